@@ -258,6 +258,13 @@ public:
 	 */
 	virtual float getPrivatePolygonOffset() = 0;
 
+	/**
+	 * Returns true if any expression of this stage refers to the shader parms
+	 * of the rendered entity. Stages without such expressions evaluate to the
+	 * same values for all entities.
+	 */
+	virtual bool usesEntityShaderParms() = 0;
+
     // If this stage is referring to a single image file, this will return 
     // the VFS path to it with the file extension removed.
     // If this layer doesn't refer to a single image file, an empty string is returned
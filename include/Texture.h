@@ -52,6 +52,17 @@ public:
      * this texture does not have a valid size.
      */
     virtual std::size_t getHeight() const = 0;
+
+    /**
+     * \brief
+     * Return false while the image of this texture is still being loaded in
+     * the background (texture streaming). Such a texture shows a placeholder,
+     * querying its size blocks until the image is available.
+     */
+    virtual bool isLoaded() const
+    {
+        return true;
+    }
 };
 typedef std::shared_ptr<Texture> TexturePtr;
 
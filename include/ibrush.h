@@ -11,6 +11,7 @@
 class Plane3;
 
 const std::string RKEY_ENABLE_TEXTURE_LOCK("user/ui/brush/textureLock");
+const std::string RKEY_DEFAULT_TEXTURE_SCALE("user/ui/textures/defaultTextureScale");
 
 namespace brush
 {
@@ -32,8 +33,13 @@ class BrushCreator :
 	public RegisterableModule
 {
 public:
+	// Creates a brush in the active layer of the current map
 	virtual scene::INodePtr createBrush() = 0;
 
+	// Creates a brush in the given layer. This doesn't access the map,
+	// the map parsers call it from their worker threads.
+	virtual scene::INodePtr createBrush(int layer) = 0;
+
 	virtual IBrushSettings& getSettings() = 0;
 };
 
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "imodule.h"
+
+#include <chrono>
+#include <functional>
+
+namespace decl
+{
+
+/**
+ * Shared worker threads for the declaration managers (materials, entityDefs,
+ * skins, particles, sound shaders and fonts) parsing their files.
+ *
+ * The managers are loading in their own background threads, which would
+ * leave most cores idle if each of them parsed its files one by one.
+ * Instead they hand their per-file work to this scheduler, whose work-stealing
+ * pool keeps all cores busy until every manager is done, and merge the
+ * parsed results in file order afterwards.
+ */
+class IDeclarationScheduler :
+	public RegisterableModule
+{
+public:
+	virtual ~IDeclarationScheduler() {}
+
+	/**
+	 * Invokes the given function for each index in [0..count) on the shared
+	 * workers and blocks until all invocations are done. The calling thread is
+	 * helping out while waiting. The invocations run concurrently and in no
+	 * particular order, the first exception thrown is rethrown after all of them
+	 * have finished.
+	 */
+	virtual void parallelFor(std::size_t count, const std::function<void(std::size_t)>& function) = 0;
+
+	// Reports the time a manager needed to parse and merge its declaration files
+	virtual void reportLoadingTime(const std::string& managerName, std::size_t numFiles,
+		std::chrono::milliseconds parseTime, std::chrono::milliseconds mergeTime) = 0;
+};
+
+}
+
+const char* const MODULE_DECLARATION_SCHEDULER("DeclarationScheduler");
+
+inline decl::IDeclarationScheduler& GlobalDeclarationScheduler()
+{
+	static module::InstanceReference<decl::IDeclarationScheduler> _reference(MODULE_DECLARATION_SCHEDULER);
+	return _reference;
+}
@@ -202,6 +202,10 @@ public:
 	// greebo: Note: expects the filename to be normalised (forward slashes, trailing slash).
 	virtual ArchiveFilePtr openFile(const std::string& filename) = 0;
 
+	/// \brief Invokes the visitor with the metadata of the file openFile() would open,
+	/// returns false without invoking it if the file is not found.
+	virtual bool findFileInfo(const std::string& filename, const VisitorFunc& visitorFunc) = 0;
+
 	/// \brief Returns the file identified by \p filename opened in binary mode, or 0 if not found.
 	// This is a variant of openFile taking an absolute path as argument.
 	virtual ArchiveFilePtr openFileInAbsolutePath(const std::string& filename) = 0;
@@ -112,6 +112,14 @@ public:
 	 */
 	virtual void updateSubgraph(const scene::INodePtr& root) = 0;
 
+	/**
+	 * Updates the "Filtered" status of the nodes which have been inserted
+	 * into the scenegraph since the last update, leaving the rest alone.
+	 * Nodes are updated right away on insertion once they are attached to
+	 * a RenderSystem, this is needed for nodes inserted before that.
+	 */
+	virtual void updateInsertedNodes() = 0;
+
 	/**
 	 * Visit the available filters, passing each filter's text name to the visitor.
 	 *
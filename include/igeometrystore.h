@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "render/ArbitraryMeshVertex.h"
+
+namespace render
+{
+
+/**
+ * Retained storage for triangle geometry, owned by the RenderSystem.
+ *
+ * Renderables copy their triangles into a slot of this store once and only
+ * update it when their geometry changes. The backend keeps the store in
+ * buffer objects and draws all slots submitted to a shader pass with
+ * a single multi-draw call, instead of calling OpenGLRenderable::render()
+ * on each of them.
+ */
+class IGeometryStore
+{
+public:
+    // Handle to the storage of a single renderable
+    typedef std::size_t Slot;
+
+    static const Slot InvalidSlot = static_cast<Slot>(-1);
+
+    virtual ~IGeometryStore() {}
+
+    /**
+     * Allocates a new slot holding the given triangles. The indices are
+     * relative to the first of the given vertices.
+     */
+    virtual Slot allocateSlot(const std::vector<ArbitraryMeshVertex>& vertices,
+                              const std::vector<unsigned int>& indices) = 0;
+
+    /**
+     * Replaces the geometry of the given slot. The handle remains valid
+     * even if the number of vertices or indices has changed.
+     */
+    virtual void updateData(Slot slot,
+                            const std::vector<ArbitraryMeshVertex>& vertices,
+                            const std::vector<unsigned int>& indices) = 0;
+
+    /**
+     * Replaces the vertices of the given slot, keeping its indices. The
+     * number of vertices must not change. Only the vertex range of this
+     * slot will be uploaded again.
+     */
+    virtual void updateVertexData(Slot slot, const std::vector<ArbitraryMeshVertex>& vertices) = 0;
+
+    // Releases the storage of the given slot, the handle is invalid afterwards
+    virtual void deallocateSlot(Slot slot) = 0;
+};
+
+}
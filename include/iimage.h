@@ -3,6 +3,8 @@
 #include "igl.h"
 #include "imodule.h"
 
+#include <vector>
+
 typedef unsigned char byte;
 
 class Texture;
@@ -49,6 +51,17 @@ public:
     /// Return the height of the image in pixels
     virtual std::size_t getHeight() const = 0;
 
+    /**
+     * \brief
+     * Upload the pixels to the given, already allocated GL texture, replacing
+     * its contents.
+     *
+     * Unlike bindTexture() this keeps the texture number, which is used to
+     * swap in the pixels of textures that have been bound before their image
+     * was available. Returns false if the pixels could not be uploaded.
+     */
+    virtual bool uploadTexture(GLuint textureNum, const std::string& name) const = 0;
+
     // greebo: Returns TRUE whether this image is precompressed (DDS)
     virtual bool isPrecompressed() const {
         return false;
@@ -77,6 +90,37 @@ public:
      */
     virtual ImagePtr imageFromVFS(const std::string& vfsPath) const = 0;
 
+    /**
+     * \brief
+     * Load a batch of images from the VFS, decoding them concurrently.
+     *
+     * The paths are resolved like the ones passed to imageFromVFS(). The
+     * returned list has the same order as the given paths, the images which
+     * could not be loaded are empty pointers.
+     *
+     * \param mipMapChain
+     * If true, the decoded images are returned along with all their mipmaps,
+     * which are computed on the worker threads. Such images are meant to be
+     * uploaded to OpenGL (without the driver having to generate the mipmaps),
+     * they report isPrecompressed() and their pixels can't be processed
+     * further. Images loaded from DDS files are returned as they are.
+     *
+     * \param maxMipMapSize
+     * If not 0, the first mipmap is scaled down until neither of its
+     * dimensions exceeds this size (e.g. GL_MAX_TEXTURE_SIZE). The images
+     * still report the size of the decoded image.
+     */
+    virtual std::vector<ImagePtr> imagesFromVFS(const std::vector<std::string>& vfsPaths,
+        bool mipMapChain = false, std::size_t maxMipMapSize = 0) const = 0;
+
+    /**
+     * \brief
+     * Returns the VFS path of the file imageFromVFS() would load for the
+     * given name (including prefix and extension), or an empty string if
+     * no such file exists.
+     */
+    virtual std::string findImageFile(const std::string& vfsPath) const = 0;
+
     /**
      * \brief
      * Load an image from a filesystem path.
@@ -169,6 +169,20 @@ public:
 
     // Exports the current selection to the given output stream, using the given map format
     virtual void exportSelected(std::ostream& out, const map::MapFormatPtr& format) = 0;
+
+    /**
+     * Saves a copy of the current map to the given path without blocking the
+     * main thread for the time it takes to write the file. The scene is copied
+     * right away, the file itself is written on a worker thread. The map format
+     * is guessed from the filename if the format argument is empty.
+     *
+     * Any background save still in progress is cancelled, the same happens when
+     * the map is saved regularly or unloaded while this one is running.
+     *
+     * Throws IMapResource::OperationException if the files can't be opened.
+     */
+    virtual map::IBackgroundMapExport::Ptr saveCopyInBackground(const std::string& absolutePath,
+        const map::MapFormatPtr& format = map::MapFormatPtr()) = 0;
 };
 typedef std::shared_ptr<IMap> IMapPtr;
 
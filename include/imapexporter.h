@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include "inode.h"
 #include "imapformat.h"
 
@@ -30,4 +31,38 @@ public:
     virtual void exportMap(const scene::INodePtr& root, const GraphTraversalFunc& traverse) = 0;
 };
 
+/**
+ * Handle to a map file which is written on a worker thread, as
+ * returned by GlobalMapModule().saveCopyInBackground().
+ *
+ * The scene has already been copied when this object is handed out,
+ * the worker thread is only operating on that copy. All methods are
+ * meant to be called from the main thread.
+ */
+class IBackgroundMapExport
+{
+public:
+    using Ptr = std::shared_ptr<IBackgroundMapExport>;
+
+    virtual ~IBackgroundMapExport() {}
+
+    // The full path of the map file being written
+    virtual const std::string& getFilename() const = 0;
+
+    // The fraction of nodes that have been written so far, in the range [0..1]
+    virtual float getProgress() const = 0;
+
+    // Returns true if the worker thread has stopped, such that finish() won't block
+    virtual bool isDone() const = 0;
+
+    // Asks the worker thread to stop as soon as possible, no file will be written
+    virtual void cancel() = 0;
+
+    // Waits for the worker thread to stop, releases the copied scene and moves
+    // the written files to their target location. Returns true if the map has
+    // been written successfully, false on failure or cancellation.
+    // Calling this more than once will return the same value.
+    virtual bool finish() = 0;
+};
+
 }
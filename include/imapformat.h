@@ -51,9 +51,11 @@ public:
 	virtual const std::string& getKeyword() const = 0;
 
 	/**
-	 * Creates and returns a primitive node according to the encountered token.
+	 * Creates and returns a primitive node according to the encountered token,
+	 * assigned to the given layer. Map readers might call this on several
+	 * threads at once, the layer is resolved by the reader beforehand.
 	 */
-    virtual scene::INodePtr parse(parser::DefTokeniser& tok) const = 0;
+    virtual scene::INodePtr parse(parser::DefTokeniser& tok, int layer) const = 0;
 };
 typedef std::shared_ptr<PrimitiveParser> PrimitiveParserPtr;
 
@@ -281,6 +283,9 @@ typedef std::shared_ptr<IMapFormatManager> IMapFormatManagerPtr;
 // Portable Map Format Name is used across module boundaries
 const char* const PORTABLE_MAP_FORMAT_NAME("Portable");
 
+// Name of the binary snapshot format used to cache the contents of large maps
+const char* const MAP_SNAPSHOT_FORMAT_NAME("Snapshot");
+
 } // namespace map
 
 const char* const MODULE_MAPFORMATMANAGER("MapFormatManager");
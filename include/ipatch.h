@@ -260,9 +260,13 @@ class IPatchModule :
 public:
 	virtual ~IPatchModule() {}
 
-	// Create a patch and return the sceneNode
+	// Create a patch in the active layer of the current map and return the sceneNode
 	virtual scene::INodePtr createPatch(PatchDefType type) = 0;
 
+	// Create a patch in the given layer. This doesn't access the map,
+	// the map parsers call it from their worker threads.
+	virtual scene::INodePtr createPatch(PatchDefType type, int layer) = 0;
+
 	virtual IPatchSettings& getSettings() = 0;
 };
 
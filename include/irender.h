@@ -14,6 +14,8 @@
  * Interfaces for the back-end renderer.
  */
 
+namespace render { class IGeometryStore; class IRenderProfiler; }
+
 /**
  * \name Global render flags
  *
@@ -383,6 +385,18 @@ public:
      * Submit OpenGL render calls.
      */
     virtual void render(const RenderInfo& info) const = 0;
+
+    /**
+     * \brief
+     * Renderables keeping their geometry in a render::IGeometryStore return
+     * the store and their slot, they are then drawn in batches by the backend
+     * instead of having render() called. The default returns false.
+     */
+    virtual bool getStorageLocation(const render::IGeometryStore*& store,
+                                    std::size_t& slot) const
+    {
+        return false;
+    }
 };
 
 class Matrix4;
@@ -566,6 +580,15 @@ public:
     /// Set the shader program to use.
     virtual void setShaderProgram(ShaderProgram prog) = 0;
 
+    /**
+     * Returns the retained geometry storage of this RenderSystem, see
+     * OpenGLRenderable::getStorageLocation().
+     */
+    virtual render::IGeometryStore& getGeometryStore() = 0;
+
+    /// Returns the profiler recording the frames rendered by this RenderSystem
+    virtual render::IRenderProfiler& getProfiler() = 0;
+
     virtual void attachRenderable(const Renderable& renderable) = 0;
     virtual void detachRenderable(const Renderable& renderable) = 0;
     virtual void forEachRenderable(const RenderableCallback& callback) const = 0;
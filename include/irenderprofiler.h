@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <ostream>
+
+namespace render
+{
+
+/**
+ * Records where the time of the rendered frames is spent, owned by the
+ * RenderSystem.
+ *
+ * The views mark their frames and the CPU sections of their front-end
+ * (scene walk, submission to the shaders), the back-end adds a section per
+ * shader pass including its draw calls, state changes and (if supported)
+ * the GPU time measured by timer queries.
+ *
+ * Recording is started by the RenderProfilerStart command, the recorded
+ * frames are written as Chrome trace file by RenderProfilerDump. While not
+ * recording, all methods return immediately.
+ */
+class IRenderProfiler
+{
+public:
+    virtual ~IRenderProfiler() {}
+
+    virtual bool isRecording() const = 0;
+
+    // Marks the beginning and the end of a frame rendered by the named view.
+    // Frames can't be nested, the inner one is ignored.
+    virtual void beginFrame(const std::string& view) = 0;
+    virtual void endFrame() = 0;
+
+    // Marks a CPU section of the current frame, sections can be nested
+    virtual void beginSection(const std::string& name) = 0;
+    virtual void endSection() = 0;
+
+    /**
+     * Adds the time one scene node needed to submit its renderables to the
+     * current frame. The times are summed up per key (e.g. the entity class
+     * of the node).
+     */
+    virtual void addSubmissionTime(const std::string& key, std::chrono::steady_clock::duration time) = 0;
+
+    // Writes the frames recorded so far in the Chrome trace event format (chrome://tracing)
+    virtual void writeChromeTrace(std::ostream& stream) const = 0;
+};
+
+// Records the enclosing scope as section of the current frame
+class ScopedRenderProfileSection
+{
+    IRenderProfiler& _profiler;
+
+public:
+    ScopedRenderProfileSection(IRenderProfiler& profiler, const std::string& name) :
+        _profiler(profiler)
+    {
+        _profiler.beginSection(name);
+    }
+
+    ~ScopedRenderProfileSection()
+    {
+        _profiler.endSection();
+    }
+};
+
+}
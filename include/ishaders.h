@@ -8,7 +8,9 @@
 #include "math/Vector3.h"
 #include "math/Vector4.h"
 
+#include <functional>
 #include <ostream>
+#include <set>
 #include <vector>
 
 #include "Texture.h"
@@ -174,6 +176,14 @@ public:
      */
     virtual TexturePtr getEditorImage() = 0;
 
+    /**
+     * \brief
+     * Return a function evaluating the editor image without creating a GL
+     * texture, which is used to generate previews. The function can be invoked
+     * on any thread, it returns an empty pointer if there is no image.
+     */
+    virtual std::function<ImagePtr()> getEditorImageLoader() = 0;
+
     /**
      * \brief
      * Return true if the editor image is no tex for this shader.
@@ -451,6 +461,27 @@ public:
 	 */
 	virtual TexturePtr loadTextureFromFile(const std::string& filename) = 0;
 
+	/**
+	 * Uploads the textures which have been loaded in the background since
+	 * the last call (texture streaming mode), until the time budget of a
+	 * frame is used up. Needs to be called with a current GL context, the
+	 * renderers are calling this once per frame. Returns true if there are
+	 * more textures waiting to be uploaded.
+	 */
+	virtual bool uploadStreamedTextures() = 0;
+
+	/**
+	 * Loads the editor images of the named materials in one batch, decoding
+	 * them concurrently, such that getEditorImage() returns them right away.
+	 * Used to warm the textures before they are needed one by one. Needs to
+	 * be called with a current GL context.
+	 */
+	virtual void prefetchEditorImages(const std::set<std::string>& materialNames) = 0;
+
+	// Signal emitted when streamed textures are waiting to be uploaded,
+	// the views need to be redrawn. Might be emitted from any thread.
+	virtual sigc::signal<void>& signal_TexturesStreamed() = 0;
+
 	/**
 	 * Creates a new shader expression for the given string. This can be used to create standalone
 	 * expression objects for unit testing purposes.
@@ -1,7 +1,6 @@
 #ifndef _ISPACE_PARTITION_H_
 #define _ISPACE_PARTITION_H_
 
-#include <list>
 #include <vector>
 #include "imodule.h"
 
@@ -44,7 +43,7 @@ public:
 	typedef std::vector<ISPNodePtr> NodeList;
 
 	// The members
-	typedef std::list<INodePtr> MemberList;
+	typedef std::vector<INodePtr> MemberList;
 
 	// Get the parent node (can be NULL for the root node)
 	virtual ISPNodePtr getParent() const = 0;
@@ -75,6 +74,10 @@ typedef std::shared_ptr<ISPNode> ISPNodePtr;
  * Note: It's not allowed to call link() for nodes which are already linked into the tree.
  * It's safe to call unlink() for any node at any time, even multiple times in a row.
  * The unlink() method will return true if the node had been linked before.
+ *
+ * When the bounds of a linked node change, relink() is called. Implementations
+ * may choose to defer the actual relocation of the node until the tree is traversed
+ * the next time, getRoot() is the point where pending changes have to be applied.
  */
 class ISpacePartitionSystem
 {
@@ -88,8 +91,13 @@ public:
 	// (node had been linked before)
 	virtual bool unlink(const scene::INodePtr& sceneNode) = 0;
 
+	// Moves the given node to the place matching its changed bounds, returns true
+	// if the node is linked into this tree (otherwise nothing happens)
+	virtual bool relink(const scene::INodePtr& sceneNode) = 0;
+
 	// Returns the root node of this SP tree (the largest one, encompassing everything)
-	virtual ISPNodePtr getRoot() const = 0;
+	// Any deferred relinks are applied before the root is returned.
+	virtual ISPNodePtr getRoot() = 0;
 };
 typedef std::shared_ptr<ISpacePartitionSystem> ISpacePartitionSystemPtr;
 
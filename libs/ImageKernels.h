@@ -0,0 +1,855 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "iimage.h"
+#include "ThreadPool.h"
+#include "math/FloatTools.h"
+#include "math/Vector3.h"
+
+// The SSE2 paths assume lrint() rounding to nearest with ties to even,
+// which is not what the FreeBSD replacement in math/lrint.h is doing
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(__FreeBSD__)
+#define IMAGE_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * Pixel processing kernels used by the map expressions and the TextureManipulator.
+ *
+ * All kernels are working on tightly packed RGBA images (unless stated
+ * otherwise) and produce exactly the same bytes as the per-pixel loops they
+ * replaced, the SSE2 paths are using integer arithmetic or the same float
+ * operations in the same order. Larger images are split into ranges of rows,
+ * which are processed on the shared util::ThreadPool.
+ */
+namespace image
+{
+
+namespace detail
+{
+
+// Images smaller than this are processed on the calling thread
+const std::size_t MIN_PIXELS_PER_TASK = 64 * 1024;
+
+// Invokes function(firstRow, endRow) for consecutive ranges covering all rows
+template<typename RowRangeFunction>
+inline void forEachRowRange(std::size_t width, std::size_t height, const RowRangeFunction& function)
+{
+	std::size_t rowsPerTask = std::max<std::size_t>(MIN_PIXELS_PER_TASK / std::max<std::size_t>(width, 1), 1);
+	std::size_t numTasks = (height + rowsPerTask - 1) / rowsPerTask;
+
+	if (numTasks <= 1)
+	{
+		function(0, height);
+		return;
+	}
+
+	util::ThreadPool::GetShared().parallelFor(numTasks, [&](std::size_t task)
+	{
+		std::size_t firstRow = task * rowsPerTask;
+		function(firstRow, std::min(firstRow + rowsPerTask, height));
+	});
+}
+
+// Invokes function(pixels, numPixels) for consecutive ranges covering the image,
+// the pixel pointers are passed as offsets in pixels from the start of the image
+template<typename PixelRangeFunction>
+inline void forEachPixelRange(std::size_t width, std::size_t height, const PixelRangeFunction& function)
+{
+	forEachRowRange(width, height, [&](std::size_t firstRow, std::size_t endRow)
+	{
+		function(firstRow * width, (endRow - firstRow) * width);
+	});
+}
+
+// Index of the neighbouring row or column, wrapping around at the borders
+inline std::size_t wrap(std::size_t index, int offset, std::size_t size)
+{
+	return (index + size + offset) % size;
+}
+
+#ifdef IMAGE_KERNELS_SSE2
+
+inline __m128i load(const byte* pixels)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+}
+
+inline void store(byte* pixels, __m128i value)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels), value);
+}
+
+// (a + b) / 2 per byte, rounding ties to even like lrint() does
+inline __m128i averageRoundToEven(__m128i a, __m128i b)
+{
+	__m128i roundedUp = _mm_avg_epu8(a, b);
+
+	// avg rounds ties up, which is wrong if the rounded value is odd
+	__m128i correction = _mm_and_si128(_mm_and_si128(_mm_xor_si128(a, b), roundedUp), _mm_set1_epi8(1));
+
+	return _mm_sub_epi8(roundedUp, correction);
+}
+
+// row1 + ((row2 - row1) * lerp) >> 16 per byte, lerp in [0..65535]
+inline __m128i lerp16(__m128i row1, __m128i row2, int lerp)
+{
+	__m128i signedLerp = _mm_set1_epi16(static_cast<short>(lerp));
+	__m128i delta = _mm_sub_epi16(row2, row1);
+
+	// mulhi is treating lerp as signed, which is lerp - 65536 for the upper half
+	__m128i product = _mm_mulhi_epi16(delta, signedLerp);
+
+	if (lerp >= 0x8000)
+	{
+		product = _mm_add_epi16(product, delta);
+	}
+
+	return _mm_add_epi16(row1, product);
+}
+
+#endif
+
+} // namespace detail
+
+/**
+ * out = (a + b) / 2 per RGB channel, alpha is set to 255.
+ * Averages the normals of two normal maps (addnormals).
+ */
+inline void addNormals(const byte* a, const byte* b, byte* out, std::size_t width, std::size_t height)
+{
+	detail::forEachPixelRange(width, height, [&](std::size_t first, std::size_t count)
+	{
+		const byte* pixOne = a + first * 4;
+		const byte* pixTwo = b + first * 4;
+		byte* pixOut = out + first * 4;
+		std::size_t i = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+		for (; i + 4 <= count; i += 4, pixOne += 16, pixTwo += 16, pixOut += 16)
+		{
+			__m128i average = detail::averageRoundToEven(detail::load(pixOne), detail::load(pixTwo));
+			detail::store(pixOut, _mm_or_si128(average, alpha));
+		}
+#endif
+
+		for (; i < count; ++i, pixOne += 4, pixTwo += 4, pixOut += 4)
+		{
+			// create the two vectors
+			Vector3 vectorOne(pixOne[0], pixOne[1], pixOne[2]);
+			Vector3 vectorTwo(pixTwo[0], pixTwo[1], pixTwo[2]);
+
+			// Take the mean value of the two vectors
+			Vector3 vectorOut = (vectorOne + vectorTwo) * 0.5;
+
+			pixOut[0] = static_cast<byte>(float_to_integer(vectorOut.x()));
+			pixOut[1] = static_cast<byte>(float_to_integer(vectorOut.y()));
+			pixOut[2] = static_cast<byte>(float_to_integer(vectorOut.z()));
+			pixOut[3] = 255;
+		}
+	});
+}
+
+/**
+ * out = (a + b) / 2 for all four channels (add).
+ */
+inline void add(const byte* a, const byte* b, byte* out, std::size_t width, std::size_t height)
+{
+	detail::forEachPixelRange(width, height, [&](std::size_t first, std::size_t count)
+	{
+		const byte* pixOne = a + first * 4;
+		const byte* pixTwo = b + first * 4;
+		byte* pixOut = out + first * 4;
+		std::size_t i = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+		for (; i + 4 <= count; i += 4, pixOne += 16, pixTwo += 16, pixOut += 16)
+		{
+			detail::store(pixOut, detail::averageRoundToEven(detail::load(pixOne), detail::load(pixTwo)));
+		}
+#endif
+
+		for (; i < count; ++i, pixOne += 4, pixTwo += 4, pixOut += 4)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				pixOut[c] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[c]) + pixTwo[c]) * 0.5f));
+			}
+		}
+	});
+}
+
+/**
+ * out = min(in * factor, 255) per channel, the factors must not be negative (scale).
+ */
+inline void scale(const byte* in, byte* out, std::size_t width, std::size_t height, const float factors[4])
+{
+#ifdef IMAGE_KERNELS_SSE2
+	// The vector conversion saturates differently when exceeding the int range,
+	// leave these (and NaNs) to the scalar loop
+	bool factorsInRange = true;
+
+	for (int c = 0; c < 4; ++c)
+	{
+		factorsInRange &= factors[c] * 255.0f < 2147483648.0f;
+	}
+#endif
+
+	detail::forEachPixelRange(width, height, [&](std::size_t first, std::size_t count)
+	{
+		const byte* pixIn = in + first * 4;
+		byte* pixOut = out + first * 4;
+		std::size_t i = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+		if (factorsInRange)
+		{
+			const __m128 factor = _mm_loadu_ps(factors);
+			const __m128i zero = _mm_setzero_si128();
+
+			for (; i + 4 <= count; i += 4, pixIn += 16, pixOut += 16)
+			{
+				__m128i pixels = detail::load(pixIn);
+				__m128i lo = _mm_unpacklo_epi8(pixels, zero);
+				__m128i hi = _mm_unpackhi_epi8(pixels, zero);
+
+				// One pixel per register, multiplied and rounded to nearest even
+				__m128i p0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), factor));
+				__m128i p1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), factor));
+				__m128i p2 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), factor));
+				__m128i p3 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), factor));
+
+				// Saturating packs clamp the values to 255
+				detail::store(pixOut, _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3)));
+			}
+		}
+#endif
+
+		for (; i < count; ++i, pixIn += 4, pixOut += 4)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				// prevent negative values and check for values >255
+				int value = float_to_integer(static_cast<float>(pixIn[c]) * factors[c]);
+				pixOut[c] = (value > 255) ? 255 : static_cast<byte>(value);
+			}
+		}
+	});
+}
+
+/**
+ * Bitwise operations on each pixel, out = (in ^ xorMask)
+ * Used by invertalpha and invertcolor.
+ */
+inline void invert(const byte* in, byte* out, std::size_t width, std::size_t height, bool colour, bool alpha)
+{
+	const byte colourMask = colour ? 255 : 0;
+	const byte alphaMask = alpha ? 255 : 0;
+
+	detail::forEachPixelRange(width, height, [&](std::size_t first, std::size_t count)
+	{
+		const byte* pixIn = in + first * 4;
+		byte* pixOut = out + first * 4;
+		std::size_t i = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+		const __m128i mask = _mm_setr_epi8(
+			colourMask, colourMask, colourMask, alphaMask, colourMask, colourMask, colourMask, alphaMask,
+			colourMask, colourMask, colourMask, alphaMask, colourMask, colourMask, colourMask, alphaMask);
+
+		for (; i + 4 <= count; i += 4, pixIn += 16, pixOut += 16)
+		{
+			detail::store(pixOut, _mm_xor_si128(detail::load(pixIn), mask));
+		}
+#endif
+
+		for (; i < count; ++i, pixIn += 4, pixOut += 4)
+		{
+			pixOut[0] = pixIn[0] ^ colourMask;
+			pixOut[1] = pixIn[1] ^ colourMask;
+			pixOut[2] = pixIn[2] ^ colourMask;
+			pixOut[3] = pixIn[3] ^ alphaMask;
+		}
+	});
+}
+
+/**
+ * Copies the red channel into all four channels (makeintensity).
+ */
+inline void makeIntensity(const byte* in, byte* out, std::size_t width, std::size_t height)
+{
+	detail::forEachPixelRange(width, height, [&](std::size_t first, std::size_t count)
+	{
+		const byte* pixIn = in + first * 4;
+		byte* pixOut = out + first * 4;
+		std::size_t i = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+		const __m128i red = _mm_set1_epi32(0xFF);
+
+		for (; i + 4 <= count; i += 4, pixIn += 16, pixOut += 16)
+		{
+			__m128i value = _mm_and_si128(detail::load(pixIn), red);
+			value = _mm_or_si128(value, _mm_slli_epi32(value, 8));
+			value = _mm_or_si128(value, _mm_slli_epi32(value, 16));
+
+			detail::store(pixOut, value);
+		}
+#endif
+
+		for (; i < count; ++i, pixIn += 4, pixOut += 4)
+		{
+			pixOut[0] = pixIn[0];
+			pixOut[1] = pixIn[0];
+			pixOut[2] = pixIn[0];
+			pixOut[3] = pixIn[0];
+		}
+	});
+}
+
+/**
+ * Sets the colour to white and the alpha to the average of the RGB channels (makealpha).
+ */
+inline void makeAlpha(const byte* in, byte* out, std::size_t width, std::size_t height)
+{
+	detail::forEachPixelRange(width, height, [&](std::size_t first, std::size_t count)
+	{
+		const byte* pixIn = in + first * 4;
+		byte* pixOut = out + first * 4;
+		std::size_t i = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+		const __m128i channel = _mm_set1_epi32(0xFF);
+		const __m128i white = _mm_set1_epi32(0x00FFFFFF);
+
+		// sum / 3 == (sum * 43691) >> 17 for all sums up to 765
+		const __m128i oneThird = _mm_set1_epi32(43691);
+
+		for (; i + 4 <= count; i += 4, pixIn += 16, pixOut += 16)
+		{
+			__m128i pixels = detail::load(pixIn);
+
+			__m128i sum = _mm_add_epi32(
+				_mm_add_epi32(_mm_and_si128(pixels, channel), _mm_and_si128(_mm_srli_epi32(pixels, 8), channel)),
+				_mm_and_si128(_mm_srli_epi32(pixels, 16), channel));
+
+			// The sum fits into the lower 16 bits of each lane, the upper ones stay zero
+			__m128i average = _mm_srli_epi32(_mm_mulhi_epu16(sum, oneThird), 1);
+
+			detail::store(pixOut, _mm_or_si128(_mm_slli_epi32(average, 24), white));
+		}
+#endif
+
+		for (; i < count; ++i, pixIn += 4, pixOut += 4)
+		{
+			pixOut[0] = 255;
+			pixOut[1] = 255;
+			pixOut[2] = 255;
+			pixOut[3] = (pixIn[0] + pixIn[1] + pixIn[2]) / 3;
+		}
+	});
+}
+
+/**
+ * Averages the RGB channels of each pixel with its 8 neighbours, wrapping
+ * around at the borders. Alpha is set to 255 (smoothnormals).
+ */
+inline void smoothNormals(const byte* in, byte* out, std::size_t width, std::size_t height)
+{
+	// Scalar version of a single pixel
+	auto smoothPixel = [&](const byte* rows[3], std::size_t x, byte* pixOut)
+	{
+		const float perKernelSize = 1.0f / 9;
+
+		// the new normal vector for this pixel
+		Vector3 smoothVector(0, 0, 0);
+
+		// calculate the average direction of the surrounding vectors
+		for (int dy = 0; dy < 3; ++dy)
+		{
+			for (int dx = -1; dx <= 1; ++dx)
+			{
+				const byte* pixel = rows[dy] + detail::wrap(x, dx, width) * 4;
+				smoothVector += Vector3(pixel[0], pixel[1], pixel[2]);
+			}
+		}
+
+		// Take the average normal vector as result
+		smoothVector *= perKernelSize;
+
+		pixOut[0] = static_cast<byte>(float_to_integer(smoothVector.x()));
+		pixOut[1] = static_cast<byte>(float_to_integer(smoothVector.y()));
+		pixOut[2] = static_cast<byte>(float_to_integer(smoothVector.z()));
+		pixOut[3] = 255;
+	};
+
+	detail::forEachRowRange(width, height, [&](std::size_t firstRow, std::size_t endRow)
+	{
+		for (std::size_t y = firstRow; y < endRow; ++y)
+		{
+			const byte* rows[3] = {
+				in + detail::wrap(y, -1, height) * width * 4,
+				in + y * width * 4,
+				in + detail::wrap(y, 1, height) * width * 4
+			};
+
+			byte* pixOut = out + y * width * 4;
+			std::size_t x = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+			if (width >= 6)
+			{
+				smoothPixel(rows, 0, pixOut);
+
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+				const __m128i four = _mm_set1_epi16(4);
+
+				// The float multiplication with 1/9 can never end up close to a .5 tie,
+				// it rounds like (sum + 4) / 9, which is (x * 58255) >> 19 for all sums
+				const __m128i oneNinth = _mm_set1_epi16(static_cast<short>(58255));
+
+				// Four pixels per iteration, all neighbours are inside the row
+				for (x = 1; x + 5 <= width; x += 4)
+				{
+					__m128i sumLo = four;
+					__m128i sumHi = four;
+
+					for (const byte* row : rows)
+					{
+						for (int dx = -1; dx <= 1; ++dx)
+						{
+							__m128i pixels = detail::load(row + (x + dx) * 4);
+							sumLo = _mm_add_epi16(sumLo, _mm_unpacklo_epi8(pixels, zero));
+							sumHi = _mm_add_epi16(sumHi, _mm_unpackhi_epi8(pixels, zero));
+						}
+					}
+
+					__m128i averageLo = _mm_srli_epi16(_mm_mulhi_epu16(sumLo, oneNinth), 3);
+					__m128i averageHi = _mm_srli_epi16(_mm_mulhi_epu16(sumHi, oneNinth), 3);
+
+					detail::store(pixOut + x * 4, _mm_or_si128(_mm_packus_epi16(averageLo, averageHi), alpha));
+				}
+			}
+#endif
+
+			for (; x < width; ++x)
+			{
+				smoothPixel(rows, x, pixOut + x * 4);
+			}
+		}
+	});
+}
+
+/**
+ * Converts the heights stored in the red channel into a normal map, using a
+ * 3x3 Prewitt filter wrapping around at the borders (heightmap).
+ */
+inline void heightmapToNormalmap(const byte* in, byte* out, std::size_t width, std::size_t height, float scale)
+{
+	// Scalar version of a single pixel, if you want to understand the code below,
+	// read http://en.wikipedia.org/wiki/Edge_detection
+	auto normalPixel = [&](const byte* rows[3], std::size_t x, byte* pixOut)
+	{
+		std::size_t left = detail::wrap(x, -1, width) * 4;
+		std::size_t right = detail::wrap(x, 1, width) * 4;
+		x *= 4;
+
+		// rows[0] is y - 1, rows[2] is y + 1
+		float du = 0;
+		du += (rows[2][left] / 255.0f) * -1.0f;
+		du += (rows[1][left] / 255.0f) * -1.0f;
+		du += (rows[0][left] / 255.0f) * -1.0f;
+		du += (rows[2][right] / 255.0f) * 1.0f;
+		du += (rows[1][right] / 255.0f) * 1.0f;
+		du += (rows[0][right] / 255.0f) * 1.0f;
+
+		float dv = 0;
+		dv += (rows[2][left] / 255.0f) * 1.0f;
+		dv += (rows[2][x] / 255.0f) * 1.0f;
+		dv += (rows[2][right] / 255.0f) * 1.0f;
+		dv += (rows[0][left] / 255.0f) * -1.0f;
+		dv += (rows[0][x] / 255.0f) * -1.0f;
+		dv += (rows[0][right] / 255.0f) * -1.0f;
+
+		float nx = -du * scale;
+		float ny = -dv * scale;
+		float nz = 1.0;
+
+		// Normalize, in double precision like the former sqrt() call did
+		float norm = static_cast<float>(1.0 / std::sqrt(static_cast<double>(nx*nx + ny*ny + nz*nz)));
+		pixOut[0] = static_cast<byte>(float_to_integer(((nx * norm) + 1) * 127.5));
+		pixOut[1] = static_cast<byte>(float_to_integer(((ny * norm) + 1) * 127.5));
+		pixOut[2] = static_cast<byte>(float_to_integer(((nz * norm) + 1) * 127.5));
+		pixOut[3] = 255;
+	};
+
+	detail::forEachRowRange(width, height, [&](std::size_t firstRow, std::size_t endRow)
+	{
+		for (std::size_t y = firstRow; y < endRow; ++y)
+		{
+			const byte* rows[3] = {
+				in + detail::wrap(y, -1, height) * width * 4,
+				in + y * width * 4,
+				in + detail::wrap(y, 1, height) * width * 4
+			};
+
+			byte* pixOut = out + y * width * 4;
+			std::size_t x = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+			if (width >= 6)
+			{
+				normalPixel(rows, 0, pixOut);
+
+				const __m128i red = _mm_set1_epi32(0xFF);
+				const __m128 maxHeight = _mm_set1_ps(255.0f);
+				const __m128 scaleFactor = _mm_set1_ps(scale);
+				const __m128 one = _mm_set1_ps(1.0f);
+				const __m128d oneDouble = _mm_set1_pd(1.0);
+				const __m128d halfRange = _mm_set1_pd(127.5);
+				const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+				// The heights of four pixels, divided by 255 like the scalar code
+				auto heights = [&](const byte* row, std::size_t x)
+				{
+					return _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(detail::load(row + x * 4), red)), maxHeight);
+				};
+
+				// ((n * norm) + 1) * 127.5 is evaluated in double precision,
+				// which is exact and rounds like lrint() on conversion
+				auto toByte = [&](__m128 n)
+				{
+					__m128i lo = _mm_cvtpd_epi32(_mm_mul_pd(_mm_cvtps_pd(n), halfRange));
+					__m128i hi = _mm_cvtpd_epi32(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(n, n)), halfRange));
+					return _mm_unpacklo_epi64(lo, hi);
+				};
+
+				for (x = 1; x + 5 <= width; x += 4)
+				{
+					__m128 topLeft = heights(rows[0], x - 1);
+					__m128 top = heights(rows[0], x);
+					__m128 topRight = heights(rows[0], x + 1);
+					__m128 left = heights(rows[1], x - 1);
+					__m128 right = heights(rows[1], x + 1);
+					__m128 bottomLeft = heights(rows[2], x - 1);
+					__m128 bottom = heights(rows[2], x);
+					__m128 bottomRight = heights(rows[2], x + 1);
+
+					// Same order of operations as the scalar code, x - y is the same as x + (y * -1)
+					__m128 zero = _mm_setzero_ps();
+					__m128 du = _mm_sub_ps(zero, bottomLeft);
+					du = _mm_sub_ps(du, left);
+					du = _mm_sub_ps(du, topLeft);
+					du = _mm_add_ps(du, bottomRight);
+					du = _mm_add_ps(du, right);
+					du = _mm_add_ps(du, topRight);
+
+					__m128 dv = _mm_add_ps(zero, bottomLeft);
+					dv = _mm_add_ps(dv, bottom);
+					dv = _mm_add_ps(dv, bottomRight);
+					dv = _mm_sub_ps(dv, topLeft);
+					dv = _mm_sub_ps(dv, top);
+					dv = _mm_sub_ps(dv, topRight);
+
+					__m128 nx = _mm_mul_ps(_mm_sub_ps(zero, du), scaleFactor);
+					__m128 ny = _mm_mul_ps(_mm_sub_ps(zero, dv), scaleFactor);
+
+					__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), one);
+					__m128 norm = _mm_movelh_ps(
+						_mm_cvtpd_ps(_mm_div_pd(oneDouble, _mm_sqrt_pd(_mm_cvtps_pd(lengthSquared)))),
+						_mm_cvtpd_ps(_mm_div_pd(oneDouble, _mm_sqrt_pd(_mm_cvtps_pd(_mm_movehl_ps(lengthSquared, lengthSquared))))));
+
+					__m128i r = toByte(_mm_add_ps(_mm_mul_ps(nx, norm), one));
+					__m128i g = toByte(_mm_add_ps(_mm_mul_ps(ny, norm), one));
+					__m128i b = toByte(_mm_add_ps(_mm_mul_ps(one, norm), one));
+
+					__m128i pixels = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+						_mm_or_si128(_mm_slli_epi32(b, 16), alpha));
+
+					detail::store(pixOut + x * 4, pixels);
+				}
+			}
+#endif
+
+			for (; x < width; ++x)
+			{
+				normalPixel(rows, x, pixOut + x * 4);
+			}
+		}
+	});
+}
+
+/**
+ * Bilinear resampling of an image with 3 or 4 bytes per pixel, using 16.16 fixed
+ * point steps (the former R_ResampleTexture). in and out must not overlap.
+ */
+inline void resample(const byte* in, std::size_t inWidth, std::size_t inHeight,
+	byte* out, std::size_t outWidth, std::size_t outHeight, int bytesPerPixel)
+{
+	const std::size_t bpp = static_cast<std::size_t>(bytesPerPixel);
+	const std::size_t inRowSize = inWidth * bpp;
+	const std::size_t outRowSize = outWidth * bpp;
+
+	// Horizontally resamples a source row
+	auto lerpLine = [&](const byte* inRow, byte* outRow)
+	{
+		std::size_t fstep = static_cast<std::size_t>(inWidth * 65536.0f / outWidth);
+		std::size_t endx = inWidth - 1;
+		std::size_t f = 0;
+
+		for (std::size_t j = 0; j < outWidth; ++j, f += fstep, outRow += bpp)
+		{
+			std::size_t xi = f >> 16;
+			const byte* pixel = inRow + xi * bpp;
+
+			if (xi < endx)
+			{
+				int lerp = static_cast<int>(f & 0xFFFF);
+
+#ifdef IMAGE_KERNELS_SSE2
+				if (bpp == 4)
+				{
+					// This pixel and the next one
+					__m128i pixels = _mm_unpacklo_epi8(
+						_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel)), _mm_setzero_si128());
+					__m128i result = detail::lerp16(pixels, _mm_srli_si128(pixels, 8), lerp);
+
+					int packed = _mm_cvtsi128_si32(_mm_packus_epi16(result, result));
+					std::memcpy(outRow, &packed, 4);
+					continue;
+				}
+#endif
+				// The differences are multiplied as unsigned numbers in the original
+				// code, the shift of the wrapped-around product behaves like floor()
+				for (std::size_t c = 0; c < bpp; ++c)
+				{
+					int delta = pixel[c + bpp] - pixel[c];
+					outRow[c] = static_cast<byte>((delta * lerp >> 16) + pixel[c]);
+				}
+			}
+			else // last pixel of the line has no pixel to lerp to
+			{
+				std::memcpy(outRow, pixel, bpp);
+			}
+		}
+	};
+
+	// Vertically interpolates between two resampled rows
+	auto lerpRows = [&](const byte* row1, const byte* row2, byte* outRow, int lerp)
+	{
+		std::size_t i = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+		const __m128i zero = _mm_setzero_si128();
+
+		for (; i + 16 <= outRowSize; i += 16)
+		{
+			__m128i a = detail::load(row1 + i);
+			__m128i b = detail::load(row2 + i);
+
+			__m128i lo = detail::lerp16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), lerp);
+			__m128i hi = detail::lerp16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), lerp);
+
+			detail::store(outRow + i, _mm_packus_epi16(lo, hi));
+		}
+#endif
+
+		for (; i < outRowSize; ++i)
+		{
+			int delta = row2[i] - row1[i];
+			outRow[i] = static_cast<byte>((delta * lerp >> 16) + row1[i]);
+		}
+	};
+
+	std::size_t fstep = (int) (inHeight * 65536.0f / outHeight);
+	std::size_t endy = inHeight - 1;
+
+	detail::forEachRowRange(outWidth, outHeight, [&](std::size_t firstRow, std::size_t endRow)
+	{
+		// The resampled source rows yi and yi + 1, reused by the following output rows
+		std::vector<byte> row1(outRowSize);
+		std::vector<byte> row2(outRowSize);
+		std::size_t cachedRow = 0;
+		bool rowsCached = false;
+
+		for (std::size_t i = firstRow; i < endRow; ++i)
+		{
+			std::size_t f = i * fstep;
+			std::size_t yi = f >> 16;
+			const byte* inRow = in + inRowSize * yi;
+			byte* outRow = out + outRowSize * i;
+
+			if (yi < endy)
+			{
+				if (!rowsCached || yi != cachedRow)
+				{
+					if (rowsCached && yi == cachedRow + 1)
+					{
+						row1.swap(row2);
+					}
+					else
+					{
+						lerpLine(inRow, row1.data());
+					}
+
+					lerpLine(inRow + inRowSize, row2.data());
+					cachedRow = yi;
+					rowsCached = true;
+				}
+
+				lerpRows(row1.data(), row2.data(), outRow, static_cast<int>(f & 0xFFFF));
+			}
+			else
+			{
+				lerpLine(inRow, outRow);
+			}
+		}
+	});
+}
+
+/**
+ * Halves the image in both directions, or only in the one exceeding the
+ * destination size, by averaging the pixels (rounding down). in may be the
+ * same as out, the rows are only processed concurrently if it isn't.
+ */
+inline void mipReduce(const byte* in, byte* out, std::size_t width, std::size_t height,
+	std::size_t destWidth, std::size_t destHeight)
+{
+	bool reduceWidth = width > destWidth;
+	bool reduceHeight = height > destHeight;
+
+	if (!reduceWidth && !reduceHeight)
+	{
+		return;
+	}
+
+	std::size_t outWidth = reduceWidth ? width >> 1 : width;
+	std::size_t outHeight = reduceHeight ? height >> 1 : height;
+	std::size_t inRowSize = width * 4;
+
+	auto reduceRows = [&](std::size_t firstRow, std::size_t endRow)
+	{
+		for (std::size_t y = firstRow; y < endRow; ++y)
+		{
+			const byte* row1 = in + inRowSize * (reduceHeight ? y * 2 : y);
+			const byte* row2 = reduceHeight ? row1 + inRowSize : row1;
+			byte* outRow = out + outWidth * 4 * y;
+			std::size_t x = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+			const __m128i zero = _mm_setzero_si128();
+
+			if (reduceWidth)
+			{
+				// Four output pixels from eight source pixels per row
+				for (; x + 4 <= outWidth; x += 4)
+				{
+					__m128i a = detail::load(row1 + x * 8);
+					__m128i b = detail::load(row1 + x * 8 + 16);
+
+					// 16 bit sums of the two rows, two pixels per register
+					__m128i sum01 = _mm_unpacklo_epi8(a, zero);
+					__m128i sum23 = _mm_unpackhi_epi8(a, zero);
+					__m128i sum45 = _mm_unpacklo_epi8(b, zero);
+					__m128i sum67 = _mm_unpackhi_epi8(b, zero);
+
+					if (reduceHeight)
+					{
+						__m128i c = detail::load(row2 + x * 8);
+						__m128i d = detail::load(row2 + x * 8 + 16);
+
+						sum01 = _mm_add_epi16(sum01, _mm_unpacklo_epi8(c, zero));
+						sum23 = _mm_add_epi16(sum23, _mm_unpackhi_epi8(c, zero));
+						sum45 = _mm_add_epi16(sum45, _mm_unpacklo_epi8(d, zero));
+						sum67 = _mm_add_epi16(sum67, _mm_unpackhi_epi8(d, zero));
+					}
+
+					// Add the even to the odd pixels
+					__m128i first = _mm_add_epi16(_mm_unpacklo_epi64(sum01, sum23), _mm_unpackhi_epi64(sum01, sum23));
+					__m128i second = _mm_add_epi16(_mm_unpacklo_epi64(sum45, sum67), _mm_unpackhi_epi64(sum45, sum67));
+
+					int shift = reduceHeight ? 2 : 1;
+					first = _mm_srl_epi16(first, _mm_cvtsi32_si128(shift));
+					second = _mm_srl_epi16(second, _mm_cvtsi32_si128(shift));
+
+					detail::store(outRow + x * 4, _mm_packus_epi16(first, second));
+				}
+			}
+			else
+			{
+				// (a + b) >> 1 is the rounded-up average minus the lost bit
+				for (; x + 4 <= outWidth; x += 4)
+				{
+					__m128i a = detail::load(row1 + x * 4);
+					__m128i b = detail::load(row2 + x * 4);
+
+					__m128i roundedUp = _mm_avg_epu8(a, b);
+					__m128i lostBit = _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1));
+
+					detail::store(outRow + x * 4, _mm_sub_epi8(roundedUp, lostBit));
+				}
+			}
+#endif
+
+			for (; x < outWidth; ++x)
+			{
+				const byte* a = reduceWidth ? row1 + x * 8 : row1 + x * 4;
+				const byte* b = reduceWidth ? row2 + x * 8 : row2 + x * 4;
+
+				for (int c = 0; c < 4; ++c)
+				{
+					if (reduceWidth && reduceHeight)
+					{
+						outRow[x * 4 + c] = static_cast<byte>((a[c] + a[c + 4] + b[c] + b[c + 4]) >> 2);
+					}
+					else if (reduceWidth)
+					{
+						outRow[x * 4 + c] = static_cast<byte>((a[c] + a[c + 4]) >> 1);
+					}
+					else
+					{
+						outRow[x * 4 + c] = static_cast<byte>((a[c] + b[c]) >> 1);
+					}
+				}
+			}
+		}
+	};
+
+	if (in == out)
+	{
+		// The output rows are overwriting source rows still needed by other tasks
+		reduceRows(0, outHeight);
+	}
+	else
+	{
+		detail::forEachRowRange(outWidth, outHeight, reduceRows);
+	}
+}
+
+/**
+ * Replaces the RGB channels of each pixel by their entry in the given table,
+ * alpha is left untouched (gamma correction).
+ */
+inline void applyTable(byte* pixels, std::size_t width, std::size_t height, const byte table[256])
+{
+	detail::forEachPixelRange(width, height, [&](std::size_t first, std::size_t count)
+	{
+		byte* pixel = pixels + first * 4;
+
+		for (std::size_t i = 0; i < count; ++i, pixel += 4)
+		{
+			pixel[0] = table[pixel[0]];
+			pixel[1] = table[pixel[1]];
+			pixel[2] = table[pixel[2]];
+		}
+	});
+}
+
+} // namespace image
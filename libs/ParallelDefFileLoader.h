@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "ifilesystem.h"
+#include "ideclscheduler.h"
+
+namespace util
+{
+
+/**
+ * Helper for the declaration managers parsing their files on the workers of
+ * the shared DeclarationScheduler.
+ *
+ * The files are collected first, then each of them is parsed into a separate
+ * ParseResult, concurrently and in no particular order. The results are merged
+ * on the calling thread afterwards, strictly in the order the files have been
+ * added, which makes the outcome (e.g. which of two definitions wins) the same
+ * as parsing the files one after the other.
+ *
+ * An exception thrown by the parse function is held back until the results of
+ * all previous files have been merged, and is rethrown in place of merging the
+ * failing file.
+ */
+template<typename ParseResult>
+class ParallelDefFileLoader
+{
+private:
+	std::string _managerName;
+	std::vector<vfs::FileInfo> _files;
+
+public:
+	// The manager name is used to report the loading time
+	ParallelDefFileLoader(const std::string& managerName) :
+		_managerName(managerName)
+	{}
+
+	// Adds a file to the list, can be used as VFS visitor
+	void addFile(const vfs::FileInfo& fileInfo)
+	{
+		_files.push_back(fileInfo);
+	}
+
+	const std::vector<vfs::FileInfo>& getFiles() const
+	{
+		return _files;
+	}
+
+	/**
+	 * Parses and merges all files.
+	 *
+	 * @parse: ParseResult(const vfs::FileInfo&), invoked concurrently, must not touch
+	 * any state shared with other files.
+	 *
+	 * @merge: void(const vfs::FileInfo&, ParseResult&), invoked on the calling thread
+	 * once per file, in order.
+	 */
+	template<typename ParseFunction, typename MergeFunction>
+	void load(const ParseFunction& parse, const MergeFunction& merge)
+	{
+		std::vector<ParseResult> results(_files.size());
+		std::vector<std::exception_ptr> errors(_files.size());
+
+		auto start = std::chrono::steady_clock::now();
+
+		GlobalDeclarationScheduler().parallelFor(_files.size(), [&](std::size_t i)
+		{
+			try
+			{
+				results[i] = parse(_files[i]);
+			}
+			catch (...)
+			{
+				errors[i] = std::current_exception();
+			}
+		});
+
+		auto parsed = std::chrono::steady_clock::now();
+
+		for (std::size_t i = 0; i < _files.size(); ++i)
+		{
+			if (errors[i])
+			{
+				std::rethrow_exception(errors[i]);
+			}
+
+			merge(_files[i], results[i]);
+		}
+
+		auto merged = std::chrono::steady_clock::now();
+
+		GlobalDeclarationScheduler().reportLoadingTime(_managerName, _files.size(),
+			std::chrono::duration_cast<std::chrono::milliseconds>(parsed - start),
+			std::chrono::duration_cast<std::chrono::milliseconds>(merged - parsed));
+	}
+};
+
+}
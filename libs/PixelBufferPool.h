@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "util/Noncopyable.h"
+
+namespace image
+{
+
+/**
+ * Recycles the pixel memory of decoded images.
+ *
+ * Loading a batch of textures allocates and frees lots of large buffers of
+ * similar sizes, which are kept here for reuse instead of going back to the
+ * heap. The buffers are grouped into buckets of power-of-two capacities, a
+ * request is served from the bucket of the next larger power of two. Released
+ * buffers are kept up to a total size, beyond that they are freed. Requests
+ * smaller than a few kilobytes are not pooled at all. Thread-safe.
+ */
+class PixelBufferPool :
+    public util::Noncopyable
+{
+private:
+    // Requests below 4 KB or above 2 GB are passed to the heap
+    static const std::size_t MIN_BUCKET_BITS = 12;
+    static const std::size_t NUM_BUCKETS = 20;
+
+    std::mutex _lock;
+    std::vector<std::uint8_t*> _buckets[NUM_BUCKETS];
+
+    std::size_t _pooledBytes;
+    std::size_t _maxPooledBytes;
+
+public:
+    PixelBufferPool(std::size_t maxPooledBytes = 128 * 1024 * 1024) :
+        _pooledBytes(0),
+        _maxPooledBytes(maxPooledBytes)
+    {}
+
+    ~PixelBufferPool()
+    {
+        for (auto& bucket : _buckets)
+        {
+            for (auto buffer : bucket)
+            {
+                delete[] buffer;
+            }
+        }
+    }
+
+    // Returns a buffer of at least the given size, with undefined contents
+    std::uint8_t* acquire(std::size_t size)
+    {
+        auto bucket = GetBucket(size);
+
+        if (bucket >= NUM_BUCKETS)
+        {
+            return new std::uint8_t[size];
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+
+            if (!_buckets[bucket].empty())
+            {
+                auto buffer = _buckets[bucket].back();
+                _buckets[bucket].pop_back();
+                _pooledBytes -= GetBucketCapacity(bucket);
+
+                return buffer;
+            }
+        }
+
+        return new std::uint8_t[GetBucketCapacity(bucket)];
+    }
+
+    // Hands back a buffer returned by acquire(), size is the requested size
+    void release(std::uint8_t* buffer, std::size_t size)
+    {
+        if (buffer == nullptr)
+        {
+            return;
+        }
+
+        auto bucket = GetBucket(size);
+
+        if (bucket < NUM_BUCKETS)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+
+            if (_pooledBytes + GetBucketCapacity(bucket) <= _maxPooledBytes)
+            {
+                _buckets[bucket].push_back(buffer);
+                _pooledBytes += GetBucketCapacity(bucket);
+                return;
+            }
+        }
+
+        delete[] buffer;
+    }
+
+    // The number of bytes currently held for reuse
+    std::size_t getPooledBytes()
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        return _pooledBytes;
+    }
+
+    // Frees all buffers held for reuse
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+
+        for (auto& bucket : _buckets)
+        {
+            for (auto buffer : bucket)
+            {
+                delete[] buffer;
+            }
+
+            bucket.clear();
+        }
+
+        _pooledBytes = 0;
+    }
+
+    // The pool shared by all images
+    static PixelBufferPool& Instance()
+    {
+        // Never destroyed, images held by static objects might be released
+        // after the static destructors have run
+        static auto* instance = new PixelBufferPool;
+        return *instance;
+    }
+
+private:
+    static std::size_t GetBucketCapacity(std::size_t bucket)
+    {
+        return std::size_t(1) << (bucket + MIN_BUCKET_BITS);
+    }
+
+    // Returns NUM_BUCKETS for sizes which are not pooled
+    static std::size_t GetBucket(std::size_t size)
+    {
+        if (size < (std::size_t(1) << MIN_BUCKET_BITS))
+        {
+            return NUM_BUCKETS;
+        }
+
+        std::size_t bucket = 0;
+
+        while (bucket < NUM_BUCKETS && GetBucketCapacity(bucket) < size)
+        {
+            ++bucket;
+        }
+
+        return bucket;
+    }
+};
+
+/**
+ * A pixel buffer of fixed size, taken from the PixelBufferPool and
+ * handed back on destruction. The contents are not initialised.
+ */
+class PixelBuffer :
+    public util::Noncopyable
+{
+private:
+    std::uint8_t* _data;
+    std::size_t _size;
+
+public:
+    PixelBuffer(std::size_t size) :
+        _data(PixelBufferPool::Instance().acquire(size)),
+        _size(size)
+    {}
+
+    ~PixelBuffer()
+    {
+        PixelBufferPool::Instance().release(_data, _size);
+    }
+
+    std::uint8_t* data() const
+    {
+        return _data;
+    }
+
+    std::size_t size() const
+    {
+        return _size;
+    }
+};
+
+}
@@ -6,6 +6,7 @@
 #include <memory>
 #include "util/Noncopyable.h"
 #include "debugging/gl.h"
+#include "PixelBufferPool.h"
 
 /// A single pixel with 8-bit RGBA components
 struct RGBAPixel
@@ -15,13 +16,16 @@ struct RGBAPixel
 
 /**
  * An RGBA image represents a single-mipmap image with certain
- * dimensions. The memory for the actual pixelmap is allocated
- * and de-allocated automatically.
+ * dimensions. The memory for the actual pixelmap is taken from
+ * the PixelBufferPool and handed back automatically.
  */
 class RGBAImage :
 	public Image,
 	public util::Noncopyable
 {
+private:
+	image::PixelBuffer _buffer;
+
 public:
 	RGBAPixel* pixels;
 
@@ -29,16 +33,12 @@ public:
 	std::size_t height;
 
 	RGBAImage(std::size_t _width, std::size_t _height) :
-		pixels(new RGBAPixel[_width * _height]),
+		_buffer(_width * _height * sizeof(RGBAPixel)),
+		pixels(reinterpret_cast<RGBAPixel*>(_buffer.data())),
 		width(_width),
 		height(_height)
 	{}
 
-	~RGBAImage()
-	{
-		delete[] pixels;
-	}
-
     /* Image implementation */
 	uint8_t* getPixels() const override
 	{
@@ -60,10 +60,23 @@ public:
     {
 		GLuint textureNum;
 
-        debug::assertNoGlErrors();
-
 		// Allocate a new texture number and store it into the Texture structure
 		glGenTextures(1, &textureNum);
+
+		uploadTexture(textureNum, name);
+
+        // Construct texture object
+        BasicTexture2DPtr tex2DObject(new BasicTexture2D(textureNum, name));
+        tex2DObject->setWidth(getWidth());
+        tex2DObject->setHeight(getHeight());
+
+		return tex2DObject;
+	}
+
+	bool uploadTexture(GLuint textureNum, const std::string& name) const override
+	{
+        debug::assertNoGlErrors();
+
 		glBindTexture(GL_TEXTURE_2D, textureNum);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
@@ -80,14 +93,9 @@ public:
 		// Un-bind the texture
 		glBindTexture(GL_TEXTURE_2D, 0);
 
-        // Construct texture object
-        BasicTexture2DPtr tex2DObject(new BasicTexture2D(textureNum, name));
-        tex2DObject->setWidth(getWidth());
-        tex2DObject->setHeight(getHeight());
-
         debug::assertNoGlErrors();
 
-		return tex2DObject;
+		return true;
 	}
 
 	bool isPrecompressed() const
@@ -0,0 +1,452 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <future>
+#include <exception>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+
+#include "util/Noncopyable.h"
+
+namespace util
+{
+
+/**
+ * A fixed-size set of worker threads processing the enqueued tasks
+ * in FIFO order. Each call to enqueue() returns a std::future which
+ * can be used to wait for the task and retrieve its result (or to
+ * rethrow any exception the task has thrown).
+ *
+ * The pool also executes parallelFor() loops. Their iterations are split
+ * into chunks which are distributed over per-worker queues, a worker running
+ * out of chunks is stealing them from the other queues. This keeps all workers
+ * busy even if the iterations take very different amounts of time, like
+ * when parsing files of different sizes. Loop chunks are processed before
+ * the enqueued tasks.
+ *
+ * The thread calling parallelFor() is processing chunks too while waiting
+ * for the loop to finish, so it's safe to call parallelFor() from within
+ * a loop body, an enqueued task or from several threads at once.
+ *
+ * Destroying the pool will process the remaining queued tasks
+ * and block until all workers have finished.
+ */
+class ThreadPool :
+    public Noncopyable
+{
+public:
+    typedef std::function<void(std::size_t)> LoopBody;
+
+private:
+    // The state of a single parallelFor() call, shared by all its chunks
+    struct Loop
+    {
+        LoopBody body;
+
+        std::mutex lock;
+        std::condition_variable finished;
+        std::size_t remaining;
+        std::exception_ptr exception;
+    };
+
+    struct Chunk
+    {
+        std::shared_ptr<Loop> loop;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    struct ChunkQueue
+    {
+        std::mutex lock;
+        std::deque<Chunk> chunks;
+    };
+
+    std::vector<std::unique_ptr<ChunkQueue>> _chunkQueues;
+    std::vector<std::thread> _workers;
+
+    // Guards the task queue and the wake-up state of the workers
+    std::mutex _queueLock;
+    std::condition_variable _queueCondition;
+    std::deque<std::function<void()>> _queue;
+    std::size_t _numQueuedChunks;
+    bool _stopping;
+
+    // Chunks per thread a loop is split into, more chunks balance better but cost more locking
+    static constexpr std::size_t CHUNKS_PER_THREAD = 8;
+
+public:
+    // Creates a pool with the given number of threads, passing 0 will
+    // pick the number of hardware threads available on this system
+    ThreadPool(std::size_t numThreads = 0) :
+        _numQueuedChunks(0),
+        _stopping(false)
+    {
+        if (numThreads == 0)
+        {
+            numThreads = GetDefaultNumThreads();
+        }
+
+        for (std::size_t i = 0; i < numThreads; ++i)
+        {
+            _chunkQueues.emplace_back(new ChunkQueue);
+        }
+
+        _workers.reserve(numThreads);
+
+        for (std::size_t i = 0; i < numThreads; ++i)
+        {
+            _workers.emplace_back([this, i]() { runWorker(i); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_queueLock);
+            _stopping = true;
+        }
+
+        _queueCondition.notify_all();
+
+        for (auto& worker : _workers)
+        {
+            worker.join();
+        }
+    }
+
+    std::size_t getNumThreads() const
+    {
+        return _workers.size();
+    }
+
+    // Queues the given callable, the returned future will hold its result
+    template<typename FunctionType>
+    auto enqueue(FunctionType&& function) -> std::future<decltype(function())>
+    {
+        using ReturnType = decltype(function());
+
+        // std::function requires copyable targets, so the packaged_task is held in a shared_ptr
+        auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<FunctionType>(function));
+        auto future = task->get_future();
+
+        {
+            std::lock_guard<std::mutex> lock(_queueLock);
+            _queue.emplace_back([task]() { (*task)(); });
+        }
+
+        _queueCondition.notify_one();
+
+        return future;
+    }
+
+    /**
+     * Invokes the given function for each index in [0..count) and blocks
+     * until all invocations are done. The invocations run concurrently and
+     * in no particular order. If any of them throws, the remaining ones are
+     * still executed and the first exception is rethrown afterwards.
+     */
+    void parallelFor(std::size_t count, const LoopBody& body)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        auto loop = std::make_shared<Loop>();
+        loop->body = body;
+        loop->remaining = count;
+
+        std::size_t numChunks = std::min(count, _chunkQueues.size() * CHUNKS_PER_THREAD);
+        std::size_t chunkSize = count / numChunks;
+        std::size_t numLargerChunks = count % numChunks;
+
+        std::size_t begin = 0;
+
+        for (std::size_t i = 0; i < numChunks; ++i)
+        {
+            std::size_t end = begin + chunkSize + (i < numLargerChunks ? 1 : 0);
+
+            auto& queue = *_chunkQueues[i % _chunkQueues.size()];
+
+            std::lock_guard<std::mutex> lock(queue.lock);
+            queue.chunks.push_back(Chunk{ loop, begin, end });
+
+            begin = end;
+        }
+
+        {
+            // Taking the lock prevents workers from missing the notification
+            std::lock_guard<std::mutex> lock(_queueLock);
+            _numQueuedChunks += numChunks;
+        }
+
+        _queueCondition.notify_all();
+
+        // Help processing chunks until this loop is done
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(loop->lock);
+
+                if (loop->remaining == 0)
+                {
+                    break;
+                }
+            }
+
+            Chunk chunk;
+
+            if (tryTakeChunk(_chunkQueues.size(), chunk))
+            {
+                runChunk(chunk);
+                continue;
+            }
+
+            // The last chunks are being processed by the workers, or this thread
+            // is a worker itself and its own chunks are processed by another parallelFor
+            // call further up the stack. Wake up now and then to see if there's new work.
+            std::unique_lock<std::mutex> lock(loop->lock);
+            loop->finished.wait_for(lock, std::chrono::milliseconds(1),
+                [&]() { return loop->remaining == 0; });
+        }
+
+        if (loop->exception)
+        {
+            std::rethrow_exception(loop->exception);
+        }
+    }
+
+    // The number of threads a default-constructed pool is using
+    static std::size_t GetDefaultNumThreads()
+    {
+        return std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    /**
+     * The default-sized pool shared by the parallel loops of this binary,
+     * created on first use. It is never destroyed: its idle workers end with
+     * the process, joining them during static destruction can deadlock when
+     * a module is unloaded.
+     */
+    static ThreadPool& GetShared()
+    {
+        static ThreadPool* _shared = new ThreadPool;
+        return *_shared;
+    }
+
+private:
+    void runWorker(std::size_t index)
+    {
+        while (true)
+        {
+            Chunk chunk;
+
+            if (tryTakeChunk(index, chunk))
+            {
+                runChunk(chunk);
+                continue;
+            }
+
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(_queueLock);
+
+                _queueCondition.wait(lock, [this]()
+                {
+                    return _stopping || _numQueuedChunks > 0 || !_queue.empty();
+                });
+
+                if (_numQueuedChunks > 0)
+                {
+                    continue; // loop chunks first
+                }
+
+                if (_queue.empty())
+                {
+                    return; // stopping and nothing left to do
+                }
+
+                task = std::move(_queue.front());
+                _queue.pop_front();
+            }
+
+            task();
+        }
+    }
+
+    // Takes a chunk from the front of the own queue, or steals one from the back of another queue.
+    // Threads that are not part of the pool pass an index >= the number of queues and can only steal.
+    bool tryTakeChunk(std::size_t ownIndex, Chunk& chunk)
+    {
+        if (ownIndex < _chunkQueues.size() && tryPop(*_chunkQueues[ownIndex], chunk, false))
+        {
+            return true;
+        }
+
+        for (std::size_t i = 1; i <= _chunkQueues.size(); ++i)
+        {
+            std::size_t victim = (ownIndex + i) % _chunkQueues.size();
+
+            if (victim != ownIndex && tryPop(*_chunkQueues[victim], chunk, true))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool tryPop(ChunkQueue& queue, Chunk& chunk, bool fromBack)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queue.lock);
+
+            if (queue.chunks.empty())
+            {
+                return false;
+            }
+
+            if (fromBack)
+            {
+                chunk = std::move(queue.chunks.back());
+                queue.chunks.pop_back();
+            }
+            else
+            {
+                chunk = std::move(queue.chunks.front());
+                queue.chunks.pop_front();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(_queueLock);
+        --_numQueuedChunks;
+
+        return true;
+    }
+
+    static void runChunk(const Chunk& chunk)
+    {
+        auto& loop = *chunk.loop;
+
+        for (std::size_t i = chunk.begin; i < chunk.end; ++i)
+        {
+            try
+            {
+                loop.body(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(loop.lock);
+
+                if (!loop.exception)
+                {
+                    loop.exception = std::current_exception();
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(loop.lock);
+
+        loop.remaining -= chunk.end - chunk.begin;
+
+        if (loop.remaining == 0)
+        {
+            loop.finished.notify_all();
+        }
+    }
+};
+
+/**
+ * Runs the enqueued tasks one after the other in FIFO order, on the workers
+ * of a ThreadPool (the shared one by default). At most one task of the queue
+ * is running at any time, such that tasks writing to the same files don't
+ * need to be synchronised, while the pool is free to run other work.
+ *
+ * Exceptions thrown by a task are discarded, tasks are expected to handle
+ * their own errors. The destructor waits for the pending tasks, it must not
+ * be called from a task of the pool the queue is running on.
+ */
+class SerialTaskQueue :
+    public util::Noncopyable
+{
+private:
+    ThreadPool& _pool;
+
+    std::mutex _lock;
+    std::condition_variable _idle;
+    std::deque<std::function<void()>> _tasks;
+
+    // True while a worker is processing the tasks of this queue
+    bool _running;
+
+public:
+    SerialTaskQueue(ThreadPool& pool = ThreadPool::GetShared()) :
+        _pool(pool),
+        _running(false)
+    {}
+
+    ~SerialTaskQueue()
+    {
+        wait();
+    }
+
+    void enqueue(const std::function<void()>& task)
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+
+        _tasks.push_back(task);
+
+        if (!_running)
+        {
+            _running = true;
+            _pool.enqueue([this]() { runTasks(); });
+        }
+    }
+
+    // Blocks until all tasks enqueued so far have been processed
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _idle.wait(lock, [this]() { return !_running; });
+    }
+
+private:
+    void runTasks()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+
+                if (_tasks.empty())
+                {
+                    _running = false;
+                    _idle.notify_all();
+                    return;
+                }
+
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+
+            try
+            {
+                task();
+            }
+            catch (...)
+            {}
+        }
+    }
+};
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "ifilesystem.h"
+#include "os/fs.h"
+#include "os/path.h"
+
+namespace os
+{
+
+/**
+ * Returns the modification time of the given file or directory in a form
+ * suitable as cache key, returns 0 if the time can't be determined.
+ */
+inline std::int64_t getModificationTimestamp(const std::string& path)
+{
+    try
+    {
+#ifdef DR_USE_BOOST_FILESYSTEM
+        return static_cast<std::int64_t>(fs::last_write_time(path));
+#else
+        return static_cast<std::int64_t>(fs::last_write_time(path).time_since_epoch().count());
+#endif
+    }
+    catch (const fs::filesystem_error&)
+    {
+        return 0;
+    }
+}
+
+// What data cached on disk for a VFS file is valid for
+struct FileKey
+{
+    std::string archivePath;
+    std::uint64_t size = 0;
+    std::int64_t timestamp = 0;
+
+    // Files without a known archive or modification time can't be cached
+    bool isValid() const
+    {
+        return !archivePath.empty() && timestamp != 0;
+    }
+
+    bool operator==(const FileKey& other) const
+    {
+        return archivePath == other.archivePath && size == other.size && timestamp == other.timestamp;
+    }
+};
+
+// Determines the key of the given VFS file
+inline FileKey getFileKey(const vfs::FileInfo& fileInfo)
+{
+    FileKey key;
+
+    key.archivePath = fileInfo.getArchivePath();
+
+    if (key.archivePath.empty())
+    {
+        return key;
+    }
+
+    key.size = fileInfo.getSize();
+
+    // Files in PK4s are as old as their archive
+    key.timestamp = getModificationTimestamp(fileInfo.getIsPhysicalFile() ?
+        standardPathWithSlash(key.archivePath) + fileInfo.fullPath() : key.archivePath);
+
+    return key;
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstring>
+
+namespace parser
+{
+
+/**
+ * 256-entry lookup table classifying each character as regular character,
+ * delimiter or kept delimiter. Replaces the linear scan through the delimiter
+ * strings which would otherwise be performed for every single input character.
+ */
+class CharacterClassTable
+{
+public:
+    enum Class : unsigned char
+    {
+        REGULAR = 0,
+        DELIMITER = 1,
+        KEPT_DELIMITER = 2,
+    };
+
+private:
+    Class _classes[256];
+
+public:
+    CharacterClassTable(const char* delims, const char* keptDelims)
+    {
+        std::memset(_classes, REGULAR, sizeof(_classes));
+
+        // Kept delimiters are assigned last, they take precedence
+        for (const char* c = delims; *c != 0; ++c)
+        {
+            _classes[static_cast<unsigned char>(*c)] = DELIMITER;
+        }
+
+        for (const char* c = keptDelims; *c != 0; ++c)
+        {
+            _classes[static_cast<unsigned char>(*c)] = KEPT_DELIMITER;
+        }
+    }
+
+    Class get(char c) const
+    {
+        return _classes[static_cast<unsigned char>(c)];
+    }
+
+    bool isDelim(char c) const
+    {
+        return get(c) == DELIMITER;
+    }
+
+    bool isKeptDelim(char c) const
+    {
+        return get(c) == KEPT_DELIMITER;
+    }
+};
+
+}
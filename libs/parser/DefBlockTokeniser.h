@@ -4,9 +4,11 @@
 
 #include <ios>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <ctype.h>
 #include "string/tokeniser.h"
+#include "CharacterClassTable.h"
 
 namespace parser 
 {
@@ -80,21 +82,15 @@ class DefBlockTokeniserFunc
         STAR              // asterisk, possibly indicates end of comment (*/)
     } _state;
 
-	const char* _delims;			// whitespace
+	CharacterClassTable _delims;	// whitespace
 
 	const char _blockStartChar;	// "{"
 	const char _blockEndChar;	// "}"
 
 	// Test if a character is a delimiter
-    bool isDelim(char c) 
+    bool isDelim(char c) const
 	{
-        const char* curDelim = _delims;
-        while (*curDelim != 0) {
-            if (*(curDelim++) == c) {
-                return true;
-            }
-        }
-        return false;
+        return _delims.isDelim(c);
     }
 
 public:
@@ -102,7 +98,7 @@ public:
     // Constructor
     DefBlockTokeniserFunc(const char* delims, char blockStartChar, char blockEndChar) :
 		_state(SEARCHING_NAME),
-		_delims(delims),
+		_delims(delims, ""),
 		_blockStartChar(blockStartChar),
 		_blockEndChar(blockEndChar)
     {}
@@ -6,7 +6,9 @@
 #include <iostream>
 #include <ios>
 #include <string>
+#include <string_view>
 #include "string/tokeniser.h"
+#include "CharacterClassTable.h"
 
 namespace parser
 {
@@ -30,40 +32,26 @@ class DefTokeniserFunc
         STAR            // asterisk, possibly indicates end of comment (*/)
     } _state;
 
-    // List of delimiters to skip
-    const char* _delims;
-
-    // List of delimiters to keep
-    const char* _keptDelims;
+    // Lookup table for delimiters to skip and delimiters to keep
+    CharacterClassTable _classes;
 
     // Test if a character is a delimiter
-    bool isDelim(char c) {
-        const char* curDelim = _delims;
-        while (*curDelim != 0) {
-            if (*(curDelim++) == c) {
-                return true;
-            }
-        }
-        return false;
+    bool isDelim(char c) const
+    {
+        return _classes.isDelim(c);
     }
 
     // Test if a character is a kept delimiter
-    bool isKeptDelim(char c) {
-        const char* curDelim = _keptDelims;
-        while (*curDelim != 0) {
-            if (*(curDelim++) == c) {
-                return true;
-            }
-        }
-        return false;
+    bool isKeptDelim(char c) const
+    {
+        return _classes.isKeptDelim(c);
     }
 
-
 public:
 
     // Constructor
     DefTokeniserFunc(const char* delims, const char* keptDelims)
-    : _state(SEARCHING), _delims(delims), _keptDelims(keptDelims)
+    : _state(SEARCHING), _classes(delims, keptDelims)
     {}
 
     /* REQUIRED. Operator() is called by the tokeniser. This function
@@ -78,7 +66,7 @@ public:
         _state = SEARCHING;
 
         // Clear out the token, no guarantee that it is empty
-        tok = "";
+        tok.clear();
 
         while (next != end) 
 		{
@@ -117,7 +105,7 @@ public:
                         // current token if we are in the process of building
                         // one.
                         case '\"':
-                            if (tok != "") {
+                            if (!tok.empty()) {
                                 return true;
                             }
                             else {
@@ -255,7 +243,7 @@ public:
 							// greebo: switch to TOKEN_STARTED, the SEARCHING state might 
 							// overwrite this if the next token is a kept delimiter
                             _state = TOKEN_STARTED; 
-                            tok += "/";
+                            tok += '/';
                             // Do not increment next here
                             continue;
                     }
@@ -284,7 +272,7 @@ public:
 						++next;
 
 						// If we have a token at this point, return it
-						if (tok != "") 
+						if (!tok.empty())
 						{
 							return true;
 						}
@@ -310,7 +298,7 @@ public:
                         ++next;
 
 						// If we have a token at this point, return it
-						if (tok != "") 
+						if (!tok.empty())
 						{
 							return true;
 						}
@@ -340,10 +328,7 @@ public:
         } // end of for loop
 
         // Return true if we have added anything to the token
-        if (tok != "")
-            return true;
-        else
-            return false;
+        return !tok.empty();
     }
 };
 
@@ -388,6 +373,24 @@ public:
      */
      virtual std::string nextToken() = 0;
 
+    /**
+     * Return the next token in the sequence as string_view, consuming it.
+     * Tokenisers operating on contiguous memory return views into their
+     * source buffer, avoiding any per-token allocation.
+     *
+     * @returns
+     * A view of the next token which is only valid until the next call
+     * to any of this tokeniser's methods.
+     *
+     * @pre
+     * hasMoreTokens() must be true, otherwise an exception will be thrown.
+     */
+    virtual std::string_view nextTokenView()
+    {
+        _tokenViewBuffer = nextToken();
+        return _tokenViewBuffer;
+    }
+
     /**
      * Assert that the next token in the sequence must be equal to the provided
      * value. A ParseException is thrown if the assert fails.
@@ -424,6 +427,10 @@ public:
 	 * next without actually changing the tokeniser's state.
 	 */
 	virtual std::string peek() const = 0;
+
+private:
+    // Storage for the default nextTokenView() implementation
+    std::string _tokenViewBuffer;
 };
 
 /**
@@ -490,7 +497,9 @@ public:
 	{
 		if (hasMoreTokens())
 		{
-			return *(_tokIter++);
+            std::string token = *_tokIter;
+            ++_tokIter;
+			return token;
 		}
 
         throw ParseException("DefTokeniser: no more tokens");
@@ -590,7 +599,9 @@ public:
 	{
 		if (hasMoreTokens())
 		{
-			return *(_tokIter++);
+            std::string token = *_tokIter;
+            ++_tokIter;
+			return token;
 		}
         
 		throw ParseException("DefTokeniser: no more tokens");
@@ -612,4 +623,387 @@ public:
 	}
 };
 
+/**
+ * Specialisation of DefTokeniser operating directly on a contiguous block of
+ * characters, like a memory-mapped file or a fully loaded string buffer.
+ * The referenced memory must stay valid during the lifetime of this tokeniser.
+ *
+ * Delimiters are classified through a lookup table and tokens are handed out
+ * as views into the source memory through nextTokenView(), so parsing a file
+ * does not allocate memory per token. Only quoted tokens which have to be
+ * altered (escape sequences, backslash-continued strings) are assembled in an
+ * internal buffer.
+ *
+ * The produced token sequence is the same as the one of the
+ * BasicDefTokeniser<std::istream> variant.
+ */
+template<>
+class BasicDefTokeniser<std::string_view> :
+	public DefTokeniser
+{
+private:
+    const char* _begin;
+    const char* _cur;
+    const char* _end;
+
+    CharacterClassTable _classes;
+
+    // The lookahead token, it has already been consumed from the input
+    std::string_view _token;
+    bool _hasToken;
+
+    // Alternating buffers for quoted tokens which can't refer to the source
+    // directly. The lookahead token may live in one of them while the other
+    // one still backs the view returned by the previous nextTokenView() call.
+    std::string _buffers[2];
+    std::size_t _curBuffer;
+
+public:
+    /**
+     * Construct a DefTokeniser working on the given memory, and optionally
+     * a list of separators.
+     *
+     * @param str
+     * The view of the characters to tokenise.
+     *
+     * @param delims
+     * The list of characters to use as delimiters.
+     *
+     * @param keptDelims
+     * String of characters to treat as delimiters but return as tokens in their
+     * own right.
+     */
+    BasicDefTokeniser(std::string_view str,
+                      const char* delims = WHITESPACE,
+                      const char* keptDelims = "{}()") :
+        _begin(str.data()),
+        _cur(str.data()),
+        _end(str.data() + str.size()),
+        _classes(delims, keptDelims),
+        _hasToken(false),
+        _curBuffer(0)
+    {
+        advance();
+    }
+
+    bool hasMoreTokens() const override
+	{
+        return _hasToken;
+    }
+
+    std::string nextToken() override
+	{
+        return std::string(nextTokenView());
+    }
+
+    std::string_view nextTokenView() override
+    {
+        if (!_hasToken)
+        {
+            throw ParseException("DefTokeniser: no more tokens");
+        }
+
+        std::string_view token = _token;
+        advance();
+
+        return token;
+    }
+
+    void assertNextToken(const std::string& val) override
+    {
+        auto token = nextTokenView();
+
+        if (token != val)
+        {
+            throw ParseException("DefTokeniser: Assertion failed: Required \""
+                + val + "\", found \"" + std::string(token) + "\"");
+        }
+    }
+
+    void skipTokens(unsigned int n) override
+    {
+        for (unsigned int i = 0; i < n; i++)
+        {
+            nextTokenView();
+        }
+    }
+
+	std::string peek() const override
+	{
+		if (_hasToken)
+		{
+            return std::string(_token);
+		}
+
+		throw ParseException("DefTokeniser: no more tokens");
+	}
+
+    // Returns the number of characters consumed from the input so far
+    // (including the lookahead token), usable for progress reporting.
+    std::size_t getPosition() const
+    {
+        return static_cast<std::size_t>(_cur - _begin);
+    }
+
+private:
+    void advance()
+    {
+        _hasToken = scanToken(_token);
+    }
+
+    std::string& getNextBuffer()
+    {
+        _curBuffer ^= 1;
+        return _buffers[_curBuffer];
+    }
+
+    // Positions _cur behind the comment starting at _cur ("//" or "/*")
+    void skipComment()
+    {
+        if (_cur[1] == '/')
+        {
+            // EOL comment, skip the line break too
+            for (_cur += 2; _cur != _end; ++_cur)
+            {
+                if (*_cur == '\r' || *_cur == '\n')
+                {
+                    ++_cur;
+                    return;
+                }
+            }
+            return;
+        }
+
+        // Delimited comment, search for the closing "*/"
+        for (_cur += 2; _cur != _end; ++_cur)
+        {
+            if (*_cur == '*' && _cur + 1 != _end && _cur[1] == '/')
+            {
+                _cur += 2;
+                return;
+            }
+        }
+    }
+
+    bool scanToken(std::string_view& token)
+    {
+        // Skip delimiters and comments
+        while (_cur != _end)
+        {
+            char ch = *_cur;
+            auto charClass = _classes.get(ch);
+
+            if (charClass == CharacterClassTable::DELIMITER)
+            {
+                ++_cur;
+                continue;
+            }
+
+            if (charClass == CharacterClassTable::KEPT_DELIMITER)
+            {
+                token = std::string_view(_cur++, 1);
+                return true;
+            }
+
+            if (ch == '/')
+            {
+                // A lone slash at the end of the input is ignored
+                if (_cur + 1 == _end)
+                {
+                    ++_cur;
+                    return false;
+                }
+
+                if (_cur[1] == '/' || _cur[1] == '*')
+                {
+                    skipComment();
+                    continue;
+                }
+            }
+
+            if (ch == '"')
+            {
+                return scanQuotedToken(token);
+            }
+
+            break;
+        }
+
+        if (_cur == _end)
+        {
+            return false;
+        }
+
+        // Unquoted token, lasts until the next delimiter, quote or comment
+        const char* start = _cur;
+
+        for (; _cur != _end; ++_cur)
+        {
+            char ch = *_cur;
+
+            if (_classes.get(ch) != CharacterClassTable::REGULAR || ch == '"')
+            {
+                break;
+            }
+
+            if (ch == '/')
+            {
+                if (_cur + 1 == _end)
+                {
+                    // Trailing slash is dropped
+                    token = std::string_view(start, _cur - start);
+                    ++_cur;
+                    return true;
+                }
+
+                if (_cur[1] == '/' || _cur[1] == '*')
+                {
+                    // The comment is skipped on the next call
+                    break;
+                }
+            }
+        }
+
+        token = std::string_view(start, _cur - start);
+        return true;
+    }
+
+    // _cur is pointing at the opening quote
+    bool scanQuotedToken(std::string_view& token)
+    {
+        const char* start = ++_cur;
+
+        // Fast path, search for the closing quote and bail out on escapes
+        while (_cur != _end && *_cur != '"' && *_cur != '\\')
+        {
+            ++_cur;
+        }
+
+        if (_cur == _end)
+        {
+            // Unterminated quote
+            token = std::string_view(start, _cur - start);
+            return !token.empty();
+        }
+
+        if (*_cur == '\\')
+        {
+            auto& buffer = getNextBuffer();
+            buffer.assign(start, _cur - start);
+            return scanQuotedTokenSlow(buffer, QUOTED, token);
+        }
+
+        // Closing quote found, look for a continuation backslash
+        token = std::string_view(start, _cur - start);
+        ++_cur;
+
+        while (_cur != _end && _classes.isDelim(*_cur))
+        {
+            ++_cur;
+        }
+
+        if (_cur == _end)
+        {
+            return !token.empty();
+        }
+
+        if (*_cur != '\\')
+        {
+            return true;
+        }
+
+        auto& buffer = getNextBuffer();
+        buffer.assign(token.data(), token.size());
+        return scanQuotedTokenSlow(buffer, AFTER_CLOSING_QUOTE, token);
+    }
+
+    enum QuoteState
+    {
+        QUOTED,
+        AFTER_CLOSING_QUOTE,
+        SEARCHING_FOR_QUOTE,
+    };
+
+    // Character-wise handling of escape sequences and continued quoted strings,
+    // the resulting token is assembled in the given buffer
+    bool scanQuotedTokenSlow(std::string& buffer, QuoteState state, std::string_view& token)
+    {
+        while (_cur != _end)
+        {
+            char ch = *_cur;
+
+            switch (state)
+            {
+            case QUOTED:
+                if (ch == '"')
+                {
+                    ++_cur;
+                    state = AFTER_CLOSING_QUOTE;
+                    continue;
+                }
+
+                if (ch == '\\')
+                {
+                    // Escape found, check next character
+                    if (++_cur == _end) continue;
+
+                    switch (*_cur)
+                    {
+                    case 'n': buffer += '\n'; break;
+                    case 't': buffer += '\t'; break;
+                    case '"': buffer += '"'; break;
+                    default:
+                        // No special escape sequence, keep the backslash
+                        buffer += '\\';
+                        buffer += *_cur;
+                    }
+
+                    ++_cur;
+                    continue;
+                }
+
+                buffer += ch;
+                ++_cur;
+                continue;
+
+            case AFTER_CLOSING_QUOTE:
+                if (ch == '\\')
+                {
+                    ++_cur;
+                    state = SEARCHING_FOR_QUOTE;
+                    continue;
+                }
+
+                if (_classes.isDelim(ch))
+                {
+                    ++_cur;
+                    continue;
+                }
+
+                token = buffer;
+                return true;
+
+            case SEARCHING_FOR_QUOTE:
+                if (_classes.isDelim(ch))
+                {
+                    ++_cur;
+                    continue;
+                }
+
+                if (ch == '"')
+                {
+                    ++_cur;
+                    state = QUOTED;
+                    continue;
+                }
+
+                throw ParseException("Could not find opening double quote after backslash.");
+            }
+        }
+
+        token = buffer;
+        return !buffer.empty();
+    }
+};
+
 } // namespace parser
@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "irender.h"
 #include "igl.h"
+#include "GLProgramAttributes.h"
 
 #include "math/FloatTools.h"
 #include "math/Vector2.h"
@@ -344,6 +345,45 @@ public:
 };
 
 
+/// Submits indexed triangles from client-side arrays, used by model surfaces
+/// which are not (yet) in the geometry store of the render system.
+inline void ArbitraryMeshVertex_renderTriangles(const std::vector<ArbitraryMeshVertex>& vertices,
+	const IndexBuffer& indices, const RenderInfo& info)
+{
+	if (vertices.empty() || indices.empty()) return;
+
+	const GLsizei stride = sizeof(ArbitraryMeshVertex);
+	const ArbitraryMeshVertex& first = vertices.front();
+
+	if (info.checkFlag(RENDER_VERTEX_COLOUR))
+	{
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(3, GL_DOUBLE, stride, &first.colour);
+	}
+
+	glVertexPointer(3, GL_DOUBLE, stride, &first.vertex);
+
+	if (info.checkFlag(RENDER_BUMP))
+	{
+		glVertexAttribPointer(ATTR_NORMAL, 3, GL_DOUBLE, 0, stride, &first.normal);
+		glVertexAttribPointer(ATTR_TEXCOORD, 2, GL_DOUBLE, 0, stride, &first.texcoord);
+		glVertexAttribPointer(ATTR_TANGENT, 3, GL_DOUBLE, 0, stride, &first.tangent);
+		glVertexAttribPointer(ATTR_BITANGENT, 3, GL_DOUBLE, 0, stride, &first.bitangent);
+	}
+	else
+	{
+		glNormalPointer(GL_DOUBLE, stride, &first.normal);
+
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_DOUBLE, stride, &first.texcoord);
+	}
+
+	glDrawElements(GL_TRIANGLES, GLsizei(indices.size()), RenderIndexTypeID, indices.data());
+
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+}
+
 class RemapXYZ {
 public:
 	static void set(Vertex3f& vertex, float x, float y, float z) {
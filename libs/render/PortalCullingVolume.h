@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include "ivolumetest.h"
+#include "math/AABB.h"
+
+namespace render
+{
+
+/**
+ * VolumeTest wrapping another one, which additionally treats everything
+ * as outside that doesn't intersect one of the given area bounds.
+ *
+ * Used with the areas a scene::PortalAreaGraph considers visible, this
+ * skips the space partition nodes behind closed walls and portals not
+ * in view during scene traversal.
+ */
+class PortalCullingVolume :
+	public VolumeTest
+{
+private:
+	const VolumeTest& _volume;
+	const std::vector<AABB>& _areaBounds;
+
+public:
+	PortalCullingVolume(const VolumeTest& volume, const std::vector<AABB>& areaBounds) :
+		_volume(volume),
+		_areaBounds(areaBounds)
+	{}
+
+	bool TestPoint(const Vector3& point) const override
+	{
+		return _volume.TestPoint(point);
+	}
+
+	bool TestLine(const Segment& segment) const override
+	{
+		return _volume.TestLine(segment);
+	}
+
+	bool TestPlane(const Plane3& plane) const override
+	{
+		return _volume.TestPlane(plane);
+	}
+
+	bool TestPlane(const Plane3& plane, const Matrix4& localToWorld) const override
+	{
+		return _volume.TestPlane(plane, localToWorld);
+	}
+
+	VolumeIntersectionValue TestAABB(const AABB& aabb) const override
+	{
+		if (!isInVisibleArea(aabb))
+		{
+			return VOLUME_OUTSIDE;
+		}
+
+		return _volume.TestAABB(aabb);
+	}
+
+	VolumeIntersectionValue TestAABB(const AABB& aabb, const Matrix4& localToWorld) const override
+	{
+		if (!isInVisibleArea(AABB::createFromOrientedAABBSafe(aabb, localToWorld)))
+		{
+			return VOLUME_OUTSIDE;
+		}
+
+		return _volume.TestAABB(aabb, localToWorld);
+	}
+
+	bool fill() const override
+	{
+		return _volume.fill();
+	}
+
+	const Matrix4& GetViewProjection() const override
+	{
+		return _volume.GetViewProjection();
+	}
+
+	const Matrix4& GetViewport() const override
+	{
+		return _volume.GetViewport();
+	}
+
+	const Matrix4& GetProjection() const override
+	{
+		return _volume.GetProjection();
+	}
+
+	const Matrix4& GetModelview() const override
+	{
+		return _volume.GetModelview();
+	}
+
+private:
+	bool isInVisibleArea(const AABB& aabb) const
+	{
+		// Objects without valid bounds can't be culled
+		if (!aabb.isValid()) return true;
+
+		for (const auto& bounds : _areaBounds)
+		{
+			if (bounds.intersects(aabb))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace render
+{
+
+/**
+ * Sorts the given elements by the 64-bit key returned by getKey, keeping
+ * the order of elements with equal keys. The elements are moved between
+ * the vector and the given buffer once for each key byte, key bytes which
+ * are the same in all elements are skipped. Few elements are sorted by
+ * comparison instead.
+ */
+template<typename Element_T, typename GetKeyFunc>
+void RadixSortByKey(std::vector<Element_T>& elements, std::vector<Element_T>& buffer, GetKeyFunc getKey)
+{
+    const std::size_t MIN_RADIX_SORT_SIZE = 64;
+
+    if (elements.size() < MIN_RADIX_SORT_SIZE)
+    {
+        std::stable_sort(elements.begin(), elements.end(), [&](const Element_T& a, const Element_T& b)
+        {
+            return getKey(a) < getKey(b);
+        });
+        return;
+    }
+
+    // The histograms of all key bytes are collected in a single sweep
+    std::size_t counts[8][256] = {};
+
+    for (const Element_T& element : elements)
+    {
+        std::uint64_t key = getKey(element);
+
+        for (std::size_t byte = 0; byte < 8; ++byte)
+        {
+            counts[byte][(key >> (byte * 8)) & 0xff]++;
+        }
+    }
+
+    // The buffer contents are overwritten by the passes, copying the elements
+    // avoids requiring a default constructor
+    buffer.assign(elements.begin(), elements.end());
+
+    for (std::size_t byte = 0; byte < 8; ++byte)
+    {
+        std::size_t* offsets = counts[byte];
+        std::size_t shift = byte * 8;
+
+        if (offsets[(getKey(elements.front()) >> shift) & 0xff] == elements.size())
+        {
+            continue;
+        }
+
+        // Turn the counts into the first index of each bucket
+        std::size_t offset = 0;
+
+        for (std::size_t bucket = 0; bucket < 256; ++bucket)
+        {
+            std::size_t count = offsets[bucket];
+            offsets[bucket] = offset;
+            offset += count;
+        }
+
+        for (Element_T& element : elements)
+        {
+            buffer[offsets[(getKey(element) >> shift) & 0xff]++] = std::move(element);
+        }
+
+        elements.swap(buffer);
+    }
+}
+
+}
@@ -4,6 +4,8 @@
 #include "ientity.h"
 #include "ieclass.h"
 #include "iscenegraph.h"
+#include "irenderprofiler.h"
+#include "debugging/ScenegraphUtils.h"
 #include <functional>
 
 namespace render
@@ -28,12 +30,33 @@ private:
     // The view we're using for culling
     const VolumeTest& _volume;
 
+    // The submission time of each node is recorded if this is set
+    IRenderProfiler* _profiler;
+
     // Construct with RenderableCollector to receive renderables
-    RenderableCollectionWalker(RenderableCollector& collector, const VolumeTest& volume) : 
+    RenderableCollectionWalker(RenderableCollector& collector, const VolumeTest& volume,
+                               IRenderProfiler* profiler = nullptr) :
 		_collector(collector), 
-		_volume(volume)
+		_volume(volume),
+		_profiler(profiler)
     {}
 
+    // The submission times are summed up per entity class and node type,
+    // primitives are counted for their parent entity
+    static std::string getProfileKey(const scene::INodePtr& node)
+    {
+        Entity* entity = Node_getEntity(node);
+
+        if (!entity && node->getParent())
+        {
+            entity = Node_getEntity(node->getParent());
+        }
+
+        std::string nodeType = getNameForNodeType(node->getNodeType());
+
+        return entity ? entity->getEntityClass()->getName() + " (" + nodeType + ")" : nodeType;
+    }
+
 public:
 	void dispatchRenderable(const Renderable& renderable)
 	{
@@ -93,7 +116,18 @@ public:
 			_collector.setHighlightFlag(RenderableCollector::Highlight::GroupMember, false);
 		}
 
-		dispatchRenderable(*node);
+		if (_profiler)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			dispatchRenderable(*node);
+
+			_profiler->addSubmissionTime(getProfileKey(node), std::chrono::steady_clock::now() - start);
+		}
+		else
+		{
+			dispatchRenderable(*node);
+		}
 
         return true;
     }
@@ -105,8 +139,12 @@ public:
      */
     static void CollectRenderablesInScene(RenderableCollector& collector, const VolumeTest& volume)
     {
+        IRenderProfiler& profiler = GlobalRenderSystem().getProfiler();
+        ScopedRenderProfileSection section(profiler, "Scene walk");
+
         // Instantiate a new walker class
-        RenderableCollectionWalker renderHighlightWalker(collector, volume);
+        RenderableCollectionWalker renderHighlightWalker(collector, volume,
+            profiler.isRecording() ? &profiler : nullptr);
 
         // Submit renderables from scene graph
         GlobalSceneGraph().foreachVisibleNodeInVolume(volume, renderHighlightWalker);
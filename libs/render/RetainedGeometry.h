@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vector>
+
+#include "irender.h"
+#include "igeometrystore.h"
+
+namespace render
+{
+
+/**
+ * \brief
+ * Keeps the triangles of a single renderable in the IGeometryStore of a
+ * RenderSystem.
+ *
+ * The owner queues an update whenever its geometry changes, and passes the
+ * current triangles to update() before submitting itself for rendering.
+ * Renderables with identical geometry can share one RetainedGeometry.
+ * The slot is released when the render system changes or on destruction.
+ */
+class RetainedGeometry
+{
+    RenderSystemWeakPtr _renderSystem;
+
+    // The store of the render system, valid as long as the slot is
+    IGeometryStore* _store;
+    IGeometryStore::Slot _slot;
+
+    bool _needsUpdate;
+
+    // Set if only the vertices have been changed since the last update
+    bool _verticesOnly;
+
+public:
+    RetainedGeometry() :
+        _store(nullptr),
+        _slot(IGeometryStore::InvalidSlot),
+        _needsUpdate(true),
+        _verticesOnly(false)
+    {}
+
+    RetainedGeometry(const RetainedGeometry& other) = delete;
+    RetainedGeometry& operator=(const RetainedGeometry& other) = delete;
+
+    ~RetainedGeometry()
+    {
+        release();
+    }
+
+    void setRenderSystem(const RenderSystemPtr& renderSystem)
+    {
+        if (renderSystem == _renderSystem.lock()) return;
+
+        release();
+
+        _renderSystem = renderSystem;
+        _needsUpdate = true;
+        _verticesOnly = false;
+    }
+
+    RenderSystemPtr getRenderSystem() const
+    {
+        return _renderSystem.lock();
+    }
+
+    void queueUpdate()
+    {
+        _needsUpdate = true;
+        _verticesOnly = false;
+    }
+
+    // Queues an update of the vertices, the number of vertices and the indices are unchanged
+    void queueVertexUpdate()
+    {
+        if (!_needsUpdate)
+        {
+            _needsUpdate = true;
+            _verticesOnly = true;
+        }
+    }
+
+    bool needsUpdate() const
+    {
+        return _needsUpdate;
+    }
+
+    // Copies the given triangles to the store, indices are relative to the first vertex
+    void update(const std::vector<ArbitraryMeshVertex>& vertices, const std::vector<unsigned int>& indices)
+    {
+        bool verticesOnly = _verticesOnly;
+
+        _needsUpdate = false;
+        _verticesOnly = false;
+
+        if (indices.empty())
+        {
+            release();
+            return;
+        }
+
+        if (_slot != IGeometryStore::InvalidSlot)
+        {
+            if (verticesOnly)
+            {
+                _store->updateVertexData(_slot, vertices);
+            }
+            else
+            {
+                _store->updateData(_slot, vertices, indices);
+            }
+
+            return;
+        }
+
+        auto renderSystem = _renderSystem.lock();
+
+        if (renderSystem)
+        {
+            _store = &renderSystem->getGeometryStore();
+            _slot = _store->allocateSlot(vertices, indices);
+        }
+    }
+
+    // Returns the store and slot, as long as the stored geometry is up to date
+    bool getStorageLocation(const IGeometryStore*& store, std::size_t& slot) const
+    {
+        if (_slot == IGeometryStore::InvalidSlot || _needsUpdate) return false;
+
+        store = _store;
+        slot = _slot;
+
+        return true;
+    }
+
+private:
+    void release()
+    {
+        if (_slot == IGeometryStore::InvalidSlot) return;
+
+        // Don't touch the store if the render system is already gone
+        if (!_renderSystem.expired())
+        {
+            _store->deallocateSlot(_slot);
+        }
+
+        _slot = IGeometryStore::InvalidSlot;
+        _store = nullptr;
+    }
+};
+
+}
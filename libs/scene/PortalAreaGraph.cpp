@@ -0,0 +1,480 @@
+#include "PortalAreaGraph.h"
+
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cmath>
+
+#include "ibrush.h"
+#include "ishaders.h"
+#include "ivolumetest.h"
+#include "gamelib.h"
+#include "math/Plane3.h"
+
+namespace scene
+{
+
+namespace
+{
+	const char* const GKEY_VISPORTAL_SHADER = "/defaults/visportalShader";
+
+	// Faces with these flags are not blocking the view in the engine
+	const int NON_OPAQUE_SURFACE_FLAGS = Material::SURF_NONSOLID | Material::SURF_AREAPORTAL |
+		Material::SURF_WATER | Material::SURF_TRIGGER | Material::SURF_PLAYERCLIP |
+		Material::SURF_MONSTERCLIP | Material::SURF_MOVEABLECLIP | Material::SURF_IKCLIP;
+
+	// Looks up the material flags, each material name is only resolved once
+	class MaterialClassifier
+	{
+	private:
+		std::string _portalMaterial;
+		std::map<std::string, std::pair<bool, bool>> _cache;
+
+	public:
+		MaterialClassifier() :
+			_portalMaterial(game::current::getValue<std::string>(GKEY_VISPORTAL_SHADER))
+		{}
+
+		bool isPortal(const std::string& name)
+		{
+			return name == _portalMaterial || classify(name).first;
+		}
+
+		bool isOpaque(const std::string& name)
+		{
+			return classify(name).second;
+		}
+
+		bool isPortalBrush(const IBrush& brush)
+		{
+			for (std::size_t i = 0; i < brush.getNumFaces(); ++i)
+			{
+				if (isPortal(brush.getFace(i).getShader()))
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool isOpaqueBrush(const IBrush& brush)
+		{
+			if (brush.getDetailFlag() == IBrush::Detail || brush.getNumFaces() == 0)
+			{
+				return false;
+			}
+
+			// A single see-through face is enough to let the brush pass
+			for (std::size_t i = 0; i < brush.getNumFaces(); ++i)
+			{
+				if (!isOpaque(brush.getFace(i).getShader()))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+	private:
+		// Returns the pair (isPortal, isOpaque)
+		const std::pair<bool, bool>& classify(const std::string& name)
+		{
+			auto found = _cache.find(name);
+
+			if (found != _cache.end())
+			{
+				return found->second;
+			}
+
+			auto classification = std::make_pair(false, true);
+
+			if (GlobalMaterialManager().materialExists(name))
+			{
+				auto material = GlobalMaterialManager().getMaterialForName(name);
+
+				classification.first = (material->getSurfaceFlags() & Material::SURF_AREAPORTAL) != 0;
+				classification.second = (material->getSurfaceFlags() & NON_OPAQUE_SURFACE_FLAGS) == 0 &&
+					(material->getMaterialFlags() & Material::FLAG_TRANSLUCENT) == 0;
+			}
+
+			return _cache.emplace(name, classification).first->second;
+		}
+	};
+}
+
+PortalAreaGraph::PortalAreaGraph()
+{
+	clear();
+}
+
+void PortalAreaGraph::clear()
+{
+	_gridOrigin = Vector3(0, 0, 0);
+	_cellSize = MIN_CELL_SIZE;
+	_size[0] = _size[1] = _size[2] = 0;
+
+	_cells.clear();
+	_areas.clear();
+	_portals.clear();
+}
+
+void PortalAreaGraph::build(const INodePtr& worldspawn)
+{
+	build(CollectBrushes(worldspawn));
+}
+
+PortalAreaGraph::Brushes PortalAreaGraph::CollectBrushes(const INodePtr& worldspawn)
+{
+	Brushes brushes;
+
+	if (!worldspawn) return brushes;
+
+	MaterialClassifier classifier;
+
+	worldspawn->foreachNode([&](const INodePtr& node)
+	{
+		auto brush = Node_getIBrush(node);
+
+		if (brush == nullptr) return true;
+
+		if (classifier.isPortalBrush(*brush))
+		{
+			brushes.portals.push_back(node->worldAABB());
+		}
+		else if (classifier.isOpaqueBrush(*brush))
+		{
+			Brushes::Solid solid{ node->worldAABB(), std::vector<Plane3>() };
+			solid.planes.reserve(brush->getNumFaces());
+
+			for (std::size_t i = 0; i < brush->getNumFaces(); ++i)
+			{
+				solid.planes.push_back(brush->getFace(i).getPlane3());
+			}
+
+			brushes.solids.emplace_back(std::move(solid));
+		}
+
+		return true;
+	});
+
+	return brushes;
+}
+
+void PortalAreaGraph::build(const Brushes& brushes)
+{
+	clear();
+
+	AABB worldBounds;
+
+	for (const auto& bounds : brushes.portals)
+	{
+		_portals.emplace_back(Portal{ bounds, std::vector<std::size_t>() });
+		worldBounds.includeAABB(bounds);
+	}
+
+	for (const auto& solid : brushes.solids)
+	{
+		worldBounds.includeAABB(solid.bounds);
+	}
+
+	// Without portals there is just one big area
+	if (_portals.empty() || !worldBounds.isValid())
+	{
+		_portals.clear();
+		return;
+	}
+
+	// Choose the cell size such that the grid is not getting too large
+	for (_cellSize = MIN_CELL_SIZE; ; _cellSize *= 2)
+	{
+		// Leave one empty cell around everything, for the void to be connected
+		for (std::size_t axis = 0; axis < 3; ++axis)
+		{
+			_size[axis] = static_cast<std::size_t>(std::ceil(worldBounds.extents[axis] * 2 / _cellSize)) + 2;
+		}
+
+		if (_size[0] * _size[1] * _size[2] <= MAX_CELLS)
+		{
+			break;
+		}
+	}
+
+	_gridOrigin = worldBounds.origin - worldBounds.extents - Vector3(_cellSize, _cellSize, _cellSize);
+	_cells.assign(_size[0] * _size[1] * _size[2], CELL_EMPTY);
+
+	for (const auto& solid : brushes.solids)
+	{
+		markSolidCells(solid);
+	}
+
+	for (const auto& portal : _portals)
+	{
+		markPortalCells(portal.bounds);
+	}
+
+	floodFillAreas();
+	connectPortals();
+}
+
+int PortalAreaGraph::getAreaAt(const Vector3& point) const
+{
+	if (_cells.empty()) return -1;
+
+	for (std::size_t axis = 0; axis < 3; ++axis)
+	{
+		auto coord = (point[axis] - _gridOrigin[axis]) / _cellSize;
+
+		if (coord < 0 || coord >= _size[axis])
+		{
+			return -1;
+		}
+	}
+
+	std::size_t coords[3];
+	getCellCoords(point, coords);
+
+	auto value = _cells[getCellIndex(coords[0], coords[1], coords[2])];
+
+	return value < MAX_AREAS ? static_cast<int>(value) : -1;
+}
+
+bool PortalAreaGraph::findVisibleAreas(const Vector3& origin, const VolumeTest& volume,
+	std::vector<AABB>& areaBounds) const
+{
+	auto startArea = getAreaAt(origin);
+
+	if (startArea == -1)
+	{
+		return false;
+	}
+
+	std::vector<bool> visited(_areas.size(), false);
+	std::vector<std::size_t> openAreas(1, static_cast<std::size_t>(startArea));
+
+	visited[startArea] = true;
+
+	// Walk through all the portals which are in the view
+	while (!openAreas.empty())
+	{
+		auto area = openAreas.back();
+		openAreas.pop_back();
+
+		areaBounds.push_back(_areas[area].bounds);
+
+		for (auto portalIndex : _areas[area].portals)
+		{
+			const auto& portal = _portals[portalIndex];
+
+			if (volume.TestAABB(portal.bounds) == VOLUME_OUTSIDE)
+			{
+				continue;
+			}
+
+			for (auto neighbour : portal.areas)
+			{
+				if (!visited[neighbour])
+				{
+					visited[neighbour] = true;
+					openAreas.push_back(neighbour);
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool PortalAreaGraph::IsPortalBrush(const INodePtr& brush)
+{
+	auto ibrush = Node_getIBrush(brush);
+
+	return ibrush != nullptr && MaterialClassifier().isPortalBrush(*ibrush);
+}
+
+bool PortalAreaGraph::IsOpaqueBrush(const INodePtr& brush)
+{
+	auto ibrush = Node_getIBrush(brush);
+
+	return ibrush != nullptr && MaterialClassifier().isOpaqueBrush(*ibrush);
+}
+
+void PortalAreaGraph::getCellCoords(const Vector3& point, std::size_t coords[3]) const
+{
+	for (std::size_t axis = 0; axis < 3; ++axis)
+	{
+		auto coord = std::floor((point[axis] - _gridOrigin[axis]) / _cellSize);
+
+		coords[axis] = static_cast<std::size_t>(std::max(0.0, std::min(coord, static_cast<double>(_size[axis] - 1))));
+	}
+}
+
+Vector3 PortalAreaGraph::getCellCentre(std::size_t x, std::size_t y, std::size_t z) const
+{
+	return _gridOrigin + Vector3(x + 0.5, y + 0.5, z + 0.5) * _cellSize;
+}
+
+void PortalAreaGraph::markSolidCells(const Brushes::Solid& brush)
+{
+	const auto& planes = brush.planes;
+	const auto& bounds = brush.bounds;
+
+	std::size_t min[3];
+	std::size_t max[3];
+	getCellCoords(bounds.origin - bounds.extents, min);
+	getCellCoords(bounds.origin + bounds.extents, max);
+
+	// Only cells with their centre inside the brush are solid
+	for (auto z = min[2]; z <= max[2]; ++z)
+	{
+		for (auto y = min[1]; y <= max[1]; ++y)
+		{
+			for (auto x = min[0]; x <= max[0]; ++x)
+			{
+				auto centre = getCellCentre(x, y, z);
+
+				bool inside = std::all_of(planes.begin(), planes.end(), [&](const Plane3& plane)
+				{
+					return plane.distanceToPoint(centre) <= 0;
+				});
+
+				if (inside)
+				{
+					_cells[getCellIndex(x, y, z)] = CELL_SOLID;
+				}
+			}
+		}
+	}
+}
+
+void PortalAreaGraph::markPortalCells(const AABB& bounds)
+{
+	std::size_t min[3];
+	std::size_t max[3];
+	getCellCoords(bounds.origin - bounds.extents, min);
+	getCellCoords(bounds.origin + bounds.extents, max);
+
+	// Every cell touched by the portal separates the areas
+	for (auto z = min[2]; z <= max[2]; ++z)
+	{
+		for (auto y = min[1]; y <= max[1]; ++y)
+		{
+			for (auto x = min[0]; x <= max[0]; ++x)
+			{
+				auto& cell = _cells[getCellIndex(x, y, z)];
+
+				if (cell != CELL_SOLID)
+				{
+					cell = CELL_PORTAL;
+				}
+			}
+		}
+	}
+}
+
+void PortalAreaGraph::floodFillAreas()
+{
+	std::vector<std::size_t> openCells;
+
+	for (std::size_t z = 0; z < _size[2]; ++z)
+	{
+		for (std::size_t y = 0; y < _size[1]; ++y)
+		{
+			for (std::size_t x = 0; x < _size[0]; ++x)
+			{
+				if (_cells[getCellIndex(x, y, z)] != CELL_EMPTY)
+				{
+					continue;
+				}
+
+				if (_areas.size() == MAX_AREAS)
+				{
+					// Give up, the grid is too fragmented to be of any use
+					clear();
+					return;
+				}
+
+				auto areaIndex = static_cast<std::uint16_t>(_areas.size());
+
+				// Bounds are including a margin of one cell, such that brushes
+				// aligned to the cell borders are still intersecting the area
+				AABB areaBounds;
+
+				_cells[getCellIndex(x, y, z)] = areaIndex;
+				openCells.push_back(getCellIndex(x, y, z));
+
+				while (!openCells.empty())
+				{
+					auto index = openCells.back();
+					openCells.pop_back();
+
+					std::size_t cx = index % _size[0];
+					std::size_t cy = (index / _size[0]) % _size[1];
+					std::size_t cz = index / (_size[0] * _size[1]);
+
+					areaBounds.includeAABB(AABB(getCellCentre(cx, cy, cz), Vector3(_cellSize, _cellSize, _cellSize) * 1.5));
+
+					auto visit = [&](std::size_t neighbour)
+					{
+						if (_cells[neighbour] == CELL_EMPTY)
+						{
+							_cells[neighbour] = areaIndex;
+							openCells.push_back(neighbour);
+						}
+					};
+
+					if (cx > 0) visit(index - 1);
+					if (cx + 1 < _size[0]) visit(index + 1);
+					if (cy > 0) visit(index - _size[0]);
+					if (cy + 1 < _size[1]) visit(index + _size[0]);
+					if (cz > 0) visit(index - _size[0] * _size[1]);
+					if (cz + 1 < _size[2]) visit(index + _size[0] * _size[1]);
+				}
+
+				_areas.emplace_back(Area{ areaBounds, std::vector<std::size_t>() });
+			}
+		}
+	}
+}
+
+void PortalAreaGraph::connectPortals()
+{
+	for (std::size_t portalIndex = 0; portalIndex < _portals.size(); ++portalIndex)
+	{
+		auto& portal = _portals[portalIndex];
+
+		std::size_t min[3];
+		std::size_t max[3];
+		getCellCoords(portal.bounds.origin - portal.bounds.extents, min);
+		getCellCoords(portal.bounds.origin + portal.bounds.extents, max);
+
+		std::set<std::size_t> areas;
+
+		// Check the neighbours of the portal cells, including the ones next to the portal bounds
+		for (auto z = min[2] > 0 ? min[2] - 1 : 0; z <= max[2] + 1 && z < _size[2]; ++z)
+		{
+			for (auto y = min[1] > 0 ? min[1] - 1 : 0; y <= max[1] + 1 && y < _size[1]; ++y)
+			{
+				for (auto x = min[0] > 0 ? min[0] - 1 : 0; x <= max[0] + 1 && x < _size[0]; ++x)
+				{
+					auto value = _cells[getCellIndex(x, y, z)];
+
+					if (value < MAX_AREAS)
+					{
+						areas.insert(value);
+					}
+				}
+			}
+		}
+
+		portal.areas.assign(areas.begin(), areas.end());
+
+		for (auto area : portal.areas)
+		{
+			_areas[area].portals.push_back(portalIndex);
+		}
+	}
+}
+
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "inode.h"
+#include "math/AABB.h"
+#include "math/Plane3.h"
+
+class VolumeTest;
+
+namespace scene
+{
+
+/**
+ * Approximation of the areas the game engine is splitting a map into,
+ * which can be used to skip the parts of the map the camera can't see.
+ *
+ * The engine compiler is building areas from the BSP tree of the
+ * worldspawn brushes, areas are the empty spaces separated by the
+ * visportals. This is way too expensive to do in the editor, so the
+ * space is divided into a grid of cubic cells instead: cells whose
+ * centre is inside an opaque structural brush are solid, cells touching
+ * the bounds of a visportal brush are separating the areas, and the
+ * rest is flood-filled to find the areas.
+ *
+ * Any error of this approximation makes areas merge (e.g. walls thinner
+ * than a cell are not sealing the area), so it might cull less than the
+ * engine but never hides anything the engine could see.
+ */
+class PortalAreaGraph
+{
+public:
+	struct Portal
+	{
+		AABB bounds;
+
+		// The areas touching this portal, usually two
+		std::vector<std::size_t> areas;
+	};
+
+	struct Area
+	{
+		// The bounds of all the cells of this area
+		AABB bounds;
+
+		std::vector<std::size_t> portals;
+	};
+
+	// The worldspawn brushes relevant to the graph, copied out of the scene
+	struct Brushes
+	{
+		struct Solid
+		{
+			AABB bounds;
+			std::vector<Plane3> planes;
+		};
+
+		std::vector<AABB> portals;
+		std::vector<Solid> solids;
+	};
+
+private:
+	// The grid is kept as small as possible, large maps get larger cells
+	static constexpr std::size_t MAX_CELLS = 1 << 22;
+	static constexpr double MIN_CELL_SIZE = 16;
+
+	// Cell values which are not an area index
+	static constexpr std::uint16_t CELL_SOLID = 0xffff;
+	static constexpr std::uint16_t CELL_PORTAL = 0xfffe;
+	static constexpr std::uint16_t CELL_EMPTY = 0xfffd;
+	static constexpr std::size_t MAX_AREAS = CELL_EMPTY;
+
+	Vector3 _gridOrigin;
+	double _cellSize;
+	std::size_t _size[3];
+
+	std::vector<std::uint16_t> _cells;
+
+	std::vector<Area> _areas;
+	std::vector<Portal> _portals;
+
+public:
+	PortalAreaGraph();
+
+	// Discards the current graph and builds a new one from the brushes of the given worldspawn
+	void build(const INodePtr& worldspawn);
+
+	// Discards the current graph and builds a new one from the given brushes.
+	// Doesn't access the scene or the material manager, can be called from any thread.
+	void build(const Brushes& brushes);
+
+	// Collects the portal and opaque brushes of the given worldspawn, to be called on the main thread
+	static Brushes CollectBrushes(const INodePtr& worldspawn);
+
+	void clear();
+
+	const std::vector<Area>& getAreas() const
+	{
+		return _areas;
+	}
+
+	const std::vector<Portal>& getPortals() const
+	{
+		return _portals;
+	}
+
+	// Returns the index of the area containing the given point,
+	// or -1 if the point is in solid space or outside the grid.
+	int getAreaAt(const Vector3& point) const;
+
+	/**
+	 * Collects the bounds of the areas which can be seen from the given point
+	 * by walking through the portals intersecting the given volume.
+	 * Returns false if the graph can't tell, i.e. the point is not inside
+	 * any area or the map doesn't have any portals.
+	 */
+	bool findVisibleAreas(const Vector3& origin, const VolumeTest& volume, std::vector<AABB>& areaBounds) const;
+
+	// Returns true if the given brush is a visportal
+	static bool IsPortalBrush(const INodePtr& brush);
+
+	// Returns true if the given brush is sealing the areas (opaque and structural)
+	static bool IsOpaqueBrush(const INodePtr& brush);
+
+private:
+	std::size_t getCellIndex(std::size_t x, std::size_t y, std::size_t z) const
+	{
+		return (z * _size[1] + y) * _size[0] + x;
+	}
+
+	// Returns the cell coordinates of the given point, clamped to the grid
+	void getCellCoords(const Vector3& point, std::size_t coords[3]) const;
+
+	Vector3 getCellCentre(std::size_t x, std::size_t y, std::size_t z) const;
+
+	void markSolidCells(const Brushes::Solid& brush);
+	void markPortalCells(const AABB& bounds);
+	void floodFillAreas();
+	void connectPortals();
+};
+
+}
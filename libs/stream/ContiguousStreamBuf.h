@@ -0,0 +1,90 @@
+#pragma once
+
+#include <streambuf>
+#include <string_view>
+
+namespace stream
+{
+
+/**
+ * A read-only std::streambuf operating on a contiguous block of memory
+ * (e.g. a memory-mapped file or a fully loaded string). The whole sequence
+ * is exposed as get area, so istream clients work as usual, while parsers
+ * aware of this type can access the memory directly through getContents()
+ * and report their read position back via setPosition().
+ *
+ * The referenced memory must outlive this buffer.
+ */
+class ContiguousStreamBuf :
+    public std::streambuf
+{
+public:
+    ContiguousStreamBuf(std::string_view contents)
+    {
+        setContents(contents);
+    }
+
+    // Replaces the buffer contents, the read position is moved to the start
+    void setContents(std::string_view contents)
+    {
+        auto begin = const_cast<char*>(contents.data());
+        setg(begin, begin, begin + contents.size());
+    }
+
+    // The full buffer contents, regardless of the current read position
+    std::string_view getContents() const
+    {
+        return std::string_view(eback(), static_cast<std::size_t>(egptr() - eback()));
+    }
+
+    // The offset of the current read position relative to the buffer start
+    std::size_t getPosition() const
+    {
+        return static_cast<std::size_t>(gptr() - eback());
+    }
+
+    // Moves the read position to the given offset (clamped to the buffer size)
+    void setPosition(std::size_t offset)
+    {
+        auto size = static_cast<std::size_t>(egptr() - eback());
+        setg(eback(), eback() + (offset < size ? offset : size), egptr());
+    }
+
+protected:
+    std::streamsize showmanyc() override
+    {
+        return egptr() - gptr();
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+
+        off_type base = 0;
+
+        switch (dir)
+        {
+        case std::ios_base::beg: base = 0; break;
+        case std::ios_base::cur: base = gptr() - eback(); break;
+        case std::ios_base::end: base = egptr() - eback(); break;
+        default: return pos_type(off_type(-1));
+        }
+
+        return seekpos(pos_type(base + off), which);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        off_type offset = pos;
+
+        if (!(which & std::ios_base::in) || offset < 0 || offset > egptr() - eback())
+        {
+            return pos_type(off_type(-1));
+        }
+
+        setg(eback(), eback() + offset, egptr());
+        return pos;
+    }
+};
+
+}
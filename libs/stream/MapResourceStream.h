@@ -2,11 +2,14 @@
 
 #include <memory>
 #include <string>
-#include <fstream>
+#include <istream>
 #include "os/path.h"
 #include "itextstream.h"
 #include "iarchive.h"
 #include "ifilesystem.h"
+#include "MappedFile.h"
+#include "ContiguousStreamBuf.h"
+#include "utils.h"
 
 namespace stream
 {
@@ -39,23 +42,28 @@ public:
 namespace detail
 {
 
-// Stream implementation targeting a physical file
+// Stream implementation targeting a physical file. The file is memory-mapped,
+// parsers can tokenise the mapped region directly through the ContiguousStreamBuf.
 class FileMapResourceStream :
     public MapResourceStream
 {
 private:
-    std::ifstream _stream;
+    MappedFile _file;
+    ContiguousStreamBuf _buffer;
+    std::istream _stream;
 
 public:
-    FileMapResourceStream(const std::string& path)
+    FileMapResourceStream(const std::string& path) :
+        _file(path),
+        _buffer(_file.getContents()),
+        _stream(&_buffer)
     {
         rMessage() << "Open file " << path << " from filesystem...";
 
-        _stream.open(path);
-
-        if (!_stream)
+        if (!_file.isOpen())
         {
             rError() << "failure" << std::endl;
+            _stream.setstate(std::ios::failbit);
             return;
         }
 
@@ -64,7 +72,7 @@ public:
 
     bool isOpen() const override
     {
-        return _stream.good();
+        return _file.isOpen();
     }
 
     std::istream& getStream() override
@@ -76,7 +84,7 @@ public:
 /**
  * MapResourceStream implementation working with a PAK file.
  * Since deflated file streams are not seekable, the whole 
- * file contents are pre-loaded into a seekable stringstream.
+ * file contents are pre-loaded into a contiguous buffer.
  */
 class ArchivedMapResourceStream :
     public MapResourceStream
@@ -84,10 +92,14 @@ class ArchivedMapResourceStream :
 private:
     ArchiveTextFilePtr _archiveFile;
 
-    std::stringstream _contentStream;
+    std::string _contents;
+    ContiguousStreamBuf _buffer;
+    std::istream _contentStream;
 
 public:
-    ArchivedMapResourceStream(const std::string& path)
+    ArchivedMapResourceStream(const std::string& path) :
+        _buffer(std::string_view()),
+        _contentStream(&_buffer)
     {
         rMessage() << "Trying to open file " << path << " from VFS...";
 
@@ -101,21 +113,17 @@ public:
 
         rMessage() << "success." << std::endl;
 
-        std::istream vfsStream(&(_archiveFile->getInputStream()));
-
-        // Load everything into one large string
-        _contentStream << vfsStream.rdbuf();
+        loadContents();
     }
 
     ArchivedMapResourceStream(const ArchiveTextFilePtr& archive) :
-        _archiveFile(archive)
+        _archiveFile(archive),
+        _buffer(std::string_view()),
+        _contentStream(&_buffer)
     {
         rMessage() << "Opened text file in PAK: " << archive->getName() << std::endl;
 
-        std::istream vfsStream(&(_archiveFile->getInputStream()));
-
-        // Load everything into one large string
-        _contentStream << vfsStream.rdbuf();
+        loadContents();
     }
 
     bool isOpen() const override
@@ -127,6 +135,16 @@ public:
     {
         return _contentStream;
     }
+
+private:
+    void loadContents()
+    {
+        // Load everything into one large string
+        _contents = stream::readAll(_archiveFile->getInputStream());
+
+        _buffer.setContents(_contents);
+        _contentStream.clear();
+    }
 };
 
 }
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "util/Noncopyable.h"
+
+namespace stream
+{
+
+/**
+ * Read-only memory mapping of a physical file. The file contents are
+ * accessible through data() and size() as long as this object is alive,
+ * no copy of the data is made - the OS pages the file in on demand.
+ *
+ * Use isOpen() to check whether the mapping succeeded. Empty files
+ * are treated as successfully opened, with data() returning nullptr.
+ *
+ * The mapping is read-only, so any number of threads can read the
+ * contents concurrently without synchronisation.
+ */
+class MappedFile :
+    public util::Noncopyable
+{
+public:
+    // Hint for the OS how the mapped pages are going to be read
+    enum class Access
+    {
+        Sequential, // read front to back once, like a map file
+        Normal,     // no particular order, like the entries of a pk4
+    };
+
+private:
+    const char* _data;
+    std::size_t _size;
+    bool _isOpen;
+
+#ifdef WIN32
+    HANDLE _file;
+    HANDLE _mapping;
+#endif
+
+public:
+    MappedFile(const std::string& path, Access access = Access::Sequential) :
+        _data(nullptr),
+        _size(0),
+        _isOpen(false)
+#ifdef WIN32
+        , _file(INVALID_HANDLE_VALUE),
+        _mapping(nullptr)
+#endif
+    {
+#ifdef WIN32
+        _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL |
+            (access == Access::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0), nullptr);
+
+        if (_file == INVALID_HANDLE_VALUE) return;
+
+        LARGE_INTEGER fileSize;
+
+        if (!GetFileSizeEx(_file, &fileSize)) return;
+
+        _size = static_cast<std::size_t>(fileSize.QuadPart);
+        _isOpen = true;
+
+        if (_size == 0) return; // empty files cannot be mapped
+
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (_mapping == nullptr)
+        {
+            _isOpen = false;
+            return;
+        }
+
+        _data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+        _isOpen = _data != nullptr;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+
+        if (fd == -1) return;
+
+        struct stat st;
+
+        if (::fstat(fd, &st) == 0)
+        {
+            _size = static_cast<std::size_t>(st.st_size);
+            _isOpen = true;
+
+            if (_size > 0)
+            {
+                void* mapped = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (mapped != MAP_FAILED)
+                {
+                    _data = static_cast<const char*>(mapped);
+                    ::madvise(mapped, _size, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+                }
+                else
+                {
+                    _size = 0;
+                    _isOpen = false;
+                }
+            }
+        }
+
+        // The mapping stays valid after closing the descriptor
+        ::close(fd);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef WIN32
+        if (_data != nullptr) UnmapViewOfFile(_data);
+        if (_mapping != nullptr) CloseHandle(_mapping);
+        if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+#else
+        if (_data != nullptr) ::munmap(const_cast<char*>(_data), _size);
+#endif
+    }
+
+    // Returns true if the file could be opened and mapped
+    bool isOpen() const
+    {
+        return _isOpen;
+    }
+
+    // Start of the mapped region, nullptr for empty or unopened files
+    const char* data() const
+    {
+        return _data;
+    }
+
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    // Returns the whole file contents as view
+    std::string_view getContents() const
+    {
+        return _data != nullptr ? std::string_view(_data, _size) : std::string_view();
+    }
+};
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "idatastream.h"
+#include <algorithm>
+#include <cstring>
+
+namespace stream
+{
+
+/**
+ * Seekable InputStream reading from a block of memory it doesn't own,
+ * like a region of a MappedFile. The memory block needs to stay valid
+ * as long as this stream is used.
+ *
+ * Unlike the PointerInputStream the reads are bounded by the block size.
+ * Seeks behave like fseek() on a FileInputStream: they return 0 on success,
+ * positions outside the block are rejected and leave the position unchanged.
+ */
+class MemoryInputStream :
+	public SeekableInputStream
+{
+private:
+	const byte_type* _begin;
+	const byte_type* _end;
+	const byte_type* _pos;
+
+public:
+	MemoryInputStream(const void* data, size_type size) :
+		_begin(static_cast<const byte_type*>(data)),
+		_end(_begin + size),
+		_pos(_begin)
+	{}
+
+	size_type read(byte_type* buffer, size_type length) override
+	{
+		size_type count = std::min(length, getRemaining());
+
+		if (count > 0)
+		{
+			std::memcpy(buffer, _pos, count);
+			_pos += count;
+		}
+
+		return count;
+	}
+
+	position_type seek(position_type position) override
+	{
+		if (position > size())
+		{
+			return 1;
+		}
+
+		_pos = _begin + position;
+		return 0;
+	}
+
+	position_type seek(offset_type offset, seekdir direction) override
+	{
+		const byte_type* base = direction == beg ? _begin : direction == end ? _end : _pos;
+
+		if ((offset < 0 && static_cast<size_type>(-offset) > static_cast<size_type>(base - _begin)) ||
+			(offset > 0 && static_cast<size_type>(offset) > static_cast<size_type>(_end - base)))
+		{
+			return 1;
+		}
+
+		_pos = base + offset;
+		return 0;
+	}
+
+	position_type tell() const override
+	{
+		return _pos - _begin;
+	}
+
+	size_type size() const
+	{
+		return _end - _begin;
+	}
+
+	// The number of bytes left to read
+	size_type getRemaining() const
+	{
+		return _end - _pos;
+	}
+
+	// Direct access to the unread part of the memory block, without copying it
+	const byte_type* getData() const
+	{
+		return _pos;
+	}
+};
+
+}
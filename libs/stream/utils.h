@@ -4,7 +4,9 @@
 #include <cstdint>
 
 #include "idatastream.h"
+#include "itextstream.h"
 #include <ostream>
+#include <string>
 #include <algorithm>
 
 namespace stream
@@ -72,4 +74,22 @@ inline InputStream::byte_type readByte(InputStream& stream)
 	return value;
 }
 
+/**
+ * Reads the remaining contents of the given text stream into a single string,
+ * ready to be tokenised as one contiguous block of memory.
+ */
+inline std::string readAll(TextInputStream& stream)
+{
+	std::string contents;
+	char buffer[16384];
+
+	for (std::size_t bytesRead = stream.read(buffer, sizeof(buffer)); bytesRead > 0;
+		 bytesRead = stream.read(buffer, sizeof(buffer)))
+	{
+		contents.append(buffer, bytesRead);
+	}
+
+	return contents;
+}
+
 }
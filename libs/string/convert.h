@@ -3,6 +3,11 @@
 #include "math/Vector3.h"
 #include "math/Vector4.h"
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
 
 namespace string
 {
@@ -236,6 +241,77 @@ template<typename Src> float to_float(const Src& src)
 }
 #endif
 
+namespace detail
+{
+
+/**
+ * Null-terminated copy of a string_view for the C conversion functions.
+ * Short strings (like all regular numbers) are copied to a local buffer,
+ * longer ones fall back to an allocated std::string.
+ */
+class TerminatedString
+{
+private:
+    char _buffer[64];
+    std::string _longString;
+    const char* _str;
+
+public:
+    TerminatedString(std::string_view str) :
+        _str(_buffer)
+    {
+        if (str.size() < sizeof(_buffer))
+        {
+            std::memcpy(_buffer, str.data(), str.size());
+            _buffer[str.size()] = '\0';
+        }
+        else
+        {
+            _longString.assign(str);
+            _str = _longString.c_str();
+        }
+    }
+
+    TerminatedString(const TerminatedString& other) = delete;
+    TerminatedString& operator=(const TerminatedString& other) = delete;
+
+    const char* c_str() const
+    {
+        return _str;
+    }
+};
+
+} // detail
+
+/**
+ * Convert a string_view to a float, without allocating memory unless the
+ * string is exceptionally long. Like convert<float>(), this returns 0 if the
+ * string is not a valid number or out of range.
+ */
+inline float to_float(std::string_view str)
+{
+    detail::TerminatedString terminated(str);
+
+    char* end = nullptr;
+    errno = 0;
+
+    float value = std::strtof(terminated.c_str(), &end);
+
+    return end == terminated.c_str() || errno == ERANGE ? 0.0f : value;
+}
+
+/**
+ * Convert a string_view to a double, without allocating memory unless the
+ * string is exceptionally long, like atof() does for null-terminated strings.
+ * Returns 0 if the string is not a valid number.
+ */
+inline double to_double(std::string_view str)
+{
+    detail::TerminatedString terminated(str);
+
+    return std::strtod(terminated.c_str(), nullptr);
+}
+
 // Convert the given type to a std::string
 template<typename Src> 
 inline std::string to_string(const Src& value)
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace util
+{
+
+/**
+ * Non-cryptographic 64 bit hash used to detect changes of file contents
+ * or to generate cache keys. It's a variant of FNV-1a consuming eight bytes
+ * per step, which makes it fast enough to hash large files on the fly.
+ * The resulting values are not portable between platforms of different
+ * endianness, don't use them in files meant to be exchanged.
+ */
+class Hash64
+{
+private:
+    std::uint64_t _value;
+
+    static constexpr std::uint64_t OffsetBasis = 14695981039346656037ULL;
+    static constexpr std::uint64_t Prime = 1099511628211ULL;
+
+public:
+    Hash64() :
+        _value(OffsetBasis)
+    {}
+
+    // Adds the given block of memory to the hash
+    void update(const void* data, std::size_t size)
+    {
+        auto bytes = static_cast<const unsigned char*>(data);
+
+        for (; size >= sizeof(std::uint64_t); size -= sizeof(std::uint64_t), bytes += sizeof(std::uint64_t))
+        {
+            std::uint64_t word;
+            std::memcpy(&word, bytes, sizeof(word));
+
+            _value = (_value ^ word) * Prime;
+            _value ^= _value >> 29;
+        }
+
+        for (; size > 0; --size, ++bytes)
+        {
+            _value = (_value ^ *bytes) * Prime;
+        }
+    }
+
+    // Adds the string contents including its length, such that
+    // consecutive strings can't produce the same hash when split differently
+    void update(std::string_view str)
+    {
+        update(static_cast<std::uint64_t>(str.size()));
+        update(str.data(), str.size());
+    }
+
+    void update(const std::string& str)
+    {
+        update(std::string_view(str));
+    }
+
+    void update(const char* str)
+    {
+        update(std::string_view(str));
+    }
+
+    template<typename ValueType>
+    typename std::enable_if<std::is_arithmetic<ValueType>::value>::type update(ValueType value)
+    {
+        update(&value, sizeof(value));
+    }
+
+    std::uint64_t getValue() const
+    {
+        return _value;
+    }
+};
+
+}
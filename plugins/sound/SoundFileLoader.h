@@ -24,6 +24,10 @@ class SoundFileLoader
     // Shader map to populate
 	SoundManager::ShaderMap& _shaders;
 
+public:
+	// The shaders found in a single file, in order of appearance
+	typedef std::vector<SoundShader::Ptr> ParsedFile;
+
 private:
 
 	std::string getShortened(const std::string& input, std::size_t maxLength)
@@ -42,7 +46,7 @@ private:
 
     // Accept a stream of shaders to parse
     void parseShadersFromStream(std::istream& contents, const vfs::FileInfo& fileInfo,
-                                const std::string& modName)
+                                const std::string& modName, ParsedFile& parsedFile)
     {
         // Construct a DefTokeniser to tokenise the string into sound shader
         // decls
@@ -54,14 +58,9 @@ private:
             parser::BlockTokeniser::Block block = tok.nextBlock();
 
             // Create a new shader with this name
-            auto result = _shaders.emplace(block.name,
-				std::make_shared<SoundShader>(block.name, block.contents, fileInfo, modName)
+            parsedFile.push_back(
+                std::make_shared<SoundShader>(block.name, block.contents, fileInfo, modName)
             );
-
-            if (!result.second) {
-                rError() << "[SoundManager]: SoundShader with name "
-                    << block.name << " already exists." << std::endl;
-            }
         }
     }
 
@@ -75,10 +74,13 @@ public:
 	{ }
 
 	/**
-	 * Functor operator.
+	 * Parses the given file into a list of shaders, without adding them
+	 * to the map. This is called on the declaration workers.
 	 */
-	void parseShaderFile(const vfs::FileInfo& fileInfo)
+	ParsedFile parseShaderFile(const vfs::FileInfo& fileInfo)
 	{
+		ParsedFile parsedFile;
+
 		// Open the .sndshd file and get its contents as a std::string
 		auto file = GlobalFileSystem().openTextFile(SOUND_FOLDER + fileInfo.name);
 
@@ -87,20 +89,36 @@ public:
         {
 			rWarning() << "[sound] Warning: unable to open \""
 					  << fileInfo.name << "\"" << std::endl;
-			return;
+			return parsedFile;
 		}
 
 		std::istream is(&(file->getInputStream()));
 
 		try
 		{
-			parseShadersFromStream(is, fileInfo, file->getModName());
+			parseShadersFromStream(is, fileInfo, file->getModName(), parsedFile);
 		}
 		catch (parser::ParseException& ex)
 		{
 			rError() << "[sound]: Error while parsing " << fileInfo.name <<
 				": " << ex.what() << std::endl;
 		}
+
+		return parsedFile;
+	}
+
+	// Adds the parsed shaders of a file to the map, the first shader of a name wins
+	void addShaders(const ParsedFile& parsedFile)
+	{
+		for (const auto& shader : parsedFile)
+		{
+			auto result = _shaders.emplace(shader->getName(), shader);
+
+			if (!result.second) {
+				rError() << "[SoundManager]: SoundShader with name "
+					<< shader->getName() << " already exists." << std::endl;
+			}
+		}
 	}
 };
 
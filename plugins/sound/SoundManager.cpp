@@ -3,8 +3,10 @@
 
 #include "ifilesystem.h"
 #include "icommandsystem.h"
+#include "ideclscheduler.h"
 
 #include "debugging/ScopedDebugTimer.h"
+#include "ParallelDefFileLoader.h"
 #include "os/path.h"
 #include "string/case_conv.h"
 
@@ -126,7 +128,7 @@ const std::string& SoundManager::getName() const
 const StringSet& SoundManager::getDependencies() const
 {
     static StringSet _dependencies { 
-        MODULE_VIRTUALFILESYSTEM, MODULE_COMMANDSYSTEM
+        MODULE_VIRTUALFILESYSTEM, MODULE_COMMANDSYSTEM, MODULE_DECLARATION_SCHEDULER
     };
 	return _dependencies;
 }
@@ -135,16 +137,22 @@ void SoundManager::loadShadersFromFilesystem()
 {
     auto foundShaders = std::make_shared<ShaderMap>();
 
-	// Pass a SoundFileLoader to the filesystem
+	// The SoundFileLoader parses the files on the declaration workers and merges them in order
     SoundFileLoader loader(*foundShaders);
+    util::ParallelDefFileLoader<SoundFileLoader::ParsedFile> fileLoader("sound shaders");
 
     GlobalFileSystem().forEachFile(
         SOUND_FOLDER,			// directory
         "sndshd", 				// required extension
-        std::bind(&SoundFileLoader::parseShaderFile, loader, std::placeholders::_1),	// loader callback
+        [&](const vfs::FileInfo& fileInfo) { fileLoader.addFile(fileInfo); },
         99						// max depth
     );
 
+    fileLoader.load(
+        [&](const vfs::FileInfo& fileInfo) { return loader.parseShaderFile(fileInfo); },
+        [&](const vfs::FileInfo&, const SoundFileLoader::ParsedFile& parsedFile) { loader.addShaders(parsedFile); }
+    );
+
     _shaders.swap(*foundShaders);
 
     rMessage() << _shaders.size() << " sound shaders found." << std::endl;
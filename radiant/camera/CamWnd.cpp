@@ -9,6 +9,7 @@
 #include "itextstream.h"
 #include "iorthoview.h"
 #include "icameraview.h"
+#include "irenderprofiler.h"
 
 #include <time.h>
 #include <fmt/format.h>
@@ -20,6 +21,7 @@
 #include "CameraSettings.h"
 #include "GlobalCameraWndManager.h"
 #include "render/RenderableCollectionWalker.h"
+#include "render/PortalCullingVolume.h"
 #include "wxutil/MouseButton.h"
 #include "registry/adaptors.h"
 #include "selection/OccludeSelector.h"
@@ -646,6 +648,9 @@ void CamWnd::Cam_Draw()
     // Reset statistics for this frame
     _renderStats.resetStats();
 
+    render::IRenderProfiler& profiler = GlobalRenderSystem().getProfiler();
+    profiler.beginFrame("Camera");
+
     _view.resetCullStats();
 
     glMatrixMode(GL_PROJECTION);
@@ -744,7 +749,26 @@ void CamWnd::Cam_Draw()
         // Front end (renderable collection from scene)
         render::CamRenderer renderer(_view, _primitiveHighlightShader.get(),
                                      _faceHighlightShader.get());
-        render::RenderableCollectionWalker::CollectRenderablesInScene(renderer, _view);
+
+        // Skip the areas which can't be seen through the visportals, if enabled
+        std::vector<AABB> visibleAreas;
+        bool areasFound = false;
+
+        if (getCameraSettings()->portalCullingEnabled())
+        {
+            render::ScopedRenderProfileSection section(profiler, "Portal culling");
+            areasFound = GlobalCamera().getPortalCulling().findVisibleAreas(_camera->getCameraOrigin(), _view, visibleAreas);
+        }
+
+        if (areasFound)
+        {
+            render::PortalCullingVolume areaVolume(_view, visibleAreas);
+            render::RenderableCollectionWalker::CollectRenderablesInScene(renderer, areaVolume);
+        }
+        else
+        {
+            render::RenderableCollectionWalker::CollectRenderablesInScene(renderer, _view);
+        }
 
         // Accumulate render statistics
         _renderStats.setLightCount(renderer.getVisibleLights(),
@@ -758,11 +782,17 @@ void CamWnd::Cam_Draw()
         }
 
         // Back end (submit to shaders and do the actual render)
-        renderer.submitToShaders();
+        {
+            render::ScopedRenderProfileSection section(profiler, "Submit to shaders");
+            renderer.submitToShaders();
+        }
+
         GlobalRenderSystem().render(allowedRenderFlags, _camera->getModelView(),
                                     _camera->getProjection(), _view.getViewer());
     }
 
+    profiler.endFrame();
+
     // greebo: Draw the clipper's points (skipping the depth-test)
     {
         glDisable(GL_DEPTH_TEST);
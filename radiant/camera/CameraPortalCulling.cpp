@@ -0,0 +1,136 @@
+#include "CameraPortalCulling.h"
+
+#include "imap.h"
+#include "iscenegraph.h"
+#include "itextstream.h"
+#include "ThreadPool.h"
+
+namespace ui
+{
+
+namespace
+{
+	// The time the scene needs to stay unchanged before the graph is rebuilt
+	const std::chrono::milliseconds REBUILD_DELAY(500);
+}
+
+CameraPortalCulling::CameraPortalCulling() :
+	_graphNeedsUpdate(true),
+	_lastSceneChange(std::chrono::steady_clock::now()),
+	_sceneChangeCount(0),
+	_pendingSceneChangeCount(0)
+{
+	_boundsChangedConn = GlobalSceneGraph().signal_boundsChanged().connect(
+		sigc::mem_fun(this, &CameraPortalCulling::onSceneChanged));
+
+	GlobalUndoSystem().attachTracker(*this);
+}
+
+CameraPortalCulling::~CameraPortalCulling()
+{
+	GlobalUndoSystem().detachTracker(*this);
+
+	_boundsChangedConn.disconnect();
+}
+
+bool CameraPortalCulling::findVisibleAreas(const Vector3& origin, const VolumeTest& view, std::vector<AABB>& areaBounds)
+{
+	ensureGraphIsUpToDate();
+
+	if (_graphNeedsUpdate || !_graph)
+	{
+		return false;
+	}
+
+	return _graph->findVisibleAreas(origin, view, areaBounds);
+}
+
+void CameraPortalCulling::clear()
+{
+	onSceneChanged();
+}
+
+void CameraPortalCulling::begin()
+{
+	onSceneChanged();
+}
+
+void CameraPortalCulling::undo()
+{
+	onSceneChanged();
+}
+
+void CameraPortalCulling::redo()
+{
+	onSceneChanged();
+}
+
+void CameraPortalCulling::onSceneChanged()
+{
+	_graphNeedsUpdate = true;
+	_lastSceneChange = std::chrono::steady_clock::now();
+	++_sceneChangeCount;
+}
+
+void CameraPortalCulling::ensureGraphIsUpToDate()
+{
+	const auto& worldspawn = GlobalMapModule().getWorldspawn();
+
+	if (worldspawn != _worldspawn.lock())
+	{
+		// A different map has been loaded
+		_worldspawn = worldspawn;
+		onSceneChanged();
+	}
+
+	if (_pendingGraph.valid() && !collectPendingGraph())
+	{
+		return; // still building
+	}
+
+	if (!_graphNeedsUpdate || std::chrono::steady_clock::now() - _lastSceneChange < REBUILD_DELAY)
+	{
+		return;
+	}
+
+	// The brushes are copied here, the workers must not access the scene
+	auto brushes = std::make_shared<scene::PortalAreaGraph::Brushes>(
+		scene::PortalAreaGraph::CollectBrushes(worldspawn));
+
+	_pendingSceneChangeCount = _sceneChangeCount;
+	_buildStart = std::chrono::steady_clock::now();
+
+	_pendingGraph = util::ThreadPool::GetShared().enqueue([brushes]()
+	{
+		auto graph = std::make_shared<scene::PortalAreaGraph>();
+		graph->build(*brushes);
+		return graph;
+	});
+}
+
+bool CameraPortalCulling::collectPendingGraph()
+{
+	if (_pendingGraph.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return false;
+	}
+
+	auto graph = _pendingGraph.get();
+
+	if (_pendingSceneChangeCount != _sceneChangeCount)
+	{
+		return true; // the scene has been changed since, the next build is due
+	}
+
+	_graph = graph;
+	_graphNeedsUpdate = false;
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _buildStart);
+
+	rMessage() << "Portal area graph built: " << _graph->getAreas().size() << " areas, " <<
+		_graph->getPortals().size() << " portals, " << duration.count() << " msec" << std::endl;
+
+	return true;
+}
+
+}
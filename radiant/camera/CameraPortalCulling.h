@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+#include <sigc++/connection.h>
+
+#include "iundo.h"
+#include "scene/PortalAreaGraph.h"
+
+class VolumeTest;
+
+namespace ui
+{
+
+/**
+ * Keeps the PortalAreaGraph of the current map up to date for the camera views.
+ *
+ * Building the graph is too expensive to happen after every change, so the
+ * graph is just marked as outdated when the scene is modified. Once the scene
+ * has not been changed for a moment, the next camera view being drawn copies
+ * the relevant brushes and the graph is built from them on the shared thread
+ * pool. The views are not culled by areas until the new graph is ready, a
+ * graph built from a scene which has changed in the meantime is discarded.
+ */
+class CameraPortalCulling :
+	public IUndoSystem::Tracker
+{
+private:
+	std::shared_ptr<scene::PortalAreaGraph> _graph;
+
+	// The worldspawn the graph has been built for
+	scene::INodeWeakPtr _worldspawn;
+
+	bool _graphNeedsUpdate;
+	std::chrono::steady_clock::time_point _lastSceneChange;
+
+	// Incremented on every change, to detect graphs built from an outdated scene
+	std::size_t _sceneChangeCount;
+
+	// The graph being built in the background and the change count it is built for
+	std::future<std::shared_ptr<scene::PortalAreaGraph>> _pendingGraph;
+	std::size_t _pendingSceneChangeCount;
+	std::chrono::steady_clock::time_point _buildStart;
+
+	sigc::connection _boundsChangedConn;
+
+public:
+	CameraPortalCulling();
+	~CameraPortalCulling();
+
+	/**
+	 * Collects the bounds of the areas visible from the given camera origin.
+	 * Returns false if the views can't be culled right now, because the
+	 * map has no portals, the camera is not inside an area or the graph is
+	 * waiting to be rebuilt.
+	 */
+	bool findVisibleAreas(const Vector3& origin, const VolumeTest& view, std::vector<AABB>& areaBounds);
+
+	// IUndoSystem::Tracker implementation, any undoable change might affect the areas
+	void clear() override;
+	void begin() override;
+	void undo() override;
+	void redo() override;
+
+private:
+	void onSceneChanged();
+	void ensureGraphIsUpToDate();
+
+	// Takes the graph built in the background if it's finished, returns false otherwise
+	bool collectPendingGraph();
+};
+
+}
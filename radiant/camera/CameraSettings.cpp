@@ -20,6 +20,7 @@ CameraSettings::CameraSettings() :
 	_cameraDrawMode(RENDER_MODE_TEXTURED),
 	_cubicScale(registry::getValue<int>(RKEY_CUBIC_SCALE)),
 	_farClipEnabled(registry::getValue<bool>(RKEY_ENABLE_FARCLIP)),
+	_portalCullingEnabled(registry::getValue<bool>(RKEY_PORTAL_CULLING)),
 	_solidSelectionBoxes(registry::getValue<bool>(RKEY_SOLID_SELECTION_BOXES)),
 	_toggleFreelook(registry::getValue<bool>(RKEY_TOGGLE_FREE_MOVE))
 {
@@ -37,6 +38,7 @@ CameraSettings::CameraSettings() :
 	observeKey(RKEY_INVERT_MOUSE_VERTICAL_AXIS);
 	observeKey(RKEY_DISCRETE_MOVEMENT);
 	observeKey(RKEY_ENABLE_FARCLIP);
+	observeKey(RKEY_PORTAL_CULLING);
 	observeKey(RKEY_DRAWMODE);
 	observeKey(RKEY_SOLID_SELECTION_BOXES);
 	observeKey(RKEY_TOGGLE_FREE_MOVE);
@@ -64,6 +66,7 @@ void CameraSettings::constructPreferencePage()
 	page.appendCheckBox(_("Freelook mode can be toggled"), RKEY_TOGGLE_FREE_MOVE);
 	page.appendCheckBox(_("Discrete movement (non-freelook mode)"), RKEY_DISCRETE_MOVEMENT);
 	page.appendCheckBox(_("Enable far-clip plane (hides distant objects)"), RKEY_ENABLE_FARCLIP);
+	page.appendCheckBox(_("Hide areas not visible through visportals"), RKEY_PORTAL_CULLING);
 
 	// Add the "inverse mouse vertical axis in free-look mode" preference
 	page.appendCheckBox(_("Invert mouse vertical axis (freelook mode)"), RKEY_INVERT_MOUSE_VERTICAL_AXIS);
@@ -129,6 +132,7 @@ void CameraSettings::keyChanged()
 	_angleSpeed = registry::getValue<int>(RKEY_ROTATION_SPEED);
 	_invertMouseVerticalAxis = registry::getValue<bool>(RKEY_INVERT_MOUSE_VERTICAL_AXIS);
 	_farClipEnabled = registry::getValue<bool>(RKEY_ENABLE_FARCLIP);
+	_portalCullingEnabled = registry::getValue<bool>(RKEY_PORTAL_CULLING);
 	_solidSelectionBoxes = registry::getValue<bool>(RKEY_SOLID_SELECTION_BOXES);
 
 	GlobalEventManager().setToggled("ToggleCubicClip", _farClipEnabled);
@@ -202,6 +206,11 @@ bool CameraSettings::farClipEnabled() const
 	return _farClipEnabled;
 }
 
+bool CameraSettings::portalCullingEnabled() const
+{
+	return _portalCullingEnabled;
+}
+
 bool CameraSettings::solidSelectionBoxes() const {
 	return _solidSelectionBoxes;
 }
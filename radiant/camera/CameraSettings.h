@@ -26,6 +26,7 @@ namespace
 	const std::string RKEY_DISCRETE_MOVEMENT = RKEY_CAMERA_ROOT + "/discreteMovement";
 	const std::string RKEY_CUBIC_SCALE = RKEY_CAMERA_ROOT + "/cubicScale";
 	const std::string RKEY_ENABLE_FARCLIP = RKEY_CAMERA_ROOT + "/enableCubicClipping";
+	const std::string RKEY_PORTAL_CULLING = RKEY_CAMERA_ROOT + "/portalCulling";
 	const std::string RKEY_DRAWMODE = RKEY_CAMERA_ROOT + "/drawMode";
 	const std::string RKEY_SOLID_SELECTION_BOXES = "user/ui/xyview/solidSelectionBoxes";
 	const std::string RKEY_TOGGLE_FREE_MOVE = RKEY_CAMERA_ROOT + "/toggleFreeMove";
@@ -62,6 +63,7 @@ class CameraSettings: public sigc::trackable
 
 	int _cubicScale;
 	bool _farClipEnabled;
+	bool _portalCullingEnabled;
 	bool _solidSelectionBoxes;
 	// This is TRUE if the mousebutton must be held to stay in freelook mode
 	// instead of enabling it by clicking and clicking again to disable
@@ -82,6 +84,9 @@ public:
 
 	// Returns true if cubic clipping is on
 	bool farClipEnabled() const;
+
+	// Returns true if the areas hidden by walls and visportals should be skipped
+	bool portalCullingEnabled() const;
 	bool invertMouseVerticalAxis() const;
 	bool discreteMovement() const;
 	bool solidSelectionBoxes() const;
@@ -4,6 +4,8 @@
 #include "ieventmanager.h"
 #include "iselection.h"
 #include "iuimanager.h"
+#include "iscenegraph.h"
+#include "imap.h"
 #include "itextstream.h"
 #include "xmlutil/Node.h"
 
@@ -152,6 +154,12 @@ void GlobalCameraWndManager::removeCamWnd(int id) {
 	}
 }
 
+CameraPortalCulling& GlobalCameraWndManager::getPortalCulling()
+{
+	assert(_portalCulling);
+	return *_portalCulling;
+}
+
 // Construct/return a floating window containing the CamWnd widget
 FloatingCamWndPtr GlobalCameraWndManager::createFloatingWindow()
 {
@@ -462,6 +470,9 @@ const StringSet& GlobalCameraWndManager::getDependencies() const
 		_dependencies.insert(MODULE_COMMANDSYSTEM);
         _dependencies.insert(MODULE_MOUSETOOLMANAGER);
 		_dependencies.insert(MODULE_UIMANAGER);
+		_dependencies.insert(MODULE_SCENEGRAPH);
+		_dependencies.insert(MODULE_UNDOSYSTEM);
+		_dependencies.insert(MODULE_MAP);
 	}
 
 	return _dependencies;
@@ -486,6 +497,8 @@ void GlobalCameraWndManager::initialiseModule(const IApplicationContext& ctx)
 
 	CamWnd::captureStates();
 
+	_portalCulling.reset(new CameraPortalCulling);
+
     IMouseToolGroup& toolGroup = GlobalMouseToolManager().getGroup(IMouseToolGroup::Type::CameraView);
 
     toolGroup.registerMouseTool(std::make_shared<FreeMoveTool>());
@@ -504,6 +517,8 @@ void GlobalCameraWndManager::shutdownModule()
 	CamWnd::releaseStates();
 
 	_cameras.clear();
+
+	_portalCulling.reset();
 }
 
 // Define the static Camera module
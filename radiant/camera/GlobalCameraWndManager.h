@@ -7,6 +7,7 @@
 
 #include "CamWnd.h"
 #include "FloatingCamWnd.h"
+#include "CameraPortalCulling.h"
 
 class wxWindow;
 
@@ -36,6 +37,8 @@ private:
     float _strafeSpeed;
     float _forwardStrafeFactor;
 
+	std::unique_ptr<CameraPortalCulling> _portalCulling;
+
 public:
 	// Constructor
 	GlobalCameraWndManager();
@@ -53,6 +56,9 @@ public:
 	// Remove the camwnd with the given ID
 	void removeCamWnd(int id);
 
+	// The area graph of the current map, shared by all camera windows
+	CameraPortalCulling& getPortalCulling();
+
 	/**
 	 * Get a PersistentFloatingWindow containing the CamWnd widget, creating
 	 * it if necessary.
@@ -10,6 +10,8 @@
 #include "igame.h"
 #include "ipreferencesystem.h"
 #include "icommandsystem.h"
+#include "imapresource.h"
+#include "iuimanager.h"
 
 #include "registry/registry.h"
 
@@ -36,12 +38,17 @@ namespace
 	// Registry key names
 	const char* RKEY_AUTOSAVE_ENABLED = "user/ui/map/autoSaveEnabled";
 	const char* RKEY_AUTOSAVE_INTERVAL = "user/ui/map/autoSaveInterval";
+	const char* RKEY_AUTOSAVE_IN_BACKGROUND = "user/ui/map/autoSaveInBackground";
 	const char* RKEY_AUTOSAVE_SNAPSHOTS_ENABLED = "user/ui/map/autoSaveSnapshots";
 	const char* RKEY_AUTOSAVE_SNAPSHOTS_FOLDER = "user/ui/map/snapshotFolder";
 	const char* RKEY_AUTOSAVE_MAX_SNAPSHOT_FOLDER_SIZE = "user/ui/map/maxSnapshotFolderSize";
 	const char* RKEY_AUTOSAVE_SNAPSHOT_FOLDER_SIZE_HISTORY = "user/ui/map/snapshotFolderSizeHistory";
 	const char* GKEY_MAP_EXTENSION = "/mapFormat/fileExtension";
 	const char* const MODULE_AUTOSAVER = "AutomaticMapSaver";
+	const char* const STATUS_BAR_ELEMENT = "AutoSaveProgress";
+
+	// The interval the status bar is updated while saving in the background
+	const int PROGRESS_INTERVAL_MSECS = 250;
 
 	std::string constructSnapshotName(const fs::path& snapshotPath, const std::string& mapName, int num)
 	{
@@ -63,6 +70,7 @@ namespace
 AutoMapSaver::AutoMapSaver() :
 	_enabled(false),
 	_snapshotsEnabled(false),
+	_saveInBackground(false),
 	_interval(5*60),
 	_changes(0)
 {}
@@ -79,6 +87,7 @@ void AutoMapSaver::registryKeyChanged()
 
 	_enabled = registry::getValue<bool>(RKEY_AUTOSAVE_ENABLED);
 	_snapshotsEnabled = registry::getValue<bool>(RKEY_AUTOSAVE_SNAPSHOTS_ENABLED);
+	_saveInBackground = registry::getValue<bool>(RKEY_AUTOSAVE_IN_BACKGROUND);
 	_interval = registry::getValue<int>(RKEY_AUTOSAVE_INTERVAL) * 60;
 	
 	// Start the timer with the new interval
@@ -141,9 +150,18 @@ void AutoMapSaver::saveSnapshot()
 		rMessage() << "Autosaving snapshot to " << filename << std::endl;
 
 		// Dump to map to the next available filename
-        GlobalCommandSystem().executeCommand("SaveMapCopyAs", filename);
+		saveMapCopy(filename);
 
-		handleSnapshotSizeLimit(existingSnapshots, snapshotPath, mapName);
+		if (_backgroundSave)
+		{
+			// The snapshot is still being written, see finishBackgroundSave()
+			_backgroundSnapshotPath = snapshotPath;
+			_backgroundSnapshotMapName = mapName;
+		}
+		else
+		{
+			handleSnapshotSizeLimit(existingSnapshots, snapshotPath, mapName);
+		}
 	}
 	else 
 	{
@@ -152,6 +170,62 @@ void AutoMapSaver::saveSnapshot()
 	}
 }
 
+void AutoMapSaver::saveMapCopy(const std::string& filename)
+{
+	if (!_saveInBackground)
+	{
+		GlobalCommandSystem().executeCommand("SaveMapCopyAs", filename);
+		return;
+	}
+
+	try
+	{
+		// The scene is copied right away, the file is written while the user continues editing
+		_backgroundSave = GlobalMapModule().saveCopyInBackground(filename);
+
+		GlobalUIManager().getStatusBarManager().setText(STATUS_BAR_ELEMENT, _("Autosaving..."));
+
+		_progressTimer->Start(PROGRESS_INTERVAL_MSECS);
+	}
+	catch (const IMapResource::OperationException& ex)
+	{
+		radiant::NotificationMessage::SendError(ex.what());
+	}
+}
+
+void AutoMapSaver::finishBackgroundSave()
+{
+	_progressTimer->Stop();
+
+	if (!_backgroundSave) return;
+
+	if (_backgroundSave->finish())
+	{
+		rMessage() << "Autosave written to " << _backgroundSave->getFilename() << std::endl;
+
+		if (!_backgroundSnapshotMapName.empty())
+		{
+			// Sum up the folder including the snapshot that has just been completed
+			std::map<int, std::string> existingSnapshots;
+			collectExistingSnapshots(existingSnapshots, _backgroundSnapshotPath, _backgroundSnapshotMapName);
+
+			handleSnapshotSizeLimit(existingSnapshots, _backgroundSnapshotPath, _backgroundSnapshotMapName);
+		}
+	}
+	else
+	{
+		// The save failed or has been cancelled, try again after the next interval
+		rMessage() << "Autosave to " << _backgroundSave->getFilename() << " has not been completed" << std::endl;
+		clearChanges();
+	}
+
+	_backgroundSave.reset();
+	_backgroundSnapshotPath.clear();
+	_backgroundSnapshotMapName.clear();
+
+	GlobalUIManager().getStatusBarManager().setText(STATUS_BAR_ELEMENT, "");
+}
+
 void AutoMapSaver::handleSnapshotSizeLimit(const std::map<int, std::string>& existingSnapshots, 
 	const fs::path& snapshotPath, const std::string& mapName)
 {
@@ -231,6 +305,12 @@ void AutoMapSaver::collectExistingSnapshots(std::map<int, std::string>& existing
 
 void AutoMapSaver::checkSave()
 {
+	// Don't start a new save while the previous one is still being written
+	if (_backgroundSave)
+	{
+		return;
+	}
+
 	// Check, if changes have been made since the last autosave
 	if (!GlobalSceneGraph().root() ||
 		_changes == GlobalSceneGraph().root()->getUndoChangeTracker().changes())
@@ -283,7 +363,7 @@ void AutoMapSaver::checkSave()
 				rMessage() << "Autosaving unnamed map to " << autoSaveFilename << std::endl;
 
 				// Invoke the save call
-                GlobalCommandSystem().executeCommand("SaveMapCopyAs", autoSaveFilename);
+				saveMapCopy(autoSaveFilename);
 			}
 			else
 			{
@@ -299,7 +379,7 @@ void AutoMapSaver::checkSave()
 				rMessage() << "Autosaving map to " << filename << std::endl;
 
 				// Invoke the save call
-                GlobalCommandSystem().executeCommand("SaveMapCopyAs", filename);
+				saveMapCopy(filename);
 			}
 		}
 	}
@@ -320,6 +400,7 @@ void AutoMapSaver::constructPreferences()
 	// Add the checkboxes and connect them with the registry key and the according observer
 	page.appendCheckBox(_("Enable Autosave"), RKEY_AUTOSAVE_ENABLED);
 	page.appendSlider(_("Autosave Interval (in minutes)"), RKEY_AUTOSAVE_INTERVAL, 1, 61, 1, 1);
+	page.appendCheckBox(_("Save in the background"), RKEY_AUTOSAVE_IN_BACKGROUND);
 
 	page.appendCheckBox(_("Save Snapshots"), RKEY_AUTOSAVE_SNAPSHOTS_ENABLED);
 	page.appendEntry(_("Snapshot folder (relative to map folder)"), RKEY_AUTOSAVE_SNAPSHOTS_FOLDER);
@@ -331,6 +412,18 @@ void AutoMapSaver::onIntervalReached(wxTimerEvent& ev)
     checkSave();
 }
 
+void AutoMapSaver::onProgressTimerReached(wxTimerEvent& ev)
+{
+	if (_backgroundSave && !_backgroundSave->isDone())
+	{
+		GlobalUIManager().getStatusBarManager().setText(STATUS_BAR_ELEMENT,
+			fmt::format(_("Autosaving... {0:d}%"), static_cast<int>(_backgroundSave->getProgress() * 100)));
+		return;
+	}
+
+	finishBackgroundSave();
+}
+
 void AutoMapSaver::onMapEvent(IMap::MapEvent ev)
 {
 	// We reset our change count regardless of whether a map
@@ -363,6 +456,7 @@ const StringSet& AutoMapSaver::getDependencies() const
 		_dependencies.insert(MODULE_MAP);
 		_dependencies.insert(MODULE_PREFERENCESYSTEM);
 		_dependencies.insert(MODULE_XMLREGISTRY);
+		_dependencies.insert(MODULE_UIMANAGER);
 	}
 
 	return _dependencies;
@@ -373,8 +467,13 @@ void AutoMapSaver::initialiseModule(const IApplicationContext& ctx)
 	rMessage() << getName() << "::initialiseModule called." << std::endl;
 
     _timer.reset(new wxTimer(this));
+    _progressTimer.reset(new wxTimer(this));
+
+    Bind(wxEVT_TIMER, &AutoMapSaver::onIntervalReached, this, _timer->GetId());
+    Bind(wxEVT_TIMER, &AutoMapSaver::onProgressTimerReached, this, _progressTimer->GetId());
 
-    Bind(wxEVT_TIMER, &AutoMapSaver::onIntervalReached, this);
+	GlobalUIManager().getStatusBarManager().addTextElement(STATUS_BAR_ELEMENT, "",
+		IStatusBarManager::POS_MAP_EDIT_TIME + 1, _("Progress of the automatic map save"));
 
 	constructPreferences();
 
@@ -387,6 +486,9 @@ void AutoMapSaver::initialiseModule(const IApplicationContext& ctx)
 	_signalConnections.push_back(GlobalRegistry().signalForKey(RKEY_AUTOSAVE_ENABLED).connect(
 		sigc::mem_fun(this, &AutoMapSaver::registryKeyChanged)
 	));
+	_signalConnections.push_back(GlobalRegistry().signalForKey(RKEY_AUTOSAVE_IN_BACKGROUND).connect(
+		sigc::mem_fun(this, &AutoMapSaver::registryKeyChanged)
+	));
 
 	// Get notified when the map is loaded afresh
 	_signalConnections.push_back(GlobalMapModule().signal_mapEvent().connect(
@@ -410,8 +512,20 @@ void AutoMapSaver::shutdownModule()
 	_enabled = false;
 	stopTimer();
 
-	// Destroy the timer
+	if (_backgroundSave)
+	{
+		_backgroundSave->cancel();
+		_backgroundSave->finish();
+		_backgroundSave.reset();
+		_backgroundSnapshotPath.clear();
+		_backgroundSnapshotMapName.clear();
+	}
+
+	_progressTimer->Stop();
+
+	// Destroy the timers
 	_timer.reset();
+	_progressTimer.reset();
 }
 
 module::StaticModule<AutoMapSaver> staticAutoSaverModule;
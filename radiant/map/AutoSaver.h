@@ -5,6 +5,7 @@
 #include "iregistry.h"
 #include "imodule.h"
 #include "imap.h"
+#include "imapexporter.h"
 
 #include <vector>
 #include <sigc++/connection.h>
@@ -29,12 +30,24 @@ class AutoMapSaver :
 	// TRUE, if the autosaver generates snapshots
 	bool _snapshotsEnabled;
 
+	// TRUE, if the map files are written on a worker thread
+	bool _saveInBackground;
+
 	// The autosave interval stored in seconds
 	unsigned long _interval;
 
     // The timer object that triggers the callback
     wxSharedPtr<wxTimer> _timer;
 
+	// The save running in the background and the timer polling its progress
+	map::IBackgroundMapExport::Ptr _backgroundSave;
+	wxSharedPtr<wxTimer> _progressTimer;
+
+	// Set while the background save is writing a snapshot, the size
+	// of the snapshot folder is checked once the file is complete
+	fs::path _backgroundSnapshotPath;
+	std::string _backgroundSnapshotMapName;
+
 	std::size_t _changes;
 
 	std::vector<sigc::connection> _signalConnections;
@@ -73,9 +86,18 @@ private:
 	// Saves a snapshot of the currently active map (only named maps)
 	void saveSnapshot();
 
+	// Writes a copy of the map to the given file, either right away or in the background
+	void saveMapCopy(const std::string& filename);
+
+	// Cleans up after the background save is done and updates the status bar
+	void finishBackgroundSave();
+
 	// This gets called when the interval time is over
     void onIntervalReached(wxTimerEvent& ev);
 
+	// Called periodically while a background save is running
+	void onProgressTimerReached(wxTimerEvent& ev);
+
 	void collectExistingSnapshots(std::map<int, std::string>& existingSnapshots,
 		const fs::path& snapshotPath, const std::string& mapName);
 
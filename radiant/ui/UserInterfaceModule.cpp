@@ -101,6 +101,7 @@ const StringSet& UserInterfaceModule::getDependencies() const
 		_dependencies.insert(MODULE_MRU_MANAGER);
 		_dependencies.insert(MODULE_MAINFRAME);
 		_dependencies.insert(MODULE_MOUSETOOLMANAGER);
+		_dependencies.insert(MODULE_SHADERSYSTEM);
 	}
 
 	return _dependencies;
@@ -202,6 +203,9 @@ void UserInterfaceModule::initialiseModule(const IApplicationContext& ctx)
 		radiant::IMessage::Type::Notification,
         radiant::TypeListener<radiant::NotificationMessage>(UserInterfaceModule::HandleNotificationMessage));
 
+	_texturesStreamedConn = GlobalMaterialManager().signal_TexturesStreamed().connect(
+		sigc::ptr_fun(UserInterfaceModule::HandleTexturesStreamed));
+
 	// Initialise the AAS UI
 	AasControlDialog::Init();
 
@@ -228,6 +232,7 @@ void UserInterfaceModule::shutdownModule()
 
 	_coloursUpdatedConn.disconnect();
 	_entitySettingsConn.disconnect();
+	_texturesStreamedConn.disconnect();
 
 	_longOperationHandler.reset();
 	_mapFileProgressHandler.reset();
@@ -415,6 +420,16 @@ void UserInterfaceModule::HandleTextureChanged(radiant::TextureChangedMessage& m
 	SurfaceInspector::update();
 }
 
+void UserInterfaceModule::HandleTexturesStreamed()
+{
+	// This is invoked by the texture streaming workers, so dispatch this
+	GetUserInterfaceModule().dispatch([]()
+	{
+		// Redraw the views to upload the textures and show them
+		GlobalMainFrame().updateAllWindows();
+	});
+}
+
 // Static module registration
 module::StaticModule<UserInterfaceModule> userInterfaceModule;
 
@@ -47,6 +47,7 @@ private:
 
 	sigc::connection _entitySettingsConn;
 	sigc::connection _coloursUpdatedConn;
+	sigc::connection _texturesStreamedConn;
 
 	std::size_t _execFailedListener;
 	std::size_t _textureChangedListener;
@@ -76,6 +77,7 @@ private:
 
 	void handleCommandExecutionFailure(radiant::CommandExecutionFailedMessage& msg);
 	static void HandleTextureChanged(radiant::TextureChangedMessage& msg);
+	static void HandleTexturesStreamed();
 	static void HandleNotificationMessage(radiant::NotificationMessage& msg);
 
 	void onDispatchEvent(DispatchEvent& evt);
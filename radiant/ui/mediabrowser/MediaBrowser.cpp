@@ -22,8 +22,10 @@
 #include <wx/radiobut.h>
 #include <wx/frame.h>
 
+#include <algorithm>
 #include <iostream>
 #include <map>
+#include <set>
 
 #include "registry/registry.h"
 #include "shaderlib.h"
@@ -70,6 +72,9 @@ const char* const REMOVE_FROM_FAVOURITES = N_("Remove from Favourites");
 
 const char* const RKEY_FAVOURITES_ROOT = "user/ui/mediaBrowser/favourites";
 
+// The number of materials around the selected one whose previews are prefetched
+const std::size_t NUM_PREFETCHED_MATERIALS = 64;
+
 }
 
 // The set of favourite materials, which can be persisted to the registry
@@ -654,6 +659,7 @@ void MediaBrowser::onMaterialDefsUnloaded()
 
 	// Clear the media browser on MaterialManager unrealisation
 	_treeStore->Clear();
+	_prefetchedFolder.clear();
 	_emptyFavouritesLabel = wxDataViewItem();
 
 	_isPopulated = false;
@@ -955,6 +961,8 @@ void MediaBrowser::handleSelectionChange()
 	// Update the preview if a texture is selected
 	if (!isDirectorySelected())
 	{
+		prefetchEditorImages(getSelection());
+
 		_preview->SetTexture(getSelection());
 		GlobalShaderClipboard().setSourceShader(getSelection());
 	}
@@ -966,6 +974,41 @@ void MediaBrowser::handleSelectionChange()
 	}
 }
 
+void MediaBrowser::prefetchEditorImages(const std::string& materialName)
+{
+	auto slash = materialName.rfind('/');
+	auto folder = slash != std::string::npos ? materialName.substr(0, slash + 1) : std::string();
+
+	// Once per folder, browsing through it will find the previews loaded
+	if (materialName.empty() || folder == _prefetchedFolder)
+	{
+		return;
+	}
+
+	_prefetchedFolder = folder;
+
+	std::vector<std::string> siblings;
+
+	GlobalMaterialManager().foreachShaderName([&](const std::string& name)
+	{
+		if (string::istarts_with(name, folder) && name.find('/', folder.size()) == std::string::npos)
+		{
+			siblings.push_back(name);
+		}
+	});
+
+	std::sort(siblings.begin(), siblings.end());
+
+	// Limit large folders to the materials around the selected one
+	std::size_t selected = std::lower_bound(siblings.begin(), siblings.end(), materialName) - siblings.begin();
+	std::size_t first = selected > NUM_PREFETCHED_MATERIALS / 2 ? selected - NUM_PREFETCHED_MATERIALS / 2 : 0;
+	std::size_t last = std::min(first + NUM_PREFETCHED_MATERIALS, siblings.size());
+	first = last - std::min(last, NUM_PREFETCHED_MATERIALS);
+
+	GlobalMaterialManager().prefetchEditorImages(
+		std::set<std::string>(siblings.begin() + first, siblings.begin() + last));
+}
+
 void MediaBrowser::_onSelectionChanged(wxTreeEvent& ev)
 {
 	handleSelectionChange();
@@ -101,6 +101,9 @@ private:
 
 	bool _blockShaderClipboardUpdates;
 
+	// The folder whose editor images have been prefetched last
+	std::string _prefetchedFolder;
+
 private:
 	void construct();
 
@@ -126,6 +129,9 @@ private:
 	void handleSelectionChange();
 	void handleTreeModeChanged();
 
+	// Loads the editor images of the materials next to the given one in a batch
+	void prefetchEditorImages(const std::string& materialName);
+
 	/* Tree selection query functions */
 	bool isDirectorySelected(); // is a directory selected
 	bool isFavouriteSelected(); // is a favourite selected
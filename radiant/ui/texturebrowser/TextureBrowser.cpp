@@ -62,31 +62,29 @@ public:
     Vector2i position;
     MaterialPtr material;
 
-    TextureTile(TextureBrowser& owner) :
-        _owner(owner)
-    {}
+    // The preview, null while it's being loaded
+    const TextureThumbnailAtlas::Thumbnail* thumbnail;
 
-    bool isVisible()
+    // Hit-testing passes requestThumbnail = false, to look up the preview
+    // without queueing it for loading
+    TextureTile(TextureBrowser& owner, std::size_t index, bool requestThumbnail = true) :
+        _owner(owner),
+        material(owner._materials[index]),
+        thumbnail(requestThumbnail ? owner._thumbnails->getThumbnail(material) :
+            owner._thumbnails->findThumbnail(material))
     {
-        return _owner.materialIsVisible(material);
+        position = _owner.getTilePosition(index);
+        size = _owner.getTileSize(thumbnail);
     }
 
     void render()
     {
-        if (!isVisible())
-        {
-            return;
-        }
-
-        TexturePtr texture = material->getEditorImage();
-        if (!texture) return;
-
         // Is this texture visible?
         if ((position.y() - size.y() - FONT_HEIGHT() < _owner.getOriginY()) &&
             (position.y() > _owner.getOriginY() - _owner.getViewportHeight()))
         {
             drawBorder();
-            drawTextureQuad(texture->getGLTexNum());
+            drawTextureQuad();
             drawTextureName();
         }
     }
@@ -162,20 +160,37 @@ private:
         }
     }
 
-    void drawTextureQuad(GLuint num)
+    void drawTextureQuad()
     {
-        glBindTexture(GL_TEXTURE_2D, num);
+        if (!thumbnail)
+        {
+            // Draw a placeholder until the preview has been loaded
+            glDisable(GL_TEXTURE_2D);
+            glColor3f(0.5f, 0.5f, 0.5f);
+
+            glBegin(GL_QUADS);
+            glVertex2i(position.x(), position.y() - FONT_HEIGHT());
+            glVertex2i(position.x() + size.x(), position.y() - FONT_HEIGHT());
+            glVertex2i(position.x() + size.x(), position.y() - FONT_HEIGHT() - size.y());
+            glVertex2i(position.x(), position.y() - FONT_HEIGHT() - size.y());
+            glEnd();
+
+            glEnable(GL_TEXTURE_2D);
+            return;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, thumbnail->texture);
         debug::assertNoGlErrors();
         glColor3f(1, 1, 1);
 
         glBegin(GL_QUADS);
-        glTexCoord2i(0, 0);
+        glTexCoord2f(thumbnail->s0, thumbnail->t0);
         glVertex2i(position.x(), position.y() - FONT_HEIGHT());
-        glTexCoord2i(1, 0);
+        glTexCoord2f(thumbnail->s1, thumbnail->t0);
         glVertex2i(position.x() + size.x(), position.y() - FONT_HEIGHT());
-        glTexCoord2i(1, 1);
+        glTexCoord2f(thumbnail->s1, thumbnail->t1);
         glVertex2i(position.x() + size.x(), position.y() - FONT_HEIGHT() - size.y());
-        glTexCoord2i(0, 1);
+        glTexCoord2f(thumbnail->s0, thumbnail->t1);
         glVertex2i(position.x(), position.y() - FONT_HEIGHT() - size.y());
         glEnd();
     }
@@ -216,6 +231,9 @@ TextureBrowser::TextureBrowser(wxWindow* parent) :
     _filterIgnoresTexturePath(true),
     _filterIsIncremental(true),
     _wxGLWidget(nullptr),
+    _columnWidth(1),
+    _rowHeight(1),
+    _numColumns(1),
     _heightChanged(true),
     _originInvalid(true),
     _mouseWheelScrollIncrement(registry::getValue<int>(RKEY_TEXTURE_MOUSE_WHEEL_INCR)),
@@ -237,6 +255,8 @@ TextureBrowser::TextureBrowser(wxWindow* parent) :
 
     _shader = texdef_name_default();
 
+    _thumbnails.reset(new TextureThumbnailAtlas(std::bind(&TextureBrowser::queueDraw, this)));
+
     _shaderLabel = new wxutil::IconTextMenuItem(_("No shader"), TEXTURE_ICON);
 
     _popupMenu->addItem(_shaderLabel, []() {}, []()->bool { return false; }); // always insensitive
@@ -421,38 +441,23 @@ void TextureBrowser::keyChanged()
     _originInvalid = true;
 }
 
-// Return the display width of a texture in the texture browser
-int TextureBrowser::getTextureWidth(const Texture& tex) const
+TextureBrowser::Vector2i TextureBrowser::getTileSize(const TextureThumbnailAtlas::Thumbnail* thumbnail) const
 {
-    if (tex.getWidth() >= tex.getHeight())
+    // Previews still loading in the background are shown as squares
+    if (!thumbnail || thumbnail->width == thumbnail->height)
     {
-        // Texture is square, or wider than it is tall
-        return _uniformTextureSize;
+        return Vector2i(_uniformTextureSize, _uniformTextureSize);
     }
-    else
-    {
-        // Otherwise, preserve the texture's aspect ratio
-        return static_cast<int>(_uniformTextureSize * 
-            (static_cast<float>(tex.getWidth()) / tex.getHeight())
-        );
-    }
-}
 
-int TextureBrowser::getTextureHeight(const Texture& tex) const
-{
-    if (tex.getHeight() >= tex.getWidth())
+    // Otherwise, preserve the texture's aspect ratio
+    if (thumbnail->width > thumbnail->height)
     {
-        // Texture is square, or taller than it is wide
-        return _uniformTextureSize;
-    }
-    else
-    {
-        // Otherwise, preserve the texture's aspect ratio
-        return static_cast<int>(
-            _uniformTextureSize
-            * (static_cast<float>(tex.getHeight()) / tex.getWidth())
-        );
+        return Vector2i(_uniformTextureSize, std::max(static_cast<int>(
+            _uniformTextureSize * (static_cast<float>(thumbnail->height) / thumbnail->width)), 1));
     }
+
+    return Vector2i(std::max(static_cast<int>(
+        _uniformTextureSize * (static_cast<float>(thumbnail->width) / thumbnail->height)), 1), _uniformTextureSize);
 }
 
 const std::string& TextureBrowser::getSelectedShader() const
@@ -471,55 +476,30 @@ void TextureBrowser::setSelectedShader(const std::string& newShader)
     focus(_shader);
 }
 
-// Data structure keeping track of the virtual position for the next texture to
-// be drawn in. Only the getPositionForTexture() method should access the values
-// in this structure.
-class TextureBrowser::CurrentPosition
+void TextureBrowser::updateLayout()
 {
-public:
+    // Every tile takes up the space of a square texture
+    _columnWidth = std::max(96, _uniformTextureSize) + 16;
+    _rowHeight = _uniformTextureSize + FONT_HEIGHT() + TILE_BORDER;
 
-    CurrentPosition()
-    : origin(VIEWPORT_BORDER, -VIEWPORT_BORDER), rowAdvance(0)
-    { }
+    // The first tile of a row is placed even if it doesn't fit
+    int availableWidth = _viewportSize.x() - 2 * VIEWPORT_BORDER - _uniformTextureSize;
+    _numColumns = availableWidth > 0 ? availableWidth / _columnWidth + 1 : 1;
 
-    Vector2i origin;
-    int rowAdvance;
-};
+    int numRows = static_cast<int>((_materials.size() + _numColumns - 1) / _numColumns);
+    _entireSpaceHeight = numRows > 0 ? VIEWPORT_BORDER + numRows * _rowHeight : 0;
+}
 
-TextureBrowser::Vector2i TextureBrowser::getPositionForTexture(
-    CurrentPosition& currentPos, const Texture& tex) const
+TextureBrowser::Vector2i TextureBrowser::getTilePosition(std::size_t index) const
 {
-    int nWidth = getTextureWidth(tex);
-    int nHeight = getTextureHeight(tex);
-
-    // Wrap to the next row if there is not enough horizontal space for this
-    // texture
-    if (currentPos.origin.x() + nWidth > _viewportSize.x() - VIEWPORT_BORDER
-        && currentPos.rowAdvance != 0)
-    {
-        currentPos.origin.x() = VIEWPORT_BORDER;
-        currentPos.origin.y() -= currentPos.rowAdvance + FONT_HEIGHT() + TILE_BORDER;
-        currentPos.rowAdvance = 0;
-    }
-
-    // Is our texture larger than the row? If so, grow the row height to match
-    // it
-    if (currentPos.rowAdvance < nHeight)
-    {
-        currentPos.rowAdvance = nHeight;
-    }
-
-    // Store the coordinates where the texture should be placed
-    Vector2i texPos = currentPos.origin;
+    int column = static_cast<int>(index % _numColumns);
+    int row = static_cast<int>(index / _numColumns);
 
-    // Advance the horizontal position for the next texture
-    currentPos.origin.x() += std::max(96, nWidth) + 16;
-
-    return texPos;
+    return Vector2i(VIEWPORT_BORDER + column * _columnWidth, -VIEWPORT_BORDER - row * _rowHeight);
 }
 
 // if texture_showinuse jump over non in-use textures
-bool TextureBrowser::materialIsVisible(const MaterialPtr& material)
+bool TextureBrowser::materialIsVisible(const MaterialPtr& material, const std::string& filter)
 {
     if (!material)
     {
@@ -536,7 +516,7 @@ bool TextureBrowser::materialIsVisible(const MaterialPtr& material)
         return false;
     }
 
-    if (!getFilter().empty())
+    if (!filter.empty())
     {
         std::string textureNameCache(material->getName());
         std::string textureName = shader_get_textureName(textureNameCache.c_str()); // can't use temporary material->getName() here
@@ -554,7 +534,7 @@ bool TextureBrowser::materialIsVisible(const MaterialPtr& material)
 		string::to_lower(textureName);
 
 		// case insensitive substring match
-		if (textureName.find(string::to_lower_copy(getFilter())) == std::string::npos)
+		if (textureName.find(filter) == std::string::npos)
 			return false;
     }
 
@@ -616,37 +596,21 @@ void TextureBrowser::performUpdate()
 
     _updateNeeded = false;
 
-    // Update all renderable items
-    _tiles.clear();
+    // Collect the visible materials, their tiles are created when drawing
+    _materials.clear();
 
-    CurrentPosition layout;
-    _entireSpaceHeight = 0;
+    auto filter = string::to_lower_copy(getFilter());
 
     GlobalMaterialManager().foreachMaterial([&](const MaterialPtr& mat)
     {
-        if (!materialIsVisible(mat))
+        if (materialIsVisible(mat, filter))
         {
-            return;
+            _materials.push_back(mat);
         }
-
-        // Create a new tile for this material
-        _tiles.push_back(TextureTile(*this));
-        TextureTile& tile = _tiles.back();
-
-        tile.material = mat;
-
-        Texture& texture = *tile.material->getEditorImage();
-
-        tile.position = getPositionForTexture(layout, texture);
-        tile.size.x() = getTextureWidth(texture);
-        tile.size.y() = getTextureHeight(texture);
-
-        _entireSpaceHeight = std::max(
-            _entireSpaceHeight,
-            abs(tile.position.y()) + FONT_HEIGHT() + tile.size.y() + TILE_BORDER
-        );
     });
 
+    updateLayout();
+
     updateScroll();
 }
 
@@ -662,23 +626,25 @@ void TextureBrowser::focus(const std::string& name)
         return;
     }
 
-    for (const TextureTile& tile : _tiles)
+    for (std::size_t i = 0; i < _materials.size(); ++i)
     {
         // we have found when texdef->name and the shader name match
         // NOTE: as everywhere else for our comparisons, we are not case sensitive
-        if (shader_equal(name, tile.material->getName()))
+        if (shader_equal(name, _materials[i]->getName()))
         {
+            auto position = getTilePosition(i);
+
             // scroll origin so the texture is completely on screen
             int originy = getOriginY();
 
-            if (tile.position.y() > originy)
+            if (position.y() > originy)
             {
-                originy = tile.position.y();
+                originy = position.y();
             }
 
-            if (tile.position.y() - tile.size.y() < originy - getViewportHeight())
+            if (position.y() - _uniformTextureSize < originy - getViewportHeight())
             {
-                originy = tile.position.y() - tile.size.y() + getViewportHeight();
+                originy = position.y() - _uniformTextureSize + getViewportHeight();
             }
 
             setOriginY(originy);
@@ -690,13 +656,27 @@ MaterialPtr TextureBrowser::getShaderAtCoords(int x, int y)
 {
     y += getOriginY() - _viewportSize.y();
 
-    for (const TextureTile& tile : _tiles)
+    // Look up the grid cell below the pointer
+    if (x < VIEWPORT_BORDER || y > -VIEWPORT_BORDER)
     {
-        if (x > tile.position.x() && x - tile.position.x() < tile.size.x() &&
-            y < tile.position.y() && tile.position.y() - y < tile.size.y() + FONT_HEIGHT())
-        {
-            return tile.material;
-        }
+        return MaterialPtr();
+    }
+
+    auto column = static_cast<std::size_t>((x - VIEWPORT_BORDER) / _columnWidth);
+    auto row = static_cast<std::size_t>((-VIEWPORT_BORDER - y) / _rowHeight);
+    auto index = row * _numColumns + column;
+
+    if (column >= static_cast<std::size_t>(_numColumns) || index >= _materials.size())
+    {
+        return MaterialPtr();
+    }
+
+    TextureTile tile(*this, index, false);
+
+    if (x > tile.position.x() && x - tile.position.x() < tile.size.x() &&
+        y < tile.position.y() && tile.position.y() - y < tile.size.y() + FONT_HEIGHT())
+    {
+        return tile.material;
     }
 
     return MaterialPtr();
@@ -725,6 +705,10 @@ void TextureBrowser::draw()
 		return;
 	}
 
+    // Copy the previews loaded in the background into the atlas
+    _thumbnails->setThumbnailSize(_uniformTextureSize);
+    _thumbnails->beginFrame();
+
 	glPushAttrib(GL_ALL_ATTRIB_BITS);
 
     debug::assertNoGlErrors();
@@ -750,11 +734,22 @@ void TextureBrowser::draw()
     glEnable (GL_TEXTURE_2D);
 	glPolygonMode (GL_FRONT_AND_BACK, GL_FILL);
 
-    for (TextureTile& tile : _tiles)
+    // Only the rows intersecting the viewport are drawn
+    int originY = getOriginY();
+    int firstRow = std::max((-originY - VIEWPORT_BORDER) / _rowHeight - 1, 0);
+    int lastRow = (-originY + _viewportSize.y() - VIEWPORT_BORDER) / _rowHeight + 1;
+
+    std::size_t firstTile = static_cast<std::size_t>(firstRow) * _numColumns;
+    std::size_t endTile = std::min(static_cast<std::size_t>(lastRow + 1) * _numColumns, _materials.size());
+
+    for (std::size_t i = firstTile; i < endTile; ++i)
     {
-        tile.render();
+        TextureTile(*this, i).render();
     }
 
+    // Load the previews requested by the tiles in one batch
+    _thumbnails->endFrame();
+
 	debug::assertNoGlErrors();
 
     // reset the current texture
@@ -8,6 +8,9 @@
 #include "wxutil/menu/PopupMenu.h"
 
 #include "TextureBrowserManager.h"
+#include "TextureThumbnailAtlas.h"
+#include <memory>
+#include <vector>
 #include <wx/panel.h>
 
 namespace wxutil
@@ -40,7 +43,10 @@ namespace
  * Widget for rendering active textures as tiles in a scrollable container.
  *
  * Uses an OpenGL widget to render a rectangular view into a "virtual space"
- * containing all active texture tiles.
+ * containing all active texture tiles. The tiles are arranged in a grid of
+ * uniform cells, such that the position of a tile follows from its index and
+ * only the visible rows need to be looked at. The tiles show small previews
+ * of the editor images, the full-size textures are not realised.
  */
 class TextureBrowser :
     public wxPanel,
@@ -49,8 +55,17 @@ class TextureBrowser :
     typedef BasicVector2<int> Vector2i;
 
     class TextureTile;
-    typedef std::list<TextureTile> TextureTiles;
-    TextureTiles _tiles;
+
+    // The materials shown in the browser, in the order of the tiles
+    std::vector<MaterialPtr> _materials;
+
+    // Previews of the editor images
+    std::unique_ptr<TextureThumbnailAtlas> _thumbnails;
+
+    // Layout of the grid, calculated by performUpdate()
+    int _columnWidth;
+    int _rowHeight;
+    int _numColumns;
 
     // Size of the 2D viewport. This is the geometry of the render window, not
     // the entire virtual space.
@@ -152,15 +167,14 @@ private:
     // This gets called by the ShaderSystem
     void onActiveShadersChanged();
 
-    // Return the display width/height of a texture in the texture browser
-    int getTextureWidth(const Texture& tex) const;
-    int getTextureHeight(const Texture& tex) const;
+    // Return the display size of a tile showing the given preview (which may be null)
+    Vector2i getTileSize(const TextureThumbnailAtlas::Thumbnail* thumbnail) const;
+
+    // Returns the virtual position of the tile with the given index
+    Vector2i getTilePosition(std::size_t index) const;
 
-    // Get a new position for the given texture, and advance the CurrentPosition
-    // state object.
-    class CurrentPosition;
-    Vector2i getPositionForTexture(CurrentPosition& layout,
-                                   const Texture& texture) const;
+    // Calculates the grid dimensions for the current viewport and tile count
+    void updateLayout();
 
     bool checkSeekInMediaBrowser(); // sensitivity check
     void onSeekInMediaBrowser();
@@ -220,9 +234,10 @@ private:
     void selectTextureAt(int mx, int my);
 
     /** greebo: Returns true if the given material is visible,
-     * taking filter and showUnused into account.
+     * taking filter and showUnused into account. The filter is
+     * expected in lowercase.
      */
-    bool materialIsVisible(const MaterialPtr& material);
+    bool materialIsVisible(const MaterialPtr& material, const std::string& filter);
 
 	// wx callbacks
     void onIdle(wxIdleEvent& ev);
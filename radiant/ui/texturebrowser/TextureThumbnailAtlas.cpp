@@ -0,0 +1,555 @@
+#include "TextureThumbnailAtlas.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "iimage.h"
+#include "imodule.h"
+#include "itextstream.h"
+#include "ImageKernels.h"
+#include "PixelBufferPool.h"
+#include "ThreadPool.h"
+#include "debugging/gl.h"
+#include "ui/UserInterfaceModule.h"
+
+namespace ui
+{
+
+namespace
+{
+    // Edge length of the atlas pages
+    const std::size_t PAGE_SIZE = 2048;
+
+    // Four pages of 16 MB, holding 1024 previews of 128x128 pixels
+    const std::size_t MAX_PAGES = 4;
+
+    const std::size_t MIN_CELL_SIZE = 32;
+    const std::size_t MAX_CELL_SIZE = 256;
+
+    // Time per frame spent uploading the previews
+    const std::chrono::milliseconds UPLOAD_BUDGET(4);
+
+    const char* const SHADER_NOT_FOUND = "notex.bmp";
+
+    // A preview loaded by the workers
+    struct ThumbnailResult
+    {
+        std::string name;
+        std::size_t generation = 0;
+
+        // Set if the material has been scrolled out of view in the meantime
+        bool skipped = false;
+
+        // The scaled down RGBA pixels
+        std::vector<byte> pixels;
+        std::size_t width = 0;
+        std::size_t height = 0;
+
+        // Compressed images are scaled down on the GL thread
+        ImagePtr precompressed;
+    };
+
+    // Scales the RGBA image down to fit into size x size pixels, keeping the
+    // aspect ratio. Smaller images are copied as they are.
+    void scaleDown(const byte* pixels, std::size_t width, std::size_t height, std::size_t size,
+        std::vector<byte>& result, std::size_t& resultWidth, std::size_t& resultHeight)
+    {
+        resultWidth = width;
+        resultHeight = height;
+
+        if (width > size || height > size)
+        {
+            resultWidth = width >= height ? size : std::max<std::size_t>(width * size / height, 1);
+            resultHeight = height >= width ? size : std::max<std::size_t>(height * size / width, 1);
+        }
+
+        // Box filter the image down to less than twice the preview size first,
+        // the bilinear resampling would skip most of the pixels otherwise
+        std::unique_ptr<image::PixelBuffer> buffer;
+        const byte* source = pixels;
+
+        while (width >= resultWidth * 2 || height >= resultHeight * 2)
+        {
+            std::size_t reducedWidth = width >= resultWidth * 2 ? width / 2 : width;
+            std::size_t reducedHeight = height >= resultHeight * 2 ? height / 2 : height;
+
+            if (!buffer)
+            {
+                buffer.reset(new image::PixelBuffer(reducedWidth * reducedHeight * 4));
+            }
+
+            image::mipReduce(source, buffer->data(), width, height, reducedWidth, reducedHeight);
+
+            source = buffer->data();
+            width = reducedWidth;
+            height = reducedHeight;
+        }
+
+        result.resize(resultWidth * resultHeight * 4);
+
+        if (width == resultWidth && height == resultHeight)
+        {
+            std::copy(source, source + result.size(), result.begin());
+        }
+        else
+        {
+            image::resample(source, width, height, result.data(), resultWidth, resultHeight, 4);
+        }
+    }
+
+    // Uploads the compressed image to a temporary texture and reads back
+    // the smallest mipmap which is at least as large as the preview
+    void scaleDownPrecompressed(const ImagePtr& image, const std::string& name, std::size_t size,
+        std::vector<byte>& result, std::size_t& resultWidth, std::size_t& resultHeight)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+
+        if (!image->uploadTexture(texture, name))
+        {
+            glDeleteTextures(1, &texture);
+            return;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, texture);
+
+        GLint level = 0;
+        GLint width = 0;
+        GLint height = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+
+        while (width > static_cast<GLint>(size) || height > static_cast<GLint>(size))
+        {
+            GLint nextWidth = 0;
+            GLint nextHeight = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level + 1, GL_TEXTURE_WIDTH, &nextWidth);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level + 1, GL_TEXTURE_HEIGHT, &nextHeight);
+
+            if (nextWidth <= 0 || nextHeight <= 0 ||
+                (nextWidth < static_cast<GLint>(size) && nextHeight < static_cast<GLint>(size)))
+            {
+                break;
+            }
+
+            ++level;
+            width = nextWidth;
+            height = nextHeight;
+        }
+
+        if (width > 0 && height > 0)
+        {
+            std::vector<byte> pixels(static_cast<std::size_t>(width) * height * 4);
+            glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+            scaleDown(pixels.data(), width, height, size, result, resultWidth, resultHeight);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDeleteTextures(1, &texture);
+    }
+}
+
+// State shared with the worker jobs
+struct TextureThumbnailAtlas::SharedState
+{
+    std::mutex mutex;
+
+    // Loaded previews waiting to be uploaded
+    std::vector<ThumbnailResult> results;
+
+    // True if a redraw has been requested since the results have all been uploaded
+    bool notified = false;
+
+    // Set on destruction, the queued jobs are skipped from then on
+    std::atomic<bool> cancelled = { false };
+
+    // Jobs queued on the thread pool which have not finished yet, guarded by the mutex
+    std::size_t pendingJobs = 0;
+    std::condition_variable jobsDone;
+
+    // The frame number of the atlas, read by the workers
+    std::atomic<std::size_t> frame = { 0 };
+
+    // Only accessed on the UI thread
+    std::function<void()> requestRedraw;
+};
+
+namespace
+{
+    void dispatchRedraw(const std::shared_ptr<TextureThumbnailAtlas::SharedState>& state)
+    {
+        std::weak_ptr<TextureThumbnailAtlas::SharedState> weakState(state);
+
+        GetUserInterfaceModule().dispatch([weakState]()
+        {
+            auto state = weakState.lock();
+
+            if (state && state->requestRedraw)
+            {
+                state->requestRedraw();
+            }
+        });
+    }
+}
+
+TextureThumbnailAtlas::TextureThumbnailAtlas(const std::function<void()>& requestRedraw) :
+    _state(std::make_shared<SharedState>()),
+    _cellSize(0),
+    _frame(0),
+    _generation(0)
+{
+    _state->requestRedraw = requestRedraw;
+
+    _contextDestroyed = GlobalOpenGLContext().signal_sharedContextDestroyed().connect(
+        sigc::mem_fun(*this, &TextureThumbnailAtlas::onSharedContextDestroyed));
+}
+
+TextureThumbnailAtlas::~TextureThumbnailAtlas()
+{
+    _contextDestroyed.disconnect();
+
+    _state->cancelled = true;
+    _state->requestRedraw = nullptr;
+
+    // Wait for the running jobs, the queued ones return right away
+    std::unique_lock<std::mutex> lock(_state->mutex);
+    _state->jobsDone.wait(lock, [this]() { return _state->pendingJobs == 0; });
+
+    // No GL context might be current at this point, the atlas pages are left to
+    // the shared context, which is releasing them once the last GL view is gone
+}
+
+void TextureThumbnailAtlas::setThumbnailSize(std::size_t size)
+{
+    std::size_t cellSize = MIN_CELL_SIZE;
+
+    while (cellSize < size && cellSize < MAX_CELL_SIZE)
+    {
+        cellSize *= 2;
+    }
+
+    if (cellSize != _cellSize)
+    {
+        clear();
+        _cellSize = cellSize;
+    }
+}
+
+void TextureThumbnailAtlas::clear()
+{
+    if (!_pages.empty())
+    {
+        glDeleteTextures(static_cast<GLsizei>(_pages.size()), _pages.data());
+    }
+
+    discardEntries();
+}
+
+void TextureThumbnailAtlas::onSharedContextDestroyed()
+{
+    // The texture names are invalid now, they must not be deleted in a new context
+    discardEntries();
+}
+
+void TextureThumbnailAtlas::discardEntries()
+{
+    ++_generation;
+
+    _entries.clear();
+    _requests.clear();
+    _freeCells.clear();
+    _pages.clear();
+}
+
+void TextureThumbnailAtlas::beginFrame()
+{
+    _state->frame = ++_frame;
+
+    std::vector<ThumbnailResult> results;
+
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        results.swap(_state->results);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::size_t numProcessed = 0;
+
+    // Process at least one preview per frame, even if it exceeds the budget
+    while (numProcessed < results.size() &&
+        (numProcessed == 0 || std::chrono::steady_clock::now() - start < UPLOAD_BUDGET))
+    {
+        auto& result = results[numProcessed++];
+        auto found = _entries.find(result.name);
+
+        if (result.generation != _generation || found == _entries.end() || found->second.ready)
+        {
+            continue; // outdated
+        }
+
+        if (result.skipped)
+        {
+            // Requested again when the material is scrolled into view
+            _entries.erase(found);
+            continue;
+        }
+
+        if (result.precompressed)
+        {
+            scaleDownPrecompressed(result.precompressed, result.name, _cellSize,
+                result.pixels, result.width, result.height);
+        }
+
+        if (result.pixels.empty())
+        {
+            // Show a grey tile for images which can't be loaded at all
+            result.pixels.assign({ 128, 128, 128, 255 });
+            result.width = result.height = 1;
+        }
+
+        if (!uploadThumbnail(found->second, result.pixels.data(), result.width, result.height))
+        {
+            // All cells are in use, try again when scrolling
+            _entries.erase(found);
+        }
+    }
+
+    bool morePending = false;
+
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+
+        // The remaining ones go first in the next frame
+        _state->results.insert(_state->results.begin(),
+            std::make_move_iterator(results.begin() + numProcessed), std::make_move_iterator(results.end()));
+
+        morePending = !_state->results.empty();
+
+        if (!morePending)
+        {
+            // Let the workers request a redraw for the next preview
+            _state->notified = false;
+        }
+    }
+
+    if (morePending)
+    {
+        // Request another frame to continue the upload
+        dispatchRedraw(_state);
+    }
+}
+
+const TextureThumbnailAtlas::Thumbnail* TextureThumbnailAtlas::getThumbnail(const MaterialPtr& material)
+{
+    auto name = material->getName();
+    auto found = _entries.find(name);
+
+    if (found != _entries.end())
+    {
+        *found->second.lastUsed = _frame;
+        return found->second.ready ? &found->second.thumbnail : nullptr;
+    }
+
+    auto& entry = _entries[name];
+    entry.lastUsed = std::make_shared<std::atomic<std::size_t>>(_frame);
+
+    _requests.push_back(Request{ name, material->getEditorImageLoader(), entry.lastUsed });
+
+    return nullptr;
+}
+
+const TextureThumbnailAtlas::Thumbnail* TextureThumbnailAtlas::findThumbnail(const MaterialPtr& material) const
+{
+    auto found = _entries.find(material->getName());
+
+    return found != _entries.end() && found->second.ready ? &found->second.thumbnail : nullptr;
+}
+
+void TextureThumbnailAtlas::endFrame()
+{
+    if (_requests.empty())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        _state->pendingJobs += _requests.size();
+    }
+
+    // Each image is a task of its own, the shared pool is decoding them concurrently
+    for (auto& request : _requests)
+    {
+        util::ThreadPool::GetShared().enqueue(
+            [state = _state, request = std::move(request), generation = _generation, size = _cellSize]()
+        {
+            ThumbnailResult result;
+            result.name = request.name;
+            result.generation = generation;
+
+            // Skip the materials which have not been drawn in the last frames
+            if (state->cancelled || state->frame > *request.lastUsed + 1)
+            {
+                result.skipped = true;
+            }
+            else
+            {
+                ImagePtr image;
+
+                try
+                {
+                    image = request.loader();
+                }
+                catch (const std::exception& ex)
+                {
+                    rError() << "[TextureBrowser] Exception loading texture " << request.name << ": " << ex.what() << std::endl;
+                }
+
+                if (!image)
+                {
+                    image = GlobalImageLoader().imageFromFile(
+                        module::GlobalModuleRegistry().getApplicationContext().getBitmapsPath() + SHADER_NOT_FOUND);
+                }
+
+                if (image && image->isPrecompressed())
+                {
+                    result.precompressed = image;
+                }
+                else if (image)
+                {
+                    scaleDown(image->getPixels(), image->getWidth(), image->getHeight(), size,
+                        result.pixels, result.width, result.height);
+                }
+            }
+
+            bool notify = false;
+
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+
+                if (!state->cancelled)
+                {
+                    state->results.push_back(std::move(result));
+
+                    notify = !state->notified;
+                    state->notified = true;
+                }
+
+                if (--state->pendingJobs == 0)
+                {
+                    state->jobsDone.notify_all();
+                }
+            }
+
+            if (notify)
+            {
+                dispatchRedraw(state);
+            }
+        });
+    }
+
+    _requests.clear();
+}
+
+bool TextureThumbnailAtlas::allocateCell(std::size_t& cell)
+{
+    if (_freeCells.empty() && _pages.size() < MAX_PAGES)
+    {
+        GLuint page;
+        glGenTextures(1, &page);
+        glBindTexture(GL_TEXTURE_2D, page);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(PAGE_SIZE), static_cast<GLsizei>(PAGE_SIZE),
+            0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        std::size_t cellsPerPage = (PAGE_SIZE / _cellSize) * (PAGE_SIZE / _cellSize);
+        std::size_t firstCell = _pages.size() * cellsPerPage;
+
+        _pages.push_back(page);
+
+        // The lower cells are handed out first
+        for (std::size_t i = cellsPerPage; i > 0; --i)
+        {
+            _freeCells.push_back(firstCell + i - 1);
+        }
+    }
+
+    if (_freeCells.empty())
+    {
+        // Evict the least recently drawn preview, unless it's visible in this frame
+        auto leastRecentlyUsed = _entries.end();
+
+        for (auto i = _entries.begin(); i != _entries.end(); ++i)
+        {
+            if (i->second.ready && *i->second.lastUsed < _frame &&
+                (leastRecentlyUsed == _entries.end() || *i->second.lastUsed < *leastRecentlyUsed->second.lastUsed))
+            {
+                leastRecentlyUsed = i;
+            }
+        }
+
+        if (leastRecentlyUsed == _entries.end())
+        {
+            return false;
+        }
+
+        _freeCells.push_back(leastRecentlyUsed->second.cell);
+        _entries.erase(leastRecentlyUsed);
+    }
+
+    cell = _freeCells.back();
+    _freeCells.pop_back();
+
+    return true;
+}
+
+bool TextureThumbnailAtlas::uploadThumbnail(Entry& entry, const byte* pixels, std::size_t width, std::size_t height)
+{
+    std::size_t cell;
+
+    if (!allocateCell(cell))
+    {
+        return false;
+    }
+
+    std::size_t cellsPerRow = PAGE_SIZE / _cellSize;
+    std::size_t cellsPerPage = cellsPerRow * cellsPerRow;
+
+    GLuint page = _pages[cell / cellsPerPage];
+    std::size_t x = (cell % cellsPerPage) % cellsPerRow * _cellSize;
+    std::size_t y = (cell % cellsPerPage) / cellsPerRow * _cellSize;
+
+    glBindTexture(GL_TEXTURE_2D, page);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(x), static_cast<GLint>(y),
+        static_cast<GLsizei>(width), static_cast<GLsizei>(height), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    debug::assertNoGlErrors();
+
+    entry.ready = true;
+    entry.cell = cell;
+
+    // Inset by half a texel, the linear filtering must not pick up the neighbours
+    auto& thumbnail = entry.thumbnail;
+    thumbnail.texture = page;
+    thumbnail.s0 = (x + 0.5f) / PAGE_SIZE;
+    thumbnail.t0 = (y + 0.5f) / PAGE_SIZE;
+    thumbnail.s1 = (x + width - 0.5f) / PAGE_SIZE;
+    thumbnail.t1 = (y + height - 0.5f) / PAGE_SIZE;
+    thumbnail.width = width;
+    thumbnail.height = height;
+
+    return true;
+}
+
+} // namespace ui
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sigc++/connection.h>
+
+#include "igl.h"
+#include "ishaders.h"
+
+namespace ui
+{
+
+/**
+ * Small previews of the material editor images, packed into a few large
+ * atlas textures.
+ *
+ * The editor images are loaded and scaled down on the shared thread pool,
+ * without creating their full-size GL textures. The previews requested in a
+ * frame are queued after drawing it and decoded concurrently. The previews are
+ * copied into the free cells of the atlas pages on the GL thread, once all
+ * cells are taken the least recently drawn previews are evicted. Materials
+ * scrolled out of view before their image has been loaded are skipped by the
+ * workers.
+ *
+ * The atlas pages live in the shared GL context and are released with it.
+ */
+class TextureThumbnailAtlas
+{
+public:
+    struct Thumbnail
+    {
+        // The atlas page and the texture coordinates of the preview
+        GLuint texture = 0;
+        float s0 = 0, t0 = 0, s1 = 0, t1 = 0;
+
+        // Size of the scaled down image, at most the thumbnail size
+        std::size_t width = 0;
+        std::size_t height = 0;
+    };
+
+    struct SharedState;
+
+private:
+    std::shared_ptr<SharedState> _state;
+
+    sigc::connection _contextDestroyed;
+
+    // Edge length of the atlas cells, a power of two
+    std::size_t _cellSize;
+
+    std::vector<GLuint> _pages;
+    std::vector<std::size_t> _freeCells;
+
+    struct Entry
+    {
+        bool ready = false;
+        std::size_t cell = 0;
+        Thumbnail thumbnail;
+
+        // The frame the preview has last been requested in, read by the workers
+        std::shared_ptr<std::atomic<std::size_t>> lastUsed;
+    };
+    std::map<std::string, Entry> _entries;
+
+    // Previews requested since the last endFrame() call
+    struct Request
+    {
+        std::string name;
+        std::function<ImagePtr()> loader;
+        std::shared_ptr<std::atomic<std::size_t>> lastUsed;
+    };
+    std::vector<Request> _requests;
+
+    // Incremented by beginFrame()
+    std::size_t _frame;
+
+    // Incremented by clear(), results of earlier requests are discarded
+    std::size_t _generation;
+
+public:
+    // The given function is invoked on the UI thread when loaded previews are
+    // waiting to be uploaded, it should trigger a redraw
+    TextureThumbnailAtlas(const std::function<void()>& requestRedraw);
+    ~TextureThumbnailAtlas();
+
+    // Sets the maximum size of the previews (in pixels), clears the atlas if the
+    // cell size changes. Needs the GL context.
+    void setThumbnailSize(std::size_t size);
+
+    // Uploads the previews loaded since the last frame, within a time budget.
+    // To be called before drawing the previews, needs the GL context.
+    void beginFrame();
+
+    // Returns the preview of the given material, or nullptr if it's not loaded
+    // yet, requesting the load if necessary. Marks the preview as being in use.
+    const Thumbnail* getThumbnail(const MaterialPtr& material);
+
+    // Returns the preview of the given material if it has been loaded already,
+    // without requesting it or marking it as being in use
+    const Thumbnail* findThumbnail(const MaterialPtr& material) const;
+
+    // Queues the loads requested since the last call, to be called after
+    // drawing the previews
+    void endFrame();
+
+    // Releases all previews and the atlas textures, needs the GL context
+    void clear();
+
+private:
+    // Forgets the previews and the atlas textures, which are gone with the shared context
+    void onSharedContextDestroyed();
+
+    void discardEntries();
+    bool allocateCell(std::size_t& cell);
+    bool uploadThumbnail(Entry& entry, const unsigned char* pixels, std::size_t width, std::size_t height);
+};
+
+} // namespace ui
@@ -10,6 +10,7 @@
 #include "igrid.h"
 #include "iregion.h"
 #include "iuimanager.h"
+#include "irenderprofiler.h"
 
 #include "wxutil/MouseButton.h"
 #include "wxutil/GLWidget.h"
@@ -1350,6 +1351,9 @@ void XYWnd::draw()
     }
 
     {
+        render::IRenderProfiler& profiler = GlobalRenderSystem().getProfiler();
+        profiler.beginFrame("Ortho view");
+
         // Construct the renderer and render the scene
         XYRenderer renderer(flagsMask, _selectedShader.get(), _selectedShaderGroup.get());
 
@@ -1366,6 +1370,8 @@ void XYWnd::draw()
 
         // Second pass (GL calls)
         renderer.render(_modelView, _projection);
+
+        profiler.endFrame();
     }
 
     glDepthMask(GL_FALSE);
@@ -482,8 +482,12 @@ void Brush::onFaceShaderChanged()
     // When the face shader changes, no geometry change is happening
     // therefore no call to onFacePlaneChanged() is necessary
 
-    // Queue an UI update of the texture tools if any of them is listening
-	signal_faceShaderChanged().emit();
+    // Queue an UI update of the texture tools if any of them is listening,
+    // brushes which are not in the scene yet are of no interest to them
+    if (_owner.inScene())
+    {
+        signal_faceShaderChanged().emit();
+    }
 }
 
 void Brush::onFaceConnectivityChanged()
@@ -1151,6 +1155,11 @@ bool Brush::buildWindings() {
         verifyConnectivityGraph();
     }
 
+    // The cleanups above might have altered any winding
+    for (const FacePtr& face : m_faces) {
+        face->getWindingRenderable().queueUpdate();
+    }
+
     return degenerate;
 }
 
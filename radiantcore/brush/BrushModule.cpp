@@ -10,6 +10,7 @@
 #include "brush/BrushNode.h"
 #include "brush/BrushClipPlane.h"
 #include "brush/BrushVisit.h"
+#include "brush/TextureProjection.h"
 #include "gamelib.h"
 
 #include "registry/registry.h"
@@ -31,7 +32,7 @@ void BrushModuleImpl::constructPreferences()
 
 	// Add the default texture scale preference and connect it to the according registryKey
 	// Note: this should be moved somewhere else, I think
-	page.appendEntry(_("Default texture scale"), "user/ui/textures/defaultTextureScale");
+	page.appendEntry(_("Default texture scale"), RKEY_DEFAULT_TEXTURE_SCALE);
 
 	// The checkbox to enable/disable the texture lock option
 	page.appendCheckBox(_("Enable Texture Lock (for Brushes)"), "user/ui/brush/textureLock");
@@ -54,6 +55,11 @@ void BrushModuleImpl::keyChanged()
 	_textureLockEnabled = registry::getValue<bool>(RKEY_ENABLE_TEXTURE_LOCK);
 }
 
+void BrushModuleImpl::defaultTextureScaleChanged()
+{
+	TextureProjection::SetDefaultTextureScale(registry::getValue<double>(RKEY_DEFAULT_TEXTURE_SCALE));
+}
+
 bool BrushModuleImpl::textureLockEnabled() const {
 	return _textureLockEnabled;
 }
@@ -71,13 +77,16 @@ void BrushModuleImpl::toggleTextureLock() {
 
 scene::INodePtr BrushModuleImpl::createBrush()
 {
-	scene::INodePtr node = std::make_shared<BrushNode>();
+	// All brushes are created in the active layer by default
+	auto root = GlobalMapModule().getRoot();
 
-	if (GlobalMapModule().getRoot())
-	{
-		// All brushes are created in the active layer by default
-		node->moveToLayer(GlobalMapModule().getRoot()->getLayerManager().getActiveLayer());
-	}
+	return createBrush(root ? root->getLayerManager().getActiveLayer() : 0);
+}
+
+scene::INodePtr BrushModuleImpl::createBrush(int layer)
+{
+	scene::INodePtr node = std::make_shared<BrushNode>();
+	node->moveToLayer(layer);
 
 	return node;
 }
@@ -119,6 +128,14 @@ void BrushModuleImpl::initialiseModule(const IApplicationContext& ctx) {
 		sigc::mem_fun(this, &BrushModuleImpl::keyChanged)
 	);
 
+	// Brushes are also constructed by the map parsers' worker threads, these
+	// must not access the registry
+	defaultTextureScaleChanged();
+
+	GlobalRegistry().signalForKey(RKEY_DEFAULT_TEXTURE_SCALE).connect(
+		sigc::mem_fun(this, &BrushModuleImpl::defaultTextureScaleChanged)
+	);
+
 	// add the preference settings
 	constructPreferences();
 
@@ -25,6 +25,7 @@ private:
 
 private:
 	void keyChanged();
+	void defaultTextureScaleChanged();
 
 	void registerBrushCommands();
 
@@ -45,6 +46,7 @@ public:
 
 	// Creates a new brush node on the heap and returns it
 	scene::INodePtr createBrush() override;
+	scene::INodePtr createBrush(int layer) override;
 
 	IBrushSettings& getSettings() override;
 
@@ -436,9 +436,13 @@ void BrushNode::renderSolid(RenderableCollector& collector,
             if (highlight)
                 collector.setHighlightFlag(RenderableCollector::Highlight::Faces, true);
 
+            // Copy changed windings to the retained geometry before submission
+            const RenderableWinding& winding = face.getWindingRenderable();
+            winding.update();
+
             // greebo: BrushNodes have always an identity l2w, don't do any transforms
             collector.addRenderable(
-                *face.getFaceShader().getGLShader(), face.getWinding(),
+                *face.getFaceShader().getGLShader(), winding,
                 Matrix4::getIdentity(), this, _renderEntity
             );
 
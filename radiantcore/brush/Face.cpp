@@ -40,6 +40,7 @@ public:
 Face::Face(Brush& owner) :
     _owner(owner),
     _shader(texdef_name_default(), _owner.getBrushNode().getRenderSystem()),
+    _windingRenderable(m_winding, _owner.getBrushNode().getRenderSystem()),
     _undoStateSaver(nullptr),
     _faceIsVisible(true)
 {
@@ -63,6 +64,7 @@ Face::Face(
     _owner(owner),
     _shader(shader, _owner.getBrushNode().getRenderSystem()),
     _texdef(projection),
+    _windingRenderable(m_winding, _owner.getBrushNode().getRenderSystem()),
     _undoStateSaver(nullptr),
     _faceIsVisible(true)
 {
@@ -75,6 +77,7 @@ Face::Face(
 Face::Face(Brush& owner, const Plane3& plane) :
     _owner(owner),
     _shader("", _owner.getBrushNode().getRenderSystem()),
+    _windingRenderable(m_winding, _owner.getBrushNode().getRenderSystem()),
     _undoStateSaver(nullptr),
     _faceIsVisible(true)
 {
@@ -88,6 +91,7 @@ Face::Face(Brush& owner, const Plane3& plane, const Matrix4& texdef,
            const std::string& shader) :
     _owner(owner),
     _shader(shader, _owner.getBrushNode().getRenderSystem()),
+    _windingRenderable(m_winding, _owner.getBrushNode().getRenderSystem()),
     _undoStateSaver(nullptr),
     _faceIsVisible(true)
 {
@@ -107,6 +111,7 @@ Face::Face(Brush& owner, const Face& other) :
     m_plane(other.m_plane),
     _shader(other._shader.getMaterialName(), _owner.getBrushNode().getRenderSystem()),
     _texdef(other.getProjection()),
+    _windingRenderable(m_winding, _owner.getBrushNode().getRenderSystem()),
     _undoStateSaver(nullptr),
     _faceIsVisible(other._faceIsVisible)
 {
@@ -234,6 +239,7 @@ void Face::renderWireframe(RenderableCollector& collector, const Matrix4& localT
 void Face::setRenderSystem(const RenderSystemPtr& renderSystem)
 {
     _shader.setRenderSystem(renderSystem);
+    _windingRenderable.setRenderSystem(renderSystem);
 
     // Update the visibility flag, we might have switched shaders
     const ShaderPtr& shader = _shader.getGLShader();
@@ -302,6 +308,7 @@ void Face::freezeTransform() {
 
 void Face::updateWinding() {
     m_winding.updateNormals(m_plane.getPlane().normal());
+    _windingRenderable.queueUpdate();
 }
 
 void Face::update_move_planepts_vertex(std::size_t index, PlanePoints planePoints) {
@@ -359,7 +366,13 @@ void Face::shaderChanged()
     }
 
     planeChanged();
-    SceneChangeNotify();
+
+    // Brushes outside the scene (e.g. while being parsed by a map loader
+    // worker thread) must not touch the global scenegraph
+    if (_owner.getBrushNode().inScene())
+    {
+        SceneChangeNotify();
+    }
 }
 
 const std::string& Face::getShader() const
@@ -385,7 +398,10 @@ void Face::texdefChanged()
     EmitTextureCoordinates();
 
     // Fire the signal to update the Texture Tools
-    signal_texdefChanged().emit();
+    if (_owner.getBrushNode().inScene())
+    {
+        signal_texdefChanged().emit();
+    }
 }
 
 const TextureProjection& Face::getProjection() const
@@ -552,6 +568,7 @@ void Face::alignTexture(AlignEdge align)
 
 void Face::EmitTextureCoordinates() {
     m_texdefTransformed.emitTextureCoordinates(m_winding, plane3().normal(), Matrix4::getIdentity());
+    _windingRenderable.queueUpdate();
 }
 
 void Face::applyDefaultTextureScale()
@@ -576,6 +593,14 @@ Winding& Face::getWinding() {
     return m_winding;
 }
 
+const RenderableWinding& Face::getWindingRenderable() const {
+    return _windingRenderable;
+}
+
+RenderableWinding& Face::getWindingRenderable() {
+    return _windingRenderable;
+}
+
 const Plane3& Face::plane3() const
 {
     _owner.onFaceEvaluateTransform();
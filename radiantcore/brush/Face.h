@@ -12,6 +12,7 @@
 #include "SurfaceShader.h"
 #include "PlanePoints.h"
 #include "FacePlane.h"
+#include "RenderableWinding.h"
 #include <memory>
 #include "util/Noncopyable.h"
 #include <sigc++/signal.h>
@@ -56,6 +57,9 @@ private:
 	Winding m_winding;
 	Vector3 m_centroid;
 
+	// Renders the winding from the retained geometry of the render system
+	RenderableWinding _windingRenderable;
+
 	IUndoStateSaver* _undoStateSaver;
 
 	// Cached visibility flag, queried during front end rendering
@@ -184,6 +188,10 @@ public:
 	const Winding& getWinding() const;
 	Winding& getWinding();
 
+	// The renderable submitted to the face shader
+	const RenderableWinding& getWindingRenderable() const;
+	RenderableWinding& getWindingRenderable();
+
 	const Plane3& plane3() const;
 
 	// Returns the Doom 3 plane
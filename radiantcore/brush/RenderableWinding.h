@@ -0,0 +1,82 @@
+#pragma once
+
+#include "irender.h"
+#include "render/RetainedGeometry.h"
+#include "Winding.h"
+
+/**
+ * Renders the polygon of a face winding from the geometry store of the
+ * render system. The winding is triangulated as fan and only copied to the
+ * store after it has been changed.
+ */
+class RenderableWinding :
+	public OpenGLRenderable
+{
+	const Winding& _winding;
+
+	mutable render::RetainedGeometry _geometry;
+
+public:
+	RenderableWinding(const Winding& winding, const RenderSystemPtr& renderSystem) :
+		_winding(winding)
+	{
+		_geometry.setRenderSystem(renderSystem);
+	}
+
+	void setRenderSystem(const RenderSystemPtr& renderSystem)
+	{
+		_geometry.setRenderSystem(renderSystem);
+	}
+
+	// Called when the winding has been changed
+	void queueUpdate()
+	{
+		_geometry.queueUpdate();
+	}
+
+	// Copies the winding to the geometry store, if it has been changed
+	void update() const
+	{
+		if (!_geometry.needsUpdate()) return;
+
+		std::vector<ArbitraryMeshVertex> vertices;
+		std::vector<unsigned int> indices;
+
+		if (_winding.size() >= 3)
+		{
+			vertices.reserve(_winding.size());
+
+			for (const WindingVertex& v : _winding)
+			{
+				ArbitraryMeshVertex vertex(v.vertex, v.normal, TexCoord2f(v.texcoord));
+				vertex.tangent = v.tangent;
+				vertex.bitangent = v.bitangent;
+
+				vertices.push_back(vertex);
+			}
+
+			indices.reserve((_winding.size() - 2) * 3);
+
+			for (unsigned int i = 1; i + 1 < _winding.size(); ++i)
+			{
+				indices.push_back(0);
+				indices.push_back(i);
+				indices.push_back(i + 1);
+			}
+		}
+
+		_geometry.update(vertices, indices);
+	}
+
+	// Used as long as the winding has not been copied to the store, and for
+	// outlines which must not show the triangle edges
+	void render(const RenderInfo& info) const override
+	{
+		_winding.render(info);
+	}
+
+	bool getStorageLocation(const render::IGeometryStore*& store, std::size_t& slot) const override
+	{
+		return _geometry.getStorageLocation(store, slot);
+	}
+};
@@ -1,10 +1,16 @@
 #include "TextureProjection.h"
 
-#include "registry/CachedKey.h"
 #include "texturelib.h"
 #include "itextstream.h"
+#include <atomic>
 #include <limits>
 
+namespace
+{
+    // The value of RKEY_DEFAULT_TEXTURE_SCALE, set by the brush module
+    std::atomic<double> _defaultTextureScale(0.5);
+}
+
 TextureProjection::TextureProjection() :
     TextureProjection(GetDefaultProjection())
 {}
@@ -19,19 +25,19 @@ TextureProjection::TextureProjection(const TextureMatrix& otherMatrix) :
 
 TextureMatrix TextureProjection::GetDefaultProjection()
 {
-    // Cache the registry key because this constructor is called a lot
-    static registry::CachedKey<float> scaleKey(
-        "user/ui/textures/defaultTextureScale"
-    );
-
     TexDef tempTexDef;
 
-    double scale = scaleKey.get();
+    double scale = _defaultTextureScale;
     tempTexDef.setScale(Vector2(scale, scale));
 
     return TextureMatrix(tempTexDef);
 }
 
+void TextureProjection::SetDefaultTextureScale(double scale)
+{
+    _defaultTextureScale = scale;
+}
+
 // Assigns an <other> projection to this one
 void TextureProjection::assign(const TextureProjection& other)
 {
@@ -33,6 +33,11 @@ public:
 
     static TextureMatrix GetDefaultProjection();
 
+    // Sets the scale of the default projection. The brush module keeps it in sync
+    // with the registry on the main thread, brushes constructed by the map
+    // parsers' worker threads must not access the registry.
+    static void SetDefaultTextureScale(double scale);
+
     void assign(const TextureProjection& other);
 
     void setTransform(double width, double height, const Matrix4& transform);
@@ -0,0 +1,43 @@
+#include "DeclarationScheduler.h"
+
+#include "itextstream.h"
+#include "module/StaticModule.h"
+#include "ThreadPool.h"
+
+namespace decl
+{
+
+void DeclarationScheduler::parallelFor(std::size_t count, const std::function<void(std::size_t)>& function)
+{
+	// The files are parsed on the pool shared with the other parallel loops of the core
+	util::ThreadPool::GetShared().parallelFor(count, function);
+}
+
+void DeclarationScheduler::reportLoadingTime(const std::string& managerName, std::size_t numFiles,
+	std::chrono::milliseconds parseTime, std::chrono::milliseconds mergeTime)
+{
+	rMessage() << "[decls] " << managerName << ": " << numFiles << " files parsed in " <<
+		parseTime.count() << " msec, merged in " << mergeTime.count() << " msec" << std::endl;
+}
+
+const std::string& DeclarationScheduler::getName() const
+{
+	static std::string _name(MODULE_DECLARATION_SCHEDULER);
+	return _name;
+}
+
+const StringSet& DeclarationScheduler::getDependencies() const
+{
+	static StringSet _dependencies;
+	return _dependencies;
+}
+
+void DeclarationScheduler::initialiseModule(const IApplicationContext& ctx)
+{
+	rMessage() << getName() << "::initialiseModule called" << std::endl;
+}
+
+// Static module instance
+module::StaticModule<DeclarationScheduler> declarationSchedulerModule;
+
+}
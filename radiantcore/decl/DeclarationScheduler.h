@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ideclscheduler.h"
+
+namespace decl
+{
+
+class DeclarationScheduler :
+	public IDeclarationScheduler
+{
+public:
+	void parallelFor(std::size_t count, const std::function<void(std::size_t)>& function) override;
+
+	void reportLoadingTime(const std::string& managerName, std::size_t numFiles,
+		std::chrono::milliseconds parseTime, std::chrono::milliseconds mergeTime) override;
+
+	// RegisterableModule implementation
+	const std::string& getName() const override;
+	const StringSet& getDependencies() const override;
+	void initialiseModule(const IApplicationContext& ctx) override;
+};
+
+}
@@ -617,4 +617,23 @@ void Doom3EntityClass::parseFromTokens(parser::DefTokeniser& tokeniser)
     _changedSignal.emit();
 }
 
+void Doom3EntityClass::takeParsedContents(Doom3EntityClass& parsed)
+{
+    _isLight = parsed._isLight;
+    _colour = parsed._colour;
+    _colourTransparent = parsed._colourTransparent;
+    _fillShader = std::move(parsed._fillShader);
+    _wireShader = std::move(parsed._wireShader);
+    _fixedSize = parsed._fixedSize;
+    _attributes = std::move(parsed._attributes);
+    _model = std::move(parsed._model);
+    _skin = std::move(parsed._skin);
+    _inheritanceResolved = false;
+    _modName = std::move(parsed._modName);
+    _attachments.swap(parsed._attachments);
+
+    // Notify the observers
+    _changedSignal.emit();
+}
+
 } // namespace eclass
@@ -217,6 +217,10 @@ public:
     // Initialises this class from the given tokens
     void parseFromTokens(parser::DefTokeniser& tokeniser);
 
+    // Replaces the contents of this class with the ones of the given class,
+    // which has been parsed on a worker thread. The name is kept.
+    void takeParsedContents(Doom3EntityClass& parsed);
+
     void setParseStamp(std::size_t parseStamp)
     {
         _parseStamp = parseStamp;
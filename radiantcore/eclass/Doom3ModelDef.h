@@ -45,6 +45,18 @@ public:
 		modName = "base";
 	}
 
+	// Replaces the data with the one of the given def, which has been
+	// parsed on a worker thread. The name is kept.
+	void takeParsedContents(const Doom3ModelDef& parsed)
+	{
+		resolved = false;
+		mesh = parsed.mesh;
+		skin = parsed.skin;
+		parent = parsed.parent;
+		anims = parsed.anims;
+		modName = parsed.modName;
+	}
+
 	// Reads the data from the given tokens into the member variables
 	void parseFromTokens(parser::DefTokeniser& tokeniser)
 	{
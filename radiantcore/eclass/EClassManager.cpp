@@ -1,6 +1,7 @@
 #include "EClassManager.h"
 
 #include "iarchive.h"
+#include "ideclscheduler.h"
 #include "ieclasscolours.h"
 #include "i18n.h"
 #include "iregistry.h"
@@ -8,6 +9,7 @@
 #include "iradiant.h"
 #include "ifilesystem.h"
 #include "parser/DefTokeniser.h"
+#include "stream/utils.h"
 #include "messages/ScopedLongRunningOperation.h"
 
 #include "Doom3EntityClass.h"
@@ -16,7 +18,7 @@
 #include "string/case_conv.h"
 #include <functional>
 
-#include "debugging/ScopedDebugTimer.h"
+#include "ParallelDefFileLoader.h"
 #include "module/StaticModule.h"
 
 namespace eclass {
@@ -133,13 +135,17 @@ void EClassManager::parseDefFiles()
 	// Increase the parse stamp for this run
 	_curParseStamp++;
 
-	{
-		ScopedDebugTimer timer("EntityDefs parsed: ");
-        GlobalFileSystem().forEachFile(
-            "def/", "def",
-            [&](const vfs::FileInfo& fileInfo) { parseFile(fileInfo); }
-        );
-	}
+	util::ParallelDefFileLoader<ParsedDefFile> loader("entityDefs");
+
+    GlobalFileSystem().forEachFile(
+        "def/", "def",
+        [&](const vfs::FileInfo& fileInfo) { loader.addFile(fileInfo); }
+    );
+
+    loader.load(
+        [&](const vfs::FileInfo& fileInfo) { return parseFile(fileInfo); },
+        [&](const vfs::FileInfo& fileInfo, const ParsedDefFile& parsedFile) { addDefinitions(parsedFile, fileInfo); }
+    );
 }
 
 void EClassManager::resolveInheritance()
@@ -298,6 +304,7 @@ const StringSet& EClassManager::getDependencies() const
 		_dependencies.insert(MODULE_XMLREGISTRY);
 		_dependencies.insert(MODULE_COMMANDSYSTEM);
 		_dependencies.insert(MODULE_ECLASS_COLOUR_MANAGER);
+		_dependencies.insert(MODULE_DECLARATION_SCHEDULER);
 	}
 
 	return _dependencies;
@@ -382,13 +389,12 @@ void EClassManager::onFileSystemShutdown()
 	unrealise();
 }
 
-// Parse the provided stream containing the contents of a single .def file.
-// Extract all entitydefs and create objects accordingly.
-void EClassManager::parse(TextInputStream& inStr, const vfs::FileInfo& fileInfo, const std::string& modDir)
+// Parse the provided contents of a single .def file into new objects,
+// this is called on the declaration workers and must not touch the maps.
+void EClassManager::parse(ParsedDefFile& parsedFile, const vfs::FileInfo& fileInfo)
 {
-	// Construct a tokeniser for the stream
-	std::istream is(&inStr);
-    parser::BasicDefTokeniser<std::istream> tokeniser(is);
+	// Construct a tokeniser working on the buffer
+    parser::BasicDefTokeniser<std::string_view> tokeniser(parsedFile.contents);
 
     while (tokeniser.hasMoreTokens())
 	{
@@ -397,98 +403,123 @@ void EClassManager::parse(TextInputStream& inStr, const vfs::FileInfo& fileInfo,
 
         if (blockType == "entitydef")
 		{
+			ParsedDecl decl;
+
 			// Get the (lowercase) entity name
-			const std::string sName =
-    			string::to_lower_copy(tokeniser.nextToken());
+			decl.name = string::to_lower_copy(tokeniser.nextToken());
+			decl.eclass = std::make_shared<Doom3EntityClass>(decl.name, fileInfo);
+
+			parsedFile.decls.push_back(decl);
+
+        	// Parse the contents of the eclass (excluding name)
+			decl.eclass->parseFromTokens(tokeniser);
+        }
+        else if (blockType == "model")
+		{
+			ParsedDecl decl;
+
+			// Read the name
+			decl.name = tokeniser.nextToken();
+			decl.model = std::make_shared<Doom3ModelDef>(decl.name);
+
+			parsedFile.decls.push_back(decl);
+
+        	decl.model->parseFromTokens(tokeniser);
+        }
+    }
+}
 
+EClassManager::ParsedDefFile EClassManager::parseFile(const vfs::FileInfo& fileInfo)
+{
+	ParsedDefFile parsedFile;
+
+	auto file = GlobalFileSystem().openTextFile(fileInfo.fullPath());
+
+	if (!file) return parsedFile;
+
+	// Load the whole file, it's tokenised in place
+	parsedFile.contents = stream::readAll(file->getInputStream());
+	parsedFile.modDir = file->getModName();
+
+	try
+    {
+		// Parse entity defs from the file
+		parse(parsedFile, fileInfo);
+	}
+    catch (parser::ParseException& e)
+    {
+		parsedFile.error = e.what();
+	}
+
+	return parsedFile;
+}
+
+// Adds the parsed decls to the maps. Existing objects are kept and take over the
+// parsed contents, so a later definition overrides an earlier one.
+void EClassManager::addDefinitions(const ParsedDefFile& parsedFile, const vfs::FileInfo& fileInfo)
+{
+	for (const auto& decl : parsedFile.decls)
+	{
+
+		if (decl.eclass)
+		{
 			// Ensure that an Entity class with this name already exists
 			// When reloading entityDef declarations, most names will already be registered
-			auto i = _entityClasses.find(sName);
+			auto i = _entityClasses.find(decl.name);
 
 			if (i == _entityClasses.end())
 			{
-				// Not existing yet, allocate a new class
-				auto result = _entityClasses.emplace(sName, std::make_shared<Doom3EntityClass>(sName, fileInfo));
+				// Not existing yet, take the parsed class
+				decl.eclass->setParseStamp(_curParseStamp);
+				decl.eclass->setModName(parsedFile.modDir);
 
-				i = result.first;
+				_entityClasses.emplace(decl.name, decl.eclass);
+				continue;
 			}
-			else
+
+			// EntityDef already exists, compare the parse stamp
+			if (i->second->getParseStamp() == _curParseStamp)
 			{
-				// EntityDef already exists, compare the parse stamp
-				if (i->second->getParseStamp() == _curParseStamp)
-				{
-					rWarning() << "[eclassmgr]: EntityDef "
-						<< sName << " redefined" << std::endl;
-				}
+				rWarning() << "[eclassmgr]: EntityDef "
+					<< decl.name << " redefined" << std::endl;
 			}
 
-			// At this point, i is pointing to a valid entityclass
-
 			i->second->setParseStamp(_curParseStamp);
-
-        	// Parse the contents of the eclass (excluding name)
-			i->second->parseFromTokens(tokeniser);
+			i->second->takeParsedContents(*decl.eclass);
 
 			// Set the mod directory
-        	i->second->setModName(modDir);
-        }
-        else if (blockType == "model")
+        	i->second->setModName(parsedFile.modDir);
+		}
+		else
 		{
-			// Read the name
-			std::string modelDefName = tokeniser.nextToken();
-
-			// Ensure that an Entity class with this name already exists
-			// When reloading entityDef declarations, most names will already be registered
-			Models::iterator i = _models.find(modelDefName);
+			Models::iterator i = _models.find(decl.name);
 
 			if (i == _models.end())
 			{
-				// Does not exist yet, allocate a new one
-
-				// Allocate an empty ModelDef
-        		Doom3ModelDefPtr model(new Doom3ModelDef(modelDefName));
+				decl.model->setParseStamp(_curParseStamp);
+				decl.model->setModName(parsedFile.modDir);
 
-				std::pair<Models::iterator, bool> result = _models.insert(
-					Models::value_type(modelDefName, model)
-				);
-
-				i = result.first;
+				_models.emplace(decl.name, decl.model);
+				continue;
 			}
-			else
+
+			// Model already exists, compare the parse stamp
+			if (i->second->getParseStamp() == _curParseStamp)
 			{
-				// Model already exists, compare the parse stamp
-				if (i->second->getParseStamp() == _curParseStamp)
-				{
-					rWarning() << "[eclassmgr]: Model "
-						<< modelDefName << " redefined" << std::endl;
-				}
+				rWarning() << "[eclassmgr]: Model "
+					<< decl.name << " redefined" << std::endl;
 			}
 
-			// Model structure is allocated and in the map,
-            // invoke the parser routine
 			i->second->setParseStamp(_curParseStamp);
-
-        	i->second->parseFromTokens(tokeniser);
-			i->second->setModName(modDir);
-        }
-    }
-}
-
-void EClassManager::parseFile(const vfs::FileInfo& fileInfo)
-{
-	auto file = GlobalFileSystem().openTextFile(fileInfo.fullPath());
-
-	if (!file) return;
-
-	try
-    {
-		// Parse entity defs from the file
-		parse(file->getInputStream(), fileInfo, file->getModName());
+			i->second->takeParsedContents(*decl.model);
+			i->second->setModName(parsedFile.modDir);
+		}
 	}
-    catch (parser::ParseException& e)
-    {
+
+	if (!parsedFile.error.empty())
+	{
 		rError() << "[eclassmgr] failed to parse " << fileInfo.fullPath()
-				 << " (" << e.what() << ")" << std::endl;
+				 << " (" << parsedFile.error << ")" << std::endl;
 	}
 }
 
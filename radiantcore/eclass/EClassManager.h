@@ -86,8 +86,33 @@ public:
     void shutdownModule() override;
 
 private:
-	// Method loading the DEF files
-    void parseFile(const vfs::FileInfo& fileInfo);
+    // An entityDef or model decl parsed on the declaration workers
+    struct ParsedDecl
+    {
+        std::string name;
+
+        // Either of these is set
+        Doom3EntityClassPtr eclass;
+        Doom3ModelDefPtr model;
+    };
+
+    struct ParsedDefFile
+    {
+        // The file contents, tokenised in place
+        std::string contents;
+        std::string modDir;
+
+        std::vector<ParsedDecl> decls;
+
+        // The parse error which stopped parsing this file, the last decl is incomplete
+        std::string error;
+    };
+
+	// Method loading the DEF files, can be called from any thread
+    ParsedDefFile parseFile(const vfs::FileInfo& fileInfo);
+
+    // Adds the parsed definitions of a file to the maps
+    void addDefinitions(const ParsedDefFile& parsedFile, const vfs::FileInfo& fileInfo);
 
     // Since loading is happening in a worker thread, we need to ensure
     // that it's done loading before accessing any defs or models.
@@ -104,8 +129,8 @@ private:
 	Doom3EntityClassPtr insertUnique(const Doom3EntityClassPtr& eclass);
     Doom3EntityClassPtr findInternal(const std::string& name);
 
-	// Parses the given inputstream for DEFs.
-	void parse(TextInputStream& inStr, const vfs::FileInfo& fileInfo, const std::string& modDir);
+	// Parses the file contents for DEFs, creating new objects for all of them
+	void parse(ParsedDefFile& parsedFile, const vfs::FileInfo& fileInfo);
 
 	// Recursively resolves the inheritance of the model defs
 	void resolveModelInheritance(const std::string& name, const Doom3ModelDefPtr& model);
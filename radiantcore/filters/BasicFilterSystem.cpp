@@ -8,8 +8,11 @@
 #include "iregistry.h"
 #include "igame.h"
 #include "ishaders.h"
+#include "ieclass.h"
 
 #include "module/StaticModule.h"
+#include "messages/TextureChanged.h"
+#include "scene/Node.h"
 #include "InstanceUpdateWalker.h"
 #include "SetObjectSelectionByFilterWalker.h"
 
@@ -28,10 +31,26 @@ namespace
 
 	// Registry key for persistent filter setting
 	const std::string RKEY_USER_ACTIVE_FILTERS = RKEY_USER_FILTER_BASE + "//activeFilter";
+
+	// Adds the nodes whose filtered status doesn't match the given visibility
+	void collectMismatchingNodes(const FilterNodeIndex::NodeSet& nodes, bool visible, FilterNodeIndex::NodeSet& result)
+	{
+		for (const auto& weak : nodes)
+		{
+			auto node = weak.lock();
+
+			if (node && node->isFiltered() == visible)
+			{
+				result.insert(node);
+			}
+		}
+	}
 }
 
 void BasicFilterSystem::setAllFilterStates(bool state)
 {
+	auto previousRules = getActiveRuleSignatures();
+
 	if (state)
 	{
 		_activeFilters = _availableFilters;
@@ -43,10 +62,10 @@ void BasicFilterSystem::setAllFilterStates(bool state)
 
 	// Invalidate the visibility cache to force new values to be
 	// loaded from the filters themselves
-	_visibilityCache.clear();
+	clearVisibilityCache();
 
-	// Update the scenegraph instances
-	update();
+	// Update the scenegraph instances affected by the change
+	updateChangedRules(previousRules);
 
 	_filterConfigChangedSignal.emit();
 
@@ -165,6 +184,24 @@ void BasicFilterSystem::initialiseModule(const IApplicationContext& ctx)
 	// user-defined filters
 	addFiltersFromXML(userFilters, false);
 
+	// Keep track of the scene nodes to update them when the rules change
+	GlobalSceneGraph().addSceneObserver(this);
+
+	if (GlobalSceneGraph().root())
+	{
+		GlobalSceneGraph().root()->foreachNode([this](const scene::INodePtr& node)
+		{
+			_nodeIndex.insert(node);
+			return true;
+		});
+	}
+
+	// Face and patch materials might change without notifying the scene
+	_textureChangedListener = GlobalRadiantCore().getMessageBus().addListener(
+		radiant::IMessage::Type::TextureChanged,
+		radiant::TypeListener<radiant::TextureChangedMessage>(
+			[this](radiant::TextureChangedMessage&) { _nodeIndex.invalidateMaterials(); }));
+
 	// Add the (de-)activate all commands
 	GlobalCommandSystem().addCommand("SetAllFilterStates", 
 		std::bind(&BasicFilterSystem::setAllFilterStatesCmd, this, std::placeholders::_1), { cmd::ARGTYPE_INT });
@@ -271,6 +308,12 @@ XmlFilterEventAdapter::Ptr BasicFilterSystem::ensureEventAdapter(XMLFilter& filt
 // Shut down the Filters module, saving active filters to registry
 void BasicFilterSystem::shutdownModule() 
 {
+	GlobalRadiantCore().getMessageBus().removeListener(_textureChangedListener);
+	GlobalSceneGraph().removeSceneObserver(this);
+
+	_nodeIndex.clear();
+	_insertedNodes.clear();
+
 	// Remove the existing set of active filter nodes
 	GlobalRegistry().deleteXPath(RKEY_USER_ACTIVE_FILTERS);
 
@@ -323,7 +366,7 @@ void BasicFilterSystem::shutdownModule()
 		}
 	}
 
-	_visibilityCache.clear();
+	clearVisibilityCache();
 	_eventAdapters.clear();
 	_activeFilters.clear();
 	_availableFilters.clear();
@@ -347,10 +390,52 @@ void BasicFilterSystem::update()
 	// Update shaders first, so that nodes can judge whether they're hidden on basis of their texture
 	updateShaders();
 
-	// Now update the scene
+	// Now update the scene, this includes any nodes waiting for their update
+	_insertedNodes.clear();
 	updateScene();
 }
 
+void BasicFilterSystem::updateInsertedNodes()
+{
+	std::vector<scene::INodeWeakPtr> insertedNodes;
+	insertedNodes.swap(_insertedNodes);
+
+	if (insertedNodes.empty()) return;
+
+	InstanceUpdateWalker walker(*this);
+
+	// Parent nodes have been inserted before their children
+	for (const auto& weak : insertedNodes)
+	{
+		auto node = weak.lock();
+
+		if (node && node->inScene())
+		{
+			walker.updateNode(node);
+		}
+	}
+}
+
+void BasicFilterSystem::onSceneNodeInsert(const scene::INodePtr& node)
+{
+	_nodeIndex.insert(node);
+	_insertedNodes.push_back(node);
+
+	// Nodes without a RenderSystem (like the ones of a map being loaded) have
+	// no shaders to check yet, they are kept until updateInsertedNodes() is called
+	auto sceneNode = std::dynamic_pointer_cast<scene::Node>(node);
+
+	if (sceneNode && sceneNode->getRenderSystem())
+	{
+		updateInsertedNodes();
+	}
+}
+
+void BasicFilterSystem::onSceneNodeErase(const scene::INodePtr& node)
+{
+	_nodeIndex.erase(node);
+}
+
 void BasicFilterSystem::forEachFilter(const std::function<void(const std::string & name)>& func)
 {
 	// Visit each filter on the list, passing the name to the visitor
@@ -376,6 +461,8 @@ bool BasicFilterSystem::getFilterState(const std::string& filter)
 void BasicFilterSystem::setFilterState(const std::string& filter, bool state) 
 {
 	assert(!_availableFilters.empty());
+
+	auto previousRules = getActiveRuleSignatures();
 	
 	if (state) 
 	{
@@ -391,10 +478,10 @@ void BasicFilterSystem::setFilterState(const std::string& filter, bool state)
 
 	// Invalidate the visibility cache to force new values to be
 	// loaded from the filters themselves
-	_visibilityCache.clear();
+	clearVisibilityCache();
 
-	// Update the scenegraph instances
-	update();
+	// Update the scenegraph instances affected by the change
+	updateChangedRules(previousRules);
 
 	_filterConfigChangedSignal.emit();
 
@@ -445,6 +532,8 @@ bool BasicFilterSystem::removeFilter(const std::string& filter)
 
 	_eventAdapters.erase(f->second->getName());
 
+	auto previousRules = getActiveRuleSignatures();
+
 	// Check if the filter was active
 	auto found = _activeFilters.find(f->first);
 	bool wasActive = found != _activeFilters.end();
@@ -462,11 +551,11 @@ bool BasicFilterSystem::removeFilter(const std::string& filter)
 	if (wasActive)
 	{
 		// Clear the cache, the rules have changed
-		_visibilityCache.clear();
+		clearVisibilityCache();
 
 		_filterConfigChangedSignal.emit();
 
-		update();
+		updateChangedRules(previousRules);
 	}
 
 	return true;
@@ -538,11 +627,13 @@ bool BasicFilterSystem::renameFilter(const std::string& oldFilterName, const std
 // Query whether an item is visible or filtered out
 bool BasicFilterSystem::isVisible(const FilterRule::Type type, const std::string& name)
 {
+	auto& cache = _visibilityCache[type];
+
 	// Check if this item is in the visibility cache, returning
 	// its cached value if found
-	auto cacheIter = _visibilityCache.find(name);
+	auto cacheIter = cache.find(name);
 	
-	if (cacheIter != _visibilityCache.end())
+	if (cacheIter != cache.end())
 	{
 		return cacheIter->second;
 	}
@@ -564,13 +655,19 @@ bool BasicFilterSystem::isVisible(const FilterRule::Type type, const std::string
 	}
 
 	// Cache the result and return to caller
-	_visibilityCache.emplace(name, visFlag);
+	cache.emplace(name, visFlag);
 
 	return visFlag;
 }
 
 bool BasicFilterSystem::isEntityVisible(const FilterRule::Type type, const Entity& entity)
 {
+	// Entity class rules only depend on the class name, use the cache
+	if (type == FilterRule::TYPE_ENTITYCLASS)
+	{
+		return isVisible(type, entity.getEntityClass()->getName());
+	}
+
 	// Otherwise, walk the list of active filters to find a value for
 	// this item.
 	bool visFlag = true; // default if no filters modify it
@@ -580,7 +677,7 @@ bool BasicFilterSystem::isEntityVisible(const FilterRule::Type type, const Entit
 		// Delegate the check to the filter object. If a filter returns
 		// false for the visibility check, then the item is filtered
 		// and we don't need any more checks.
-		if (!active.second->isEntityVisible(type, entity))
+		if (active.second->hasRules(type) && !active.second->isEntityVisible(type, entity))
 		{
 			visFlag = false;
 			break;
@@ -603,15 +700,17 @@ bool BasicFilterSystem::setFilterRules(const std::string& filter, const FilterRu
 
 	if (f != _availableFilters.end() && !f->second->isReadOnly())
 	{
+		auto previousRules = getActiveRuleSignatures();
+
 		// Apply the ruleset
 		f->second->setRules(ruleSet);
 
 		// Clear the cache, the ruleset has changed
-		_visibilityCache.clear();
+		clearVisibilityCache();
 
 		_filterConfigChangedSignal.emit();
 
-		update();
+		updateChangedRules(previousRules);
 
 		return true;
 	}
@@ -634,17 +733,134 @@ void BasicFilterSystem::updateScene()
 	updateSubgraph(GlobalSceneGraph().root());
 }
 
+void BasicFilterSystem::clearVisibilityCache()
+{
+	for (auto& cache : _visibilityCache)
+	{
+		cache.clear();
+	}
+}
+
+BasicFilterSystem::RuleSignatures BasicFilterSystem::getActiveRuleSignatures() const
+{
+	RuleSignatures signatures;
+
+	for (const auto& active : _activeFilters)
+	{
+		for (std::size_t type = 0; type < NUM_RULE_TYPES; ++type)
+		{
+			if (!active.second->hasRules(static_cast<FilterRule::Type>(type))) continue;
+
+			auto& signature = signatures[type];
+
+			for (const auto& rule : active.second->getRuleSet())
+			{
+				if (rule.type != type) continue;
+
+				signature.append(rule.entityKey).append(1, '\n');
+				signature.append(rule.match).append(1, '\n');
+				signature.append(1, rule.show ? '1' : '0');
+			}
+
+			// Rules are evaluated per filter, mark the end of this one
+			signature.append(1, '\0');
+		}
+	}
+
+	return signatures;
+}
+
+void BasicFilterSystem::updateChangedRules(const RuleSignatures& previousRules)
+{
+	auto rules = getActiveRuleSignatures();
+
+	auto rulesChanged = [&](FilterRule::Type type)
+	{
+		return rules[type] != previousRules[type];
+	};
+
+	// Materials are updated regardless of the scene
+	auto changedMaterials = rulesChanged(FilterRule::TYPE_TEXTURE) ?
+		updateShaders() : std::vector<std::string>();
+
+	if (!GlobalSceneGraph().root()) return;
+
+	// Pending nodes are evaluated against the new rules
+	updateInsertedNodes();
+
+	FilterNodeIndex::NodeSet entities;
+	FilterNodeIndex::NodeSet surfaces;
+
+	for (const auto& material : changedMaterials)
+	{
+		_nodeIndex.collectNodesWithMaterial(material, surfaces);
+	}
+
+	if (rulesChanged(FilterRule::TYPE_OBJECT))
+	{
+		collectMismatchingNodes(_nodeIndex.getBrushes(), isVisible(FilterRule::TYPE_OBJECT, "brush"), surfaces);
+		collectMismatchingNodes(_nodeIndex.getPatches(), isVisible(FilterRule::TYPE_OBJECT, "patch"), surfaces);
+	}
+
+	if (rulesChanged(FilterRule::TYPE_ENTITYKEYVALUE))
+	{
+		// Any entity might be affected by spawnarg rules
+		for (const auto& pair : _nodeIndex.getEntitiesByClass())
+		{
+			entities.insert(pair.second.begin(), pair.second.end());
+		}
+	}
+	else if (rulesChanged(FilterRule::TYPE_ENTITYCLASS))
+	{
+		for (const auto& pair : _nodeIndex.getEntitiesByClass())
+		{
+			collectMismatchingNodes(pair.second, isVisible(FilterRule::TYPE_ENTITYCLASS, pair.first), entities);
+		}
+	}
+
+	InstanceUpdateWalker walker(*this);
+
+	// Entities first, their status is passed down to their child nodes
+	for (const auto& weak : entities)
+	{
+		auto node = weak.lock();
+
+		if (node)
+		{
+			node->traverse(walker);
+		}
+	}
+
+	for (const auto& weak : surfaces)
+	{
+		auto node = weak.lock();
+
+		if (node)
+		{
+			walker.updateNode(node);
+		}
+	}
+}
+
 // Update scenegraph instances with filtered status
-void BasicFilterSystem::updateShaders() 
+std::vector<std::string> BasicFilterSystem::updateShaders() 
 {
+	std::vector<std::string> changedMaterials;
+
 	// Construct a ShaderVisitor to traverse the shaders
-    GlobalMaterialManager().foreachMaterial([this] (const MaterialPtr& material)
+    GlobalMaterialManager().foreachMaterial([&] (const MaterialPtr& material)
     {
         // Set the shader's visibility based on the current filter settings
-        material->setVisible(
-            isVisible(FilterRule::TYPE_TEXTURE, material->getName())
-        );
+        bool visible = isVisible(FilterRule::TYPE_TEXTURE, material->getName());
+
+        if (material->isVisible() != visible)
+        {
+            material->setVisible(visible);
+            changedMaterials.push_back(material->getName());
+        }
     });
+
+	return changedMaterials;
 }
 
 // RegisterableModule implementation
@@ -663,6 +879,7 @@ const StringSet& BasicFilterSystem::getDependencies() const
 		_dependencies.insert(MODULE_XMLREGISTRY);
 		_dependencies.insert(MODULE_GAMEMANAGER);
 		_dependencies.insert(MODULE_COMMANDSYSTEM);
+		_dependencies.insert(MODULE_SCENEGRAPH);
 	}
 
 	return _dependencies;
@@ -3,8 +3,11 @@
 #include "imodule.h"
 #include "ifilter.h"
 #include "icommandsystem.h"
+#include "iscenegraph.h"
 
+#include <array>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <iostream>
@@ -12,6 +15,7 @@
 #include "xmlutil/Node.h"
 #include "XMLFilter.h"
 #include "XmlFilterEventAdapter.h"
+#include "FilterNodeIndex.h"
 
 namespace filters
 {
@@ -19,9 +23,12 @@ namespace filters
 /** FilterSystem implementation class.
  */
 class BasicFilterSystem : 
-	public IFilterSystem
+	public IFilterSystem,
+	public scene::Graph::Observer
 {
 private:
+	static const std::size_t NUM_RULE_TYPES = FilterRule::TYPE_ENTITYKEYVALUE + 1;
+
 	// Hashtable of available filters, indexed by name
 	typedef std::map<std::string, XMLFilter::Ptr> FilterTable;
 	FilterTable _availableFilters;
@@ -29,10 +36,19 @@ private:
 	// Second table containing just the active filters
 	FilterTable _activeFilters;
 
-	// Cache of visibility flags for item names, to avoid having to
-	// traverse the active filter list for each lookup
-	typedef std::map<std::string, bool> StringFlagCache;
-	StringFlagCache _visibilityCache;
+	// Cache of visibility flags for item names, one table per rule type, to
+	// avoid having to traverse the active filter list for each lookup.
+	// Only cleared when the active rules change.
+	typedef std::unordered_map<std::string, bool> StringFlagCache;
+	std::array<StringFlagCache, NUM_RULE_TYPES> _visibilityCache;
+
+	// The nodes of the global scene affected by each type of rule
+	FilterNodeIndex _nodeIndex;
+
+	// Nodes inserted into the scene which haven't been updated yet
+	std::vector<scene::INodeWeakPtr> _insertedNodes;
+
+	std::size_t _textureChangedListener;
 
     sigc::signal<void> _filterConfigChangedSignal;
     sigc::signal<void> _filterCollectionChangedSignal;
@@ -46,7 +62,18 @@ private:
 	// flag on Nodes depending on their entity class
 	void updateScene();
 
-	void updateShaders();
+	// Updates the visibility of all materials, returns the names of the changed ones
+	std::vector<std::string> updateShaders();
+
+	void clearVisibilityCache();
+
+	// The rules of the active filters for each rule type, in a comparable form
+	typedef std::array<std::string, NUM_RULE_TYPES> RuleSignatures;
+	RuleSignatures getActiveRuleSignatures() const;
+
+	// Updates the scene nodes affected by the rule types which changed since
+	// the given snapshot was taken, instead of walking the whole scene
+	void updateChangedRules(const RuleSignatures& previousRules);
 
 	void addFiltersFromXML(const xml::NodeList& nodes, bool readOnly);
 
@@ -72,6 +99,8 @@ public:
 	// Updates the given subgraph
 	void updateSubgraph(const scene::INodePtr& root) override;
 
+	void updateInsertedNodes() override;
+
 	// Filter system visit function
 	void forEachFilter(const std::function<void(const std::string & name)>& func) override;
 
@@ -109,6 +138,10 @@ public:
 	// Activates or deactivates all known filters.
 	void setAllFilterStates(bool state) override;
 
+	// Graph::Observer implementation
+	void onSceneNodeInsert(const scene::INodePtr& node) override;
+	void onSceneNodeErase(const scene::INodePtr& node) override;
+
 	// RegisterableModule implementation
 	const std::string& getName() const override;
 	const StringSet& getDependencies() const override;
@@ -0,0 +1,117 @@
+#include "FilterNodeIndex.h"
+
+#include "ientity.h"
+#include "ieclass.h"
+#include "ibrush.h"
+#include "ipatch.h"
+
+namespace filters
+{
+
+FilterNodeIndex::FilterNodeIndex() :
+	_materialIndexValid(false)
+{}
+
+void FilterNodeIndex::insert(const scene::INodePtr& node)
+{
+	if (Node_isEntity(node))
+	{
+		_entitiesByClass[Node_getEntity(node)->getEntityClass()->getName()].insert(node);
+	}
+	else if (Node_isBrush(node))
+	{
+		_brushes.insert(node);
+		_materialIndexValid = false;
+	}
+	else if (Node_isPatch(node))
+	{
+		_patches.insert(node);
+		_materialIndexValid = false;
+	}
+}
+
+void FilterNodeIndex::erase(const scene::INodePtr& node)
+{
+	if (Node_isEntity(node))
+	{
+		auto found = _entitiesByClass.find(Node_getEntity(node)->getEntityClass()->getName());
+
+		if (found != _entitiesByClass.end())
+		{
+			found->second.erase(node);
+
+			if (found->second.empty())
+			{
+				_entitiesByClass.erase(found);
+			}
+		}
+	}
+	else if (Node_isBrush(node))
+	{
+		_brushes.erase(node);
+		_materialIndexValid = false;
+	}
+	else if (Node_isPatch(node))
+	{
+		_patches.erase(node);
+		_materialIndexValid = false;
+	}
+}
+
+void FilterNodeIndex::clear()
+{
+	_entitiesByClass.clear();
+	_brushes.clear();
+	_patches.clear();
+	_surfacesByMaterial.clear();
+	_materialIndexValid = false;
+}
+
+void FilterNodeIndex::invalidateMaterials()
+{
+	_materialIndexValid = false;
+}
+
+void FilterNodeIndex::collectNodesWithMaterial(const std::string& material, NodeSet& nodes)
+{
+	ensureMaterialIndex();
+
+	auto found = _surfacesByMaterial.find(material);
+
+	if (found != _surfacesByMaterial.end())
+	{
+		nodes.insert(found->second.begin(), found->second.end());
+	}
+}
+
+void FilterNodeIndex::ensureMaterialIndex()
+{
+	if (_materialIndexValid) return;
+
+	_surfacesByMaterial.clear();
+
+	for (const auto& weak : _brushes)
+	{
+		auto node = weak.lock();
+		if (!node) continue;
+
+		const auto& brush = *Node_getIBrush(node);
+
+		for (std::size_t i = 0; i < brush.getNumFaces(); ++i)
+		{
+			_surfacesByMaterial[brush.getFace(i).getShader()].insert(node);
+		}
+	}
+
+	for (const auto& weak : _patches)
+	{
+		auto node = weak.lock();
+		if (!node) continue;
+
+		_surfacesByMaterial[Node_getIPatch(node)->getShader()].insert(node);
+	}
+
+	_materialIndexValid = true;
+}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "inode.h"
+#include "string/string.h"
+
+namespace filters
+{
+
+/**
+ * Reverse lookup of the scene nodes affected by the filter rules, used to
+ * re-evaluate only the nodes whose filtered status might have changed.
+ *
+ * Entities are indexed by their entity class name, which can't change
+ * while they are in the scene. Brushes and patches are indexed by their
+ * materials. Since face materials can be changed at any time, this table
+ * is rebuilt on demand after any material change has been reported.
+ * Material names are compared case-insensitively like in the shader system,
+ * faces don't necessarily use the same spelling as the material declaration.
+ */
+class FilterNodeIndex
+{
+public:
+	typedef std::set<scene::INodeWeakPtr, std::owner_less<scene::INodeWeakPtr>> NodeSet;
+	typedef std::map<std::string, NodeSet> NodeSetsByName;
+
+	struct MaterialNameLess
+	{
+		bool operator()(const std::string& a, const std::string& b) const
+		{
+			return string_compare_nocase(a.c_str(), b.c_str()) < 0;
+		}
+	};
+	typedef std::map<std::string, NodeSet, MaterialNameLess> NodeSetsByMaterial;
+
+private:
+	NodeSetsByName _entitiesByClass;
+
+	NodeSet _brushes;
+	NodeSet _patches;
+
+	NodeSetsByMaterial _surfacesByMaterial;
+	bool _materialIndexValid;
+
+public:
+	FilterNodeIndex();
+
+	// Adds or removes a node, anything but entities, brushes and patches is ignored
+	void insert(const scene::INodePtr& node);
+	void erase(const scene::INodePtr& node);
+
+	void clear();
+
+	// Marks the material lookup table as outdated
+	void invalidateMaterials();
+
+	const NodeSetsByName& getEntitiesByClass() const
+	{
+		return _entitiesByClass;
+	}
+
+	const NodeSet& getBrushes() const
+	{
+		return _brushes;
+	}
+
+	const NodeSet& getPatches() const
+	{
+		return _patches;
+	}
+
+	// Adds the brushes and patches using the named material (in any case) to the given set
+	void collectNodesWithMaterial(const std::string& material, NodeSet& nodes);
+
+private:
+	void ensureMaterialIndex();
+};
+
+}
@@ -106,6 +106,45 @@ public:
 		return true;
 	}
 
+	/**
+	 * Updates the filtered status of the given node only, without touching
+	 * its children. Nodes below a filtered parent are filtered too.
+	 */
+	void updateNode(const scene::INodePtr& node)
+	{
+		auto parent = node->getParent();
+
+		bool isVisible = !parent || !parent->isFiltered();
+
+		if (isVisible)
+		{
+			if (Node_isEntity(node))
+			{
+				isVisible = evaluateEntity(node);
+			}
+			else if (Node_isPatch(node))
+			{
+				isVisible = evaluatePatch(node);
+			}
+			else if (Node_isBrush(node))
+			{
+				isVisible = evaluateBrush(node);
+
+				if (isVisible)
+				{
+					Node_getIBrush(node)->updateFaceVisibility();
+				}
+			}
+		}
+
+		node->setFiltered(!isVisible);
+
+		if (!isVisible)
+		{
+			Node_setSelected(node, false);
+		}
+	}
+
 private:
 	bool evaluateEntity(const scene::INodePtr& node)
 	{
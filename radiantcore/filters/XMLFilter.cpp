@@ -3,14 +3,127 @@
 #include "ientity.h"
 #include "ieclass.h"
 #include "ifilter.h"
-#include <regex>
+#include "itextstream.h"
+#include <cctype>
 #include <algorithm>
 
 namespace filters
 {
 
+namespace
+{
+	const std::string MATCH_ANYTHING(".*");
+
+	bool startsWithWildcard(const std::string& expression)
+	{
+		return expression.compare(0, MATCH_ANYTHING.length(), MATCH_ANYTHING) == 0;
+	}
+
+	bool endsWithWildcard(const std::string& expression)
+	{
+		return expression.length() >= MATCH_ANYTHING.length() &&
+			expression.compare(expression.length() - MATCH_ANYTHING.length(), MATCH_ANYTHING.length(), MATCH_ANYTHING) == 0;
+	}
+
+	// Resolves the escaped characters of the given expression, returns false
+	// if the expression contains any regex syntax and is not a plain string
+	bool unescapeLiteral(const std::string& expression, std::string& literal)
+	{
+		static const std::string REGEX_SPECIAL_CHARACTERS(".[]{}()*+?^$|");
+
+		literal.clear();
+		literal.reserve(expression.length());
+
+		for (std::size_t i = 0; i < expression.length(); ++i)
+		{
+			char c = expression[i];
+
+			if (c == '\\')
+			{
+				// Escaped letters and digits are character classes or back references
+				if (++i == expression.length() || std::isalnum(static_cast<unsigned char>(expression[i])))
+				{
+					return false;
+				}
+
+				literal += expression[i];
+			}
+			else if (REGEX_SPECIAL_CHARACTERS.find(c) != std::string::npos)
+			{
+				return false;
+			}
+			else
+			{
+				literal += c;
+			}
+		}
+
+		return true;
+	}
+}
+
+XMLFilter::RuleMatcher::RuleMatcher(const std::string& expression) :
+	_kind(Kind::Pattern)
+{
+	if (expression == MATCH_ANYTHING)
+	{
+		_kind = Kind::Any;
+		return;
+	}
+
+	// Check for plain strings, optionally surrounded by wildcards
+	bool leadingWildcard = startsWithWildcard(expression);
+	auto start = leadingWildcard ? MATCH_ANYTHING.length() : 0;
+
+	bool trailingWildcard = expression.length() >= start + MATCH_ANYTHING.length() && endsWithWildcard(expression);
+	auto end = expression.length() - (trailingWildcard ? MATCH_ANYTHING.length() : 0);
+
+	if (unescapeLiteral(expression.substr(start, end - start), _text))
+	{
+		_kind = leadingWildcard ?
+			(trailingWildcard ? Kind::Substring : Kind::Suffix) :
+			(trailingWildcard ? Kind::Prefix : Kind::Literal);
+		return;
+	}
+
+	_text.clear();
+
+	try
+	{
+		_pattern = std::regex(expression, std::regex::ECMAScript | std::regex::optimize);
+	}
+	catch (const std::regex_error& ex)
+	{
+		rWarning() << "Invalid filter expression " << expression << ": " << ex.what() << std::endl;
+		_kind = Kind::Invalid;
+	}
+}
+
+bool XMLFilter::RuleMatcher::matches(const std::string& value) const
+{
+	switch (_kind)
+	{
+	case Kind::Any:
+		return true;
+	case Kind::Literal:
+		return value == _text;
+	case Kind::Prefix:
+		return value.compare(0, _text.length(), _text) == 0;
+	case Kind::Suffix:
+		return value.length() >= _text.length() &&
+			value.compare(value.length() - _text.length(), _text.length(), _text) == 0;
+	case Kind::Substring:
+		return value.find(_text) != std::string::npos;
+	case Kind::Pattern:
+		return std::regex_match(value, _pattern);
+	default:
+		return false;
+	}
+}
+
 XMLFilter::XMLFilter(const std::string& name, bool readOnly) :
 	_name(name),
+	_ruleTypes(0),
 	_readonly(readOnly)
 {
 	updateEventName();
@@ -25,24 +138,25 @@ bool XMLFilter::isVisible(const FilterRule::Type type, const std::string& name)
 
 	bool visible = true; // default if unmodified by rules
 
-	for (FilterRules::const_iterator ruleIter = _rules.begin();
-		 ruleIter != _rules.end();
-		 ++ruleIter)
+	if (!hasRules(type))
+	{
+		return visible;
+	}
+
+	for (std::size_t i = 0; i < _rules.size(); ++i)
 	{
 		// Check the item type.
-		if (ruleIter->type != type)
+		if (_rules[i].type != type)
 		{
 			continue;
 		}
 
-		// If we have a rule for this item, use a regex to match the query name
-		// against the "match" parameter
-		std::regex ex(ruleIter->match);
-
-		if (std::regex_match(name, ex))
+		// If we have a rule for this item, match the query name against
+		// the compiled "match" parameter
+		if (_matchers[i].matches(name))
 		{
 			// Overwrite the visible flag with the value from the rule.
-			visible = ruleIter->show;
+			visible = _rules[i].show;
 		}
 	}
 
@@ -54,33 +168,34 @@ bool XMLFilter::isEntityVisible(const FilterRule::Type type, const Entity& entit
 {
 	bool visible = true; // default if unmodified by rules
 
+	if (!hasRules(type))
+	{
+		return visible;
+	}
+
 	IEntityClassConstPtr eclass = entity.getEntityClass();
 	
-	for (FilterRules::const_iterator ruleIter = _rules.begin();
-		 ruleIter != _rules.end();
-		 ++ruleIter)
+	for (std::size_t i = 0; i < _rules.size(); ++i)
 	{
-		if (ruleIter->type != type)
+		const auto& rule = _rules[i];
+
+		if (rule.type != type)
 		{
 			continue;
 		}
 
 		if (type == FilterRule::TYPE_ENTITYCLASS)
 		{
-			std::regex ex(ruleIter->match);
-
-			if (std::regex_match(eclass->getName(), ex))
+			if (_matchers[i].matches(eclass->getName()))
 			{
-				visible = ruleIter->show;
+				visible = rule.show;
 			}
 		}
 		else if (type == FilterRule::TYPE_ENTITYKEYVALUE)
 		{
-			std::regex ex(ruleIter->match);
-
-			if (std::regex_match(entity.getKeyValue(ruleIter->entityKey), ex))
+			if (_matchers[i].matches(entity.getKeyValue(rule.entityKey)))
 			{
-				visible = ruleIter->show;
+				visible = rule.show;
 			}
 		}
 	}
@@ -115,7 +230,21 @@ const FilterRules& XMLFilter::getRuleSet() const
 }
 
 void XMLFilter::setRules(const FilterRules& rules) {
-	_rules = rules;
+	_rules.clear();
+	_matchers.clear();
+	_ruleTypes = 0;
+
+	for (const auto& rule : rules)
+	{
+		addCompiledRule(rule);
+	}
+}
+
+void XMLFilter::addCompiledRule(const FilterRule& rule)
+{
+	_rules.push_back(rule);
+	_matchers.emplace_back(rule.match);
+	_ruleTypes |= 1u << rule.type;
 }
 
 void XMLFilter::updateEventName() {
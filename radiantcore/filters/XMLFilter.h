@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <regex>
 #include "ifilter.h"
 
 namespace filters
@@ -14,6 +15,47 @@ namespace filters
 
 class XMLFilter
 {
+public:
+	/**
+	 * The match expression of a rule, compiled once when the rule is set.
+	 * Expressions which are plain strings, optionally with a leading or
+	 * trailing ".*", are compared directly, only real patterns are run
+	 * through the regex engine. Invalid expressions never match.
+	 */
+	class RuleMatcher
+	{
+	public:
+		enum class Kind
+		{
+			Any,		// .*
+			Literal,	// abc
+			Prefix,		// abc.*
+			Suffix,		// .*abc
+			Substring,	// .*abc.*
+			Pattern,	// anything else
+			Invalid,
+		};
+
+	private:
+		Kind _kind;
+
+		// The unescaped text for the non-pattern kinds
+		std::string _text;
+
+		std::regex _pattern;
+
+	public:
+		RuleMatcher(const std::string& expression);
+
+		Kind getKind() const
+		{
+			return _kind;
+		}
+
+		// Returns true if the whole value is matched by the expression
+		bool matches(const std::string& value) const;
+	};
+
 private:
 	// Text name of filter (from game.xml)
 	std::string _name;
@@ -24,6 +66,12 @@ private:
 	// Ordered list of rule objects
 	FilterRules _rules;
 
+	// The compiled match expressions, one for each rule
+	std::vector<RuleMatcher> _matchers;
+
+	// One bit for each FilterRule::Type used by the rules
+	unsigned int _ruleTypes;
+
 	// True if this filter can't be changed
 	bool _readonly;
 
@@ -54,7 +102,7 @@ public:
 	 */
 	void addRule(const FilterRule::Type type, const std::string& match, bool show)
 	{
-		_rules.push_back(FilterRule::Create(type, match, show));
+		addCompiledRule(FilterRule::Create(type, match, show));
 	}
 
 	/** Add an entitykeyvalue rule to this filter.
@@ -71,7 +119,13 @@ public:
 	 */
 	void addEntityKeyValueRule(const std::string& key, const std::string& match, bool show)
 	{
-		_rules.push_back(FilterRule::CreateEntityKeyValueRule(key, match, show));
+		addCompiledRule(FilterRule::CreateEntityKeyValueRule(key, match, show));
+	}
+
+	// Returns true if this filter has at least one rule of the given type
+	bool hasRules(const FilterRule::Type type) const
+	{
+		return (_ruleTypes & (1u << type)) != 0;
 	}
 
 	/** Test a given item for visibility against all of the rules
@@ -121,6 +175,8 @@ public:
 
 private:
 	void updateEventName();
+
+	void addCompiledRule(const FilterRule& rule);
 };
 
 }
@@ -11,8 +11,10 @@
 namespace fonts
 {
 
-void FontLoader::operator()(const vfs::FileInfo& fileInfo)
+FontLoader::LoadedGlyphSet FontLoader::loadGlyphSet(const vfs::FileInfo& fileInfo) const
 {
+	LoadedGlyphSet loaded;
+
 	// Construct the full VFS path
 	std::string fullPath = os::standardPath(_basePath + fileInfo.name);
 
@@ -44,11 +46,11 @@ void FontLoader::operator()(const vfs::FileInfo& fileInfo)
 
 		if (resolution != NumResolutions)
 		{
-			// Create the font (if not done yet), acquire the info structure
-			FontInfoPtr font = _manager.findOrCreateFontInfo(fontname);
+			loaded.fontname = fontname;
+			loaded.resolution = resolution;
 
 			// Load the DAT file and create the glyph info
-			font->glyphSets[resolution] = GlyphSet::createFromDatFile(
+			loaded.glyphSet = GlyphSet::createFromDatFile(
 				fullPath, fontname, _manager.getCurLanguage(), resolution
 			);
 		}
@@ -57,6 +59,21 @@ void FontLoader::operator()(const vfs::FileInfo& fileInfo)
 			rWarning() << "FontLoader: ignoring DAT: " << fileInfo.name << std::endl;
 		}
 	}
+
+	return loaded;
+}
+
+void FontLoader::addGlyphSet(const LoadedGlyphSet& loaded)
+{
+	if (loaded.fontname.empty())
+	{
+		return;
+	}
+
+	// Create the font (if not done yet), acquire the info structure
+	FontInfoPtr font = _manager.findOrCreateFontInfo(loaded.fontname);
+
+	font->glyphSets[loaded.resolution] = loaded.glyphSet;
 }
 
 } // namespace fonts
@@ -1,6 +1,7 @@
 #include "ifonts.h"
 
 #include "ifilesystem.h"
+#include "GlyphSet.h"
 
 namespace fonts
 {
@@ -17,13 +18,26 @@ private:
 	FontManager& _manager;
 
 public:
+	// A DAT file loaded on one of the declaration workers
+	struct LoadedGlyphSet
+	{
+		std::string fontname;
+		Resolution resolution = NumResolutions;
+		GlyphSetPtr glyphSet;
+	};
+
 	// Constructor. Set the base path of the search.
 	FontLoader(const std::string& path, FontManager& manager) :
 		_basePath(path),
 		_manager(manager)
 	{}
 
-	void operator()(const vfs::FileInfo& fileInfo);
+	// Loads the glyph set from the given DAT file, without registering it.
+	// The result has no font name if the file is not a valid DAT file.
+	LoadedGlyphSet loadGlyphSet(const vfs::FileInfo& fileInfo) const;
+
+	// Assigns the loaded glyph set to its font, creating the font if necessary
+	void addGlyphSet(const LoadedGlyphSet& loaded);
 };
 
 } // namespace fonts
@@ -5,8 +5,10 @@
 #include "itextstream.h"
 #include "iregistry.h"
 #include "igame.h"
+#include "ideclscheduler.h"
 #include "os/path.h"
 #include "module/StaticModule.h"
+#include "ParallelDefFileLoader.h"
 
 #include "xmlutil/MissingXMLNodeException.h"
 
@@ -47,6 +49,7 @@ const StringSet& FontManager::getDependencies() const
 		_dependencies.insert(MODULE_XMLREGISTRY);
 		_dependencies.insert(MODULE_GAMEMANAGER);
 		_dependencies.insert(MODULE_SHADERSYSTEM);
+		_dependencies.insert(MODULE_DECLARATION_SCHEDULER);
 	}
 
 	return _dependencies;
@@ -101,9 +104,17 @@ void FontManager::loadFonts()
 	std::string path = os::standardPathWithSlash(nlBasePath[0].getContent()) + _curLanguage + "/";
 	std::string extension = nlExt[0].getContent();
 
-	// Instantiate a visitor to traverse the VFS
+	// Load the DAT files on the declaration workers, the fonts are registered in file order
 	FontLoader loader(path, *this);
-	GlobalFileSystem().forEachFile(path, extension, loader, 2);
+	util::ParallelDefFileLoader<FontLoader::LoadedGlyphSet> fileLoader("fonts");
+
+	GlobalFileSystem().forEachFile(path, extension,
+		[&](const vfs::FileInfo& fileInfo) { fileLoader.addFile(fileInfo); }, 2);
+
+	fileLoader.load(
+		[&](const vfs::FileInfo& fileInfo) { return loader.loadGlyphSet(fileInfo); },
+		[&](const vfs::FileInfo&, const FontLoader::LoadedGlyphSet& loaded) { loader.addGlyphSet(loaded); }
+	);
 
 	rMessage() << _fonts.size() << " fonts registered." << std::endl;
 }
@@ -9,11 +9,15 @@
 #include "iarchive.h"
 #include "iregistry.h"
 #include "igame.h"
+#include "itextstream.h"
 
 #include "string/case_conv.h"
 
 #include "os/path.h"
 #include "DirectoryArchiveFile.h"
+#include "DDSImage.h"
+#include "ImageKernels.h"
+#include "ThreadPool.h"
 #include "module/StaticModule.h"
 
 namespace image
@@ -23,6 +27,102 @@ namespace
 {
     // Registry key holding texture types
     const char* const GKEY_IMAGE_TYPES = "/filetypes/texture//extension";
+
+    // A decoded image along with all its mipmaps. It reports the size of the
+    // decoded image, the first mipmap is scaled down to a power of two.
+    class MipMapChainImage :
+        public DDSImage
+    {
+    private:
+        std::size_t _width;
+        std::size_t _height;
+
+    public:
+        MipMapChainImage(std::size_t size, std::size_t width, std::size_t height) :
+            DDSImage(size),
+            _width(width),
+            _height(height)
+        {}
+
+        std::size_t getWidth() const override { return _width; }
+        std::size_t getHeight() const override { return _height; }
+    };
+
+    // The largest power of two not exceeding the given size, like gluBuild2DMipmaps is using
+    std::size_t getPowerOfTwo(std::size_t size)
+    {
+        std::size_t result = 1;
+
+        while (result * 2 <= size)
+        {
+            result *= 2;
+        }
+
+        return result;
+    }
+
+    // Creates the mipmaps of the given RGBA image, down to 1x1 pixels. The first
+    // mipmap doesn't exceed the given size, unless it is 0.
+    ImagePtr createMipMapChain(const ImagePtr& image, std::size_t maxSize)
+    {
+        if (!image || image->isPrecompressed() || image->getWidth() == 0 || image->getHeight() == 0)
+        {
+            return image;
+        }
+
+        std::size_t width = getPowerOfTwo(image->getWidth());
+        std::size_t height = getPowerOfTwo(image->getHeight());
+
+        if (maxSize > 0)
+        {
+            // Like TextureManipulator, each dimension is reduced on its own
+            width = std::min(width, getPowerOfTwo(maxSize));
+            height = std::min(height, getPowerOfTwo(maxSize));
+        }
+
+        // All mipmaps are stored in one buffer
+        std::size_t totalSize = 0;
+
+        for (std::size_t w = width, h = height; ; w = std::max<std::size_t>(w / 2, 1), h = std::max<std::size_t>(h / 2, 1))
+        {
+            totalSize += w * h * 4;
+
+            if (w == 1 && h == 1) break;
+        }
+
+        auto chain = std::make_shared<MipMapChainImage>(totalSize, image->getWidth(), image->getHeight());
+        chain->setFormat(GL_RGBA, false, GL_RGBA);
+
+        // The first mipmap is a copy of the image, unless it needs to be resized
+        std::size_t offset = 0;
+        byte* mipMap = chain->addMipMap(width, height, width * height * 4, offset);
+
+        if (width == image->getWidth() && height == image->getHeight())
+        {
+            std::copy(image->getPixels(), image->getPixels() + width * height * 4, mipMap);
+        }
+        else
+        {
+            image::resample(image->getPixels(), image->getWidth(), image->getHeight(), mipMap, width, height, 4);
+        }
+
+        while (width > 1 || height > 1)
+        {
+            std::size_t reducedWidth = std::max<std::size_t>(width / 2, 1);
+            std::size_t reducedHeight = std::max<std::size_t>(height / 2, 1);
+
+            offset += width * height * 4;
+            byte* reduced = chain->addMipMap(reducedWidth, reducedHeight, reducedWidth * reducedHeight * 4, offset);
+
+            image::mipReduce(mipMap, reduced, width, height, reducedWidth, reducedHeight);
+
+            mipMap = reduced;
+            width = reducedWidth;
+            height = reducedHeight;
+        }
+
+        return chain;
+    }
 }
 
 void ImageLoader::addLoaderToMap(const ImageTypeLoader::Ptr& loader)
@@ -90,6 +190,56 @@ ImagePtr ImageLoader::imageFromVFS(const std::string& name) const
 	return ImagePtr();
 }
 
+std::vector<ImagePtr> ImageLoader::imagesFromVFS(const std::vector<std::string>& names,
+    bool mipMapChain, std::size_t maxMipMapSize) const
+{
+    std::vector<ImagePtr> images(names.size());
+
+    // One image per task, the mipmap kernels split up the larger images further
+    util::ThreadPool::GetShared().parallelFor(names.size(), [&](std::size_t i)
+    {
+        try
+        {
+            images[i] = imageFromVFS(names[i]);
+
+            if (mipMapChain)
+            {
+                images[i] = createMipMapChain(images[i], maxMipMapSize);
+            }
+        }
+        catch (const std::exception& ex)
+        {
+            // Don't let a single broken file fail the whole batch
+            rError() << "[ImageLoader] Failed to load image " << names[i] << ": " << ex.what() << std::endl;
+        }
+    });
+
+    return images;
+}
+
+std::string ImageLoader::findImageFile(const std::string& name) const
+{
+    // Same lookup order as imageFromVFS
+    for (const auto& extension : _extensions)
+    {
+        auto loaderIter = _loadersByExtension.find(extension);
+
+        if (loaderIter == _loadersByExtension.end())
+        {
+            continue;
+        }
+
+        std::string fullName = loaderIter->second->getPrefix() + name + "." + extension;
+
+        if (GlobalFileSystem().getFileCount(fullName) > 0)
+        {
+            return fullName;
+        }
+    }
+
+    return std::string();
+}
+
 ImagePtr ImageLoader::imageFromFile(const std::string& filename) const
 {
     ImagePtr image;
@@ -30,6 +30,9 @@ public:
 
     // ImageLoader implementation
     ImagePtr imageFromVFS(const std::string& vfsPath) const override;
+    std::vector<ImagePtr> imagesFromVFS(const std::vector<std::string>& vfsPaths,
+        bool mipMapChain, std::size_t maxMipMapSize) const override;
+    std::string findImageFile(const std::string& vfsPath) const override;
 	ImagePtr imageFromFile(const std::string& filename) const override;
 
     // RegisterableModule implementation
@@ -213,7 +213,8 @@ static void jpeg_buffer_src(j_decompress_ptr cinfo, void* buffer, int bufsize)
 
 // =============================================================================
 
-static char errormsg[JMSG_LENGTH_MAX];
+// Per thread, images are decoded concurrently
+static thread_local char errormsg[JMSG_LENGTH_MAX];
 
 typedef struct my_jpeg_error_mgr
 {
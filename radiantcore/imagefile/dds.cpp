@@ -30,161 +30,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "idatastream.h"
 
 #include "ddslib.h"
-#include "util/Noncopyable.h"
-#include "RGBAImage.h"
+#include "DDSImage.h"
 
 namespace image
 {
 
-// Metadata for a single MipMap level
-struct MipMapInfo
-{
-    std::size_t width;  // pixel width
-    std::size_t height; // pixel height
-
-    std::size_t size;   // memory size used by this mipmap
-
-    std::size_t offset; // offset in _pixelData to the beginning of this mipmap
-
-    MipMapInfo() :
-        width(0),
-        height(0),
-        size(0),
-        offset(0)
-    {}
-};
-typedef std::vector<MipMapInfo> MipMapInfoList;
-
-// Image subclass for DDS images
-class DDSImage: public Image, public util::Noncopyable
-{
-    // The actual pixels
-    mutable std::vector<uint8_t> _pixelData;
-
-    // The GL format of the texture data, and a boolean flag to indicate if we
-    // need to upload with glCompressedTexImage2D rather than glTexImage2D
-    GLenum _format = 0;
-    bool _compressed = true;
-
-    // Metadata for each mipmap. All pixel data is stored in _pixelData, with
-    // the offset to each mipmap stored in the _mipMapInfo list.
-    MipMapInfoList _mipMapInfo;
-
-public:
-
-    // Pass the required memory size to the constructor
-    DDSImage(std::size_t size): _pixelData(size)
-    {}
-
-    // Set the compression format
-    void setFormat(GLenum format, bool compressed)
-    {
-        _format = format;
-        _compressed = compressed;
-    }
-
-    // Add a new mipmap with the given parameters and return a pointer to its
-    // allocated byte data
-    uint8_t* addMipMap(std::size_t width, std::size_t height,
-                       std::size_t size, std::size_t offset)
-    {
-        // Create the MipMapInfo metadata and store it in our list
-        MipMapInfo info;
-        info.size = size;
-        info.width = width;
-        info.height = height;
-        info.offset = offset;
-        _mipMapInfo.push_back(info);
-
-        // Return the absolute pointer to the new mipmap's byte data
-        assert(offset < _pixelData.size());
-        return _pixelData.data() + offset;
-    }
-
-    /* Image implementation */
-    uint8_t* getPixels() const override { return _pixelData.data(); }
-    std::size_t getWidth() const override { return _mipMapInfo[0].width; }
-    std::size_t getHeight() const override { return _mipMapInfo[0].height; }
-
-    /* BindableTexture implementation */
-    TexturePtr bindTexture(const std::string& name) const
-    {
-        GLuint textureNum;
-
-        debug::assertNoGlErrors();
-
-        // Allocate a new texture number and store it into the Texture structure
-        glGenTextures(1, &textureNum);
-        glBindTexture(GL_TEXTURE_2D, textureNum);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-
-        glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
-
-        for (std::size_t i = 0; i < _mipMapInfo.size(); ++i)
-        {
-            const MipMapInfo& mipMap = _mipMapInfo[i];
-
-            if (_compressed)
-            {
-                glCompressedTexImage2D(
-                    GL_TEXTURE_2D, static_cast<GLint>(i), _format,
-                    static_cast<GLsizei>(mipMap.width),
-                    static_cast<GLsizei>(mipMap.height),
-                    0, static_cast<GLsizei>(mipMap.size),
-                    _pixelData.data() + mipMap.offset
-                );
-            }
-            else
-            {
-                // For uncompressed textures the format specifies the layout in
-                // memory, not the internal format we want OpenGL to use (which
-                // is always GL_RGB).
-                glTexImage2D(
-                    GL_TEXTURE_2D, static_cast<GLint>(i), GL_RGB,
-                    static_cast<GLsizei>(mipMap.width),
-                    static_cast<GLsizei>(mipMap.height),
-                    0, _format, GL_UNSIGNED_BYTE,
-                    _pixelData.data() + mipMap.offset
-                );
-            }
-
-            // Handle unsupported format error
-            if (glGetError() == GL_INVALID_ENUM)
-            {
-                rError() << "[DDSImage] Unable to bind texture '" << name
-                         << "': unsupported texture format " << _format
-                         << (_compressed ? " (compressed)" : " (uncompressed)")
-                         << std::endl;
-
-                return TexturePtr();
-            }
-
-            debug::assertNoGlErrors();
-        }
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(_mipMapInfo.size() - 1));
-
-        // Un-bind the texture
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        // Create and return texture object
-        BasicTexture2DPtr texObj(new BasicTexture2D(textureNum, name));
-        texObj->setWidth(getWidth());
-        texObj->setHeight(getHeight());
-
-        debug::assertNoGlErrors();
-
-        return texObj;
-    }
-
-    bool isPrecompressed() const {
-        return true;
-    }
-};
-typedef std::shared_ptr<DDSImage> DDSImagePtr;
-
 // Map DDS FOURCC values to GLenum compression formats
 static const std::map<std::string, GLenum> GL_FMT_FOR_FOURCC
 {
@@ -0,0 +1,350 @@
+#include "BackgroundMapExport.h"
+
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+
+#include "i18n.h"
+#include "itextstream.h"
+#include "imapresource.h"
+#include "ilayer.h"
+#include "iselectiongroup.h"
+#include "iselectionset.h"
+
+#include "scene/Clone.h"
+#include "scene/Traverse.h"
+#include "messages/MapFileOperation.h"
+
+#include "RootNode.h"
+#include "MapResource.h"
+#include "NodeCounter.h"
+#include "algorithm/MapExporter.h"
+
+#include <fmt/format.h>
+
+namespace map
+{
+
+namespace
+{
+
+// Wraps the MapExporter's visitor to count the written nodes.
+// Throws OperationCancelled when the cancel flag is set.
+class ProgressVisitor :
+	public scene::NodeVisitor
+{
+private:
+	scene::NodeVisitor& _visitor;
+	std::atomic<std::size_t>& _count;
+	const std::atomic<bool>& _cancelled;
+
+public:
+	ProgressVisitor(scene::NodeVisitor& visitor, std::atomic<std::size_t>& count,
+		const std::atomic<bool>& cancelled) :
+		_visitor(visitor),
+		_count(count),
+		_cancelled(cancelled)
+	{}
+
+	bool pre(const scene::INodePtr& node) override
+	{
+		if (_cancelled)
+		{
+			throw FileOperation::OperationCancelled();
+		}
+
+		if (Node_isPrimitive(node) || Node_isEntity(node))
+		{
+			++_count;
+		}
+
+		return _visitor.pre(node);
+	}
+
+	void post(const scene::INodePtr& node) override
+	{
+		_visitor.post(node);
+	}
+};
+
+}
+
+BackgroundMapExport::BackgroundMapExport(const scene::IMapRootNodePtr& sceneRoot,
+	const MapFormat& format, const std::string& filename) :
+	_filename(filename),
+	_mapFile(filename),
+	_totalNodeCount(0),
+	_writtenNodeCount(0),
+	_cancelled(false),
+	_finished(false),
+	_success(false)
+{
+	_auxFile = _mapFile;
+	_auxFile.replace_extension(MapResource::GetInfoFileExtension());
+
+	_tempMapFile = _mapFile.string() + ".tmp";
+	_tempAuxFile = _auxFile.string() + ".tmp";
+
+	if (!MapResource::FileIsWriteable(_mapFile) ||
+		(format.allowInfoFileCreation() && !MapResource::FileIsWriteable(_auxFile)))
+	{
+		throw IMapResource::OperationException(fmt::format(_("File is write-protected: {0}"), _filename));
+	}
+
+	_mapStream.open(_tempMapFile.string());
+
+	if (!_mapStream.is_open())
+	{
+		throw IMapResource::OperationException(
+			fmt::format(_("Could not open file for writing: {0}"), _tempMapFile.string()));
+	}
+
+	if (format.allowInfoFileCreation())
+	{
+		_auxStream.reset(new std::ofstream(_tempAuxFile.string()));
+
+		if (!_auxStream->is_open())
+		{
+			_mapStream.close();
+			removeTemporaryFiles();
+
+			throw IMapResource::OperationException(
+				fmt::format(_("Could not open file for writing: {0}"), _tempAuxFile.string()));
+		}
+	}
+
+	_root = CopyScene(sceneRoot);
+
+	NodeCounter counter;
+	scene::traverse(_root, counter);
+	_totalNodeCount = counter.getCount();
+
+	_writer = format.getMapWriter();
+
+	// The exporter prepares the copied scene right away, on this thread
+	if (_auxStream)
+	{
+		_exporter.reset(new MapExporter(*_writer, _root, _mapStream, *_auxStream, _totalNodeCount));
+	}
+	else
+	{
+		_exporter.reset(new MapExporter(*_writer, _root, _mapStream, _totalNodeCount));
+	}
+
+	// The message bus must not be used from the worker thread
+	_exporter->disableProgressMessages();
+
+	_result = std::async(std::launch::async, [this]() { return write(); });
+}
+
+BackgroundMapExport::~BackgroundMapExport()
+{
+	cancel();
+	finish();
+}
+
+const std::string& BackgroundMapExport::getFilename() const
+{
+	return _filename;
+}
+
+float BackgroundMapExport::getProgress() const
+{
+	if (_totalNodeCount == 0)
+	{
+		return isDone() ? 1.0f : 0.0f;
+	}
+
+	auto fraction = static_cast<float>(_writtenNodeCount) / static_cast<float>(_totalNodeCount);
+
+	return fraction < 1.0f ? fraction : 1.0f;
+}
+
+bool BackgroundMapExport::isDone() const
+{
+	return _finished || _result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void BackgroundMapExport::cancel()
+{
+	_cancelled = true;
+}
+
+bool BackgroundMapExport::finish()
+{
+	if (_finished)
+	{
+		return _success;
+	}
+
+	_finished = true;
+
+	bool written = false;
+
+	try
+	{
+		written = _result.get();
+	}
+	catch (const std::exception& ex)
+	{
+		rError() << "Failure writing map in the background: " << ex.what() << std::endl;
+	}
+
+	// Destroying the exporter cleans up the copied scene and writes the info file blocks
+	_exporter.reset();
+	_writer.reset();
+	_root.reset();
+
+	_mapStream.close();
+
+	if (_auxStream)
+	{
+		_auxStream->close();
+	}
+
+	if (written && (_mapStream.fail() || (_auxStream && _auxStream->fail())))
+	{
+		rError() << "Failure writing to file " << _tempMapFile.string() << std::endl;
+		written = false;
+	}
+
+	if (written)
+	{
+		try
+		{
+			// Replace the target files only after everything has been written
+			fs::rename(_tempMapFile, _mapFile);
+
+			if (_auxStream)
+			{
+				fs::rename(_tempAuxFile, _auxFile);
+			}
+		}
+		catch (fs::filesystem_error& ex)
+		{
+			rError() << "Could not move the written map to " << _filename << ": " << ex.what() << std::endl;
+			written = false;
+		}
+	}
+	else if (_cancelled)
+	{
+		rMessage() << "Background save of " << _filename << " cancelled." << std::endl;
+	}
+
+	if (!written)
+	{
+		// Don't leave any partially written files behind
+		removeTemporaryFiles();
+	}
+
+	_success = written;
+
+	return _success;
+}
+
+bool BackgroundMapExport::write()
+{
+	try
+	{
+		_exporter->exportMap(_root, [this](const scene::INodePtr& root, scene::NodeVisitor& visitor)
+		{
+			ProgressVisitor progressVisitor(visitor, _writtenNodeCount, _cancelled);
+			scene::traverse(root, progressVisitor);
+		});
+
+		_mapStream.flush();
+
+		return true;
+	}
+	catch (const FileOperation::OperationCancelled&)
+	{
+		return false;
+	}
+}
+
+void BackgroundMapExport::removeTemporaryFiles()
+{
+	std::remove(_tempMapFile.string().c_str());
+	std::remove(_tempAuxFile.string().c_str());
+}
+
+scene::IMapRootNodePtr BackgroundMapExport::CopyScene(const scene::IMapRootNodePtr& sceneRoot)
+{
+	auto root = std::make_shared<RootNode>(sceneRoot->name());
+
+	// Give the subscribers a chance to store their state in the scene before it is copied,
+	// like the model scale which is lost when cloning an entity
+	GlobalMapResourceManager().signal_onResourceExporting().emit(sceneRoot);
+
+	std::unordered_map<scene::INodePtr, scene::INodePtr> clones;
+
+	sceneRoot->foreachNode([&](const scene::INodePtr& node)
+	{
+		auto clone = scene::cloneNodeIncludingDescendants(node,
+			[&](const scene::INodePtr& sourceNode, const scene::INodePtr& clonedNode)
+		{
+			clones.emplace(sourceNode, clonedNode);
+		});
+
+		if (clone)
+		{
+			root->addChildNode(clone);
+		}
+
+		return true;
+	});
+
+	GlobalMapResourceManager().signal_onResourceExported().emit(sceneRoot);
+
+	// The layer memberships are part of the cloned nodes, the layers themselves are not
+	auto& layerManager = root->getLayerManager();
+
+	sceneRoot->getLayerManager().foreachLayer([&](int layerId, const std::string& layerName)
+	{
+		if (layerManager.createLayer(layerName, layerId) == -1)
+		{
+			// The default layer already exists
+			layerManager.renameLayer(layerId, layerName);
+		}
+	});
+
+	sceneRoot->getSelectionGroupManager().foreachSelectionGroup([&](selection::ISelectionGroup& group)
+	{
+		auto copiedGroup = root->getSelectionGroupManager().createSelectionGroup(group.getId());
+		copiedGroup->setName(group.getName());
+
+		group.foreachNode([&](const scene::INodePtr& node)
+		{
+			auto clone = clones.find(node);
+
+			if (clone != clones.end())
+			{
+				copiedGroup->addNode(clone->second);
+			}
+		});
+	});
+
+	sceneRoot->getSelectionSetManager().foreachSelectionSet([&](const selection::ISelectionSetPtr& set)
+	{
+		auto copiedSet = root->getSelectionSetManager().createSelectionSet(set->getName());
+
+		for (const auto& node : set->getNodes())
+		{
+			auto clone = clones.find(node);
+
+			if (clone != clones.end())
+			{
+				copiedSet->addNode(clone->second);
+			}
+		}
+	});
+
+	sceneRoot->foreachProperty([&](const std::string& key, const std::string& value)
+	{
+		root->setProperty(key, value);
+	});
+
+	return root;
+}
+
+}
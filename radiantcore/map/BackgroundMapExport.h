@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <fstream>
+#include <memory>
+
+#include "imap.h"
+#include "imapexporter.h"
+#include "imapformat.h"
+#include "os/fs.h"
+
+namespace map
+{
+
+class MapExporter;
+
+/**
+ * Writes a copy of the map on a worker thread.
+ *
+ * The constructor copies the scene, including layers, selection groups
+ * and selection sets, and prepares the copy for export, all on the
+ * calling (main) thread. The worker thread is then traversing the copy
+ * only, so the user is free to continue editing the map.
+ *
+ * The files are written to temporary files first, which replace the
+ * target files once finish() is called after a successful export.
+ */
+class BackgroundMapExport :
+	public IBackgroundMapExport
+{
+private:
+	std::string _filename;
+
+	fs::path _mapFile;
+	fs::path _auxFile;
+	fs::path _tempMapFile;
+	fs::path _tempAuxFile;
+
+	std::ofstream _mapStream;
+	std::unique_ptr<std::ofstream> _auxStream;
+
+	// The copied scene, only the worker is accessing it until it's done
+	scene::IMapRootNodePtr _root;
+
+	IMapWriterPtr _writer;
+	std::unique_ptr<MapExporter> _exporter;
+
+	std::size_t _totalNodeCount;
+	std::atomic<std::size_t> _writtenNodeCount;
+	std::atomic<bool> _cancelled;
+
+	// Holds the worker's outcome, true if the map has been written completely
+	std::future<bool> _result;
+
+	bool _finished;
+	bool _success;
+
+public:
+	// Copies the given scene and starts the worker thread.
+	// Throws IMapResource::OperationException if the files can't be opened.
+	BackgroundMapExport(const scene::IMapRootNodePtr& sceneRoot, const MapFormat& format,
+		const std::string& filename);
+
+	// Cancels and finishes the export if this hasn't happened yet
+	~BackgroundMapExport();
+
+	const std::string& getFilename() const override;
+	float getProgress() const override;
+	bool isDone() const override;
+	void cancel() override;
+	bool finish() override;
+
+private:
+	// Runs on the worker thread
+	bool write();
+
+	void removeTemporaryFiles();
+
+	static scene::IMapRootNodePtr CopyScene(const scene::IMapRootNodePtr& sceneRoot);
+};
+
+}
@@ -22,6 +22,11 @@
 #include "igame.h"
 #include "imru.h"
 #include "imapformat.h"
+#include "ibrush.h"
+#include "ipatch.h"
+#include "ishaders.h"
+#include "irender.h"
+#include "igl.h"
 
 #include "registry/registry.h"
 #include "entitylib.h"
@@ -61,6 +66,33 @@ namespace map
 namespace 
 {
     const char* const MAP_UNNAMED_STRING = N_("unnamed.map");
+
+    // Returns the names of the materials applied to the brushes and patches below the given node
+    std::set<std::string> collectMaterialNames(const scene::INodePtr& root)
+    {
+        std::set<std::string> names;
+
+        root->foreachNode([&](const scene::INodePtr& node)
+        {
+            if (Node_isBrush(node))
+            {
+                auto* brush = Node_getIBrush(node);
+
+                for (std::size_t i = 0; i < brush->getNumFaces(); ++i)
+                {
+                    names.insert(brush->getFace(i).getShader());
+                }
+            }
+            else if (Node_isPatch(node))
+            {
+                names.insert(Node_getIPatch(node)->getShader());
+            }
+
+            return true;
+        });
+
+        return names;
+    }
 }
 
 Map::Map() :
@@ -136,8 +168,18 @@ void Map::loadMapResourceFromLocation(const MapLocation& location)
     {
         radiant::ScopedLongRunningOperation blocker(_("Loading textures..."));
 
-        GlobalSceneGraph().root()->setRenderSystem(std::dynamic_pointer_cast<RenderSystem>(
-            module::GlobalModuleRegistry().getModule(MODULE_RENDERSYSTEM)));
+        auto renderSystem = std::dynamic_pointer_cast<RenderSystem>(
+            module::GlobalModuleRegistry().getModule(MODULE_RENDERSYSTEM));
+
+        // Decode the editor images in one batch, realising the shaders would load them one by one.
+        // In lighting mode the shaders are using the stage images instead.
+        if (GlobalOpenGLContext().getSharedContext() && renderSystem &&
+            renderSystem->getCurrentShaderProgram() != RenderSystem::SHADER_PROGRAM_INTERACTION)
+        {
+            GlobalMaterialManager().prefetchEditorImages(collectMaterialNames(GlobalSceneGraph().root()));
+        }
+
+        GlobalSceneGraph().root()->setRenderSystem(renderSystem);
     }
 
     // Map loading finished, emit the signal
@@ -150,8 +192,9 @@ void Map::loadMapResourceFromLocation(const MapLocation& location)
     rMessage() << GlobalCounters().getCounter(counterPatches).get() << " patches\n";
     rMessage() << GlobalCounters().getCounter(counterEntities).get() << " entities\n";
 
-    // Let the filtersystem update the filtered status of all instances
-    GlobalFilterSystem().update();
+    // The loaded nodes have been waiting for their shaders, let the
+    // filtersystem update their filtered status now
+    GlobalFilterSystem().updateInsertedNodes();
 
     // Clear the modified flag
     setModified(false);
@@ -233,6 +276,8 @@ MapFormatPtr Map::getFormat()
 // free all map elements, reinitialize the structures that depend on them
 void Map::freeMap() 
 {
+	cancelBackgroundExport();
+
 	// Fire the map unloading event, 
 	// This will de-select stuff, clear the pointfile, etc.
     emitMapEvent(MapUnloading);
@@ -347,6 +392,9 @@ bool Map::save(const MapFormatPtr& mapFormat)
 
     _saveInProgress = true;
 
+    // The regular save takes precedence over any copy written in the background
+    cancelBackgroundExport();
+
     emitMapEvent(MapSaving);
 
     util::ScopeTimer timer("map save");
@@ -435,6 +483,8 @@ void Map::saveDirect(const std::string& filename, const MapFormatPtr& mapFormat)
 
     _saveInProgress = true;
 
+    cancelBackgroundExport();
+
 	MapFormatPtr format = mapFormat;
 
 	if (!mapFormat)
@@ -460,6 +510,8 @@ void Map::saveSelected(const std::string& filename, const MapFormatPtr& mapForma
 
     _saveInProgress = true;
 
+    cancelBackgroundExport();
+
 	MapFormatPtr format = mapFormat;
 
 	if (!format)
@@ -606,6 +658,45 @@ void Map::saveCopyAs()
     }
 }
 
+IBackgroundMapExport::Ptr Map::saveCopyInBackground(const std::string& absolutePath, const MapFormatPtr& mapFormat)
+{
+    // Only one copy is written at a time
+    cancelBackgroundExport();
+
+    if (!getRoot())
+    {
+        throw IMapResource::OperationException(_("No map loaded"));
+    }
+
+    auto format = mapFormat ? mapFormat : GlobalMapFormatManager().getMapFormatForFilename(absolutePath);
+
+    if (!format)
+    {
+        throw IMapResource::OperationException(
+            fmt::format(_("Could not determine the map format of file {0}"), absolutePath));
+    }
+
+    rMessage() << "Saving map copy to " << absolutePath << " in the background" << std::endl;
+
+    auto backgroundExport = std::make_shared<BackgroundMapExport>(getRoot(), *format, absolutePath);
+    _backgroundExport = backgroundExport;
+
+    return backgroundExport;
+}
+
+void Map::cancelBackgroundExport()
+{
+    auto backgroundExport = _backgroundExport.lock();
+
+    if (backgroundExport)
+    {
+        backgroundExport->cancel();
+        backgroundExport->finish();
+    }
+
+    _backgroundExport.reset();
+}
+
 void Map::saveCopyAs(const std::string& absolutePath, const MapFormatPtr& mapFormat)
 {
     if (absolutePath.empty())
@@ -932,6 +1023,7 @@ const StringSet& Map::getDependencies() const
 		_dependencies.insert(MODULE_MAPINFOFILEMANAGER);
 		_dependencies.insert(MODULE_FILETYPES);
 		_dependencies.insert(MODULE_MAPRESOURCEMANAGER);
+		_dependencies.insert(MODULE_SHADERSYSTEM);
     }
 
     return _dependencies;
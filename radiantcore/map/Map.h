@@ -13,6 +13,7 @@
 #include "model/export/ScaledModelExporter.h"
 #include "model/export/ModelScalePreserver.h"
 #include "MapPositionManager.h"
+#include "BackgroundMapExport.h"
 #include "messages/ApplicationShutdownRequest.h"
 
 #include <sigc++/signal.h>
@@ -49,6 +50,9 @@ class Map :
 
 	bool _saveInProgress;
 
+	// The copy which is currently written by saveCopyInBackground(), if any
+	std::weak_ptr<BackgroundMapExport> _backgroundExport;
+
 	// A local helper object, observing the radiant module
 	ScaledModelExporter _scaledModelExporter;
 	std::unique_ptr<MapPositionManager> _mapPositionManager;
@@ -157,6 +161,12 @@ public:
 	void exportSelected(std::ostream& out) override;
 	void exportSelected(std::ostream& out, const MapFormatPtr& format) override;
 
+	IBackgroundMapExport::Ptr saveCopyInBackground(const std::string& absolutePath,
+		const MapFormatPtr& mapFormat = MapFormatPtr()) override;
+
+	// Stops any background save started by saveCopyInBackground() and waits for it
+	void cancelBackgroundExport();
+
 	// free all map elements, reinitialize the structures that depend on them
 	void freeMap();
 
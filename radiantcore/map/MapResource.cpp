@@ -1,6 +1,7 @@
 #include "MapResource.h"
 
 #include "i18n.h"
+#include <cstdio>
 #include <sstream>
 #include <fstream>
 #include <iostream>
@@ -22,6 +23,7 @@
 #include "os/fs.h"
 #include "scene/Traverse.h"
 #include "scenelib.h"
+#include "ThreadPool.h"
 
 #include <functional>
 #include <fmt/format.h>
@@ -35,6 +37,8 @@
 #include "messages/MapFileOperation.h"
 #include "NodeCounter.h"
 #include "MapResourceLoader.h"
+#include "format/snapshot/MapSnapshotFormat.h"
+#include "format/snapshot/MapSnapshotWriter.h"
 
 namespace map
 {
@@ -49,13 +53,121 @@ namespace
 			path_is_absolute(name.c_str()) ? name : GlobalFileSystem().findFile(name)
 		);
 	}
+
+	// Passes the exported map to the format's writer and records the same
+	// nodes in the snapshot, such that the scene is only walked once per save
+	class SnapshotCapturingWriter :
+		public IMapWriter
+	{
+	private:
+		IMapWriter& _writer;
+		format::MapSnapshotWriter& _snapshot;
+
+	public:
+		SnapshotCapturingWriter(IMapWriter& writer, format::MapSnapshotWriter& snapshot) :
+			_writer(writer),
+			_snapshot(snapshot)
+		{}
+
+		void beginWriteMap(const scene::IMapRootNodePtr& root, std::ostream& stream) override
+		{
+			_writer.beginWriteMap(root, stream);
+		}
+
+		void endWriteMap(const scene::IMapRootNodePtr& root, std::ostream& stream) override
+		{
+			_writer.endWriteMap(root, stream);
+			_snapshot.captureMap(root);
+		}
+
+		void beginWriteEntity(const IEntityNodePtr& entity, std::ostream& stream) override
+		{
+			_writer.beginWriteEntity(entity, stream);
+			_snapshot.beginWriteEntity(entity, stream);
+		}
+
+		void endWriteEntity(const IEntityNodePtr& entity, std::ostream& stream) override
+		{
+			_writer.endWriteEntity(entity, stream);
+			_snapshot.endWriteEntity(entity, stream);
+		}
+
+		void beginWriteBrush(const IBrushNodePtr& brush, std::ostream& stream) override
+		{
+			_writer.beginWriteBrush(brush, stream);
+			_snapshot.beginWriteBrush(brush, stream);
+		}
+
+		void endWriteBrush(const IBrushNodePtr& brush, std::ostream& stream) override
+		{
+			_writer.endWriteBrush(brush, stream);
+			_snapshot.endWriteBrush(brush, stream);
+		}
+
+		void beginWritePatch(const IPatchNodePtr& patch, std::ostream& stream) override
+		{
+			_writer.beginWritePatch(patch, stream);
+			_snapshot.beginWritePatch(patch, stream);
+		}
+
+		void endWritePatch(const IPatchNodePtr& patch, std::ostream& stream) override
+		{
+			_writer.endWritePatch(patch, stream);
+			_snapshot.endWritePatch(patch, stream);
+		}
+	};
+
+	// Replaces the snapshot file with the given contents, failures are logged
+	void writeSnapshotFile(const fs::path& snapshotPath, const std::string& contents)
+	{
+		fs::path tempPath = snapshotPath.string() + ".tmp";
+
+		try
+		{
+			fs::create_directories(snapshotPath.parent_path());
+
+			{
+				std::ofstream stream(tempPath.string(), std::ios::binary);
+
+				if (!stream.is_open())
+				{
+					throw std::runtime_error(fmt::format(_("Could not open file for writing: {0}"), tempPath.string()));
+				}
+
+				stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+				stream.close();
+
+				if (stream.fail())
+				{
+					throw std::runtime_error(fmt::format(_("Failure writing to file {0}"), tempPath.string()));
+				}
+			}
+
+			// Replace the old snapshot only after the new one has been written completely
+			fs::rename(tempPath, snapshotPath);
+		}
+		catch (const std::exception& ex)
+		{
+			rWarning() << "Failed to write map snapshot " << snapshotPath.string() << ": " << ex.what() << std::endl;
+
+			// Don't leave any partially written files behind
+			std::remove(tempPath.string().c_str());
+		}
+	}
 }
 
-MapResource::MapResource(const std::string& resourcePath)
+MapResource::MapResource(const std::string& resourcePath) :
+	_saveCount(0)
 {
     constructPaths(resourcePath);
 }
 
+MapResource::~MapResource()
+{
+	// Blocks until the queued snapshots are written
+	_snapshotQueue.wait();
+}
+
 void MapResource::rename(const std::string& fullPath)
 {
     constructPaths(fullPath);
@@ -140,8 +252,27 @@ void MapResource::save(const MapFormatPtr& mapFormat)
 		throw OperationException(fmt::format(_("Map path is not absolute: {0}"), fullpath));
 	}
 
+	// Snapshots still waiting to be written don't match the new file
+	++_saveCount;
+
+	// Keep the snapshot in sync if the format allows us to predict the loaded values,
+	// the nodes are captured while they are written to the map file
+	auto precision = format::MapSnapshotFormat::GetTextPrecision(*format);
+	std::shared_ptr<format::MapSnapshotWriter> snapshot;
+
+	if (precision >= 0 && supportsSnapshots())
+	{
+		snapshot = std::make_shared<format::MapSnapshotWriter>(0, precision);
+	}
+
 	// Save the actual file (throws on fail)
-	saveFile(*format, _mapRoot, scene::traverse, fullpath);
+	saveFile(*format, _mapRoot, scene::traverse, fullpath, snapshot.get());
+
+	// Hashing the written files and writing the snapshot is left to the background queue
+	if (snapshot)
+	{
+		queueSnapshot(snapshot, 0);
+	}
 
 	mapSave();
 }
@@ -263,6 +394,21 @@ RootNodePtr MapResource::loadMapNode()
 {
 	RootNodePtr rootNode;
 
+    // Try to take the shortcut through an up-to-date snapshot first
+    std::uint64_t sourceHash = supportsSnapshots() ? format::MapSnapshotFormat::CalculateSourceHash(
+        getAbsoluteResourcePath(), getAbsoluteInfoFilePath()) : 0;
+
+    if (sourceHash != 0)
+    {
+        rootNode = loadSnapshot(sourceHash);
+
+        if (rootNode)
+        {
+            rootNode->setName(_name);
+            return rootNode;
+        }
+    }
+
 	// Open a stream - will throw on failure
     auto stream = openMapfileStream();
 
@@ -281,8 +427,17 @@ RootNodePtr MapResource::loadMapNode()
             throw OperationException(_("Could not determine map format"));
         }
 
+        // Store the parsed scene, such that the next load can skip the parsing.
+        // The entities are captured as they are inserted by the loader.
+        std::shared_ptr<format::MapSnapshotWriter> snapshot;
+
+        if (sourceHash != 0 && format->getMapFormatName() != MAP_SNAPSHOT_FORMAT_NAME)
+        {
+            snapshot = std::make_shared<format::MapSnapshotWriter>(sourceHash, 0);
+        }
+
         // Instantiate a loader to process the map file stream
-        MapResourceLoader loader(stream->getStream(), *format);
+        MapResourceLoader loader(stream->getStream(), *format, snapshot.get());
 
         // Load the root from the primary stream (throws on failure or cancel)
         rootNode = loader.load();
@@ -302,6 +457,13 @@ RootNodePtr MapResource::loadMapNode()
                 loader.loadInfoFile(infoFileStream->getStream(), rootNode);
             }
         }
+
+        // Layers, groups and sets are known once the info file has been applied
+        if (snapshot && rootNode)
+        {
+            snapshot->captureMap(rootNode);
+            queueSnapshot(snapshot, sourceHash);
+        }
     }
     catch (const OperationException& ex)
     {
@@ -313,6 +475,100 @@ RootNodePtr MapResource::loadMapNode()
 	return rootNode;
 }
 
+bool MapResource::supportsSnapshots()
+{
+    return path_is_absolute(getAbsoluteResourcePath().c_str()) && !isReadOnly();
+}
+
+RootNodePtr MapResource::loadSnapshot(std::uint64_t sourceHash)
+{
+    auto snapshotPath = format::MapSnapshotFormat::GetSnapshotPath(getAbsoluteResourcePath());
+
+    if (!os::fileOrDirExists(snapshotPath))
+    {
+        return RootNodePtr();
+    }
+
+    auto stream = stream::MapResourceStream::OpenFromPath(snapshotPath);
+
+    if (!stream->isOpen() || format::MapSnapshotFormat::ReadSourceHash(stream->getStream()) != sourceHash)
+    {
+        rMessage() << "Map snapshot " << snapshotPath << " is outdated, ignoring it." << std::endl;
+        return RootNodePtr();
+    }
+
+    auto format = GlobalMapFormatManager().getMapFormatByName(MAP_SNAPSHOT_FORMAT_NAME);
+
+    if (!format)
+    {
+        return RootNodePtr();
+    }
+
+    try
+    {
+        stream->getStream().seekg(0);
+
+        rMessage() << "Loading map from snapshot " << snapshotPath << std::endl;
+
+        MapResourceLoader loader(stream->getStream(), *format);
+        return loader.load();
+    }
+    catch (const OperationException& ex)
+    {
+        if (ex.operationCancelled())
+        {
+            throw;
+        }
+
+        // A broken snapshot is not a problem, we still have the map file
+        rWarning() << "Failed to load map snapshot " << snapshotPath << ": " << ex.what() << std::endl;
+        return RootNodePtr();
+    }
+}
+
+void MapResource::queueSnapshot(const std::shared_ptr<format::MapSnapshotWriter>& snapshot, std::uint64_t sourceHash)
+{
+    auto mapPath = getAbsoluteResourcePath();
+    auto infoFilePath = getAbsoluteInfoFilePath();
+    auto saveCount = _saveCount.load();
+
+    // The queue processes the snapshots in the order they have been captured
+    _snapshotQueue.enqueue([this, snapshot, sourceHash, saveCount, mapPath, infoFilePath]() mutable
+    {
+        if (sourceHash == 0)
+        {
+            sourceHash = format::MapSnapshotFormat::CalculateSourceHash(mapPath, infoFilePath);
+        }
+
+        // Drop the snapshot if the map has been saved again, the hash might belong to the newer file
+        if (sourceHash == 0 || _saveCount != saveCount)
+        {
+            return;
+        }
+
+        std::ostringstream stream(std::ios::binary);
+
+        try
+        {
+            snapshot->setSourceHash(sourceHash);
+            snapshot->writeSnapshot(stream);
+        }
+        catch (const std::exception& ex)
+        {
+            rWarning() << "Failed to create map snapshot: " << ex.what() << std::endl;
+            return;
+        }
+
+        writeSnapshotFile(format::MapSnapshotFormat::GetSnapshotPath(mapPath), stream.str());
+    });
+}
+
+std::string MapResource::getAbsoluteInfoFilePath()
+{
+    auto fullpath = getAbsoluteResourcePath();
+    return fullpath.substr(0, fullpath.rfind('.')) + GetInfoFileExtension();
+}
+
 stream::MapResourceStream::Ptr MapResource::openFileStream(const std::string& path)
 {
     // Call the factory method to acquire a stream
@@ -335,11 +591,7 @@ stream::MapResourceStream::Ptr MapResource::openInfofileStream()
 {
     try
     {
-        auto fullpath = getAbsoluteResourcePath();
-        auto infoFilename = fullpath.substr(0, fullpath.rfind('.'));
-        infoFilename += GetInfoFileExtension();
-
-        return openFileStream(infoFilename);
+        return openFileStream(getAbsoluteInfoFilePath());
     }
     catch (const OperationException& ex)
     {
@@ -379,7 +631,8 @@ void MapResource::throwIfNotWriteable(const fs::path& path)
 }
 
 void MapResource::saveFile(const MapFormat& format, const scene::IMapRootNodePtr& root,
-						   const GraphTraversalFunc& traverse, const std::string& filename)
+						   const GraphTraversalFunc& traverse, const std::string& filename,
+						   format::MapSnapshotWriter* snapshot)
 {
 	// Actual output file paths
 	fs::path outFile = filename;
@@ -429,7 +682,13 @@ void MapResource::saveFile(const MapFormat& format, const scene::IMapRootNodePtr
 	// and the destructor will clean it up afterwards. That way
 	// we ensure a nice and tidy scene when exceptions are thrown.
 	MapExporterPtr exporter;
-	auto mapWriter = format.getMapWriter();
+	auto formatWriter = format.getMapWriter();
+	IMapWriterPtr mapWriter = formatWriter;
+
+	if (snapshot)
+	{
+		mapWriter = std::make_shared<SnapshotCapturingWriter>(*formatWriter, *snapshot);
+	}
 
 	if (format.allowInfoFileCreation())
 	{
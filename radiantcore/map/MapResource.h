@@ -4,14 +4,20 @@
 #include "imapformat.h"
 #include "imodel.h"
 #include "imap.h"
+#include <atomic>
+#include <memory>
 #include <set>
 #include "RootNode.h"
 #include "os/fs.h"
 #include "stream/MapResourceStream.h"
 
+#include "ThreadPool.h"
+
 namespace map
 {
 
+namespace format { class MapSnapshotWriter; }
+
 class MapResource :
 	public IMapResource,
 	public util::Noncopyable
@@ -32,10 +38,20 @@ private:
 	// File extension of this resource
 	std::string _extension;
 
+	// Incremented before saving the map file, queued snapshots of earlier
+	// saves are dropped since the file on disk doesn't match them anymore
+	std::atomic<std::size_t> _saveCount;
+
+	// Writes the snapshots in the background, one at a time
+	util::SerialTaskQueue _snapshotQueue;
+
 public:
 	// Constructor
 	MapResource(const std::string& resourcePath);
 
+	// Waits for the pending snapshot writes
+	~MapResource() override;
+
 	virtual void rename(const std::string& fullPath) override;
 
 	virtual bool load() override;
@@ -47,9 +63,18 @@ public:
     virtual void clear() override;
 
 	// Save the map contents to the given filename using the given MapFormat export module
-	// Throws an OperationException if anything prevents successful completion
+	// Throws an OperationException if anything prevents successful completion.
+	// The exported nodes and the map are captured by the given snapshot writer, if any.
 	static void saveFile(const MapFormat& format, const scene::IMapRootNodePtr& root,
-						 const GraphTraversalFunc& traverse, const std::string& filename);
+						 const GraphTraversalFunc& traverse, const std::string& filename,
+						 format::MapSnapshotWriter* snapshot = nullptr);
+
+    // Returns the extension of the auxiliary info file (including the leading dot character)
+    static std::string GetInfoFileExtension();
+
+    // Returns true if the file can be written to. Also returns true if the file
+    // doesn't exist (assuming the file can always be created).
+    static bool FileIsWriteable(const fs::path& path);
 
 protected:
     // Implementation-specific method to open the stream of the primary .map or .mapx file
@@ -60,13 +85,6 @@ protected:
     // May return an empty reference, may throw OperationException on failure
     virtual stream::MapResourceStream::Ptr openInfofileStream();
 
-    // Returns the extension of the auxiliary info file (including the leading dot character)
-    static std::string GetInfoFileExtension();
-
-    // Returns true if the file can be written to. Also returns true if the file
-    // doesn't exist (assuming the file can always be created).
-    static bool FileIsWriteable(const fs::path& path);
-
 private:
     void constructPaths(const std::string& resourcePath);
     std::string getAbsoluteResourcePath();
@@ -79,6 +97,20 @@ private:
 
 	RootNodePtr loadMapNode();
 
+	// Returns true if this resource can be cached as binary snapshot (writeable physical files)
+	bool supportsSnapshots();
+
+	// Loads the root node from the snapshot tagged with the given source hash,
+	// returns an empty pointer if there's no matching snapshot
+	RootNodePtr loadSnapshot(std::uint64_t sourceHash);
+
+	// Queues the captured snapshot for writing, failures are non-fatal. A source
+	// hash of 0 is calculated in the background from the files on disk.
+	void queueSnapshot(const std::shared_ptr<format::MapSnapshotWriter>& snapshot, std::uint64_t sourceHash);
+
+	// Returns the absolute path to the .darkradiant file
+	std::string getAbsoluteInfoFilePath();
+
 	void connectMap();
 
 	// Opens a stream for the given path, which might be VFS path or an absolute one. 
@@ -10,9 +10,10 @@
 namespace map
 {
 
-MapResourceLoader::MapResourceLoader(std::istream& stream, const MapFormat& format) :
+MapResourceLoader::MapResourceLoader(std::istream& stream, const MapFormat& format, format::MapSnapshotWriter* snapshot) :
     _stream(stream),
-    _format(format)
+    _format(format),
+    _snapshot(snapshot)
 {}
 
 RootNodePtr MapResourceLoader::load()
@@ -23,7 +24,7 @@ RootNodePtr MapResourceLoader::load()
     try
     {
         // Our importer taking care of scene insertion
-        MapImporter importFilter(root, _stream);
+        MapImporter importFilter(root, _stream, _snapshot);
 
         // Acquire a map reader/parser
         IMapReaderPtr reader = _format.getMapReader(importFilter);
@@ -12,6 +12,8 @@
 namespace map
 {
 
+namespace format { class MapSnapshotWriter; }
+
 /**
  * A MapResourceLoader is responsible of loading/deserialising
  * the map root node from one or more streams.
@@ -25,8 +27,14 @@ private:
     // Maps entity,primitive indices to nodes, used in infofile parsing code
     NodeIndexMap _indexMapping;
 
+    // Optional, captures the entities as they are inserted
+    format::MapSnapshotWriter* _snapshot;
+
 public:
-    MapResourceLoader(std::istream& stream, const MapFormat& format);
+    // If a snapshot writer is passed, the loaded entities and primitives are
+    // captured by it. The map itself is left to the caller (after loading
+    // the info file), see MapSnapshotWriter::captureMap().
+    MapResourceLoader(std::istream& stream, const MapFormat& format, format::MapSnapshotWriter* snapshot = nullptr);
 
     // Process the stream passed to the constructor, returns
     // the root node
@@ -10,6 +10,7 @@
 #include "registry/registry.h"
 #include "string/string.h"
 #include "messages/MapFileOperation.h"
+#include "../format/snapshot/MapSnapshotWriter.h"
 
 namespace map
 {
@@ -20,13 +21,15 @@ namespace
 	std::size_t EMPTY_PRIMITVE_NUM = std::numeric_limits<std::size_t>::max();
 }
 
-MapImporter::MapImporter(const scene::IMapRootNodePtr& root, std::istream& inputStream) :
+MapImporter::MapImporter(const scene::IMapRootNodePtr& root, std::istream& inputStream,
+	format::MapSnapshotWriter* snapshot) :
 	_root(root),
 	_dialogEventLimiter(registry::getValue<int>(RKEY_MAP_LOAD_STATUS_INTERLEAVE)),
 	_entityCount(0),
 	_primitiveCount(0),
 	_inputStream(inputStream),
-	_fileSize(0)
+	_fileSize(0),
+	_snapshot(snapshot)
 {
 	// Get the file size, for handling the progress dialog
 	_inputStream.seekg(0, std::ios::end);
@@ -74,6 +77,12 @@ bool MapImporter::addEntity(const scene::INodePtr& entityNode)
 
 	_root->addChildNode(entityNode);
 
+	// The entity is complete, its primitives have been added before
+	if (_snapshot)
+	{
+		_snapshot->captureEntity(entityNode);
+	}
+
 	return true;
 }
 
@@ -10,6 +10,8 @@
 namespace map
 {
 
+namespace format { class MapSnapshotWriter; }
+
 /**
  * A default map import filter/handler. An instance of this class
  * is required to get a valid IMapReader from the MapFormat module.
@@ -19,6 +21,8 @@ namespace map
  *
  * This IMapImportFilter implementation will be sending messages across
  * the wire for the UI to react to, displaying progress, etc.
+ * The inserted entities can be captured by a snapshot writer on the way,
+ * which saves an export pass over the freshly loaded map.
  */
 class MapImporter :
 	public IMapImportFilter
@@ -43,8 +47,11 @@ private:
 	// Keep track of all the entities and primitives for later retrieval
 	NodeIndexMap _nodes;
 
+	format::MapSnapshotWriter* _snapshot;
+
 public:
-	MapImporter(const scene::IMapRootNodePtr& root, std::istream& inputStream);
+	MapImporter(const scene::IMapRootNodePtr& root, std::istream& inputStream,
+		format::MapSnapshotWriter* snapshot = nullptr);
 
 	~MapImporter();
 
@@ -4,11 +4,19 @@
 #include "ieclass.h"
 #include "igame.h"
 #include "ientity.h"
+#include "ilayer.h"
+#include "imap.h"
 #include "string/string.h"
+#include "stream/ContiguousStreamBuf.h"
+#include "ThreadPool.h"
 
 #include "Doom3MapFormat.h"
+#include "EntityBlockScanner.h"
 
 #include "i18n.h"
+#include <atomic>
+#include <future>
+#include <memory>
 #include <fmt/format.h>
 
 #include "primitiveparsers/BrushDef.h"
@@ -18,10 +26,19 @@
 
 namespace map {
 
+namespace
+{
+	// The number of primitives parsed by a single worker task. Maps containing
+	// less than two batches are not worth the overhead of the parallel parser.
+	const std::size_t PRIMITIVES_PER_TASK = 64;
+}
+
 Doom3MapReader::Doom3MapReader(IMapImportFilter& importFilter) : 
 	_importFilter(importFilter),
 	_entityCount(0),
-	_primitiveCount(0)
+	_primitiveCount(0),
+	_primitiveLayer(0),
+	_syncStreamPosition([]() {})
 {}
 
 void Doom3MapReader::readFromStream(std::istream& stream)
@@ -29,9 +46,47 @@ void Doom3MapReader::readFromStream(std::istream& stream)
 	// Call the virtual method to initialise the primitve parser map (if not done yet)
 	initPrimitiveParsers();
 
-	// The tokeniser used to split the stream into pieces
-	parser::BasicDefTokeniser<std::istream> tok(stream);
+	// Primitives go to the active layer, like the ones created by the brush and patch modules
+	auto root = GlobalMapModule().getRoot();
+	_primitiveLayer = root ? root->getLayerManager().getActiveLayer() : 0;
+
+	// Map files opened by the MapResource are backed by a contiguous memory block
+	// (memory-mapped file or pre-loaded PAK contents), these are tokenised in place
+	auto contiguousBuffer = dynamic_cast<stream::ContiguousStreamBuf*>(stream.rdbuf());
+
+	if (contiguousBuffer != nullptr)
+	{
+		auto startPosition = contiguousBuffer->getPosition();
+
+		if (readInParallel(*contiguousBuffer, startPosition))
+		{
+			return;
+		}
+
+		parser::BasicDefTokeniser<std::string_view> tok(contiguousBuffer->getContents().substr(startPosition));
+
+		// The stream position is not advanced by the tokeniser, keep it in sync
+		// since the import filter is using it to calculate the progress fraction
+		_syncStreamPosition = [&]()
+		{
+			contiguousBuffer->setPosition(startPosition + tok.getPosition());
+		};
+
+		readFromTokeniser(tok);
+	}
+	else
+	{
+		// The tokeniser used to split the stream into pieces
+		parser::BasicDefTokeniser<std::istream> tok(stream);
+
+		readFromTokeniser(tok);
+	}
 
+	_syncStreamPosition = []() {};
+}
+
+void Doom3MapReader::readFromTokeniser(parser::DefTokeniser& tok)
+{
 	// Try to parse the map version (throws on failure)
 	parseMapVersion(tok);
 
@@ -121,6 +176,15 @@ void Doom3MapReader::parsePrimitive(parser::DefTokeniser& tok, const scene::INod
 {
     _primitiveCount++;
 
+	scene::INodePtr primitive = createPrimitive(tok, _primitiveCount);
+
+	// Now add the primitive as a child of the entity
+	_syncStreamPosition();
+	_importFilter.addPrimitiveToEntity(primitive, parentEntity);
+}
+
+scene::INodePtr Doom3MapReader::createPrimitive(parser::DefTokeniser& tok, std::size_t primitiveNumber) const
+{
 	std::string primitiveKeyword = tok.nextToken();
 
 	// Get a parser for this keyword
@@ -136,21 +200,20 @@ void Doom3MapReader::parsePrimitive(parser::DefTokeniser& tok, const scene::INod
 	// Try to parse the primitive, throwing exception if failed
 	try
 	{
-		scene::INodePtr primitive = parser->parse(tok);
+		scene::INodePtr primitive = parser->parse(tok, _primitiveLayer);
 
 		if (!primitive)
 		{
-			std::string text = fmt::format(_("Primitive #{0:d}: parse error"), _primitiveCount);
+			std::string text = fmt::format(_("Primitive #{0:d}: parse error"), primitiveNumber);
 			throw FailureException(text);
 		}
 
-		// Now add the primitive as a child of the entity
-		_importFilter.addPrimitiveToEntity(primitive, parentEntity); 
+		return primitive;
 	}
 	catch (parser::ParseException& e)
 	{
 		// Translate ParseExceptions to FailureExceptions
-		std::string text = fmt::format(_("Primitive #{0:d}: parse exception {1}"), _primitiveCount, e.what());
+		std::string text = fmt::format(_("Primitive #{0:d}: parse exception {1}"), primitiveNumber, e.what());
 		throw FailureException(text);
 	}
 }
@@ -254,7 +317,170 @@ void Doom3MapReader::parseEntity(parser::DefTokeniser& tok)
 	}
 
 	// Insert the entity
+	_syncStreamPosition();
 	_importFilter.addEntity(entity);
 }
 
+Doom3MapReader::EntityKeyValues Doom3MapReader::parseKeyValues(const std::string_view& text) const
+{
+	EntityKeyValues keyValues;
+
+	try
+	{
+		parser::BasicDefTokeniser<std::string_view> tok(text);
+
+		while (tok.hasMoreTokens())
+		{
+			std::string key = tok.nextToken();
+
+			// A missing value means that the next token is the brace following the spawnargs
+			std::string value = tok.hasMoreTokens() ? tok.nextToken() : std::string(1, *(text.data() + text.size()));
+
+			// Sanity check (invalid number of tokens will get us out of sync)
+			if (value == "{" || value == "}")
+			{
+				std::string errMsg = fmt::format(_("Parsed invalid value '{0}' for key '{1}'"), value, key);
+				throw FailureException(errMsg);
+			}
+
+			keyValues.insert(EntityKeyValues::value_type(key, value));
+		}
+	}
+	catch (parser::ParseException& e)
+	{
+		throw FailureException(e.what());
+	}
+
+	return keyValues;
+}
+
+bool Doom3MapReader::readInParallel(stream::ContiguousStreamBuf& buffer, std::size_t startPosition)
+{
+	if (util::ThreadPool::GetDefaultNumThreads() < 2)
+	{
+		return false;
+	}
+
+	auto contents = buffer.getContents().substr(startPosition);
+
+	// Locate the entity and primitive blocks first. Malformed files are left
+	// to the sequential parser, which is producing the more detailed errors.
+	std::unique_ptr<EntityBlockScanner> scanner;
+
+	try
+	{
+		scanner.reset(new EntityBlockScanner(contents));
+	}
+	catch (parser::ParseException& e)
+	{
+		rMessage() << "[mapdoom3] Falling back to sequential parsing: " << e.what() << std::endl;
+		return false;
+	}
+
+	if (scanner->getNumPrimitives() < 2 * PRIMITIVES_PER_TASK)
+	{
+		return false;
+	}
+
+	parser::BasicDefTokeniser<std::string_view> headerTok(scanner->getHeader());
+	parseMapVersion(headerTok);
+
+	if (headerTok.hasMoreTokens())
+	{
+		return false; // unexpected content in front of the first entity
+	}
+
+	// Worker tasks check this flag to skip their work after the main thread
+	// has been interrupted by a failure or a cancelled operation
+	std::atomic<bool> cancelled(false);
+
+	typedef std::vector<scene::INodePtr> Primitives;
+	std::vector<std::future<Primitives>> tasks;
+
+	auto& pool = util::ThreadPool::GetShared();
+
+	for (const auto& entity : scanner->getEntities())
+	{
+		for (std::size_t first = 0; first < entity.primitives.size(); first += PRIMITIVES_PER_TASK)
+		{
+			auto last = std::min(first + PRIMITIVES_PER_TASK, entity.primitives.size());
+
+			tasks.emplace_back(pool.enqueue([this, &cancelled, &entity, first, last]()
+			{
+				Primitives primitives;
+
+				if (cancelled) return primitives;
+
+				primitives.reserve(last - first);
+
+				for (auto i = first; i < last; ++i)
+				{
+					parser::BasicDefTokeniser<std::string_view> tok(entity.primitives[i]);
+					primitives.emplace_back(createPrimitive(tok, i + 1));
+				}
+
+				return primitives;
+			}));
+		}
+	}
+
+	auto task = tasks.begin();
+
+	try
+	{
+		// Create the entities and insert the nodes in the order of the map file
+		for (const auto& entity : scanner->getEntities())
+		{
+			try
+			{
+				scene::INodePtr node = createEntity(parseKeyValues(entity.keyValues));
+
+				_primitiveCount = 0;
+
+				for (std::size_t first = 0; first < entity.primitives.size(); first += PRIMITIVES_PER_TASK)
+				{
+					// Rethrows any exception of the worker
+					Primitives primitives = (task++)->get();
+
+					for (const auto& primitive : primitives)
+					{
+						buffer.setPosition(startPosition + scanner->getEndOffset(entity.primitives[_primitiveCount]));
+						_importFilter.addPrimitiveToEntity(primitive, node);
+
+						// Stray tokens behind a primitive are read as spawnargs by the sequential
+						// parser, which fails on an odd count. The parsed values are discarded there.
+						parseKeyValues(entity.primitiveTrailers[_primitiveCount++]);
+					}
+				}
+
+				buffer.setPosition(startPosition + entity.end);
+				_importFilter.addEntity(node);
+			}
+			catch (FailureException& e)
+			{
+				std::string text = fmt::format(_("Failed parsing entity {0:d}:\n{1}"), _entityCount, e.what());
+
+				// Re-throw with more text
+				throw FailureException(text);
+			}
+
+			_entityCount++;
+		}
+	}
+	catch (...)
+	{
+		// The remaining tasks are referencing the local variables, wait for them to finish
+		cancelled = true;
+
+		for (; task != tasks.end(); ++task)
+		{
+			task->wait();
+		}
+
+		throw;
+	}
+
+	return true;
+}
+
 } // namespace map
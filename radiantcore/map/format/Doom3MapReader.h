@@ -2,10 +2,13 @@
 #define NODE_IMPORTER_H_
 
 #include <map>
+#include <functional>
 #include "inode.h"
 #include "imapformat.h"
 #include "parser/DefTokeniser.h"
 
+namespace stream { class ContiguousStreamBuf; }
+
 namespace map {
 
 class Doom3MapReader :
@@ -23,10 +26,18 @@ protected:
 	// The number of primitives of the currently parsed entity
 	std::size_t _primitiveCount;
 
+	// The layer the primitives are created in, the active layer of the current map.
+	// Resolved on the calling thread, the parsers might run on worker threads.
+	int _primitiveLayer;
+
 	// Our list of primitive parsers
 	typedef std::map<std::string, PrimitiveParserPtr> PrimitiveParsers;
 	PrimitiveParsers _primitiveParsers;
 
+	// Moves the input stream's read position to the one of the tokeniser,
+	// to be called before nodes are handed to the import filter
+	std::function<void()> _syncStreamPosition;
+
 public:
 	Doom3MapReader(IMapImportFilter& importFilter);
 
@@ -40,6 +51,9 @@ protected:
 	// Adds a specific primitive parser
 	virtual void addPrimitiveParser(const PrimitiveParserPtr& parser);
 
+	// Parses the map version and all entities from the given tokeniser
+	virtual void readFromTokeniser(parser::DefTokeniser& tok);
+
 	// Parse the version tag at the beginning, throws on failure
 	virtual void parseMapVersion(parser::DefTokeniser& tok);
 
@@ -49,6 +63,22 @@ protected:
 	// Parse the primitive block and insert the child into the given parent
 	virtual void parsePrimitive(parser::DefTokeniser& tok, const scene::INodePtr& parentEntity);
 
+	// Parses the primitive following in the given tokeniser and returns the node,
+	// throws on failure. This doesn't change any state of this reader, and might
+	// be called from several worker threads at once.
+	scene::INodePtr createPrimitive(parser::DefTokeniser& tok, std::size_t primitiveNumber) const;
+
+	// Attempts to split the given buffer into entity blocks which are parsed on
+	// several worker threads, the nodes are handed to the import filter on the
+	// calling thread, in the same order as the sequential parser would do.
+	// Returns false if the contents are not suited for parallel parsing, in which
+	// case nothing has been read and the caller should fall back to the tokeniser.
+	bool readInParallel(stream::ContiguousStreamBuf& buffer, std::size_t startPosition);
+
+	// Parses the spawnargs of an entity block as located by the EntityBlockScanner,
+	// the text must be followed by the brace terminating the spawnarg section
+	EntityKeyValues parseKeyValues(const std::string_view& text) const;
+
 	// Create an entity with the given properties and layers
 	scene::INodePtr createEntity(const EntityKeyValues& keyValues);
 };
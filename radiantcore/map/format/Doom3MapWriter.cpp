@@ -1,5 +1,7 @@
 #include "Doom3MapWriter.h"
 
+#include <chrono>
+
 #include "igame.h"
 #include "ientity.h"
 
@@ -14,6 +16,13 @@ namespace map
 namespace
 {
 
+// The number of deferred values to collect before submitting a buffer,
+// large enough to keep the scheduling overhead low
+const std::size_t VALUES_PER_BLOCK = 4096;
+
+// Limit the number of blocks waiting to be written, for the memory's sake
+const std::size_t MAX_PENDING_BLOCKS_PER_THREAD = 4;
+
 // Escape the line break characters in the given input string to \n
 inline std::string escapeLineBreaks(const std::string& input)
 {
@@ -35,65 +44,123 @@ void Doom3MapWriter::beginWriteMap(const scene::IMapRootNodePtr& root, std::ostr
 
 void Doom3MapWriter::endWriteMap(const scene::IMapRootNodePtr& root, std::ostream& stream)
 {
-	// nothing
+	// Write everything that is still in the queue
+	flushBuffer(stream, true);
 }
 
 void Doom3MapWriter::beginWriteEntity(const IEntityNodePtr& entity, std::ostream& stream)
 {
+	auto& buffer = getBuffer(stream);
+
 	// Write out the entity number comment
-	stream << "// entity " << _entityCount++ << std::endl;
+	buffer << "// entity " << _entityCount++ << "\n";
 
 	// Entity opening brace
-	stream << "{" << std::endl;
+	buffer << "{\n";
 
 	// Entity key values
-	writeEntityKeyValues(entity, stream);
+	writeEntityKeyValues(entity, buffer);
 }
 
-void Doom3MapWriter::writeEntityKeyValues(const IEntityNodePtr& entity, std::ostream& stream)
+void Doom3MapWriter::writeEntityKeyValues(const IEntityNodePtr& entity, MapTextBuffer& buffer)
 {
 	// Export the entity key values
     entity->getEntity().forEachKeyValue([&](const std::string& key, const std::string& value)
     {
-        stream << "\"" << key << "\" \"" << escapeLineBreaks(value) << "\"" << std::endl;
+        buffer << "\"" << key << "\" \"" << escapeLineBreaks(value) << "\"\n";
     });
 }
 
 void Doom3MapWriter::endWriteEntity(const IEntityNodePtr& entity, std::ostream& stream)
 {
 	// Write the closing brace for the entity
-	stream << "}" << std::endl;
+	getBuffer(stream) << "}\n";
 
 	// Reset the primitive count again
 	_primitiveCount = 0;
+
+	flushBuffer(stream, false);
 }
 
 void Doom3MapWriter::beginWriteBrush(const IBrushNodePtr& brush, std::ostream& stream)
 {
+	auto& buffer = getBuffer(stream);
+
 	// Primitive count comment
-	stream << "// primitive " << _primitiveCount++ << std::endl;
+	buffer << "// primitive " << _primitiveCount++ << "\n";
 
 	// Export brushDef3 definition to stream
-	BrushDef3Exporter::exportBrush(stream, brush);
+	BrushDef3Exporter::exportBrush(buffer, brush);
 }
 
 void Doom3MapWriter::endWriteBrush(const IBrushNodePtr& brush, std::ostream& stream)
 {
-	// nothing
+	flushBuffer(stream, false);
 }
 
 void Doom3MapWriter::beginWritePatch(const IPatchNodePtr& patch, std::ostream& stream)
 {
+	auto& buffer = getBuffer(stream);
+
 	// Primitive count comment
-	stream << "// primitive " << _primitiveCount++ << std::endl;
+	buffer << "// primitive " << _primitiveCount++ << "\n";
 
 	// Export patch here _mapStream
-	PatchDefExporter::exportPatch(stream, patch);
+	PatchDefExporter::exportPatch(buffer, patch);
 }
 
 void Doom3MapWriter::endWritePatch(const IPatchNodePtr& patch, std::ostream& stream)
 {
-	// nothing
+	flushBuffer(stream, false);
+}
+
+MapTextBuffer& Doom3MapWriter::getBuffer(std::ostream& stream)
+{
+	if (!_buffer)
+	{
+		// Take over the precision the MapExporter configured on the stream
+		_buffer.reset(new MapTextBuffer(static_cast<int>(stream.precision())));
+	}
+
+	return *_buffer;
+}
+
+void Doom3MapWriter::flushBuffer(std::ostream& stream, bool force)
+{
+	if (_buffer && !_buffer->empty() && (force || _buffer->getNumDeferredValues() >= VALUES_PER_BLOCK))
+	{
+		std::shared_ptr<MapTextBuffer> buffer(std::move(_buffer));
+
+		if (util::ThreadPool::GetDefaultNumThreads() > 1)
+		{
+			_pendingBlocks.emplace_back(util::ThreadPool::GetShared().enqueue([buffer]() { return buffer->format(); }));
+		}
+		else
+		{
+			// Single-threaded: no need to defer anything
+			auto text = buffer->format();
+			stream.write(text.data(), text.size());
+		}
+	}
+
+	auto maxPendingBlocks = util::ThreadPool::GetShared().getNumThreads() * MAX_PENDING_BLOCKS_PER_THREAD;
+
+	while (!_pendingBlocks.empty())
+	{
+		auto& block = _pendingBlocks.front();
+
+		// Only wait for unfinished blocks if we're forced to or the queue is getting too long
+		if (!force && _pendingBlocks.size() <= maxPendingBlocks &&
+			block.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			break;
+		}
+
+		auto text = block.get();
+		stream.write(text.data(), text.size());
+
+		_pendingBlocks.pop_front();
+	}
 }
 
 } // namespace
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <deque>
+#include <future>
+#include <memory>
 #include "imapformat.h"
+#include "ThreadPool.h"
+#include "primitivewriters/MapTextBuffer.h"
 
 namespace map
 {
@@ -9,6 +14,10 @@ namespace map
  * Standard implementation of a Doom 3 Map file writer (Map Version 2)
  *
  * Creates a plaintext file with brushDef3/patchDef2/patchDef3 primitives.
+ *
+ * The map text is assembled in MapTextBuffers, which are converted to their
+ * final form on worker threads while the scene traversal continues. The
+ * converted blocks are written to the stream in order.
  */
 class Doom3MapWriter :
 	public IMapWriter
@@ -18,6 +27,14 @@ protected:
 	std::size_t _entityCount;
 	std::size_t _primitiveCount;
 
+private:
+	// The text of the nodes visited since the last submission
+	std::unique_ptr<MapTextBuffer> _buffer;
+
+	// The blocks submitted to the shared thread pool in file order, waiting to be
+	// written to the stream. Each task keeps its buffer alive on its own.
+	std::deque<std::future<std::string>> _pendingBlocks;
+
 public:
 	Doom3MapWriter();
 
@@ -37,7 +54,15 @@ public:
 	virtual void endWritePatch(const IPatchNodePtr& patch, std::ostream& stream) override;
 
 protected:
-	void writeEntityKeyValues(const IEntityNodePtr& entity, std::ostream& stream);
+	// Returns the buffer the text of the current node has to be appended to
+	MapTextBuffer& getBuffer(std::ostream& stream);
+
+	void writeEntityKeyValues(const IEntityNodePtr& entity, MapTextBuffer& buffer);
+
+private:
+	// Hands the buffer over to the workers (if it's got enough contents or force is set)
+	// and writes all the blocks that are finished to the stream
+	void flushBuffer(std::ostream& stream, bool force);
 };
 
 } // namespace
@@ -0,0 +1,174 @@
+#include "EntityBlockScanner.h"
+
+#include "parser/ParseException.h"
+#include <fmt/format.h>
+
+namespace map
+{
+
+namespace
+{
+	inline bool isWhitespace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+	}
+}
+
+EntityBlockScanner::EntityBlockScanner(std::string_view text) :
+	_text(text),
+	_numPrimitives(0)
+{
+	scan();
+}
+
+bool EntityBlockScanner::skipCommentOrQuote(std::size_t& pos) const
+{
+	const auto size = _text.size();
+
+	if (_text[pos] == '"')
+	{
+		// Backslashes are escaping the next character, like in the DefTokeniser
+		for (++pos; pos < size && _text[pos] != '"'; ++pos)
+		{
+			if (_text[pos] == '\\') ++pos;
+		}
+
+		pos = pos < size ? pos + 1 : size;
+		return true;
+	}
+
+	if (_text[pos] != '/' || pos + 1 >= size)
+	{
+		return false;
+	}
+
+	if (_text[pos + 1] == '/')
+	{
+		auto lineEnd = _text.find('\n', pos + 2);
+		pos = lineEnd != std::string_view::npos ? lineEnd + 1 : size;
+		return true;
+	}
+
+	if (_text[pos + 1] == '*')
+	{
+		auto commentEnd = _text.find("*/", pos + 2);
+		pos = commentEnd != std::string_view::npos ? commentEnd + 2 : size;
+		return true;
+	}
+
+	return false;
+}
+
+void EntityBlockScanner::scan()
+{
+	const auto size = _text.size();
+
+	std::size_t pos = 0;
+	std::size_t depth = 0;
+	std::size_t entityStart = 0;
+	std::size_t primitiveStart = 0;
+	std::size_t primitiveEnd = 0;
+	bool headerFound = false;
+
+	while (pos < size)
+	{
+		char c = _text[pos];
+
+		if (skipCommentOrQuote(pos))
+		{
+			// A quoted string outside of an entity is only allowed in the header
+			if (depth == 0 && c == '"' && headerFound)
+			{
+				throw parser::ParseException(fmt::format(
+					"Unexpected quoted string after entity {0:d}", _entities.size() - 1));
+			}
+
+			continue;
+		}
+
+		if (c == '{')
+		{
+			if (depth == 0)
+			{
+				if (!headerFound)
+				{
+					_header = _text.substr(0, pos);
+					headerFound = true;
+				}
+
+				_entities.emplace_back();
+				entityStart = pos + 1;
+			}
+			else if (depth == 1)
+			{
+				auto& entity = _entities.back();
+
+				if (entity.primitives.empty())
+				{
+					entity.keyValues = _text.substr(entityStart, pos - entityStart);
+				}
+				else
+				{
+					entity.primitiveTrailers.push_back(_text.substr(primitiveEnd, pos - primitiveEnd));
+				}
+
+				primitiveStart = pos + 1;
+			}
+
+			++depth;
+		}
+		else if (c == '}')
+		{
+			if (depth == 0)
+			{
+				throw parser::ParseException(fmt::format(
+					"Unbalanced closing brace at offset {0:d}", pos));
+			}
+
+			if (depth == 2)
+			{
+				_entities.back().primitives.push_back(_text.substr(primitiveStart, pos + 1 - primitiveStart));
+				++_numPrimitives;
+
+				primitiveEnd = pos + 1;
+			}
+			else if (depth == 1)
+			{
+				auto& entity = _entities.back();
+
+				if (entity.primitives.empty())
+				{
+					entity.keyValues = _text.substr(entityStart, pos - entityStart);
+				}
+				else
+				{
+					entity.primitiveTrailers.push_back(_text.substr(primitiveEnd, pos - primitiveEnd));
+				}
+
+				entity.end = pos + 1;
+			}
+
+			--depth;
+		}
+		else if (depth == 0 && headerFound && !isWhitespace(c))
+		{
+			throw parser::ParseException(fmt::format(
+				"Unexpected token after entity {0:d}, expected an opening brace", _entities.size() - 1));
+		}
+
+		++pos;
+	}
+
+	if (depth > 0)
+	{
+		throw parser::ParseException(fmt::format(
+			"Unexpected end of file in entity {0:d}", _entities.size() - 1));
+	}
+
+	if (!headerFound)
+	{
+		_header = _text;
+	}
+}
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+namespace map
+{
+
+/**
+ * Splits the text of a Doom 3 style map file into its entity blocks and
+ * primitive blocks, without tokenising their contents. This is a single
+ * fast pass over the characters, which is only aware of braces, quoted
+ * strings and comments, such that the actual parsing of the blocks can
+ * be distributed across several threads afterwards.
+ *
+ * All returned views are pointing into the scanned text.
+ */
+class EntityBlockScanner
+{
+public:
+	struct EntityBlock
+	{
+		// The spawnarg section, between the opening brace of the entity
+		// and the start of its first primitive (or the closing brace)
+		std::string_view keyValues;
+
+		// The contents of each primitive block, starting right after its
+		// opening brace and including the closing brace. This is the text
+		// the primitive parsers expect to see after the opening brace
+		std::vector<std::string_view> primitives;
+
+		// The text following each primitive block, up to the next primitive
+		// or the closing brace of the entity. This is usually empty, the
+		// sequential parser is reading any tokens in there as spawnargs.
+		std::vector<std::string_view> primitiveTrailers;
+
+		// Offset right behind the entity's closing brace
+		std::size_t end;
+	};
+
+	typedef std::vector<EntityBlock> EntityBlocks;
+
+private:
+	std::string_view _text;
+
+	// Everything in front of the first entity (the version tag)
+	std::string_view _header;
+
+	EntityBlocks _entities;
+	std::size_t _numPrimitives;
+
+public:
+	// Scans the whole text, throws parser::ParseException on unbalanced
+	// braces or on unexpected content between the entity blocks
+	EntityBlockScanner(std::string_view text);
+
+	const std::string_view& getHeader() const
+	{
+		return _header;
+	}
+
+	const EntityBlocks& getEntities() const
+	{
+		return _entities;
+	}
+
+	// The number of primitives summed up over all entities
+	std::size_t getNumPrimitives() const
+	{
+		return _numPrimitives;
+	}
+
+	// Returns the offset of the first character after the given view
+	std::size_t getEndOffset(const std::string_view& view) const
+	{
+		return static_cast<std::size_t>(view.data() + view.size() - _text.data());
+	}
+
+private:
+	void scan();
+
+	// Advances pos past the comment or quoted string starting at pos,
+	// returns false if the character at pos doesn't start any of these
+	bool skipCommentOrQuote(std::size_t& pos) const;
+};
+
+}
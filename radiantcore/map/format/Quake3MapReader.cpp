@@ -4,6 +4,8 @@
 #include "ieclass.h"
 #include "igame.h"
 #include "ientity.h"
+#include "ilayer.h"
+#include "imap.h"
 #include "string/string.h"
 
 #include "i18n.h"
@@ -19,7 +21,8 @@ namespace map {
 Quake3MapReader::Quake3MapReader(IMapImportFilter& importFilter) : 
 	_importFilter(importFilter),
 	_entityCount(0),
-	_primitiveCount(0)
+	_primitiveCount(0),
+	_primitiveLayer(0)
 {}
 
 void Quake3MapReader::readFromStream(std::istream& stream)
@@ -27,6 +30,10 @@ void Quake3MapReader::readFromStream(std::istream& stream)
 	// Call the virtual method to initialise the primitve parser map (if not done yet)
 	initPrimitiveParsers();
 
+	// Primitives go to the active layer, like the ones created by the brush and patch modules
+	auto root = GlobalMapModule().getRoot();
+	_primitiveLayer = root ? root->getLayerManager().getActiveLayer() : 0;
+
 	// The tokeniser used to split the stream into pieces
 	parser::BasicDefTokeniser<std::istream> tok(stream);
 
@@ -94,7 +101,7 @@ void Quake3MapReader::parsePrimitive(parser::DefTokeniser& tok, const scene::INo
 	// Try to parse the primitive, throwing exception if failed
 	try
 	{
-		scene::INodePtr primitive = parser->parse(tok);
+		scene::INodePtr primitive = parser->parse(tok, _primitiveLayer);
 
 		if (!primitive)
 		{
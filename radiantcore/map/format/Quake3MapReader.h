@@ -22,6 +22,10 @@ protected:
 	// The number of primitives of the currently parsed entity
 	std::size_t _primitiveCount;
 
+	// The layer the primitives are created in, the active layer of the current map.
+	// Resolved on the calling thread, the parsers might run on worker threads.
+	int _primitiveLayer;
+
 	// Our list of primitive parsers
 	typedef std::map<std::string, PrimitiveParserPtr> PrimitiveParsers;
 	PrimitiveParsers _primitiveParsers;
@@ -23,20 +23,23 @@ public:
 
 	virtual void beginWriteBrush(const IBrushNodePtr& brush, std::ostream& stream) override
 	{
+		auto& buffer = getBuffer(stream);
+
 		// Primitive count comment
-		stream << "// brush " << _primitiveCount++ << std::endl;
+		buffer << "// brush " << _primitiveCount++ << "\n";
 
 		// Export brushDef definition to stream
-		BrushDefExporter::exportBrush(stream, brush);
+		BrushDefExporter::exportBrush(buffer, brush);
 	}
 
 	virtual void beginWritePatch(const IPatchNodePtr& patch, std::ostream& stream) override
 	{
 		// Primitive count comment, not a typo, patches also seem to have "brush" in their comments
-		stream << "// brush " << _primitiveCount++ << std::endl;
+		auto& buffer = getBuffer(stream);
+		buffer << "// brush " << _primitiveCount++ << "\n";
 
 		// Export patchDef2 to stream (patchDef3 is not supported)
-		PatchDefExporter::exportQ3PatchDef2(stream, patch);
+		PatchDefExporter::exportQ3PatchDef2(buffer, patch);
 	}
 };
 
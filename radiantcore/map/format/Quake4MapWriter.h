@@ -22,11 +22,13 @@ public:
 
 	virtual void beginWriteBrush(const IBrushNodePtr& brush, std::ostream& stream) override
 	{
+		auto& buffer = getBuffer(stream);
+
 		// Primitive count comment
-		stream << "// primitive " << _primitiveCount++ << std::endl;
+		buffer << "// primitive " << _primitiveCount++ << "\n";
 
 		// Export brushDef3 definition to stream, but without contents flags
-		BrushDef3Exporter::exportBrush(stream, brush, false);
+		BrushDef3Exporter::exportBrush(buffer, brush, false);
 	}
 };
 
@@ -36,10 +36,10 @@ brushDef
 }
 }
 */
-scene::INodePtr BrushDefParser::parse(parser::DefTokeniser& tok) const
+scene::INodePtr BrushDefParser::parse(parser::DefTokeniser& tok, int layer) const
 {
 	// Create a new brush
-	scene::INodePtr node = GlobalBrushCreator().createBrush();
+	scene::INodePtr node = GlobalBrushCreator().createBrush(layer);
 
 	// Cast the node, this must succeed
 	IBrushNodePtr brushNode = std::dynamic_pointer_cast<IBrushNode>(node);
@@ -52,7 +52,7 @@ scene::INodePtr BrushDefParser::parse(parser::DefTokeniser& tok) const
 	// Parse face tokens until a closing brace is encountered
 	while (1)
 	{
-		std::string token = tok.nextToken();
+		auto token = tok.nextTokenView();
 
 		// Token should be either a "(" (start of face) or "}" (end of brush)
 		if (token == "}")
@@ -62,25 +62,25 @@ scene::INodePtr BrushDefParser::parse(parser::DefTokeniser& tok) const
 		else if (token == "(") // FACE
 		{
 			// Parse three 3D points to construct a plane
-			double x = string::to_float(tok.nextToken());
-			double y = string::to_float(tok.nextToken());
-			double z = string::to_float(tok.nextToken());
+			double x = string::to_double(tok.nextTokenView());
+			double y = string::to_double(tok.nextTokenView());
+			double z = string::to_double(tok.nextTokenView());
 			Vector3 p1(x, y, z);
 
 			tok.assertNextToken(")");
 			tok.assertNextToken("(");
 
-			x = string::to_float(tok.nextToken());
-			y = string::to_float(tok.nextToken());
-			z = string::to_float(tok.nextToken());
+			x = string::to_double(tok.nextTokenView());
+			y = string::to_double(tok.nextTokenView());
+			z = string::to_double(tok.nextTokenView());
 			Vector3 p2(x, y, z);
 
 			tok.assertNextToken(")");
 			tok.assertNextToken("(");
 
-			x = string::to_float(tok.nextToken());
-			y = string::to_float(tok.nextToken());
-			z = string::to_float(tok.nextToken());
+			x = string::to_double(tok.nextTokenView());
+			y = string::to_double(tok.nextTokenView());
+			z = string::to_double(tok.nextTokenView());
 			Vector3 p3(x, y, z);
 
 			tok.assertNextToken(")");
@@ -93,15 +93,15 @@ scene::INodePtr BrushDefParser::parse(parser::DefTokeniser& tok) const
 			tok.assertNextToken("(");
 
 			tok.assertNextToken("(");
-			texdef.xx() = string::to_float(tok.nextToken());
-			texdef.yx() = string::to_float(tok.nextToken());
-			texdef.tx() = string::to_float(tok.nextToken());
+			texdef.xx() = string::to_double(tok.nextTokenView());
+			texdef.yx() = string::to_double(tok.nextTokenView());
+			texdef.tx() = string::to_double(tok.nextTokenView());
 			tok.assertNextToken(")");
 
 			tok.assertNextToken("(");
-			texdef.xy() = string::to_float(tok.nextToken());
-			texdef.yy() = string::to_float(tok.nextToken());
-			texdef.ty() = string::to_float(tok.nextToken());
+			texdef.xy() = string::to_double(tok.nextTokenView());
+			texdef.yy() = string::to_double(tok.nextTokenView());
+			texdef.ty() = string::to_double(tok.nextTokenView());
 			tok.assertNextToken(")");
 
 			tok.assertNextToken(")");
@@ -122,7 +122,7 @@ scene::INodePtr BrushDefParser::parse(parser::DefTokeniser& tok) const
 		}
 		else
 		{
-			std::string text = fmt::format(_("BrushDefParser: invalid token '{0}'"), token);
+			std::string text = fmt::format(_("BrushDefParser: invalid token '{0}'"), std::string(token));
 			throw parser::ParseException(text);
 		}
 	}
@@ -154,10 +154,10 @@ Example Primitive:
 }
 
 */
-scene::INodePtr LegacyBrushDefParser::parse(parser::DefTokeniser& tok) const
+scene::INodePtr LegacyBrushDefParser::parse(parser::DefTokeniser& tok, int layer) const
 {
 	// Create a new brush
-	scene::INodePtr node = GlobalBrushCreator().createBrush();
+	scene::INodePtr node = GlobalBrushCreator().createBrush(layer);
 
 	// Cast the node, this must succeed
 	IBrushNodePtr brushNode = std::dynamic_pointer_cast<IBrushNode>(node);
@@ -168,7 +168,7 @@ scene::INodePtr LegacyBrushDefParser::parse(parser::DefTokeniser& tok) const
 	// Parse face tokens until a closing brace is encountered
 	while (1)
 	{
-		std::string token = tok.nextToken();
+		auto token = tok.nextTokenView();
 
 		// Token should be either a "(" (start of face) or "}" (end of brush)
 		if (token == "}")
@@ -178,25 +178,25 @@ scene::INodePtr LegacyBrushDefParser::parse(parser::DefTokeniser& tok) const
 		else if (token == "(") // FACE
 		{
 			// Parse three 3D points to construct a plane
-			double x = string::to_float(tok.nextToken());
-			double y = string::to_float(tok.nextToken());
-			double z = string::to_float(tok.nextToken());
+			double x = string::to_double(tok.nextTokenView());
+			double y = string::to_double(tok.nextTokenView());
+			double z = string::to_double(tok.nextTokenView());
 			Vector3 p1(x, y, z);
 
 			tok.assertNextToken(")");
 			tok.assertNextToken("(");
 
-			x = string::to_float(tok.nextToken());
-			y = string::to_float(tok.nextToken());
-			z = string::to_float(tok.nextToken());
+			x = string::to_double(tok.nextTokenView());
+			y = string::to_double(tok.nextTokenView());
+			z = string::to_double(tok.nextTokenView());
 			Vector3 p2(x, y, z);
 
 			tok.assertNextToken(")");
 			tok.assertNextToken("(");
 
-			x = string::to_float(tok.nextToken());
-			y = string::to_float(tok.nextToken());
-			z = string::to_float(tok.nextToken());
+			x = string::to_double(tok.nextTokenView());
+			y = string::to_double(tok.nextTokenView());
+			z = string::to_double(tok.nextTokenView());
 			Vector3 p3(x, y, z);
 
 			tok.assertNextToken(")");
@@ -208,13 +208,13 @@ scene::INodePtr LegacyBrushDefParser::parse(parser::DefTokeniser& tok) const
 			std::string shader = GlobalTexturePrefix_get() + tok.nextToken();
 
 			// Parse texture (shift rotation scale)
-            float shiftS = string::to_float(tok.nextToken());
-            float shiftT = string::to_float(tok.nextToken());
+            float shiftS = string::to_double(tok.nextTokenView());
+            float shiftT = string::to_double(tok.nextTokenView());
 
-            float rotation = string::to_float(tok.nextToken());
+            float rotation = string::to_double(tok.nextTokenView());
 
-            float scaleS = string::to_float(tok.nextToken());
-            float scaleT = string::to_float(tok.nextToken());
+            float scaleS = string::to_double(tok.nextTokenView());
+            float scaleT = string::to_double(tok.nextTokenView());
 
             Matrix4 texdef = getTexDef(shiftS, shiftT, rotation, scaleS, scaleT);
 
@@ -231,7 +231,7 @@ scene::INodePtr LegacyBrushDefParser::parse(parser::DefTokeniser& tok) const
 		}
 		else
 		{
-			std::string text = fmt::format(_("BrushDefParser: invalid token '{0}'"), token);
+			std::string text = fmt::format(_("BrushDefParser: invalid token '{0}'"), std::string(token));
 			throw parser::ParseException(text);
 		}
 	}
@@ -13,7 +13,7 @@ class BrushDefParser :
 public:
 	const std::string& getKeyword() const;
 
-    scene::INodePtr parse(parser::DefTokeniser& tok) const;
+    scene::INodePtr parse(parser::DefTokeniser& tok, int layer) const;
 };
 typedef std::shared_ptr<BrushDefParser> BrushDefParserPtr;
 
@@ -24,7 +24,7 @@ class LegacyBrushDefParser :
 public:
 	const std::string& getKeyword() const;
 
-    scene::INodePtr parse(parser::DefTokeniser& tok) const;
+    scene::INodePtr parse(parser::DefTokeniser& tok, int layer) const;
 
 private:
     static Matrix4 getTexDef(float shiftS, float shiftT, float rotation, float scaleS, float scaleT);
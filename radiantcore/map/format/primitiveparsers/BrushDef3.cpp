@@ -44,10 +44,10 @@ brushDef3
 #pragma optimize( "", off )
 #endif
 
-scene::INodePtr BrushDef3Parser::parse(parser::DefTokeniser& tok) const
+scene::INodePtr BrushDef3Parser::parse(parser::DefTokeniser& tok, int layer) const
 {
 	// Create a new brush
-	scene::INodePtr node = GlobalBrushCreator().createBrush();
+	scene::INodePtr node = GlobalBrushCreator().createBrush(layer);
 
 	// Cast the node, this must succeed
 	IBrushNodePtr brushNode = std::dynamic_pointer_cast<IBrushNode>(node);
@@ -60,7 +60,7 @@ scene::INodePtr BrushDef3Parser::parse(parser::DefTokeniser& tok) const
 	// Parse face tokens until a closing brace is encountered
 	while (1)
 	{
-		std::string token = tok.nextToken();
+		auto token = tok.nextTokenView();
 
 		// Token should be either a "(" (start of face) or "}" (end of brush)
 		if (token == "}")
@@ -72,10 +72,10 @@ scene::INodePtr BrushDef3Parser::parse(parser::DefTokeniser& tok) const
 			// Construct a plane and parse its values
 			Plane3 plane;
 
-			plane.normal().x() = string::to_float(tok.nextToken());
-			plane.normal().y() = string::to_float(tok.nextToken());
-			plane.normal().z() = string::to_float(tok.nextToken());
-			plane.dist() = -string::to_float(tok.nextToken()); // negate d
+			plane.normal().x() = string::to_double(tok.nextTokenView());
+			plane.normal().y() = string::to_double(tok.nextTokenView());
+			plane.normal().z() = string::to_double(tok.nextTokenView());
+			plane.dist() = -string::to_double(tok.nextTokenView()); // negate d
 
 			tok.assertNextToken(")");
 
@@ -84,15 +84,15 @@ scene::INodePtr BrushDef3Parser::parse(parser::DefTokeniser& tok) const
 			tok.assertNextToken("(");
 
 			tok.assertNextToken("(");
-			texdef.xx() = string::to_float(tok.nextToken());
-			texdef.yx() = string::to_float(tok.nextToken());
-			texdef.tx() = string::to_float(tok.nextToken());
+			texdef.xx() = string::to_double(tok.nextTokenView());
+			texdef.yx() = string::to_double(tok.nextTokenView());
+			texdef.tx() = string::to_double(tok.nextTokenView());
 			tok.assertNextToken(")");
 
 			tok.assertNextToken("(");
-			texdef.xy() = string::to_float(tok.nextToken());
-			texdef.yy() = string::to_float(tok.nextToken());
-			texdef.ty() = string::to_float(tok.nextToken());
+			texdef.xy() = string::to_double(tok.nextTokenView());
+			texdef.yy() = string::to_double(tok.nextTokenView());
+			texdef.ty() = string::to_double(tok.nextTokenView());
 			tok.assertNextToken(")");
 
 			tok.assertNextToken(")");
@@ -112,7 +112,7 @@ scene::INodePtr BrushDef3Parser::parse(parser::DefTokeniser& tok) const
 			/*IFace& face = */brush.addFace(plane, texdef, shader);
 		}
 		else {
-			std::string text = fmt::format(_("BrushDef3Parser: invalid token '{0}'"), token);
+			std::string text = fmt::format(_("BrushDef3Parser: invalid token '{0}'"), std::string(token));
 			throw parser::ParseException(text);
 		}
 	}
@@ -123,10 +123,10 @@ scene::INodePtr BrushDef3Parser::parse(parser::DefTokeniser& tok) const
 	return node;
 }
 
-scene::INodePtr BrushDef3ParserQuake4::parse(parser::DefTokeniser& tok) const
+scene::INodePtr BrushDef3ParserQuake4::parse(parser::DefTokeniser& tok, int layer) const
 {
 	// Create a new brush
-	scene::INodePtr node = GlobalBrushCreator().createBrush();
+	scene::INodePtr node = GlobalBrushCreator().createBrush(layer);
 
 	// Cast the node, this must succeed
 	IBrushNodePtr brushNode = std::dynamic_pointer_cast<IBrushNode>(node);
@@ -139,7 +139,7 @@ scene::INodePtr BrushDef3ParserQuake4::parse(parser::DefTokeniser& tok) const
 	// Parse face tokens until a closing brace is encountered
 	while (1)
 	{
-		std::string token = tok.nextToken();
+		auto token = tok.nextTokenView();
 
 		// Token should be either a "(" (start of face) or "}" (end of brush)
 		if (token == "}")
@@ -151,10 +151,10 @@ scene::INodePtr BrushDef3ParserQuake4::parse(parser::DefTokeniser& tok) const
 			// Construct a plane and parse its values
 			Plane3 plane;
 
-			plane.normal().x() = string::to_float(tok.nextToken());
-			plane.normal().y() = string::to_float(tok.nextToken());
-			plane.normal().z() = string::to_float(tok.nextToken());
-			plane.dist() = -string::to_float(tok.nextToken()); // negate d
+			plane.normal().x() = string::to_double(tok.nextTokenView());
+			plane.normal().y() = string::to_double(tok.nextTokenView());
+			plane.normal().z() = string::to_double(tok.nextTokenView());
+			plane.dist() = -string::to_double(tok.nextTokenView()); // negate d
 
 			tok.assertNextToken(")");
 
@@ -163,15 +163,15 @@ scene::INodePtr BrushDef3ParserQuake4::parse(parser::DefTokeniser& tok) const
 			tok.assertNextToken("(");
 
 			tok.assertNextToken("(");
-			texdef.xx() = string::to_float(tok.nextToken());
-			texdef.yx() = string::to_float(tok.nextToken());
-			texdef.tx() = string::to_float(tok.nextToken());
+			texdef.xx() = string::to_double(tok.nextTokenView());
+			texdef.yx() = string::to_double(tok.nextTokenView());
+			texdef.tx() = string::to_double(tok.nextTokenView());
 			tok.assertNextToken(")");
 
 			tok.assertNextToken("(");
-			texdef.xy() = string::to_float(tok.nextToken());
-			texdef.yy() = string::to_float(tok.nextToken());
-			texdef.ty() = string::to_float(tok.nextToken());
+			texdef.xy() = string::to_double(tok.nextTokenView());
+			texdef.yy() = string::to_double(tok.nextTokenView());
+			texdef.ty() = string::to_double(tok.nextTokenView());
 			tok.assertNextToken(")");
 
 			tok.assertNextToken(")");
@@ -183,7 +183,7 @@ scene::INodePtr BrushDef3ParserQuake4::parse(parser::DefTokeniser& tok) const
 			/*IFace& face = */brush.addFace(plane, texdef, shader);
 		}
 		else {
-			std::string text = fmt::format(_("BrushDef3ParserQuake4: invalid token '{0}'"), token);
+			std::string text = fmt::format(_("BrushDef3ParserQuake4: invalid token '{0}'"), std::string(token));
 			throw parser::ParseException(text);
 		}
 	}
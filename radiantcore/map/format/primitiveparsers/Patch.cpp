@@ -24,13 +24,13 @@ void PatchParser::parseMatrix(parser::DefTokeniser& tok, IPatch& patch) const
 			tok.assertNextToken("(");
 
 			// Parse vertex coordinates
-			patch.ctrlAt(r, c).vertex[0] = string::to_float(tok.nextToken());
-			patch.ctrlAt(r, c).vertex[1] = string::to_float(tok.nextToken());
-			patch.ctrlAt(r, c).vertex[2] = string::to_float(tok.nextToken());
+			patch.ctrlAt(r, c).vertex[0] = string::to_double(tok.nextTokenView());
+			patch.ctrlAt(r, c).vertex[1] = string::to_double(tok.nextTokenView());
+			patch.ctrlAt(r, c).vertex[2] = string::to_double(tok.nextTokenView());
 
 			// Parse texture coordinates
-			patch.ctrlAt(r, c).texcoord[0] = string::to_float(tok.nextToken());
-			patch.ctrlAt(r, c).texcoord[1] = string::to_float(tok.nextToken());
+			patch.ctrlAt(r, c).texcoord[0] = string::to_double(tok.nextTokenView());
+			patch.ctrlAt(r, c).texcoord[1] = string::to_double(tok.nextTokenView());
 
 			tok.assertNextToken(")");
 		}
@@ -35,9 +35,9 @@ patchDef2
 }
 }
 */
-scene::INodePtr PatchDef2Parser::parse(parser::DefTokeniser& tok) const
+scene::INodePtr PatchDef2Parser::parse(parser::DefTokeniser& tok, int layer) const
 {
-	scene::INodePtr node = GlobalPatchModule().createPatch(patch::PatchDefType::Def2);
+	scene::INodePtr node = GlobalPatchModule().createPatch(patch::PatchDefType::Def2, layer);
 
 	IPatchNodePtr patchNode = std::dynamic_pointer_cast<IPatchNode>(node);
 	assert(patchNode != NULL);
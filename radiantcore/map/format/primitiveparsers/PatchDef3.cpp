@@ -34,9 +34,9 @@ patchDef3
 }
 }
 */
-scene::INodePtr PatchDef3Parser::parse(parser::DefTokeniser& tok) const
+scene::INodePtr PatchDef3Parser::parse(parser::DefTokeniser& tok, int layer) const
 {
-	scene::INodePtr node = GlobalPatchModule().createPatch(patch::PatchDefType::Def3);
+	scene::INodePtr node = GlobalPatchModule().createPatch(patch::PatchDefType::Def3, layer);
 
 	IPatchNodePtr patchNode = std::dynamic_pointer_cast<IPatchNode>(node);
 	assert(patchNode != NULL);
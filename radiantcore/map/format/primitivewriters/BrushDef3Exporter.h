@@ -1,5 +1,6 @@
 #pragma once
 
+#include "MapTextBuffer.h"
 #include "ibrush.h"
 #include "math/Plane3.h"
 #include "math/Matrix4.h"
@@ -7,57 +8,33 @@
 namespace map
 {
 
-namespace
-{
-	// Writes a double to the given stream and checks for NaN and infinity
-	inline void writeDoubleSafe(const double d, std::ostream& os)
-	{
-		if (isValid(d))
-		{
-			if (d == -0.0)
-			{
-				os << 0; // convert -0 to 0
-			}
-			else
-			{
-				os << d;
-			}
-		}
-		else
-		{
-			// Is infinity or NaN, write 0
-			os << "0";
-		}
-	}
-}
-
 class BrushDef3Exporter
 {
 public:
 
-	// Writes a brushDef3 definition from the given brush to the given stream
-	static void exportBrush(std::ostream& stream, const IBrushNodePtr& brushNode, bool writeContentsFlags = true)
+	// Writes a brushDef3 definition from the given brush to the given buffer
+	static void exportBrush(MapTextBuffer& buffer, const IBrushNodePtr& brushNode, bool writeContentsFlags = true)
 	{
 		const IBrush& brush = brushNode->getIBrush();
 
 		// Brush decl header
-		stream << "{" << std::endl;
-		stream << "brushDef3" << std::endl;
-		stream << "{" << std::endl;
+		buffer << "{\n";
+		buffer << "brushDef3\n";
+		buffer << "{\n";
 
 		// Iterate over each brush face, exporting the tokens from all faces
 		for (std::size_t i = 0; i < brush.getNumFaces(); ++i)
 		{
-			writeFace(stream, brush.getFace(i), writeContentsFlags, brush.getDetailFlag());
+			writeFace(buffer, brush.getFace(i), writeContentsFlags, brush.getDetailFlag());
 		}
 
 		// Close brush contents and header
-		stream << "}" << std::endl << "}" << std::endl;
+		buffer << "}\n" << "}\n";
 	}
 
 private:
 
-	static void writeFace(std::ostream& stream, const IFace& face, bool writeContentsFlags, IBrush::DetailFlag detailFlag)
+	static void writeFace(MapTextBuffer& buffer, const IFace& face, bool writeContentsFlags, IBrush::DetailFlag detailFlag)
 	{
 		// greebo: Don't export faces with degenerate or empty windings (they are "non-contributing")
 		if (face.getWinding().size() <= 2)
@@ -68,56 +45,56 @@ private:
 		// Write the plane equation
 		const Plane3& plane = face.getPlane3();
 
-		stream << "( ";
-		writeDoubleSafe(plane.normal().x(), stream);
-		stream << " ";
-		writeDoubleSafe(plane.normal().y(), stream);
-		stream << " ";
-		writeDoubleSafe(plane.normal().z(), stream);
-		stream << " ";
-		writeDoubleSafe(-plane.dist(), stream); // negate d
-		stream << " ";
-		stream << ") ";
+		buffer << "( ";
+		buffer.writeDouble(plane.normal().x());
+		buffer << " ";
+		buffer.writeDouble(plane.normal().y());
+		buffer << " ";
+		buffer.writeDouble(plane.normal().z());
+		buffer << " ";
+		buffer.writeDouble(-plane.dist()); // negate d
+		buffer << " ";
+		buffer << ") ";
 
 		// Write TexDef
 		Matrix4 texdef = face.getTexDefMatrix();
-		stream << "( ";
-
-		stream << "( ";
-		writeDoubleSafe(texdef.xx(), stream);
-		stream << " ";
-		writeDoubleSafe(texdef.yx(), stream);
-		stream << " ";
-		writeDoubleSafe(texdef.tx(), stream);
-		stream << " ) ";
-
-		stream << "( ";
-		writeDoubleSafe(texdef.xy(), stream);
-		stream << " ";
-		writeDoubleSafe(texdef.yy(), stream);
-		stream << " ";
-		writeDoubleSafe(texdef.ty(), stream);
-		stream << " ) ";
-
-		stream << ") ";
+		buffer << "( ";
+
+		buffer << "( ";
+		buffer.writeDouble(texdef.xx());
+		buffer << " ";
+		buffer.writeDouble(texdef.yx());
+		buffer << " ";
+		buffer.writeDouble(texdef.tx());
+		buffer << " ) ";
+
+		buffer << "( ";
+		buffer.writeDouble(texdef.xy());
+		buffer << " ";
+		buffer.writeDouble(texdef.yy());
+		buffer << " ";
+		buffer.writeDouble(texdef.ty());
+		buffer << " ) ";
+
+		buffer << ") ";
 
 		// Write Shader
 		const std::string& shaderName = face.getShader();
 
 		if (shaderName.empty()) {
-			stream << "\"_default\" ";
+			buffer << "\"_default\" ";
 		}
 		else {
-			stream << "\"" << shaderName << "\" ";
+			buffer << "\"" << shaderName << "\" ";
 		}
 
 		// Export (dummy) contents/flags
 		if (writeContentsFlags)
 		{
-			stream << detailFlag << " 0 0";
+			buffer << static_cast<int>(detailFlag) << " 0 0";
 		}
 
-		stream << std::endl;
+		buffer << "\n";
 	}
 };
 
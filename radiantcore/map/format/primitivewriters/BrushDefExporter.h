@@ -1,5 +1,6 @@
 #pragma once
 
+#include "MapTextBuffer.h"
 #include "ibrush.h"
 #include "math/Plane3.h"
 #include "math/Matrix4.h"
@@ -10,52 +11,28 @@
 namespace map
 {
 
-namespace
-{
-	// Writes a double to the given stream and checks for NaN and infinity
-	inline void writeDoubleSafe(const double d, std::ostream& os)
-	{
-		if (isValid(d))
-		{
-			if (d == -0.0)
-			{
-				os << 0; // convert -0 to 0
-			}
-			else
-			{
-				os << d;
-			}
-		}
-		else
-		{
-			// Is infinity or NaN, write 0
-			os << "0";
-		}
-	}
-}
-
 class BrushDefExporter
 {
 public:
 
-	// Writes a Q3-style brushDef definition from the given brush to the given stream
-	static void exportBrush(std::ostream& stream, const IBrushNodePtr& brushNode)
+	// Writes a Q3-style brushDef definition from the given brush to the given buffer
+	static void exportBrush(MapTextBuffer& buffer, const IBrushNodePtr& brushNode)
 	{
 		const IBrush& brush = brushNode->getIBrush();
 
 		// Brush decl header
-		stream << "{" << std::endl;
-		stream << "brushDef" << std::endl;
-		stream << "{" << std::endl;
+		buffer << "{\n";
+		buffer << "brushDef\n";
+		buffer << "{\n";
 
 		// Iterate over each brush face, exporting the tokens from all faces
 		for (std::size_t i = 0; i < brush.getNumFaces(); ++i)
 		{
-			writeFace(stream, brush.getFace(i), brush.getDetailFlag());
+			writeFace(buffer, brush.getFace(i), brush.getDetailFlag());
 		}
 
 		// Close brush contents and header
-		stream << "}" << std::endl << "}" << std::endl;
+		buffer << "}\n" << "}\n";
 	}
 
 	/* 
@@ -72,7 +49,7 @@ public:
 
 private:
 
-	static void writeFace(std::ostream& stream, const IFace& face, IBrush::DetailFlag detailFlag)
+	static void writeFace(MapTextBuffer& buffer, const IFace& face, IBrush::DetailFlag detailFlag)
 	{
 		// greebo: Don't export faces with degenerate or empty windings (they are "non-contributing")
 		const IWinding& winding = face.getWinding();
@@ -84,79 +61,79 @@ private:
 
 		// Each face plane is defined by three points
 
-		stream << "( ";
-		writeDoubleSafe(winding[2].vertex.x(), stream);
-		stream << " ";
-		writeDoubleSafe(winding[2].vertex.y(), stream);
-		stream << " ";
-		writeDoubleSafe(winding[2].vertex.z(), stream);
-		stream << " ";
-		stream << ") ";
-
-		stream << "( ";
-		writeDoubleSafe(winding[0].vertex.x(), stream);
-		stream << " ";
-		writeDoubleSafe(winding[0].vertex.y(), stream);
-		stream << " ";
-		writeDoubleSafe(winding[0].vertex.z(), stream);
-		stream << " ";
-		stream << ") ";
-
-		stream << "( ";
-		writeDoubleSafe(winding[1].vertex.x(), stream);
-		stream << " ";
-		writeDoubleSafe(winding[1].vertex.y(), stream);
-		stream << " ";
-		writeDoubleSafe(winding[1].vertex.z(), stream);
-		stream << " ";
-		stream << ") ";
+		buffer << "( ";
+		buffer.writeDouble(winding[2].vertex.x());
+		buffer << " ";
+		buffer.writeDouble(winding[2].vertex.y());
+		buffer << " ";
+		buffer.writeDouble(winding[2].vertex.z());
+		buffer << " ";
+		buffer << ") ";
+
+		buffer << "( ";
+		buffer.writeDouble(winding[0].vertex.x());
+		buffer << " ";
+		buffer.writeDouble(winding[0].vertex.y());
+		buffer << " ";
+		buffer.writeDouble(winding[0].vertex.z());
+		buffer << " ";
+		buffer << ") ";
+
+		buffer << "( ";
+		buffer.writeDouble(winding[1].vertex.x());
+		buffer << " ";
+		buffer.writeDouble(winding[1].vertex.y());
+		buffer << " ";
+		buffer.writeDouble(winding[1].vertex.z());
+		buffer << " ";
+		buffer << ") ";
 
 		// Write TexDef
 		Matrix4 texdef = face.getTexDefMatrix();
-		stream << "( ";
-
-		stream << "( ";
-		writeDoubleSafe(texdef.xx(), stream);
-		stream << " ";
-		writeDoubleSafe(texdef.yx(), stream);
-		stream << " ";
-		writeDoubleSafe(texdef.tx(), stream);
-		stream << " ) ";
-
-		stream << "( ";
-		writeDoubleSafe(texdef.xy(), stream);
-		stream << " ";
-		writeDoubleSafe(texdef.yy(), stream);
-		stream << " ";
-		writeDoubleSafe(texdef.ty(), stream);
-		stream << " ) ";
-
-		stream << ") ";
+		buffer << "( ";
+
+		buffer << "( ";
+		buffer.writeDouble(texdef.xx());
+		buffer << " ";
+		buffer.writeDouble(texdef.yx());
+		buffer << " ";
+		buffer.writeDouble(texdef.tx());
+		buffer << " ) ";
+
+		buffer << "( ";
+		buffer.writeDouble(texdef.xy());
+		buffer << " ";
+		buffer.writeDouble(texdef.yy());
+		buffer << " ";
+		buffer.writeDouble(texdef.ty());
+		buffer << " ) ";
+
+		buffer << ") ";
 
 		// Write Shader (without quotes)
 		const std::string& shaderName = face.getShader();
 
 		if (shaderName.empty())
 		{
-			stream << "_default ";
+			buffer << "_default ";
 		}
 		else
 		{
 			if (string::starts_with(shaderName, GlobalTexturePrefix_get()))
 			{
 				// brushDef has an implicit "textures/" not written to the map, cut it off
-				stream << "" << shader_get_textureName(shaderName.c_str()) << " ";
+				buffer << "" << shader_get_textureName(shaderName.c_str()) << " ";
 			}
 			else
 			{
-				stream << "" << shaderName << " ";
+				buffer << "" << shaderName << " ";
 			}
 		}
 
 		// Export (dummy) contents/flags
-		stream << detailFlag << " 0 0";
+		buffer << static_cast<int>(detailFlag) << " 0 0";
 		
-		stream << std::endl;
+		buffer << "\n";
 	}
 };
 
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <fmt/format.h>
+
+#include "math/FloatTools.h"
+
+namespace map
+{
+
+/**
+ * Text buffer the map writers are assembling the map blocks in.
+ *
+ * Floating point values are producing the same text as an std::ostream
+ * with the given precision would do, but converting them is expensive.
+ * Integral values (the majority in most maps) are converted right away,
+ * the other ones are stored in binary form and are only converted when
+ * format() is called. This allows the caller to collect the values from
+ * the scene on the main thread, while the conversion can happen on any
+ * thread without touching the scene.
+ */
+class MapTextBuffer
+{
+private:
+	// Placeholder character for a deferred value, never part of map text
+	static constexpr char DeferredValue = '\0';
+
+	std::string _text;
+	std::vector<double> _values;
+
+	int _precision;
+
+	// Integers below this limit are printed the same way by %g
+	double _integerLimit;
+
+public:
+	MapTextBuffer(int precision = 6) :
+		_precision(precision > 0 ? precision : 1),
+		_integerLimit(std::pow(10.0, _precision < 15 ? _precision : 15))
+	{}
+
+	MapTextBuffer& operator<<(const char* str)
+	{
+		_text.append(str);
+		return *this;
+	}
+
+	MapTextBuffer& operator<<(const std::string& str)
+	{
+		_text.append(str);
+		return *this;
+	}
+
+	MapTextBuffer& operator<<(char c)
+	{
+		_text.push_back(c);
+		return *this;
+	}
+
+	template<typename IntegerType>
+	typename std::enable_if<std::is_integral<IntegerType>::value, MapTextBuffer&>::type operator<<(IntegerType value)
+	{
+		fmt::format_int formatted(value);
+		_text.append(formatted.data(), formatted.size());
+		return *this;
+	}
+
+	// Writes the given value, NaN and infinity are written as 0, -0 is converted to 0
+	void writeDouble(double value)
+	{
+		if (!isValid(value) || value == 0.0)
+		{
+			_text.push_back('0');
+		}
+		else if (std::abs(value) < _integerLimit && value == std::floor(value))
+		{
+			*this << static_cast<long long>(value);
+		}
+		else
+		{
+			_text.push_back(DeferredValue);
+			_values.push_back(value);
+		}
+	}
+
+	bool empty() const
+	{
+		return _text.empty();
+	}
+
+	// The number of values waiting for their conversion, useful to estimate the format() cost
+	std::size_t getNumDeferredValues() const
+	{
+		return _values.size();
+	}
+
+	// Appends the final text to the given buffer
+	void formatTo(fmt::memory_buffer& output) const
+	{
+		const char* text = _text.data();
+		const char* end = text + _text.size();
+
+		for (auto value : _values)
+		{
+			auto placeholder = static_cast<const char*>(std::memchr(text, DeferredValue, end - text));
+
+			output.append(text, placeholder);
+			fmt::format_to(output, "{0:.{1}g}", value, _precision);
+
+			text = placeholder + 1;
+		}
+
+		output.append(text, end);
+	}
+
+	std::string format() const
+	{
+		if (_values.empty())
+		{
+			return _text;
+		}
+
+		fmt::memory_buffer output;
+		formatTo(output);
+
+		return std::string(output.data(), output.size());
+	}
+};
+
+}
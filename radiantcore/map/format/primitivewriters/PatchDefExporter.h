@@ -1,5 +1,6 @@
 #pragma once
 
+#include "MapTextBuffer.h"
 #include "shaderlib.h"
 #include "ipatch.h"
 
@@ -8,195 +9,172 @@
 namespace map
 {
 
-namespace
-{
-	inline void writePatchDouble(const double d, std::ostream& os)
-	{
-		if (isValid(d))
-		{
-			if (d == -0.0)
-			{
-				os << 0; // convert -0 to 0
-			}
-			else
-			{
-				os << d;
-			}
-		}
-		else
-		{
-			// Is infinity or NaN, write 0
-			os << "0";
-		}
-	}
-}
-
 class PatchDefExporter
 {
 public:
 
-	// Writes a patchDef2/3 definition from the given patch to the given stream
-	static void exportPatch(std::ostream& stream, const IPatchNodePtr& patchNode)
+	// Writes a patchDef2/3 definition from the given patch to the given buffer
+	static void exportPatch(MapTextBuffer& buffer, const IPatchNodePtr& patchNode)
 	{
 		const IPatch& patch = patchNode->getPatch();
 
 		if (patch.subdivisionsFixed())
 		{
-			exportPatchDef3(stream, patch);
+			exportPatchDef3(buffer, patch);
 		}
 		else
 		{
-			exportPatchDef2(stream, patch);
+			exportPatchDef2(buffer, patch);
 		}
 	}
 
 	// Export a patchDef2 declaration, Q3-style
-	static void exportQ3PatchDef2(std::ostream& stream, const IPatchNodePtr& patchNode)
+	static void exportQ3PatchDef2(MapTextBuffer& buffer, const IPatchNodePtr& patchNode)
 	{
 		const IPatch& patch = patchNode->getPatch();
 
 		// Export patch declaration
-		stream << "{\n";
-		stream << "patchDef2\n";
-		stream << "{\n";
+		buffer << "{\n";
+		buffer << "patchDef2\n";
+		buffer << "{\n";
 
-		exportQ3Shader(stream, patch);
+		exportQ3Shader(buffer, patch);
 
 		// Export patch dimension / parameters
-		stream << "( ";
-		stream << patch.getWidth() << " ";
-		stream << patch.getHeight() << " ";
+		buffer << "( ";
+		buffer << patch.getWidth() << " ";
+		buffer << patch.getHeight() << " ";
 
 		// empty contents/flags
-		stream << "0 0 0 )\n";
+		buffer << "0 0 0 )\n";
 
-		exportPatchControlMatrix(stream, patch);
+		exportPatchControlMatrix(buffer, patch);
 
-		stream << "}\n}\n";
+		buffer << "}\n}\n";
 	}
 
 private:
 	// Export a patchDef3 declaration (fixed subdivisions)
-	static void exportPatchDef3(std::ostream& stream, const IPatch& patch)
+	static void exportPatchDef3(MapTextBuffer& buffer, const IPatch& patch)
 	{
 		// Export patch declaration
-		stream << "{\n";
-		stream << "patchDef3\n";
-		stream << "{\n";
+		buffer << "{\n";
+		buffer << "patchDef3\n";
+		buffer << "{\n";
 
-		exportShader(stream, patch);
+		exportShader(buffer, patch);
 
 		// Export patch dimension / parameters
-		stream << "( ";
-		stream << patch.getWidth() << " ";
-		stream << patch.getHeight() << " ";
+		buffer << "( ";
+		buffer << patch.getWidth() << " ";
+		buffer << patch.getHeight() << " ";
 
 		assert(patch.subdivisionsFixed());
 
 		Subdivisions divisions = patch.getSubdivisions();
-		stream << divisions.x() << " ";
-		stream << divisions.y() << " ";
+		buffer << divisions.x() << " ";
+		buffer << divisions.y() << " ";
 
 		// empty contents/flags
-		stream << "0 0 0 )\n";
+		buffer << "0 0 0 )\n";
 
-		exportPatchControlMatrix(stream, patch);
+		exportPatchControlMatrix(buffer, patch);
 
-		stream << "}\n}\n";
+		buffer << "}\n}\n";
 	}
 
 	// Export a patchDef2 declaration, D3-style
-	static void exportPatchDef2(std::ostream& stream, const IPatch& patch)
+	static void exportPatchDef2(MapTextBuffer& buffer, const IPatch& patch)
 	{
 		// Export patch declaration
-		stream << "{\n";
-		stream << "patchDef2\n";
-		stream << "{\n";
+		buffer << "{\n";
+		buffer << "patchDef2\n";
+		buffer << "{\n";
 
-		exportShader(stream, patch);
+		exportShader(buffer, patch);
 
 		// Export patch dimension / parameters
-		stream << "( ";
-		stream << patch.getWidth() << " ";
-		stream << patch.getHeight() << " ";
+		buffer << "( ";
+		buffer << patch.getWidth() << " ";
+		buffer << patch.getHeight() << " ";
 
 		// empty contents/flags
-		stream << "0 0 0 )\n";
+		buffer << "0 0 0 )\n";
 
-		exportPatchControlMatrix(stream, patch);
+		exportPatchControlMatrix(buffer, patch);
 
-		stream << "}\n}\n";
+		buffer << "}\n}\n";
 	}
 
-	static void exportShader(std::ostream& stream, const IPatch& patch)
+	static void exportShader(MapTextBuffer& buffer, const IPatch& patch)
 	{
 		// Export shader
 		const std::string& shaderName = patch.getShader();
 
 		if (shaderName.empty())
 		{
-			stream << "\"_default\"";
+			buffer << "\"_default\"";
 		}
 		else
 		{
-			stream << "\"" << shaderName << "\"";
+			buffer << "\"" << shaderName << "\"";
 		}
-		stream << "\n";
+		buffer << "\n";
 	}
 
 	// Q3 shader declarations are missing their textures/ prefix and don't use quotes
-	static void exportQ3Shader(std::ostream& stream, const IPatch& patch)
+	static void exportQ3Shader(MapTextBuffer& buffer, const IPatch& patch)
 	{
 		// Export shader
 		const std::string& shaderName = patch.getShader();
 
 		if (shaderName.empty())
 		{
-			stream << "_default";
+			buffer << "_default";
 		}
 		else
 		{
 			if (string::starts_with(shaderName, GlobalTexturePrefix_get()))
 			{
 				// Q3-style patchDef2 doesn't write the "textures/" prefix to the map, cut it off
-				stream << "" << shader_get_textureName(shaderName.c_str()) << " ";
+				buffer << "" << shader_get_textureName(shaderName.c_str()) << " ";
 			}
 			else
 			{
-				stream << "" << shaderName << " ";
+				buffer << "" << shaderName << " ";
 			}
 		}
-		stream << "\n";
+		buffer << "\n";
 	}
 
-	static void exportPatchControlMatrix(std::ostream& stream, const IPatch& patch)
+	static void exportPatchControlMatrix(MapTextBuffer& buffer, const IPatch& patch)
 	{
 		// Export the control point matrix
-		stream << "(\n";
+		buffer << "(\n";
 
 		for (std::size_t c = 0; c < patch.getWidth(); c++)
 		{
-			stream << "( ";
+			buffer << "( ";
 
 			for (std::size_t r = 0; r < patch.getHeight(); r++)
 			{
-				stream << "( ";
-				writePatchDouble(patch.ctrlAt(r,c).vertex[0], stream);
-				stream << " ";
-				writePatchDouble(patch.ctrlAt(r,c).vertex[1], stream);
-				stream << " ";
-				writePatchDouble(patch.ctrlAt(r,c).vertex[2], stream);
-				stream << " ";
-				writePatchDouble(patch.ctrlAt(r,c).texcoord[0], stream);
-				stream << " ";
-				writePatchDouble(patch.ctrlAt(r,c).texcoord[1], stream);
-				stream << " ) ";
+				buffer << "( ";
+				buffer.writeDouble(patch.ctrlAt(r,c).vertex[0]);
+				buffer << " ";
+				buffer.writeDouble(patch.ctrlAt(r,c).vertex[1]);
+				buffer << " ";
+				buffer.writeDouble(patch.ctrlAt(r,c).vertex[2]);
+				buffer << " ";
+				buffer.writeDouble(patch.ctrlAt(r,c).texcoord[0]);
+				buffer << " ";
+				buffer.writeDouble(patch.ctrlAt(r,c).texcoord[1]);
+				buffer << " ) ";
 			}
 
-			stream << ")\n";
+			buffer << ")\n";
 		}
 
-		stream << ")\n";
+		buffer << ")\n";
 	}
 };
 
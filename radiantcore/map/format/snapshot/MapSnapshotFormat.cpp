@@ -0,0 +1,184 @@
+#include "MapSnapshotFormat.h"
+
+#include <fmt/format.h>
+
+#include "itextstream.h"
+#include "imodule.h"
+#include "igame.h"
+#include "os/fs.h"
+#include "os/path.h"
+#include "string/convert.h"
+#include "stream/MappedFile.h"
+#include "util/Hash.h"
+
+#include "MapSnapshotReader.h"
+#include "MapSnapshotWriter.h"
+#include "../Doom3MapFormat.h"
+
+#include "module/StaticModule.h"
+
+namespace map
+{
+
+namespace format
+{
+
+namespace
+{
+	const char* const SNAPSHOT_FOLDER = "mapsnapshots/";
+	const char* const GKEY_FLOAT_PRECISION = "/mapFormat/floatPrecision";
+
+	// Adds the size and contents of the given file to the hash, returns false if it can't be opened
+	bool hashFileContents(util::Hash64& hash, const std::string& path)
+	{
+		stream::MappedFile file(path);
+
+		if (!file.isOpen())
+		{
+			hash.update(static_cast<std::uint64_t>(0)); // no file
+			return false;
+		}
+
+		hash.update(static_cast<std::uint64_t>(file.size()));
+
+		if (file.size() > 0)
+		{
+			hash.update(file.data(), file.size());
+		}
+
+		return true;
+	}
+}
+
+const std::uint32_t MapSnapshotFormat::Version = 1;
+const char* const MapSnapshotFormat::Extension = "mapsnapshot";
+
+const std::string& MapSnapshotFormat::getName() const
+{
+	static std::string _name(typeid(MapSnapshotFormat).name());
+	return _name;
+}
+
+const StringSet& MapSnapshotFormat::getDependencies() const
+{
+	static StringSet _dependencies;
+
+	if (_dependencies.empty())
+	{
+		_dependencies.insert(MODULE_MAPFORMATMANAGER);
+	}
+
+	return _dependencies;
+}
+
+void MapSnapshotFormat::initialiseModule(const IApplicationContext& ctx)
+{
+	rMessage() << getName() << ": initialiseModule called." << std::endl;
+
+	GlobalMapFormatManager().registerMapFormat(Extension, shared_from_this());
+}
+
+void MapSnapshotFormat::shutdownModule()
+{
+	GlobalMapFormatManager().unregisterMapFormat(shared_from_this());
+}
+
+const std::string& MapSnapshotFormat::getMapFormatName() const
+{
+	static std::string _name = MAP_SNAPSHOT_FORMAT_NAME;
+	return _name;
+}
+
+const std::string& MapSnapshotFormat::getGameType() const
+{
+	static std::string _gameType = "doom3";
+	return _gameType;
+}
+
+IMapReaderPtr MapSnapshotFormat::getMapReader(IMapImportFilter& filter) const
+{
+	return std::make_shared<MapSnapshotReader>(filter);
+}
+
+IMapWriterPtr MapSnapshotFormat::getMapWriter() const
+{
+	return std::make_shared<MapSnapshotWriter>();
+}
+
+bool MapSnapshotFormat::allowInfoFileCreation() const
+{
+	// Layers, groups, sets and properties are stored in the snapshot itself
+	return false;
+}
+
+bool MapSnapshotFormat::canLoad(std::istream& stream) const
+{
+	char magic[sizeof(snapshot::Magic)];
+
+	stream.read(magic, sizeof(magic));
+
+	return stream.gcount() == sizeof(magic) && std::memcmp(magic, snapshot::Magic, sizeof(magic)) == 0;
+}
+
+std::string MapSnapshotFormat::GetSnapshotPath(const std::string& mapPath)
+{
+	// Snapshots of maps with equal names in different folders need to be distinguishable
+	util::Hash64 pathHash;
+	pathHash.update(os::standardPath(mapPath));
+
+	return fmt::format("{0}{1}{2}_{3:016x}.{4}",
+		module::GlobalModuleRegistry().getApplicationContext().getCacheDataPath(),
+		SNAPSHOT_FOLDER, fs::path(mapPath).stem().string(), pathHash.getValue(), Extension);
+}
+
+std::uint64_t MapSnapshotFormat::CalculateSourceHash(const std::string& mapPath, const std::string& infoFilePath)
+{
+	util::Hash64 hash;
+	hash.update(Version);
+
+	if (!hashFileContents(hash, mapPath))
+	{
+		return 0;
+	}
+
+	hashFileContents(hash, infoFilePath);
+
+	// Never return the 0 reserved for "no hash"
+	return hash.getValue() != 0 ? hash.getValue() : 1;
+}
+
+std::uint64_t MapSnapshotFormat::ReadSourceHash(std::istream& stream)
+{
+	snapshot::Header header;
+
+	stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (stream.gcount() != sizeof(header) ||
+		std::memcmp(header.magic, snapshot::Magic, sizeof(header.magic)) != 0 ||
+		header.byteOrderMark != snapshot::ByteOrderMark || header.version != Version)
+	{
+		return 0;
+	}
+
+	return header.sourceHash;
+}
+
+int MapSnapshotFormat::GetTextPrecision(const MapFormat& format)
+{
+	// Only the Doom 3 format is writing plane equations, vertices and detail flags as they are
+	if (dynamic_cast<const Doom3MapFormat*>(&format) == nullptr)
+	{
+		return -1;
+	}
+
+	auto game = GlobalGameManager().currentGame();
+	auto nodes = game ? game->getLocalXPath(GKEY_FLOAT_PRECISION) : xml::NodeList();
+
+	return !nodes.empty() ? string::convert<int>(nodes[0].getAttributeValue("value"), -1) : -1;
+}
+
+module::StaticModule<MapSnapshotFormat> mapSnapshotModule;
+
+}
+
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstdint>
+#include "imapformat.h"
+
+namespace map
+{
+
+namespace format
+{
+
+/**
+ * Binary map snapshot format, used as cache to speed up the loading of
+ * large maps. After a map has been loaded or saved, a snapshot of the
+ * scene is written to the cache folder, tagged with the hash of the map
+ * and info file contents it's been created from. When the same map is
+ * opened again and the hash is still matching, the snapshot is loaded
+ * instead, saving the time needed to tokenise and parse the text.
+ *
+ * Since the format is just a cache, it is not meant to be exchanged
+ * between different machines and may change without notice (bump the
+ * version when doing so, outdated snapshots are ignored).
+ */
+class MapSnapshotFormat :
+	public MapFormat,
+	public std::enable_shared_from_this<MapSnapshotFormat>
+{
+public:
+	static const std::uint32_t Version;
+	static const char* const Extension;
+
+	// RegisterableModule implementation
+	const std::string& getName() const override;
+	const StringSet& getDependencies() const override;
+	void initialiseModule(const IApplicationContext& ctx) override;
+	void shutdownModule() override;
+
+	const std::string& getMapFormatName() const override;
+	const std::string& getGameType() const override;
+	IMapReaderPtr getMapReader(IMapImportFilter& filter) const override;
+	IMapWriterPtr getMapWriter() const override;
+
+	bool allowInfoFileCreation() const override;
+
+	bool canLoad(std::istream& stream) const override;
+
+	// Returns the path of the snapshot file associated to the given (absolute) map path
+	static std::string GetSnapshotPath(const std::string& mapPath);
+
+	// Calculates the hash of the given map and info file contents as stored in the snapshot
+	// header. A missing info file is valid, but returns 0 if the map file cannot be read.
+	static std::uint64_t CalculateSourceHash(const std::string& mapPath, const std::string& infoFilePath);
+
+	// Reads the source hash from the header of the snapshot in the given stream,
+	// returns 0 if the stream doesn't contain a snapshot of a supported version.
+	static std::uint64_t ReadSourceHash(std::istream& stream);
+
+	// Returns the float precision the given text map format is writing its brush planes,
+	// texture matrices and patch vertices with. A snapshot of a freshly saved map needs to
+	// apply the same rounding to be equivalent to the file. Returns -1 for formats storing
+	// their primitives in a different representation (no snapshot can be created on save).
+	static int GetTextPrecision(const MapFormat& format);
+};
+
+namespace snapshot
+{
+
+// File layout: a Header followed by the sections listed below, in that order.
+// Each section is a flat array of records, starting at an 8-byte aligned offset.
+// All numbers are stored in native byte order, which is checked on load.
+enum Section
+{
+	StringLengths,		// std::uint32_t per string
+	StringData,			// the characters of all strings, without terminators
+	Layers,				// LayerRecord
+	SelectionGroups,	// SelectionGroupRecord
+	SelectionSets,		// SelectionSetRecord
+	Properties,			// KeyValueRecord
+	Entities,			// EntityRecord
+	KeyValues,			// KeyValueRecord
+	Primitives,			// PrimitiveRecord
+	Brushes,			// BrushRecord
+	Faces,				// FaceRecord
+	Patches,			// PatchRecord
+	ControlVertices,	// ControlVertexRecord
+	Memberships,		// MembershipRecord
+	NumSections
+};
+
+const char Magic[8] = { 'D', 'R', 'M', 'A', 'P', 'S', 'N', 'P' };
+const std::uint32_t ByteOrderMark = 0x01020304;
+
+struct Header
+{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byteOrderMark;
+	std::uint64_t sourceHash;
+	std::uint64_t counts[NumSections];
+};
+
+// Strings are referenced by their index in the string table
+struct LayerRecord
+{
+	std::int32_t id;
+	std::uint32_t name;
+};
+
+struct SelectionGroupRecord
+{
+	std::uint64_t id;
+	std::uint32_t name;
+	std::uint32_t padding;
+};
+
+struct SelectionSetRecord
+{
+	std::uint32_t name;
+};
+
+struct KeyValueRecord
+{
+	std::uint32_t key;
+	std::uint32_t value;
+};
+
+struct EntityRecord
+{
+	std::uint32_t firstKeyValue;
+	std::uint32_t numKeyValues;
+	std::uint32_t firstPrimitive;
+	std::uint32_t numPrimitives;
+};
+
+enum PrimitiveType : std::uint32_t
+{
+	Brush,
+	PatchDef2,
+	PatchDef3,
+};
+
+struct PrimitiveRecord
+{
+	std::uint32_t type;
+	std::uint32_t index; // into the Brushes or Patches section
+};
+
+struct BrushRecord
+{
+	std::uint32_t firstFace;
+	std::uint32_t numFaces;
+	std::uint32_t detailFlag;
+	std::uint32_t padding;
+};
+
+struct FaceRecord
+{
+	double plane[4];	// normal and distance
+	double texdef[6];	// xx, yx, tx, xy, yy, ty
+	std::uint32_t material;
+	std::uint32_t padding;
+};
+
+struct PatchRecord
+{
+	std::uint32_t width;
+	std::uint32_t height;
+	std::uint32_t subdivisionsX;
+	std::uint32_t subdivisionsY;
+	std::uint32_t material;
+	std::uint32_t firstControlVertex; // width*height vertices, column-major like the text formats
+};
+
+struct ControlVertexRecord
+{
+	double vertex[3];
+	double texcoord[2];
+};
+
+enum MembershipType : std::uint32_t
+{
+	Layer,
+	SelectionGroup,
+	SelectionSet,
+};
+
+// Entities and primitives are numbered in the order they appear in the file,
+// the membership records are sorted by this node number
+struct MembershipRecord
+{
+	std::uint32_t node;
+	std::uint32_t type;
+	std::uint64_t id;
+};
+
+}
+
+}
+
+} // namespace map
@@ -0,0 +1,451 @@
+#include "MapSnapshotReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <fmt/format.h>
+
+#include "i18n.h"
+#include "itextstream.h"
+#include "ientity.h"
+#include "ieclass.h"
+#include "ibrush.h"
+#include "ipatch.h"
+#include "imap.h"
+#include "ilayer.h"
+
+#include "math/Plane3.h"
+#include "math/Matrix4.h"
+#include "scenelib.h"
+#include "stream/ContiguousStreamBuf.h"
+
+namespace map
+{
+
+namespace format
+{
+
+MapSnapshotReader::MapSnapshotReader(IMapImportFilter& importFilter) :
+	_importFilter(importFilter),
+	_nodeCount(0),
+	_membershipIndex(0)
+{}
+
+template<typename RecordType>
+RecordType MapSnapshotReader::getRecord(snapshot::Section section, std::size_t index) const
+{
+	if (index >= _header.counts[section])
+	{
+		throw FailureException(_("The snapshot file is corrupt."));
+	}
+
+	RecordType record;
+	std::memcpy(&record, _data.data() + _sectionOffsets[section] + index * sizeof(RecordType), sizeof(RecordType));
+
+	return record;
+}
+
+void MapSnapshotReader::readFromStream(std::istream& stream)
+{
+	// Map files opened by the MapResource are backed by a contiguous memory block,
+	// everything else is copied to a local buffer first
+	auto contiguousBuffer = dynamic_cast<stream::ContiguousStreamBuf*>(stream.rdbuf());
+	std::string localBuffer;
+
+	if (contiguousBuffer != nullptr)
+	{
+		_data = contiguousBuffer->getContents().substr(contiguousBuffer->getPosition());
+	}
+	else
+	{
+		localBuffer.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		_data = localBuffer;
+	}
+
+	readHeader();
+	readStrings();
+
+	readLayers();
+	readSelectionGroups();
+	readSelectionSets();
+	readMapProperties();
+
+	auto numEntities = static_cast<std::uint32_t>(_header.counts[snapshot::Entities]);
+	auto startPosition = contiguousBuffer != nullptr ? contiguousBuffer->getPosition() : 0;
+
+	for (std::uint32_t i = 0; i < numEntities; ++i)
+	{
+		readEntity(i);
+
+		// Report the progress in proportion to the number of processed entities
+		if (contiguousBuffer != nullptr)
+		{
+			contiguousBuffer->setPosition(startPosition + _data.size() * (i + 1) / numEntities);
+		}
+	}
+}
+
+void MapSnapshotReader::readHeader()
+{
+	if (_data.size() < sizeof(snapshot::Header))
+	{
+		throw FailureException(_("The snapshot file is truncated."));
+	}
+
+	std::memcpy(&_header, _data.data(), sizeof(_header));
+
+	if (std::memcmp(_header.magic, snapshot::Magic, sizeof(_header.magic)) != 0 ||
+		_header.byteOrderMark != snapshot::ByteOrderMark)
+	{
+		throw FailureException(_("This is not a map snapshot compatible with this platform."));
+	}
+
+	if (_header.version != MapSnapshotFormat::Version)
+	{
+		throw FailureException(_("Unsupported format version."));
+	}
+
+	// Calculate the section offsets, checking that everything is within the file
+	const std::size_t recordSizes[snapshot::NumSections] =
+	{
+		sizeof(std::uint32_t),					// StringLengths
+		sizeof(char),							// StringData
+		sizeof(snapshot::LayerRecord),
+		sizeof(snapshot::SelectionGroupRecord),
+		sizeof(snapshot::SelectionSetRecord),
+		sizeof(snapshot::KeyValueRecord),		// Properties
+		sizeof(snapshot::EntityRecord),
+		sizeof(snapshot::KeyValueRecord),		// KeyValues
+		sizeof(snapshot::PrimitiveRecord),
+		sizeof(snapshot::BrushRecord),
+		sizeof(snapshot::FaceRecord),
+		sizeof(snapshot::PatchRecord),
+		sizeof(snapshot::ControlVertexRecord),
+		sizeof(snapshot::MembershipRecord),
+	};
+
+	std::size_t offset = (sizeof(snapshot::Header) + 7) & ~static_cast<std::size_t>(7);
+
+	for (int section = 0; section < snapshot::NumSections; ++section)
+	{
+		auto count = _header.counts[section];
+
+		if (count > (_data.size() - std::min(offset, _data.size())) / recordSizes[section])
+		{
+			throw FailureException(_("The snapshot file is truncated."));
+		}
+
+		_sectionOffsets[section] = offset;
+
+		offset += static_cast<std::size_t>(count) * recordSizes[section];
+		offset = (offset + 7) & ~static_cast<std::size_t>(7);
+	}
+}
+
+void MapSnapshotReader::readStrings()
+{
+	auto numStrings = static_cast<std::size_t>(_header.counts[snapshot::StringLengths]);
+	auto stringData = _data.substr(_sectionOffsets[snapshot::StringData],
+		static_cast<std::size_t>(_header.counts[snapshot::StringData]));
+
+	_strings.reserve(numStrings);
+
+	std::size_t offset = 0;
+
+	for (std::size_t i = 0; i < numStrings; ++i)
+	{
+		auto length = getRecord<std::uint32_t>(snapshot::StringLengths, i);
+
+		if (length > stringData.size() - offset)
+		{
+			throw FailureException(_("The snapshot file is corrupt."));
+		}
+
+		_strings.emplace_back(stringData.substr(offset, length));
+		offset += length;
+	}
+}
+
+void MapSnapshotReader::readLayers()
+{
+	auto& layerManager = _importFilter.getRootNode()->getLayerManager();
+
+	layerManager.reset();
+
+	for (std::size_t i = 0; i < _header.counts[snapshot::Layers]; ++i)
+	{
+		auto layer = getRecord<snapshot::LayerRecord>(snapshot::Layers, i);
+		layerManager.createLayer(getString(layer.name), layer.id);
+	}
+}
+
+void MapSnapshotReader::readSelectionGroups()
+{
+	auto& groupManager = _importFilter.getRootNode()->getSelectionGroupManager();
+
+	groupManager.deleteAllSelectionGroups();
+
+	for (std::size_t i = 0; i < _header.counts[snapshot::SelectionGroups]; ++i)
+	{
+		auto group = getRecord<snapshot::SelectionGroupRecord>(snapshot::SelectionGroups, i);
+		groupManager.createSelectionGroup(static_cast<std::size_t>(group.id))->setName(getString(group.name));
+	}
+}
+
+void MapSnapshotReader::readSelectionSets()
+{
+	auto& setManager = _importFilter.getRootNode()->getSelectionSetManager();
+
+	setManager.deleteAllSelectionSets();
+	_selectionSets.clear();
+
+	for (std::size_t i = 0; i < _header.counts[snapshot::SelectionSets]; ++i)
+	{
+		auto set = getRecord<snapshot::SelectionSetRecord>(snapshot::SelectionSets, i);
+		_selectionSets.push_back(setManager.createSelectionSet(getString(set.name)));
+	}
+}
+
+void MapSnapshotReader::readMapProperties()
+{
+	_importFilter.getRootNode()->clearProperties();
+
+	for (std::size_t i = 0; i < _header.counts[snapshot::Properties]; ++i)
+	{
+		auto property = getRecord<snapshot::KeyValueRecord>(snapshot::Properties, i);
+		_importFilter.getRootNode()->setProperty(getString(property.key), getString(property.value));
+	}
+}
+
+void MapSnapshotReader::readEntity(std::uint32_t entityIndex)
+{
+	auto record = getRecord<snapshot::EntityRecord>(snapshot::Entities, entityIndex);
+
+	const std::string* className = nullptr;
+
+	for (std::uint32_t i = 0; i < record.numKeyValues; ++i)
+	{
+		auto keyValue = getRecord<snapshot::KeyValueRecord>(snapshot::KeyValues, record.firstKeyValue + i);
+
+		if (getString(keyValue.key) == "classname")
+		{
+			className = &getString(keyValue.value);
+			break;
+		}
+	}
+
+	if (className == nullptr)
+	{
+		throw FailureException(fmt::format(_("Could not find classname for entity {0:d}."), entityIndex));
+	}
+
+	auto eclass = GlobalEntityClassManager().findClass(*className);
+
+	if (!eclass)
+	{
+		rError() << "MapSnapshotReader: Could not find entity class: " << *className << std::endl;
+
+		// EntityClass not found, insert a brush-based one
+		eclass = GlobalEntityClassManager().findOrInsert(*className, true);
+	}
+
+	auto entity = GlobalEntityModule().createEntity(eclass);
+
+	for (std::uint32_t i = 0; i < record.numKeyValues; ++i)
+	{
+		auto keyValue = getRecord<snapshot::KeyValueRecord>(snapshot::KeyValues, record.firstKeyValue + i);
+		entity->getEntity().setKeyValue(getString(keyValue.key), getString(keyValue.value));
+	}
+
+	auto entityNumber = _nodeCount++;
+
+	std::vector<scene::INodePtr> primitives;
+	primitives.reserve(record.numPrimitives);
+
+	for (std::uint32_t i = 0; i < record.numPrimitives; ++i)
+	{
+		auto primitive = getRecord<snapshot::PrimitiveRecord>(snapshot::Primitives, record.firstPrimitive + i);
+
+		switch (primitive.type)
+		{
+		case snapshot::Brush:
+			primitives.push_back(readBrush(primitive.index));
+			break;
+		case snapshot::PatchDef2:
+		case snapshot::PatchDef3:
+			primitives.push_back(readPatch(primitive.index, static_cast<snapshot::PrimitiveType>(primitive.type)));
+			break;
+		default:
+			throw FailureException(fmt::format(_("Unknown primitive type in entity {0:d}."), entityIndex));
+		};
+	}
+
+	// Insert the primitives before the entity, like the text map readers do
+	for (const auto& primitive : primitives)
+	{
+		_importFilter.addPrimitiveToEntity(primitive, entity);
+	}
+
+	_importFilter.addEntity(entity);
+
+	applyMemberships(entityNumber, entity);
+
+	for (const auto& primitive : primitives)
+	{
+		applyMemberships(_nodeCount++, primitive);
+	}
+}
+
+scene::INodePtr MapSnapshotReader::readBrush(std::uint32_t brushIndex)
+{
+	auto record = getRecord<snapshot::BrushRecord>(snapshot::Brushes, brushIndex);
+
+	auto node = GlobalBrushCreator().createBrush();
+
+	auto brushNode = std::dynamic_pointer_cast<IBrushNode>(node);
+	assert(brushNode);
+
+	auto& brush = brushNode->getIBrush();
+
+	brush.setDetailFlag(static_cast<IBrush::DetailFlag>(record.detailFlag));
+
+	for (std::uint32_t i = 0; i < record.numFaces; ++i)
+	{
+		auto face = getRecord<snapshot::FaceRecord>(snapshot::Faces, record.firstFace + i);
+
+		Plane3 plane;
+
+		plane.normal().x() = face.plane[0];
+		plane.normal().y() = face.plane[1];
+		plane.normal().z() = face.plane[2];
+		plane.dist() = -face.plane[3]; // negate d
+
+		Matrix4 texdef;
+
+		texdef.xx() = face.texdef[0];
+		texdef.yx() = face.texdef[1];
+		texdef.tx() = face.texdef[2];
+		texdef.xy() = face.texdef[3];
+		texdef.yy() = face.texdef[4];
+		texdef.ty() = face.texdef[5];
+
+		brush.addFace(plane, texdef, getString(face.material));
+	}
+
+	return node;
+}
+
+scene::INodePtr MapSnapshotReader::readPatch(std::uint32_t patchIndex, snapshot::PrimitiveType type)
+{
+	auto record = getRecord<snapshot::PatchRecord>(snapshot::Patches, patchIndex);
+
+	auto node = GlobalPatchModule().createPatch(
+		type == snapshot::PatchDef3 ? patch::PatchDefType::Def3 : patch::PatchDefType::Def2);
+
+	auto patchNode = std::dynamic_pointer_cast<IPatchNode>(node);
+	assert(patchNode);
+
+	auto& patch = patchNode->getPatch();
+
+	patch.setShader(getString(record.material));
+	patch.setDims(record.width, record.height);
+
+	if (type == snapshot::PatchDef3)
+	{
+		patch.setFixedSubdivisions(true, Subdivisions(record.subdivisionsX, record.subdivisionsY));
+	}
+
+	// Check the dimensions that have actually been set, they might have been clamped
+	if (patch.getWidth() != record.width || patch.getHeight() != record.height)
+	{
+		throw FailureException(fmt::format(_("Invalid patch dimensions: {0:d}x{1:d}"), record.width, record.height));
+	}
+
+	auto vertexIndex = static_cast<std::size_t>(record.firstControlVertex);
+
+	for (std::size_t c = 0; c < patch.getWidth(); c++)
+	{
+		for (std::size_t r = 0; r < patch.getHeight(); r++)
+		{
+			auto vertex = getRecord<snapshot::ControlVertexRecord>(snapshot::ControlVertices, vertexIndex++);
+			auto& ctrl = patch.ctrlAt(r, c);
+
+			ctrl.vertex[0] = vertex.vertex[0];
+			ctrl.vertex[1] = vertex.vertex[1];
+			ctrl.vertex[2] = vertex.vertex[2];
+
+			ctrl.texcoord[0] = vertex.texcoord[0];
+			ctrl.texcoord[1] = vertex.texcoord[1];
+		}
+	}
+
+	patch.controlPointsChanged();
+
+	return node;
+}
+
+void MapSnapshotReader::applyMemberships(std::uint32_t nodeNumber, const scene::INodePtr& node)
+{
+	scene::LayerList layers;
+	auto numMemberships = static_cast<std::size_t>(_header.counts[snapshot::Memberships]);
+
+	for (; _membershipIndex < numMemberships; ++_membershipIndex)
+	{
+		auto membership = getRecord<snapshot::MembershipRecord>(snapshot::Memberships, _membershipIndex);
+
+		if (membership.node != nodeNumber)
+		{
+			break;
+		}
+
+		switch (membership.type)
+		{
+		case snapshot::Layer:
+			layers.insert(static_cast<int>(membership.id));
+			break;
+		case snapshot::SelectionGroup:
+			{
+				auto group = _importFilter.getRootNode()->getSelectionGroupManager().findOrCreateSelectionGroup(
+					static_cast<std::size_t>(membership.id));
+				group->addNode(node);
+			}
+			break;
+		case snapshot::SelectionSet:
+			if (membership.id < _selectionSets.size())
+			{
+				_selectionSets[static_cast<std::size_t>(membership.id)]->addNode(node);
+			}
+			break;
+		};
+	}
+
+	if (layers.empty()) return;
+
+	node->assignToLayers(layers);
+
+	// Child nodes like entity attachments are sharing the layers of their parent
+	node->foreachNode([&](const scene::INodePtr& child)
+	{
+		if (!Node_isEntity(child) && !Node_isPrimitive(child))
+		{
+			child->assignToLayers(layers);
+		}
+
+		return true;
+	});
+}
+
+const std::string& MapSnapshotReader::getString(std::uint32_t index) const
+{
+	if (index >= _strings.size())
+	{
+		throw FailureException(_("The snapshot file is corrupt."));
+	}
+
+	return _strings[index];
+}
+
+
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "inode.h"
+#include "imapformat.h"
+#include "iselectiongroup.h"
+#include "iselectionset.h"
+#include "MapSnapshotFormat.h"
+
+namespace map
+{
+
+namespace format
+{
+
+/**
+ * Reader for the binary map snapshots. The sections are accessed in place,
+ * the only processing needed is the creation of the scene nodes.
+ */
+class MapSnapshotReader :
+	public IMapReader
+{
+private:
+	IMapImportFilter& _importFilter;
+
+	// The snapshot contents and the offsets of the sections within
+	std::string_view _data;
+	std::size_t _sectionOffsets[snapshot::NumSections];
+	snapshot::Header _header;
+
+	std::vector<std::string> _strings;
+	std::vector<selection::ISelectionSetPtr> _selectionSets;
+
+	// Running number of the created entities and primitives
+	std::uint32_t _nodeCount;
+
+	// Cursor into the membership section, which is sorted by node number
+	std::size_t _membershipIndex;
+
+public:
+	MapSnapshotReader(IMapImportFilter& importFilter);
+
+	// IMapReader implementation
+	void readFromStream(std::istream& stream) override;
+
+private:
+	void readHeader();
+	void readStrings();
+	void readLayers();
+	void readSelectionGroups();
+	void readSelectionSets();
+	void readMapProperties();
+
+	void readEntity(std::uint32_t entityIndex);
+	scene::INodePtr readBrush(std::uint32_t brushIndex);
+	scene::INodePtr readPatch(std::uint32_t patchIndex, snapshot::PrimitiveType type);
+
+	// Applies the layers, groups and sets recorded for the given node number
+	void applyMemberships(std::uint32_t nodeNumber, const scene::INodePtr& node);
+
+	const std::string& getString(std::uint32_t index) const;
+
+	// Copies the record with the given index out of the given section
+	template<typename RecordType>
+	RecordType getRecord(snapshot::Section section, std::size_t index) const;
+};
+
+}
+
+}
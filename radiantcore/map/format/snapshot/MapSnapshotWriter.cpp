@@ -0,0 +1,417 @@
+#include "MapSnapshotWriter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "ientity.h"
+#include "ibrush.h"
+#include "ipatch.h"
+#include "imap.h"
+#include "ilayer.h"
+#include "iselectiongroup.h"
+#include "iselectionset.h"
+
+#include "math/Plane3.h"
+#include "math/Matrix4.h"
+
+namespace map
+{
+
+namespace format
+{
+
+namespace
+{
+	// Writes the given records and pads the stream to the next multiple of 8 bytes
+	template<typename RecordType>
+	void writeSection(std::ostream& stream, const RecordType* records, std::size_t count)
+	{
+		auto size = sizeof(RecordType) * count;
+
+		if (size > 0)
+		{
+			stream.write(reinterpret_cast<const char*>(records), size);
+		}
+
+		const char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+		stream.write(padding, (8 - size % 8) % 8);
+	}
+
+	template<typename RecordType>
+	void writeSection(std::ostream& stream, const std::vector<RecordType>& records)
+	{
+		writeSection(stream, records.data(), records.size());
+	}
+}
+
+MapSnapshotWriter::MapSnapshotWriter(std::uint64_t sourceHash, int precision) :
+	_sourceHash(sourceHash),
+	_precision(precision)
+{}
+
+void MapSnapshotWriter::beginWriteMap(const scene::IMapRootNodePtr& root, std::ostream& stream)
+{
+	// nothing, the map data is captured along with the memberships in the end
+}
+
+void MapSnapshotWriter::endWriteMap(const scene::IMapRootNodePtr& root, std::ostream& stream)
+{
+	captureMap(root);
+	writeSnapshot(stream);
+}
+
+void MapSnapshotWriter::beginWriteEntity(const IEntityNodePtr& entity, std::ostream& stream)
+{
+	beginEntity(std::dynamic_pointer_cast<scene::INode>(entity), entity->getEntity());
+}
+
+void MapSnapshotWriter::endWriteEntity(const IEntityNodePtr& entity, std::ostream& stream)
+{
+	endEntity();
+}
+
+void MapSnapshotWriter::beginWriteBrush(const IBrushNodePtr& brushNode, std::ostream& stream)
+{
+	captureBrush(brushNode->getIBrush());
+	_nodes.push_back(std::dynamic_pointer_cast<scene::INode>(brushNode));
+}
+
+void MapSnapshotWriter::endWriteBrush(const IBrushNodePtr& brush, std::ostream& stream)
+{
+	// nothing
+}
+
+void MapSnapshotWriter::beginWritePatch(const IPatchNodePtr& patchNode, std::ostream& stream)
+{
+	capturePatch(patchNode->getPatch());
+	_nodes.push_back(std::dynamic_pointer_cast<scene::INode>(patchNode));
+}
+
+void MapSnapshotWriter::endWritePatch(const IPatchNodePtr& patch, std::ostream& stream)
+{
+	// nothing
+}
+
+void MapSnapshotWriter::captureEntity(const scene::INodePtr& entity)
+{
+	auto entityNode = std::dynamic_pointer_cast<IEntityNode>(entity);
+
+	if (!entityNode) return;
+
+	beginEntity(entity, entityNode->getEntity());
+
+	entity->foreachNode([&](const scene::INodePtr& child)
+	{
+		if (Node_isBrush(child))
+		{
+			const auto& brush = *Node_getIBrush(child);
+
+			// Like the MapExporter, skip brushes which wouldn't be exported
+			brush.evaluateBRep();
+
+			if (brush.hasContributingFaces())
+			{
+				captureBrush(brush);
+				_nodes.push_back(child);
+			}
+		}
+		else if (Node_isPatch(child))
+		{
+			capturePatch(*Node_getIPatch(child));
+			_nodes.push_back(child);
+		}
+
+		return true;
+	});
+
+	endEntity();
+}
+
+void MapSnapshotWriter::captureMap(const scene::IMapRootNodePtr& root)
+{
+	root->getLayerManager().foreachLayer([&](int layerId, const std::string& layerName)
+	{
+		_layers.push_back(snapshot::LayerRecord{ layerId, getStringIndex(layerName) });
+	});
+
+	root->getSelectionGroupManager().foreachSelectionGroup([&](selection::ISelectionGroup& group)
+	{
+		// Ignore empty groups
+		if (group.size() == 0) return;
+
+		_selectionGroups.push_back(snapshot::SelectionGroupRecord{ group.getId(), getStringIndex(group.getName()), 0 });
+	});
+
+	std::vector<std::set<scene::INodePtr>> selectionSetNodes;
+
+	root->getSelectionSetManager().foreachSelectionSet([&](const selection::ISelectionSetPtr& set)
+	{
+		_selectionSets.push_back(snapshot::SelectionSetRecord{ getStringIndex(set->getName()) });
+		selectionSetNodes.push_back(set->getNodes());
+	});
+
+	root->foreachProperty([&](const std::string& key, const std::string& value)
+	{
+		_properties.push_back(snapshot::KeyValueRecord{ getStringIndex(key), getStringIndex(value) });
+	});
+
+	// The memberships are sorted by node number
+	for (std::uint32_t nodeNumber = 0; nodeNumber < _nodes.size(); ++nodeNumber)
+	{
+		const auto& node = _nodes[nodeNumber];
+
+		if (!node) continue;
+
+		for (auto layerId : node->getLayers())
+		{
+			_memberships.push_back(snapshot::MembershipRecord{ nodeNumber, snapshot::Layer, static_cast<std::uint64_t>(layerId) });
+		}
+
+		auto selectable = std::dynamic_pointer_cast<IGroupSelectable>(node);
+
+		if (selectable)
+		{
+			for (auto groupId : selectable->getGroupIds())
+			{
+				_memberships.push_back(snapshot::MembershipRecord{ nodeNumber, snapshot::SelectionGroup, groupId });
+			}
+		}
+
+		for (std::size_t i = 0; i < selectionSetNodes.size(); ++i)
+		{
+			if (selectionSetNodes[i].count(node) > 0)
+			{
+				_memberships.push_back(snapshot::MembershipRecord{ nodeNumber, snapshot::SelectionSet, i });
+			}
+		}
+	}
+
+	// Don't keep the scene alive
+	_nodes.clear();
+}
+
+void MapSnapshotWriter::setSourceHash(std::uint64_t sourceHash)
+{
+	_sourceHash = sourceHash;
+}
+
+void MapSnapshotWriter::writeSnapshot(std::ostream& stream)
+{
+	// The values are captured as they are, the rounding is done here
+	for (auto& face : _faces)
+	{
+		for (auto& value : face.plane) value = convertDouble(value);
+		for (auto& value : face.texdef) value = convertDouble(value);
+	}
+
+	for (auto& controlVertex : _controlVertices)
+	{
+		for (auto& value : controlVertex.vertex) value = convertDouble(value);
+		for (auto& value : controlVertex.texcoord) value = convertDouble(value);
+	}
+
+	std::vector<std::uint32_t> stringLengths;
+	std::string stringData;
+	stringLengths.reserve(_strings.size());
+
+	for (const auto& str : _strings)
+	{
+		stringLengths.push_back(static_cast<std::uint32_t>(str.size()));
+		stringData.append(str);
+	}
+
+	snapshot::Header header;
+
+	std::memcpy(header.magic, snapshot::Magic, sizeof(header.magic));
+	header.version = MapSnapshotFormat::Version;
+	header.byteOrderMark = snapshot::ByteOrderMark;
+	header.sourceHash = _sourceHash;
+
+	header.counts[snapshot::StringLengths] = stringLengths.size();
+	header.counts[snapshot::StringData] = stringData.size();
+	header.counts[snapshot::Layers] = _layers.size();
+	header.counts[snapshot::SelectionGroups] = _selectionGroups.size();
+	header.counts[snapshot::SelectionSets] = _selectionSets.size();
+	header.counts[snapshot::Properties] = _properties.size();
+	header.counts[snapshot::Entities] = _entities.size();
+	header.counts[snapshot::KeyValues] = _keyValues.size();
+	header.counts[snapshot::Primitives] = _primitives.size();
+	header.counts[snapshot::Brushes] = _brushes.size();
+	header.counts[snapshot::Faces] = _faces.size();
+	header.counts[snapshot::Patches] = _patches.size();
+	header.counts[snapshot::ControlVertices] = _controlVertices.size();
+	header.counts[snapshot::Memberships] = _memberships.size();
+
+	writeSection(stream, &header, 1);
+
+	writeSection(stream, stringLengths);
+	writeSection(stream, stringData.data(), stringData.size());
+	writeSection(stream, _layers);
+	writeSection(stream, _selectionGroups);
+	writeSection(stream, _selectionSets);
+	writeSection(stream, _properties);
+	writeSection(stream, _entities);
+	writeSection(stream, _keyValues);
+	writeSection(stream, _primitives);
+	writeSection(stream, _brushes);
+	writeSection(stream, _faces);
+	writeSection(stream, _patches);
+	writeSection(stream, _controlVertices);
+	writeSection(stream, _memberships);
+
+	if (stream.fail())
+	{
+		throw FailureException("Failed to write the map snapshot.");
+	}
+}
+
+void MapSnapshotWriter::beginEntity(const scene::INodePtr& node, const Entity& entity)
+{
+	snapshot::EntityRecord record;
+
+	record.firstKeyValue = static_cast<std::uint32_t>(_keyValues.size());
+	record.firstPrimitive = static_cast<std::uint32_t>(_primitives.size());
+
+	entity.forEachKeyValue([&](const std::string& key, const std::string& value)
+	{
+		_keyValues.push_back(snapshot::KeyValueRecord{ getStringIndex(key), getStringIndex(value) });
+	});
+
+	record.numKeyValues = static_cast<std::uint32_t>(_keyValues.size()) - record.firstKeyValue;
+	record.numPrimitives = 0;
+
+	_entities.push_back(record);
+	_nodes.push_back(node);
+}
+
+void MapSnapshotWriter::endEntity()
+{
+	auto& record = _entities.back();
+	record.numPrimitives = static_cast<std::uint32_t>(_primitives.size()) - record.firstPrimitive;
+}
+
+void MapSnapshotWriter::captureBrush(const IBrush& brush)
+{
+	// Snapshots of freshly loaded maps are written before the scene has been rendered
+	brush.evaluateBRep();
+
+	snapshot::BrushRecord record;
+	record.firstFace = static_cast<std::uint32_t>(_faces.size());
+	record.detailFlag = static_cast<std::uint32_t>(brush.getDetailFlag());
+	record.padding = 0;
+
+	for (std::size_t i = 0; i < brush.getNumFaces(); ++i)
+	{
+		const auto& face = brush.getFace(i);
+
+		// Skip the non-contributing faces, like the text formats do
+		if (face.getWinding().size() <= 2)
+		{
+			continue;
+		}
+
+		const auto& plane = face.getPlane3();
+		auto texdef = face.getTexDefMatrix();
+
+		snapshot::FaceRecord faceRecord;
+
+		faceRecord.plane[0] = plane.normal().x();
+		faceRecord.plane[1] = plane.normal().y();
+		faceRecord.plane[2] = plane.normal().z();
+		faceRecord.plane[3] = -plane.dist();
+
+		faceRecord.texdef[0] = texdef.xx();
+		faceRecord.texdef[1] = texdef.yx();
+		faceRecord.texdef[2] = texdef.tx();
+		faceRecord.texdef[3] = texdef.xy();
+		faceRecord.texdef[4] = texdef.yy();
+		faceRecord.texdef[5] = texdef.ty();
+
+		faceRecord.material = getStringIndex(!face.getShader().empty() ? face.getShader() : "_default");
+		faceRecord.padding = 0;
+
+		_faces.push_back(faceRecord);
+	}
+
+	record.numFaces = static_cast<std::uint32_t>(_faces.size()) - record.firstFace;
+
+	_primitives.push_back(snapshot::PrimitiveRecord{ snapshot::Brush, static_cast<std::uint32_t>(_brushes.size()) });
+	_brushes.push_back(record);
+}
+
+void MapSnapshotWriter::capturePatch(const IPatch& patch)
+{
+	snapshot::PatchRecord record;
+
+	record.width = static_cast<std::uint32_t>(patch.getWidth());
+	record.height = static_cast<std::uint32_t>(patch.getHeight());
+	record.subdivisionsX = 0;
+	record.subdivisionsY = 0;
+
+	if (patch.subdivisionsFixed())
+	{
+		const auto& subdivisions = patch.getSubdivisions();
+
+		record.subdivisionsX = static_cast<std::uint32_t>(subdivisions.x());
+		record.subdivisionsY = static_cast<std::uint32_t>(subdivisions.y());
+	}
+
+	record.material = getStringIndex(!patch.getShader().empty() ? patch.getShader() : "_default");
+	record.firstControlVertex = static_cast<std::uint32_t>(_controlVertices.size());
+
+	for (std::size_t c = 0; c < patch.getWidth(); c++)
+	{
+		for (std::size_t r = 0; r < patch.getHeight(); r++)
+		{
+			const auto& ctrl = patch.ctrlAt(r, c);
+
+			_controlVertices.push_back(snapshot::ControlVertexRecord
+			{
+				{ ctrl.vertex.x(), ctrl.vertex.y(), ctrl.vertex.z() },
+				{ ctrl.texcoord.x(), ctrl.texcoord.y() }
+			});
+		}
+	}
+
+	auto type = patch.subdivisionsFixed() ? snapshot::PatchDef3 : snapshot::PatchDef2;
+
+	_primitives.push_back(snapshot::PrimitiveRecord{ type, static_cast<std::uint32_t>(_patches.size()) });
+	_patches.push_back(record);
+}
+
+std::uint32_t MapSnapshotWriter::getStringIndex(const std::string& str)
+{
+	auto result = _stringIndices.emplace(str, static_cast<std::uint32_t>(_strings.size()));
+
+	if (result.second)
+	{
+		_strings.push_back(str);
+	}
+
+	return result.first->second;
+}
+
+double MapSnapshotWriter::convertDouble(double value) const
+{
+	// Checks for NaN and infinity, and converts -0 to 0
+	if (!isValid(value) || value == 0.0)
+	{
+		return 0.0;
+	}
+
+	if (_precision <= 0)
+	{
+		return value;
+	}
+
+	// Take the same round trip through the decimal representation as the text formats
+	char buffer[64];
+	std::snprintf(buffer, sizeof(buffer), "%.*g", _precision, value);
+
+	return std::strtod(buffer, nullptr);
+}
+
+}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <set>
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "imapformat.h"
+#include "MapSnapshotFormat.h"
+
+class Entity;
+class IBrush;
+class IPatch;
+
+namespace map
+{
+
+namespace format
+{
+
+/**
+ * Writer collecting the scene contents into the flat arrays of the binary
+ * snapshot format. All data is buffered in memory and written to the stream
+ * in one go when the map is finished.
+ *
+ * Besides acting as IMapWriter, the nodes can be captured while another
+ * writer is exporting them or while a map is being loaded. Capturing needs
+ * to happen on the main thread, while the snapshot can be written on any
+ * thread afterwards since it doesn't reference the scene anymore.
+ */
+class MapSnapshotWriter :
+	public IMapWriter
+{
+private:
+	std::uint64_t _sourceHash;
+
+	// Significant digits the floating point values are rounded to, 0 = no rounding
+	int _precision;
+
+	std::vector<std::string> _strings;
+	std::unordered_map<std::string, std::uint32_t> _stringIndices;
+
+	std::vector<snapshot::LayerRecord> _layers;
+	std::vector<snapshot::SelectionGroupRecord> _selectionGroups;
+	std::vector<snapshot::SelectionSetRecord> _selectionSets;
+	std::vector<snapshot::KeyValueRecord> _properties;
+	std::vector<snapshot::EntityRecord> _entities;
+	std::vector<snapshot::KeyValueRecord> _keyValues;
+	std::vector<snapshot::PrimitiveRecord> _primitives;
+	std::vector<snapshot::BrushRecord> _brushes;
+	std::vector<snapshot::FaceRecord> _faces;
+	std::vector<snapshot::PatchRecord> _patches;
+	std::vector<snapshot::ControlVertexRecord> _controlVertices;
+	std::vector<snapshot::MembershipRecord> _memberships;
+
+	// The captured entities and primitives, numbered in this order.
+	// Their memberships are looked up by captureMap().
+	std::vector<scene::INodePtr> _nodes;
+
+public:
+	// The source hash is stored in the header. A positive precision makes the writer
+	// round all floating point values to the given number of significant digits, like
+	// the text map formats do, to produce the same values as re-loading the text file.
+	MapSnapshotWriter(std::uint64_t sourceHash = 0, int precision = 0);
+
+	void beginWriteMap(const scene::IMapRootNodePtr& root, std::ostream& stream) override;
+	void endWriteMap(const scene::IMapRootNodePtr& root, std::ostream& stream) override;
+
+	void beginWriteEntity(const IEntityNodePtr& entity, std::ostream& stream) override;
+	void endWriteEntity(const IEntityNodePtr& entity, std::ostream& stream) override;
+
+	void beginWriteBrush(const IBrushNodePtr& brush, std::ostream& stream) override;
+	void endWriteBrush(const IBrushNodePtr& brush, std::ostream& stream) override;
+
+	void beginWritePatch(const IPatchNodePtr& patch, std::ostream& stream) override;
+	void endWritePatch(const IPatchNodePtr& patch, std::ostream& stream) override;
+
+	// Captures the given entity along with its child brushes and patches
+	void captureEntity(const scene::INodePtr& entity);
+
+	// Captures the layers, selection groups, selection sets and properties of the map, and the
+	// memberships of the captured nodes. To be called once all nodes have been captured.
+	void captureMap(const scene::IMapRootNodePtr& root);
+
+	void setSourceHash(std::uint64_t sourceHash);
+
+	// Writes the snapshot of the captured map, doesn't access the scene
+	void writeSnapshot(std::ostream& stream);
+
+private:
+	void beginEntity(const scene::INodePtr& node, const Entity& entity);
+	void endEntity();
+	void captureBrush(const IBrush& brush);
+	void capturePatch(const IPatch& patch);
+
+	std::uint32_t getStringIndex(const std::string& str);
+	double convertDouble(double value) const;
+};
+
+}
+
+}
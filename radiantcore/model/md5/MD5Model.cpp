@@ -255,6 +255,11 @@ void MD5Model::setRenderSystem(const RenderSystemPtr& renderSystem)
 {
 	_renderSystem = renderSystem;
 
+	for (const Surface& surface : _surfaces)
+	{
+		surface.surface->setRenderSystem(renderSystem);
+	}
+
 	captureShaders();
 }
 
@@ -112,6 +112,8 @@ void MD5ModelNode::render(RenderableCollector& collector, const VolumeTest& volu
         if (surfaceShader->isVisible())
         {
             assert(i->shader); // shader must be captured at this point
+            i->surface->updateStoredGeometry();
+
             collector.addRenderable(
                 collector.supportsFullMaterials() ? *i->shader
                                                   : *entity.getWireShader(),
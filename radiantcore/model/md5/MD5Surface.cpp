@@ -18,23 +18,21 @@ inline VertexPointer vertexpointer_arbitrarymeshvertex(const ArbitraryMeshVertex
 MD5Surface::MD5Surface() : 
 	_originalShaderName(""),
 	_mesh(new MD5Mesh),
-	_normalList(0),
-	_lightingList(0)
+	_geometry(std::make_shared<render::RetainedGeometry>()),
+	_isDefaultPose(false)
 {}
 
 MD5Surface::MD5Surface(const MD5Surface& other) :
 	_aabb_local(other._aabb_local),
 	_originalShaderName(other._originalShaderName),
 	_mesh(other._mesh),
-	_normalList(0),
-	_lightingList(0)
+	_geometry(other._isDefaultPose ? other._geometry : std::make_shared<render::RetainedGeometry>()),
+	_isDefaultPose(other._isDefaultPose)
 {}
 
 // Destructor
 MD5Surface::~MD5Surface()
-{
-    releaseDisplayLists();
-}
+{}
 
 // Update geometry
 void MD5Surface::updateGeometry()
@@ -65,93 +63,50 @@ void MD5Surface::updateGeometry()
 		i->bitangent.normalise();
 	}
 
-	// Build the display lists
-	createDisplayLists();
+	_geometry->queueVertexUpdate();
 }
 
 // Back-end render
 void MD5Surface::render(const RenderInfo& info) const
 {
-	if (info.checkFlag(RENDER_BUMP))
-    {
-		glCallList(_lightingList);
-	}
-	else
-    {
-		glCallList(_normalList);
-	}
+	ArbitraryMeshVertex_renderTriangles(_vertices, _indices, info);
 }
 
-// Construct the display lists
-void MD5Surface::createDisplayLists()
+bool MD5Surface::getStorageLocation(const render::IGeometryStore*& store, std::size_t& slot) const
 {
-    // Release old display lists first
-    releaseDisplayLists();
+	return _geometry->getStorageLocation(store, slot);
+}
 
-	// Create the list for lighting mode
-	_lightingList = glGenLists(1);
-	assert(_lightingList != 0);
-	glNewList(_lightingList, GL_COMPILE);
+void MD5Surface::setRenderSystem(const RenderSystemPtr& renderSystem)
+{
+	auto current = _geometry->getRenderSystem();
 
-	glBegin(GL_TRIANGLES);
-	for (Indices::const_iterator i = _indices.begin();
-		 i != _indices.end();
-		 ++i)
+	// Copies rendered by another render system can't share the stored geometry
+	if (current && current != renderSystem)
 	{
-		// Get the vertex for this index
-		ArbitraryMeshVertex& v = _vertices[*i];
-
-		// Submit the vertex attributes and coordinate
-		if (GLEW_ARB_vertex_program) {
-			// Submit the vertex attributes and coordinate
-			glVertexAttrib2dvARB(ATTR_TEXCOORD, v.texcoord);
-			glVertexAttrib3dvARB(ATTR_TANGENT, v.tangent);
-			glVertexAttrib3dvARB(ATTR_BITANGENT, v.bitangent);
-			glVertexAttrib3dvARB(ATTR_NORMAL, v.normal);
-		}
-		glVertex3dv(v.vertex);
+		ensureUnsharedGeometry();
 	}
-	glEnd();
-
-	glEndList();
 
-	// Generate the list for flat-shaded (unlit) mode
-	_normalList = glGenLists(1);
-	assert(_normalList != 0);
-	glNewList(_normalList, GL_COMPILE);
+	_geometry->setRenderSystem(renderSystem);
+}
 
-	glBegin(GL_TRIANGLES);
-	for (Indices::const_iterator i = _indices.begin();
-		 i != _indices.end();
-		 ++i)
+void MD5Surface::updateStoredGeometry() const
+{
+	if (_geometry->needsUpdate())
 	{
-		// Get the vertex for this index
-		ArbitraryMeshVertex& v = _vertices[*i];
-
-		// Submit attributes
-		glNormal3dv(v.normal);
-		glTexCoord2dv(v.texcoord);
-		glVertex3dv(v.vertex);
+		_geometry->update(_vertices, _indices);
 	}
-	glEnd();
-
-	glEndList();
 }
 
-void MD5Surface::releaseDisplayLists()
+void MD5Surface::ensureUnsharedGeometry()
 {
-    // Release GL display lists if applicable
-    if (_normalList != 0)
-    {
-        glDeleteLists(_normalList, 1);
-        _normalList = 0;
-    }
-
-    if (_lightingList != 0)
-    {
-        glDeleteLists(_lightingList, 1);
-        _lightingList = 0;
-    }
+	if (_geometry.use_count() > 1)
+	{
+		auto renderSystem = _geometry->getRenderSystem();
+
+		_geometry = std::make_shared<render::RetainedGeometry>();
+		_geometry->setRenderSystem(renderSystem);
+	}
 }
 
 // Selection test
@@ -312,11 +267,17 @@ void MD5Surface::updateToDefaultPose(const MD5Joints& joints)
 
 	buildVertexNormals();
 
+	_isDefaultPose = true;
+
 	updateGeometry();
 }
 
 void MD5Surface::updateToSkeleton(const MD5Skeleton& skeleton)
 {
+	// The posed vertices can't be shared with the other copies
+	_isDefaultPose = false;
+	ensureUnsharedGeometry();
+
 	// Ensure we have all vertices allocated
 	if (_vertices.size() != _mesh->vertices.size())
 	{
@@ -391,6 +352,8 @@ void MD5Surface::buildIndexArray()
 		_indices.push_back(static_cast<RenderIndex>(tri.b));
 		_indices.push_back(static_cast<RenderIndex>(tri.c));
 	}
+
+	_geometry->queueUpdate();
 }
 
 void MD5Surface::parseFromTokens(parser::DefTokeniser& tok)
@@ -2,6 +2,7 @@
 
 #include "irender.h"
 #include "render.h"
+#include "render/RetainedGeometry.h"
 #include "irenderable.h"
 #include "math/AABB.h"
 #include "math/Frustum.h"
@@ -44,17 +45,15 @@ private:
 	Vertices _vertices;
 	Indices _indices;
 
-	// The GL display lists for this surface's geometry
-	GLuint _normalList;
-	GLuint _lightingList;
+	// The triangles in the geometry store of the render system, shared
+	// with the copies of this surface as long as they are in the default pose
+	std::shared_ptr<render::RetainedGeometry> _geometry;
+	bool _isDefaultPose;
 
 private:
 
-	// Create the display lists
-	void createDisplayLists();
-
-    // Frees any display list in use
-    void releaseDisplayLists();
+	// Use an own RetainedGeometry if the current one is shared
+	void ensureUnsharedGeometry();
 
 	// Re-calculate the normal vectors
 	void buildVertexNormals();
@@ -80,7 +79,7 @@ public:
 	void setDefaultMaterial(const std::string& name);
 	
 	/**
-	 * Calculate the AABB and build the display lists for rendering.
+	 * Calculate the AABB and queue the upload of the changed vertices.
 	 */
 	void updateGeometry();
 
@@ -94,9 +93,18 @@ public:
 	// Applies the given Skin to this surface.
 	void applySkin(const ModelSkin& skin);
 
-    // Back-end render function
+    // Back-end render function, only used as long as the geometry is not
+    // in the store of the render system
     void render(const RenderInfo& info) const;
 
+    bool getStorageLocation(const render::IGeometryStore*& store, std::size_t& slot) const override;
+
+    void setRenderSystem(const RenderSystemPtr& renderSystem);
+
+    // Copies the geometry to the store of the render system, if it has been changed.
+    // To be called before submitting this surface for rendering.
+    void updateStoredGeometry() const;
+
 	const AABB& localAABB() const;
 
 	// Test for selection
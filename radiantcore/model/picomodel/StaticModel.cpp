@@ -110,6 +110,8 @@ void StaticModel::renderSolid(RenderableCollector& rend,
     // Submit renderables from each surface
     foreachVisibleSurface([&](const Surface& s)
     {
+        s.surface->updateStoredGeometry();
+
         // Submit the ordinary shader for material-based rendering
         rend.addRenderable(*s.shader, *s.surface, localToWorld,
                            &litObject, &entity);
@@ -123,6 +125,8 @@ void StaticModel::renderWireframe(RenderableCollector& rend,
     // Submit renderables from each surface
     foreachVisibleSurface([&](const Surface& s)
     {
+        s.surface->updateStoredGeometry();
+
         // Submit the wireframe shader for non-shaded renderers
         rend.addRenderable(*entity.getWireShader(), *s.surface, localToWorld,
                            nullptr, &entity);
@@ -133,6 +137,11 @@ void StaticModel::setRenderSystem(const RenderSystemPtr& renderSystem)
 {
     _renderSystem = renderSystem;
 
+    for (const Surface& surface : _surfVec)
+    {
+        surface.surface->setRenderSystem(renderSystem);
+    }
+
     captureShaders();
 }
 
@@ -15,9 +15,7 @@ namespace model {
 StaticModelSurface::StaticModelSurface(picoSurface_t* surf,
 											 const std::string& fExt)
 : _defaultMaterial(""),
-  _dlRegular(0),
-  _dlProgramVcol(0),
-  _dlProgramNoVCol(0)
+  _geometry(std::make_shared<render::RetainedGeometry>())
 {
 	// Get the shader from the picomodel struct. If this is a LWO model, use
 	// the material name to select the shader, while for an ASE model the
@@ -89,9 +87,6 @@ StaticModelSurface::StaticModelSurface(picoSurface_t* surf,
 
 	// Calculate the tangent and bitangent vectors
 	calculateTangents();
-
-	// Construct the DLs
-	createDisplayLists();
 }
 
 StaticModelSurface::StaticModelSurface(const StaticModelSurface& other) :
@@ -100,12 +95,8 @@ StaticModelSurface::StaticModelSurface(const StaticModelSurface& other) :
 	_indices(other._indices),
 	_nIndices(other._nIndices),
 	_localAABB(other._localAABB),
-	_dlRegular(0),
-	_dlProgramVcol(0),
-	_dlProgramNoVCol(0)
-{
-	createDisplayLists();
-}
+	_geometry(other._geometry)
+{}
 
 std::string StaticModelSurface::cleanupShaderName(const std::string& inName)
 {
@@ -149,13 +140,8 @@ std::string StaticModelSurface::cleanupShaderName(const std::string& inName)
 	}
 }
 
-// Destructor. Release the GL display lists.
 StaticModelSurface::~StaticModelSurface()
-{
-	glDeleteLists(_dlRegular, 1);
-	glDeleteLists(_dlProgramNoVCol, 1);
-	glDeleteLists(_dlProgramVcol, 1);
-}
+{}
 
 // Convert byte pointers to colour vector
 Vector3 StaticModelSurface::getColourVector(unsigned char* array) {
@@ -197,92 +183,33 @@ void StaticModelSurface::calculateTangents() {
 // Back-end render function
 void StaticModelSurface::render(const RenderInfo& info) const
 {
-	// Invoke appropriate display list
-	if (info.checkFlag(RENDER_PROGRAM))
-    {
-        if (info.checkFlag(RENDER_VERTEX_COLOUR))
-        {
-            glCallList(_dlProgramVcol);
-        }
-        else
-        {
-            glCallList(_dlProgramNoVCol);
-        }
-	}
-	else
-    {
-		glCallList(_dlRegular);
-	}
+	ArbitraryMeshVertex_renderTriangles(_vertices, _indices, info);
 }
 
-// Construct a list for GLProgram mode, either with or without vertex colour
-GLuint StaticModelSurface::compileProgramList(bool includeColour)
+bool StaticModelSurface::getStorageLocation(const render::IGeometryStore*& store, std::size_t& slot) const
 {
-    GLuint list = glGenLists(1);
-	assert(list != 0); // check if we run out of display lists
-    glNewList(list, GL_COMPILE);
-
-	glBegin(GL_TRIANGLES);
-	for (Indices::const_iterator i = _indices.begin();
-		 i != _indices.end();
-		 ++i)
-	{
-		// Get the vertex for this index
-		ArbitraryMeshVertex& v = _vertices[*i];
-
-		// Submit the vertex attributes and coordinate
-		if (GLEW_ARB_vertex_program)
-        {
-			glVertexAttrib2dvARB(ATTR_TEXCOORD, v.texcoord);
-			glVertexAttrib3dvARB(ATTR_TANGENT, v.tangent);
-			glVertexAttrib3dvARB(ATTR_BITANGENT, v.bitangent);
-			glVertexAttrib3dvARB(ATTR_NORMAL, v.normal);
-		}
+	return _geometry->getStorageLocation(store, slot);
+}
 
-        // Optional vertex colour
-        if (includeColour)
-        {
-            glColor3dv(v.colour);
-        }
+void StaticModelSurface::setRenderSystem(const RenderSystemPtr& renderSystem)
+{
+	auto current = _geometry->getRenderSystem();
 
-        // Submit the vertex itself
-		glVertex3dv(v.vertex);
+	// Copies rendered by another render system can't share the stored geometry
+	if (current && current != renderSystem && _geometry.use_count() > 1)
+	{
+		_geometry = std::make_shared<render::RetainedGeometry>();
 	}
-	glEnd();
-
-	glEndList();
 
-    return list;
+	_geometry->setRenderSystem(renderSystem);
 }
 
-// Construct the two display lists
-void StaticModelSurface::createDisplayLists()
+void StaticModelSurface::updateStoredGeometry() const
 {
-	// Generate the lists for lighting mode
-    _dlProgramNoVCol = compileProgramList(false);
-    _dlProgramVcol = compileProgramList(true);
-
-	// Generate the list for flat-shaded (unlit) mode
-	_dlRegular = glGenLists(1);
-	assert(_dlRegular != 0); // check if we run out of display lists
-	glNewList(_dlRegular, GL_COMPILE);
-
-	glBegin(GL_TRIANGLES);
-	for (Indices::const_iterator i = _indices.begin();
-		 i != _indices.end();
-		 ++i)
+	if (_geometry->needsUpdate())
 	{
-		// Get the vertex for this index
-		ArbitraryMeshVertex& v = _vertices[*i];
-
-		// Submit attributes
-		glNormal3dv(v.normal);
-		glTexCoord2dv(v.texcoord);
-		glVertex3dv(v.vertex);
+		_geometry->update(_vertices, _indices);
 	}
-	glEnd();
-
-	glEndList();
 }
 
 // Perform selection test for this surface
@@ -440,11 +367,16 @@ void StaticModelSurface::applyScale(const Vector3& scale, const StaticModelSurfa
 
 	calculateTangents();
 
-	glDeleteLists(_dlRegular, 1);
-	glDeleteLists(_dlProgramNoVCol, 1);
-	glDeleteLists(_dlProgramVcol, 1);
+	// The vertices differ from the other copies now, use our own storage
+	if (_geometry.use_count() > 1)
+	{
+		auto renderSystem = _geometry->getRenderSystem();
+
+		_geometry = std::make_shared<render::RetainedGeometry>();
+		_geometry->setRenderSystem(renderSystem);
+	}
 
-	createDisplayLists();
+	_geometry->queueVertexUpdate();
 }
 
 } // namespace model
@@ -3,6 +3,7 @@
 #include "GLProgramAttributes.h"
 #include "lib/picomodel.h"
 #include "render.h"
+#include "render/RetainedGeometry.h"
 #include "math/AABB.h"
 
 #include "ishaders.h"
@@ -54,10 +55,9 @@ class StaticModelSurface :
 	// The AABB containing this surface, in local object space.
 	AABB _localAABB;
 
-	// The GL display lists for this surface's geometry
-	GLuint _dlRegular;
-	GLuint _dlProgramVcol;
-    GLuint _dlProgramNoVCol;
+	// The triangles in the geometry store of the render system, shared
+	// with the unmodified copies of this surface
+	std::shared_ptr<render::RetainedGeometry> _geometry;
 
 private:
 
@@ -67,10 +67,6 @@ private:
 	// Calculate tangent and bitangent vectors for all vertices.
 	void calculateTangents();
 
-	// Create the display lists
-    GLuint compileProgramList(bool includeColour);
-	void createDisplayLists();
-
 	std::string cleanupShaderName(const std::string& mapName);
 
 public:
@@ -91,10 +87,19 @@ public:
 	~StaticModelSurface();
 
 	/**
-	 * Render function from OpenGLRenderable
+	 * Render function from OpenGLRenderable, only used as long as the
+	 * geometry is not in the store of the render system.
 	 */
 	void render(const RenderInfo& info) const;
 
+	bool getStorageLocation(const render::IGeometryStore*& store, std::size_t& slot) const override;
+
+	void setRenderSystem(const RenderSystemPtr& renderSystem);
+
+	// Copies the geometry to the store of the render system, if it has been changed.
+	// To be called before submitting this surface for rendering.
+	void updateStoredGeometry() const;
+
 	/** Get the containing AABB for this surface.
 	 */
 	const AABB& getAABB() const {
@@ -11,14 +11,16 @@
 #include "ifilesystem.h"
 #include "ifiletypes.h"
 #include "iarchive.h"
+#include "ideclscheduler.h"
 #include "igame.h"
 #include "i18n.h"
 
 #include "parser/DefTokeniser.h"
 #include "math/Vector4.h"
 #include "os/fs.h"
+#include "stream/utils.h"
 
-#include "debugging/ScopedDebugTimer.h"
+#include "ParallelDefFileLoader.h"
 
 #include <fstream>
 #include <iostream>
@@ -153,19 +155,32 @@ void ParticlesManager::ensureDefsLoaded()
 }
 
 // Parse particle defs from string
-void ParticlesManager::parseStream(std::istream& contents, const std::string& filename)
+ParticlesManager::ParsedParticleFile ParticlesManager::parseStream(std::string contents, const std::string& filename)
 {
+	ParsedParticleFile result;
+	result.contents = std::move(contents);
+
 	// Usual ritual, get a parser::DefTokeniser and start tokenising the DEFs
-	parser::BasicDefTokeniser<std::istream> tok(contents);
+	parser::BasicDefTokeniser<std::string_view> tok(result.contents);
 
-	while (tok.hasMoreTokens())
+	try
+	{
+		while (tok.hasMoreTokens())
+		{
+			parseParticleDef(tok, filename, result);
+		}
+	}
+	catch (parser::ParseException& e)
 	{
-		parseParticleDef(tok, filename);
+		result.error = e.what();
 	}
+
+	return result;
 }
 
 // Parse a single particle def
-void ParticlesManager::parseParticleDef(parser::DefTokeniser& tok, const std::string& filename)
+void ParticlesManager::parseParticleDef(parser::BasicDefTokeniser<std::string_view>& tok,
+	const std::string& filename, ParsedParticleFile& result)
 {
 	// Standard DEF, starts with "particle <name> {"
 	std::string declName = tok.nextToken();
@@ -195,16 +210,58 @@ void ParticlesManager::parseParticleDef(parser::DefTokeniser& tok, const std::st
 	}
 
 	// Valid particle declaration, go ahead parsing the name
-	std::string name = tok.nextToken();
+	ParsedParticle parsed;
+	parsed.name = tok.nextToken();
+
+	// Remember where the block starts, in case an existing def needs to be parsed from it
+	parsed.blockStart = tok.hasMoreTokens() && tok.peek() == "{" &&
+		result.contents[tok.getPosition() - 1] == '{' ? tok.getPosition() - 1 : std::string::npos;
+
 	tok.assertNextToken("{");
 
-    // Find the particle def (use the non-blocking, internal lookup)
-	ParticleDefPtr pdef = findOrInsertParticleDefInternal(name);
+	// Parse into a new def, it replaces the existing one or is merged into it later
+	parsed.def = std::make_shared<ParticleDef>(parsed.name);
+	parsed.def->setFilename(filename);
 
-	pdef->setFilename(filename);
+	result.particles.push_back(parsed);
 
 	// Let the particle construct itself from the token stream
-	pdef->parseFromTokens(tok);
+	parsed.def->parseFromTokens(tok);
+}
+
+void ParticlesManager::addParticleDefs(const ParsedParticleFile& parsedFile, const std::string& filename)
+{
+	for (const auto& parsed : parsedFile.particles)
+	{
+		auto existing = _particleDefs.find(parsed.name);
+
+		if (existing == _particleDefs.end())
+		{
+			_particleDefs.emplace(parsed.name, parsed.def);
+			continue;
+		}
+
+		// An existing def (from a previous file or a previous load) is updated in place,
+		// so the objects referencing it get notified. Parsing the incomplete last def
+		// of a file fails again with the same error.
+		existing->second->setFilename(filename);
+
+		if (parsed.blockStart == std::string::npos)
+		{
+			throw parser::ParseException("DefTokeniser: Assertion failed: Required \"{\"");
+		}
+
+		parser::BasicDefTokeniser<std::string_view> tok(
+			std::string_view(parsedFile.contents).substr(parsed.blockStart));
+
+		tok.assertNextToken("{");
+		existing->second->parseFromTokens(tok);
+	}
+
+	if (!parsedFile.error.empty())
+	{
+		throw parser::ParseException(parsedFile.error);
+	}
 }
 
 const std::string& ParticlesManager::getName() const
@@ -222,6 +279,7 @@ const StringSet& ParticlesManager::getDependencies() const
 		_dependencies.insert(MODULE_VIRTUALFILESYSTEM);
 		_dependencies.insert(MODULE_COMMANDSYSTEM);
 		_dependencies.insert(MODULE_FILETYPES);
+		_dependencies.insert(MODULE_DECLARATION_SCHEDULER);
 	}
 
 	return _dependencies;
@@ -244,35 +302,48 @@ void ParticlesManager::initialiseModule(const IApplicationContext& ctx)
 
 void ParticlesManager::reloadParticleDefs()
 {
-	ScopedDebugTimer timer("Particle definitions parsed: ");
+	util::ParallelDefFileLoader<ParsedParticleFile> loader("particles");
 
     GlobalFileSystem().forEachFile(
         PARTICLES_DIR, PARTICLES_EXT,
+        [&](const vfs::FileInfo& fileInfo) { loader.addFile(fileInfo); },
+        1 // depth == 1: don't search subdirectories
+    );
+
+    loader.load(
         [&](const vfs::FileInfo& fileInfo)
         {
             // Attempt to open the file in text mode
             ArchiveTextFilePtr file = GlobalFileSystem().openTextFile(PARTICLES_DIR + fileInfo.name);
 
-            if (file != NULL)
+            if (!file)
             {
-                // File is open, so parse the tokens
-                try 
-                {
-                    std::istream is(&(file->getInputStream()));
-                    parseStream(is, fileInfo.name);
-                }
-                catch (parser::ParseException& e)
-                {
-                    rError() << "[particles] Failed to parse " << fileInfo.name
-                        << ": " << e.what() << std::endl;
-                }
+                ParsedParticleFile result;
+                result.openFailed = true;
+                return result;
             }
-            else
+
+            // File is open, so parse the tokens
+            return parseStream(stream::readAll(file->getInputStream()), fileInfo.name);
+        },
+        [&](const vfs::FileInfo& fileInfo, const ParsedParticleFile& parsedFile)
+        {
+            if (parsedFile.openFailed)
             {
                 rError() << "[particles] Unable to open " << fileInfo.name << std::endl;
+                return;
             }
-        },
-        1 // depth == 1: don't search subdirectories
+
+            try
+            {
+                addParticleDefs(parsedFile, fileInfo.name);
+            }
+            catch (parser::ParseException& e)
+            {
+                rError() << "[particles] Failed to parse " << fileInfo.name
+                    << ": " << e.what() << std::endl;
+            }
+        }
     );
 
     rMessage() << "Found " << _particleDefs.size() << " particle definitions." << std::endl;
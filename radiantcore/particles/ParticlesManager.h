@@ -65,14 +65,42 @@ private:
     // that it's done loading before accessing any defs.
     void ensureDefsLoaded();
 
+    // A particle def parsed on one of the loader threads
+    struct ParsedParticle
+    {
+        std::string name;
+        ParticleDefPtr def;
+
+        // Offset of the opening brace in the file contents, npos if unknown
+        std::size_t blockStart;
+    };
+
+    struct ParsedParticleFile
+    {
+        // The file contents are kept to parse existing defs again when merging
+        std::string contents;
+        std::vector<ParsedParticle> particles;
+
+        // The parse error which stopped parsing the file, the last def is incomplete
+        std::string error;
+
+        bool openFailed = false;
+    };
+
     /**
-    * Accept a stream containing particle definitions to parse and add to the
-    * list.
+    * Accept the contents of a file containing particle definitions to parse,
+    * the defs are not added to the list yet. Can be called from any thread.
     */
-    void parseStream(std::istream& s, const std::string& filename);
+    ParsedParticleFile parseStream(std::string contents, const std::string& filename);
 
 	// Recursive-descent parse functions
-	void parseParticleDef(parser::DefTokeniser& tok, const std::string& filename);
+	void parseParticleDef(parser::BasicDefTokeniser<std::string_view>& tok,
+		const std::string& filename, ParsedParticleFile& result);
+
+    // Adds the parsed defs to the list. Defs which are already existing are updated
+    // in place, so the last definition of a particle wins like it always did.
+    // Throws a ParseException if the file couldn't be parsed completely.
+    void addParticleDefs(const ParsedParticleFile& parsedFile, const std::string& filename);
 
 	static void stripParticleDefFromStream(std::istream& input, std::ostream& output, const std::string& particleName);
 };
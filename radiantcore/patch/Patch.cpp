@@ -220,6 +220,7 @@ void Patch::setRenderSystem(const RenderSystemPtr& renderSystem)
 {
     _renderSystem = renderSystem;
     _shader.setRenderSystem(renderSystem);
+    _solidRenderable.setRenderSystem(renderSystem);
 
 #if DEBUG_PATCH_NTB_VECTORS
     _renderableNTBVectors.setRenderSystem(renderSystem);
@@ -2715,7 +2716,11 @@ void Patch::setFixedSubdivisions(bool isFixed, const Subdivisions& divisions)
 		_subDivisions.y() = 4;
 	}
 
-    SceneChangeNotify();
+    if (_node.inScene())
+    {
+        SceneChangeNotify();
+    }
+
     textureChanged();
     controlPointsChanged();
 }
@@ -2777,7 +2782,12 @@ void Patch::textureChanged()
         (*i++)->onPatchTextureChanged();
     }
 
-    signal_patchTextureChanged().emit();
+    // Patches outside the scene (e.g. while being parsed by a map loader
+    // worker thread) must not fire the global signal
+    if (_node.inScene())
+    {
+        signal_patchTextureChanged().emit();
+    }
 }
 
 void Patch::attachObserver(Observer* observer)
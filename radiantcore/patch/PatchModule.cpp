@@ -27,13 +27,16 @@ namespace
 
 scene::INodePtr PatchModule::createPatch(PatchDefType type)
 {
-	scene::INodePtr node = std::make_shared<PatchNode>(type);
+	// All patches are created in the active layer by default
+	auto root = GlobalMapModule().getRoot();
 
-	if (GlobalMapModule().getRoot())
-	{
-		// All patches are created in the active layer by default
-		node->moveToLayer(GlobalMapModule().getRoot()->getLayerManager().getActiveLayer());
-	}
+	return createPatch(type, root ? root->getLayerManager().getActiveLayer() : 0);
+}
+
+scene::INodePtr PatchModule::createPatch(PatchDefType type, int layer)
+{
+	scene::INodePtr node = std::make_shared<PatchNode>(type);
+	node->moveToLayer(layer);
 
 	return node;
 }
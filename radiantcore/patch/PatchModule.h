@@ -18,6 +18,7 @@ private:
 public:
 	// PatchCreator implementation
 	scene::INodePtr createPatch(PatchDefType type) override;
+	scene::INodePtr createPatch(PatchDefType type, int layer) override;
 
 	IPatchSettings& getSettings() override;
 
@@ -273,6 +273,7 @@ void PatchNode::renderSolid(RenderableCollector& collector, const VolumeTest& vo
     // Defer the tesselation calculation to the last minute
 	const_cast<Patch&>(m_patch).evaluateTransform();
     const_cast<Patch&>(m_patch).updateTesselation();
+    const_cast<Patch&>(m_patch)._solidRenderable.update();
 
 	assert(_renderEntity); // patches rendered without parent - no way!
 
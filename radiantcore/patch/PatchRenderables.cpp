@@ -91,9 +91,52 @@ void RenderablePatchSolid::render(const RenderInfo& info) const
 	}
 }
 
+bool RenderablePatchSolid::getStorageLocation(const render::IGeometryStore*& store, std::size_t& slot) const
+{
+    return _geometry.getStorageLocation(store, slot);
+}
+
+void RenderablePatchSolid::setRenderSystem(const RenderSystemPtr& renderSystem)
+{
+    _geometry.setRenderSystem(renderSystem);
+}
+
+void RenderablePatchSolid::update()
+{
+    if (!_geometry.needsUpdate()) return;
+
+    std::vector<unsigned int> indices;
+
+    if (!_tess.vertices.empty() && _tess.lenStrips >= 4)
+    {
+        indices.reserve(_tess.numStrips * (_tess.lenStrips - 2) * 3);
+
+        // Split the quads of each strip into two triangles
+        const RenderIndex* strip_indices = &_tess.indices.front();
+        for (std::size_t i = 0;
+            i < _tess.numStrips;
+            i++, strip_indices += _tess.lenStrips)
+        {
+            for (std::size_t k = 0; k + 3 < _tess.lenStrips; k += 2)
+            {
+                indices.push_back(strip_indices[k]);
+                indices.push_back(strip_indices[k + 1]);
+                indices.push_back(strip_indices[k + 3]);
+
+                indices.push_back(strip_indices[k]);
+                indices.push_back(strip_indices[k + 3]);
+                indices.push_back(strip_indices[k + 2]);
+            }
+        }
+    }
+
+    _geometry.update(_tess.vertices, indices);
+}
+
 void RenderablePatchSolid::queueUpdate()
 {
     _needsUpdate = true;
+    _geometry.queueUpdate();
 }
 
 const ShaderPtr& RenderablePatchVectorsNTB::getShader() const
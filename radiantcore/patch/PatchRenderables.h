@@ -10,6 +10,7 @@
 
 #include "render/VertexBuffer.h"
 #include "render/IndexedVertexBuffer.h"
+#include "render/RetainedGeometry.h"
 
 /// Helper class to render a PatchTesselation in wireframe mode
 class RenderablePatchWireframe :
@@ -61,11 +62,21 @@ class RenderablePatchSolid :
 
     mutable bool _needsUpdate;
 
+    // The tesselation triangles in the geometry store of the render system
+    render::RetainedGeometry _geometry;
+
 public:
 	RenderablePatchSolid(PatchTesselation& tess);
 
 	void render(const RenderInfo& info) const;
 
+    bool getStorageLocation(const render::IGeometryStore*& store, std::size_t& slot) const override;
+
+    void setRenderSystem(const RenderSystemPtr& renderSystem);
+
+    // Copies the tesselation to the geometry store, if it has been changed
+    void update();
+
     void queueUpdate();
 };
 
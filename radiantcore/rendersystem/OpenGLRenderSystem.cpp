@@ -4,13 +4,19 @@
 #include "igl.h"
 #include "itextstream.h"
 #include "iradiant.h"
+#include "i18n.h"
 
 #include "math/Matrix4.h"
 #include "module/StaticModule.h"
 #include "backend/GLProgramFactory.h"
+#include "command/ExecutionFailure.h"
+#include "render/RadixSort.h"
 #include "debugging/debugging.h"
 
 #include <functional>
+#include <fstream>
+#include <algorithm>
+#include <fmt/format.h>
 
 namespace render {
 
@@ -113,6 +119,18 @@ void OpenGLRenderSystem::render(RenderStateFlags globalstate,
                                const Matrix4& projection,
                                const Vector3& viewer)
 {
+    ScopedRenderProfileSection backEndSection(_profiler, "Back end");
+
+    {
+        ScopedRenderProfileSection uploadSection(_profiler, "Upload");
+
+        // Swap in the pixels of the textures loaded in the background
+        GlobalMaterialManager().uploadStreamedTextures();
+
+        // Upload the geometry changed since the last frame
+        _geometryStore.syncToBufferObjects();
+    }
+
     glPushAttrib(GL_ALL_ATTRIB_BITS);
 
     // Set the projection and modelview matrices
@@ -193,21 +211,19 @@ void OpenGLRenderSystem::render(RenderStateFlags globalstate,
     glHint(GL_FOG_HINT, GL_NICEST);
     glDisable(GL_FOG);
 
-    // Iterate over the sorted mapping between OpenGLStates and their
-    // OpenGLShaderPasses (containing the renderable geometry), and render the
-    // contents of each bucket. Each pass is passed a reference to the "current"
-    // state, which it can change.
-    for (OpenGLStates::iterator i = _state_sorted.begin();
-        i != _state_sorted.end();
-        ++i)
+    // Render the OpenGLShaderPasses which received renderables in the order
+    // of their sort keys, consecutive passes share most of their state. Each
+    // pass is passed a reference to the "current" state, which it can change.
+    RadixSortByKey(_renderQueue, _renderQueueBuffer,
+                   [](const RenderQueueEntry& entry) { return entry.sortKey; });
+
+    for (const RenderQueueEntry& entry : _renderQueue)
     {
-        // Render the OpenGLShaderPass
-        if (!i->second->empty())
-        {
-            i->second->render(current, globalstate, viewer, _time);
-        }
+        entry.pass->render(current, globalstate, viewer, _time);
     }
 
+    _renderQueue.clear();
+
     glPopAttrib();
 }
 
@@ -252,6 +268,12 @@ void OpenGLRenderSystem::unrealise()
         sp->unrealise();
     }
 
+    // The buffer objects are re-created from the stored data when needed
+    if (GlobalOpenGLContext().getSharedContext())
+    {
+        _geometryStore.releaseBufferObjects();
+    }
+
 	if (GlobalOpenGLContext().getSharedContext() && 
         shaderProgramsAvailable() && 
         getCurrentShaderProgram() != SHADER_PROGRAM_NONE)
@@ -348,12 +370,56 @@ void OpenGLRenderSystem::setShaderProgramsAvailable(bool available)
     _shaderProgramsAvailable = available;
 }
 
-void OpenGLRenderSystem::insertSortedState(const OpenGLStates::value_type& val) {
-    _state_sorted.insert(val);
+GeometryStore& OpenGLRenderSystem::getGeometryStore()
+{
+    return _geometryStore;
+}
+
+RenderProfiler& OpenGLRenderSystem::getProfiler()
+{
+    return _profiler;
 }
 
-void OpenGLRenderSystem::eraseSortedState(const OpenGLStates::key_type& key) {
-    _state_sorted.erase(key);
+void OpenGLRenderSystem::insertPass(const OpenGLShaderPassPtr& pass)
+{
+    const OpenGLState& state = pass->state();
+
+    // Number the programs in the order they show up, 0 is the fixed-function pipeline
+    std::uint64_t programIndex = 0;
+
+    if (state.glProgram)
+    {
+        auto found = std::find(_sortedPrograms.begin(), _sortedPrograms.end(), state.glProgram);
+
+        if (found == _sortedPrograms.end())
+        {
+            found = _sortedPrograms.insert(found, state.glProgram);
+        }
+
+        programIndex = std::min<std::uint64_t>(found - _sortedPrograms.begin() + 1, 7);
+    }
+
+    // Sort position (13 bits) | program (3 bits) | first texture (24 bits) | render flags (24 bits)
+    std::uint64_t sortPosition = static_cast<std::uint64_t>(state.getSortPosition() - OpenGLState::SORT_FIRST);
+    std::uint64_t texture = std::min<std::uint64_t>(static_cast<std::uint64_t>(state.texture0), 0xffffff);
+
+    pass->setSortKey((sortPosition & 0x1fff) << 51 | programIndex << 48 | texture << 24 |
+                     (state.getRenderFlags() & 0xffffff));
+}
+
+void OpenGLRenderSystem::erasePass(const OpenGLShaderPassPtr& pass)
+{
+    if (!pass->isQueued()) return;
+
+    _renderQueue.erase(std::remove_if(_renderQueue.begin(), _renderQueue.end(),
+        [&](const RenderQueueEntry& entry) { return entry.pass == pass.get(); }), _renderQueue.end());
+
+    pass->clearRenderables();
+}
+
+void OpenGLRenderSystem::queuePass(OpenGLShaderPass& pass)
+{
+    _renderQueue.push_back(RenderQueueEntry{ pass.getSortKey(), &pass });
 }
 
 // renderables
@@ -393,6 +459,7 @@ const StringSet& OpenGLRenderSystem::getDependencies() const
 	{
 		_dependencies.insert(MODULE_SHADERSYSTEM);
 		_dependencies.insert(MODULE_SHARED_GL_CONTEXT);
+		_dependencies.insert(MODULE_COMMANDSYSTEM);
 	}
 
     return _dependencies;
@@ -420,6 +487,14 @@ void OpenGLRenderSystem::initialiseModule(const IApplicationContext& ctx)
 
     _sharedContextDestroyed = GlobalOpenGLContext().signal_sharedContextDestroyed()
         .connect(sigc::mem_fun(this, &OpenGLRenderSystem::unrealise));
+
+    _defaultProfilePath = ctx.getSettingsPath() + "renderprofile.json";
+
+    GlobalCommandSystem().addCommand("RenderProfilerStart",
+        std::bind(&OpenGLRenderSystem::startProfilingCmd, this, std::placeholders::_1));
+    GlobalCommandSystem().addCommand("RenderProfilerDump",
+        std::bind(&OpenGLRenderSystem::dumpProfileCmd, this, std::placeholders::_1),
+        { cmd::ARGTYPE_STRING | cmd::ARGTYPE_OPTIONAL });
 }
 
 void OpenGLRenderSystem::shutdownModule()
@@ -430,6 +505,37 @@ void OpenGLRenderSystem::shutdownModule()
 	_materialDefsUnloaded.disconnect();
 }
 
+void OpenGLRenderSystem::startProfilingCmd(const cmd::ArgumentList& args)
+{
+    _profiler.startRecording();
+
+    rMessage() << "Render profiler: recording, use RenderProfilerDump to write the trace." << std::endl;
+}
+
+void OpenGLRenderSystem::dumpProfileCmd(const cmd::ArgumentList& args)
+{
+    if (!_profiler.isRecording())
+    {
+        throw cmd::ExecutionFailure(_("The render profiler is not recording, use RenderProfilerStart first."));
+    }
+
+    _profiler.stopRecording();
+
+    auto path = args.empty() || args[0].getString().empty() ? _defaultProfilePath : args[0].getString();
+
+    std::ofstream stream(path);
+
+    if (!stream)
+    {
+        throw cmd::ExecutionFailure(fmt::format(_("Could not open {0} for writing"), path));
+    }
+
+    _profiler.writeChromeTrace(stream);
+
+    rMessage() << "Render profiler: wrote " << _profiler.getNumRecordedFrames() <<
+        " frames to " << path << std::endl;
+}
+
 // Define the static OpenGLRenderSystem module
 module::StaticModule<OpenGLRenderSystem> openGLRenderSystemModule;
 
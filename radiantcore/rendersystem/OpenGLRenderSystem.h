@@ -1,12 +1,15 @@
 #pragma once
 
 #include "irender.h"
+#include "icommandsystem.h"
 #include <sigc++/connection.h>
 #include <map>
+#include <cstdint>
 #include "imodule.h"
 #include "backend/OpenGLStateManager.h"
 #include "backend/OpenGLShader.h"
-#include "backend/OpenGLStateLess.h"
+#include "backend/GeometryStore.h"
+#include "backend/RenderProfiler.h"
 
 namespace render
 {
@@ -37,12 +40,29 @@ class OpenGLRenderSystem
     // Current shader program in use
     ShaderProgram _currentShaderProgram;
 
-	// Map of OpenGLState references, with access functions.
-	OpenGLStates _state_sorted;
+	// The passes with renderables to be drawn in the next frame
+	struct RenderQueueEntry
+	{
+		std::uint64_t sortKey;
+		OpenGLShaderPass* pass;
+	};
+	std::vector<RenderQueueEntry> _renderQueue;
+	std::vector<RenderQueueEntry> _renderQueueBuffer;
+
+	// The GL programs used by the inserted passes, their index is part of the sort key
+	std::vector<const GLProgram*> _sortedPrograms;
 
 	// Render time
 	std::size_t _time;
 
+	// Retained geometry of brushes and patches
+	GeometryStore _geometryStore;
+
+	RenderProfiler _profiler;
+
+	// The trace file written by RenderProfilerDump if no path is given
+	std::string _defaultProfilePath;
+
 	sigc::signal<void> _sigExtensionsInitialised;
 
 	sigc::connection _materialDefsLoaded;
@@ -83,13 +103,19 @@ public:
 	bool shaderProgramsAvailable() const override;
 	void setShaderProgramsAvailable(bool available) override;
 
+	GeometryStore& getGeometryStore() override;
+	RenderProfiler& getProfiler() override;
+
 	typedef std::set<const Renderable*> Renderables;
 	Renderables m_renderables;
 	mutable bool m_traverseRenderablesMutex;
 
     /* OpenGLStateManager implementation */
-	void insertSortedState(const OpenGLStates::value_type& val) override;
-	void eraseSortedState(const OpenGLStates::key_type& key) override;
+	void insertPass(const OpenGLShaderPassPtr& pass) override;
+	void erasePass(const OpenGLShaderPassPtr& pass) override;
+
+	// Called by a shader pass receiving its first renderable since it has been rendered
+	void queuePass(OpenGLShaderPass& pass);
 
 	// renderables
 	void attachRenderable(const Renderable& renderable) override;
@@ -101,6 +127,10 @@ public:
     virtual const StringSet& getDependencies() const override;
     virtual void initialiseModule(const IApplicationContext& ctx) override;
     virtual void shutdownModule() override;
+
+private:
+	void startProfilingCmd(const cmd::ArgumentList& args);
+	void dumpProfileCmd(const cmd::ArgumentList& args);
 };
 typedef std::shared_ptr<OpenGLRenderSystem> OpenGLRenderSystemPtr;
 
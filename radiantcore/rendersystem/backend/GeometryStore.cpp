@@ -0,0 +1,379 @@
+#include "GeometryStore.h"
+
+#include <limits>
+#include <algorithm>
+
+#include "irender.h"
+#include "GLProgramAttributes.h"
+#include "render/VBO.h"
+
+namespace render
+{
+
+namespace
+{
+
+const std::size_t NO_DIRTY_RANGE = std::numeric_limits<std::size_t>::max();
+
+// Uploads the dirty range of the given array, (re-)allocating the buffer if it is too small
+template<typename Element_T>
+void SyncBufferObject(GLenum target, GLuint& buffer, std::size_t& capacity,
+                      const std::vector<Element_T>& data,
+                      std::size_t& dirtyBegin, std::size_t& dirtyEnd)
+{
+    if (data.empty()) return;
+
+    if (buffer == 0)
+    {
+        glGenBuffers(1, &buffer);
+        capacity = 0;
+    }
+
+    glBindBuffer(target, buffer);
+
+    if (data.size() > capacity)
+    {
+        // Grow along with the vector, the whole array needs to be copied
+        capacity = data.capacity();
+        glBufferData(target, capacity * sizeof(Element_T), nullptr, GL_DYNAMIC_DRAW);
+
+        dirtyBegin = 0;
+        dirtyEnd = data.size();
+    }
+
+    if (dirtyBegin < dirtyEnd)
+    {
+        glBufferSubData(target, dirtyBegin * sizeof(Element_T),
+                        (dirtyEnd - dirtyBegin) * sizeof(Element_T), &data[dirtyBegin]);
+    }
+
+    dirtyBegin = NO_DIRTY_RANGE;
+    dirtyEnd = 0;
+
+    glBindBuffer(target, 0);
+}
+
+}
+
+GeometryStore::RangeAllocator::RangeAllocator() :
+    _size(0)
+{}
+
+std::size_t GeometryStore::RangeAllocator::allocate(std::size_t count)
+{
+    if (count == 0) return 0;
+
+    for (auto i = _freeRanges.begin(); i != _freeRanges.end(); ++i)
+    {
+        if (i->second < count) continue;
+
+        auto offset = i->first;
+        auto remaining = i->second - count;
+
+        _freeRanges.erase(i);
+
+        if (remaining > 0)
+        {
+            _freeRanges.emplace(offset + count, remaining);
+        }
+
+        return offset;
+    }
+
+    // No free range is large enough, append
+    auto offset = _size;
+    _size += count;
+
+    return offset;
+}
+
+void GeometryStore::RangeAllocator::release(std::size_t offset, std::size_t count)
+{
+    if (count == 0) return;
+
+    auto inserted = _freeRanges.emplace(offset, count).first;
+
+    // Merge with the following range
+    auto next = std::next(inserted);
+
+    if (next != _freeRanges.end() && inserted->first + inserted->second == next->first)
+    {
+        inserted->second += next->second;
+        _freeRanges.erase(next);
+    }
+
+    // Merge with the preceding range
+    if (inserted != _freeRanges.begin())
+    {
+        auto prev = std::prev(inserted);
+
+        if (prev->first + prev->second == inserted->first)
+        {
+            prev->second += inserted->second;
+            _freeRanges.erase(inserted);
+            inserted = prev;
+        }
+    }
+
+    // A free range at the end is given back
+    if (inserted->first + inserted->second == _size)
+    {
+        _size = inserted->first;
+        _freeRanges.erase(inserted);
+    }
+}
+
+void GeometryStore::RangeAllocator::clear()
+{
+    _freeRanges.clear();
+    _size = 0;
+}
+
+GeometryStore::GeometryStore() :
+    _vertexDirtyBegin(NO_DIRTY_RANGE),
+    _vertexDirtyEnd(0),
+    _indexDirtyBegin(NO_DIRTY_RANGE),
+    _indexDirtyEnd(0),
+    _vertexBuffer(0),
+    _indexBuffer(0),
+    _vertexBufferCapacity(0),
+    _indexBufferCapacity(0)
+{}
+
+GeometryStore::~GeometryStore()
+{
+    releaseBufferObjects();
+}
+
+IGeometryStore::Slot GeometryStore::allocateSlot(const std::vector<ArbitraryMeshVertex>& vertices,
+                                                 const std::vector<unsigned int>& indices)
+{
+    Slot slot;
+
+    if (!_freeSlots.empty())
+    {
+        slot = _freeSlots.back();
+        _freeSlots.pop_back();
+    }
+    else
+    {
+        slot = _slots.size();
+        _slots.emplace_back();
+    }
+
+    auto& info = _slots[slot];
+    info = SlotInfo{ 0, 0, 0, 0 };
+
+    storeData(info, vertices, indices);
+
+    return slot;
+}
+
+void GeometryStore::updateData(Slot slot, const std::vector<ArbitraryMeshVertex>& vertices,
+                               const std::vector<unsigned int>& indices)
+{
+    assert(slot < _slots.size());
+    storeData(_slots[slot], vertices, indices);
+}
+
+void GeometryStore::updateVertexData(Slot slot, const std::vector<ArbitraryMeshVertex>& vertices)
+{
+    assert(slot < _slots.size());
+
+    const auto& info = _slots[slot];
+    assert(info.numVertices == vertices.size());
+
+    std::copy(vertices.begin(), vertices.end(), _vertices.begin() + info.firstVertex);
+    markVerticesDirty(info.firstVertex, info.firstVertex + info.numVertices);
+}
+
+void GeometryStore::deallocateSlot(Slot slot)
+{
+    assert(slot < _slots.size());
+
+    releaseRanges(_slots[slot]);
+    _freeSlots.push_back(slot);
+}
+
+void GeometryStore::storeData(SlotInfo& info, const std::vector<ArbitraryMeshVertex>& vertices,
+                              const std::vector<unsigned int>& indices)
+{
+    // Keep the ranges if the sizes are unchanged, which is the common case
+    // for transformed or re-textured geometry
+    if (info.numVertices != vertices.size() || info.numIndices != indices.size())
+    {
+        releaseRanges(info);
+
+        info.numVertices = vertices.size();
+        info.firstVertex = _vertexRanges.allocate(info.numVertices);
+        info.numIndices = indices.size();
+        info.firstIndex = _indexRanges.allocate(info.numIndices);
+
+        if (_vertices.size() < _vertexRanges.size())
+        {
+            _vertices.resize(_vertexRanges.size());
+        }
+
+        if (_indices.size() < _indexRanges.size())
+        {
+            _indices.resize(_indexRanges.size());
+        }
+    }
+
+    std::copy(vertices.begin(), vertices.end(), _vertices.begin() + info.firstVertex);
+
+    auto index = _indices.begin() + info.firstIndex;
+
+    for (auto relativeIndex : indices)
+    {
+        *index++ = relativeIndex + static_cast<unsigned int>(info.firstVertex);
+    }
+
+    markVerticesDirty(info.firstVertex, info.firstVertex + info.numVertices);
+    markIndicesDirty(info.firstIndex, info.firstIndex + info.numIndices);
+}
+
+void GeometryStore::releaseRanges(SlotInfo& info)
+{
+    _vertexRanges.release(info.firstVertex, info.numVertices);
+    _indexRanges.release(info.firstIndex, info.numIndices);
+
+    info = SlotInfo{ 0, 0, 0, 0 };
+}
+
+void GeometryStore::markVerticesDirty(std::size_t begin, std::size_t end)
+{
+    if (begin == end) return;
+
+    _vertexDirtyBegin = std::min(_vertexDirtyBegin, begin);
+    _vertexDirtyEnd = std::max(_vertexDirtyEnd, end);
+}
+
+void GeometryStore::markIndicesDirty(std::size_t begin, std::size_t end)
+{
+    if (begin == end) return;
+
+    _indexDirtyBegin = std::min(_indexDirtyBegin, begin);
+    _indexDirtyEnd = std::max(_indexDirtyEnd, end);
+}
+
+void GeometryStore::syncToBufferObjects()
+{
+    SyncBufferObject(GL_ARRAY_BUFFER, _vertexBuffer, _vertexBufferCapacity,
+                     _vertices, _vertexDirtyBegin, _vertexDirtyEnd);
+    SyncBufferObject(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer, _indexBufferCapacity,
+                     _indices, _indexDirtyBegin, _indexDirtyEnd);
+}
+
+void GeometryStore::draw(const std::vector<Slot>& slots, const RenderInfo& info)
+{
+    if (!beginDraw(info)) return;
+
+    drawSlots(slots);
+
+    endDraw();
+}
+
+bool GeometryStore::beginDraw(const RenderInfo& info)
+{
+    if (_vertexBuffer == 0 || _indexBuffer == 0) return false;
+
+    typedef VertexTraits<ArbitraryMeshVertex> Traits;
+    const GLsizei STRIDE = sizeof(ArbitraryMeshVertex);
+
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+
+    // Brush and patch vertices are white, models might carry vertex colours
+    if (info.checkFlag(RENDER_VERTEX_COLOUR))
+    {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glColorPointer(3, GL_DOUBLE, STRIDE, reinterpret_cast<const GLvoid*>(offsetof(ArbitraryMeshVertex, colour)));
+    }
+    else
+    {
+        glDisableClientState(GL_COLOR_ARRAY);
+    }
+
+    glVertexPointer(3, GL_DOUBLE, STRIDE, Traits::VERTEX_OFFSET());
+
+    if (info.checkFlag(RENDER_TEXTURE_CUBEMAP))
+    {
+        // The vertex coordinates are the cube map texture coordinates
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(3, GL_DOUBLE, STRIDE, Traits::VERTEX_OFFSET());
+    }
+    else if (info.checkFlag(RENDER_BUMP))
+    {
+        glVertexAttribPointer(ATTR_NORMAL, 3, GL_DOUBLE, 0, STRIDE, Traits::NORMAL_OFFSET());
+        glVertexAttribPointer(ATTR_TEXCOORD, 2, GL_DOUBLE, 0, STRIDE, Traits::TEXCOORD_OFFSET());
+        glVertexAttribPointer(ATTR_TANGENT, 3, GL_DOUBLE, 0, STRIDE, Traits::TANGENT_OFFSET());
+        glVertexAttribPointer(ATTR_BITANGENT, 3, GL_DOUBLE, 0, STRIDE, Traits::BITANGENT_OFFSET());
+    }
+    else
+    {
+        if (info.checkFlag(RENDER_LIGHTING))
+        {
+            glNormalPointer(GL_DOUBLE, STRIDE, Traits::NORMAL_OFFSET());
+        }
+
+        if (info.checkFlag(RENDER_TEXTURE_2D))
+        {
+            glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+            glTexCoordPointer(2, GL_DOUBLE, STRIDE, Traits::TEXCOORD_OFFSET());
+        }
+    }
+
+    return true;
+}
+
+void GeometryStore::drawSlots(const std::vector<Slot>& slots)
+{
+    _drawCounts.clear();
+    _drawOffsets.clear();
+
+    for (auto slot : slots)
+    {
+        const auto& slotInfo = _slots[slot];
+
+        if (slotInfo.numIndices == 0) continue;
+
+        _drawCounts.push_back(static_cast<GLsizei>(slotInfo.numIndices));
+        _drawOffsets.push_back(reinterpret_cast<const GLvoid*>(slotInfo.firstIndex * sizeof(unsigned int)));
+    }
+
+    if (_drawCounts.empty()) return;
+
+    glMultiDrawElements(GL_TRIANGLES, _drawCounts.data(), GL_UNSIGNED_INT,
+                        _drawOffsets.data(), static_cast<GLsizei>(_drawCounts.size()));
+}
+
+void GeometryStore::drawSlot(Slot slot)
+{
+    const auto& slotInfo = _slots[slot];
+
+    if (slotInfo.numIndices == 0) return;
+
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(slotInfo.numIndices), GL_UNSIGNED_INT,
+                   reinterpret_cast<const GLvoid*>(slotInfo.firstIndex * sizeof(unsigned int)));
+}
+
+void GeometryStore::endDraw()
+{
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void GeometryStore::releaseBufferObjects()
+{
+    deleteVBO(_vertexBuffer);
+    deleteVBO(_indexBuffer);
+
+    _vertexBufferCapacity = 0;
+    _indexBufferCapacity = 0;
+}
+
+}
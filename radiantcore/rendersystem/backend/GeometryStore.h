@@ -0,0 +1,127 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "igl.h"
+#include "igeometrystore.h"
+
+class RenderInfo;
+
+namespace render
+{
+
+/**
+ * Implementation of the retained geometry storage of the OpenGLRenderSystem.
+ *
+ * All slots share one vertex and one index array, which are mirrored in
+ * two buffer objects. Freed ranges are re-used for later allocations, and
+ * only the range touched since the last upload is copied to the buffer
+ * objects when the store is synchronised at the beginning of a frame.
+ */
+class GeometryStore :
+    public IGeometryStore
+{
+private:
+    // Hands out ranges of an array, re-using released ones (first fit)
+    class RangeAllocator
+    {
+        // Free ranges, mapping offset to size
+        std::map<std::size_t, std::size_t> _freeRanges;
+
+        // The number of elements in use, including the free ranges
+        std::size_t _size;
+
+    public:
+        RangeAllocator();
+
+        std::size_t allocate(std::size_t count);
+        void release(std::size_t offset, std::size_t count);
+
+        std::size_t size() const
+        {
+            return _size;
+        }
+
+        void clear();
+    };
+
+    struct SlotInfo
+    {
+        std::size_t firstVertex;
+        std::size_t numVertices;
+        std::size_t firstIndex;
+        std::size_t numIndices;
+    };
+
+    // CPU copy of the buffer object contents, indices are absolute
+    std::vector<ArbitraryMeshVertex> _vertices;
+    std::vector<unsigned int> _indices;
+
+    RangeAllocator _vertexRanges;
+    RangeAllocator _indexRanges;
+
+    std::vector<SlotInfo> _slots;
+    std::vector<Slot> _freeSlots;
+
+    // The element ranges which need to be uploaded [begin, end)
+    std::size_t _vertexDirtyBegin;
+    std::size_t _vertexDirtyEnd;
+    std::size_t _indexDirtyBegin;
+    std::size_t _indexDirtyEnd;
+
+    GLuint _vertexBuffer;
+    GLuint _indexBuffer;
+
+    // Capacity of the buffer objects in elements
+    std::size_t _vertexBufferCapacity;
+    std::size_t _indexBufferCapacity;
+
+    // Draw parameters, kept around to avoid re-allocations
+    std::vector<GLsizei> _drawCounts;
+    std::vector<const GLvoid*> _drawOffsets;
+
+public:
+    GeometryStore();
+    ~GeometryStore();
+
+    // IGeometryStore implementation
+    Slot allocateSlot(const std::vector<ArbitraryMeshVertex>& vertices,
+                      const std::vector<unsigned int>& indices) override;
+    void updateData(Slot slot, const std::vector<ArbitraryMeshVertex>& vertices,
+                    const std::vector<unsigned int>& indices) override;
+    void updateVertexData(Slot slot, const std::vector<ArbitraryMeshVertex>& vertices) override;
+    void deallocateSlot(Slot slot) override;
+
+    // Copies the modified data to the buffer objects, creating them if necessary.
+    // Needs a current GL context.
+    void syncToBufferObjects();
+
+    // Draws the given slots with a single call. The vertex pointers are set up
+    // according to the given render flags.
+    void draw(const std::vector<Slot>& slots, const RenderInfo& info);
+
+    // Binds the buffer objects and sets up the vertex pointers according to the
+    // given render flags, for drawing several batches with the same setup.
+    // Returns false (without binding anything) if the store has not been synchronised.
+    bool beginDraw(const RenderInfo& info);
+
+    // Draw calls between beginDraw() and endDraw()
+    void drawSlots(const std::vector<Slot>& slots);
+    void drawSlot(Slot slot);
+
+    void endDraw();
+
+    // Deletes the buffer objects, they are re-created from the CPU copy on the next sync
+    void releaseBufferObjects();
+
+private:
+    void storeData(SlotInfo& info, const std::vector<ArbitraryMeshVertex>& vertices,
+                   const std::vector<unsigned int>& indices);
+    void releaseRanges(SlotInfo& info);
+
+    void markVerticesDirty(std::size_t begin, std::size_t end);
+    void markIndicesDirty(std::size_t begin, std::size_t end);
+};
+
+}
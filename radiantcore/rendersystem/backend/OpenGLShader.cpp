@@ -188,9 +188,7 @@ void OpenGLShader::insertPasses()
          i != _shaderPasses.end();
           ++i)
     {
-    	_renderSystem.insertSortedState(
-            OpenGLStates::value_type((*i)->statePtr(), *i)
-        );
+    	_renderSystem.insertPass(*i);
     }
 }
 
@@ -201,7 +199,7 @@ void OpenGLShader::removePasses()
          i != _shaderPasses.end();
          ++i)
 	{
-        _renderSystem.eraseSortedState((*i)->statePtr());
+        _renderSystem.erasePass(*i);
     }
 }
 
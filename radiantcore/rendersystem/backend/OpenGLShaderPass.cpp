@@ -1,5 +1,6 @@
 #include "OpenGLShaderPass.h"
 #include "OpenGLShader.h"
+#include "../OpenGLRenderSystem.h"
 
 #include "math/Matrix4.h"
 #include "math/AABB.h"
@@ -8,9 +9,12 @@
 #include "texturelib.h"
 #include "iglprogram.h"
 
+#include "render/RadixSort.h"
 #include "debugging/render.h"
 #include "debugging/gl.h"
 
+#include <algorithm>
+
 namespace render
 {
 
@@ -363,6 +367,8 @@ void OpenGLShaderPass::applyState(OpenGLState& current,
     // operations.
     if (changingBitsMask != 0)
     {
+        _owner.getRenderSystem().getProfiler().countStateChange();
+
         if(changingBitsMask & requiredState & RENDER_FILL)
         {
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
@@ -573,26 +579,19 @@ void OpenGLShaderPass::addRenderable(const OpenGLRenderable& renderable,
                                      const RendererLight* light,
                                      const IRenderEntity* entity)
 {
-    if (entity)
+    if (!_isQueued)
     {
-        // Find or insert the render entity in our map
-        auto i = _renderables.find(entity);
-        if (i == _renderables.end())
-        {
-            i = _renderables.insert(std::make_pair(entity, Renderables())).first;
-        }
-
-        // Add this renderable to the list of renderables associated with the entity
-        i->second.push_back(
-            TransformedRenderable(renderable, modelview, light, entity)
-        );
-    }
-    else
-    {
-        _renderablesWithoutEntity.push_back(
-            TransformedRenderable(renderable, modelview, light, nullptr)
-        );
+        _isQueued = true;
+        _owner.getRenderSystem().queuePass(*this);
     }
+
+    _renderables.push_back(TransformedRenderable(renderable, modelview, light, entity));
+}
+
+void OpenGLShaderPass::clearRenderables()
+{
+    _renderables.clear();
+    _isQueued = false;
 }
 
 // Render the bucket contents
@@ -601,6 +600,15 @@ void OpenGLShaderPass::render(OpenGLState& current,
                               const Vector3& viewer,
                               std::size_t time)
 {
+    RenderProfiler& profiler = _owner.getRenderSystem().getProfiler();
+    bool profiling = profiler.isRecording();
+
+    if (profiling)
+    {
+        const MaterialPtr& material = _owner.getMaterial();
+        profiler.beginGpuSection(material ? material->getName() : _glState.getName());
+    }
+
     // Reset the texture matrix
     glMatrixMode(GL_TEXTURE);
     glLoadMatrixd(Matrix4::getIdentity());
@@ -610,28 +618,56 @@ void OpenGLShaderPass::render(OpenGLState& current,
     // Apply our state to the current state object
     applyState(current, flagsMask, viewer, time, NULL);
 
-    if (!_renderablesWithoutEntity.empty())
+    // Group the renderables by entity, keeping their submission order. The
+    // ones without entity come first.
+    RadixSortByKey(_renderables, _sortBuffer, [](const TransformedRenderable& r)
+    {
+        return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(r.entity));
+    });
+
+    auto end = _renderables.cend();
+    auto entityBegin = std::find_if(_renderables.cbegin(), end,
+        [](const TransformedRenderable& r) { return r.entity != nullptr; });
+
+    if (entityBegin != _renderables.cbegin())
     {
-        renderAllContained(_renderablesWithoutEntity, current, viewer, time);
+        renderAllContained(_renderables.cbegin(), entityBegin, current, viewer, time, false);
     }
 
-    for (RenderablesByEntity::const_iterator i = _renderables.begin();
-         i != _renderables.end();
-         ++i)
+    // If the state is the same for all entities, the retained renderables of
+    // entities sharing the same geometry (like many instances of the same model)
+    // are drawn together after all entities have been visited
+    bool drawAsInstances = entityBegin != end && !stateDependsOnEntity();
+
+    for (auto entityEnd = entityBegin; entityBegin != end; entityBegin = entityEnd)
     {
+        const IRenderEntity* entity = entityBegin->entity;
+
+        entityEnd = std::find_if(entityBegin, end,
+            [&](const TransformedRenderable& r) { return r.entity != entity; });
+
         // Apply our state to the current state object
-        applyState(current, flagsMask, viewer, time, i->first);
+        if (!drawAsInstances)
+        {
+            applyState(current, flagsMask, viewer, time, entity);
+        }
 
         if (!stateIsActive())
         {
             continue;
         }
 
-        renderAllContained(i->second, current, viewer, time);
+        renderAllContained(entityBegin, entityEnd, current, viewer, time, drawAsInstances);
     }
 
-    _renderablesWithoutEntity.clear();
-    _renderables.clear();
+    drawInstances(current, viewer);
+
+    clearRenderables();
+
+    if (profiling)
+    {
+        profiler.endSection();
+    }
 }
 
 bool OpenGLShaderPass::stateIsActive()
@@ -642,6 +678,15 @@ bool OpenGLShaderPass::stateIsActive()
             (_glState.stage3 == NULL || _glState.stage3->isVisible()));
 }
 
+bool OpenGLShaderPass::stateDependsOnEntity()
+{
+    return (_glState.stage0 && _glState.stage0->usesEntityShaderParms()) ||
+           (_glState.stage1 && _glState.stage1->usesEntityShaderParms()) ||
+           (_glState.stage2 && _glState.stage2->usesEntityShaderParms()) ||
+           (_glState.stage3 && _glState.stage3->usesEntityShaderParms()) ||
+           (_glState.stage4 && _glState.stage4->usesEntityShaderParms());
+}
+
 // Setup lighting
 void OpenGLShaderPass::setUpLightingCalculation(OpenGLState& current,
                                                 const RendererLight* light,
@@ -697,58 +742,213 @@ void OpenGLShaderPass::setUpLightingCalculation(OpenGLState& current,
 }
 
 // Flush renderables
-void OpenGLShaderPass::renderAllContained(const Renderables& renderables,
+void OpenGLShaderPass::renderAllContained(Renderables::const_iterator begin,
+                                          Renderables::const_iterator end,
                                           OpenGLState& current,
                                           const Vector3& viewer,
-                                          std::size_t time)
+                                          std::size_t time,
+                                          bool collectInstances)
 {
     // Keep a pointer to the last transform matrix and render entity used
     const Matrix4* transform = 0;
 
+    // Retained renderables sharing the same transform and light are drawn
+    // together from the geometry store of our render system
+    const IGeometryStore& geometryStore = _owner.getRenderSystem().getGeometryStore();
+    const RendererLight* retainedLight = nullptr;
+
+    RenderProfiler& profiler = _owner.getRenderSystem().getProfiler();
+
+    // The stored geometry is triangulated, which would show the inner edges
+    // in line mode. Non-filled passes draw the outlines through render().
+    bool useGeometryStore = current.testRenderFlag(RENDER_FILL);
+
     glPushMatrix();
 
     // Iterate over each transformed renderable in the vector
-    for (const TransformedRenderable& r : renderables)
+    for (auto i = begin; i != end; ++i)
     {
+        const TransformedRenderable& r = *i;
+
+        const IGeometryStore* store = nullptr;
+        std::size_t slot = 0;
+        bool isRetained = useGeometryStore &&
+            r.renderable->getStorageLocation(store, slot) && store == &geometryStore;
+
+        if (isRetained && collectInstances && !r.light)
+        {
+            _instances.push_back(RetainedInstance{ slot, r.transform });
+            continue;
+        }
+
         // If the current iteration's transform matrix was different from the
         // last, apply it and store for the next iteration
         if (transform == NULL ||
             (transform != r.transform && !transform->isAffineEqual(*r.transform)))
         {
+            flushRetainedRenderables(current, viewer);
+
             transform = r.transform;
-            glPopMatrix();
-            glPushMatrix();
-            glMultMatrixd(*transform);
+            setObjectTransform(current, *transform);
+        }
 
-            // Determine the face direction
-            if (current.testRenderFlag(RENDER_CULLFACE)
-                && transform->getHandedness() == Matrix4::RIGHTHANDED)
-            {
-                glFrontFace(GL_CW);
-            }
-            else
-            {
-                glFrontFace(GL_CCW);
-            }
+        // The lighting parameters of the collected renderables must not be changed
+        if (!isRetained || r.light != retainedLight)
+        {
+            flushRetainedRenderables(current, viewer);
         }
 
         // If we are using a lighting program and this renderable is lit, set
         // up the lighting calculation
         const RendererLight* light = r.light;
-        if (current.glProgram && light)
+        if (current.glProgram && light && (!isRetained || _retainedSlots.empty()))
         {
             setUpLightingCalculation(current, light, viewer, *transform, time);
+            profiler.countStateChange();
+        }
+
+        if (isRetained)
+        {
+            retainedLight = light;
+            _retainedSlots.push_back(slot);
+            continue;
         }
 
         // Render the renderable
         RenderInfo info(current.getRenderFlags(), viewer, current.cubeMapMode);
         r.renderable->render(info);
+        profiler.countDrawCalls();
     }
 
+    flushRetainedRenderables(current, viewer);
+
     // Cleanup
     glPopMatrix();
 }
 
+void OpenGLShaderPass::setObjectTransform(OpenGLState& current, const Matrix4& transform)
+{
+    glPopMatrix();
+    glPushMatrix();
+    glMultMatrixd(transform);
+
+    // Determine the face direction
+    if (current.testRenderFlag(RENDER_CULLFACE)
+        && transform.getHandedness() == Matrix4::RIGHTHANDED)
+    {
+        glFrontFace(GL_CW);
+    }
+    else
+    {
+        glFrontFace(GL_CCW);
+    }
+}
+
+void OpenGLShaderPass::flushRetainedRenderables(OpenGLState& current, const Vector3& viewer)
+{
+    if (_retainedSlots.empty()) return;
+
+    RenderInfo info(current.getRenderFlags(), viewer, current.cubeMapMode);
+    _owner.getRenderSystem().getGeometryStore().draw(_retainedSlots, info);
+    _owner.getRenderSystem().getProfiler().countDrawCalls();
+
+    _retainedSlots.clear();
+}
+
+void OpenGLShaderPass::drawInstances(OpenGLState& current, const Vector3& viewer)
+{
+    if (_instances.empty()) return;
+
+    GeometryStore& geometryStore = _owner.getRenderSystem().getGeometryStore();
+    RenderProfiler& profiler = _owner.getRenderSystem().getProfiler();
+    RenderInfo info(current.getRenderFlags(), viewer, current.cubeMapMode);
+
+    if (!geometryStore.beginDraw(info))
+    {
+        _instances.clear();
+        return;
+    }
+
+    glPushMatrix();
+
+    // Group the instances by geometry, keeping the submission order within the groups
+    std::stable_sort(_instances.begin(), _instances.end(),
+        [](const RetainedInstance& a, const RetainedInstance& b) { return a.slot < b.slot; });
+
+    const Matrix4* transform = nullptr;
+
+    // Geometry used more than once is drawn once per instance, the buffers
+    // and vertex pointers stay the same. The remaining single instances are
+    // moved to the front of the vector.
+    auto singlesEnd = _instances.begin();
+
+    for (auto group = _instances.begin(); group != _instances.end();)
+    {
+        auto groupEnd = std::find_if(group, _instances.end(),
+            [&](const RetainedInstance& instance) { return instance.slot != group->slot; });
+
+        if (groupEnd - group == 1)
+        {
+            *singlesEnd++ = *group;
+        }
+        else
+        {
+            for (auto instance = group; instance != groupEnd; ++instance)
+            {
+                if (transform != instance->transform)
+                {
+                    transform = instance->transform;
+                    setObjectTransform(current, *transform);
+                }
+
+                geometryStore.drawSlot(instance->slot);
+            }
+
+            profiler.countDrawCalls(groupEnd - group);
+        }
+
+        group = groupEnd;
+    }
+
+    _instances.erase(singlesEnd, _instances.end());
+
+    // The single instances sharing a transform are drawn with one call
+    auto drawCollectedSlots = [&]()
+    {
+        if (_retainedSlots.empty()) return;
+
+        geometryStore.drawSlots(_retainedSlots);
+        profiler.countDrawCalls();
+
+        _retainedSlots.clear();
+    };
+
+    std::stable_sort(_instances.begin(), _instances.end(),
+        [](const RetainedInstance& a, const RetainedInstance& b) { return a.transform < b.transform; });
+
+    for (const RetainedInstance& instance : _instances)
+    {
+        if (transform == nullptr ||
+            (transform != instance.transform && !transform->isAffineEqual(*instance.transform)))
+        {
+            drawCollectedSlots();
+
+            transform = instance.transform;
+            setObjectTransform(current, *transform);
+        }
+
+        _retainedSlots.push_back(instance.slot);
+    }
+
+    drawCollectedSlots();
+
+    glPopMatrix();
+
+    geometryStore.endDraw();
+
+    _instances.clear();
+}
+
 // Stream insertion operator
 std::ostream& operator<<(std::ostream& st, const OpenGLShaderPass& self)
 {
@@ -4,7 +4,7 @@
 #include "iglrender.h"
 
 #include <vector>
-#include <map>
+#include <cstdint>
 
 /* FORWARD DECLS */
 class Matrix4;
@@ -60,13 +60,30 @@ class OpenGLShaderPass
 		{}
 	};
 
-	// Vector of transformed renderables using this state
+	// Vector of transformed renderables using this state, in submission order.
+	// They are grouped by their entity before rendering.
 	typedef std::vector<TransformedRenderable> Renderables;
-	Renderables _renderablesWithoutEntity;
-	
-	// Renderables sorted by RenderEntity
-	typedef std::map<const IRenderEntity*, Renderables> RenderablesByEntity;
-	RenderablesByEntity _renderables;
+	Renderables _renderables;
+	Renderables _sortBuffer;
+
+	// Orders this pass in the render queue of the render system
+	std::uint64_t _sortKey;
+
+	// True if this pass is in the render queue, i.e. it has renderables
+	bool _isQueued;
+
+	// Slots of the retained renderables collected for the next multi-draw call
+	std::vector<std::size_t> _retainedSlots;
+
+	// A retained renderable of an entity, drawn as instance of its geometry
+	struct RetainedInstance
+	{
+		std::size_t slot;
+		const Matrix4* transform;
+	};
+
+	// Instances collected from all entities, if the state doesn't depend on them
+	std::vector<RetainedInstance> _instances;
 
 private:
 
@@ -84,11 +101,26 @@ private:
 
 	void setupTextureMatrix(GLenum textureUnit, const ShaderLayerPtr& stage);
 
-	// Render all of the given TransformedRenderables
-	void renderAllContained(const Renderables& renderables,
+	// Returns true if the stages of this pass evaluate differently per entity
+	bool stateDependsOnEntity();
+
+	// Render all of the given TransformedRenderables. If collectInstances is
+	// set, the unlit retained renderables are only collected for drawInstances().
+	void renderAllContained(Renderables::const_iterator begin,
+							Renderables::const_iterator end,
 							OpenGLState& current,
 						    const Vector3& viewer,
-							std::size_t time);
+							std::size_t time,
+							bool collectInstances);
+
+	// Replaces the object transform on top of the modelview stack
+	void setObjectTransform(OpenGLState& current, const Matrix4& transform);
+
+	// Draws the collected retained renderables from the geometry store
+	void flushRetainedRenderables(OpenGLState& current, const Vector3& viewer);
+
+	// Draws the collected instances, setting up the vertex pointers only once
+	void drawInstances(OpenGLState& current, const Vector3& viewer);
 
     /* Helper functions to enable/disable particular GL states */
 
@@ -121,7 +153,9 @@ private:
 public:
 
 	OpenGLShaderPass(OpenGLShader& owner) :
-		_owner(owner)
+		_owner(owner),
+		_sortKey(0),
+		_isQueued(false)
 	{}
 
 	/**
@@ -182,9 +216,27 @@ public:
 	 */
 	bool empty() const
 	{
-		return _renderables.empty() && _renderablesWithoutEntity.empty();
+		return _renderables.empty();
 	}
 
+	std::uint64_t getSortKey() const
+	{
+		return _sortKey;
+	}
+
+	void setSortKey(std::uint64_t sortKey)
+	{
+		_sortKey = sortKey;
+	}
+
+	bool isQueued() const
+	{
+		return _isQueued;
+	}
+
+	// Discards the renderables added since the last render() call
+	void clearRenderables();
+
 	friend std::ostream& operator<<(std::ostream& st, const OpenGLShaderPass& self);
 };
 
@@ -1,10 +1,6 @@
 #pragma once
 
-#include "OpenGLStateLess.h"
-
-#include <map>
-
-class OpenGLState;
+#include <memory>
 
 namespace render
 {
@@ -12,20 +8,14 @@ namespace render
 class OpenGLShaderPass;
 typedef std::shared_ptr<OpenGLShaderPass> OpenGLShaderPassPtr;
 
-/**
- * A sorted map of OpenGL states, maintained by the OpenGLStateManager. The sort
- * function intelligently sorts OpenGL states in an order which will allow them
- * to rendered as efficiently as possible, reducing the number of unnecessary
- * context switches.
- */
-typedef std::map<OpenGLState*,
-				 OpenGLShaderPassPtr,
-				 OpenGLStateLess> OpenGLStates;
-
 /**
  * \brief
- * Interface for an object which can manage sorted GL states. This is
- * implemented by the OpenGLRenderSystem.
+ * Interface for an object which can manage the shader passes to be rendered.
+ * This is implemented by the OpenGLRenderSystem.
+ *
+ * Each inserted pass gets a sort key derived from its OpenGLState, which
+ * orders the passes as efficiently as possible, reducing the number of
+ * unnecessary context switches between them.
  */
 class OpenGLStateManager
 {
@@ -33,18 +23,17 @@ public:
 
     /**
      * \brief
-     * Insert a new OpenGL state into the map.
+     * Insert a new shader pass, assigning its sort key.
      */
-    virtual void insertSortedState(const OpenGLStates::value_type& val) = 0;
+    virtual void insertPass(const OpenGLShaderPassPtr& pass) = 0;
 
     /**
      * \brief
-     * Remove a given OpenGL state from the map.
+     * Remove the given shader pass, its pending renderables are discarded.
      */
-    virtual void eraseSortedState(const OpenGLStates::key_type& key) = 0;
+    virtual void erasePass(const OpenGLShaderPassPtr& pass) = 0;
 
 };
 
 
 }
-
@@ -0,0 +1,289 @@
+#include "RenderProfiler.h"
+
+#include <iomanip>
+
+namespace render
+{
+
+namespace
+{
+
+// Converts to microseconds, the time unit of the trace format
+double getMicroseconds(RenderProfiler::Clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+void writeJsonString(std::ostream& stream, const std::string& value)
+{
+    stream << '"';
+
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '"': stream << "\\\""; break;
+        case '\\': stream << "\\\\"; break;
+        case '\n': stream << "\\n"; break;
+        case '\t': stream << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                stream << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                       << static_cast<int>(c) << std::dec << std::setfill(' ');
+            }
+            else
+            {
+                stream << c;
+            }
+        }
+    }
+
+    stream << '"';
+}
+
+// The trace threads the events are arranged in
+enum TraceThread
+{
+    CPU_THREAD = 1,
+    GPU_THREAD = 2,
+    SUBMISSION_THREAD = 3,
+};
+
+// Writes the common part of a complete ("X") event, the caller adds the arguments
+void writeCompleteEvent(std::ostream& stream, const std::string& name, const char* category,
+                        TraceThread thread, double start, double duration)
+{
+    stream << ",\n{\"name\":";
+    writeJsonString(stream, name);
+    stream << ",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+           << ",\"ts\":" << start << ",\"dur\":" << duration;
+}
+
+void writeThreadName(std::ostream& stream, TraceThread thread, const char* name)
+{
+    stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+           << ",\"args\":{\"name\":\"" << name << "\"}}";
+}
+
+}
+
+RenderProfiler::RenderProfiler() :
+    _recording(false),
+    _inFrame(false),
+    _queryActive(false)
+{}
+
+void RenderProfiler::startRecording()
+{
+    endFrame();
+
+    _frames.clear();
+    _recording = true;
+    _recordingStart = Clock::now();
+}
+
+void RenderProfiler::stopRecording()
+{
+    _recording = false;
+}
+
+bool RenderProfiler::isRecording() const
+{
+    return _recording;
+}
+
+void RenderProfiler::beginFrame(const std::string& view)
+{
+    if (!_recording || _inFrame) return;
+
+    _inFrame = true;
+
+    if (_frames.size() >= MAX_FRAMES)
+    {
+        _frames.pop_front();
+    }
+
+    _frames.emplace_back(Frame{ view, Clock::now(), Clock::duration::zero(), {}, {}, 0, 0 });
+}
+
+void RenderProfiler::endFrame()
+{
+    if (!_inFrame) return;
+
+    while (!_openSections.empty())
+    {
+        endSection();
+    }
+
+    auto& frame = _frames.back();
+
+    // Wait for the results of the timer queries
+    for (auto& section : frame.sections)
+    {
+        if (section.query == 0) continue;
+
+        glGetQueryObjectui64v(section.query, GL_QUERY_RESULT, &section.gpuTime);
+        glDeleteQueries(1, &section.query);
+        section.query = 0;
+    }
+
+    frame.duration = Clock::now() - frame.start;
+    _inFrame = false;
+}
+
+void RenderProfiler::beginSection(const std::string& name)
+{
+    beginSection(name, false);
+}
+
+void RenderProfiler::beginGpuSection(const std::string& name)
+{
+    beginSection(name, true);
+}
+
+void RenderProfiler::beginSection(const std::string& name, bool measureGpuTime)
+{
+    if (!_inFrame) return;
+
+    auto& sections = _frames.back().sections;
+
+    _openSections.push_back(sections.size());
+    sections.emplace_back(Section{ name, Clock::now(), Clock::duration::zero(), 0, 0, 0, 0 });
+
+    if (measureGpuTime && !_queryActive && GLEW_ARB_timer_query)
+    {
+        auto& section = sections.back();
+
+        glGenQueries(1, &section.query);
+        glBeginQuery(GL_TIME_ELAPSED, section.query);
+
+        _queryActive = true;
+    }
+}
+
+void RenderProfiler::endSection()
+{
+    if (!_inFrame || _openSections.empty()) return;
+
+    auto& section = _frames.back().sections[_openSections.back()];
+    _openSections.pop_back();
+
+    if (section.query != 0)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        _queryActive = false;
+    }
+
+    section.duration = Clock::now() - section.start;
+}
+
+void RenderProfiler::addSubmissionTime(const std::string& key, Clock::duration time)
+{
+    if (!_inFrame) return;
+
+    auto& submissionTime = _frames.back().submissionTimes[key];
+
+    submissionTime.time += time;
+    submissionTime.numNodes++;
+}
+
+RenderProfiler::Section* RenderProfiler::getInnermostSection()
+{
+    return _openSections.empty() ? nullptr : &_frames.back().sections[_openSections.back()];
+}
+
+void RenderProfiler::countDrawCalls(std::size_t count)
+{
+    if (!_inFrame) return;
+
+    _frames.back().drawCalls += count;
+
+    auto section = getInnermostSection();
+
+    if (section)
+    {
+        section->drawCalls += count;
+    }
+}
+
+void RenderProfiler::countStateChange()
+{
+    if (!_inFrame) return;
+
+    _frames.back().stateChanges++;
+
+    auto section = getInnermostSection();
+
+    if (section)
+    {
+        section->stateChanges++;
+    }
+}
+
+std::size_t RenderProfiler::getNumRecordedFrames() const
+{
+    // The current frame is not complete yet
+    return _inFrame ? _frames.size() - 1 : _frames.size();
+}
+
+void RenderProfiler::writeChromeTrace(std::ostream& stream) const
+{
+    stream << std::fixed << std::setprecision(3);
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+           << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Renderer\"}}";
+
+    writeThreadName(stream, CPU_THREAD, "CPU");
+    writeThreadName(stream, GPU_THREAD, "GPU (timer queries)");
+    writeThreadName(stream, SUBMISSION_THREAD, "Submission by entity class (summed up)");
+
+    auto numFrames = getNumRecordedFrames();
+
+    for (std::size_t i = 0; i < numFrames; ++i)
+    {
+        const auto& frame = _frames[i];
+        auto frameStart = getMicroseconds(frame.start - _recordingStart);
+
+        writeCompleteEvent(stream, frame.view, "frame", CPU_THREAD, frameStart, getMicroseconds(frame.duration));
+        stream << ",\"args\":{\"drawCalls\":" << frame.drawCalls
+               << ",\"stateChanges\":" << frame.stateChanges << "}}";
+
+        stream << ",\n{\"name\":\"Counts\",\"ph\":\"C\",\"pid\":1,\"ts\":" << frameStart
+               << ",\"args\":{\"drawCalls\":" << frame.drawCalls
+               << ",\"stateChanges\":" << frame.stateChanges << "}}";
+
+        for (const auto& section : frame.sections)
+        {
+            auto sectionStart = getMicroseconds(section.start - _recordingStart);
+
+            writeCompleteEvent(stream, section.name, "section", CPU_THREAD, sectionStart, getMicroseconds(section.duration));
+            stream << ",\"args\":{\"drawCalls\":" << section.drawCalls
+                   << ",\"stateChanges\":" << section.stateChanges << "}}";
+
+            if (section.gpuTime > 0)
+            {
+                // GPU work runs asynchronously, it is shown starting with its CPU section
+                writeCompleteEvent(stream, section.name, "gpu", GPU_THREAD, sectionStart, section.gpuTime / 1000.0);
+                stream << "}";
+            }
+        }
+
+        // The summed up times of each key are laid out one after the other
+        auto submissionStart = frameStart;
+
+        for (const auto& pair : frame.submissionTimes)
+        {
+            auto duration = getMicroseconds(pair.second.time);
+
+            writeCompleteEvent(stream, pair.first, "submission", SUBMISSION_THREAD, submissionStart, duration);
+            stream << ",\"args\":{\"nodes\":" << pair.second.numNodes << "}}";
+
+            submissionStart += duration;
+        }
+    }
+
+    stream << "\n]}\n";
+}
+
+}
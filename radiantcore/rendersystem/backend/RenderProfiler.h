@@ -0,0 +1,108 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <ostream>
+
+#include "igl.h"
+#include "irenderprofiler.h"
+
+namespace render
+{
+
+/**
+ * Implementation of the frame profiler of the OpenGLRenderSystem.
+ *
+ * The sections of a frame are kept in the order they have been started,
+ * their nesting follows from their start and duration. GPU times are measured with
+ * GL_TIME_ELAPSED queries for the (non-nested) shader pass sections, the
+ * results are read back at the end of the frame, which stalls the pipeline
+ * but only happens while recording.
+ */
+class RenderProfiler :
+    public IRenderProfiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // Frames older than this are dropped while recording
+    static const std::size_t MAX_FRAMES = 1000;
+
+private:
+    struct Section
+    {
+        std::string name;
+        Clock::time_point start;
+        Clock::duration duration;
+
+        std::size_t drawCalls;
+        std::size_t stateChanges;
+
+        // The timer query of this section, 0 if the GPU time is not measured
+        GLuint query;
+        GLuint64 gpuTime;
+    };
+
+    struct SubmissionTime
+    {
+        Clock::duration time;
+        std::size_t numNodes;
+    };
+
+    struct Frame
+    {
+        std::string view;
+        Clock::time_point start;
+        Clock::duration duration;
+
+        std::vector<Section> sections;
+        std::map<std::string, SubmissionTime> submissionTimes;
+
+        std::size_t drawCalls;
+        std::size_t stateChanges;
+    };
+
+    bool _recording;
+    Clock::time_point _recordingStart;
+
+    std::deque<Frame> _frames;
+    bool _inFrame;
+
+    // Indices of the sections of the current frame which have not been ended yet
+    std::vector<std::size_t> _openSections;
+
+    // Only one timer query can be active at a time
+    bool _queryActive;
+
+public:
+    RenderProfiler();
+
+    // Discards the recorded frames and starts recording
+    void startRecording();
+    void stopRecording();
+
+    // IRenderProfiler implementation
+    bool isRecording() const override;
+    void beginFrame(const std::string& view) override;
+    void endFrame() override;
+    void beginSection(const std::string& name) override;
+    void endSection() override;
+    void addSubmissionTime(const std::string& key, Clock::duration time) override;
+    void writeChromeTrace(std::ostream& stream) const override;
+
+    // Begins a section measuring the GPU time too, if timer queries are supported
+    void beginGpuSection(const std::string& name);
+
+    // Counters of the innermost open section (and the current frame)
+    void countDrawCalls(std::size_t count = 1);
+    void countStateChange();
+
+    std::size_t getNumRecordedFrames() const;
+
+private:
+    void beginSection(const std::string& name, bool measureGpuTime);
+    Section* getInnermostSection();
+};
+
+}
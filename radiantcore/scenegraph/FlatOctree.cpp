@@ -0,0 +1,438 @@
+#include "FlatOctree.h"
+
+#include <iterator>
+#include "inode.h"
+
+namespace scene
+{
+
+namespace
+{
+	// The number of members, before a cell tries to subdivide itself
+	const std::size_t SUBDIVISION_THRESHOLD = 32;
+	const std::size_t MIN_NODE_EXTENTS = 128;
+
+	const float START_SIZE = 512.0f;
+	const float MAX_WORLD_COORD = 65536;
+
+	const AABB START_AABB(Vector3(0,0,0), Vector3(START_SIZE, START_SIZE, START_SIZE));
+}
+
+/**
+ * The ISPNode representing a single cell of the FlatOctree.
+ * Bounds and children of a cell never change, the members are
+ * read from the owning tree's cell array.
+ */
+class FlatOctreeNode :
+	public ISPNode
+{
+private:
+	// Is set to null when the owning tree discards its cells
+	FlatOctree* _owner;
+	std::uint32_t _cellIndex;
+
+	AABB _bounds;
+
+	ISPNodeWeakPtr _parent;
+	NodeList _children;
+
+public:
+	FlatOctreeNode(FlatOctree& owner, std::uint32_t cellIndex, const AABB& bounds,
+		const std::shared_ptr<FlatOctreeNode>& parent) :
+		_owner(&owner),
+		_cellIndex(cellIndex),
+		_bounds(bounds),
+		_parent(parent)
+	{}
+
+	ISPNodePtr getParent() const override
+	{
+		return _parent.lock();
+	}
+
+	const AABB& getBounds() const override
+	{
+		return _bounds;
+	}
+
+	const NodeList& getChildNodes() const override
+	{
+		return _children;
+	}
+
+	bool isLeaf() const override
+	{
+		return _children.empty();
+	}
+
+	const MemberList& getMembers() const override
+	{
+		static const MemberList _emptyMembers;
+
+		return _owner != nullptr ? _owner->_cells[_cellIndex].members : _emptyMembers;
+	}
+
+	void addChild(const ISPNodePtr& child)
+	{
+		_children.push_back(child);
+	}
+
+	void detach()
+	{
+		_owner = nullptr;
+		_children.clear();
+	}
+};
+
+FlatOctree::FlatOctree()
+{
+	reset(START_AABB);
+}
+
+FlatOctree::~FlatOctree()
+{
+	// Views might be referenced from outside, let them forget about us
+	for (const auto& view : _views)
+	{
+		view->detach();
+	}
+}
+
+void FlatOctree::link(const INodePtr& sceneNode)
+{
+	// Make sure we don't do double-links
+	assert(_locations.find(sceneNode.get()) == nullptr);
+
+	// Take a copy, evaluating other nodes' bounds might affect this one
+	AABB bounds = sceneNode->worldAABB();
+
+	ensureRootSize(bounds);
+
+	std::uint32_t cellIndex = 0;
+
+	// Nodes with invalid bounds are staying in the root cell
+	if (bounds.isValid())
+	{
+		// Descend as far as the node fits into the child cells
+		for (auto firstChild = _cells[0].firstChild; firstChild != 0; )
+		{
+			auto matchingChild = firstChild;
+
+			while (matchingChild < firstChild + 8 && !_cells[matchingChild].bounds.contains(bounds))
+			{
+				++matchingChild;
+			}
+
+			if (matchingChild == firstChild + 8)
+			{
+				break;
+			}
+
+			cellIndex = matchingChild;
+			firstChild = _cells[cellIndex].firstChild;
+		}
+	}
+
+	addMember(cellIndex, sceneNode);
+
+	const Cell& cell = _cells[cellIndex];
+
+	if (cell.firstChild == 0 &&
+		cell.members.size() >= SUBDIVISION_THRESHOLD &&
+		cell.bounds.extents.x() > MIN_NODE_EXTENTS)
+	{
+		subdivide(cellIndex);
+	}
+}
+
+bool FlatOctree::unlink(const INodePtr& sceneNode)
+{
+	auto location = _locations.find(sceneNode.get());
+
+	if (location == nullptr)
+	{
+		return false;
+	}
+
+	removeMember(*location);
+	_locations.erase(sceneNode.get());
+
+	return true;
+}
+
+bool FlatOctree::relink(const INodePtr& sceneNode)
+{
+	auto location = _locations.find(sceneNode.get());
+
+	if (location == nullptr)
+	{
+		return false;
+	}
+
+	if (!location->relinkPending)
+	{
+		location->relinkPending = true;
+		_pendingRelinks.push_back(sceneNode.get());
+	}
+
+	return true;
+}
+
+ISPNodePtr FlatOctree::getRoot()
+{
+	applyPendingRelinks();
+
+	return _views.front();
+}
+
+void FlatOctree::applyPendingRelinks()
+{
+	// Relinking might cause further bounds changes, loop until everything is settled
+	while (!_pendingRelinks.empty())
+	{
+		// Process a copy, the raw pointers of nodes which have been unlinked
+		// in the meantime will not be found in the location table
+		_relinkBatch.swap(_pendingRelinks);
+
+		for (auto node : _relinkBatch)
+		{
+			auto location = _locations.find(node);
+
+			if (location == nullptr || !location->relinkPending)
+			{
+				continue;
+			}
+
+			location->relinkPending = false;
+
+			// Hold a reference, the node might be removed from its cell below
+			auto sceneNode = _cells[location->cell].members[location->slot];
+
+			AABB bounds = sceneNode->worldAABB();
+
+			location = _locations.find(node);
+
+			if (location == nullptr || isMatchingCell(location->cell, bounds))
+			{
+				continue; // node stays where it is, this is the common case
+			}
+
+			removeMember(*location);
+			_locations.erase(node);
+
+			link(sceneNode);
+		}
+
+		_relinkBatch.clear();
+	}
+}
+
+bool FlatOctree::isMatchingCell(std::uint32_t cellIndex, const AABB& bounds) const
+{
+	if (!bounds.isValid())
+	{
+		return cellIndex == 0;
+	}
+
+	const Cell& cell = _cells[cellIndex];
+
+	if (!cell.bounds.contains(bounds))
+	{
+		return false;
+	}
+
+	// The node must not fit into one of the children
+	if (cell.firstChild != 0)
+	{
+		for (auto child = cell.firstChild; child < cell.firstChild + 8; ++child)
+		{
+			if (_cells[child].bounds.contains(bounds))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void FlatOctree::addMember(std::uint32_t cellIndex, const INodePtr& sceneNode)
+{
+	auto& members = _cells[cellIndex].members;
+
+	_locations.insert(sceneNode.get(), NodeLocationTable::Location
+	{
+		cellIndex, static_cast<std::uint32_t>(members.size()), false
+	});
+
+	members.push_back(sceneNode);
+}
+
+void FlatOctree::removeMember(const NodeLocationTable::Location& location)
+{
+	auto& members = _cells[location.cell].members;
+
+	// Fill the gap with the last member of this cell
+	if (location.slot + 1 < members.size())
+	{
+		members[location.slot] = std::move(members.back());
+		_locations.find(members[location.slot].get())->slot = location.slot;
+	}
+
+	members.pop_back();
+}
+
+void FlatOctree::subdivide(std::uint32_t cellIndex)
+{
+	// Evaluate all member bounds before re-distributing them, this way
+	// any bounds change happening during evaluation is already settled
+	for (std::size_t i = 0; i < _cells[cellIndex].members.size(); ++i)
+	{
+		_cells[cellIndex].members[i]->worldAABB();
+	}
+
+	AABB bounds = _cells[cellIndex].bounds;
+
+	// Each child cell has half the extents of this cell
+	Vector3 childExtents = bounds.extents * 0.5;
+
+	// Construct delta-vectors, pointing in each room direction
+	Vector3 x(childExtents.x(), 0, 0);
+	Vector3 y(0, childExtents.y(), 0);
+	Vector3 z(0, 0, childExtents.z());
+
+	Vector3 baseUpper = bounds.origin + z;
+	Vector3 baseLower = bounds.origin - z;
+
+	// Upper four children first, counter-clockwise starting at +x +y
+	auto firstChild = createCell(AABB(baseUpper + x + y, childExtents), cellIndex);
+	createCell(AABB(baseUpper + x - y, childExtents), cellIndex);
+	createCell(AABB(baseUpper - x - y, childExtents), cellIndex);
+	createCell(AABB(baseUpper - x + y, childExtents), cellIndex);
+	createCell(AABB(baseLower + x + y, childExtents), cellIndex);
+	createCell(AABB(baseLower + x - y, childExtents), cellIndex);
+	createCell(AABB(baseLower - x - y, childExtents), cellIndex);
+	createCell(AABB(baseLower - x + y, childExtents), cellIndex);
+
+	_cells[cellIndex].firstChild = firstChild;
+
+	ISPNode::MemberList members;
+	members.swap(_cells[cellIndex].members);
+
+	for (auto& member : members)
+	{
+		const AABB& memberBounds = member->worldAABB();
+
+		auto targetCell = cellIndex;
+
+		if (memberBounds.isValid())
+		{
+			for (auto child = firstChild; child < firstChild + 8; ++child)
+			{
+				if (_cells[child].bounds.contains(memberBounds))
+				{
+					targetCell = child;
+					break;
+				}
+			}
+		}
+
+		auto& targetMembers = _cells[targetCell].members;
+
+		auto location = _locations.find(member.get());
+		location->cell = targetCell;
+		location->slot = static_cast<std::uint32_t>(targetMembers.size());
+
+		targetMembers.push_back(std::move(member));
+	}
+
+	// All members might have ended up in the same child
+	for (auto child = firstChild; child < firstChild + 8; ++child)
+	{
+		if (_cells[child].members.size() >= SUBDIVISION_THRESHOLD &&
+			childExtents.x() > MIN_NODE_EXTENTS)
+		{
+			subdivide(child);
+		}
+	}
+}
+
+std::uint32_t FlatOctree::createCell(const AABB& bounds, std::uint32_t parentIndex)
+{
+	auto index = static_cast<std::uint32_t>(_cells.size());
+
+	_cells.emplace_back(bounds);
+
+	auto parent = !_views.empty() ? _views[parentIndex] : std::shared_ptr<FlatOctreeNode>();
+	auto view = std::make_shared<FlatOctreeNode>(*this, index, bounds, parent);
+
+	if (parent)
+	{
+		parent->addChild(view);
+	}
+
+	_views.push_back(view);
+
+	return index;
+}
+
+void FlatOctree::ensureRootSize(const AABB& bounds)
+{
+	if (!bounds.isValid()) return; // skip this for invalid bounds
+
+	AABB rootBounds = _cells.front().bounds;
+
+	while (!rootBounds.contains(bounds))
+	{
+		AABB newBounds = rootBounds;
+		newBounds.extents *= 2;
+
+		// Don't go beyond the map limits
+		if (newBounds.extents.x() > MAX_WORLD_COORD)
+		{
+			break;
+		}
+
+		rootBounds = newBounds;
+	}
+
+	if (rootBounds == _cells.front().bounds)
+	{
+		return;
+	}
+
+	// Collect all members and link them into a fresh tree
+	ISPNode::MemberList members;
+	members.reserve(_locations.size());
+
+	for (auto& cell : _cells)
+	{
+		std::move(cell.members.begin(), cell.members.end(), std::back_inserter(members));
+	}
+
+	reset(rootBounds);
+
+	for (const auto& member : members)
+	{
+		link(member);
+	}
+}
+
+void FlatOctree::reset(const AABB& rootBounds)
+{
+	for (const auto& view : _views)
+	{
+		view->detach();
+	}
+
+	_views.clear();
+	_cells.clear();
+	_locations.clear();
+
+	// Every member is linked according to its current bounds after this
+	_pendingRelinks.clear();
+
+	createCell(rootBounds, 0);
+}
+
+} // namespace scene
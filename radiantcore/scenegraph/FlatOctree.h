@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ispacepartition.h"
+#include "math/AABB.h"
+
+#include "NodeLocationTable.h"
+
+namespace scene
+{
+
+class FlatOctreeNode;
+
+/**
+ * The octree partitioning the scene, keeping all its cells in one contiguous
+ * array, such that linking and culling don't need to chase pointers.
+ *
+ * Cells are cubes which get 8 children as soon as they host
+ * SUBDIVISION_THRESHOLD members (unless they reached MIN_NODE_EXTENTS),
+ * each member is linked into the smallest cell containing it.
+ *
+ * Members are stored in an array per cell, the NodeLocationTable
+ * knows the cell and the array slot of each linked scene node,
+ * so unlinking doesn't need to search for anything.
+ *
+ * Bounds changes are not applied right away: relink() just marks the
+ * node, the pending relinks are processed in one go when getRoot() is
+ * called before the next traversal. Nodes which are still fitting into
+ * their cell are not moved at all, which is the common case when
+ * dragging a selection in small steps.
+ *
+ * The ISPNode objects handed out by getRoot() are thin views onto the
+ * cell array, they are only allocated when a cell is created.
+ */
+class FlatOctree :
+	public ISpacePartitionSystem
+{
+private:
+	friend class FlatOctreeNode;
+
+	struct Cell
+	{
+		AABB bounds;
+
+		// Index of the first of the 8 consecutive child cells, 0 for leaves
+		std::uint32_t firstChild;
+
+		ISPNode::MemberList members;
+
+		Cell(const AABB& bounds_) :
+			bounds(bounds_),
+			firstChild(0)
+		{}
+	};
+
+	// The root cell is always at index 0
+	std::vector<Cell> _cells;
+
+	// The ISPNode views, one for each cell
+	std::vector<std::shared_ptr<FlatOctreeNode>> _views;
+
+	NodeLocationTable _locations;
+
+	// The nodes which have been passed to relink() since the last getRoot() call
+	std::vector<const INode*> _pendingRelinks;
+
+	// The relinks currently being processed, kept to reuse its memory
+	std::vector<const INode*> _relinkBatch;
+
+public:
+	FlatOctree();
+	~FlatOctree();
+
+	void link(const INodePtr& sceneNode) override;
+	bool unlink(const INodePtr& sceneNode) override;
+
+	// Marks the node for relinking, this happens in the next getRoot() call
+	bool relink(const INodePtr& sceneNode) override;
+
+	ISPNodePtr getRoot() override;
+
+private:
+	void applyPendingRelinks();
+
+	// Returns true if the given bounds are still belonging to the given cell
+	bool isMatchingCell(std::uint32_t cellIndex, const AABB& bounds) const;
+
+	void addMember(std::uint32_t cellIndex, const INodePtr& sceneNode);
+	void removeMember(const NodeLocationTable::Location& location);
+
+	// Creates the 8 children of the given cell and distributes its members
+	void subdivide(std::uint32_t cellIndex);
+
+	// Creates a new cell and its view, returns its index
+	std::uint32_t createCell(const AABB& bounds, std::uint32_t parentIndex);
+
+	/**
+	 * Makes sure the root cell is large enough to contain the given bounds.
+	 * Growing the root rebuilds the whole tree, which happens only a few times
+	 * until the root has reached its maximum size.
+	 */
+	void ensureRootSize(const AABB& bounds);
+
+	// Discards all cells and creates an empty root cell with the given bounds
+	void reset(const AABB& rootBounds);
+};
+
+} // namespace scene
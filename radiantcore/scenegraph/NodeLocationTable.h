@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+
+namespace scene
+{
+
+class INode;
+
+/**
+ * Hash table mapping scene nodes to the place they are stored at
+ * in the FlatOctree (the cell index and the slot in the member array).
+ *
+ * This is an open-addressing table with linear probing, keyed by the
+ * raw node pointer, such that lookups don't need to touch the refcount
+ * and don't allocate. The capacity is always a power of two, the table
+ * grows once it is filled by half. Erased entries are not marked as
+ * deleted, the following entries are moved back instead.
+ */
+class NodeLocationTable
+{
+public:
+	struct Location
+	{
+		std::uint32_t cell;
+		std::uint32_t slot;
+
+		// True if the node is waiting to be moved to its new cell
+		bool relinkPending;
+	};
+
+private:
+	struct Entry
+	{
+		const INode* node;
+		Location location;
+	};
+
+	static constexpr std::size_t MIN_CAPACITY_BITS = 6;
+
+	std::vector<Entry> _entries;
+	std::size_t _size;
+	std::size_t _capacityBits;
+
+public:
+	NodeLocationTable() :
+		_size(0),
+		_capacityBits(MIN_CAPACITY_BITS)
+	{
+		_entries.resize(std::size_t(1) << _capacityBits, Entry{ nullptr, Location() });
+	}
+
+	std::size_t size() const
+	{
+		return _size;
+	}
+
+	// Returns the location of the given node, or nullptr if it is not in the table.
+	// The pointer is valid until the next insert() or erase() call.
+	Location* find(const INode* node)
+	{
+		for (auto i = getHomeIndex(node); ; i = (i + 1) & getMask())
+		{
+			auto& entry = _entries[i];
+
+			if (entry.node == node)
+			{
+				return &entry.location;
+			}
+
+			if (entry.node == nullptr)
+			{
+				return nullptr;
+			}
+		}
+	}
+
+	// Adds the given node, which must not be in the table yet
+	Location& insert(const INode* node, const Location& location)
+	{
+		assert(node != nullptr && find(node) == nullptr);
+
+		if ((_size + 1) * 2 > _entries.size())
+		{
+			rehash(_capacityBits + 1);
+		}
+
+		++_size;
+
+		return place(node, location);
+	}
+
+	// Removes the given node from the table, returns false if it hasn't been in there
+	bool erase(const INode* node)
+	{
+		auto mask = getMask();
+		auto i = getHomeIndex(node);
+
+		while (_entries[i].node != node)
+		{
+			if (_entries[i].node == nullptr)
+			{
+				return false;
+			}
+
+			i = (i + 1) & mask;
+		}
+
+		// Move back the entries following in the same cluster which would
+		// no longer be found by the probing sequence starting at their home index
+		for (auto j = (i + 1) & mask; _entries[j].node != nullptr; j = (j + 1) & mask)
+		{
+			auto home = getHomeIndex(_entries[j].node);
+
+			// Distance check working across the wrap-around
+			if (((j - home) & mask) >= ((j - i) & mask))
+			{
+				_entries[i] = _entries[j];
+				i = j;
+			}
+		}
+
+		_entries[i].node = nullptr;
+		--_size;
+
+		return true;
+	}
+
+	void clear()
+	{
+		_entries.assign(std::size_t(1) << MIN_CAPACITY_BITS, Entry{ nullptr, Location() });
+		_capacityBits = MIN_CAPACITY_BITS;
+		_size = 0;
+	}
+
+private:
+	std::size_t getMask() const
+	{
+		return _entries.size() - 1;
+	}
+
+	// Fibonacci hashing, the upper bits of the product are the best distributed ones
+	std::size_t getHomeIndex(const INode* node) const
+	{
+		auto hash = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(node)) * 11400714819323198485ull;
+		return static_cast<std::size_t>(hash >> (64 - _capacityBits));
+	}
+
+	Location& place(const INode* node, const Location& location)
+	{
+		auto i = getHomeIndex(node);
+
+		while (_entries[i].node != nullptr)
+		{
+			i = (i + 1) & getMask();
+		}
+
+		_entries[i] = Entry{ node, location };
+
+		return _entries[i].location;
+	}
+
+	void rehash(std::size_t capacityBits)
+	{
+		std::vector<Entry> oldEntries(std::size_t(1) << capacityBits, Entry{ nullptr, Location() });
+		oldEntries.swap(_entries);
+
+		_capacityBits = capacityBits;
+
+		for (const auto& entry : oldEntries)
+		{
+			if (entry.node != nullptr)
+			{
+				place(entry.node, entry.location);
+			}
+		}
+	}
+};
+
+}
@@ -7,18 +7,61 @@
 #include "debugging/debugging.h"
 
 #include "math/AABB.h"
-#include "Octree.h"
+#include "FlatOctree.h"
 #include "SceneGraphFactory.h"
 #include "util/ScopedBoolLock.h"
 #include "module/StaticModule.h"
+#include "ThreadPool.h"
 
 namespace scene
 {
 
+namespace
+{
+	// Scenes with fewer nodes are culled on the calling thread only
+	const std::size_t MIN_NODES_FOR_PARALLEL_CULLING = 4096;
+
+	// The tree is split into this many subtrees per worker thread
+	const std::size_t SUBTREES_PER_THREAD = 4;
+
+	void collectMembers(const ISPNode& node, bool visitHidden, std::vector<const INodePtr*>& result)
+	{
+		for (const auto& member : node.getMembers())
+		{
+			if (visitHidden || member->visible())
+			{
+				result.push_back(&member);
+			}
+		}
+	}
+
+	// Worker function: collects the members of all the SP nodes intersecting the volume.
+	// The children are tested against the volume, the given node itself has been tested before.
+	void cullSubtree(const ISPNode& node, const VolumeTest& volume, bool visitHidden,
+		std::vector<const INodePtr*>& result, std::size_t& visited, std::size_t& skipped)
+	{
+		++visited;
+
+		collectMembers(node, visitHidden, result);
+
+		for (const auto& child : node.getChildNodes())
+		{
+			if (volume.TestAABB(child->getBounds()) == VOLUME_OUTSIDE)
+			{
+				++skipped;
+				continue;
+			}
+
+			cullSubtree(*child, volume, visitHidden, result, visited, skipped);
+		}
+	}
+}
+
 SceneGraph::SceneGraph() :
-	_spacePartition(new Octree),
+	_spacePartition(new FlatOctree),
 	_visitedSPNodes(0),
 	_skippedSPNodes(0),
+	_numLinkedNodes(0),
     _traversalOngoing(false)
 {}
 
@@ -86,7 +129,8 @@ void SceneGraph::setRoot(const IMapRootNodePtr& newRoot)
 	_root = newRoot;
 
 	// Refresh the space partition class
-	_spacePartition = ISpacePartitionSystemPtr(new Octree);
+	_spacePartition = ISpacePartitionSystemPtr(new FlatOctree);
+	_numLinkedNodes = 0;
 
 	if (_root)
 	{
@@ -120,6 +164,7 @@ void SceneGraph::insert(const INodePtr& node)
 
 	// Insert this node into our SP tree
 	_spacePartition->link(node);
+	++_numLinkedNodes;
 
 	// Call the onInsert event on the node
     assert(_root);
@@ -139,7 +184,10 @@ void SceneGraph::erase(const INodePtr& node)
         return;
     }
 
-	_spacePartition->unlink(node);
+	if (_spacePartition->unlink(node))
+	{
+		--_numLinkedNodes;
+	}
 
 	// Fire the onRemove event on the Node
     assert(_root);
@@ -162,11 +210,8 @@ void SceneGraph::nodeBoundsChanged(const INodePtr& node)
         return;
     }
 
-	if (_spacePartition->unlink(node))
-	{
-		// unlink returned true, so the given node was linked before => re-link it
-		_spacePartition->link(node);
-	}
+	// The space partition will move the node before the next traversal
+	_spacePartition->relink(node);
 }
 
 void SceneGraph::foreachNode(const INode::VisitorFunc& functor)
@@ -212,11 +257,15 @@ void SceneGraph::foreachNodeInVolume(const VolumeTest& volume, const INode::Visi
 {
     // Acquire the worldAABB() of the scenegraph root - if any node got changed in the graph
     // the scenegraph's root bounds are marked as "dirty" and the bounds will be re-calculated
-    // which in turn might trigger a re-link in the Octree. We want to avoid that the Octree
+    // which in turn might trigger a re-link in the octree. We want to avoid that the octree
     // changes during traversal so let's call this now. If nothing got changed, this call is very cheap.
     if (_root != nullptr) _root->worldAABB();
 
     {
+        // Nested traversals (started by the functor) are not using the worker threads,
+        // the parallel pass is using a single set of result buffers
+        bool isNested = _traversalOngoing;
+
         // Buffer any calls that might happen in between
         util::ScopedBoolLock traversal(_traversalOngoing);
 
@@ -225,7 +274,11 @@ void SceneGraph::foreachNodeInVolume(const VolumeTest& volume, const INode::Visi
 
         _visitedSPNodes = _skippedSPNodes = 0;
 
-        foreachNodeInVolume_r(*root, volume, functor, visitHidden);
+        if (isNested || _numLinkedNodes < MIN_NODES_FOR_PARALLEL_CULLING ||
+            !foreachNodeInVolumeParallel(*root, volume, functor, visitHidden))
+        {
+            foreachNodeInVolume_r(*root, volume, functor, visitHidden);
+        }
 
         _visitedSPNodes = _skippedSPNodes = 0;
     }
@@ -298,6 +351,107 @@ bool SceneGraph::foreachNodeInVolume_r(const ISPNode& node, const VolumeTest& vo
 	return true; // continue traversal
 }
 
+bool SceneGraph::foreachNodeInVolumeParallel(const ISPNode& root, const VolumeTest& volume,
+											 const INode::VisitorFunc& functor, bool visitHidden)
+{
+	auto numThreads = util::ThreadPool::GetDefaultNumThreads();
+
+	if (numThreads < 2)
+	{
+		return false;
+	}
+
+	// Split the tree on this thread, breadth first, until there are enough subtrees.
+	// The members of the split SP nodes are collected into the first list.
+	_culledMembers.resize(1);
+	_culledMembers.front().clear();
+
+	std::vector<const ISPNode*> subtrees(1, &root);
+	std::vector<const ISPNode*> nextSubtrees;
+
+	while (subtrees.size() < numThreads * SUBTREES_PER_THREAD)
+	{
+		bool split = false;
+
+		nextSubtrees.clear();
+
+		for (auto node : subtrees)
+		{
+			if (node->isLeaf())
+			{
+				nextSubtrees.push_back(node);
+				continue;
+			}
+
+			split = true;
+
+			++_visitedSPNodes;
+			collectMembers(*node, visitHidden, _culledMembers.front());
+
+			for (const auto& child : node->getChildNodes())
+			{
+				if (volume.TestAABB(child->getBounds()) == VOLUME_OUTSIDE)
+				{
+					++_skippedSPNodes;
+					continue;
+				}
+
+				nextSubtrees.push_back(child.get());
+			}
+		}
+
+		subtrees.swap(nextSubtrees);
+
+		if (!split) break; // only leaves left
+	}
+
+	if (subtrees.size() < numThreads)
+	{
+		// Not worth the effort, the collected members are discarded
+		_visitedSPNodes = _skippedSPNodes = 0;
+		return false;
+	}
+
+	_culledMembers.resize(subtrees.size() + 1);
+
+	struct SubtreeStatistics
+	{
+		std::size_t visited = 0;
+		std::size_t skipped = 0;
+	};
+
+	std::vector<SubtreeStatistics> statistics(subtrees.size());
+
+	// The loop returns when all subtrees are done, the functor might modify the nodes
+	util::ThreadPool::GetShared().parallelFor(subtrees.size(), [&](std::size_t i)
+	{
+		auto& members = _culledMembers[i + 1];
+		members.clear();
+
+		cullSubtree(*subtrees[i], volume, visitHidden, members, statistics[i].visited, statistics[i].skipped);
+	});
+
+	for (const auto& subtree : statistics)
+	{
+		_visitedSPNodes += subtree.visited;
+		_skippedSPNodes += subtree.skipped;
+	}
+
+	for (const auto& members : _culledMembers)
+	{
+		for (auto member : members)
+		{
+			// We're done, as soon as the walker returns FALSE
+			if (!functor(*member))
+			{
+				return true;
+			}
+		}
+	}
+
+	return true;
+}
+
 ISpacePartitionSystemPtr SceneGraph::getSpacePartition()
 {
 	return _spacePartition;
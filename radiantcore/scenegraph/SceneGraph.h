@@ -2,6 +2,8 @@
 
 #include <map>
 #include <list>
+#include <memory>
+#include <vector>
 #include <sigc++/signal.h>
 
 #include "iscenegraph.h"
@@ -37,6 +39,13 @@ private:
 	std::size_t _visitedSPNodes;
 	std::size_t _skippedSPNodes;
 
+	// The number of nodes linked into the space partition
+	std::size_t _numLinkedNodes;
+
+	// The members found by the parallel culling pass, one list per subtree
+	typedef std::vector<const INodePtr*> CulledMembers;
+	std::vector<CulledMembers> _culledMembers;
+
     // During partition traversal all link/unlink calls are buffered and
     // performed later on.
     enum ActionType
@@ -99,6 +108,11 @@ private:
 	bool foreachNodeInVolume_r(const ISPNode& node, const VolumeTest& volume, 
 							   const INode::VisitorFunc& functor, bool visitHidden);
 
+	// Culls the subtrees of the given SP node on the worker threads, then calls the functor
+	// for the visible members on this thread. Returns false if the tree is too small to split.
+	bool foreachNodeInVolumeParallel(const ISPNode& root, const VolumeTest& volume,
+									 const INode::VisitorFunc& functor, bool visitHidden);
+
     void flushActionBuffer();
 };
 typedef std::shared_ptr<SceneGraph> SceneGraphPtr;
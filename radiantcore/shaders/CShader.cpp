@@ -59,6 +59,24 @@ TexturePtr CShader::getEditorImage()
     return _editorTexture;
 }
 
+MapExpressionPtr CShader::getEditorImageExpression() const
+{
+    return std::dynamic_pointer_cast<MapExpression>(_template->getEditorTexture());
+}
+
+std::function<ImagePtr()> CShader::getEditorImageLoader()
+{
+    // Parse the template on this thread, the expression can be evaluated anywhere
+    auto expression = getEditorImageExpression();
+
+    if (!expression)
+    {
+        return []() { return ImagePtr(); };
+    }
+
+    return [expression]() { return expression->getImage(); };
+}
+
 bool CShader::isEditorImageNoTex()
 {
 	return (getEditorImage() == GetTextureManager().getShaderNotFound());
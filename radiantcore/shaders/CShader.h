@@ -49,6 +49,10 @@ public:
     float getPolygonOffset() const;
 	TexturePtr getEditorImage();
 	bool isEditorImageNoTex();
+	std::function<ImagePtr()> getEditorImageLoader();
+
+	// The map expression of the editor image, empty if there's none
+	MapExpressionPtr getEditorImageExpression() const;
 
 	// Return the light falloff texture (Z dimension).
 	TexturePtr lightFalloffImage();
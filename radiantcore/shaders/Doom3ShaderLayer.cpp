@@ -81,6 +81,7 @@ const IShaderExpressionPtr Doom3ShaderLayer::NULL_EXPRESSION;
 Doom3ShaderLayer::Doom3ShaderLayer(ShaderTemplate& material, ShaderLayer::Type type, const NamedBindablePtr& btex)
 :	_material(material),
 	_registers(NUM_RESERVED_REGISTERS),
+	_programIsValid(true),
 	_condition(REG_ONE),
 	_bindableTex(btex),
 	_type(type),
@@ -120,6 +121,28 @@ Doom3ShaderLayer::Doom3ShaderLayer(ShaderTemplate& material, ShaderLayer::Type t
 	_texGenParams[0] = _texGenParams[1] = _texGenParams[2] = 0;
 }
 
+bool Doom3ShaderLayer::compileExpressions()
+{
+	// Expressions are only ever appended, compile the new ones
+	while (_programIsValid && _program.getNumExpressions() < _expressions.size())
+	{
+		_programIsValid = _program.addExpression(_expressions[_program.getNumExpressions()]);
+	}
+
+	return _programIsValid;
+}
+
+bool Doom3ShaderLayer::usesEntityShaderParms()
+{
+	// Expressions which can't be compiled can't be inspected
+	if (!compileExpressions())
+	{
+		return !_expressions.empty();
+	}
+
+	return _program.usesShaderParms();
+}
+
 TexturePtr Doom3ShaderLayer::getTexture() const
 {
     // Bind texture to GL if needed
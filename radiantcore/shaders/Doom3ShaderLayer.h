@@ -5,6 +5,7 @@
 
 #include "math/Vector4.h"
 #include "NamedBindable.h"
+#include "ShaderExpressionProgram.h"
 
 namespace shaders
 {
@@ -45,6 +46,11 @@ private:
 
     static const IShaderExpressionPtr NULL_EXPRESSION;
 
+    // The expressions compiled into register instructions, compiled
+    // on demand. Not used if any of the expressions fails to compile.
+    ShaderExpressionProgram _program;
+    bool _programIsValid;
+
     // The condition register for this stage. Points to a register to be interpreted as bool.
     std::size_t _condition;
 
@@ -142,6 +148,12 @@ public:
 
     void evaluateExpressions(std::size_t time) 
     {
+        if (compileExpressions())
+        {
+            _program.evaluate(time, _registers);
+            return;
+        }
+
         for (Expressions::iterator i = _expressions.begin(); i != _expressions.end(); ++i)
         {
             (*i)->evaluate(time);
@@ -150,12 +162,22 @@ public:
 
     void evaluateExpressions(std::size_t time, const IRenderEntity& entity)
     {
+        if (compileExpressions())
+        {
+            _program.evaluate(time, entity, _registers);
+            return;
+        }
+
         for (Expressions::iterator i = _expressions.begin(); i != _expressions.end(); ++i)
         {
             (*i)->evaluate(time, entity);
         }
     }
 
+    // Compiles the expressions added since the last call, returns false if the
+    // expressions need to be evaluated one by one instead
+    bool compileExpressions();
+
     /**
      * \brief
      * Set the bindable texture object.
@@ -506,6 +528,8 @@ public:
     }
 
     std::string getMapImageFilename() override;
+
+    bool usesEntityShaderParms() override;
 };
 
 /**
@@ -1,5 +1,7 @@
 #include "Doom3ShaderSystem.h"
 #include "ShaderFileLoader.h"
+#include "MaterialIndexCache.h"
+#include "MaterialSourceFiles.h"
 
 #include "i18n.h"
 #include "iradiant.h"
@@ -11,6 +13,7 @@
 #include "iradiant.h"
 #include "igame.h"
 #include "iarchive.h"
+#include "ideclscheduler.h"
 
 #include "xmlutil/Node.h"
 #include "xmlutil/MissingXMLNodeException.h"
@@ -61,7 +64,7 @@ Doom3ShaderSystem::Doom3ShaderSystem() :
 void Doom3ShaderSystem::construct()
 {
     _library = std::make_shared<ShaderLibrary>();
-    _textureManager = std::make_shared<GLTextureManager>();
+    _textureManager = std::make_shared<GLTextureManager>(_signalTexturesStreamed);
 
     // Register this class as VFS observer
     GlobalFileSystem().addObserver(*this);
@@ -72,6 +75,9 @@ void Doom3ShaderSystem::destroy()
     // De-register this class as VFS Observer
     GlobalFileSystem().removeObserver(*this);
 
+    // Don't keep loading textures in the background
+    _textureManager->stopStreaming();
+
     // Free the shaders if we're in realised state
     if (_realised) 
     {
@@ -107,9 +113,13 @@ ShaderLibraryPtr Doom3ShaderSystem::loadMaterialFiles()
     // Load each file from the global filesystem
     {
         ScopedDebugTimer timer("ShaderFiles parsed: ");
+        MaterialIndexCache indexCache(_indexCachePath);
+
         ShaderFileLoader<ShaderLibrary> loader(GlobalFileSystem(), *library,
-                                               sPath, extension);
+                                               sPath, extension, &indexCache);
         loader.parseFiles();
+
+        indexCache.save();
     }
 
     rMessage() << library->getNumDefinitions() << " shader definitions found." << std::endl;
@@ -161,6 +171,7 @@ void Doom3ShaderSystem::onFileSystemShutdown()
 void Doom3ShaderSystem::freeShaders() {
     _library->clear();
     _defLoader.reset();
+    MaterialSourceFiles::Clear();
     _textureManager->checkBindings();
     activeShadersChangedNotify();
 }
@@ -296,6 +307,35 @@ TexturePtr Doom3ShaderSystem::loadTextureFromFile(const std::string& filename)
     return _textureManager->getBinding(filename);
 }
 
+bool Doom3ShaderSystem::uploadStreamedTextures()
+{
+    return _textureManager->uploadStreamedTextures();
+}
+
+void Doom3ShaderSystem::prefetchEditorImages(const std::set<std::string>& materialNames)
+{
+    ensureDefsLoaded();
+
+    std::vector<MapExpressionPtr> expressions;
+
+    for (const auto& name : materialNames)
+    {
+        auto expression = _library->findShader(name)->getEditorImageExpression();
+
+        if (expression)
+        {
+            expressions.push_back(expression);
+        }
+    }
+
+    _textureManager->prefetchTextures(expressions);
+}
+
+sigc::signal<void>& Doom3ShaderSystem::signal_TexturesStreamed()
+{
+    return _signalTexturesStreamed;
+}
+
 IShaderExpressionPtr Doom3ShaderSystem::createShaderExpressionFromString(const std::string& exprStr)
 {
     return ShaderExpression::createFromString(exprStr);
@@ -323,6 +363,8 @@ const StringSet& Doom3ShaderSystem::getDependencies() const
         _dependencies.insert(MODULE_VIRTUALFILESYSTEM);
         _dependencies.insert(MODULE_XMLREGISTRY);
         _dependencies.insert(MODULE_GAMEMANAGER);
+        _dependencies.insert(MODULE_DECLARATION_SCHEDULER);
+        _dependencies.insert(MODULE_PREFERENCESYSTEM);
     }
 
     return _dependencies;
@@ -332,6 +374,8 @@ void Doom3ShaderSystem::initialiseModule(const IApplicationContext& ctx)
 {
     rMessage() << getName() << "::initialiseModule called" << std::endl;
 
+    _indexCachePath = ctx.getCacheDataPath() + "materials.cache";
+
     construct();
     realise();
 
@@ -31,6 +31,9 @@ class Doom3ShaderSystem :
     // The ShaderFileLoader will provide a new ShaderLibrary once complete
     util::ThreadedDefLoader<ShaderLibraryPtr> _defLoader;
 
+    // Location of the material index, see MaterialIndexCache
+    std::string _indexCachePath;
+
 	// The manager that handles the texture caching.
 	GLTextureManagerPtr _textureManager;
 
@@ -46,6 +49,7 @@ class Doom3ShaderSystem :
 	// Signals for module subscribers
 	sigc::signal<void> _signalDefsLoaded;
 	sigc::signal<void> _signalDefsUnloaded;
+	sigc::signal<void> _signalTexturesStreamed;
 
 public:
 
@@ -101,6 +105,10 @@ public:
 	 */
     TexturePtr loadTextureFromFile(const std::string& filename) override;
 
+    bool uploadStreamedTextures() override;
+    void prefetchEditorImages(const std::set<std::string>& materialNames) override;
+    sigc::signal<void>& signal_TexturesStreamed() override;
+
 	GLTextureManager& getTextureManager();
 
     // Get default textures for D,B,S layers
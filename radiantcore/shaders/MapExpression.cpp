@@ -5,13 +5,13 @@
 #include "imodule.h"
 
 #include <iostream>
+#include <map>
 
 #include "os/path.h"
 #include "string/convert.h"
-#include "math/FloatTools.h" // contains float_to_integer() helper
-#include "math/Vector3.h"
 
 #include "RGBAImage.h"
+#include "ImageKernels.h"
 #include "textures/HeightmapCreator.h"
 #include "textures/TextureManipulator.h"
 #include "string/predicate.h"
@@ -19,21 +19,24 @@
 /* CONSTANTS */
 namespace
 {
-	// Default image maps for optional material stages
-	const std::string IMAGE_BLACK = "_black.bmp";
-	const std::string IMAGE_CUBICLIGHT = "_cubiclight.bmp";
-	const std::string IMAGE_CURRENTRENDER = "_currentrender.bmp";
-	const std::string IMAGE_DEFAULT = "_default.bmp";
-	const std::string IMAGE_FLAT = "_flat.bmp";
-	const std::string IMAGE_FOG = "_fog.bmp";
-	const std::string IMAGE_NOFALLOFF = "noFalloff.bmp";
-	const std::string IMAGE_POINTLIGHT1 = "_pointlight1.bmp";
-	const std::string IMAGE_POINTLIGHT2 = "_pointlight2.bmp";
-	const std::string IMAGE_POINTLIGHT3 = "_pointlight3.bmp";
-	const std::string IMAGE_QUADRATIC = "_quadratic.bmp";
-	const std::string IMAGE_SCRATCH = "_scratch.bmp";
-	const std::string IMAGE_SPOTLIGHT = "_spotlight.bmp";
-	const std::string IMAGE_WHITE = "_white.bmp";
+	// Default image maps for optional material stages, by keyword
+	const std::map<std::string, std::string> BUILTIN_IMAGES
+	{
+		{ "_black", "_black.bmp" },
+		{ "_cubiclight", "_cubiclight.bmp" },
+		{ "_currentRender", "_currentrender.bmp" },
+		{ "_default", "_default.bmp" },
+		{ "_flat", "_flat.bmp" },
+		{ "_fog", "_fog.bmp" },
+		{ "_nofalloff", "noFalloff.bmp" },
+		{ "_pointlight1", "_pointlight1.bmp" },
+		{ "_pointlight2", "_pointlight2.bmp" },
+		{ "_pointlight3", "_pointlight3.bmp" },
+		{ "_quadratic", "_quadratic.bmp" },
+		{ "_scratch", "_scratch.bmp" },
+		{ "_spotlight", "_spotlight.bmp" },
+		{ "_white", "_white.bmp" },
+	};
 
 	inline std::string getBitmapsPath()
 	{
@@ -146,6 +149,10 @@ std::string HeightMapExpression::getIdentifier() const {
 	return identifier;
 }
 
+void HeightMapExpression::collectImageNames(std::set<std::string>& names) const {
+	heightMapExp->collectImageNames(names);
+}
+
 AddNormalsExpression::AddNormalsExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExpOne = createForToken(token);
@@ -177,40 +184,8 @@ ImagePtr AddNormalsExpression::getImage() const {
 
     ImagePtr result (new RGBAImage(width, height));
 
-    byte* pixOne = imgOne->getPixels();
-    byte* pixTwo = imgTwo->getPixels();
-    byte* pixOut = result->getPixels();
+    image::addNormals(imgOne->getPixels(), imgTwo->getPixels(), result->getPixels(), width, height);
 
-    // iterate through the pixels
-    for( std::size_t y = 0; y < height; y++ )
-	{
-		for( std::size_t x = 0; x < width; x++ )
-		{
-			// create the two vectors
-			Vector3 vectorOne(
-    			static_cast<double>(pixOne[0]),
-    			static_cast<double>(pixOne[1]),
-    			static_cast<double>(pixOne[2])
-			);
-			Vector3 vectorTwo(
-    			static_cast<double>(pixTwo[0]),
-    			static_cast<double>(pixTwo[1]),
-    			static_cast<double>(pixTwo[2])
-			);
-			// Take the mean value of the two vectors
-			Vector3 vectorOut = (vectorOne + vectorTwo) * 0.5;
-
-			pixOut[0] = static_cast<byte>(float_to_integer(vectorOut.x()));
-			pixOut[1] = static_cast<byte>(float_to_integer(vectorOut.y()));
-			pixOut[2] = static_cast<byte>(float_to_integer(vectorOut.z()));
-			pixOut[3] = 255;
-
-			// advance the pixel pointer
-			pixOne += 4;
-			pixTwo += 4;
-			pixOut += 4;
-		}
-    }
     return result;
 }
 
@@ -220,6 +195,11 @@ std::string AddNormalsExpression::getIdentifier() const {
 	return identifier;
 }
 
+void AddNormalsExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExpOne->collectImageNames(names);
+	mapExpTwo->collectImageNames(names);
+}
+
 SmoothNormalsExpression::SmoothNormalsExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
@@ -243,56 +223,8 @@ ImagePtr SmoothNormalsExpression::getImage() const {
 
 	ImagePtr result (new RGBAImage(width, height));
 
-	byte* in = normalMap->getPixels();
-	byte* out = result->getPixels();
+	image::smoothNormals(normalMap->getPixels(), result->getPixels(), width, height);
 
-	struct KernelElement {
-		// offset to the current pixel
-		int dx, dy;
-	};
-
-	// a 3x3 kernel with the surrounding pixels including the pixel itself
-	const int kernelSize = 9;
-	KernelElement kernel[kernelSize] = {
-		{-1, -1 },
-		{ 0, -1 },
-		{ 1, -1 },
-		{ 1,  0 },
-		{ 1,  1 },
-		{ 0,  1 },
-		{-1,  1 },
-		{-1,  0 },
-		{ 0,  0 }
-	};
-	const float perKernelSize = 1.0f/kernelSize;
-
-	// iterate through the pixels
-	for( std::size_t y = 0; y < height; y++) {
-		for( std::size_t x = 0; x < width; x++) {
-			//the new normal vector for this pixel
-			Vector3 smoothVector(0,0,0);
-
-			// calculate the average direction of the surrounding vectors
-			for (KernelElement* i = kernel; i != kernel + kernelSize; ++i) {
-				// temporary vector to represent one of the surrounding pixels
-				byte* pixel = getPixel(in, width, height, x + i->dx, y + i->dy);
-				Vector3 temp(pixel[0], pixel[1], pixel[2]);
-
-				smoothVector += temp;
-			}
-
-			// Take the average normal vector as result
-			smoothVector *= perKernelSize;
-
-			out[0] = static_cast<byte>(float_to_integer(smoothVector.x()));
-			out[1] = static_cast<byte>(float_to_integer(smoothVector.y()));
-			out[2] = static_cast<byte>(float_to_integer(smoothVector.z()));
-			out[3] = 255;
-
-			// advance the pixel pointer
-			out += 4;
-	    }
-	}
     return result;
 }
 
@@ -302,6 +234,10 @@ std::string SmoothNormalsExpression::getIdentifier() const {
 	return identifier;
 }
 
+void SmoothNormalsExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 AddExpression::AddExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExpOne = createForToken(token);
@@ -333,27 +269,8 @@ ImagePtr AddExpression::getImage() const {
 
     ImagePtr result (new RGBAImage(width, height));
 
-    byte* pixOne = imgOne->getPixels();
-    byte* pixTwo = imgTwo->getPixels();
-    byte* pixOut = result->getPixels();
+    image::add(imgOne->getPixels(), imgTwo->getPixels(), result->getPixels(), width, height);
 
-    // iterate through the pixels
-    for( std::size_t y = 0; y < height; y++)
-	{
-		for( std::size_t x = 0; x < width; x++)
-		{
-			// add the colors
-			pixOut[0] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[0]) + pixTwo[0]) * 0.5f));
-			pixOut[1] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[1]) + pixTwo[1]) * 0.5f));
-			pixOut[2] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[2]) + pixTwo[2]) * 0.5f));
-			pixOut[3] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[3]) + pixTwo[3]) * 0.5f));
-
-			//advance the pixel pointer
-			pixOne += 4;
-			pixTwo += 4;
-			pixOut += 4;
-		}
-    }
 	return result;
 }
 
@@ -363,6 +280,11 @@ std::string AddExpression::getIdentifier() const {
 	return identifier;
 }
 
+void AddExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExpOne->collectImageNames(names);
+	mapExpTwo->collectImageNames(names);
+}
+
 ScaleExpression::ScaleExpression (DefTokeniser& token) : scaleGreen(0),scaleBlue(0),scaleAlpha(0) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
@@ -404,32 +326,9 @@ ImagePtr ScaleExpression::getImage() const {
 
     ImagePtr result (new RGBAImage(width, height));
 
-    byte* in = img->getPixels();
-    byte* out = result->getPixels();
+    const float factors[4] = { scaleRed, scaleGreen, scaleBlue, scaleAlpha };
+    image::scale(img->getPixels(), result->getPixels(), width, height, factors);
 
-    // iterate through the pixels
-    for( std::size_t y = 0; y < height; ++y)
-	{
-		for( std::size_t x = 0; x < width; ++x)
-		{
-			// prevent negative values and check for values >255
-			int red = float_to_integer(static_cast<float>(in[0]) * scaleRed);
-			out[0] = (red>255) ? 255 : static_cast<byte>(red);
-
-			int green = float_to_integer(static_cast<float>(in[1]) * scaleGreen);
-			out[1] = (green>255) ? 255 : static_cast<byte>(green);
-
-			int blue = float_to_integer(static_cast<float>(in[2]) * scaleBlue);
-			out[2] = (blue>255) ? 255 : static_cast<byte>(blue);
-
-			int alpha = float_to_integer(static_cast<float>(in[3]) * scaleAlpha);
-			out[3] = (alpha>255) ? 255 : static_cast<byte>(alpha);
-
-			// advance the pixel pointer
-			in += 4;
-			out += 4;
-		}
-    }
 	return result;
 }
 
@@ -439,6 +338,10 @@ std::string ScaleExpression::getIdentifier() const {
 	return identifier;
 }
 
+void ScaleExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 InvertAlphaExpression::InvertAlphaExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
@@ -461,24 +364,7 @@ ImagePtr InvertAlphaExpression::getImage() const {
 
 	ImagePtr result (new RGBAImage(width, height));
 
-	byte* in = img->getPixels();
-	byte* out = result->getPixels();
-
-	// iterate through the pixels
-	for( std::size_t y = 0; y < height; ++y)
-	{
-		for( std::size_t x = 0; x < width; ++x)
-		{
-			out[0] = in[0];
-			out[1] = in[1];
-			out[2] = in[2];
-			out[3] = 255 - in[3];
-
-			// advance the pixel pointer
-			in += 4;
-			out += 4;
-		}
-	}
+	image::invert(img->getPixels(), result->getPixels(), width, height, false, true);
 
 	return result;
 }
@@ -489,6 +375,10 @@ std::string InvertAlphaExpression::getIdentifier() const {
 	return identifier;
 }
 
+void InvertAlphaExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 InvertColorExpression::InvertColorExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
@@ -511,22 +401,7 @@ ImagePtr InvertColorExpression::getImage() const {
 
 	ImagePtr result (new RGBAImage(width, height));
 
-	byte* in = img->getPixels();
-	byte* out = result->getPixels();
-
-	// iterate through the pixels
-	for( std::size_t y = 0; y < height; y++) {
-		for( std::size_t x = 0; x < width; x++) {
-			out[0] = 255 - in[0];
-			out[1] = 255 - in[1];
-			out[2] = 255 - in[2];
-			out[3] = in[3];
-
-			// advance the pixel pointer
-			in += 4;
-			out += 4;
-		}
-	}
+	image::invert(img->getPixels(), result->getPixels(), width, height, true, false);
 
 	return result;
 }
@@ -537,6 +412,10 @@ std::string InvertColorExpression::getIdentifier() const {
 	return identifier;
 }
 
+void InvertColorExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 MakeIntensityExpression::MakeIntensityExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
@@ -559,24 +438,7 @@ ImagePtr MakeIntensityExpression::getImage() const {
 
 	ImagePtr result (new RGBAImage(width, height));
 
-	byte* in = img->getPixels();
-	byte* out = result->getPixels();
-
-	// iterate through the pixels
-	for( std::size_t y = 0; y < height; ++y)
-	{
-		for( std::size_t x = 0; x < width; ++x)
-		{
-			out[0] = in[0];
-			out[1] = in[0];
-			out[2] = in[0];
-			out[3] = in[0];
-
-			// advance the pixel pointer
-			in += 4;
-			out += 4;
-		}
-	}
+	image::makeIntensity(img->getPixels(), result->getPixels(), width, height);
 
 	return result;
 }
@@ -587,6 +449,10 @@ std::string MakeIntensityExpression::getIdentifier() const {
 	return identifier;
 }
 
+void MakeIntensityExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 MakeAlphaExpression::MakeAlphaExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
@@ -609,24 +475,7 @@ ImagePtr MakeAlphaExpression::getImage() const {
 
 	ImagePtr result (new RGBAImage(width, height));
 
-	byte* in = img->getPixels();
-	byte* out = result->getPixels();
-
-	// iterate through the pixels
-	for( std::size_t y = 0; y < height; y++)
-	{
-		for( std::size_t x = 0; x < width; x++)
-		{
-			out[0] = 255;
-			out[1] = 255;
-			out[2] = 255;
-			out[3] = (in[0] + in[1] + in[2])/3;
-
-			// advance the pixel pointer
-			in += 4;
-			out += 4;
-		}
-	}
+	image::makeAlpha(img->getPixels(), result->getPixels(), width, height);
 
 	return result;
 }
@@ -637,6 +486,10 @@ std::string MakeAlphaExpression::getIdentifier() const {
 	return identifier;
 }
 
+void MakeAlphaExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 /* ImageExpression */
 
 ImageExpression::ImageExpression(const std::string& imgName)
@@ -650,80 +503,22 @@ ImageExpression::ImageExpression(const std::string& imgName)
 ImagePtr ImageExpression::getImage() const
 {
 	// Check for some image keywords and load the correct file
-	if (_imgName == "_black") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_BLACK
-        );
-	}
-	else if (_imgName == "_cubiclight") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_CUBICLIGHT
-        );
-	}
-	else if (_imgName == "_currentRender") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_CURRENTRENDER
-        );
-	}
-	else if (_imgName == "_default") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_DEFAULT
-        );
-	}
-	else if (_imgName == "_flat") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_FLAT
-        );
-	}
-	else if (_imgName == "_fog") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_FOG
-        );
-	}
-	else if (_imgName == "_nofalloff") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_NOFALLOFF
-        );
-	}
-	else if (_imgName == "_pointlight1") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_POINTLIGHT1
-        );
-	}
-	else if (_imgName == "_pointlight2") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_POINTLIGHT2
-        );
-	}
-	else if (_imgName == "_pointlight3") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_POINTLIGHT3
-        );
-	}
-	else if (_imgName == "_quadratic") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_QUADRATIC
-        );
-	}
-	else if (_imgName == "_scratch") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_SCRATCH
-        );
-	}
-	else if (_imgName == "_spotlight") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_SPOTLIGHT
-        );
-	}
-	else if (_imgName == "_white") {
-		return GlobalImageLoader().imageFromFile(
-            getBitmapsPath() + IMAGE_WHITE
-        );
+	auto builtin = BUILTIN_IMAGES.find(_imgName);
+
+	if (builtin != BUILTIN_IMAGES.end())
+	{
+		return GlobalImageLoader().imageFromFile(getBitmapsPath() + builtin->second);
 	}
-	else
-    {
-        // this is a normal material image, so we load the image from VFS
-		return GlobalImageLoader().imageFromVFS(_imgName);
+
+	// this is a normal material image, so we load the image from VFS
+	return GlobalImageLoader().imageFromVFS(_imgName);
+}
+
+void ImageExpression::collectImageNames(std::set<std::string>& names) const
+{
+	if (BUILTIN_IMAGES.count(_imgName) == 0)
+	{
+		names.insert(_imgName);
 	}
 }
 
@@ -2,7 +2,7 @@
 #define MAPEXPRESSION_H_
 
 #include <string>
-
+#include <set>
 #include <memory>
 
 #include "NamedBindable.h"
@@ -47,6 +47,14 @@ public: /* INTERFACE METHODS */
         return false;
     }
 
+    /**
+     * \brief
+     * Adds the names of the VFS images this expression is reading to the
+     * given set (without extension, as passed to imageFromVFS). Built-in
+     * images like _black are not included.
+     */
+    virtual void collectImageNames(std::set<std::string>& names) const = 0;
+
 public:
 
     /* BindableTexture interface */
@@ -90,6 +98,7 @@ public:
 	HeightMapExpression (DefTokeniser& token);
 	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const override;
 };
 
 class AddNormalsExpression : public MapExpression {
@@ -99,6 +108,7 @@ public:
 	AddNormalsExpression (DefTokeniser& token);
 	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const override;
 };
 
 class SmoothNormalsExpression : public MapExpression {
@@ -107,6 +117,7 @@ public:
 	SmoothNormalsExpression (DefTokeniser& token);
 	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const override;
 };
 
 class AddExpression : public MapExpression {
@@ -116,6 +127,7 @@ public:
 	AddExpression (DefTokeniser& token);
 	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const override;
 };
 
 class ScaleExpression : public MapExpression {
@@ -128,6 +140,7 @@ public:
 	ScaleExpression (DefTokeniser& token);
 	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const override;
 };
 
 class InvertAlphaExpression : public MapExpression {
@@ -136,6 +149,7 @@ public:
 	InvertAlphaExpression (DefTokeniser& token);
 	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const override;
 };
 
 class InvertColorExpression : public MapExpression {
@@ -144,6 +158,7 @@ public:
 	InvertColorExpression (DefTokeniser& token);
 	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const override;
 };
 
 class MakeIntensityExpression : public MapExpression {
@@ -152,6 +167,7 @@ public:
 	MakeIntensityExpression (DefTokeniser& token);
 	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const override;
 };
 
 class MakeAlphaExpression : public MapExpression {
@@ -160,6 +176,7 @@ public:
 	MakeAlphaExpression (DefTokeniser& token);
 	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const override;
 };
 
 /**
@@ -179,6 +196,7 @@ public:
 	ImageExpression(const std::string& imgName);
 	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const override;
 };
 
 } // namespace shaders
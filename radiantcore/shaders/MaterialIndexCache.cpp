@@ -0,0 +1,292 @@
+#include "MaterialIndexCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include "ifilesystem.h"
+#include "itextstream.h"
+#include "os/fs.h"
+#include "os/file.h"
+#include "os/path.h"
+
+namespace shaders
+{
+
+// Version 1: initial format
+const std::uint32_t MaterialIndexCache::Version = 1;
+
+namespace
+{
+	const char Magic[8] = { 'D', 'R', 'M', 'T', 'R', 'I', 'D', 'X' };
+	const std::uint32_t ByteOrderMark = 0x01020304;
+
+	// The file is a sequence of native-endian numbers and length-prefixed strings:
+	// magic, byte order mark, version, number of files, followed by the files.
+	class Writer
+	{
+	private:
+		std::ofstream& _stream;
+
+	public:
+		Writer(std::ofstream& stream) :
+			_stream(stream)
+		{}
+
+		template<typename T>
+		void write(T value)
+		{
+			_stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		void write(const std::string& str)
+		{
+			write(static_cast<std::uint32_t>(str.size()));
+			_stream.write(str.data(), str.size());
+		}
+	};
+
+	class Reader
+	{
+	private:
+		const std::string& _data;
+		std::size_t _pos;
+
+	public:
+		Reader(const std::string& data) :
+			_data(data),
+			_pos(0)
+		{}
+
+		template<typename T>
+		T read()
+		{
+			T value;
+			readBytes(&value, sizeof(T));
+			return value;
+		}
+
+		std::string readString()
+		{
+			auto length = read<std::uint32_t>();
+
+			if (length > _data.size() - _pos)
+			{
+				throw std::runtime_error("String exceeds the file");
+			}
+
+			_pos += length;
+			return _data.substr(_pos - length, length);
+		}
+
+		void readBytes(void* target, std::size_t count)
+		{
+			if (count > _data.size() - _pos)
+			{
+				throw std::runtime_error("Unexpected end of file");
+			}
+
+			std::memcpy(target, _data.data() + _pos, count);
+			_pos += count;
+		}
+
+		bool isAtEnd() const
+		{
+			return _pos == _data.size();
+		}
+	};
+}
+
+MaterialIndexCache::MaterialIndexCache(const std::string& path) :
+	_path(path),
+	_changed(false)
+{
+	loadFile();
+}
+
+void MaterialIndexCache::loadFile()
+{
+	if (!os::fileOrDirExists(_path))
+	{
+		return;
+	}
+
+	std::ifstream stream(_path, std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+	try
+	{
+		Reader reader(data);
+
+		char magic[sizeof(Magic)];
+		reader.readBytes(magic, sizeof(magic));
+
+		if (std::memcmp(magic, Magic, sizeof(Magic)) != 0 ||
+			reader.read<std::uint32_t>() != ByteOrderMark || reader.read<std::uint32_t>() != Version)
+		{
+			rMessage() << "[shaders] Material index " << _path << " is outdated, ignoring it." << std::endl;
+			return;
+		}
+
+		auto numFiles = reader.read<std::uint32_t>();
+
+		for (std::uint32_t f = 0; f < numFiles; ++f)
+		{
+			auto file = reader.readString();
+
+			auto& record = _records[file];
+			record.key.archivePath = reader.readString();
+			record.key.size = reader.read<std::uint64_t>();
+			record.key.timestamp = reader.read<std::int64_t>();
+
+			auto numEntries = reader.read<std::uint32_t>();
+
+			for (std::uint32_t e = 0; e < numEntries; ++e)
+			{
+				Entry entry;
+				entry.isTable = reader.read<std::uint8_t>() != 0;
+				entry.name = reader.readString();
+				entry.offset = reader.read<std::uint32_t>();
+				entry.length = reader.read<std::uint32_t>();
+				entry.contents = reader.readString();
+				entry.header.editorImage = reader.readString();
+				entry.header.description = reader.readString();
+
+				record.entries.emplace_back(std::move(entry));
+			}
+		}
+
+		if (!reader.isAtEnd())
+		{
+			throw std::runtime_error("Trailing data");
+		}
+	}
+	catch (const std::runtime_error& ex)
+	{
+		rWarning() << "[shaders] Material index " << _path << " is damaged, ignoring it: " << ex.what() << std::endl;
+		_records.clear();
+	}
+}
+
+bool MaterialIndexCache::getEntries(const std::string& file, const FileKey& key, Entries& entries) const
+{
+	auto found = _records.find(file);
+
+	if (found == _records.end() || !key.isValid() || !(found->second.key == key))
+	{
+		return false;
+	}
+
+	entries = found->second.entries;
+	return true;
+}
+
+void MaterialIndexCache::markUsed(const std::string& file)
+{
+	_usedFiles.insert(file);
+}
+
+void MaterialIndexCache::storeEntries(const std::string& file, const FileKey& key, const Entries& entries)
+{
+	if (!key.isValid())
+	{
+		return;
+	}
+
+	auto& record = _records[file];
+	record.key = key;
+	record.entries = entries;
+
+	_usedFiles.insert(file);
+	_changed = true;
+}
+
+void MaterialIndexCache::save()
+{
+	// Drop the files which are gone or have not been loaded
+	for (auto i = _records.begin(); i != _records.end();)
+	{
+		if (_usedFiles.count(i->first) == 0)
+		{
+			_records.erase(i++);
+			_changed = true;
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	if (!_changed)
+	{
+		return;
+	}
+
+	fs::path cachePath = _path;
+	fs::path tempPath = _path + ".tmp";
+
+	try
+	{
+		fs::create_directories(cachePath.parent_path());
+
+		std::ofstream stream(tempPath.string(), std::ios::binary);
+
+		if (!stream.is_open())
+		{
+			throw std::runtime_error("Could not open file for writing");
+		}
+
+		Writer writer(stream);
+
+		stream.write(Magic, sizeof(Magic));
+		writer.write(ByteOrderMark);
+		writer.write(Version);
+		writer.write(static_cast<std::uint32_t>(_records.size()));
+
+		for (const auto& pair : _records)
+		{
+			writer.write(pair.first);
+			writer.write(pair.second.key.archivePath);
+			writer.write(pair.second.key.size);
+			writer.write(pair.second.key.timestamp);
+			writer.write(static_cast<std::uint32_t>(pair.second.entries.size()));
+
+			for (const auto& entry : pair.second.entries)
+			{
+				writer.write(static_cast<std::uint8_t>(entry.isTable ? 1 : 0));
+				writer.write(entry.name);
+				writer.write(entry.offset);
+				writer.write(entry.length);
+				writer.write(entry.contents);
+				writer.write(entry.header.editorImage);
+				writer.write(entry.header.description);
+			}
+		}
+
+		stream.close();
+
+		if (stream.fail())
+		{
+			throw std::runtime_error("Failure writing to file");
+		}
+
+		// Replace the old index only after the new one has been written completely
+		fs::rename(tempPath, cachePath);
+
+		_changed = false;
+
+		rMessage() << "[shaders] Wrote material index of " << _records.size() << " files to " << _path << std::endl;
+	}
+	catch (const std::exception& ex)
+	{
+		rWarning() << "[shaders] Failed to write material index " << _path << ": " << ex.what() << std::endl;
+
+		// Don't leave any partially written files behind
+		std::remove(tempPath.string().c_str());
+	}
+}
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ShaderTemplate.h"
+#include "os/filekey.h"
+
+namespace shaders
+{
+
+/**
+ * On-disk index of the material files, which saves the shader system from
+ * reading and splitting up all .mtr files on startup.
+ *
+ * For each material file the index stores the names and locations of its
+ * declarations, along with the ShaderTemplate headers needed to list the
+ * materials. The (usually few) table declarations are stored with their text.
+ * A file's index is tagged with the size and modification time of the file
+ * or its containing PK4, outdated entries are not returned.
+ */
+class MaterialIndexCache
+{
+public:
+	static const std::uint32_t Version;
+
+	struct Entry
+	{
+		bool isTable = false;
+		std::string name;
+
+		// Location of the block contents in the material file
+		std::uint32_t offset = 0;
+		std::uint32_t length = 0;
+
+		// The text of table declarations, or of materials whose location
+		// could not be determined, empty otherwise
+		std::string contents;
+
+		ShaderTemplate::Header header;
+	};
+	typedef std::vector<Entry> Entries;
+
+	// What a file's index is valid for
+	typedef os::FileKey FileKey;
+
+private:
+	std::string _path;
+
+	struct Record
+	{
+		FileKey key;
+		Entries entries;
+	};
+	std::map<std::string, Record> _records;
+
+	// Files requested or stored during this session, the others are dropped on save
+	std::set<std::string> _usedFiles;
+	bool _changed;
+
+public:
+	// Loads the index from the given file, a missing or invalid file results in an empty index
+	MaterialIndexCache(const std::string& path);
+
+	// Retrieves the index of the given material file (VFS path), returns false if there's
+	// none or it doesn't match the given key. Can be called from any thread, as long as
+	// no other thread is storing.
+	bool getEntries(const std::string& file, const FileKey& key, Entries& entries) const;
+
+	// Keeps the index of the given file in the cache
+	void markUsed(const std::string& file);
+
+	void storeEntries(const std::string& file, const FileKey& key, const Entries& entries);
+
+	// Rewrites the cache file if entries have been stored or some have not been used
+	void save();
+
+private:
+	void loadFile();
+};
+
+}
@@ -0,0 +1,113 @@
+#include "MaterialSourceFiles.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "iarchive.h"
+#include "ifilesystem.h"
+#include "itextstream.h"
+#include "parser/DefBlockTokeniser.h"
+#include "stream/utils.h"
+#include "string/replace.h"
+
+namespace shaders
+{
+
+namespace
+{
+	// The number of material files kept in memory
+	const std::size_t MAX_CACHED_FILES = 4;
+
+	typedef std::shared_ptr<const std::string> FileContentsPtr;
+
+	std::mutex _lock;
+
+	// Most recently used file first
+	std::list<std::pair<std::string, FileContentsPtr>> _files;
+
+	FileContentsPtr getFileContents(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		for (auto i = _files.begin(); i != _files.end(); ++i)
+		{
+			if (i->first == path)
+			{
+				_files.splice(_files.begin(), _files, i);
+				return i->second;
+			}
+		}
+
+		auto file = GlobalFileSystem().openTextFile(path);
+
+		if (!file)
+		{
+			return FileContentsPtr();
+		}
+
+		auto contents = std::make_shared<const std::string>(stream::readAll(file->getInputStream()));
+
+		_files.emplace_front(path, contents);
+
+		if (_files.size() > MAX_CACHED_FILES)
+		{
+			_files.pop_back();
+		}
+
+		return contents;
+	}
+
+	// Searches the whole file for the named block, like the ShaderFileLoader does
+	std::string findBlock(const std::string& contents, const std::string& materialName)
+	{
+		parser::BasicDefBlockTokeniser<std::string> tokeniser(contents);
+
+		while (tokeniser.hasMoreBlocks())
+		{
+			auto block = tokeniser.nextBlock();
+			string::replace_all(block.name, "\\", "/");
+
+			if (block.name == materialName)
+			{
+				return block.contents;
+			}
+		}
+
+		return std::string();
+	}
+}
+
+std::string MaterialSourceFiles::LoadBlock(const MaterialBlockLocation& location, const std::string& materialName)
+{
+	auto contents = getFileContents(location.file);
+
+	if (!contents)
+	{
+		rWarning() << "[shaders] Unable to read " << location.file << " to get material " << materialName << std::endl;
+		return std::string();
+	}
+
+	std::size_t begin = location.offset;
+	std::size_t end = begin + location.length;
+
+	// The block needs to be enclosed in braces, unless it's at the end of an unterminated file
+	if (begin > 0 && end <= contents->size() && (*contents)[begin - 1] == '{' &&
+		(end == contents->size() || (*contents)[end] == '}'))
+	{
+		return contents->substr(begin, location.length);
+	}
+
+	rMessage() << "[shaders] " << location.file << " has been changed, searching it for material " << materialName << std::endl;
+
+	return findBlock(*contents, materialName);
+}
+
+void MaterialSourceFiles::Clear()
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	_files.clear();
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace shaders
+{
+
+// Position of a material block's contents (excluding the braces) in its .mtr file
+struct MaterialBlockLocation
+{
+	// VFS path of the material file
+	std::string file;
+
+	std::uint32_t offset = 0;
+	std::uint32_t length = 0;
+};
+
+/**
+ * Loads the contents of material blocks on demand, which lets the ShaderTemplates
+ * hold their location instead of a copy of their declaration text.
+ *
+ * Materials of the same file tend to be realised together, so the contents
+ * of the most recently used files are kept around for a while.
+ */
+class MaterialSourceFiles
+{
+public:
+	// Returns the block at the given location. If the file has been changed
+	// since the location has been determined, the file is searched for the
+	// named block instead. Returns an empty string if the block is gone.
+	static std::string LoadBlock(const MaterialBlockLocation& location, const std::string& materialName);
+
+	// Releases the cached file contents
+	static void Clear();
+};
+
+}
@@ -4,6 +4,7 @@
 #include "irender.h"
 #include "parser/DefTokeniser.h"
 #include "TableDefinition.h"
+#include "ShaderExpressionProgram.h"
 
 namespace shaders
 {
@@ -64,6 +65,16 @@ public:
 		return _index;
 	}
 
+	// The register index this expression has been linked to, -1 if it's not linked
+	int getLinkedRegister() const
+	{
+		return _index;
+	}
+
+	// Emits the instructions evaluating this expression into the given program,
+	// returning the register holding the result
+	virtual ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) = 0;
+
 	static IShaderExpressionPtr createFromString(const std::string& exprStr);
 
 	static IShaderExpressionPtr createFromTokens(parser::DefTokeniser& tokeniser);
@@ -97,6 +108,11 @@ public:
 	{
 		return entity.getShaderParm(_parmNum);
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.shaderParm(_parmNum);
+	}
 };
 
 class GlobalShaderParmExpression :
@@ -121,6 +137,11 @@ public:
 	{
 		return getValue(time);
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.constant(getValue(0));
+	}
 };
 
 // An expression returning the current (game) time as result
@@ -141,6 +162,11 @@ public:
 	{
 		return getValue(time);
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.time();
+	}
 };
 
 // An expression representing a constant floating point number
@@ -165,6 +191,11 @@ public:
 	{
 		return getValue(time);
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.constant(_value);
+	}
 };
 
 // An expression looking up a value in a table def
@@ -198,6 +229,11 @@ public:
 		float lookupVal = _lookupExpr->getValue(time, entity);
 		return _tableDef->getValue(lookupVal);
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.tableLookup(_tableDef, program.compile(_lookupExpr));
+	}
 };
 
 // Abstract base class for an expression taking two sub-expression as arguments
@@ -271,6 +307,11 @@ public:
 	{
 		return _a->getValue(time, entity) + _b->getValue(time, entity);
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::Add, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression subtracting the value of two expressions
@@ -292,6 +333,11 @@ public:
 	{
 		return _a->getValue(time, entity) - _b->getValue(time, entity);
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::Subtract, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression multiplying the value of two expressions
@@ -313,6 +359,11 @@ public:
 	{
 		return _a->getValue(time, entity) * _b->getValue(time, entity);
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::Multiply, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression dividing the value of two expressions
@@ -334,6 +385,11 @@ public:
 	{
 		return _a->getValue(time, entity) / _b->getValue(time, entity);
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::Divide, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression returning modulo of A % B
@@ -355,6 +411,11 @@ public:
 	{
 		return fmod(_a->getValue(time, entity), _b->getValue(time, entity));
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::Modulo, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression returning 1 if A < B, otherwise 0
@@ -376,6 +437,11 @@ public:
 	{
 		return _a->getValue(time, entity) < _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::Less, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression returning 1 if A <= B, otherwise 0
@@ -397,6 +463,11 @@ public:
 	{
 		return _a->getValue(time, entity) <= _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::LessOrEqual, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression returning 1 if A > B, otherwise 0
@@ -418,6 +489,11 @@ public:
 	{
 		return _a->getValue(time, entity) > _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::Greater, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression returning 1 if A >= B, otherwise 0
@@ -439,6 +515,11 @@ public:
 	{
 		return _a->getValue(time, entity) >= _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::GreaterOrEqual, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression returning 1 if A == B, otherwise 0
@@ -460,6 +541,11 @@ public:
 	{
 		return _a->getValue(time, entity) == _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::Equal, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression returning 1 if A != B, otherwise 0
@@ -481,6 +567,11 @@ public:
 	{
 		return _a->getValue(time, entity) != _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::NotEqual, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression returning 1 if both A and B are true (non-zero), otherwise 0
@@ -502,6 +593,11 @@ public:
 	{
 		return (_a->getValue(time, entity) != 0 && _b->getValue(time, entity) != 0) ? 1.0f : 0;
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::And, program.compile(_a), program.compile(_b));
+	}
 };
 
 // An expression returning 1 if either A or B are true (non-zero), otherwise 0
@@ -523,6 +619,11 @@ public:
 	{
 		return (_a->getValue(time, entity) != 0 || _b->getValue(time, entity) != 0) ? 1.0f : 0;
 	}
+
+	ShaderExpressionProgram::Operand compile(ShaderExpressionProgram& program) override
+	{
+		return program.binary(ShaderExpressionProgram::OpCode::Or, program.compile(_a), program.compile(_b));
+	}
 };
 
 } // namespace
@@ -0,0 +1,213 @@
+#include "ShaderExpressionProgram.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "irender.h"
+#include "ShaderExpression.h"
+
+namespace shaders
+{
+
+namespace
+{
+	// Thrown when an expression can't be compiled
+	class CompileError :
+		public std::runtime_error
+	{
+	public:
+		CompileError(const std::string& message) :
+			std::runtime_error(message)
+		{}
+	};
+}
+
+ShaderExpressionProgram::ShaderExpressionProgram() :
+	_timeRegister(-1),
+	_numExpressions(0)
+{}
+
+void ShaderExpressionProgram::clear()
+{
+	*this = ShaderExpressionProgram();
+}
+
+bool ShaderExpressionProgram::addExpression(const IShaderExpressionPtr& expression)
+{
+	auto shaderExpression = std::dynamic_pointer_cast<ShaderExpression>(expression);
+
+	if (!shaderExpression || shaderExpression->getLinkedRegister() < 0)
+	{
+		return false;
+	}
+
+	// Keep the current state to revert to if the expression fails to compile
+	ShaderExpressionProgram previous(*this);
+
+	try
+	{
+		auto result = compile(expression);
+
+		_outputs.push_back(Output{ result.index, static_cast<std::size_t>(shaderExpression->getLinkedRegister()) });
+		++_numExpressions;
+
+		return true;
+	}
+	catch (const CompileError&)
+	{
+		*this = std::move(previous);
+		return false;
+	}
+}
+
+void ShaderExpressionProgram::evaluate(std::size_t time, Registers& registers)
+{
+	// parmNN is 0 without entity
+	run(time, [](int) { return 0.0f; }, registers);
+}
+
+void ShaderExpressionProgram::evaluate(std::size_t time, const IRenderEntity& entity, Registers& registers)
+{
+	run(time, [&](int parmNum) { return entity.getShaderParm(parmNum); }, registers);
+}
+
+template<typename GetShaderParm>
+void ShaderExpressionProgram::run(std::size_t time, const GetShaderParm& getShaderParm, Registers& registers)
+{
+	float* r = _registers.data();
+
+	for (const auto& i : _instructions)
+	{
+		switch (i.op)
+		{
+		case OpCode::Time:
+			r[i.dest] = time / 1000.0f; // convert msecs to secs
+			break;
+		case OpCode::ShaderParm:
+			r[i.dest] = getShaderParm(i.a);
+			break;
+		case OpCode::TableLookup:
+			r[i.dest] = _tables[i.b]->getValue(r[i.a]);
+			break;
+		default:
+			r[i.dest] = Apply(i.op, r[i.a], r[i.b]);
+			break;
+		}
+	}
+
+	for (const auto& output : _outputs)
+	{
+		registers[output.target] = r[output.source];
+	}
+}
+
+ShaderExpressionProgram::Operand ShaderExpressionProgram::compile(const IShaderExpressionPtr& expression)
+{
+	auto shaderExpression = std::dynamic_pointer_cast<ShaderExpression>(expression);
+
+	if (!shaderExpression)
+	{
+		throw CompileError("Unknown expression type");
+	}
+
+	return shaderExpression->compile(*this);
+}
+
+ShaderExpressionProgram::Operand ShaderExpressionProgram::constant(float value)
+{
+	std::uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	auto found = _constants.find(bits);
+
+	if (found != _constants.end())
+	{
+		return Operand{ found->second, true };
+	}
+
+	auto index = allocateRegister(value);
+	_constants.emplace(bits, index);
+
+	return Operand{ index, true };
+}
+
+ShaderExpressionProgram::Operand ShaderExpressionProgram::time()
+{
+	if (_timeRegister < 0)
+	{
+		_timeRegister = emit(OpCode::Time, 0, 0).index;
+	}
+
+	return Operand{ static_cast<RegisterIndex>(_timeRegister), false };
+}
+
+ShaderExpressionProgram::Operand ShaderExpressionProgram::shaderParm(int parmNum)
+{
+	auto found = _shaderParms.find(parmNum);
+
+	if (found != _shaderParms.end())
+	{
+		return Operand{ found->second, false };
+	}
+
+	auto result = emit(OpCode::ShaderParm, static_cast<RegisterIndex>(parmNum), 0);
+	_shaderParms.emplace(parmNum, result.index);
+
+	return result;
+}
+
+ShaderExpressionProgram::Operand ShaderExpressionProgram::binary(OpCode op, const Operand& a, const Operand& b)
+{
+	if (a.isConstant && b.isConstant)
+	{
+		return constant(Apply(op, _registers[a.index], _registers[b.index]));
+	}
+
+	return emit(op, a.index, b.index);
+}
+
+ShaderExpressionProgram::Operand ShaderExpressionProgram::tableLookup(const TableDefinitionPtr& table, const Operand& lookup)
+{
+	if (lookup.isConstant)
+	{
+		return constant(table->getValue(_registers[lookup.index]));
+	}
+
+	std::size_t tableIndex = 0;
+
+	while (tableIndex < _tables.size() && _tables[tableIndex] != table)
+	{
+		++tableIndex;
+	}
+
+	if (tableIndex == _tables.size())
+	{
+		_tables.push_back(table);
+	}
+
+	return emit(OpCode::TableLookup, lookup.index, static_cast<RegisterIndex>(tableIndex));
+}
+
+ShaderExpressionProgram::RegisterIndex ShaderExpressionProgram::allocateRegister(float value)
+{
+	if (_registers.size() > std::numeric_limits<RegisterIndex>::max())
+	{
+		throw CompileError("Too many registers");
+	}
+
+	_registers.push_back(value);
+
+	return static_cast<RegisterIndex>(_registers.size() - 1);
+}
+
+ShaderExpressionProgram::Operand ShaderExpressionProgram::emit(OpCode op, RegisterIndex a, RegisterIndex b)
+{
+	auto dest = allocateRegister(0);
+
+	_instructions.push_back(Instruction{ op, dest, a, b });
+
+	return Operand{ dest, false };
+}
+
+}
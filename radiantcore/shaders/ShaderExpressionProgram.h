@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "ishaderexpression.h"
+#include "TableDefinition.h"
+
+class IRenderEntity;
+
+namespace shaders
+{
+
+/**
+ * A set of shader expressions compiled into a flat list of register
+ * instructions, evaluated in a single loop without any virtual calls.
+ *
+ * Each expression tree is translated by its nodes (see ShaderExpression::compile),
+ * which emit their instructions after the ones of their operands. Subexpressions
+ * not depending on time or shaderparms are folded into constants while compiling,
+ * time and each shaderparm are loaded only once per evaluation.
+ *
+ * The register file of the program is private, the result of each expression
+ * is copied into the register it has been linked to when evaluating.
+ */
+class ShaderExpressionProgram
+{
+public:
+	enum class OpCode : std::uint8_t
+	{
+		Time,				// dest = time in seconds
+		ShaderParm,			// dest = entity shaderparm a (0 without entity)
+		Add,				// dest = a + b
+		Subtract,			// dest = a - b
+		Multiply,			// dest = a * b
+		Divide,				// dest = a / b
+		Modulo,				// dest = fmod(a, b)
+		Less,				// dest = a < b ? 1 : 0
+		LessOrEqual,		// dest = a <= b ? 1 : 0
+		Greater,			// dest = a > b ? 1 : 0
+		GreaterOrEqual,		// dest = a >= b ? 1 : 0
+		Equal,				// dest = a == b ? 1 : 0
+		NotEqual,			// dest = a != b ? 1 : 0
+		And,				// dest = a != 0 && b != 0 ? 1 : 0
+		Or,					// dest = a != 0 || b != 0 ? 1 : 0
+		TableLookup,		// dest = table b [a]
+	};
+
+	typedef std::uint16_t RegisterIndex;
+
+	struct Instruction
+	{
+		OpCode op;
+		RegisterIndex dest;
+		RegisterIndex a;
+		RegisterIndex b;
+	};
+
+	// The register holding the result of a compiled (sub)expression
+	struct Operand
+	{
+		RegisterIndex index;
+
+		// True if the value is known at compile time
+		bool isConstant;
+	};
+
+private:
+	std::vector<Instruction> _instructions;
+
+	// The constants and the results of the instructions
+	std::vector<float> _registers;
+
+	std::vector<TableDefinitionPtr> _tables;
+
+	// Copies the result of an expression into its linked register
+	struct Output
+	{
+		RegisterIndex source;
+		std::size_t target;
+	};
+	std::vector<Output> _outputs;
+
+	// Registers already holding a constant (by bit pattern), time or shaderparm
+	std::map<std::uint32_t, RegisterIndex> _constants;
+	std::map<int, RegisterIndex> _shaderParms;
+	int _timeRegister;
+
+	std::size_t _numExpressions;
+
+public:
+	ShaderExpressionProgram();
+
+	// Removes all expressions
+	void clear();
+
+	/**
+	 * Compiles the given expression, its result will be written to the
+	 * register the expression has been linked to. Returns false if the
+	 * expression can't be compiled, the program is unchanged in this case.
+	 */
+	bool addExpression(const IShaderExpressionPtr& expression);
+
+	// The number of expressions added to this program
+	std::size_t getNumExpressions() const
+	{
+		return _numExpressions;
+	}
+
+	std::size_t getNumInstructions() const
+	{
+		return _instructions.size();
+	}
+
+	// True if any of the compiled expressions loads an entity shaderparm
+	bool usesShaderParms() const
+	{
+		return !_shaderParms.empty();
+	}
+
+	// Evaluates all expressions and writes the results to the given registers
+	void evaluate(std::size_t time, Registers& registers);
+	void evaluate(std::size_t time, const IRenderEntity& entity, Registers& registers);
+
+	// Methods used by the expressions to compile themselves
+	Operand compile(const IShaderExpressionPtr& expression);
+	Operand constant(float value);
+	Operand time();
+	Operand shaderParm(int parmNum);
+	Operand binary(OpCode op, const Operand& a, const Operand& b);
+	Operand tableLookup(const TableDefinitionPtr& table, const Operand& lookup);
+
+	// Applies the given binary operator, used by the interpreter and for constant folding
+	static float Apply(OpCode op, float a, float b)
+	{
+		switch (op)
+		{
+		case OpCode::Add: return a + b;
+		case OpCode::Subtract: return a - b;
+		case OpCode::Multiply: return a * b;
+		case OpCode::Divide: return a / b;
+		case OpCode::Modulo: return std::fmod(a, b);
+		case OpCode::Less: return a < b ? 1.0f : 0;
+		case OpCode::LessOrEqual: return a <= b ? 1.0f : 0;
+		case OpCode::Greater: return a > b ? 1.0f : 0;
+		case OpCode::GreaterOrEqual: return a >= b ? 1.0f : 0;
+		case OpCode::Equal: return a == b ? 1.0f : 0;
+		case OpCode::NotEqual: return a != b ? 1.0f : 0;
+		case OpCode::And: return (a != 0 && b != 0) ? 1.0f : 0;
+		case OpCode::Or: return (a != 0 || b != 0) ? 1.0f : 0;
+		default: return 0;
+		}
+	}
+
+private:
+	RegisterIndex allocateRegister(float value);
+	Operand emit(OpCode op, RegisterIndex a, RegisterIndex b);
+
+	template<typename GetShaderParm>
+	void run(std::size_t time, const GetShaderParm& getShaderParm, Registers& registers);
+};
+
+}
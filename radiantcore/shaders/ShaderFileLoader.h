@@ -8,8 +8,11 @@
 #include "TableDefinition.h"
 #include "ShaderTemplate.h"
 #include "ShaderDefinition.h"
+#include "MaterialIndexCache.h"
 
 #include "parser/DefBlockTokeniser.h"
+#include "ParallelDefFileLoader.h"
+#include "stream/utils.h"
 #include "string/replace.h"
 #include "string/predicate.h"
 
@@ -17,6 +20,10 @@ namespace shaders
 {
 
 // VFS functor class which loads material (mtr) files.
+// The files are parsed on the shared declaration workers, the
+// definitions are added to the library in file order afterwards.
+// Only the location of each material is recorded, its text is
+// loaded from the file when the material is actually needed.
 template<typename ShaderLibrary_T> class ShaderFileLoader
 {
     // The VFS module to provide shader files
@@ -24,16 +31,30 @@ template<typename ShaderLibrary_T> class ShaderFileLoader
 
     ShaderLibrary_T& _library;
 
+    // Optional index of the material files, saving the effort of splitting them up
+    MaterialIndexCache* _indexCache;
+
+    // The declarations found in a single file, in order of appearance
+    struct ParsedFile
+    {
+        MaterialIndexCache::FileKey key;
+        MaterialIndexCache::Entries entries;
+
+        // Whether the entries have been taken from the index
+        bool fromCache = false;
+    };
+
     // List of shader definition files to parse
-    std::vector<vfs::FileInfo> _files;
+    util::ParallelDefFileLoader<ParsedFile> _loader;
 
 private:
 
-    bool parseTable(const parser::BlockTokeniser::Block& block, const vfs::FileInfo& fileInfo)
+    // Returns the table name if the given block is a table decl, an empty string otherwise
+    static std::string getTableName(const parser::BlockTokeniser::Block& block)
     {
         if (block.name.length() <= 5 || !string::starts_with(block.name, "table"))
         {
-            return false; // definitely not a table decl
+            return std::string(); // definitely not a table decl
         }
 
         // Look closer by trying to split up the table name from the decl
@@ -43,44 +64,73 @@ private:
 
         if (std::regex_match(block.name, matches, expr))
         {
-            auto tableName = matches[1].str();
+            return matches[1].str();
+        }
+
+        return std::string();
+    }
 
-            auto table = std::make_shared<TableDefinition>(tableName, block.contents);
+    // Determines the offset of the block contents, given the position following the block.
+    // Returns false if the contents can't be located, e.g. due to an unterminated file.
+    static bool locateBlock(const std::string& contents, std::size_t blockEnd,
+        const parser::BlockTokeniser::Block& block, std::uint32_t& offset)
+    {
+        std::size_t length = block.contents.length();
 
-            if (!_library.addTableDefinition(table))
+        // The closing brace is not part of the contents, unless the file ended early
+        for (std::size_t end : { blockEnd - 1, blockEnd })
+        {
+            if (end < length + 1 || end > contents.length())
             {
-                rError() << "[shaders] " << fileInfo.name << ": table " << tableName << " already defined." << std::endl;
+                continue;
             }
 
-            return true;
+            std::size_t start = end - length;
+
+            if (contents[start - 1] == '{' && contents.compare(start, length, block.contents) == 0)
+            {
+                offset = static_cast<std::uint32_t>(start);
+                return true;
+            }
         }
 
         return false;
     }
 
-    // Parse a shader file with the given contents and filename
-    void parseShaderFile(std::istream& inStr, const vfs::FileInfo& fileInfo)
+    // Parse a shader file with the given contents, this is called on the worker threads
+    static MaterialIndexCache::Entries parseShaderFile(const std::string& contents)
     {
-        // Parse the file with a blocktokeniser, the actual block contents
-        // will be parsed separately.
-        parser::BasicDefBlockTokeniser<std::istream> tokeniser(inStr);
+        MaterialIndexCache::Entries result;
 
-        while (tokeniser.hasMoreBlocks())
+        // Split the file up into blocks, the actual block contents
+        // will be parsed when the material is realised.
+        parser::DefBlockTokeniserFunc tokeniser(" \t\n\v\r", '{', '}');
+        parser::BlockTokeniser::Block block;
+
+        auto next = contents.cbegin();
+
+        while (next != contents.cend() && tokeniser(next, contents.cend(), block))
         {
-            // Get the next block
-            parser::BlockTokeniser::Block block = tokeniser.nextBlock();
+            MaterialIndexCache::Entry entry;
 
             // Try to parse tables
-            if (parseTable(block, fileInfo))
+            auto tableName = getTableName(block);
+
+            if (!tableName.empty())
             {
+                entry.isTable = true;
+                entry.name = tableName;
+                entry.contents = block.contents;
+
+                result.emplace_back(std::move(entry));
                 continue; // table successfully parsed
             }
-            
+
             if (block.name.substr(0, 5) == "skin ")
             {
                 continue; // skip skin definition
             }
-            
+
             if (block.name.substr(0, 9) == "particle ")
             {
                 continue; // skip particle definition
@@ -88,54 +138,136 @@ private:
 
             string::replace_all(block.name, "\\", "/"); // use forward slashes
 
-            auto shaderTemplate = std::make_shared<ShaderTemplate>(block.name, block.contents);
+            entry.name = block.name;
+            entry.header = ShaderTemplate::ParseHeader(block.contents);
+
+            // Keep the text if the material can't be loaded from its location later on
+            if (locateBlock(contents, next - contents.cbegin(), block, entry.offset))
+            {
+                entry.length = static_cast<std::uint32_t>(block.contents.length());
+            }
+            else
+            {
+                entry.contents = block.contents;
+            }
+
+            result.emplace_back(std::move(entry));
+        }
+
+        return result;
+    }
+
+    // Adds the parsed definitions of a file to the library, first definition wins
+    void addDefinitions(const vfs::FileInfo& fileInfo, const ParsedFile& parsed)
+    {
+        for (const auto& entry : parsed.entries)
+        {
+            if (entry.isTable)
+            {
+                auto table = std::make_shared<TableDefinition>(entry.name, entry.contents);
+
+                if (!_library.addTableDefinition(table))
+                {
+                    rError() << "[shaders] " << fileInfo.name << ": table " << entry.name << " already defined." << std::endl;
+                }
+
+                continue;
+            }
+
+            ShaderTemplatePtr shaderTemplate;
+
+            if (entry.length > 0 || entry.contents.empty())
+            {
+                MaterialBlockLocation location;
+                location.file = fileInfo.fullPath();
+                location.offset = entry.offset;
+                location.length = entry.length;
+
+                shaderTemplate = std::make_shared<ShaderTemplate>(entry.name, location, entry.header);
+            }
+            else
+            {
+                shaderTemplate = std::make_shared<ShaderTemplate>(entry.name, entry.contents);
+            }
 
             // Construct the ShaderDefinition wrapper class
             ShaderDefinition def(shaderTemplate, fileInfo);
 
             // Insert into the definitions map, if not already present
-            if (!_library.addDefinition(block.name, def))
+            if (!_library.addDefinition(entry.name, def))
             {
-                rError() << "[shaders] " << fileInfo.name << ": shader " << block.name << " already defined." << std::endl;
+                rError() << "[shaders] " << fileInfo.name << ": shader " << entry.name << " already defined." << std::endl;
             }
         }
+
+        if (!_indexCache || !parsed.key.isValid())
+        {
+            return;
+        }
+
+        if (parsed.fromCache)
+        {
+            _indexCache->markUsed(fileInfo.fullPath());
+        }
+        else
+        {
+            _indexCache->storeEntries(fileInfo.fullPath(), parsed.key, parsed.entries);
+        }
     }
 
 public:
 
-    /// Construct and initialise the ShaderFileLoader
+    /// Construct and initialise the ShaderFileLoader, the index cache is optional
     ShaderFileLoader(vfs::VirtualFileSystem& fs, ShaderLibrary_T& library,
                      const std::string& basedir,
-                     const std::string& extension = "mtr")
-    : _vfs(fs), _library(library)
+                     const std::string& extension = "mtr",
+                     MaterialIndexCache* indexCache = nullptr)
+    : _vfs(fs), _library(library), _indexCache(indexCache), _loader("materials")
     {
-        _files.reserve(200);
-
         // Walk the VFS and populate our files list
         _vfs.forEachFile(
             basedir, extension,
-            [this](const vfs::FileInfo& fi) { _files.push_back(fi); },
+            [this](const vfs::FileInfo& fi) { _loader.addFile(fi); },
             0
         );
     }
 
     void parseFiles()
     {
-        for (const vfs::FileInfo& fileInfo: _files)
-        {
-            // Open the file
-            auto file = _vfs.openTextFile(fileInfo.fullPath());
-
-            if (file)
+        _loader.load(
+            [this](const vfs::FileInfo& fileInfo)
             {
-                std::istream is(&(file->getInputStream()));
-                parseShaderFile(is, fileInfo);
-            }
-            else
+                ParsedFile parsed;
+
+                if (_indexCache)
+                {
+                    parsed.key = os::getFileKey(fileInfo);
+                    parsed.fromCache = _indexCache->getEntries(fileInfo.fullPath(), parsed.key, parsed.entries);
+
+                    if (parsed.fromCache)
+                    {
+                        return parsed;
+                    }
+                }
+
+                // Open the file
+                auto file = _vfs.openTextFile(fileInfo.fullPath());
+
+                if (!file)
+                {
+                    throw std::runtime_error("Unable to read shaderfile: " + fileInfo.name);
+                }
+
+                // Load the file contents in one go, the blocks are located by their offset
+                parsed.entries = parseShaderFile(stream::readAll(file->getInputStream()));
+
+                return parsed;
+            },
+            [this](const vfs::FileInfo& fileInfo, ParsedFile& parsed)
             {
-                throw std::runtime_error("Unable to read shaderfile: " + fileInfo.name);
+                addDefinitions(fileInfo, parsed);
             }
-        }
+        );
     }
 };
 
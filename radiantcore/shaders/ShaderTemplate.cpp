@@ -17,14 +17,135 @@
 namespace shaders
 {
 
+namespace
+{
+    // Passes the tokens of another tokeniser through, keeping a quoted copy of them
+    class RecordingTokeniser :
+        public parser::DefTokeniser
+    {
+    private:
+        parser::DefTokeniser& _tokeniser;
+        std::string _recorded;
+
+    public:
+        RecordingTokeniser(parser::DefTokeniser& tokeniser) :
+            _tokeniser(tokeniser)
+        {}
+
+        bool hasMoreTokens() const override
+        {
+            return _tokeniser.hasMoreTokens();
+        }
+
+        std::string nextToken() override
+        {
+            std::string token = _tokeniser.nextToken();
+
+            _recorded += _recorded.empty() ? "\"" : " \"";
+            _recorded += token;
+            _recorded += '"';
+
+            return token;
+        }
+
+        std::string peek() const override
+        {
+            return _tokeniser.peek();
+        }
+
+        const std::string& getRecordedTokens() const
+        {
+            return _recorded;
+        }
+    };
+
+    // The shader declarations are tokenised with the comma as kept delimiter
+    const char* const SHADER_KEPT_DELIMITERS = "{}(),";
+}
+
 NamedBindablePtr ShaderTemplate::getEditorTexture()
 {
     if (!_parsed)
+    {
+        // An explicit editor image can be created without parsing the whole declaration
+        if (_hasHeader && !_header.editorImage.empty())
+        {
+            if (!_editorTex)
+            {
+                parser::BasicDefTokeniser<std::string> tokeniser(
+                    _header.editorImage, parser::WHITESPACE, SHADER_KEPT_DELIMITERS);
+
+                try
+                {
+                    _editorTex = MapExpression::createForToken(tokeniser);
+                }
+                catch (parser::ParseException&)
+                {
+                    parseDefinition();
+                }
+            }
+
+            return _editorTex;
+        }
+
         parseDefinition();
+    }
 
     return _editorTex;
 }
 
+ShaderTemplate::Header ShaderTemplate::ParseHeader(const std::string& blockContents)
+{
+    Header header;
+
+    parser::BasicDefTokeniser<std::string> tokeniser(
+        blockContents, parser::WHITESPACE, SHADER_KEPT_DELIMITERS);
+
+    try
+    {
+        // Only the global level is of interest
+        int level = 1;
+
+        while (tokeniser.hasMoreTokens())
+        {
+            std::string token = tokeniser.nextToken();
+
+            if (token == "}")
+            {
+                --level;
+            }
+            else if (token == "{")
+            {
+                ++level;
+            }
+            else if (level == 1)
+            {
+                string::to_lower(token);
+
+                if (token == "qer_editorimage")
+                {
+                    // Let the map expression consume its tokens and remember them,
+                    // the last editor image wins like in parseDefinition()
+                    RecordingTokeniser recorder(tokeniser);
+                    MapExpression::createForToken(recorder);
+
+                    header.editorImage = recorder.getRecordedTokens();
+                }
+                else if (token == "description")
+                {
+                    header.description = tokeniser.nextToken();
+                }
+            }
+        }
+    }
+    catch (parser::ParseException&)
+    {
+        // The error is reported when the declaration is actually parsed
+    }
+
+    return header;
+}
+
 IShaderExpressionPtr ShaderTemplate::parseSingleExpressionTerm(parser::DefTokeniser& tokeniser)
 {
 	std::string token = tokeniser.nextToken();
@@ -1207,6 +1328,13 @@ void ShaderTemplate::parseDefinition()
             << p.what() << std::endl;
     }
 
+    // The declaration can be loaded again when it's requested, don't keep it around
+    if (_hasLocation)
+    {
+        std::string().swap(_blockContents);
+        _blockContentsLoaded = false;
+    }
+
 	// greebo: It appears that D3 is applying default sort values for material without
 	// an explicitly defined sort value, depending on a couple of things I didn't really investigate
 	// Some blend materials get SORT_MEDIUM applied by default, diffuses get OPAQUE assigned, but lights do not, etc.
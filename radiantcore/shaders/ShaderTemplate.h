@@ -2,6 +2,7 @@
 
 #include "MapExpression.h"
 #include "Doom3ShaderLayer.h"
+#include "MaterialSourceFiles.h"
 
 #include "ishaders.h"
 #include "parser/DefTokeniser.h"
@@ -83,8 +84,28 @@ private:
 	// Whether this material renders opaque, perforated, etc.
 	Material::Coverage _coverage;
 
-	// Raw material declaration
-	std::string _blockContents;
+public:
+	// Information picked from the declaration without parsing it completely,
+	// enough to list the material in the texture browser
+	struct Header
+	{
+		// The tokens of the qer_editorimage map expression, empty if there's none
+		std::string editorImage;
+
+		std::string description;
+	};
+
+private:
+	// Raw material declaration, loaded from the block location on demand
+	// if this template has one, and released again after parsing
+	mutable std::string _blockContents;
+	mutable bool _blockContentsLoaded;
+
+	MaterialBlockLocation _location;
+	bool _hasLocation;
+
+	Header _header;
+	bool _hasHeader;
 
 	// Whether the block has been parsed
 	bool _parsed;
@@ -112,6 +133,9 @@ public:
       _polygonOffset(0.0f),
 	  _coverage(Material::MC_UNDETERMINED),
 	  _blockContents(blockContents),
+	  _blockContentsLoaded(true),
+	  _hasLocation(false),
+	  _hasHeader(false),
 	  _parsed(false)
 	{
 		_decalInfo.stayMilliSeconds = 0;
@@ -136,9 +160,32 @@ public:
 		_name = name;
 	}
 
+	/**
+	 * Construct a ShaderTemplate whose declaration text is loaded from the
+	 * given location when needed. The header answers the queries of the
+	 * texture browser without parsing the declaration.
+	 */
+	ShaderTemplate(const std::string& name, const MaterialBlockLocation& location, const Header& header) :
+		ShaderTemplate(name, std::string())
+	{
+		_blockContentsLoaded = false;
+		_location = location;
+		_hasLocation = true;
+		_header = header;
+		_hasHeader = true;
+	}
+
+	// Extracts the header information from the given declaration text
+	static Header ParseHeader(const std::string& blockContents);
+
 	const std::string& getDescription()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed)
+		{
+			if (_hasHeader) return _header.description;
+			parseDefinition();
+		}
+
 		return description;
 	}
 
@@ -236,10 +283,18 @@ public:
 	void setBlockContents(const std::string& blockContents)
 	{
 		_blockContents = blockContents;
+		_blockContentsLoaded = true;
+		_hasLocation = false;
 	}
 
 	const std::string& getBlockContents() const
 	{
+		if (!_blockContentsLoaded)
+		{
+			_blockContents = MaterialSourceFiles::LoadBlock(_location, _name);
+			_blockContentsLoaded = true;
+		}
+
 		return _blockContents;
 	}
 
@@ -8,14 +8,28 @@
 #include "../MapExpression.h"
 #include "TextureManipulator.h"
 #include "parser/DefTokeniser.h"
+#include "ThreadPool.h"
+
+#include <set>
 
 namespace
 {
     const std::string SHADER_NOT_FOUND = "notex.bmp";
+    const std::string TEXTURE_CACHE_DIRECTORY = "textures/";
+
+    // Rough amount of decoded pixel data prefetched at once, each batch is
+    // uploaded and released before the next one is decoded
+    const std::size_t PREFETCH_BATCH_BYTES = 256 * 1024 * 1024;
 }
 
 namespace shaders {
 
+GLTextureManager::GLTextureManager(sigc::signal<void>& signalTexturesStreamed) :
+    _cache(std::make_shared<TextureCache>(
+        module::GlobalModuleRegistry().getApplicationContext().getCacheDataPath() + TEXTURE_CACHE_DIRECTORY)),
+    _streamer(signalTexturesStreamed, _cache)
+{}
+
 void GLTextureManager::checkBindings()
 {
     // Check the TextureMap for unique pointers and release them
@@ -57,8 +71,26 @@ TexturePtr GLTextureManager::getBinding(NamedBindablePtr bindable)
     }
     else
     {
-        // Create and insert texture object, if it is valid
-        TexturePtr texture = bindable->bindTexture(identifier);
+        TexturePtr texture;
+
+        // Single images can be loaded in the background, cube maps are
+        // still loaded right away
+        auto mapExpression = std::dynamic_pointer_cast<MapExpression>(bindable);
+
+        if (mapExpression && !mapExpression->isCubeMap() && _streamer.isEnabled())
+        {
+            texture = _streamer.createTexture(mapExpression, identifier);
+        }
+        else if (mapExpression && !mapExpression->isCubeMap())
+        {
+            texture = bindMapExpression(*mapExpression, identifier);
+        }
+        else
+        {
+            texture = bindable->bindTexture(identifier);
+        }
+
+        // Insert texture object, if it is valid
         if (texture)
         {
             _textures.insert(TextureMap::value_type(identifier, texture));
@@ -102,6 +134,195 @@ TexturePtr GLTextureManager::getBinding(const std::string& fullPath)
     return _textures[fullPath];
 }
 
+void GLTextureManager::prefetchTextures(const std::vector<MapExpressionPtr>& expressions)
+{
+    // Collect the single images which are not bound yet, once per identifier
+    std::vector<MapExpressionPtr> pending;
+    std::set<std::string> identifiers;
+
+    for (const auto& expression : expressions)
+    {
+        if (!expression || expression->isCubeMap())
+        {
+            continue;
+        }
+
+        auto identifier = expression->getIdentifier();
+
+        if (_textures.count(identifier) == 0 && identifiers.insert(identifier).second)
+        {
+            pending.push_back(expression);
+        }
+    }
+
+    if (_streamer.isEnabled())
+    {
+        // The streamer is loading them in the background anyway
+        for (const auto& expression : pending)
+        {
+            getBinding(expression);
+        }
+
+        return;
+    }
+
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+
+    // The number of images per batch is adjusted to the average size seen so far
+    std::size_t batchLength = util::ThreadPool::GetDefaultNumThreads();
+    std::size_t numPrefetched = 0;
+    std::size_t prefetchedBytes = 0;
+
+    for (auto first = pending.begin(); first != pending.end();)
+    {
+        auto last = first + std::min<std::size_t>(batchLength, pending.end() - first);
+
+        prefetchedBytes += prefetchBatch(std::vector<MapExpressionPtr>(first, last),
+            static_cast<std::size_t>(std::max(maxTextureSize, 0)));
+        numPrefetched += last - first;
+
+        if (prefetchedBytes > 0)
+        {
+            batchLength = std::max<std::size_t>(PREFETCH_BATCH_BYTES * numPrefetched / prefetchedBytes, 1);
+        }
+
+        first = last;
+    }
+}
+
+std::size_t GLTextureManager::prefetchBatch(const std::vector<MapExpressionPtr>& pending, std::size_t maxTextureSize)
+{
+    std::vector<ImagePtr> images(pending.size());
+    std::vector<TextureCache::Key> keys(pending.size());
+    bool useCache = _cache->isEnabled();
+
+    if (useCache)
+    {
+        bool compress = _cache->useCompression();
+
+        util::ThreadPool::GetShared().parallelFor(pending.size(), [&](std::size_t i)
+        {
+            keys[i] = _cache->getKey(*pending[i], compress);
+            images[i] = _cache->load(keys[i]);
+        });
+    }
+
+    // Plain image files are decoded in one batch, the other expressions are evaluated one by one
+    std::vector<bool> fromCache(pending.size());
+    std::vector<std::string> imageNames;
+    std::vector<std::size_t> imageIndices;
+    std::vector<std::size_t> expressionIndices;
+
+    for (std::size_t i = 0; i < pending.size(); ++i)
+    {
+        fromCache[i] = images[i] != nullptr;
+
+        if (fromCache[i])
+        {
+            continue;
+        }
+
+        std::set<std::string> names;
+        pending[i]->collectImageNames(names);
+
+        if (dynamic_cast<const ImageExpression*>(pending[i].get()) != nullptr && names.size() == 1)
+        {
+            imageNames.push_back(*names.begin());
+            imageIndices.push_back(i);
+        }
+        else
+        {
+            expressionIndices.push_back(i);
+        }
+    }
+
+    auto decodedImages = GlobalImageLoader().imagesFromVFS(imageNames, true, maxTextureSize);
+
+    for (std::size_t j = 0; j < imageIndices.size(); ++j)
+    {
+        images[imageIndices[j]] = decodedImages[j];
+    }
+
+    util::ThreadPool::GetShared().parallelFor(expressionIndices.size(), [&](std::size_t j)
+    {
+        auto i = expressionIndices[j];
+
+        try
+        {
+            images[i] = pending[i]->getImage();
+        }
+        catch (const std::exception&)
+        {
+            // Left to getBinding(), which is reporting the error
+        }
+    });
+
+    std::size_t decodedBytes = 0;
+
+    for (std::size_t i = 0; i < pending.size(); ++i)
+    {
+        if (!images[i])
+        {
+            continue; // reported by getBinding() when the texture is requested
+        }
+
+        decodedBytes += images[i]->getWidth() * images[i]->getHeight() * 4;
+
+        auto identifier = pending[i]->getIdentifier();
+        auto texture = images[i]->bindTexture(identifier);
+
+        if (!texture)
+        {
+            continue;
+        }
+
+        _textures.emplace(identifier, texture);
+
+        if (useCache && !fromCache[i])
+        {
+            _cache->store(keys[i], texture->getGLTexNum(), texture->getWidth(), texture->getHeight());
+        }
+    }
+
+    return decodedBytes;
+}
+
+TexturePtr GLTextureManager::bindMapExpression(const MapExpression& expression, const std::string& identifier)
+{
+    if (!_cache->isEnabled())
+    {
+        return expression.bindTexture(identifier);
+    }
+
+    auto key = _cache->getKey(expression, _cache->useCompression());
+    auto cachedImage = _cache->load(key);
+
+    if (cachedImage)
+    {
+        return cachedImage->bindTexture(identifier);
+    }
+
+    auto texture = expression.bindTexture(identifier);
+
+    if (texture)
+    {
+        _cache->store(key, texture->getGLTexNum(), texture->getWidth(), texture->getHeight());
+    }
+
+    return texture;
+}
+
+bool GLTextureManager::uploadStreamedTextures()
+{
+    return _streamer.uploadPendingTextures();
+}
+
+void GLTextureManager::stopStreaming()
+{
+    _streamer.stop();
+}
+
 // Return the shader-not-found texture, loading if necessary
 TexturePtr GLTextureManager::getShaderNotFound()
 {
@@ -3,8 +3,11 @@
 
 #include "ishaders.h"
 #include <map>
+#include <vector>
 #include "../MapExpression.h"
 #include "texturelib.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
 
 namespace shaders
 {
@@ -18,16 +21,34 @@ class GLTextureManager
 	// The fallback textures in case a texture is empty or broken
 	TexturePtr _shaderNotFound;
 
+	// Keeps the evaluated map expressions across sessions
+	TextureCachePtr _cache;
+
+	// Loads the textures in the background if enabled
+	TextureStreamer _streamer;
+
 private:
 
 	// Constructs the fallback textures like "Shader Image Missing"
 	TexturePtr loadStandardTexture(const std::string& filename);
 
+	// Binds the given map expression, going through the texture cache if enabled
+	TexturePtr bindMapExpression(const MapExpression& expression, const std::string& identifier);
+
+	// Loads and binds the given textures, returns the approximate number of bytes decoded
+	std::size_t prefetchBatch(const std::vector<MapExpressionPtr>& expressions, std::size_t maxTextureSize);
+
 public:
 
+	// The signal is emitted when streamed textures are ready to be uploaded
+	GLTextureManager(sigc::signal<void>& signalTexturesStreamed);
+
     /**
      * \brief
-     * Construct a bound texture from a generic named bindable.
+     * Construct a bound texture from a generic named bindable. In streaming
+     * mode single images are returned right away, showing a placeholder
+     * until uploadStreamedTextures() has uploaded their pixels. Evaluated
+     * map expressions are kept in the on-disk texture cache.
      */
 	TexturePtr getBinding(NamedBindablePtr bindable);
 
@@ -39,6 +60,20 @@ public:
 	 */
 	TexturePtr getBinding(const std::string& fullPath);
 
+	/**
+	 * \brief
+	 * Binds the textures of the given map expressions in one go, such that
+	 * the getBinding() calls for them return right away.
+	 *
+	 * The images are loaded from the texture cache or decoded concurrently,
+	 * plain image files along with their mipmaps. They are processed in
+	 * batches of limited size, each batch is uploaded and released before
+	 * the next one is decoded. Cube maps and the expressions which are bound
+	 * already are skipped, in streaming mode the textures are just queued for
+	 * loading. Needs a GL context.
+	 */
+	void prefetchTextures(const std::vector<MapExpressionPtr>& expressions);
+
 	/**
      * \brief
      * Get the "shader not found" texture.
@@ -51,6 +86,13 @@ public:
 	 */
 	void checkBindings();
 
+	// Uploads the streamed textures decoded so far, within the time budget
+	// of a frame. Returns true if there are more textures to upload.
+	bool uploadStreamedTextures();
+
+	// Stops the texture streaming workers, called on shutdown
+	void stopStreaming();
+
 };
 
 typedef std::shared_ptr<GLTextureManager> GLTextureManagerPtr;
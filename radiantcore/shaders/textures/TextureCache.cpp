@@ -0,0 +1,777 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include "ifilesystem.h"
+#include "ipreferencesystem.h"
+#include "itextstream.h"
+#include "DDSImage.h"
+#include "ThreadPool.h"
+#include "os/fs.h"
+#include "os/file.h"
+#include "os/filekey.h"
+#include "os/path.h"
+#include "string/case_conv.h"
+#include "util/Hash.h"
+#include "fmt/format.h"
+
+#include "../MapExpression.h"
+
+namespace shaders
+{
+
+// Version 1: initial format
+const std::uint32_t TextureCache::Version = 1;
+
+namespace
+{
+	const std::string RKEY_TEXTURE_CACHE = "user/ui/textures/cache";
+	const std::string RKEY_TEXTURE_CACHE_COMPRESSION = "user/ui/textures/cacheCompression";
+	const std::string RKEY_TEXTURE_CACHE_SIZE = "user/ui/textures/cacheSize";
+
+	const char Magic[8] = { 'D', 'R', 'T', 'E', 'X', 'C', 'H', 'E' };
+	const std::uint32_t ByteOrderMark = 0x01020304;
+
+	const std::string FileExtension = "tex";
+
+	// Enough for 2^31 x 2^31 pixels
+	const std::uint32_t MaxLevels = 32;
+
+	struct MipMap
+	{
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t size;
+	};
+
+	// The mipmaps of a texture as they are written to disk
+	struct TextureData
+	{
+		std::uint32_t width = 0;
+		std::uint32_t height = 0;
+
+		GLenum format = GL_RGBA;
+		bool compressed = false;
+
+		std::vector<MipMap> mipMaps;
+		std::vector<std::uint8_t> pixels;
+	};
+
+	// The file is a sequence of native-endian numbers and length-prefixed strings:
+	// magic, byte order mark, version, key description, dimensions of the original
+	// image, GL format, compression flag, number of mipmaps, the mipmap dimensions
+	// and sizes, followed by the pixels of all mipmaps.
+	class Reader
+	{
+	private:
+		const std::string& _data;
+		std::size_t _pos;
+
+	public:
+		Reader(const std::string& data) :
+			_data(data),
+			_pos(0)
+		{}
+
+		template<typename T>
+		T read()
+		{
+			T value;
+			readBytes(&value, sizeof(T));
+			return value;
+		}
+
+		std::string readString()
+		{
+			auto length = read<std::uint32_t>();
+
+			if (length > getRemaining())
+			{
+				throw std::runtime_error("String exceeds the file");
+			}
+
+			_pos += length;
+			return _data.substr(_pos - length, length);
+		}
+
+		void readBytes(void* target, std::size_t count)
+		{
+			if (count > getRemaining())
+			{
+				throw std::runtime_error("Unexpected end of file");
+			}
+
+			std::memcpy(target, _data.data() + _pos, count);
+			_pos += count;
+		}
+
+		std::size_t getRemaining() const
+		{
+			return _data.size() - _pos;
+		}
+	};
+
+	class Writer
+	{
+	private:
+		std::ofstream& _stream;
+
+	public:
+		Writer(std::ofstream& stream) :
+			_stream(stream)
+		{}
+
+		template<typename T>
+		void write(T value)
+		{
+			_stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		void write(const std::string& str)
+		{
+			write(static_cast<std::uint32_t>(str.size()));
+			_stream.write(str.data(), str.size());
+		}
+	};
+
+	// A cached texture reports the size of the image it has been created from,
+	// which might be smaller than its first mipmap
+	class CachedImage :
+		public image::DDSImage
+	{
+	private:
+		std::size_t _width;
+		std::size_t _height;
+
+	public:
+		CachedImage(std::size_t size, std::size_t width, std::size_t height) :
+			DDSImage(size),
+			_width(width),
+			_height(height)
+		{}
+
+		std::size_t getWidth() const override { return _width; }
+		std::size_t getHeight() const override { return _height; }
+	};
+
+	bool isSupportedFormat(GLenum format, bool compressed)
+	{
+		return compressed ?
+			format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT :
+			format == GL_RGBA;
+	}
+
+	// Marks the file as recently used, the pruning removes the oldest files first
+	void touchFile(const std::string& path)
+	{
+		try
+		{
+#ifdef DR_USE_BOOST_FILESYSTEM
+			fs::last_write_time(path, std::time(nullptr));
+#else
+			fs::last_write_time(path, fs::file_time_type::clock::now());
+#endif
+		}
+		catch (const fs::filesystem_error&)
+		{}
+	}
+
+	// Converts the given colour to RGB565, rounding to the nearest value
+	std::uint16_t toRgb565(const int colour[3])
+	{
+		return static_cast<std::uint16_t>(((colour[0] * 31 + 127) / 255) << 11 |
+			((colour[1] * 63 + 127) / 255) << 5 | ((colour[2] * 31 + 127) / 255));
+	}
+
+	void fromRgb565(std::uint16_t value, int colour[3])
+	{
+		int r = (value >> 11) & 31;
+		int g = (value >> 5) & 63;
+		int b = value & 31;
+
+		colour[0] = (r << 3) | (r >> 2);
+		colour[1] = (g << 2) | (g >> 4);
+		colour[2] = (b << 3) | (b >> 2);
+	}
+
+	void writeLittleEndian(std::uint8_t* target, std::uint64_t value, std::size_t numBytes)
+	{
+		for (std::size_t i = 0; i < numBytes; ++i)
+		{
+			target[i] = static_cast<std::uint8_t>(value >> (i * 8));
+		}
+	}
+
+	// Encodes the 16 RGBA pixels of a block as DXT1 colour block (8 bytes), using the
+	// inset bounding box of the colours as end points and the nearest palette entries
+	void encodeColourBlock(const std::uint8_t pixels[16][4], std::uint8_t* target)
+	{
+		int min[3] = { 255, 255, 255 };
+		int max[3] = { 0, 0, 0 };
+
+		for (std::size_t i = 0; i < 16; ++i)
+		{
+			for (std::size_t c = 0; c < 3; ++c)
+			{
+				min[c] = std::min<int>(min[c], pixels[i][c]);
+				max[c] = std::max<int>(max[c], pixels[i][c]);
+			}
+		}
+
+		// Move the end points inwards, the extremes are covered well enough by the interpolated colours
+		for (std::size_t c = 0; c < 3; ++c)
+		{
+			int inset = (max[c] - min[c]) >> 4;
+			min[c] += inset;
+			max[c] -= inset;
+		}
+
+		auto colour0 = toRgb565(max);
+		auto colour1 = toRgb565(min);
+
+		// The first colour must be the larger one to select the four colour mode
+		if (colour0 < colour1)
+		{
+			std::swap(colour0, colour1);
+		}
+
+		std::uint32_t indices = 0;
+
+		if (colour0 != colour1)
+		{
+			int palette[4][3];
+			fromRgb565(colour0, palette[0]);
+			fromRgb565(colour1, palette[1]);
+
+			for (std::size_t c = 0; c < 3; ++c)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (std::size_t i = 0; i < 16; ++i)
+			{
+				std::uint32_t best = 0;
+				int bestDistance = std::numeric_limits<int>::max();
+
+				for (std::uint32_t p = 0; p < 4; ++p)
+				{
+					int distance = 0;
+
+					for (std::size_t c = 0; c < 3; ++c)
+					{
+						int delta = pixels[i][c] - palette[p][c];
+						distance += delta * delta;
+					}
+
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = p;
+					}
+				}
+
+				indices |= best << (i * 2);
+			}
+		}
+
+		writeLittleEndian(target, colour0, 2);
+		writeLittleEndian(target + 2, colour1, 2);
+		writeLittleEndian(target + 4, indices, 4);
+	}
+
+	// Encodes the alpha values of a block as DXT5 alpha block (8 bytes)
+	void encodeAlphaBlock(const std::uint8_t pixels[16][4], std::uint8_t* target)
+	{
+		int alpha0 = 0;
+		int alpha1 = 255;
+
+		for (std::size_t i = 0; i < 16; ++i)
+		{
+			alpha0 = std::max<int>(alpha0, pixels[i][3]);
+			alpha1 = std::min<int>(alpha1, pixels[i][3]);
+		}
+
+		std::uint64_t indices = 0;
+
+		// With alpha0 > alpha1 the palette holds the two end points and six interpolated values
+		if (alpha0 != alpha1)
+		{
+			int palette[8] = { alpha0, alpha1 };
+
+			for (int p = 1; p < 7; ++p)
+			{
+				palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+			}
+
+			for (std::size_t i = 0; i < 16; ++i)
+			{
+				std::uint64_t best = 0;
+				int bestDistance = 256;
+
+				for (std::uint64_t p = 0; p < 8; ++p)
+				{
+					int distance = std::abs(pixels[i][3] - palette[p]);
+
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = p;
+					}
+				}
+
+				indices |= best << (i * 3);
+			}
+		}
+
+		target[0] = static_cast<std::uint8_t>(alpha0);
+		target[1] = static_cast<std::uint8_t>(alpha1);
+		writeLittleEndian(target + 2, indices, 6);
+	}
+
+	// Compresses the RGBA mipmaps to DXT1, or to DXT5 if they are not opaque
+	void compressTexture(TextureData& texture)
+	{
+		bool hasAlpha = false;
+
+		for (std::size_t i = 3; i < texture.pixels.size() && !hasAlpha; i += 4)
+		{
+			hasAlpha = texture.pixels[i] != 255;
+		}
+
+		// Opaque textures take half the space
+		GLenum format = hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		std::size_t blockSize = hasAlpha ? 16 : 8;
+
+		std::vector<MipMap> mipMaps;
+		std::vector<std::uint8_t> pixels;
+
+		const std::uint8_t* source = texture.pixels.data();
+
+		for (const auto& mipMap : texture.mipMaps)
+		{
+			std::size_t blocksX = (mipMap.width + 3) / 4;
+			std::size_t blocksY = (mipMap.height + 3) / 4;
+			auto size = static_cast<std::uint32_t>(blocksX * blocksY * blockSize);
+
+			mipMaps.push_back(MipMap{ mipMap.width, mipMap.height, size });
+
+			std::size_t offset = pixels.size();
+			pixels.resize(offset + size);
+
+			for (std::size_t by = 0; by < blocksY; ++by)
+			{
+				for (std::size_t bx = 0; bx < blocksX; ++bx)
+				{
+					std::uint8_t block[16][4];
+
+					// Mipmaps smaller than a block repeat their last row and column
+					for (std::size_t i = 0; i < 16; ++i)
+					{
+						std::size_t x = std::min<std::size_t>(bx * 4 + i % 4, mipMap.width - 1);
+						std::size_t y = std::min<std::size_t>(by * 4 + i / 4, mipMap.height - 1);
+
+						std::memcpy(block[i], source + (y * mipMap.width + x) * 4, 4);
+					}
+
+					auto* target = pixels.data() + offset;
+
+					if (hasAlpha)
+					{
+						encodeAlphaBlock(block, target);
+						target += 8;
+					}
+
+					encodeColourBlock(block, target);
+					offset += blockSize;
+				}
+			}
+
+			source += mipMap.size;
+		}
+
+		texture.format = format;
+		texture.compressed = true;
+		texture.mipMaps.swap(mipMaps);
+		texture.pixels.swap(pixels);
+	}
+
+	void writeFile(const std::string& path, const std::string& description, const TextureData& texture)
+	{
+		fs::path cachePath = path;
+		fs::path tempPath = path + ".tmp";
+
+		try
+		{
+			fs::create_directories(cachePath.parent_path());
+
+			std::ofstream stream(tempPath.string(), std::ios::binary);
+
+			if (!stream.is_open())
+			{
+				throw std::runtime_error("Could not open file for writing");
+			}
+
+			Writer writer(stream);
+
+			stream.write(Magic, sizeof(Magic));
+			writer.write(ByteOrderMark);
+			writer.write(TextureCache::Version);
+			writer.write(description);
+			writer.write(texture.width);
+			writer.write(texture.height);
+			writer.write(static_cast<std::uint32_t>(texture.format));
+			writer.write(static_cast<std::uint8_t>(texture.compressed ? 1 : 0));
+			writer.write(static_cast<std::uint32_t>(texture.mipMaps.size()));
+
+			for (const auto& mipMap : texture.mipMaps)
+			{
+				writer.write(mipMap.width);
+				writer.write(mipMap.height);
+				writer.write(mipMap.size);
+			}
+
+			stream.write(reinterpret_cast<const char*>(texture.pixels.data()), texture.pixels.size());
+			stream.close();
+
+			if (stream.fail())
+			{
+				throw std::runtime_error("Failure writing to file");
+			}
+
+			// Other threads might be loading the old file, replace it in one go
+			fs::rename(tempPath, cachePath);
+		}
+		catch (const std::exception& ex)
+		{
+			rWarning() << "[shaders] Failed to write texture cache file " << path << ": " << ex.what() << std::endl;
+
+			// Don't leave any partially written files behind
+			std::remove(tempPath.string().c_str());
+		}
+	}
+}
+
+TextureCache::TextureCache(const std::string& directory) :
+	_directory(os::standardPathWithSlash(directory)),
+	_enabled(RKEY_TEXTURE_CACHE),
+	_compression(RKEY_TEXTURE_CACHE_COMPRESSION),
+	_sizeLimit(RKEY_TEXTURE_CACHE_SIZE)
+{
+	constructPreferences();
+}
+
+TextureCache::~TextureCache()
+{
+	// Blocks until all files have been written
+	_writer.wait();
+
+	prune();
+}
+
+bool TextureCache::isEnabled() const
+{
+	return _enabled.get();
+}
+
+bool TextureCache::useCompression() const
+{
+	return _compression.get() && GLEW_VERSION_1_3 && GLEW_EXT_texture_compression_s3tc;
+}
+
+std::string TextureCache::getFilePath(const Key& key) const
+{
+	return _directory + fmt::format("{0:016x}.", key.hash) + FileExtension;
+}
+
+TextureCache::Key TextureCache::getKey(const MapExpression& expression, bool compress) const
+{
+	std::set<std::string> imageNames;
+	expression.collectImageNames(imageNames);
+
+	// Built-in images are quick to load
+	if (imageNames.empty())
+	{
+		return Key();
+	}
+
+	// Compressed and uncompressed textures are stored in different files
+	std::string description = expression.getIdentifier() + (compress ? "\ndxt" : "\nrgba");
+
+	for (const auto& name : imageNames)
+	{
+		auto file = GlobalImageLoader().findImageFile(name);
+
+		// DDS files are compressed and mipmapped already
+		if (file.empty() || string::to_lower_copy(os::getExtension(file)) == "dds")
+		{
+			return Key();
+		}
+
+		os::FileKey fileKey;
+
+		GlobalFileSystem().findFileInfo(file, [&](const vfs::FileInfo& fileInfo)
+		{
+			fileKey = os::getFileKey(fileInfo);
+		});
+
+		if (!fileKey.isValid())
+		{
+			return Key();
+		}
+
+		description += "\n" + file + "|" + fileKey.archivePath + "|" +
+			std::to_string(fileKey.size) + "|" + std::to_string(fileKey.timestamp);
+	}
+
+	util::Hash64 hash;
+	hash.update(description);
+
+	Key key;
+	key.description = std::move(description);
+	key.hash = hash.getValue();
+	key.compressed = compress;
+
+	return key;
+}
+
+ImagePtr TextureCache::load(const Key& key) const
+{
+	if (!key.isValid())
+	{
+		return ImagePtr();
+	}
+
+	auto path = getFilePath(key);
+
+	std::ifstream stream(path, std::ios::binary);
+
+	if (!stream.is_open())
+	{
+		return ImagePtr();
+	}
+
+	std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+	stream.close();
+
+	try
+	{
+		Reader reader(data);
+
+		char magic[sizeof(Magic)];
+		reader.readBytes(magic, sizeof(magic));
+
+		// Outdated files are replaced when the texture is stored again
+		if (std::memcmp(magic, Magic, sizeof(Magic)) != 0 ||
+			reader.read<std::uint32_t>() != ByteOrderMark || reader.read<std::uint32_t>() != Version ||
+			reader.readString() != key.description)
+		{
+			return ImagePtr();
+		}
+
+		auto width = reader.read<std::uint32_t>();
+		auto height = reader.read<std::uint32_t>();
+		auto format = static_cast<GLenum>(reader.read<std::uint32_t>());
+		bool compressed = reader.read<std::uint8_t>() != 0;
+		auto numMipMaps = reader.read<std::uint32_t>();
+
+		if (!isSupportedFormat(format, compressed) || numMipMaps == 0 || numMipMaps > MaxLevels)
+		{
+			throw std::runtime_error("Invalid texture format");
+		}
+
+		std::vector<MipMap> mipMaps;
+		std::size_t totalSize = 0;
+
+		for (std::uint32_t i = 0; i < numMipMaps; ++i)
+		{
+			MipMap mipMap;
+			mipMap.width = reader.read<std::uint32_t>();
+			mipMap.height = reader.read<std::uint32_t>();
+			mipMap.size = reader.read<std::uint32_t>();
+
+			if (mipMap.width == 0 || mipMap.height == 0 || mipMap.size == 0)
+			{
+				throw std::runtime_error("Invalid mipmap");
+			}
+
+			totalSize += mipMap.size;
+			mipMaps.push_back(mipMap);
+		}
+
+		if (totalSize != reader.getRemaining())
+		{
+			throw std::runtime_error("Size mismatch");
+		}
+
+		auto image = std::make_shared<CachedImage>(totalSize, width, height);
+		image->setFormat(format, compressed, GL_RGBA);
+
+		std::size_t offset = 0;
+
+		for (const auto& mipMap : mipMaps)
+		{
+			reader.readBytes(image->addMipMap(mipMap.width, mipMap.height, mipMap.size, offset), mipMap.size);
+			offset += mipMap.size;
+		}
+
+		touchFile(path);
+
+		return image;
+	}
+	catch (const std::runtime_error& ex)
+	{
+		rWarning() << "[shaders] Texture cache file " << path << " is damaged, removing it: " << ex.what() << std::endl;
+		std::remove(path.c_str());
+
+		return ImagePtr();
+	}
+}
+
+void TextureCache::store(const Key& key, GLuint textureNum, std::size_t width, std::size_t height)
+{
+	if (!key.isValid() || textureNum == 0)
+	{
+		return;
+	}
+
+	auto texture = std::make_shared<TextureData>();
+	texture->width = static_cast<std::uint32_t>(width);
+	texture->height = static_cast<std::uint32_t>(height);
+
+	debug::assertNoGlErrors();
+
+	glBindTexture(GL_TEXTURE_2D, textureNum);
+
+	// Read back all mipmaps down to 1x1 as 32 bit RGBA
+	for (std::uint32_t i = 0; i < MaxLevels; ++i)
+	{
+		auto level = static_cast<GLint>(i);
+
+		GLint levelWidth = 0;
+		GLint levelHeight = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &levelWidth);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &levelHeight);
+
+		if (levelWidth <= 0 || levelHeight <= 0)
+		{
+			break;
+		}
+
+		auto size = static_cast<std::uint32_t>(levelWidth) * static_cast<std::uint32_t>(levelHeight) * 4;
+		texture->mipMaps.push_back(MipMap{ static_cast<std::uint32_t>(levelWidth), static_cast<std::uint32_t>(levelHeight), size });
+
+		texture->pixels.resize(texture->pixels.size() + size);
+		glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, texture->pixels.data() + texture->pixels.size() - size);
+
+		if (levelWidth == 1 && levelHeight == 1)
+		{
+			break;
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (glGetError() != GL_NO_ERROR || texture->mipMaps.empty())
+	{
+		return;
+	}
+
+	auto path = getFilePath(key);
+	auto description = key.description;
+	bool compress = key.compressed;
+
+	// Compressing and writing doesn't need the GL context
+	_writer.enqueue([path, description, texture, compress]()
+	{
+		if (compress)
+		{
+			compressTexture(*texture);
+		}
+
+		writeFile(path, description, *texture);
+	});
+}
+
+void TextureCache::prune()
+{
+	struct CacheFile
+	{
+		std::string path;
+		std::uintmax_t size;
+		std::int64_t timestamp;
+	};
+
+	try
+	{
+		if (!os::fileOrDirExists(_directory))
+		{
+			return;
+		}
+
+		std::vector<CacheFile> files;
+		std::uintmax_t totalSize = 0;
+
+		for (fs::directory_iterator it(_directory); it != fs::directory_iterator(); ++it)
+		{
+			auto path = it->path().string();
+
+			if (os::getExtension(path) != FileExtension)
+			{
+				continue;
+			}
+
+			CacheFile file{ path, fs::file_size(it->path()), os::getModificationTimestamp(path) };
+
+			totalSize += file.size;
+			files.emplace_back(std::move(file));
+		}
+
+		auto limit = static_cast<std::uintmax_t>(std::max(_sizeLimit.get(), 0)) * 1024 * 1024;
+
+		if (totalSize <= limit)
+		{
+			return;
+		}
+
+		std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b)
+		{
+			return a.timestamp < b.timestamp;
+		});
+
+		std::size_t numRemoved = 0;
+
+		for (auto i = files.begin(); i != files.end() && totalSize > limit; ++i, ++numRemoved)
+		{
+			fs::remove(i->path);
+			totalSize -= i->size;
+		}
+
+		rMessage() << "[shaders] Removed " << numRemoved << " least recently used files from the texture cache" << std::endl;
+	}
+	catch (const fs::filesystem_error& ex)
+	{
+		rWarning() << "[shaders] Failed to prune the texture cache " << _directory << ": " << ex.what() << std::endl;
+	}
+}
+
+void TextureCache::constructPreferences()
+{
+	IPreferencePage& page = GlobalPreferenceSystem().getPage("Settings/Textures");
+
+	page.appendCheckBox("Cache textures on disk", RKEY_TEXTURE_CACHE);
+	page.appendCheckBox("Compress cached textures (DXT)", RKEY_TEXTURE_CACHE_COMPRESSION);
+	page.appendSpinner("Texture cache size (MB)", RKEY_TEXTURE_CACHE_SIZE, 64, 65536, 1);
+}
+
+} // namespace shaders
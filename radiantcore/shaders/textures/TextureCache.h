@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "igl.h"
+#include "iimage.h"
+#include "registry/CachedKey.h"
+#include "ThreadPool.h"
+
+namespace shaders
+{
+
+class MapExpression;
+
+/**
+ * Persistent cache of evaluated map expressions, which saves the texture
+ * manager from decoding, combining and mipmapping the source images again
+ * in the next session.
+ *
+ * Each texture is stored in its own file, holding all mipmap levels as
+ * they have been uploaded to OpenGL, optionally compressed to DXT1/DXT5 in
+ * the background. The files are named after the hash of the expression
+ * and the size and modification time of its source images, such that changing an
+ * image invalidates all textures built from it. The least recently used
+ * files are removed once the cache exceeds the size set in the preferences.
+ */
+class TextureCache
+{
+public:
+	static const std::uint32_t Version;
+
+	struct Key
+	{
+		// Expression and source file details, stored to detect hash collisions
+		std::string description;
+		std::uint64_t hash = 0;
+
+		// True if the texture is stored DXT compressed
+		bool compressed = false;
+
+		// Expressions without image files (or reading DDS files) are not cached
+		bool isValid() const
+		{
+			return !description.empty();
+		}
+	};
+
+private:
+	std::string _directory;
+
+	registry::CachedKey<bool> _enabled;
+	registry::CachedKey<bool> _compression;
+	registry::CachedKey<int> _sizeLimit;
+
+	// Compresses and writes the files in the background, one at a time
+	util::SerialTaskQueue _writer;
+
+public:
+	// The files are kept in the given directory, which is created when needed
+	TextureCache(const std::string& directory);
+
+	// Waits for the pending writes and trims the cache to its size limit
+	~TextureCache();
+
+	// Returns true if textures should be cached (set in the preferences)
+	bool isEnabled() const;
+
+	// Returns true if cached textures should be compressed, which depends on the
+	// preferences and the GL extensions. Needs to be called on the GL thread.
+	bool useCompression() const;
+
+	/**
+	 * Determines the key of the given expression by looking up its source
+	 * images in the VFS. Returns an invalid key if the expression can't be
+	 * cached. The compression flag is the one returned by useCompression(),
+	 * resolved on the GL thread. Can be called from any thread.
+	 */
+	Key getKey(const MapExpression& expression, bool compress) const;
+
+	/**
+	 * Loads the texture stored for the given key, returns an empty pointer if
+	 * there's none. The image reports the dimensions of the original image.
+	 * Can be called from any thread.
+	 */
+	ImagePtr load(const Key& key) const;
+
+	/**
+	 * Reads back the mipmaps of the given texture and queues them for
+	 * compression and writing. The width and height are the ones of the image
+	 * the texture has been created from. Needs to be called on the GL thread.
+	 */
+	void store(const Key& key, GLuint textureNum, std::size_t width, std::size_t height);
+
+private:
+	std::string getFilePath(const Key& key) const;
+
+	// Removes the least recently used files until the cache fits its size limit
+	void prune();
+
+	void constructPreferences();
+};
+typedef std::shared_ptr<TextureCache> TextureCachePtr;
+
+} // namespace shaders
@@ -75,9 +75,6 @@ private:
 	// This is called on first startup or if the user changes the value
 	void calculateGammaTable();
 
-	void resampleTextureLerpLine(const byte *in, byte *out,
-								 std::size_t inwidth, std::size_t outwidth, int bytesperpixel);
-
 }; // class TextureManipulator
 
 } // namespace shaders
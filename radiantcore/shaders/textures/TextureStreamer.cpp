@@ -0,0 +1,312 @@
+#include "TextureStreamer.h"
+
+#include <chrono>
+#include "igl.h"
+#include "imodule.h"
+#include "itextstream.h"
+#include "ipreferencesystem.h"
+#include "ThreadPool.h"
+#include "TextureManipulator.h"
+
+namespace shaders
+{
+
+namespace
+{
+	const std::string RKEY_TEXTURE_STREAMING = "user/ui/textures/streaming";
+
+	const std::string SHADER_NOT_FOUND = "notex.bmp";
+
+	// Time per frame spent uploading the decoded images
+	const std::chrono::milliseconds UPLOAD_BUDGET(4);
+
+	// Shown until the image has been uploaded
+	const GLubyte PLACEHOLDER_PIXEL[4] = { 128, 128, 128, 255 };
+}
+
+StreamedTexture::StreamedTexture(const MapExpressionPtr& expression, const std::string& name,
+	const std::shared_ptr<TextureStreamingState>& state) :
+	_state(state),
+	_expression(expression),
+	_name(name),
+	_texNum(0),
+	_decoded(false),
+	_width(0),
+	_height(0),
+	_useCache(state->cache && state->cache->isEnabled()),
+	_compressCache(_useCache && state->cache->useCompression())
+{
+	glGenTextures(1, &_texNum);
+	glBindTexture(GL_TEXTURE_2D, _texNum);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER_PIXEL);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+StreamedTexture::~StreamedTexture()
+{
+	// The last reference might be dropped by a worker, so leave
+	// the deletion to the next uploadPendingTextures() call
+	std::lock_guard<std::mutex> lock(_state->mutex);
+	_state->released.push_back(_texNum);
+}
+
+void StreamedTexture::decode()
+{
+	std::call_once(_decodeFlag, [this]()
+	{
+		auto cache = _state->cache;
+
+		try
+		{
+			if (cache && _useCache)
+			{
+				auto key = cache->getKey(*_expression, _compressCache);
+
+				_image = cache->load(key);
+
+				if (!_image)
+				{
+					_image = _expression->getImage();
+					_cacheKey = std::move(key);
+				}
+			}
+			else
+			{
+				_image = _expression->getImage();
+			}
+		}
+		catch (const std::exception& ex)
+		{
+			rError() << "[shaders] Exception loading texture " << _name << ": " << ex.what() << std::endl;
+		}
+
+		if (!_image)
+		{
+			rError() << "[shaders] Unable to load texture: " << _name << std::endl;
+
+			// Show the same image as a texture failing to load synchronously
+			_image = GlobalImageLoader().imageFromFile(
+				module::GlobalModuleRegistry().getApplicationContext().getBitmapsPath() + SHADER_NOT_FOUND);
+		}
+
+		_width = _image ? _image->getWidth() : 1;
+		_height = _image ? _image->getHeight() : 1;
+		_decoded = true;
+
+		bool notify = false;
+
+		{
+			std::lock_guard<std::mutex> lock(_state->mutex);
+
+			_state->decoded.push_back(shared_from_this());
+
+			notify = !_state->notified;
+			_state->notified = true;
+		}
+
+		if (notify && _state->signalStreamed != nullptr)
+		{
+			_state->signalStreamed->emit();
+		}
+	});
+}
+
+void StreamedTexture::upload()
+{
+	if (!_image)
+	{
+		return; // nothing to upload, keep the placeholder
+	}
+
+	if (!_image->uploadTexture(_texNum, _name))
+	{
+		rError() << "[shaders] Unable to upload texture: " << _name << std::endl;
+	}
+	else if (_cacheKey.isValid() && _state->cache)
+	{
+		_state->cache->store(_cacheKey, _texNum, _width, _height);
+	}
+
+	// The pixels are in graphics memory now
+	_image.reset();
+	_expression.reset();
+	_cacheKey = TextureCache::Key();
+}
+
+std::string StreamedTexture::getName() const
+{
+	return _name;
+}
+
+GLuint StreamedTexture::getGLTexNum() const
+{
+	return _texNum;
+}
+
+std::size_t StreamedTexture::getWidth() const
+{
+	const_cast<StreamedTexture&>(*this).decode();
+	return _width;
+}
+
+std::size_t StreamedTexture::getHeight() const
+{
+	const_cast<StreamedTexture&>(*this).decode();
+	return _height;
+}
+
+bool StreamedTexture::isLoaded() const
+{
+	return _decoded;
+}
+
+TextureStreamer::TextureStreamer(sigc::signal<void>& signalStreamed, const TextureCachePtr& cache) :
+	_state(std::make_shared<TextureStreamingState>()),
+	_enabled(RKEY_TEXTURE_STREAMING)
+{
+	_state->signalStreamed = &signalStreamed;
+	_state->cache = cache;
+
+	// The workers are resampling images, make sure the manipulator is
+	// constructed on this thread, it is connecting to the registry
+	TextureManipulator::instance();
+
+	constructPreferences();
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	stop();
+}
+
+bool TextureStreamer::isEnabled() const
+{
+	return _enabled.get();
+}
+
+TexturePtr TextureStreamer::createTexture(const MapExpressionPtr& expression, const std::string& name)
+{
+	auto texture = std::make_shared<StreamedTexture>(expression, name, _state);
+
+	std::weak_ptr<StreamedTexture> weakTexture(texture);
+	auto state = _state;
+
+	util::ThreadPool::GetShared().enqueue([weakTexture, state]()
+	{
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+
+			if (state->cancelled)
+			{
+				return;
+			}
+
+			++state->runningJobs;
+		}
+
+		// Textures which have been released in the meantime are skipped
+		auto texture = weakTexture.lock();
+
+		if (texture)
+		{
+			texture->decode();
+		}
+
+		texture.reset();
+
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+			--state->runningJobs;
+		}
+
+		state->jobFinished.notify_all();
+	});
+
+	return texture;
+}
+
+bool TextureStreamer::uploadPendingTextures()
+{
+	std::vector<GLuint> released;
+	std::vector<std::weak_ptr<StreamedTexture>> decoded;
+
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+
+		released.swap(_state->released);
+		decoded.swap(_state->decoded);
+	}
+
+	if (!released.empty())
+	{
+		glDeleteTextures(static_cast<GLsizei>(released.size()), released.data());
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::size_t numUploaded = 0;
+
+	// Upload at least one texture per call, even if it exceeds the budget
+	while (numUploaded < decoded.size() &&
+		(numUploaded == 0 || std::chrono::steady_clock::now() - start < UPLOAD_BUDGET))
+	{
+		auto texture = decoded[numUploaded++].lock();
+
+		if (texture)
+		{
+			texture->upload();
+		}
+	}
+
+	bool morePending = false;
+
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+
+		// The remaining ones go first in the next frame
+		_state->decoded.insert(_state->decoded.begin(), decoded.begin() + numUploaded, decoded.end());
+
+		morePending = !_state->decoded.empty();
+
+		if (!morePending)
+		{
+			// Let the workers request a redraw for the next decoded image
+			_state->notified = false;
+		}
+	}
+
+	if (morePending && _state->signalStreamed != nullptr)
+	{
+		// Request another frame to continue the upload
+		_state->signalStreamed->emit();
+	}
+
+	return morePending;
+}
+
+void TextureStreamer::stop()
+{
+	// Wait for the running jobs, the queued ones return right away
+	{
+		std::unique_lock<std::mutex> lock(_state->mutex);
+
+		_state->cancelled = true;
+		_state->jobFinished.wait(lock, [this]() { return _state->runningJobs == 0; });
+	}
+
+	// The streamed textures might be released much later, let go of the
+	// cache such that it can finish writing its files now
+	_state->cache.reset();
+}
+
+void TextureStreamer::constructPreferences()
+{
+	IPreferencePage& page = GlobalPreferenceSystem().getPage("Settings/Textures");
+
+	page.appendCheckBox("Load textures in the background", RKEY_TEXTURE_STREAMING);
+}
+
+} // namespace shaders
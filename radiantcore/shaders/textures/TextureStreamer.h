@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sigc++/signal.h>
+
+#include "Texture.h"
+#include "TextureCache.h"
+#include "iimage.h"
+#include "registry/CachedKey.h"
+#include "../MapExpression.h"
+
+namespace shaders
+{
+
+class StreamedTexture;
+typedef std::shared_ptr<StreamedTexture> StreamedTexturePtr;
+
+/**
+ * State shared by the TextureStreamer, its worker jobs and the streamed
+ * textures, which might outlive the streamer.
+ */
+struct TextureStreamingState
+{
+	std::mutex mutex;
+
+	// Textures whose image has been decoded, waiting to be uploaded
+	std::vector<std::weak_ptr<StreamedTexture>> decoded;
+
+	// GL texture numbers of destroyed textures, deleted on the GL thread
+	std::vector<GLuint> released;
+
+	// True if the streamed signal has been emitted since the last time
+	// the decoded textures have all been uploaded
+	bool notified = false;
+
+	// Set on shutdown, the queued jobs are skipped from then on
+	std::atomic<bool> cancelled = { false };
+
+	// The number of jobs decoding a texture right now, guarded by the mutex
+	std::size_t runningJobs = 0;
+	std::condition_variable jobFinished;
+
+	// Emitted when decoded textures are waiting to be uploaded
+	sigc::signal<void>* signalStreamed = nullptr;
+
+	// Evaluated expressions are loaded from and stored to this cache
+	TextureCachePtr cache;
+};
+
+/**
+ * A 2D texture bound before its image has been loaded.
+ *
+ * The GL texture number is allocated right away and holds a placeholder
+ * pixel, until the TextureStreamer uploads the decoded image into the
+ * same texture number. Everything referring to the texture number (like
+ * the passes of the OpenGL shaders) picks up the final image without
+ * having to be realised again.
+ */
+class StreamedTexture :
+	public Texture,
+	public std::enable_shared_from_this<StreamedTexture>
+{
+private:
+	std::shared_ptr<TextureStreamingState> _state;
+
+	MapExpressionPtr _expression;
+	std::string _name;
+	GLuint _texNum;
+
+	std::once_flag _decodeFlag;
+	std::atomic<bool> _decoded;
+
+	// Written once by decode(), released after the upload
+	ImagePtr _image;
+	std::size_t _width;
+	std::size_t _height;
+
+	// The cache preferences, resolved on the GL thread when the texture is created
+	bool _useCache;
+	bool _compressCache;
+
+	// Set if the evaluated image should be stored in the cache after its upload
+	TextureCache::Key _cacheKey;
+
+public:
+	// Allocates the GL texture and uploads the placeholder, needs a GL context
+	StreamedTexture(const MapExpressionPtr& expression, const std::string& name,
+		const std::shared_ptr<TextureStreamingState>& state);
+
+	~StreamedTexture();
+
+	/**
+	 * Evaluates the map expression (or loads it from the texture cache) and
+	 * queues the image for its upload. Does
+	 * nothing if this has been done already, blocks while another thread is
+	 * doing it. Safe to be called from any thread.
+	 */
+	void decode();
+
+	// Uploads the decoded image to the GL texture, called on the GL thread
+	void upload();
+
+	/* Texture implementation */
+	std::string getName() const override;
+	GLuint getGLTexNum() const override;
+
+	// The dimensions are those of the final image, querying them
+	// blocks until the image has been decoded.
+	std::size_t getWidth() const override;
+	std::size_t getHeight() const override;
+
+	bool isLoaded() const override;
+};
+
+/**
+ * Loads textures in the background (texture streaming mode).
+ *
+ * The map expressions of the streamed textures are evaluated on the shared
+ * thread pool, which includes decoding the image files and resampling.
+ * The decoded images are uploaded on the GL thread by uploadPendingTextures(),
+ * which is called once per frame and stops after a few milliseconds, the
+ * remaining images are uploaded in the next frames.
+ */
+class TextureStreamer
+{
+private:
+	std::shared_ptr<TextureStreamingState> _state;
+
+	registry::CachedKey<bool> _enabled;
+
+public:
+	// The cache may be empty, textures are not cached then
+	TextureStreamer(sigc::signal<void>& signalStreamed, const TextureCachePtr& cache);
+	~TextureStreamer();
+
+	// Returns true if textures should be streamed (set in the preferences)
+	bool isEnabled() const;
+
+	/**
+	 * Creates the texture showing a placeholder and queues the evaluation of
+	 * the given expression, which must not be a cube map. Needs a GL context.
+	 */
+	TexturePtr createTexture(const MapExpressionPtr& expression, const std::string& name);
+
+	/**
+	 * Uploads the textures decoded since the last call, until the time budget is
+	 * used up. Needs to be called on the GL thread. Returns true if there are
+	 * more textures waiting to be uploaded.
+	 */
+	bool uploadPendingTextures();
+
+	// Skips the queued jobs and waits for the running ones, called on shutdown
+	void stop();
+
+private:
+	void constructPreferences();
+};
+
+} // namespace shaders
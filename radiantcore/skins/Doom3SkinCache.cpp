@@ -3,7 +3,10 @@
 #include "itextstream.h"
 #include "ifilesystem.h"
 #include "iarchive.h"
+#include "ideclscheduler.h"
 #include "module/StaticModule.h"
+#include "stream/utils.h"
+#include "ParallelDefFileLoader.h"
 
 #include <iostream>
 
@@ -59,29 +62,30 @@ void Doom3SkinCache::loadSkinFiles()
 {
 	rMessage() << "[skins] Loading skins." << std::endl;
 
+	util::ParallelDefFileLoader<ParsedSkinFile> loader("skins");
+
 	// Use a functor to traverse the skins directory, catching any parse
 	// exceptions that may be thrown
 	try
 	{
-        GlobalFileSystem().forEachFile(
-            SKINS_FOLDER, "skin",
-            [&] (const vfs::FileInfo& fileInfo)
+        GlobalFileSystem().forEachFile(SKINS_FOLDER, "skin",
+            [&](const vfs::FileInfo& fileInfo) { loader.addFile(fileInfo); });
+
+        loader.load(
+            [&](const vfs::FileInfo& fileInfo)
             {
                 // Open the .skin file and get its contents as a std::string
                 auto file = GlobalFileSystem().openTextFile(SKINS_FOLDER + fileInfo.name);
                 assert(file);
 
-                std::istream is(&(file->getInputStream()));
-
-                try 
-                {
-                    // Pass the contents back to the SkinCache module for parsing
-                    parseFile(is, fileInfo.name);
-                }
-                catch (parser::ParseException& e)
-                {
-                    rError() << "[skins]: in " << fileInfo.name << ": " << e.what() << std::endl;
-                }
+                // Load the whole file at once, it's tokenised in place
+                std::string contents = stream::readAll(file->getInputStream());
+
+                return parseFile(contents, fileInfo.name);
+            },
+            [&](const vfs::FileInfo& fileInfo, ParsedSkinFile& parsedFile)
+            {
+                addSkins(parsedFile, fileInfo.name);
             }
         );
 	}
@@ -97,49 +101,74 @@ void Doom3SkinCache::loadSkinFiles()
 }
 
 // Parse the contents of a .skin file
-void Doom3SkinCache::parseFile(std::istream& contents, const std::string& filename)
+Doom3SkinCache::ParsedSkinFile Doom3SkinCache::parseFile(std::string_view contents, const std::string& filename)
 {
+    ParsedSkinFile result;
+
     // Construct a DefTokeniser to parse the file
-	parser::BasicDefTokeniser<std::istream> tok(contents);
+	parser::BasicDefTokeniser<std::string_view> tok(contents);
 
-	// Call the parseSkin() function for each skin decl
-	while (tok.hasMoreTokens())
-    {
-		try
-        {
-			// Try to parse the skin
-			Doom3ModelSkinPtr modelSkin = parseSkin(tok);
-			std::string skinName = modelSkin->getName();
+	try
+	{
+		// Call the parseSkin() function for each skin decl
+		while (tok.hasMoreTokens())
+		{
+			try
+			{
+				// Try to parse the skin
+				ParsedSkin parsedSkin;
+				parsedSkin.skin = parseSkin(tok, parsedSkin.models);
+				parsedSkin.skin->setSkinFileName(filename);
+
+				result.push_back(std::move(parsedSkin));
+			}
+			catch (parser::ParseException& e)
+			{
+				rWarning() << "[skins]: in " << filename << ": " << e.what() << std::endl;
+			}
+		}
+	}
+	catch (parser::ParseException& e)
+	{
+		rError() << "[skins]: in " << filename << ": " << e.what() << std::endl;
+	}
 
-			modelSkin->setSkinFileName(filename);
+	return result;
+}
 
-			auto found = _namedSkins.find(skinName);
+void Doom3SkinCache::addSkins(const ParsedSkinFile& parsedFile, const std::string& filename)
+{
+	for (const auto& parsedSkin : parsedFile)
+	{
+		const auto& skinName = parsedSkin.skin->getName();
 
-			// Is this already defined?
-			if (found != _namedSkins.end()) 
-            {
-                rWarning() << "[skins] in " << filename << ": skin " + skinName +
-						     " previously defined in " +
-							 found->second->getSkinFileName() + "!" << std::endl;
-				// Don't insert the skin into the list
-			}
-			else
-            {
-				// Add the populated Doom3ModelSkin to the hashtable and the name to the
-				// list of all skins
-				_namedSkins.emplace(skinName, modelSkin);
-				_allSkins.emplace_back(skinName);
-			}
+		for (const auto& model : parsedSkin.models)
+		{
+			_modelSkins[model].push_back(skinName);
 		}
-		catch (parser::ParseException& e)
-        {
-            rWarning() << "[skins]: in " << filename << ": " << e.what() << std::endl;
+
+		auto found = _namedSkins.find(skinName);
+
+		// Is this already defined?
+		if (found != _namedSkins.end()) 
+		{
+			rWarning() << "[skins] in " << filename << ": skin " + skinName +
+						 " previously defined in " +
+						 found->second->getSkinFileName() + "!" << std::endl;
+			// Don't insert the skin into the list
+		}
+		else
+		{
+			// Add the populated Doom3ModelSkin to the hashtable and the name to the
+			// list of all skins
+			_namedSkins.emplace(skinName, parsedSkin.skin);
+			_allSkins.emplace_back(skinName);
 		}
 	}
 }
 
 // Parse an individual skin declaration
-Doom3ModelSkinPtr Doom3SkinCache::parseSkin(parser::DefTokeniser& tok) 
+Doom3ModelSkinPtr Doom3SkinCache::parseSkin(parser::DefTokeniser& tok, StringList& models)
 {
 	// [ "skin" ] <name> "{"
 	//			[ "model" <modelname> ]
@@ -177,7 +206,7 @@ Doom3ModelSkinPtr Doom3SkinCache::parseSkin(parser::DefTokeniser& tok)
 		// this is a remap declaration
 		if (key == "model")
         {
-			_modelSkins[value].push_back(skinName);
+			models.push_back(value);
 		}
 		else
         {
@@ -204,6 +233,7 @@ const StringSet& Doom3SkinCache::getDependencies() const
 	if (_dependencies.empty())
     {
 		_dependencies.insert(MODULE_VIRTUALFILESYSTEM);
+		_dependencies.insert(MODULE_DECLARATION_SCHEDULER);
 	}
 
 	return _dependencies;
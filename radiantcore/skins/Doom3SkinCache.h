@@ -80,15 +80,27 @@ private:
     // Iterates over each skin file in the VFS skins/ folder
     void loadSkinFiles();
 
-    // Parse an individual skin declaration and add return the skin object
-    Doom3ModelSkinPtr parseSkin(parser::DefTokeniser& tokeniser);
-
-    /* Parse the provided istream as a .skin file, and add all skins found within
-    * to the internal data structures.
+    // A skin parsed on one of the loader threads, along with the models it's assigned to
+    struct ParsedSkin
+    {
+        Doom3ModelSkinPtr skin;
+        StringList models;
+    };
+    typedef std::vector<ParsedSkin> ParsedSkinFile;
+
+    // Parse an individual skin declaration and return the skin object,
+    // the names of the models listed in the decl are added to the given list
+    Doom3ModelSkinPtr parseSkin(parser::DefTokeniser& tokeniser, StringList& models);
+
+    /* Parse the provided contents of a .skin file and return all skins found within.
+    * This doesn't touch the internal data structures and can be called from any thread.
     *
     * @filename: This is for informational purposes only (error message display).
     */
-    void parseFile(std::istream& contents, const std::string& filename);
+    ParsedSkinFile parseFile(std::string_view contents, const std::string& filename);
+
+    // Add the parsed skins to the internal data structures, skipping already defined ones
+    void addSkins(const ParsedSkinFile& parsedFile, const std::string& filename);
 };
 
 } // namespace skins
@@ -0,0 +1,424 @@
+#include "ArchiveIndexCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "itextstream.h"
+#include "os/fs.h"
+#include "os/file.h"
+#include "stream/MappedFile.h"
+#include "util/Hash.h"
+
+namespace vfs
+{
+
+namespace
+{
+	const char Magic[8] = { 'D', 'R', 'V', 'F', 'S', 'I', 'D', 'X' };
+	const std::uint32_t ByteOrderMark = 0x01020304;
+
+	enum RecordType : std::uint32_t
+	{
+		DirectoryListing,
+		ArchiveIndex,
+	};
+
+	enum EntryFlags : std::uint32_t
+	{
+		EntryIsDirectory = 1 << 0,
+		EntryIsDeflated = 1 << 1,
+	};
+
+	std::uint64_t getKeyHash(std::uint32_t type, const std::string& path)
+	{
+		util::Hash64 hash;
+		hash.update(type);
+		hash.update(path);
+
+		return hash.getValue();
+	}
+
+	template<typename T>
+	void writeArray(std::ofstream& stream, const std::vector<T>& items)
+	{
+		if (!items.empty())
+		{
+			stream.write(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T));
+		}
+	}
+}
+
+// File layout: the Header, followed by the Record and Entry arrays, the hash table
+// (record index + 1 per slot, 0 marking empty slots) and the string data.
+// All numbers are stored in native byte order, which is checked on load.
+struct ArchiveIndexCache::Header
+{
+	char magic[8];
+	std::uint32_t byteOrderMark;
+	std::uint32_t version;
+	std::uint32_t numRecords;
+	std::uint32_t numEntries;
+	std::uint32_t hashTableSize; // power of two
+	std::uint32_t stringDataSize;
+};
+
+struct ArchiveIndexCache::Record
+{
+	std::uint32_t type;
+	std::uint32_t pathOffset;
+	std::uint32_t pathLength;
+	std::uint32_t firstEntry;
+	std::uint64_t size;
+	std::int64_t timestamp;
+	std::uint32_t numEntries;
+	std::uint32_t padding;
+};
+
+struct ArchiveIndexCache::Entry
+{
+	std::uint32_t nameOffset;
+	std::uint32_t nameLength;
+	std::uint32_t flags;
+	std::uint32_t position;
+	std::uint32_t compressedSize;
+	std::uint32_t uncompressedSize;
+};
+
+const std::uint32_t ArchiveIndexCache::Version = 1;
+
+ArchiveIndexCache::ArchiveIndexCache(const std::string& path) :
+	_path(path),
+	_header(nullptr),
+	_records(nullptr),
+	_entries(nullptr),
+	_hashTable(nullptr),
+	_strings(nullptr)
+{
+	loadFile();
+}
+
+ArchiveIndexCache::~ArchiveIndexCache()
+{}
+
+void ArchiveIndexCache::loadFile()
+{
+	static_assert(sizeof(Header) % 8 == 0, "The header needs to keep the records aligned");
+
+	if (!os::fileOrDirExists(_path))
+	{
+		return;
+	}
+
+	_file.reset(new stream::MappedFile(_path, stream::MappedFile::Access::Normal));
+
+	if (!_file->isOpen() || _file->size() < sizeof(Header))
+	{
+		_file.reset();
+		return;
+	}
+
+	auto header = reinterpret_cast<const Header*>(_file->data());
+
+	if (std::memcmp(header->magic, Magic, sizeof(Magic)) != 0 ||
+		header->byteOrderMark != ByteOrderMark || header->version != Version ||
+		header->hashTableSize == 0 || (header->hashTableSize & (header->hashTableSize - 1)) != 0)
+	{
+		rMessage() << "[vfs] Index cache " << _path << " is outdated, ignoring it." << std::endl;
+		_file.reset();
+		return;
+	}
+
+	std::uint64_t expectedSize = sizeof(Header) +
+		static_cast<std::uint64_t>(header->numRecords) * sizeof(Record) +
+		static_cast<std::uint64_t>(header->numEntries) * sizeof(Entry) +
+		static_cast<std::uint64_t>(header->hashTableSize) * sizeof(std::uint32_t) +
+		header->stringDataSize;
+
+	if (expectedSize != _file->size())
+	{
+		rWarning() << "[vfs] Index cache " << _path << " is damaged, ignoring it." << std::endl;
+		_file.reset();
+		return;
+	}
+
+	_header = header;
+	_records = reinterpret_cast<const Record*>(_header + 1);
+	_entries = reinterpret_cast<const Entry*>(_records + _header->numRecords);
+	_hashTable = reinterpret_cast<const std::uint32_t*>(_entries + _header->numEntries);
+	_strings = reinterpret_cast<const char*>(_hashTable + _header->hashTableSize);
+
+	_recordUsed.assign(_header->numRecords, false);
+}
+
+const ArchiveIndexCache::Record* ArchiveIndexCache::findRecord(std::uint32_t type, const std::string& path) const
+{
+	if (_header == nullptr)
+	{
+		return nullptr;
+	}
+
+	auto mask = _header->hashTableSize - 1;
+	auto hash = getKeyHash(type, path);
+
+	for (std::uint32_t i = 0; i < _header->hashTableSize; ++i)
+	{
+		auto value = _hashTable[(hash + i) & mask];
+
+		if (value == 0 || value > _header->numRecords)
+		{
+			return nullptr; // empty slot, not in the cache
+		}
+
+		const auto& record = _records[value - 1];
+
+		if (record.type == type && record.pathLength == path.size() && getString(record.pathOffset, record.pathLength) == path)
+		{
+			// Don't hand out any records pointing outside the cache
+			if (record.firstEntry > _header->numEntries || record.numEntries > _header->numEntries - record.firstEntry)
+			{
+				return nullptr;
+			}
+
+			return &record;
+		}
+	}
+
+	return nullptr;
+}
+
+std::string ArchiveIndexCache::getString(std::uint32_t offset, std::uint32_t length) const
+{
+	if (offset > _header->stringDataSize || length > _header->stringDataSize - offset)
+	{
+		return std::string();
+	}
+
+	return std::string(_strings + offset, length);
+}
+
+bool ArchiveIndexCache::getDirectoryListing(const std::string& path, std::int64_t timestamp, std::vector<std::string>& names)
+{
+	auto record = findRecord(DirectoryListing, path);
+
+	if (record == nullptr || record->timestamp != timestamp)
+	{
+		return false;
+	}
+
+	names.clear();
+	names.reserve(record->numEntries);
+
+	for (auto entry = _entries + record->firstEntry; entry != _entries + record->firstEntry + record->numEntries; ++entry)
+	{
+		names.emplace_back(getString(entry->nameOffset, entry->nameLength));
+	}
+
+	_recordUsed[record - _records] = true;
+	return true;
+}
+
+void ArchiveIndexCache::storeDirectoryListing(const std::string& path, std::int64_t timestamp, const std::vector<std::string>& names)
+{
+	PendingRecord record{ DirectoryListing, path, 0, timestamp };
+
+	record.entries.reserve(names.size());
+
+	for (const auto& name : names)
+	{
+		record.entries.push_back(archive::ZipArchive::IndexEntry{ name, false, false, 0, 0, 0 });
+	}
+
+	_pendingRecords.emplace_back(std::move(record));
+}
+
+bool ArchiveIndexCache::getArchiveIndex(const std::string& path, std::uint64_t size, std::int64_t timestamp, archive::ZipArchive::Index& index)
+{
+	auto record = findRecord(ArchiveIndex, path);
+
+	if (record == nullptr || record->size != size || record->timestamp != timestamp)
+	{
+		return false;
+	}
+
+	index.clear();
+	index.reserve(record->numEntries);
+
+	for (auto entry = _entries + record->firstEntry; entry != _entries + record->firstEntry + record->numEntries; ++entry)
+	{
+		index.push_back(archive::ZipArchive::IndexEntry{
+			getString(entry->nameOffset, entry->nameLength),
+			(entry->flags & EntryIsDirectory) != 0,
+			(entry->flags & EntryIsDeflated) != 0,
+			entry->position,
+			entry->compressedSize,
+			entry->uncompressedSize
+		});
+	}
+
+	_recordUsed[record - _records] = true;
+	return true;
+}
+
+void ArchiveIndexCache::storeArchiveIndex(const std::string& path, std::uint64_t size, std::int64_t timestamp, const archive::ZipArchive::Index& index)
+{
+	_pendingRecords.emplace_back(PendingRecord{ ArchiveIndex, path, size, timestamp, index });
+}
+
+void ArchiveIndexCache::save()
+{
+	if (_path.empty() || (_pendingRecords.empty() &&
+		std::find(_recordUsed.begin(), _recordUsed.end(), false) == _recordUsed.end()))
+	{
+		return; // cache is up to date
+	}
+
+	// Carry over the records which are still in use
+	for (std::uint32_t i = 0; i < _recordUsed.size(); ++i)
+	{
+		if (!_recordUsed[i]) continue;
+
+		const auto& record = _records[i];
+		auto path = getString(record.pathOffset, record.pathLength);
+		archive::ZipArchive::Index index;
+
+		if (record.type == DirectoryListing)
+		{
+			std::vector<std::string> names;
+			getDirectoryListing(path, record.timestamp, names);
+			storeDirectoryListing(path, record.timestamp, names);
+		}
+		else if (getArchiveIndex(path, record.size, record.timestamp, index))
+		{
+			storeArchiveIndex(path, record.size, record.timestamp, index);
+		}
+	}
+
+	// Assemble the file contents
+	std::vector<Record> records;
+	std::vector<Entry> entries;
+	std::string strings;
+
+	auto addString = [&](const std::string& str, std::uint32_t& offset, std::uint32_t& length)
+	{
+		offset = static_cast<std::uint32_t>(strings.size());
+		length = static_cast<std::uint32_t>(str.size());
+		strings.append(str);
+	};
+
+	for (const auto& pending : _pendingRecords)
+	{
+		Record record{ pending.type };
+
+		addString(pending.path, record.pathOffset, record.pathLength);
+		record.firstEntry = static_cast<std::uint32_t>(entries.size());
+		record.size = pending.size;
+		record.timestamp = pending.timestamp;
+		record.numEntries = static_cast<std::uint32_t>(pending.entries.size());
+		record.padding = 0;
+
+		for (const auto& pendingEntry : pending.entries)
+		{
+			Entry entry;
+
+			addString(pendingEntry.path, entry.nameOffset, entry.nameLength);
+			entry.flags = (pendingEntry.isDirectory ? EntryIsDirectory : 0) | (pendingEntry.isDeflated ? EntryIsDeflated : 0);
+			entry.position = pendingEntry.position;
+			entry.compressedSize = pendingEntry.compressedSize;
+			entry.uncompressedSize = pendingEntry.uncompressedSize;
+
+			entries.push_back(entry);
+		}
+
+		records.push_back(record);
+	}
+
+	_pendingRecords.clear();
+
+	if (strings.size() > std::numeric_limits<std::uint32_t>::max())
+	{
+		rWarning() << "[vfs] Too many files to write the index cache." << std::endl;
+		return;
+	}
+
+	// The hash table is kept at most half full
+	std::uint32_t hashTableSize = 8;
+
+	while (hashTableSize < records.size() * 2)
+	{
+		hashTableSize <<= 1;
+	}
+
+	std::vector<std::uint32_t> hashTable(hashTableSize, 0);
+
+	for (std::uint32_t i = 0; i < records.size(); ++i)
+	{
+		auto hash = getKeyHash(records[i].type, strings.substr(records[i].pathOffset, records[i].pathLength));
+
+		for (std::uint64_t slot = hash; ; ++slot)
+		{
+			if (hashTable[slot & (hashTableSize - 1)] == 0)
+			{
+				hashTable[slot & (hashTableSize - 1)] = i + 1;
+				break;
+			}
+		}
+	}
+
+	Header header;
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.byteOrderMark = ByteOrderMark;
+	header.version = Version;
+	header.numRecords = static_cast<std::uint32_t>(records.size());
+	header.numEntries = static_cast<std::uint32_t>(entries.size());
+	header.hashTableSize = hashTableSize;
+	header.stringDataSize = static_cast<std::uint32_t>(strings.size());
+
+	// Release the mapping, the file can't be replaced while it is mapped on some platforms
+	_header = nullptr;
+	_recordUsed.clear();
+	_file.reset();
+
+	fs::path cachePath = _path;
+	fs::path tempPath = _path + ".tmp";
+
+	try
+	{
+		fs::create_directories(cachePath.parent_path());
+
+		std::ofstream stream(tempPath.string(), std::ios::binary);
+
+		if (!stream.is_open())
+		{
+			throw std::runtime_error("Could not open file for writing");
+		}
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writeArray(stream, records);
+		writeArray(stream, entries);
+		writeArray(stream, hashTable);
+		stream.write(strings.data(), strings.size());
+		stream.close();
+
+		if (stream.fail())
+		{
+			throw std::runtime_error("Failure writing to file");
+		}
+
+		// Replace the old cache only after the new one has been written completely
+		fs::rename(tempPath, cachePath);
+
+		rMessage() << "[vfs] Wrote index cache with " << records.size() << " records to " << _path << std::endl;
+	}
+	catch (const std::exception& ex)
+	{
+		rWarning() << "[vfs] Failed to write index cache " << _path << ": " << ex.what() << std::endl;
+
+		// Don't leave any partially written files behind
+		std::remove(tempPath.string().c_str());
+	}
+}
+
+}
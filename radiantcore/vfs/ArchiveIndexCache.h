@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ZipArchive.h"
+
+namespace stream { class MappedFile; }
+
+namespace vfs
+{
+
+/**
+ * On-disk cache of the VFS structure, which saves the file system from
+ * scanning the search paths and reading the central directories of all
+ * the PK4 archives on startup.
+ *
+ * The cache stores the file listings of the search paths and the index of
+ * each archive, keyed by their path and tagged with the size and modification
+ * time they had when being cached. Stale entries are not returned, the caller
+ * is expected to look up the data the regular way and store it again.
+ *
+ * The cache file is mapped into memory and queried in place: a hash table
+ * is pointing to the records, whose names are referring to a flat string
+ * table holding the sorted paths of all the archive contents.
+ * Like the map snapshots it is machine-specific and not meant to be exchanged.
+ */
+class ArchiveIndexCache
+{
+public:
+	static const std::uint32_t Version;
+
+private:
+	std::string _path;
+
+	std::unique_ptr<stream::MappedFile> _file;
+
+	struct Header;
+	struct Record;
+	struct Entry;
+
+	// Pointers into the mapped file, null if there's no valid cache
+	const Header* _header;
+	const Record* _records;
+	const Entry* _entries;
+	const std::uint32_t* _hashTable;
+	const char* _strings;
+
+	// Which of the mapped records have been requested during this session
+	std::vector<bool> _recordUsed;
+
+	// Records added during this session, to be written on save()
+	struct PendingRecord
+	{
+		std::uint32_t type;
+		std::string path;
+		std::uint64_t size;
+		std::int64_t timestamp;
+		archive::ZipArchive::Index entries;
+	};
+	std::vector<PendingRecord> _pendingRecords;
+
+public:
+	// Loads the cache from the given file, a missing or invalid file results in an empty cache
+	ArchiveIndexCache(const std::string& path);
+	~ArchiveIndexCache();
+
+	// Returns the names of the files and folders in the given directory, as cached for the given timestamp.
+	// Returns false if there's no up to date listing of this directory.
+	bool getDirectoryListing(const std::string& path, std::int64_t timestamp, std::vector<std::string>& names);
+	void storeDirectoryListing(const std::string& path, std::int64_t timestamp, const std::vector<std::string>& names);
+
+	// Retrieves the index of the given archive, returns false if there's none matching the size and timestamp
+	bool getArchiveIndex(const std::string& path, std::uint64_t size, std::int64_t timestamp, archive::ZipArchive::Index& index);
+	void storeArchiveIndex(const std::string& path, std::uint64_t size, std::int64_t timestamp, const archive::ZipArchive::Index& index);
+
+	/**
+	 * Rewrites the cache file if anything has been stored since it has been loaded,
+	 * or if some cached records haven't been requested. The new file contains the
+	 * stored and the requested records only, so the cache doesn't grow over time.
+	 */
+	void save();
+
+private:
+	void loadFile();
+	const Record* findRecord(std::uint32_t type, const std::string& path) const;
+	std::string getString(std::uint32_t offset, std::uint32_t length) const;
+};
+
+}
@@ -1,35 +1,35 @@
 #pragma once
 
 #include "iarchive.h"
-#include "stream/FileInputStream.h"
+#include "stream/MappedFile.h"
 #include "DeflatedInputStream.h"
 
 namespace archive
 {
 
+/// \brief An ArchiveFile stored in a ZIP in DEFLATE format.
+/// The data is inflated right from the mapped archive.
 class DeflatedArchiveFile :
 	public ArchiveFile
 {
 private:
 	std::string _name;
-	stream::FileInputStream _istream;
-	stream::SubFileInputStream _substream;	// provides a subset of _istream
-	DeflatedInputStream _zipstream; // inflates data from _subStream
-	stream::FileInputStream::size_type _size;
+	std::shared_ptr<stream::MappedFile> _archive; // keeps the mapping alive
+	DeflatedInputStream _zipstream; // inflates data from the mapped archive
+	std::size_t _size;
 
 public:
-	typedef stream::FileInputStream::size_type size_type;
-	typedef stream::FileInputStream::position_type position_type;
+	typedef std::size_t size_type;
+	typedef std::size_t position_type;
 
 	DeflatedArchiveFile(const std::string& name,
-						const std::string& archiveName, // path to the ZIP file
+						const std::shared_ptr<stream::MappedFile>& archive,
 						position_type position,
 						size_type stream_size,
 						size_type file_size) :
 		_name(name),
-		_istream(archiveName),
-		_substream(_istream, position, stream_size),
-		_zipstream(_substream), 
+		_archive(archive),
+		_zipstream(reinterpret_cast<const InputStream::byte_type*>(archive->data() + position), stream_size),
 		_size(file_size)
 	{}
 
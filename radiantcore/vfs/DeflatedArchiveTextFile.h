@@ -2,7 +2,9 @@
 
 #include "iarchive.h"
 #include "iregistry.h"
+#include "stream/MappedFile.h"
 #include "stream/BinaryToTextInputStream.h"
+#include "DeflatedInputStream.h"
 
 namespace archive
 {
@@ -15,17 +17,16 @@ class DeflatedArchiveTextFile :
 {
 private:
 	std::string _name;
-	stream::FileInputStream _istream;
-	stream::SubFileInputStream _substream;	// reads subset of _istream
-	DeflatedInputStream _zipstream;	// inflates data from _substream
+	std::shared_ptr<stream::MappedFile> _archive; // keeps the mapping alive
+	DeflatedInputStream _zipstream;	// inflates data from the mapped archive
 	stream::BinaryToTextInputStream<DeflatedInputStream> _textStream; // converts data from _zipstream
 
     // Mod directory containing this file
     const std::string _modRoot;
 
 public:
-	typedef stream::FileInputStream::size_type size_type;
-	typedef stream::FileInputStream::position_type position_type;
+	typedef std::size_t size_type;
+	typedef std::size_t position_type;
 
     /**
      * Constructor.
@@ -34,14 +35,13 @@ public:
      * The name of the mod directory this file's archive is located in.
      */
     DeflatedArchiveTextFile(const std::string& name,
-                            const std::string& archiveName, // full path to ZIP file
+                            const std::shared_ptr<stream::MappedFile>& archive,
                             const std::string& modRoot,
                             position_type position,
                             size_type stream_size) : 
 		_name(name),
-		_istream(archiveName),
-		_substream(_istream, position, stream_size),
-		_zipstream(_substream),
+		_archive(archive),
+		_zipstream(reinterpret_cast<const InputStream::byte_type*>(archive->data() + position), stream_size),
 		_textStream(_zipstream),
 		_modRoot(modRoot)
     {}
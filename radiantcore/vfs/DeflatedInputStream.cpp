@@ -6,7 +6,7 @@ namespace archive
 {
 
 DeflatedInputStream::DeflatedInputStream(InputStream& istream) :
-	_istream(istream),
+	_istream(&istream),
 	_zipStream(new z_stream)
 {
 	_zipStream->zalloc = 0;
@@ -17,6 +17,21 @@ DeflatedInputStream::DeflatedInputStream(InputStream& istream) :
 	inflateInit2(_zipStream.get(), -MAX_WBITS);
 }
 
+DeflatedInputStream::DeflatedInputStream(const byte_type* data, size_type size) :
+	_istream(nullptr),
+	_zipStream(new z_stream)
+{
+	_zipStream->zalloc = 0;
+	_zipStream->zfree = 0;
+	_zipStream->opaque = 0;
+
+	// zlib won't write to the input, the pointer is just not declared const
+	_zipStream->next_in = const_cast<byte_type*>(data);
+	_zipStream->avail_in = static_cast<uInt>(size);
+
+	inflateInit2(_zipStream.get(), -MAX_WBITS);
+}
+
 DeflatedInputStream::~DeflatedInputStream()
 {
 	inflateEnd(_zipStream.get());
@@ -30,11 +45,11 @@ DeflatedInputStream::size_type DeflatedInputStream::read(byte_type* buffer, size
 
 	while (_zipStream->avail_out != 0)
 	{
-		if (_zipStream->avail_in == 0)
+		if (_zipStream->avail_in == 0 && _istream != nullptr)
 		{
 			// Load some data from the wrapped buffer and point z_stream to it
 			_zipStream->next_in = _buffer;
-			_zipStream->avail_in = static_cast<uInt>(_istream.read(_buffer, sizeof(_buffer)));
+			_zipStream->avail_in = static_cast<uInt>(_istream->read(_buffer, sizeof(_buffer)));
 		}
 
 		if (inflate(_zipStream.get(), Z_SYNC_FLUSH) != Z_OK)
@@ -14,17 +14,21 @@ namespace archive
 ///
 /// - Uses z_stream to decompress the data stream on the fly.
 /// - Uses a buffer to reduce the number of times the wrapped stream must be read.
+/// - Data already in memory (e.g. a mapped archive) is inflated in place without buffering.
 class DeflatedInputStream :
 	public InputStream
 {
 private:
-	InputStream& _istream;
+	InputStream* _istream;
 	std::unique_ptr<z_stream> _zipStream;
 	unsigned char _buffer[1024];
 
 public:
 	DeflatedInputStream(InputStream& istream);
 
+	// Inflates the given block of memory, which must stay valid during the lifetime of this stream
+	DeflatedInputStream(const byte_type* data, size_type size);
+
 	virtual ~DeflatedInputStream();
 
 	// InputStream implementation
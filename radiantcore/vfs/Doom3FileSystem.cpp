@@ -31,10 +31,12 @@
 #include "os/path.h"
 #include "os/dir.h"
 #include "os/file.h"
+#include "os/filekey.h"
 
 #include "string/split.h"
 #include "debugging/ScopedDebugTimer.h"
 
+#include "ArchiveIndexCache.h"
 #include "DirectoryArchive.h"
 #include "DirectoryArchiveFile.h"
 #include "DirectoryArchiveTextFile.h"
@@ -46,6 +48,17 @@
 namespace vfs
 {
 
+namespace
+{
+    const char* const INDEX_CACHE_FILENAME = "vfsindex.cache";
+}
+
+Doom3FileSystem::Doom3FileSystem()
+{}
+
+Doom3FileSystem::~Doom3FileSystem()
+{}
+
 void Doom3FileSystem::initDirectory(const std::string& inputPath)
 {
     // greebo: Normalise path: Replace backslashes and ensure trailing slash
@@ -66,27 +79,44 @@ void Doom3FileSystem::initDirectory(const std::string& inputPath)
     // Instantiate a new sorting container for the filenames
     SortedFilenames filenameList;
 
-    // Traverse the directory using the filename list as functor
-    try
+    // The directory's timestamp changes when files are added, removed or renamed
+    auto timestamp = _indexCache ? os::getModificationTimestamp(path) : 0;
+    std::vector<std::string> cachedNames;
+
+    if (timestamp != 0 && _indexCache->getDirectoryListing(path, timestamp, cachedNames))
     {
-        os::foreachItemInDirectory(path, [&](const fs::path& file)
-        {
-            try
-            {
-                // Just insert the name, it will get sorted correctly.
-                filenameList.insert(file.filename().string());
-            }
-            catch (std::system_error& ex)
-            {
-                rWarning() << "[vfs] Skipping file " << string::unicode_to_utf8(file.filename().wstring()) <<
-                    " - possibly unsupported characters in filename? " << 
-                    "(Exception: " << ex.what() << ")" << std::endl;
-            }
-        });
+        filenameList.insert(cachedNames.begin(), cachedNames.end());
     }
-    catch (os::DirectoryNotFoundException&)
+    else
     {
-        rError() << "[vfs] Directory '" << path << "' not found." << std::endl;
+        // Traverse the directory using the filename list as functor
+        try
+        {
+            os::foreachItemInDirectory(path, [&](const fs::path& file)
+            {
+                try
+                {
+                    // Just insert the name, it will get sorted correctly.
+                    filenameList.insert(file.filename().string());
+                }
+                catch (std::system_error& ex)
+                {
+                    rWarning() << "[vfs] Skipping file " << string::unicode_to_utf8(file.filename().wstring()) <<
+                        " - possibly unsupported characters in filename? " << 
+                        "(Exception: " << ex.what() << ")" << std::endl;
+                }
+            });
+        }
+        catch (os::DirectoryNotFoundException&)
+        {
+            rError() << "[vfs] Directory '" << path << "' not found." << std::endl;
+        }
+
+        if (timestamp != 0)
+        {
+            _indexCache->storeDirectoryListing(path, timestamp, 
+                std::vector<std::string>(filenameList.begin(), filenameList.end()));
+        }
     }
 
     if (filenameList.empty())
@@ -133,12 +163,23 @@ void Doom3FileSystem::initialise(const SearchPaths& vfsSearchPaths, const Extens
         _allowedExtensionsDir.insert(allowedExtension + "dir");
     }
 
+    if (!_indexCachePath.empty())
+    {
+        _indexCache.reset(new ArchiveIndexCache(_indexCachePath));
+    }
+
     // Initialise the paths, in the given order
     for (const std::string& path : _vfsSearchPaths)
     {
         initDirectory(path);
     }
 
+    if (_indexCache)
+    {
+        _indexCache->save();
+        _indexCache.reset();
+    }
+
     for (Observer* observer : _observers)
     {
         observer->onFileSystemInitialise();
@@ -219,6 +260,33 @@ ArchiveFilePtr Doom3FileSystem::openFile(const std::string& filename)
     return ArchiveFilePtr();
 }
 
+bool Doom3FileSystem::findFileInfo(const std::string& filename, const VisitorFunc& visitorFunc)
+{
+    for (const ArchiveDescriptor& descriptor : _archives)
+    {
+        if (!descriptor.archive->containsFile(filename))
+        {
+            continue;
+        }
+
+        // Both the directories and the PK4s are able to report the file details
+        auto infoProvider = std::dynamic_pointer_cast<IArchiveFileInfoProvider>(descriptor.archive);
+
+        if (infoProvider)
+        {
+            visitorFunc(FileInfo("", filename, Visibility::NORMAL, *infoProvider));
+        }
+        else
+        {
+            visitorFunc(FileInfo("", filename, Visibility::NORMAL));
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
 ArchiveFilePtr Doom3FileSystem::openFileInAbsolutePath(const std::string& filename)
 {
     std::shared_ptr<archive::DirectoryArchiveFile> file =
@@ -359,7 +427,7 @@ void Doom3FileSystem::initPakFile(const std::string& filename)
         ArchiveDescriptor entry;
 
         entry.name = filename;
-        entry.archive = std::make_shared<archive::ZipArchive>(filename);
+        entry.archive = openPakFile(filename);
         entry.is_pakfile = true;
         _archives.push_back(entry);
 
@@ -380,6 +448,35 @@ void Doom3FileSystem::initPakFile(const std::string& filename)
     }
 }
 
+IArchive::Ptr Doom3FileSystem::openPakFile(const std::string& filename)
+{
+    auto timestamp = _indexCache ? os::getModificationTimestamp(filename) : 0;
+
+    if (timestamp == 0)
+    {
+        return std::make_shared<archive::ZipArchive>(filename);
+    }
+
+    auto size = os::getFileSize(filename);
+    archive::ZipArchive::Index index;
+
+    if (_indexCache->getArchiveIndex(filename, size, timestamp, index))
+    {
+        return std::make_shared<archive::ZipArchive>(filename, index);
+    }
+
+    auto archive = std::make_shared<archive::ZipArchive>(filename);
+    index = archive->getIndex();
+
+    // Broken archives are not cached, they should keep reporting their errors
+    if (!index.empty())
+    {
+        _indexCache->storeArchiveIndex(filename, size, timestamp, index);
+    }
+
+    return archive;
+}
+
 const SearchPaths& Doom3FileSystem::getVfsSearchPaths()
 {
     // Should not be called before the list is initialised
@@ -407,6 +504,8 @@ const StringSet& Doom3FileSystem::getDependencies() const
 void Doom3FileSystem::initialiseModule(const IApplicationContext& ctx)
 {
     rMessage() << getName() << "::initialiseModule called" << std::endl;
+
+    _indexCachePath = ctx.getCacheDataPath() + INDEX_CACHE_FILENAME;
 }
 
 void Doom3FileSystem::shutdownModule()
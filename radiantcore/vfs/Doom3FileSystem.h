@@ -2,10 +2,13 @@
 
 #include "iarchive.h"
 #include "ifilesystem.h"
+#include <memory>
 
 namespace vfs
 {
 
+class ArchiveIndexCache;
+
 class Doom3FileSystem :
 	public VirtualFileSystem
 {
@@ -30,7 +33,14 @@ private:
 	typedef std::set<Observer*> ObserverList;
 	ObserverList _observers;
 
+	// Speeds up the initialisation, only alive during initialise()
+	std::string _indexCachePath;
+	std::unique_ptr<ArchiveIndexCache> _indexCache;
+
 public:
+	Doom3FileSystem();
+	~Doom3FileSystem();
+
 	void initialise(const SearchPaths& vfsSearchPaths, const ExtensionSet& allowedExtensions) override;
     bool isInitialised() const override;
 	void shutdown() override;
@@ -39,6 +49,7 @@ public:
 
 	int getFileCount(const std::string& filename) override;
 	ArchiveFilePtr openFile(const std::string& filename) override;
+	bool findFileInfo(const std::string& filename, const VisitorFunc& visitorFunc) override;
 	ArchiveTextFilePtr openTextFile(const std::string& filename) override;
 
 	ArchiveFilePtr openFileInAbsolutePath(const std::string& filename) override;
@@ -77,6 +88,7 @@ public:
 private:
 	void initDirectory(const std::string& path);
 	void initPakFile(const std::string& filename);
+	IArchive::Ptr openPakFile(const std::string& filename);
 };
 
 }
@@ -1,38 +1,38 @@
 #pragma once
 
 #include "iarchive.h"
+#include "stream/MappedFile.h"
+#include "stream/MemoryInputStream.h"
 
 namespace archive
 {
 
 /// \brief An ArchiveFile which is stored uncompressed as part of a larger archive file.
+/// The data is read right from the mapped archive, it is not copied or reopened.
 class StoredArchiveFile :
 	public ArchiveFile
 {
 private:
 	std::string _name;
-	stream::FileInputStream _filestream;
-	stream::SubFileInputStream _substream;	// provides a subset of _filestream
-	stream::FileInputStream::size_type _size;
+	std::shared_ptr<stream::MappedFile> _archive; // keeps the mapping alive
+	stream::MemoryInputStream _substream;	// the part of the mapped archive holding the file
 
 public:
-	typedef stream::FileInputStream::size_type size_type;
-	typedef stream::FileInputStream::position_type position_type;
+	typedef std::size_t size_type;
+	typedef std::size_t position_type;
 
 	StoredArchiveFile(const std::string& name,
-					  const std::string& archiveName, // full path to the archive file
+					  const std::shared_ptr<stream::MappedFile>& archive,
 					  position_type position,
-					  size_type stream_size,
-					  size_type file_size) : 
+					  size_type stream_size) :
 		_name(name),
-		_filestream(archiveName),
-		_substream(_filestream, position, stream_size),
-		_size(file_size)
+		_archive(archive),
+		_substream(archive->data() + position, stream_size)
 	{}
 
 	size_type size() const override
 	{
-		return _size;
+		return _substream.size();
 	}
 
 	const std::string& getName() const override
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "iarchive.h"
+#include "stream/MappedFile.h"
+#include "stream/MemoryInputStream.h"
 #include "stream/BinaryToTextInputStream.h"
 
 namespace archive
@@ -12,15 +14,15 @@ class StoredArchiveTextFile :
 {
 private:
 	std::string _name;
-	stream::FileInputStream _filestream;
-	stream::SubFileInputStream _substream; // provides a subset of _filestream
-	stream::BinaryToTextInputStream<stream::SubFileInputStream> _textStream; // converts data from _substream
+	std::shared_ptr<stream::MappedFile> _archive; // keeps the mapping alive
+	stream::MemoryInputStream _substream; // the part of the mapped archive holding the file
+	stream::BinaryToTextInputStream<stream::MemoryInputStream> _textStream; // converts data from _substream
 
 	// Mod root
 	std::string _modRoot;
 public:
-	typedef stream::FileInputStream::size_type size_type;
-	typedef stream::FileInputStream::position_type position_type;
+	typedef std::size_t size_type;
+	typedef std::size_t position_type;
 
 	/**
 	* Constructor.
@@ -29,13 +31,13 @@ public:
 	* Name of the mod directory containing this file.
 	*/
 	StoredArchiveTextFile(const std::string& name,
-						  const std::string& archiveName,
+						  const std::shared_ptr<stream::MappedFile>& archive,
 						  const std::string& modRoot,
 						  position_type position,
 						  size_type stream_size) : 
 		_name(name),
-		_filestream(archiveName),
-		_substream(_filestream, position, stream_size),
+		_archive(archive),
+		_substream(archive->data() + position, stream_size),
 		_textStream(_substream),
 		_modRoot(modRoot)
 	{}
@@ -8,6 +8,7 @@
 
 #include "os/fs.h"
 #include "os/path.h"
+#include "stream/MemoryInputStream.h"
 
 #include "ZipStreamUtils.h"
 #include "DeflatedArchiveFile.h"
@@ -32,9 +33,9 @@ public:
 ZipArchive::ZipArchive(const std::string& fullPath) :
 	_fullPath(fullPath),
 	_containingFolder(os::standardPathWithSlash(fs::path(_fullPath).remove_filename())),
-	_istream(_fullPath)
+	_mappedFile(std::make_shared<stream::MappedFile>(_fullPath, stream::MappedFile::Access::Normal))
 {
-	if (_istream.failed())
+	if (!_mappedFile->isOpen())
 	{
 		rError() << "Cannot open Zip file stream: " << _fullPath << std::endl;
 		return;
@@ -51,11 +52,57 @@ ZipArchive::ZipArchive(const std::string& fullPath) :
 	}
 }
 
+ZipArchive::ZipArchive(const std::string& fullPath, const Index& index) :
+	_fullPath(fullPath),
+	_containingFolder(os::standardPathWithSlash(fs::path(_fullPath).remove_filename())),
+	_mappedFile(std::make_shared<stream::MappedFile>(_fullPath, stream::MappedFile::Access::Normal))
+{
+	if (!_mappedFile->isOpen())
+	{
+		rError() << "Cannot open Zip file stream: " << _fullPath << std::endl;
+		return;
+	}
+
+	for (const auto& entry : index)
+	{
+		if (entry.isDirectory)
+		{
+			_filesystem[entry.path].getRecord().reset();
+			continue;
+		}
+
+		_filesystem[entry.path].getRecord() = std::make_shared<ZipRecord>(entry.position,
+			entry.compressedSize, entry.uncompressedSize,
+			entry.isDeflated ? ZipRecord::eDeflated : ZipRecord::eStored);
+	}
+}
+
 ZipArchive::~ZipArchive()
 {
 	_filesystem.clear();
 }
 
+ZipArchive::Index ZipArchive::getIndex()
+{
+	Index index;
+
+	for (auto& pair : _filesystem)
+	{
+		const auto& record = pair.second.getRecord();
+
+		if (!record)
+		{
+			index.push_back(IndexEntry{ pair.first.string(), true, false, 0, 0, 0 });
+			continue;
+		}
+
+		index.push_back(IndexEntry{ pair.first.string(), false, record->mode == ZipRecord::eDeflated,
+			record->position, record->stream_size, record->file_size });
+	}
+
+	return index;
+}
+
 ArchiveFilePtr ZipArchive::openFile(const std::string& name)
 {
 	ZipFileSystem::iterator i = _filesystem.find(name);
@@ -64,32 +111,20 @@ ArchiveFilePtr ZipArchive::openFile(const std::string& name)
 	{
 		const std::shared_ptr<ZipRecord>& file = i->second.getRecord();
 
-		stream::FileInputStream::size_type position = 0;
+		auto position = getFileDataPosition(*file);
 
+		if (position == 0)
 		{
-			// Guard against concurrent access
-			std::lock_guard<std::mutex> lock(_streamLock);
-
-			_istream.seek(file->position);
-
-			ZipFileHeader header;
-			stream::readZipFileHeader(_istream, header);
-
-			position = _istream.tell();
-
-			if (header.magic != ZIP_MAGIC_FILE_HEADER)
-			{
-				rError() << "Error reading zip file " << _fullPath << std::endl;
-				return ArchiveFilePtr();
-			}
+			rError() << "Error reading zip file " << _fullPath << std::endl;
+			return ArchiveFilePtr();
 		}
 
 		switch (file->mode)
 		{
 		case ZipRecord::eStored:
-			return std::make_shared<StoredArchiveFile>(name, _fullPath, position, file->stream_size, file->file_size);
+			return std::make_shared<StoredArchiveFile>(name, _mappedFile, position, file->stream_size);
 		case ZipRecord::eDeflated:
-			return std::make_shared<DeflatedArchiveFile>(name, _fullPath, position, file->stream_size, file->file_size);
+			return std::make_shared<DeflatedArchiveFile>(name, _mappedFile, position, file->stream_size, file->file_size);
 		}
 	}
 
@@ -104,15 +139,9 @@ ArchiveTextFilePtr ZipArchive::openTextFile(const std::string& name)
 	{
 		const std::shared_ptr<ZipRecord>& file = i->second.getRecord();
 
-		// Guard against concurrent access
-		std::lock_guard<std::mutex> lock(_streamLock);
-
-		_istream.seek(file->position);
-
-		ZipFileHeader header;
-		stream::readZipFileHeader(_istream, header);
+		auto position = getFileDataPosition(*file);
 
-		if (header.magic != ZIP_MAGIC_FILE_HEADER)
+		if (position == 0)
 		{
 			rError() << "Error reading zip file " << _fullPath << std::endl;
 			return ArchiveTextFilePtr();
@@ -122,12 +151,12 @@ ArchiveTextFilePtr ZipArchive::openTextFile(const std::string& name)
 		{
 		case ZipRecord::eStored:
 			return std::make_shared<StoredArchiveTextFile>(
-                name, _fullPath, _containingFolder, _istream.tell(), file->stream_size
+                name, _mappedFile, _containingFolder, position, file->stream_size
             );
 
 		case ZipRecord::eDeflated:
 			return std::make_shared<DeflatedArchiveTextFile>(
-                name, _fullPath, _containingFolder, _istream.tell(), file->stream_size
+                name, _mappedFile, _containingFolder, position, file->stream_size
             );
 		}
 	}
@@ -163,10 +192,40 @@ std::string ZipArchive::getArchivePath(const std::string& relativePath)
     return _fullPath;
 }
 
-void ZipArchive::readZipRecord()
+std::size_t ZipArchive::getFileDataPosition(const ZipRecord& record) const
+{
+	// The local header is read from the mapped file, which is safe to do from any thread
+	if (record.position + ZIP_FILE_HEADER_LENGTH > _mappedFile->size())
+	{
+		return 0;
+	}
+
+	stream::MemoryInputStream istream(_mappedFile->data(), _mappedFile->size());
+	istream.seek(record.position);
+
+	ZipFileHeader header;
+	stream::readZipFileHeader(istream, header);
+
+	if (header.magic != ZIP_MAGIC_FILE_HEADER)
+	{
+		return 0;
+	}
+
+	// The name and extras might have been cut off, don't trust the stream position
+	std::size_t position = record.position + ZIP_FILE_HEADER_LENGTH + header.nameLength + header.extras;
+
+	if (position + record.stream_size > _mappedFile->size())
+	{
+		return 0;
+	}
+
+	return position;
+}
+
+void ZipArchive::readZipRecord(SeekableInputStream& istream)
 {
 	ZipMagic magic;
-	stream::readZipMagic(_istream, magic);
+	stream::readZipMagic(istream, magic);
 
 	if (magic != ZIP_MAGIC_ROOT_DIR_ENTRY)
 	{
@@ -174,14 +233,14 @@ void ZipArchive::readZipRecord()
 	}
 
 	ZipVersion version_encoder;
-	stream::readZipVersion(_istream, version_encoder);
+	stream::readZipVersion(istream, version_encoder);
 	ZipVersion version_extract;
-	stream::readZipVersion(_istream, version_extract);
+	stream::readZipVersion(istream, version_extract);
 
 	//unsigned short flags =
-	stream::readLittleEndian<int16_t>(_istream);
+	stream::readLittleEndian<int16_t>(istream);
 	
-	uint16_t compression_mode = stream::readLittleEndian<uint16_t>(_istream);
+	uint16_t compression_mode = stream::readLittleEndian<uint16_t>(istream);
 
 	if (compression_mode != Z_DEFLATED && compression_mode != 0)
 	{
@@ -189,25 +248,25 @@ void ZipArchive::readZipRecord()
 	}
 
 	ZipDosTime dostime;
-	stream::readZipDosTime(_istream, dostime);
+	stream::readZipDosTime(istream, dostime);
 
 	//unsigned int crc32 =
-	stream::readLittleEndian<uint32_t>(_istream);
+	stream::readLittleEndian<uint32_t>(istream);
 	
-	uint32_t compressed_size = stream::readLittleEndian<uint32_t>(_istream);
-	uint32_t uncompressed_size = stream::readLittleEndian<uint32_t>(_istream);
-	uint16_t namelength = stream::readLittleEndian<uint16_t>(_istream);
-	uint16_t extras = stream::readLittleEndian<uint16_t>(_istream);
-	uint16_t comment = stream::readLittleEndian<uint16_t>(_istream);
+	uint32_t compressed_size = stream::readLittleEndian<uint32_t>(istream);
+	uint32_t uncompressed_size = stream::readLittleEndian<uint32_t>(istream);
+	uint16_t namelength = stream::readLittleEndian<uint16_t>(istream);
+	uint16_t extras = stream::readLittleEndian<uint16_t>(istream);
+	uint16_t comment = stream::readLittleEndian<uint16_t>(istream);
 
 	//unsigned short diskstart =
-	stream::readLittleEndian<uint16_t>(_istream);
+	stream::readLittleEndian<uint16_t>(istream);
 	//unsigned short filetype =
-	stream::readLittleEndian<uint16_t>(_istream);
+	stream::readLittleEndian<uint16_t>(istream);
 	//unsigned int filemode =
-	stream::readLittleEndian<uint32_t>(_istream);
+	stream::readLittleEndian<uint32_t>(istream);
 
-	uint32_t position = stream::readLittleEndian<uint32_t>(_istream);
+	uint32_t position = stream::readLittleEndian<uint32_t>(istream);
 
 	// greebo: Read the filename directly into a newly constructed std::string.
 
@@ -218,11 +277,11 @@ void ZipArchive::readZipRecord()
 
 	std::string path(namelength, '\0');
 
-	_istream.read(
-		reinterpret_cast<stream::FileInputStream::byte_type*>(const_cast<char*>(path.data())),
+	istream.read(
+		reinterpret_cast<InputStream::byte_type*>(const_cast<char*>(path.data())),
 		namelength);
 
-	_istream.seek(extras + comment, stream::FileInputStream::cur);
+	istream.seek(extras + comment, SeekableStream::cur);
 
 	if (os::isDirectory(path))
 	{
@@ -248,28 +307,33 @@ void ZipArchive::readZipRecord()
 
 void ZipArchive::loadZipFile()
 {
-	SeekableStream::position_type pos = findZipDiskTrailerPosition(_istream);
+	stream::MemoryInputStream istream(_mappedFile->data(), _mappedFile->size());
+
+	SeekableStream::position_type pos = findZipDiskTrailerPosition(istream);
 
 	if (pos == 0)
 	{
 		throw ZipFailureException("Unable to locate Zip disk trailer");
 	}
 
-	_istream.seek(pos);
+	istream.seek(pos);
 
 	ZipDiskTrailer trailer;
-	stream::readZipDiskTrailer(_istream, trailer);
+	stream::readZipDiskTrailer(istream, trailer);
 
 	if (trailer.magic != ZIP_MAGIC_DISK_TRAILER)
 	{
 		throw ZipFailureException("Invalid Zip Magic, maybe this is not a zip file?");
 	}
 
-	_istream.seek(trailer.rootseek);
+	if (istream.seek(trailer.rootseek) != 0)
+	{
+		throw ZipFailureException("Invalid Zip directory position");
+	}
 
 	for (unsigned short i = 0; i < trailer.entries; ++i)
 	{
-		readZipRecord();
+		readZipRecord(istream);
 	}
 }
 
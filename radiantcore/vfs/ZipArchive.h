@@ -2,8 +2,8 @@
 
 #include "iarchive.h"
 #include "GenericFileSystem.h"
-#include "stream/FileInputStream.h"
-#include <mutex>
+#include "idatastream.h"
+#include "stream/MappedFile.h"
 
 namespace archive
 {
@@ -16,6 +16,10 @@ namespace archive
  * physical directories.
  *
  * Archives are owned and instantiated by the GlobalFileSystem instance.
+ *
+ * The Zip file is mapped into memory, the opened files are reading their
+ * data directly from the mapped region. Any number of threads can open
+ * and read files at the same time, no locking is involved.
  */
 class ZipArchive final :
 	public IArchive,
@@ -52,13 +56,34 @@ private:
 	std::string _fullPath;			// the full path to the Zip file
 	std::string _containingFolder;  // the folder this Zip is located in
 	mutable std::string _modName;	// mod name, calculated based on the containing folder
-	stream::FileInputStream _istream;
-    std::mutex _streamLock;
+
+	// The mapped Zip file, shared with the files opened from it
+	std::shared_ptr<stream::MappedFile> _mappedFile;
 
 public:
+	// A file or directory as listed in the central directory of the archive
+	struct IndexEntry
+	{
+		std::string path;
+		bool isDirectory;
+		bool isDeflated;
+		uint32_t position;
+		uint32_t compressedSize;
+		uint32_t uncompressedSize;
+	};
+	typedef std::vector<IndexEntry> Index;
+
 	ZipArchive(const std::string& fullPath);
+
+	// Constructs the archive from an index retrieved from an earlier instance
+	// through getIndex(), the central directory is not read from the file.
+	ZipArchive(const std::string& fullPath, const Index& index);
+
 	virtual ~ZipArchive();
 
+	// Returns all files and directories of this archive, sorted by path
+	Index getIndex();
+
 	// Archive implementation
 	ArchiveFilePtr openFile(const std::string& name) override;
 	ArchiveTextFilePtr openTextFile(const std::string& name) override;
@@ -70,8 +95,12 @@ public:
     std::string getArchivePath(const std::string& relativePath) override;
 
 private:
-	void readZipRecord();
+	void readZipRecord(SeekableInputStream& stream);
 	void loadZipFile();
+
+	// Returns the position of the file data following the local header of the given record,
+	// or 0 if the header is damaged or the data is exceeding the archive
+	std::size_t getFileDataPosition(const ZipRecord& record) const;
 };
 
 }
@@ -0,0 +1,134 @@
+#include "RadiantTest.h"
+
+#include "ideclscheduler.h"
+#include "ieclass.h"
+#include "ifilesystem.h"
+#include "ParallelDefFileLoader.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace test
+{
+
+using DeclarationSchedulerTest = RadiantTest;
+
+TEST_F(DeclarationSchedulerTest, ParallelForVisitsEachIndexOnce)
+{
+    const std::size_t count = 1000;
+    std::vector<std::atomic<int>> visits(count);
+
+    GlobalDeclarationScheduler().parallelFor(count, [&](std::size_t i) { ++visits[i]; });
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        EXPECT_EQ(visits[i].load(), 1) << "Index " << i << " visited " << visits[i].load() << " times";
+    }
+}
+
+TEST_F(DeclarationSchedulerTest, NestedParallelFor)
+{
+    std::atomic<std::size_t> sum(0);
+
+    // The loop bodies are calling back into the scheduler, this must not deadlock
+    GlobalDeclarationScheduler().parallelFor(16, [&](std::size_t)
+    {
+        GlobalDeclarationScheduler().parallelFor(16, [&](std::size_t i) { sum += i; });
+    });
+
+    EXPECT_EQ(sum.load(), 16 * (15 * 16 / 2));
+}
+
+TEST_F(DeclarationSchedulerTest, ParallelForRethrowsException)
+{
+    std::atomic<std::size_t> visited(0);
+
+    EXPECT_THROW(GlobalDeclarationScheduler().parallelFor(100, [&](std::size_t i)
+    {
+        ++visited;
+
+        if (i == 50)
+        {
+            throw std::runtime_error("Test");
+        }
+    }), std::runtime_error);
+
+    // The remaining iterations are still executed
+    EXPECT_EQ(visited.load(), 100);
+}
+
+TEST_F(DeclarationSchedulerTest, ResultsAreMergedInFileOrder)
+{
+    util::ParallelDefFileLoader<std::string> loader("test");
+
+    GlobalFileSystem().forEachFile("materials/", "mtr",
+        [&](const vfs::FileInfo& fileInfo) { loader.addFile(fileInfo); }, 0);
+
+    ASSERT_GT(loader.getFiles().size(), 1);
+
+    std::vector<std::string> mergedFiles;
+
+    loader.load(
+        [](const vfs::FileInfo& fileInfo) { return fileInfo.name; },
+        [&](const vfs::FileInfo& fileInfo, const std::string& parsed)
+        {
+            EXPECT_EQ(parsed, fileInfo.name);
+            mergedFiles.push_back(parsed);
+        }
+    );
+
+    ASSERT_EQ(mergedFiles.size(), loader.getFiles().size());
+
+    for (std::size_t i = 0; i < mergedFiles.size(); ++i)
+    {
+        EXPECT_EQ(mergedFiles[i], loader.getFiles()[i].name);
+    }
+}
+
+TEST_F(DeclarationSchedulerTest, ParseErrorIsRethrownInFileOrder)
+{
+    util::ParallelDefFileLoader<std::string> loader("test");
+
+    GlobalFileSystem().forEachFile("materials/", "mtr",
+        [&](const vfs::FileInfo& fileInfo) { loader.addFile(fileInfo); }, 0);
+
+    ASSERT_GT(loader.getFiles().size(), 1);
+
+    // Let the second file fail, the first one should be merged before the exception arrives
+    auto failingFile = loader.getFiles()[1].name;
+    std::vector<std::string> mergedFiles;
+
+    EXPECT_THROW(loader.load(
+        [&](const vfs::FileInfo& fileInfo)
+        {
+            if (fileInfo.name == failingFile)
+            {
+                throw std::runtime_error("Test");
+            }
+
+            return fileInfo.name;
+        },
+        [&](const vfs::FileInfo&, const std::string& parsed) { mergedFiles.push_back(parsed); }
+    ), std::runtime_error);
+
+    ASSERT_EQ(mergedFiles.size(), 1);
+    EXPECT_EQ(mergedFiles[0], loader.getFiles()[0].name);
+}
+
+TEST_F(DeclarationSchedulerTest, ReloadedEntityClassIsUpdatedInPlace)
+{
+    auto eclass = GlobalEntityClassManager().findClass("dr:entity_using_modeldef");
+    ASSERT_TRUE(eclass);
+    EXPECT_EQ(eclass->getAttribute("random").getValue(), "1");
+
+    GlobalEntityClassManager().reloadDefs();
+
+    // Existing classes are parsed again instead of being replaced
+    auto reloaded = GlobalEntityClassManager().findClass("dr:entity_using_modeldef");
+    EXPECT_EQ(reloaded, eclass);
+    EXPECT_EQ(reloaded->getAttribute("random").getValue(), "1");
+    EXPECT_EQ(reloaded->getModelPath(), "just_an_md5.md5mesh");
+}
+
+}
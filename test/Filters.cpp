@@ -0,0 +1,207 @@
+#include "RadiantTest.h"
+
+#include "ifilter.h"
+#include "ientity.h"
+#include "ieclass.h"
+#include "ipatch.h"
+#include "imap.h"
+#include "ishaders.h"
+#include "iscenegraph.h"
+#include "algorithm/Scene.h"
+#include "algorithm/Primitives.h"
+
+namespace test
+{
+
+using FilterTest = RadiantTest;
+
+namespace
+{
+
+const std::string TEST_FILTER("Test Filter");
+
+// Adds and activates a filter with the given rules
+void activateTestFilter(const FilterRules& rules)
+{
+    EXPECT_TRUE(GlobalFilterSystem().addFilter(TEST_FILTER, rules));
+    GlobalFilterSystem().setFilterState(TEST_FILTER, true);
+}
+
+void removeTestFilter()
+{
+    GlobalFilterSystem().setFilterState(TEST_FILTER, false);
+    EXPECT_TRUE(GlobalFilterSystem().removeFilter(TEST_FILTER));
+}
+
+}
+
+TEST_F(FilterTest, RulesMatchWholeNames)
+{
+    activateTestFilter(
+    {
+        FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/common/.*", false),
+        FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/common/caulk", true),
+        FilterRule::Create(FilterRule::TYPE_TEXTURE, ".*_ed", false),
+        FilterRule::Create(FilterRule::TYPE_TEXTURE, ".*glass.*", false),
+        FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/(stone|wood)/[a-z]+[0-9]", false),
+        FilterRule::Create(FilterRule::TYPE_ENTITYCLASS, "monster_.*", false),
+        FilterRule::Create(FilterRule::TYPE_OBJECT, "patch", false),
+    });
+
+    auto& filterSystem = GlobalFilterSystem();
+
+    // Prefix rule, overridden by the literal
+    EXPECT_FALSE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/common/nodraw"));
+    EXPECT_TRUE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/common/caulk"));
+    EXPECT_FALSE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/common/caulk2"));
+
+    // Suffix and substring rules
+    EXPECT_FALSE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/tiles01_ed"));
+    EXPECT_TRUE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/tiles01_ed2"));
+    EXPECT_FALSE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/darkmod/glass/clear"));
+
+    // Regular expressions
+    EXPECT_FALSE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/stone/brick1"));
+    EXPECT_TRUE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/stone/brick"));
+    EXPECT_TRUE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/metal/plate1"));
+
+    EXPECT_FALSE(filterSystem.isVisible(FilterRule::TYPE_ENTITYCLASS, "monster_zombie"));
+    EXPECT_TRUE(filterSystem.isVisible(FilterRule::TYPE_ENTITYCLASS, "func_static"));
+
+    // Rules only apply to their own type
+    EXPECT_FALSE(filterSystem.isVisible(FilterRule::TYPE_OBJECT, "patch"));
+    EXPECT_TRUE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "patch"));
+    EXPECT_TRUE(filterSystem.isVisible(FilterRule::TYPE_ENTITYCLASS, "textures/common/nodraw"));
+
+    removeTestFilter();
+}
+
+TEST_F(FilterTest, ChangedRulesAreApplied)
+{
+    activateTestFilter({ FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/common/caulk", false) });
+
+    auto& filterSystem = GlobalFilterSystem();
+
+    EXPECT_FALSE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/common/caulk"));
+    EXPECT_TRUE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/common/nodraw"));
+
+    // Previously queried names must not return the cached values
+    filterSystem.setFilterRules(TEST_FILTER, { FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/common/nodraw", false) });
+
+    EXPECT_TRUE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/common/caulk"));
+    EXPECT_FALSE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/common/nodraw"));
+
+    // Deactivating the filter shows everything again
+    filterSystem.setFilterState(TEST_FILTER, false);
+    EXPECT_TRUE(filterSystem.isVisible(FilterRule::TYPE_TEXTURE, "textures/common/nodraw"));
+
+    EXPECT_TRUE(filterSystem.removeFilter(TEST_FILTER));
+}
+
+TEST_F(FilterTest, InvalidExpressionsDoNotMatch)
+{
+    activateTestFilter(
+    {
+        FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/(common", false),
+        FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/.*", false),
+        FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/[a-z", true),
+    });
+
+    EXPECT_FALSE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/common"));
+    EXPECT_FALSE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/[a-z"));
+
+    removeTestFilter();
+}
+
+TEST_F(FilterTest, ChangedRulesUpdateAffectedNodes)
+{
+    loadMap("altar.map");
+
+    auto root = GlobalSceneGraph().root();
+    auto patch = algorithm::findFirstPatchWithMaterial(root, "textures/brick_dark01");
+    auto light = algorithm::findFirstEntity(root, [](IEntityNode& entity)
+    {
+        return entity.getEntity().getKeyValue("classname") == "light_torchflame";
+    });
+    auto funcStatic = algorithm::findFirstEntity(root, [](IEntityNode& entity)
+    {
+        return entity.getEntity().getKeyValue("classname") == "func_static";
+    });
+
+    ASSERT_TRUE(patch && light && funcStatic);
+    EXPECT_FALSE(patch->isFiltered());
+    EXPECT_FALSE(light->isFiltered());
+
+    activateTestFilter(
+    {
+        FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/brick_dark01", false),
+    });
+
+    EXPECT_TRUE(patch->isFiltered());
+    EXPECT_FALSE(light->isFiltered());
+
+    GlobalFilterSystem().setFilterRules(TEST_FILTER,
+    {
+        FilterRule::Create(FilterRule::TYPE_ENTITYCLASS, "light_.*", false),
+    });
+
+    EXPECT_FALSE(patch->isFiltered());
+    EXPECT_TRUE(light->isFiltered());
+    EXPECT_FALSE(funcStatic->isFiltered());
+
+    // Child nodes of the hidden entity are filtered too
+    light->foreachNode([](const scene::INodePtr& child)
+    {
+        EXPECT_TRUE(child->isFiltered());
+        return true;
+    });
+
+    removeTestFilter();
+
+    EXPECT_FALSE(patch->isFiltered());
+    EXPECT_FALSE(light->isFiltered());
+}
+
+TEST_F(FilterTest, ChangedRulesUpdateMixedCaseFaces)
+{
+    // The material is known by its lower-case name, the faces use other spellings
+    ASSERT_EQ(GlobalMaterialManager().getMaterialForName("textures/common/caulk")->getName(), "textures/common/caulk");
+
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    auto mixedCase = algorithm::createCubicBrush(worldspawn, Vector3(0, 0, 0), "textures/Common/Caulk");
+    auto upperCase = algorithm::createCubicBrush(worldspawn, Vector3(256, 0, 0), "TEXTURES/COMMON/CAULK");
+
+    EXPECT_FALSE(mixedCase->isFiltered());
+    EXPECT_FALSE(upperCase->isFiltered());
+
+    activateTestFilter({ FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/common/caulk", false) });
+
+    EXPECT_TRUE(mixedCase->isFiltered());
+    EXPECT_TRUE(upperCase->isFiltered());
+
+    removeTestFilter();
+
+    EXPECT_FALSE(mixedCase->isFiltered());
+    EXPECT_FALSE(upperCase->isFiltered());
+}
+
+TEST_F(FilterTest, InsertedNodesAreFiltered)
+{
+    activateTestFilter({ FilterRule::Create(FilterRule::TYPE_ENTITYCLASS, "func_static", false) });
+
+    auto funcStatic = GlobalEntityModule().createEntity(GlobalEntityClassManager().findOrInsert("func_static", true));
+    auto light = GlobalEntityModule().createEntity(GlobalEntityClassManager().findOrInsert("light", false));
+
+    GlobalSceneGraph().root()->addChildNode(funcStatic);
+    GlobalSceneGraph().root()->addChildNode(light);
+
+    // No full update is needed for the new nodes
+    EXPECT_TRUE(funcStatic->isFiltered());
+    EXPECT_FALSE(light->isFiltered());
+
+    removeTestFilter();
+
+    EXPECT_FALSE(funcStatic->isFiltered());
+}
+
+}
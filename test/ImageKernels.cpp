@@ -0,0 +1,589 @@
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "ImageKernels.h"
+#include "math/FloatTools.h"
+#include "math/Vector3.h"
+
+namespace test
+{
+
+namespace
+{
+
+// The per-pixel loops the kernels have been replacing, the kernels must produce the same bytes
+namespace reference
+{
+
+inline byte* getPixel(byte* pixels, std::size_t width, std::size_t height, std::size_t x, std::size_t y)
+{
+    return pixels + (((((y + height) % height) * width) + ((x + width) % width)) * 4);
+}
+
+void heightmapToNormalmap(byte* in, byte* out, std::size_t width, std::size_t height, float scale)
+{
+    struct KernelElement
+    {
+        int x, y;
+        float w;
+    };
+
+    const int kernelSize = 6;
+    KernelElement kernel_du[kernelSize] = {
+        {-1, 1,-1.0f },
+        {-1, 0,-1.0f },
+        {-1,-1,-1.0f },
+        { 1, 1, 1.0f },
+        { 1, 0, 1.0f },
+        { 1,-1, 1.0f }
+    };
+    KernelElement kernel_dv[kernelSize] = {
+        {-1, 1, 1.0f },
+        { 0, 1, 1.0f },
+        { 1, 1, 1.0f },
+        {-1,-1,-1.0f },
+        { 0,-1,-1.0f },
+        { 1,-1,-1.0f }
+    };
+
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+        {
+            float du = 0;
+            for (KernelElement* i = kernel_du; i != kernel_du + kernelSize; ++i) {
+                du += (getPixel(in, width, height, x + (*i).x, y + (*i).y)[0] / 255.0f) * (*i).w;
+            }
+            float dv = 0;
+            for (KernelElement* i = kernel_dv; i != kernel_dv + kernelSize; ++i) {
+                dv += (getPixel(in, width, height, x + (*i).x, y + (*i).y)[0] / 255.0f) * (*i).w;
+            }
+
+            float nx = -du * scale;
+            float ny = -dv * scale;
+            float nz = 1.0;
+
+            // The unqualified sqrt() has been resolving to the double overload
+            float norm = 1.0f/std::sqrt(static_cast<double>(nx*nx + ny*ny + nz*nz));
+            out[0] = static_cast<byte>(float_to_integer(((nx * norm) + 1) * 127.5));
+            out[1] = static_cast<byte>(float_to_integer(((ny * norm) + 1) * 127.5));
+            out[2] = static_cast<byte>(float_to_integer(((nz * norm) + 1) * 127.5));
+            out[3] = 255;
+
+            out += 4;
+        }
+    }
+}
+
+void addNormals(const byte* pixOne, const byte* pixTwo, byte* pixOut, std::size_t width, std::size_t height)
+{
+    for (std::size_t i = 0; i < width * height; ++i)
+    {
+        Vector3 vectorOne(pixOne[0], pixOne[1], pixOne[2]);
+        Vector3 vectorTwo(pixTwo[0], pixTwo[1], pixTwo[2]);
+        Vector3 vectorOut = (vectorOne + vectorTwo) * 0.5;
+
+        pixOut[0] = static_cast<byte>(float_to_integer(vectorOut.x()));
+        pixOut[1] = static_cast<byte>(float_to_integer(vectorOut.y()));
+        pixOut[2] = static_cast<byte>(float_to_integer(vectorOut.z()));
+        pixOut[3] = 255;
+
+        pixOne += 4;
+        pixTwo += 4;
+        pixOut += 4;
+    }
+}
+
+void smoothNormals(byte* in, byte* out, std::size_t width, std::size_t height)
+{
+    struct KernelElement
+    {
+        int dx, dy;
+    };
+
+    const int kernelSize = 9;
+    KernelElement kernel[kernelSize] = {
+        {-1, -1 },
+        { 0, -1 },
+        { 1, -1 },
+        { 1,  0 },
+        { 1,  1 },
+        { 0,  1 },
+        {-1,  1 },
+        {-1,  0 },
+        { 0,  0 }
+    };
+    const float perKernelSize = 1.0f/kernelSize;
+
+    for (std::size_t y = 0; y < height; y++)
+    {
+        for (std::size_t x = 0; x < width; x++)
+        {
+            Vector3 smoothVector(0,0,0);
+
+            for (KernelElement* i = kernel; i != kernel + kernelSize; ++i)
+            {
+                byte* pixel = getPixel(in, width, height, x + i->dx, y + i->dy);
+                smoothVector += Vector3(pixel[0], pixel[1], pixel[2]);
+            }
+
+            smoothVector *= perKernelSize;
+
+            out[0] = static_cast<byte>(float_to_integer(smoothVector.x()));
+            out[1] = static_cast<byte>(float_to_integer(smoothVector.y()));
+            out[2] = static_cast<byte>(float_to_integer(smoothVector.z()));
+            out[3] = 255;
+
+            out += 4;
+        }
+    }
+}
+
+void add(const byte* pixOne, const byte* pixTwo, byte* pixOut, std::size_t width, std::size_t height)
+{
+    for (std::size_t i = 0; i < width * height; ++i)
+    {
+        pixOut[0] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[0]) + pixTwo[0]) * 0.5f));
+        pixOut[1] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[1]) + pixTwo[1]) * 0.5f));
+        pixOut[2] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[2]) + pixTwo[2]) * 0.5f));
+        pixOut[3] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[3]) + pixTwo[3]) * 0.5f));
+
+        pixOne += 4;
+        pixTwo += 4;
+        pixOut += 4;
+    }
+}
+
+void scale(const byte* in, byte* out, std::size_t width, std::size_t height, const float factors[4])
+{
+    for (std::size_t i = 0; i < width * height; ++i)
+    {
+        int red = float_to_integer(static_cast<float>(in[0]) * factors[0]);
+        out[0] = (red>255) ? 255 : static_cast<byte>(red);
+
+        int green = float_to_integer(static_cast<float>(in[1]) * factors[1]);
+        out[1] = (green>255) ? 255 : static_cast<byte>(green);
+
+        int blue = float_to_integer(static_cast<float>(in[2]) * factors[2]);
+        out[2] = (blue>255) ? 255 : static_cast<byte>(blue);
+
+        int alpha = float_to_integer(static_cast<float>(in[3]) * factors[3]);
+        out[3] = (alpha>255) ? 255 : static_cast<byte>(alpha);
+
+        in += 4;
+        out += 4;
+    }
+}
+
+void invertAlpha(const byte* in, byte* out, std::size_t width, std::size_t height)
+{
+    for (std::size_t i = 0; i < width * height; ++i, in += 4, out += 4)
+    {
+        out[0] = in[0];
+        out[1] = in[1];
+        out[2] = in[2];
+        out[3] = 255 - in[3];
+    }
+}
+
+void invertColor(const byte* in, byte* out, std::size_t width, std::size_t height)
+{
+    for (std::size_t i = 0; i < width * height; ++i, in += 4, out += 4)
+    {
+        out[0] = 255 - in[0];
+        out[1] = 255 - in[1];
+        out[2] = 255 - in[2];
+        out[3] = in[3];
+    }
+}
+
+void makeIntensity(const byte* in, byte* out, std::size_t width, std::size_t height)
+{
+    for (std::size_t i = 0; i < width * height; ++i, in += 4, out += 4)
+    {
+        out[0] = in[0];
+        out[1] = in[0];
+        out[2] = in[0];
+        out[3] = in[0];
+    }
+}
+
+void makeAlpha(const byte* in, byte* out, std::size_t width, std::size_t height)
+{
+    for (std::size_t i = 0; i < width * height; ++i, in += 4, out += 4)
+    {
+        out[0] = 255;
+        out[1] = 255;
+        out[2] = 255;
+        out[3] = (in[0] + in[1] + in[2])/3;
+    }
+}
+
+void resampleLerpLine(const byte *in, byte *out, std::size_t inwidth, std::size_t outwidth, int bytesperpixel)
+{
+    std::size_t j, xi, oldx = 0, f, lerp;
+    std::size_t fstep = static_cast<std::size_t>(inwidth * 65536.0f / outwidth);
+    std::size_t endx = (inwidth - 1);
+    std::size_t bpp = bytesperpixel;
+
+    for (j = 0, f = 0; j < outwidth; j++, f += fstep)
+    {
+        xi = f >> 16;
+        if (xi != oldx) {
+            in += (xi - oldx) * bpp;
+            oldx = xi;
+        }
+
+        if (xi < endx) {
+            lerp = f & 0xFFFF;
+            for (std::size_t c = 0; c < bpp; ++c)
+            {
+                *out++ = (byte) ((((in[c + bpp] - in[c]) * lerp) >> 16) + in[c]);
+            }
+        }
+        else
+        {
+            for (std::size_t c = 0; c < bpp; ++c)
+            {
+                *out++ = in[c];
+            }
+        }
+    }
+}
+
+void resample(const byte* indata, std::size_t inwidth, std::size_t inheight,
+    byte* out, std::size_t outwidth, std::size_t outheight, int bytesperpixel)
+{
+    std::size_t bpp = bytesperpixel;
+    std::vector<byte> row1(outwidth * bpp);
+    std::vector<byte> row2(outwidth * bpp);
+
+    std::size_t i, yi, oldy, f, fstep, lerp, endy = (inheight-1), inwidthB = inwidth*bpp, outwidthB = outwidth*bpp;
+    fstep = (int) (inheight * 65536.0f / outheight);
+
+    const byte* inrow = indata;
+    oldy = 0;
+    resampleLerpLine(inrow, row1.data(), inwidth, outwidth, bytesperpixel);
+
+    if (inheight > 1)
+    {
+        resampleLerpLine(inrow + inwidthB, row2.data(), inwidth, outwidth, bytesperpixel);
+    }
+
+    for (i = 0, f = 0; i < outheight; i++, f += fstep)
+    {
+        yi = f >> 16;
+        if (yi < endy) {
+            lerp = f & 0xFFFF;
+            if (yi != oldy) {
+                inrow = indata + inwidthB * yi;
+                if (yi == oldy+1)
+                    memcpy(row1.data(), row2.data(), outwidthB);
+                else
+                    resampleLerpLine(inrow, row1.data(), inwidth, outwidth, bytesperpixel);
+
+                resampleLerpLine(inrow + inwidthB, row2.data(), inwidth, outwidth, bytesperpixel);
+                oldy = yi;
+            }
+            for (std::size_t b = 0; b < outwidthB; ++b)
+            {
+                out[b] = (byte) ((((row2[b] - row1[b]) * lerp) >> 16) + row1[b]);
+            }
+            out += outwidthB;
+        }
+        else {
+            if (yi != oldy) {
+                inrow = indata + inwidthB*yi;
+                if (yi == oldy+1)
+                    memcpy(row1.data(), row2.data(), outwidthB);
+                else
+                    resampleLerpLine(inrow, row1.data(), inwidth, outwidth, bytesperpixel);
+
+                oldy = yi;
+            }
+            memcpy(out, row1.data(), outwidthB);
+            out += outwidthB;
+        }
+    }
+}
+
+void mipReduce(byte *in, byte *out, std::size_t width, std::size_t height,
+    std::size_t destwidth, std::size_t destheight)
+{
+    std::size_t x, y, width2, height2, nextrow;
+    if (width > destwidth) {
+        if (height > destheight) {
+            width2 = width >> 1;
+            height2 = height >> 1;
+            nextrow = width << 2;
+            for (y = 0;y < height2;y++) {
+                for (x = 0;x < width2;x++) {
+                    out[0] = (byte) ((in[0] + in[4] + in[nextrow  ] + in[nextrow+4]) >> 2);
+                    out[1] = (byte) ((in[1] + in[5] + in[nextrow+1] + in[nextrow+5]) >> 2);
+                    out[2] = (byte) ((in[2] + in[6] + in[nextrow+2] + in[nextrow+6]) >> 2);
+                    out[3] = (byte) ((in[3] + in[7] + in[nextrow+3] + in[nextrow+7]) >> 2);
+                    out += 4;
+                    in += 8;
+                }
+                in += nextrow;
+            }
+        }
+        else {
+            width2 = width >> 1;
+            for (y = 0;y < height;y++) {
+                for (x = 0;x < width2;x++) {
+                    out[0] = (byte) ((in[0] + in[4]) >> 1);
+                    out[1] = (byte) ((in[1] + in[5]) >> 1);
+                    out[2] = (byte) ((in[2] + in[6]) >> 1);
+                    out[3] = (byte) ((in[3] + in[7]) >> 1);
+                    out += 4;
+                    in += 8;
+                }
+            }
+        }
+    }
+    else if (height > destheight) {
+        height2 = height >> 1;
+        nextrow = width << 2;
+        for (y = 0;y < height2;y++) {
+            for (x = 0;x < width;x++) {
+                out[0] = (byte) ((in[0] + in[nextrow  ]) >> 1);
+                out[1] = (byte) ((in[1] + in[nextrow+1]) >> 1);
+                out[2] = (byte) ((in[2] + in[nextrow+2]) >> 1);
+                out[3] = (byte) ((in[3] + in[nextrow+3]) >> 1);
+                out += 4;
+                in += 4;
+            }
+            in += nextrow;
+        }
+    }
+}
+
+}
+
+struct Size
+{
+    std::size_t width;
+    std::size_t height;
+};
+
+// Covers the scalar borders, the SIMD remainders and images processed by several tasks
+const Size IMAGE_SIZES[] = {
+    { 1, 1 }, { 1, 7 }, { 7, 1 }, { 2, 3 }, { 5, 3 }, { 6, 6 }, { 7, 9 },
+    { 17, 13 }, { 64, 64 }, { 129, 31 }, { 300, 257 }, { 1024, 80 }
+};
+
+std::vector<byte> createRandomImage(std::size_t width, std::size_t height, unsigned int seed, int bytesPerPixel = 4)
+{
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> distribution(0, 255);
+
+    std::vector<byte> pixels(width * height * bytesPerPixel);
+
+    for (auto& pixel : pixels)
+    {
+        pixel = static_cast<byte>(distribution(generator));
+    }
+
+    return pixels;
+}
+
+// Returns the index of the first differing byte, or -1 if the buffers are equal
+long findMismatch(const std::vector<byte>& expected, const std::vector<byte>& actual)
+{
+    for (std::size_t i = 0; i < expected.size(); ++i)
+    {
+        if (expected[i] != actual[i])
+        {
+            return static_cast<long>(i);
+        }
+    }
+
+    return -1;
+}
+
+template<typename Reference, typename Kernel>
+void expectSameUnaryResult(const Reference& reference, const Kernel& kernel)
+{
+    unsigned int seed = 0;
+
+    for (const auto& size : IMAGE_SIZES)
+    {
+        auto in = createRandomImage(size.width, size.height, ++seed);
+        std::vector<byte> expected(in.size());
+        std::vector<byte> actual(in.size());
+
+        reference(in.data(), expected.data(), size.width, size.height);
+        kernel(in.data(), actual.data(), size.width, size.height);
+
+        EXPECT_EQ(findMismatch(expected, actual), -1) << "Mismatch in " << size.width << "x" << size.height;
+    }
+}
+
+template<typename Reference, typename Kernel>
+void expectSameBinaryResult(const Reference& reference, const Kernel& kernel)
+{
+    unsigned int seed = 100;
+
+    for (const auto& size : IMAGE_SIZES)
+    {
+        auto one = createRandomImage(size.width, size.height, ++seed);
+        auto two = createRandomImage(size.width, size.height, ++seed);
+        std::vector<byte> expected(one.size());
+        std::vector<byte> actual(one.size());
+
+        reference(one.data(), two.data(), expected.data(), size.width, size.height);
+        kernel(one.data(), two.data(), actual.data(), size.width, size.height);
+
+        EXPECT_EQ(findMismatch(expected, actual), -1) << "Mismatch in " << size.width << "x" << size.height;
+    }
+}
+
+}
+
+TEST(ImageKernels, HeightmapToNormalmap)
+{
+    for (float scale : { 0.0f, 1.0f, 2.5f, -3.0f, 100.0f })
+    {
+        expectSameUnaryResult(
+            [&](byte* in, byte* out, std::size_t w, std::size_t h) { reference::heightmapToNormalmap(in, out, w, h, scale); },
+            [&](byte* in, byte* out, std::size_t w, std::size_t h) { image::heightmapToNormalmap(in, out, w, h, scale); });
+    }
+}
+
+TEST(ImageKernels, AddNormals)
+{
+    expectSameBinaryResult(reference::addNormals, image::addNormals);
+}
+
+TEST(ImageKernels, SmoothNormals)
+{
+    expectSameUnaryResult(reference::smoothNormals, image::smoothNormals);
+}
+
+TEST(ImageKernels, Add)
+{
+    expectSameBinaryResult(reference::add, image::add);
+}
+
+TEST(ImageKernels, Scale)
+{
+    const float factors[][4] = {
+        { 1, 1, 1, 1 },
+        { 0, 0.5f, 1.3f, 2 },
+        { 0.25f, 0.75f, 0.1f, 0.9f },
+        { 300, 1e6f, 1, 0 },
+    };
+
+    for (const auto& factor : factors)
+    {
+        expectSameUnaryResult(
+            [&](const byte* in, byte* out, std::size_t w, std::size_t h) { reference::scale(in, out, w, h, factor); },
+            [&](const byte* in, byte* out, std::size_t w, std::size_t h) { image::scale(in, out, w, h, factor); });
+    }
+}
+
+TEST(ImageKernels, Invert)
+{
+    expectSameUnaryResult(reference::invertAlpha,
+        [&](const byte* in, byte* out, std::size_t w, std::size_t h) { image::invert(in, out, w, h, false, true); });
+
+    expectSameUnaryResult(reference::invertColor,
+        [&](const byte* in, byte* out, std::size_t w, std::size_t h) { image::invert(in, out, w, h, true, false); });
+}
+
+TEST(ImageKernels, MakeIntensityAndAlpha)
+{
+    expectSameUnaryResult(reference::makeIntensity, image::makeIntensity);
+    expectSameUnaryResult(reference::makeAlpha, image::makeAlpha);
+}
+
+TEST(ImageKernels, Resample)
+{
+    const Size targetSizes[] = { { 1, 1 }, { 2, 8 }, { 16, 16 }, { 64, 32 }, { 512, 256 } };
+    unsigned int seed = 200;
+
+    for (int bytesPerPixel : { 3, 4 })
+    {
+        for (const auto& size : IMAGE_SIZES)
+        {
+            auto in = createRandomImage(size.width, size.height, ++seed, bytesPerPixel);
+
+            for (const auto& target : targetSizes)
+            {
+                std::vector<byte> expected(target.width * target.height * bytesPerPixel);
+                std::vector<byte> actual(expected.size());
+
+                reference::resample(in.data(), size.width, size.height,
+                    expected.data(), target.width, target.height, bytesPerPixel);
+                image::resample(in.data(), size.width, size.height,
+                    actual.data(), target.width, target.height, bytesPerPixel);
+
+                EXPECT_EQ(findMismatch(expected, actual), -1) << "Mismatch resampling " <<
+                    size.width << "x" << size.height << " to " << target.width << "x" << target.height <<
+                    " with " << bytesPerPixel << " bytes per pixel";
+            }
+        }
+    }
+}
+
+TEST(ImageKernels, MipReduce)
+{
+    // The TextureManipulator is only reducing power-of-two images
+    const Size sizes[] = { { 1, 1 }, { 2, 2 }, { 2, 16 }, { 16, 2 }, { 8, 8 }, { 64, 128 }, { 1024, 512 } };
+    unsigned int seed = 300;
+
+    for (const auto& size : sizes)
+    {
+        for (const auto& dest : { Size{ 0, 0 }, Size{ size.width, 0 }, Size{ 0, size.height } })
+        {
+            auto in = createRandomImage(size.width, size.height, ++seed);
+
+            std::vector<byte> expected(in);
+            reference::mipReduce(expected.data(), expected.data(), size.width, size.height, dest.width, dest.height);
+
+            // In place like the TextureManipulator
+            std::vector<byte> inPlace(in);
+            image::mipReduce(inPlace.data(), inPlace.data(), size.width, size.height, dest.width, dest.height);
+
+            EXPECT_EQ(findMismatch(expected, inPlace), -1) << "Mismatch reducing " <<
+                size.width << "x" << size.height << " to " << dest.width << "x" << dest.height << " in place";
+
+            // Into a separate buffer, processed in parallel
+            std::vector<byte> separate(in);
+            image::mipReduce(in.data(), separate.data(), size.width, size.height, dest.width, dest.height);
+
+            EXPECT_EQ(findMismatch(expected, separate), -1) << "Mismatch reducing " <<
+                size.width << "x" << size.height << " to " << dest.width << "x" << dest.height;
+        }
+    }
+}
+
+TEST(ImageKernels, ApplyTable)
+{
+    byte table[256];
+
+    for (int i = 0; i < 256; ++i)
+    {
+        table[i] = static_cast<byte>(255 - i / 2);
+    }
+
+    auto pixels = createRandomImage(300, 257, 400);
+    auto expected = pixels;
+
+    for (std::size_t i = 0; i < expected.size(); i += 4)
+    {
+        expected[i] = table[expected[i]];
+        expected[i + 1] = table[expected[i + 1]];
+        expected[i + 2] = table[expected[i + 2]];
+    }
+
+    image::applyTable(pixels.data(), 300, 257, table);
+
+    EXPECT_EQ(findMismatch(expected, pixels), -1);
+}
+
+}
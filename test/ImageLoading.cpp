@@ -0,0 +1,168 @@
+#include "RadiantTest.h"
+
+#include <cstring>
+#include <vector>
+
+#include "iimage.h"
+#include "ImageKernels.h"
+#include "PixelBufferPool.h"
+#include "RGBAImage.h"
+
+namespace test
+{
+
+using ImageLoadingTest = RadiantTest;
+
+namespace
+{
+
+const std::vector<std::string> TEST_IMAGES
+{
+    "textures/tiles01_ed",      // jpg, 64x64
+    "lights/biground1",         // tga
+    "textures/brick_dark01_ed", // jpg
+    "textures/this_is_missing",
+};
+
+bool pixelsAreEqual(const ImagePtr& a, const ImagePtr& b)
+{
+    return a->getWidth() == b->getWidth() && a->getHeight() == b->getHeight() &&
+        std::memcmp(a->getPixels(), b->getPixels(), a->getWidth() * a->getHeight() * 4) == 0;
+}
+
+}
+
+TEST_F(ImageLoadingTest, BatchLoadMatchesSingleLoad)
+{
+    auto images = GlobalImageLoader().imagesFromVFS(TEST_IMAGES);
+
+    ASSERT_EQ(images.size(), TEST_IMAGES.size());
+
+    for (std::size_t i = 0; i < TEST_IMAGES.size(); ++i)
+    {
+        auto expected = GlobalImageLoader().imageFromVFS(TEST_IMAGES[i]);
+
+        if (!expected)
+        {
+            EXPECT_FALSE(images[i]) << TEST_IMAGES[i] << " should not have been loaded";
+            continue;
+        }
+
+        ASSERT_TRUE(images[i]) << TEST_IMAGES[i] << " has not been loaded";
+        EXPECT_FALSE(images[i]->isPrecompressed());
+        EXPECT_TRUE(pixelsAreEqual(images[i], expected)) << "Pixel mismatch in " << TEST_IMAGES[i];
+    }
+
+    // The missing image is the only one which is empty
+    EXPECT_TRUE(images[0] && images[1] && images[2]);
+    EXPECT_FALSE(images[3]);
+}
+
+TEST_F(ImageLoadingTest, BatchLoadWithMipMapChain)
+{
+    auto images = GlobalImageLoader().imagesFromVFS(TEST_IMAGES, true);
+
+    ASSERT_EQ(images.size(), TEST_IMAGES.size());
+    EXPECT_FALSE(images[3]);
+
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        auto expected = GlobalImageLoader().imageFromVFS(TEST_IMAGES[i]);
+
+        ASSERT_TRUE(images[i]) << TEST_IMAGES[i] << " has not been loaded";
+        EXPECT_TRUE(images[i]->isPrecompressed()) << "Mipmapped images are not supposed to be processed further";
+
+        // The reported size is the one of the decoded image
+        EXPECT_EQ(images[i]->getWidth(), expected->getWidth());
+        EXPECT_EQ(images[i]->getHeight(), expected->getHeight());
+    }
+
+    // A power-of-two image is stored unchanged as first mipmap
+    auto expected = GlobalImageLoader().imageFromVFS(TEST_IMAGES[0]);
+    auto width = expected->getWidth();
+    auto height = expected->getHeight();
+
+    ASSERT_EQ(width, 64);
+    ASSERT_EQ(height, 64);
+    EXPECT_EQ(std::memcmp(images[0]->getPixels(), expected->getPixels(), width * height * 4), 0);
+
+    // The second mipmap follows right after, averaging 2x2 pixels
+    const auto* level0 = expected->getPixels();
+    const auto* level1 = images[0]->getPixels() + width * height * 4;
+
+    for (std::size_t channel = 0; channel < 4; ++channel)
+    {
+        int sum = level0[channel] + level0[4 + channel] + level0[width * 4 + channel] + level0[width * 4 + 4 + channel];
+        EXPECT_EQ(level1[channel], sum / 4) << "Unexpected value in channel " << channel;
+    }
+}
+
+TEST_F(ImageLoadingTest, MipMapChainIsClampedToMaximumSize)
+{
+    auto images = GlobalImageLoader().imagesFromVFS({ TEST_IMAGES[0] }, true, 16);
+    auto expected = GlobalImageLoader().imageFromVFS(TEST_IMAGES[0]);
+
+    ASSERT_TRUE(images[0] && expected);
+
+    // The reported size is still the one of the decoded image
+    EXPECT_EQ(images[0]->getWidth(), 64);
+    EXPECT_EQ(images[0]->getHeight(), 64);
+
+    // The first mipmap is the image resampled to the maximum size
+    std::vector<byte> resampled(16 * 16 * 4);
+    image::resample(expected->getPixels(), 64, 64, resampled.data(), 16, 16, 4);
+
+    EXPECT_EQ(std::memcmp(images[0]->getPixels(), resampled.data(), resampled.size()), 0);
+}
+
+TEST_F(ImageLoadingTest, PixelBufferPoolReusesBuffers)
+{
+    image::PixelBufferPool pool(1024 * 1024);
+
+    auto* buffer = pool.acquire(200 * 200 * 4);
+    pool.release(buffer, 200 * 200 * 4);
+
+    // 256 KB bucket
+    EXPECT_EQ(pool.getPooledBytes(), 256 * 1024);
+
+    // A request of the same bucket gets the same buffer back
+    EXPECT_EQ(pool.acquire(256 * 256 * 4), buffer);
+    EXPECT_EQ(pool.getPooledBytes(), 0);
+
+    // Buffers exceeding the pool size are freed right away
+    auto* large = pool.acquire(2048 * 2048 * 4);
+    pool.release(large, 2048 * 2048 * 4);
+    EXPECT_EQ(pool.getPooledBytes(), 0);
+
+    pool.release(buffer, 256 * 256 * 4);
+    EXPECT_EQ(pool.getPooledBytes(), 256 * 1024);
+
+    // Small requests are not pooled
+    auto* small = pool.acquire(16);
+    pool.release(small, 16);
+    EXPECT_EQ(pool.getPooledBytes(), 256 * 1024);
+
+    pool.clear();
+    EXPECT_EQ(pool.getPooledBytes(), 0);
+}
+
+TEST_F(ImageLoadingTest, ImagesUsePooledBuffers)
+{
+    auto& pool = image::PixelBufferPool::Instance();
+    pool.clear();
+
+    const uint8_t* pixels = nullptr;
+
+    {
+        RGBAImage image(128, 128);
+        pixels = image.getPixels();
+    }
+
+    EXPECT_EQ(pool.getPooledBytes(), 128 * 128 * 4);
+
+    // The next image of that size is reusing the memory
+    RGBAImage image(128, 128);
+    EXPECT_EQ(image.getPixels(), pixels);
+}
+
+}
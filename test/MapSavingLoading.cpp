@@ -1,6 +1,9 @@
 #include "RadiantTest.h"
 
 #include <fstream>
+#include <sstream>
+#include <map>
+#include <thread>
 #include "iundo.h"
 #include "imap.h"
 #include "imapformat.h"
@@ -16,6 +19,7 @@
 #include "algorithm/Primitives.h"
 #include "os/file.h"
 #include <sigc++/connection.h>
+#include <fmt/format.h>
 
 using namespace std::chrono_literals;
 
@@ -360,6 +364,339 @@ TEST_F(MapLoadingTest, openMapWithoutInfoFile)
     EXPECT_EQ(GlobalMapModule().getMapName(), tempPath.string());
 }
 
+namespace
+{
+
+constexpr std::size_t NumLargeMapEntities = 3;
+constexpr std::size_t NumLargeMapBrushesPerEntity = 500;
+
+// Writes a map with a worldspawn and two func_statics, each brush carrying a unique material
+void writeLargeMap(const fs::path& mapPath)
+{
+    std::ofstream stream(mapPath.string());
+    stream << "Version 2\n";
+
+    for (std::size_t e = 0; e < NumLargeMapEntities; ++e)
+    {
+        stream << "// entity " << e << "\n{\n";
+
+        if (e == 0)
+        {
+            stream << "\"classname\" \"worldspawn\"\n";
+        }
+        else
+        {
+            stream << "\"classname\" \"func_static\"\n\"name\" \"static_" << e << "\"\n\"model\" \"static_" << e << "\"\n";
+        }
+
+        for (std::size_t b = 0; b < NumLargeMapBrushesPerEntity; ++b)
+        {
+            auto material = fmt::format("\"textures/parallel/{0}_{1}\" 0 0 0\n", e, b);
+            auto x = b * 64;
+
+            stream << "// primitive " << b << "\n{\nbrushDef3\n{\n";
+            stream << "( 1 0 0 -" << x + 64 << " ) ( ( 0.015625 0 0 ) ( 0 0.015625 0 ) ) " << material;
+            stream << "( -1 0 0 " << x << " ) ( ( 0.015625 0 0 ) ( 0 0.015625 0 ) ) " << material;
+            stream << "( 0 1 0 -64 ) ( ( 0.015625 0 0 ) ( 0 0.015625 0 ) ) " << material;
+            stream << "( 0 -1 0 0 ) ( ( 0.015625 0 0 ) ( 0 0.015625 0 ) ) " << material;
+            stream << "( 0 0 1 -64 ) ( ( 0.015625 0 0 ) ( 0 0.015625 0 ) ) " << material;
+            stream << "( 0 0 -1 0 ) ( ( 0.015625 0 0 ) ( 0 0.015625 0 ) ) " << material;
+            stream << "}\n}\n";
+        }
+
+        stream << "}\n";
+    }
+}
+
+// Checks that the scene contains the primitives of writeLargeMap() in the file order
+void checkLargeMapPrimitiveOrder()
+{
+    auto root = GlobalMapModule().getRoot();
+
+    for (std::size_t e = 0; e < NumLargeMapEntities; ++e)
+    {
+        auto entity = e == 0 ? GlobalMapModule().findOrInsertWorldspawn() :
+            algorithm::getEntityByName(root, fmt::format("static_{0}", e));
+
+        ASSERT_TRUE(entity);
+
+        std::size_t b = 0;
+
+        entity->foreachNode([&](const scene::INodePtr& node)
+        {
+            EXPECT_TRUE(Node_isBrush(node));
+            EXPECT_EQ(Node_getIBrush(node)->getFace(0).getShader(), fmt::format("textures/parallel/{0}_{1}", e, b));
+            ++b;
+            return true;
+        });
+
+        EXPECT_EQ(b, NumLargeMapBrushesPerEntity);
+    }
+}
+
+}
+
+// Larger maps are parsed on several threads, the primitives need to end up in the file order
+TEST_F(MapLoadingTest, openLargeMapPreservesPrimitiveOrder)
+{
+    fs::path mapPath = _context.getTemporaryDataPath();
+    mapPath /= "large_map_primitive_order.map";
+
+    writeLargeMap(mapPath);
+
+    GlobalCommandSystem().executeCommand("OpenMap", mapPath.string());
+    checkLargeMapPrimitiveOrder();
+
+    fs::remove(mapPath);
+}
+
+// A single stray token between two primitives is read as a spawnarg without value
+TEST_F(MapLoadingTest, openLargeMapWithStrayTokenFails)
+{
+    fs::path mapPath = _context.getTemporaryDataPath();
+    mapPath /= "large_map_stray_token.map";
+
+    writeLargeMap(mapPath);
+
+    std::string contents;
+    {
+        std::ifstream stream(mapPath.string());
+        std::stringstream buffer;
+        buffer << stream.rdbuf();
+        contents = buffer.str();
+    }
+
+    auto primitive = contents.find("// primitive 1\n", contents.find("// entity 1\n"));
+    ASSERT_NE(primitive, std::string::npos);
+    contents.insert(primitive, "stray\n");
+
+    std::ofstream(mapPath.string()) << contents;
+
+    GlobalCommandSystem().executeCommand("OpenMap", mapPath.string());
+
+    // The parallel parser must fail like the sequential one, leaving an empty map
+    EXPECT_FALSE(algorithm::getEntityByName(GlobalMapModule().getRoot(), "static_1"));
+    EXPECT_EQ(GlobalMapModule().getMapName(), "unnamed.map");
+
+    fs::remove(mapPath);
+}
+
+namespace
+{
+
+// Returns the snapshot files in the cache folder belonging to a map with the given name
+std::vector<fs::path> findMapSnapshots(const std::string& cachePath, const std::string& mapName)
+{
+    fs::path snapshotFolder = cachePath;
+    snapshotFolder /= "mapsnapshots";
+
+    std::vector<fs::path> snapshots;
+
+    if (!os::fileOrDirExists(snapshotFolder)) return snapshots;
+
+    auto prefix = fs::path(mapName).stem().string() + "_";
+
+    for (const auto& entry : fs::directory_iterator(snapshotFolder))
+    {
+        auto filename = entry.path().filename().string();
+
+        if (filename.compare(0, prefix.length(), prefix) == 0 && entry.path().extension() == ".mapsnapshot")
+        {
+            snapshots.push_back(entry.path());
+        }
+    }
+
+    return snapshots;
+}
+
+std::string readFileContents(const fs::path& path)
+{
+    std::ifstream stream(path.string(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+// Snapshots are written in the background, this waits for the snapshot of the given map
+// to appear (with contents different to the given ones). Returns an empty path on timeout.
+fs::path waitForMapSnapshot(const std::string& cachePath, const std::string& mapName,
+    const std::string& previousContents = std::string())
+{
+    for (auto waited = 0ms; waited < 10000ms; waited += 20ms)
+    {
+        auto snapshots = findMapSnapshots(cachePath, mapName);
+
+        if (snapshots.size() == 1 && readFileContents(snapshots.front()) != previousContents)
+        {
+            return snapshots.front();
+        }
+
+        std::this_thread::sleep_for(20ms);
+    }
+
+    return fs::path();
+}
+
+std::string describeVector(const Vector3& vector)
+{
+    return fmt::format("{0} {1} {2}", vector.x(), vector.y(), vector.z());
+}
+
+// Describes the entities and primitives of the current map in scene order,
+// to compare the scenes resulting from different ways of loading a map
+std::vector<std::string> describeMapScene()
+{
+    std::vector<std::string> lines;
+
+    auto describeLayers = [&](const scene::INodePtr& node)
+    {
+        std::string layers = "layers";
+
+        for (auto layer : node->getLayers())
+        {
+            layers += fmt::format(" {0}", layer);
+        }
+
+        lines.push_back(layers);
+    };
+
+    GlobalMapModule().getRoot()->foreachNode([&](const scene::INodePtr& entityNode)
+    {
+        auto entity = Node_getEntity(entityNode);
+
+        if (entity == nullptr) return true;
+
+        std::map<std::string, std::string> keyValues;
+
+        entity->forEachKeyValue([&](const std::string& key, const std::string& value)
+        {
+            keyValues[key] = value;
+        });
+
+        lines.push_back("entity");
+
+        for (const auto& pair : keyValues)
+        {
+            lines.push_back(pair.first + " = " + pair.second);
+        }
+
+        describeLayers(entityNode);
+
+        entityNode->foreachNode([&](const scene::INodePtr& node)
+        {
+            if (auto brush = Node_getIBrush(node); brush != nullptr)
+            {
+                lines.push_back(fmt::format("brush {0}", static_cast<int>(brush->getDetailFlag())));
+
+                for (std::size_t i = 0; i < brush->getNumFaces(); ++i)
+                {
+                    const auto& face = brush->getFace(i);
+                    auto texdef = face.getTexDefMatrix();
+
+                    lines.push_back(fmt::format("face {0} {1} {2} {3} {4} {5} {6} {7} {8}", face.getShader(),
+                        describeVector(face.getPlane3().normal()), face.getPlane3().dist(),
+                        texdef.xx(), texdef.yx(), texdef.tx(), texdef.xy(), texdef.yy(), texdef.ty()));
+                }
+            }
+            else if (auto patch = Node_getIPatch(node); patch != nullptr)
+            {
+                lines.push_back(fmt::format("patch {0} {1}x{2}", patch->getShader(), patch->getWidth(), patch->getHeight()));
+
+                for (std::size_t row = 0; row < patch->getHeight(); ++row)
+                {
+                    for (std::size_t col = 0; col < patch->getWidth(); ++col)
+                    {
+                        const auto& control = patch->ctrlAt(row, col);
+                        lines.push_back(fmt::format("control {0} {1} {2}", describeVector(control.vertex),
+                            control.texcoord.x(), control.texcoord.y()));
+                    }
+                }
+            }
+
+            describeLayers(node);
+            return true;
+        });
+
+        return true;
+    });
+
+    return lines;
+}
+
+}
+
+TEST_F(MapLoadingTest, openMapCreatesSnapshot)
+{
+    auto tempPath = createMapCopyInTempDataPath("altar.map", "altar_openMapCreatesSnapshot.map");
+
+    EXPECT_TRUE(findMapSnapshots(_context.getCacheDataPath(), tempPath.string()).empty());
+
+    GlobalCommandSystem().executeCommand("OpenMap", tempPath.string());
+    checkAltarScene();
+
+    EXPECT_FALSE(waitForMapSnapshot(_context.getCacheDataPath(), tempPath.string()).empty());
+
+    // The second load is served from the snapshot, which needs to yield the same scene
+    GlobalCommandSystem().executeCommand("OpenMap", tempPath.string());
+    checkAltarScene();
+
+    EXPECT_EQ(GlobalMapModule().getMapName(), tempPath.string());
+    EXPECT_EQ(findMapSnapshots(_context.getCacheDataPath(), tempPath.string()).size(), 1);
+}
+
+TEST_F(MapLoadingTest, snapshotMatchesParsedScene)
+{
+    auto tempPath = createMapCopyInTempDataPath("altar.map", "altar_snapshotMatchesParsedScene.map");
+
+    GlobalCommandSystem().executeCommand("OpenMap", tempPath.string());
+    checkAltarScene();
+
+    auto parsedScene = describeMapScene();
+    EXPECT_FALSE(parsedScene.empty());
+
+    auto snapshotPath = waitForMapSnapshot(_context.getCacheDataPath(), tempPath.string());
+    ASSERT_FALSE(snapshotPath.empty());
+
+    // Opening the snapshot file itself goes through the snapshot reader only
+    GlobalCommandSystem().executeCommand("OpenMap", snapshotPath.string());
+    EXPECT_EQ(describeMapScene(), parsedScene);
+
+    // Reopening the map takes the shortcut through the snapshot
+    GlobalCommandSystem().executeCommand("OpenMap", tempPath.string());
+    checkAltarScene();
+    EXPECT_EQ(describeMapScene(), parsedScene);
+}
+
+TEST_F(MapLoadingTest, openModifiedMapIgnoresSnapshot)
+{
+    auto tempPath = createMapCopyInTempDataPath("altar.map", "altar_openModifiedMapIgnoresSnapshot.map");
+
+    GlobalCommandSystem().executeCommand("OpenMap", tempPath.string());
+    checkAltarScene();
+
+    EXPECT_FALSE(algorithm::getEntityByName(GlobalMapModule().getRoot(), "snapshot_test_entity"));
+
+    auto snapshotPath = waitForMapSnapshot(_context.getCacheDataPath(), tempPath.string());
+    ASSERT_FALSE(snapshotPath.empty());
+
+    auto staleSnapshot = readFileContents(snapshotPath);
+
+    // Modify the map file behind our back
+    std::ofstream stream(tempPath.string(), std::ios::app);
+    stream << "// entity 999\n{\n\"classname\" \"info_player_start\"\n\"name\" \"snapshot_test_entity\"\n\"origin\" \"0 0 0\"\n}\n";
+    stream.close();
+
+    // The stale snapshot must not be used, the map file is parsed again
+    GlobalCommandSystem().executeCommand("OpenMap", tempPath.string());
+    checkAltarScene();
+
+    EXPECT_TRUE(algorithm::getEntityByName(GlobalMapModule().getRoot(), "snapshot_test_entity"));
+
+    // The stale snapshot is replaced by the one of the modified map
+    EXPECT_FALSE(waitForMapSnapshot(_context.getCacheDataPath(), tempPath.string(), staleSnapshot).empty());
+
+    GlobalCommandSystem().executeCommand("OpenMap", tempPath.string());
+    EXPECT_TRUE(algorithm::getEntityByName(GlobalMapModule().getRoot(), "snapshot_test_entity"));
+}
+
 TEST_F(MapLoadingTest, loadingCanBeCancelled)
 {
     std::string mapName = "altar.map";
@@ -691,6 +1028,34 @@ TEST_F(MapSavingTest, saveCopyAs)
     checkAltarScene();
 }
 
+// Larger maps are formatted on several threads, the blocks need to be written in the scene order
+TEST_F(MapSavingTest, saveLargeMapPreservesPrimitiveOrder)
+{
+    fs::path mapPath = _context.getTemporaryDataPath();
+    mapPath /= "large_map_save_order.map";
+
+    writeLargeMap(mapPath);
+
+    GlobalCommandSystem().executeCommand("OpenMap", mapPath.string());
+    checkLargeMapPrimitiveOrder();
+
+    fs::path tempPath = _context.getTemporaryDataPath();
+    tempPath /= "large_map_save_order_copy.map";
+
+    FileSelectionHelper responder(tempPath.string(), GlobalMapFormatManager().getMapFormatForFilename(tempPath.string()));
+    GlobalCommandSystem().executeCommand("SaveMapCopyAs");
+
+    EXPECT_TRUE(os::fileOrDirExists(tempPath));
+
+    // Load the copy and verify the order
+    GlobalCommandSystem().executeCommand("OpenMap", tempPath.string());
+    checkLargeMapPrimitiveOrder();
+
+    fs::remove(mapPath);
+    fs::remove(tempPath);
+    fs::remove(fs::path(tempPath).replace_extension("darkradiant"));
+}
+
 TEST_F(MapSavingTest, saveCopyAsMapx)
 {
     std::string modRelativePath = "maps/altar.map";
@@ -729,7 +1094,125 @@ TEST_F(MapSavingTest, saveCopyAsMapx)
     EXPECT_EQ(GlobalMapModule().getMapName(), tempPath);
 }
 
+TEST_F(MapSavingTest, saveCopyAsSnapshot)
+{
+    std::string modRelativePath = "maps/altar.map";
+
+    GlobalCommandSystem().executeCommand("OpenMap", modRelativePath);
+    checkAltarScene();
+
+    fs::path tempPath = _context.getTemporaryDataPath();
+    tempPath /= "altar_copy.mapsnapshot";
+
+    auto format = GlobalMapFormatManager().getMapFormatByName(map::MAP_SNAPSHOT_FORMAT_NAME);
+    ASSERT_TRUE(format);
+
+    FileSelectionHelper responder(tempPath.string(), format);
+
+    EXPECT_FALSE(os::fileOrDirExists(tempPath));
+
+    GlobalCommandSystem().executeCommand("SaveMapCopyAs");
+
+    EXPECT_TRUE(os::fileOrDirExists(tempPath));
+
+    // Load the snapshot directly and verify the scene
+    GlobalCommandSystem().executeCommand("OpenMap", tempPath.string());
+    checkAltarScene();
+
+    fs::remove(tempPath);
+}
+
 // Check that the overwriting an existing map file will create a backup set
+TEST_F(MapSavingTest, saveCopyInBackground)
+{
+    GlobalCommandSystem().executeCommand("OpenMap", std::string("maps/altar.map"));
+    checkAltarScene();
+
+    fs::path tempPath = _context.getTemporaryDataPath();
+    tempPath /= "altar_background_copy.map";
+
+    EXPECT_FALSE(os::fileOrDirExists(tempPath));
+
+    auto backgroundExport = GlobalMapModule().saveCopyInBackground(tempPath.string());
+
+    ASSERT_TRUE(backgroundExport);
+    EXPECT_EQ(backgroundExport->getFilename(), tempPath.string());
+    EXPECT_TRUE(backgroundExport->finish());
+    EXPECT_TRUE(backgroundExport->isDone());
+    EXPECT_EQ(backgroundExport->getProgress(), 1.0f);
+
+    // The temporary files should have been moved to the target location
+    EXPECT_TRUE(os::fileOrDirExists(tempPath));
+    EXPECT_TRUE(os::fileOrDirExists(fs::path(tempPath).replace_extension("darkradiant")));
+    EXPECT_FALSE(os::fileOrDirExists(tempPath.string() + ".tmp"));
+
+    // The current scene should be unaffected
+    EXPECT_FALSE(GlobalMapModule().isModified());
+    checkAltarScene();
+
+    // Load the copy and verify the scene, including layers, groups and sets
+    GlobalCommandSystem().executeCommand("OpenMap", tempPath.string());
+    checkAltarScene();
+}
+
+TEST_F(MapSavingTest, cancelledBackgroundSaveLeavesNoFiles)
+{
+    fs::path mapPath = _context.getTemporaryDataPath();
+    mapPath /= "large_map_background_cancel.map";
+
+    writeLargeMap(mapPath);
+
+    GlobalCommandSystem().executeCommand("OpenMap", mapPath.string());
+
+    fs::path tempPath = _context.getTemporaryDataPath();
+    tempPath /= "large_map_background_cancel_copy.map";
+
+    auto backgroundExport = GlobalMapModule().saveCopyInBackground(tempPath.string());
+
+    backgroundExport->cancel();
+
+    // The worker might have been done before it noticed the cancellation,
+    // but there must not be any partially written files
+    if (backgroundExport->finish())
+    {
+        EXPECT_TRUE(os::fileOrDirExists(tempPath));
+    }
+    else
+    {
+        EXPECT_FALSE(os::fileOrDirExists(tempPath));
+    }
+
+    EXPECT_FALSE(os::fileOrDirExists(tempPath.string() + ".tmp"));
+    EXPECT_FALSE(os::fileOrDirExists(fs::path(tempPath).replace_extension("darkradiant").string() + ".tmp"));
+
+    fs::remove(mapPath);
+    fs::remove(tempPath);
+    fs::remove(fs::path(tempPath).replace_extension("darkradiant"));
+}
+
+// A regular save should stop the background save
+TEST_F(MapSavingTest, saveMapStopsBackgroundSave)
+{
+    GlobalCommandSystem().executeCommand("OpenMap", std::string("maps/altar.map"));
+
+    fs::path backgroundPath = _context.getTemporaryDataPath();
+    backgroundPath /= "altar_background_stopped.map";
+
+    auto backgroundExport = GlobalMapModule().saveCopyInBackground(backgroundPath.string());
+
+    fs::path tempPath = _context.getTemporaryDataPath();
+    tempPath /= "altar_regular_copy.map";
+
+    GlobalCommandSystem().executeCommand("SaveMapCopyAs", tempPath.string());
+
+    EXPECT_TRUE(backgroundExport->isDone());
+    EXPECT_TRUE(os::fileOrDirExists(tempPath));
+    EXPECT_FALSE(os::fileOrDirExists(backgroundPath.string() + ".tmp"));
+
+    fs::remove(backgroundPath);
+    fs::remove(fs::path(backgroundPath).replace_extension("darkradiant"));
+}
+
 TEST_F(MapSavingTest, saveMapCreatesBackup)
 {
     auto mapPath = createMapCopyInTempDataPath("altar.map", "altar_saveMapCreatesBackup.map");
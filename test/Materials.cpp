@@ -1,12 +1,57 @@
 #include "RadiantTest.h"
 
 #include "ishaders.h"
+#include "irender.h"
+#include "os/file.h"
+#include "math/Vector3.h"
+
+#include <chrono>
+#include <iostream>
 
 namespace test
 {
 
 using MaterialsTest = RadiantTest;
 
+namespace
+{
+
+// Render entity with fixed shaderparms
+class TestRenderEntity :
+    public IRenderEntity
+{
+private:
+    Vector3 _direction;
+    ShaderPtr _wireShader;
+
+public:
+    float getShaderParm(int parmNum) const override
+    {
+        return parmNum * 0.25f + 0.1f;
+    }
+
+    const Vector3& getDirection() const override
+    {
+        return _direction;
+    }
+
+    const ShaderPtr& getWireShader() const override
+    {
+        return _wireShader;
+    }
+};
+
+// The expressions of textures/orbweaver/animated_grille, in stage order
+const char* const ANIMATED_GRILLE_EXPRESSIONS[] =
+{
+    "time * 0.3 + expressionTestTable[time * 0.1]",
+    "time % 2", "(parm3 > 0.5) * 3",
+    "1 / (2 + 3)", "time * 2 - 4 * 0.5",
+    "(time >= 1) && (time < 4)", "global3 + parm1 * -1.5",
+};
+
+}
+
 TEST_F(MaterialsTest, MaterialFileInfo)
 {
     auto& materialManager = GlobalMaterialManager();
@@ -37,4 +82,139 @@ TEST_F(MaterialsTest, MaterialFileInfo)
     EXPECT_EQ(hiddenTex2->getShaderFileInfo().visibility, vfs::Visibility::HIDDEN);
 }
 
+TEST_F(MaterialsTest, MaterialsAreLoadedFromIndexCache)
+{
+    auto& materialManager = GlobalMaterialManager();
+
+    auto visportal = materialManager.getMaterialForName("textures/editor/visportal");
+    auto description = visportal->getDescription();
+    auto definition = visportal->getDefinition();
+
+    EXPECT_EQ(description, "used to divide areas, areas between sealed portal faces are what gives the engine rendering, sound and AI information");
+    EXPECT_NE(definition.find("areaportal"), std::string::npos);
+
+    // Loading the materials should have written the index
+    EXPECT_TRUE(os::fileOrDirExists(_context.getCacheDataPath() + "materials.cache"));
+
+    // Reload, this time the material files are not split up again
+    materialManager.refresh();
+
+    EXPECT_TRUE(materialManager.materialExists("textures/orbweaver/drain_grille"));
+
+    visportal = materialManager.getMaterialForName("textures/editor/visportal");
+    EXPECT_EQ(visportal->getDescription(), description);
+    EXPECT_EQ(visportal->getDefinition(), definition);
+
+    // The declaration text is read from the file on demand
+    auto drainGrille = materialManager.getMaterialForName("textures/orbweaver/drain_grille");
+    EXPECT_NE(drainGrille->getDefinition().find("diffusemap textures/darkmod/metal/flat/heavy_rust_pocked01"), std::string::npos);
+}
+
+TEST_F(MaterialsTest, CompiledExpressionsMatchExpressionTrees)
+{
+    auto material = GlobalMaterialManager().getMaterialForName("textures/orbweaver/animated_grille");
+    ASSERT_EQ(material->getAllLayers().size(), 1);
+
+    auto layer = material->getAllLayers().front();
+
+    // The stage evaluates its compiled expressions, the standalone ones walk their trees
+    std::vector<shaders::IShaderExpressionPtr> trees;
+
+    for (auto exprString : ANIMATED_GRILLE_EXPRESSIONS)
+    {
+        trees.push_back(GlobalMaterialManager().createShaderExpressionFromString(exprString));
+        ASSERT_TRUE(trees.back()) << "Failed to parse " << exprString;
+    }
+
+    TestRenderEntity entity;
+
+    for (std::size_t time = 0; time < 10000; time += 37)
+    {
+        layer->evaluateExpressions(time, entity);
+
+        EXPECT_EQ(layer->getRotation(), trees[0]->getValue(time, entity)) << "at " << time;
+        EXPECT_EQ(layer->getTranslation(), Vector2(trees[1]->getValue(time, entity), trees[2]->getValue(time, entity))) << "at " << time;
+        EXPECT_EQ(layer->getScale(), Vector2(trees[3]->getValue(time, entity), trees[4]->getValue(time, entity))) << "at " << time;
+        EXPECT_EQ(layer->getShear(), Vector2(trees[5]->getValue(time, entity), trees[6]->getValue(time, entity))) << "at " << time;
+
+        // Without entity, the shaderparms are 0
+        layer->evaluateExpressions(time);
+
+        EXPECT_EQ(layer->getTranslation().y(), trees[2]->getValue(time)) << "at " << time;
+        EXPECT_EQ(layer->getShear().y(), trees[6]->getValue(time)) << "at " << time;
+    }
+}
+
+TEST_F(MaterialsTest, StagesReportEntityShaderParmUsage)
+{
+    // The animated grille translates and shears its stage by parm3 and parm1
+    auto animatedGrille = GlobalMaterialManager().getMaterialForName("textures/orbweaver/animated_grille");
+    EXPECT_TRUE(animatedGrille->getAllLayers().front()->usesEntityShaderParms());
+
+    // The drain grille stages are the same for every entity
+    auto drainGrille = GlobalMaterialManager().getMaterialForName("textures/orbweaver/drain_grille");
+    ASSERT_FALSE(drainGrille->getAllLayers().empty());
+
+    for (const auto& layer : drainGrille->getAllLayers())
+    {
+        EXPECT_FALSE(layer->usesEntityShaderParms());
+    }
+}
+
+// Microbenchmark comparing the expression trees to the compiled stage expressions.
+// Disabled since it only measures, run it with --gtest_also_run_disabled_tests.
+TEST_F(MaterialsTest, DISABLED_CompiledExpressionBenchmark)
+{
+    auto material = GlobalMaterialManager().getMaterialForName("textures/orbweaver/animated_grille");
+    auto layer = material->getAllLayers().front();
+
+    std::vector<shaders::IShaderExpressionPtr> trees;
+
+    for (auto exprString : ANIMATED_GRILLE_EXPRESSIONS)
+    {
+        trees.push_back(GlobalMaterialManager().createShaderExpressionFromString(exprString));
+    }
+
+    TestRenderEntity entity;
+    const std::size_t iterations = 200000;
+
+    auto start = std::chrono::steady_clock::now();
+
+    float treeSum = 0;
+
+    for (std::size_t time = 0; time < iterations; ++time)
+    {
+        for (const auto& tree : trees)
+        {
+            treeSum += tree->getValue(time, entity);
+        }
+    }
+
+    auto treeDuration = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+
+    float programSum = 0;
+
+    for (std::size_t time = 0; time < iterations; ++time)
+    {
+        layer->evaluateExpressions(time, entity);
+
+        programSum += layer->getRotation();
+        programSum += layer->getTranslation().x();
+        programSum += layer->getTranslation().y();
+        programSum += layer->getScale().x();
+        programSum += layer->getScale().y();
+        programSum += layer->getShear().x();
+        programSum += layer->getShear().y();
+    }
+
+    auto programDuration = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(programSum, treeSum);
+
+    std::cout << "Evaluated " << trees.size() << " expressions " << iterations << " times: trees " <<
+        std::chrono::duration_cast<std::chrono::milliseconds>(treeDuration).count() << " ms, compiled " <<
+        std::chrono::duration_cast<std::chrono::milliseconds>(programDuration).count() << " ms" << std::endl;
+}
+
 }
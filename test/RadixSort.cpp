@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <vector>
+
+#include "render/RadixSort.h"
+
+namespace test
+{
+
+namespace
+{
+
+struct KeyedValue
+{
+    std::uint64_t key;
+    std::size_t submissionIndex;
+};
+
+std::vector<KeyedValue> createValues(std::size_t count, std::uint64_t keyMask)
+{
+    std::mt19937_64 random(count);
+    std::vector<KeyedValue> values;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        values.push_back(KeyedValue{ random() & keyMask, i });
+    }
+
+    return values;
+}
+
+void expectSortedAndStable(const std::vector<KeyedValue>& values)
+{
+    for (std::size_t i = 1; i < values.size(); ++i)
+    {
+        const auto& previous = values[i - 1];
+        const auto& current = values[i];
+
+        EXPECT_LE(previous.key, current.key) << "at " << i;
+
+        if (previous.key == current.key)
+        {
+            EXPECT_LT(previous.submissionIndex, current.submissionIndex) << "at " << i;
+        }
+    }
+}
+
+}
+
+TEST(RadixSort, SortsByKeyAndKeepsSubmissionOrder)
+{
+    auto getKey = [](const KeyedValue& value) { return value.key; };
+    std::vector<KeyedValue> buffer;
+
+    // Few elements, many elements with all key bytes used, and many
+    // elements sharing most key bytes (like pointers or sort positions)
+    for (auto keyMask : { ~std::uint64_t(0), std::uint64_t(0xff00f), std::uint64_t(0x7) })
+    {
+        for (std::size_t count : { 0, 1, 10, 63, 64, 1000, 20000 })
+        {
+            auto values = createValues(count, keyMask);
+
+            render::RadixSortByKey(values, buffer, getKey);
+
+            EXPECT_EQ(values.size(), count);
+            expectSortedAndStable(values);
+        }
+    }
+}
+
+}
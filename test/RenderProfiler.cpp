@@ -0,0 +1,108 @@
+#include "RadiantTest.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "irender.h"
+#include "irenderprofiler.h"
+#include "icommandsystem.h"
+#include "os/fs.h"
+
+using namespace std::chrono_literals;
+
+namespace test
+{
+
+using RenderProfilerTest = RadiantTest;
+
+namespace
+{
+
+// Records a frame with two nested sections and some submission times, no timer queries are involved
+void recordFrame(render::IRenderProfiler& profiler, const std::string& view)
+{
+    profiler.beginFrame(view);
+
+    profiler.beginSection("Scene walk");
+    profiler.addSubmissionTime("func_static", 2ms);
+    profiler.addSubmissionTime("light", 1ms);
+    profiler.endSection();
+
+    profiler.beginSection("Back end");
+    profiler.beginSection("Pass \"textures/common/caulk\"\t1\x01");
+    std::this_thread::sleep_for(1ms);
+    profiler.endSection();
+    profiler.endSection();
+
+    profiler.endFrame();
+}
+
+std::size_t countOccurrences(const std::string& text, const std::string& pattern)
+{
+    std::size_t count = 0;
+
+    for (auto pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + pattern.size()))
+    {
+        ++count;
+    }
+
+    return count;
+}
+
+}
+
+TEST_F(RenderProfilerTest, ChromeTraceContainsRecordedFrames)
+{
+    auto& profiler = GlobalRenderSystem().getProfiler();
+
+    // Nothing is recorded before the recording is started
+    EXPECT_FALSE(profiler.isRecording());
+    recordFrame(profiler, "Ignored view");
+
+    GlobalCommandSystem().executeCommand("RenderProfilerStart");
+    EXPECT_TRUE(profiler.isRecording());
+
+    recordFrame(profiler, "Camera");
+    recordFrame(profiler, "XY \"Top\"");
+
+    std::ostringstream stream;
+    profiler.writeChromeTrace(stream);
+    auto trace = stream.str();
+
+    EXPECT_EQ(trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"), 0u);
+    EXPECT_EQ(trace.substr(trace.size() - 4), "\n]}\n");
+
+    // Only the frames recorded after the start, names are escaped
+    EXPECT_EQ(trace.find("Ignored view"), std::string::npos);
+    EXPECT_EQ(countOccurrences(trace, "{\"name\":\"Camera\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"), 1u);
+    EXPECT_EQ(countOccurrences(trace, "{\"name\":\"XY \\\"Top\\\"\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"), 1u);
+    EXPECT_EQ(countOccurrences(trace, "\"ph\":\"C\""), 2u);
+
+    // Three sections per frame, control characters are escaped
+    EXPECT_EQ(countOccurrences(trace, "\"cat\":\"section\""), 6u);
+    EXPECT_EQ(countOccurrences(trace, "{\"name\":\"Pass \\\"textures/common/caulk\\\"\\t1\\u0001\",\"cat\":\"section\""), 2u);
+
+    // The submission times are in microseconds, summed up per key
+    EXPECT_EQ(countOccurrences(trace, "\"cat\":\"submission\""), 4u);
+    EXPECT_EQ(countOccurrences(trace, "{\"name\":\"func_static\",\"cat\":\"submission\",\"ph\":\"X\",\"pid\":1,\"tid\":3,"), 2u);
+    EXPECT_EQ(countOccurrences(trace, ",\"dur\":2000.000,\"args\":{\"nodes\":1}}"), 2u);
+    EXPECT_EQ(countOccurrences(trace, ",\"dur\":1000.000,\"args\":{\"nodes\":1}}"), 2u);
+
+    // The dump command stops the recording and writes the same trace
+    fs::path tracePath = _context.getTemporaryDataPath();
+    tracePath /= "render_profile.json";
+
+    GlobalCommandSystem().executeCommand("RenderProfilerDump", tracePath.string());
+    EXPECT_FALSE(profiler.isRecording());
+
+    std::ifstream file(tracePath.string());
+    std::stringstream contents;
+    contents << file.rdbuf();
+    file.close();
+
+    EXPECT_EQ(contents.str(), trace);
+
+    fs::remove(tracePath);
+}
+
+}
@@ -0,0 +1,286 @@
+#include "RadiantTest.h"
+
+#include <map>
+#include "iscenegraph.h"
+#include "ivolumetest.h"
+#include "ispacepartition.h"
+#include "itransformable.h"
+#include "imap.h"
+#include "scenelib.h"
+#include "math/AABB.h"
+#include "math/Matrix4.h"
+#include "math/Plane3.h"
+#include "scene/PortalAreaGraph.h"
+#include "algorithm/Primitives.h"
+
+namespace test
+{
+
+using SpacePartitionTest = RadiantTest;
+
+namespace
+{
+
+// Collects the members of the given SP node and its children,
+// the value is the SP node the member is linked to
+void collectMembers(const scene::ISPNodePtr& node, std::map<scene::INodePtr, scene::ISPNodePtr>& members)
+{
+    for (const auto& member : node->getMembers())
+    {
+        EXPECT_TRUE(members.emplace(member, node).second) << "Node is linked twice";
+    }
+
+    for (const auto& child : node->getChildNodes())
+    {
+        EXPECT_EQ(child->getParent(), node);
+        collectMembers(child, members);
+    }
+}
+
+// Checks that the node is linked to the smallest SP node containing it
+void expectCorrectlyLinked(const scene::INodePtr& node, const std::map<scene::INodePtr, scene::ISPNodePtr>& members)
+{
+    auto found = members.find(node);
+    ASSERT_NE(found, members.end()) << "Node is not linked";
+
+    const auto& bounds = node->worldAABB();
+
+    EXPECT_TRUE(found->second->getBounds().contains(bounds));
+
+    for (const auto& child : found->second->getChildNodes())
+    {
+        EXPECT_FALSE(child->getBounds().contains(bounds)) << "Node should be linked to a child";
+    }
+}
+
+// Creates an axis-aligned brush with the given material on all faces
+scene::INodePtr createBoxBrush(const scene::INodePtr& parent, const Vector3& min, const Vector3& max,
+    const std::string& material)
+{
+    auto brushNode = GlobalBrushCreator().createBrush();
+    parent->addChildNode(brushNode);
+
+    auto& brush = *Node_getIBrush(brushNode);
+
+    brush.addFace(Plane3(+1, 0, 0, max.x()));
+    brush.addFace(Plane3(-1, 0, 0, -min.x()));
+    brush.addFace(Plane3(0, +1, 0, max.y()));
+    brush.addFace(Plane3(0, -1, 0, -min.y()));
+    brush.addFace(Plane3(0, 0, +1, max.z()));
+    brush.addFace(Plane3(0, 0, -1, -min.z()));
+
+    brush.setShader(material);
+    brush.evaluateBRep();
+
+    return brushNode;
+}
+
+// Volume containing everything intersecting the given box
+class BoxVolume :
+    public VolumeTest
+{
+private:
+    AABB _box;
+    Matrix4 _identity;
+
+public:
+    BoxVolume(const AABB& box) :
+        _box(box),
+        _identity(Matrix4::getIdentity())
+    {}
+
+    bool TestPoint(const Vector3& point) const override { return _box.intersects(point); }
+    bool TestLine(const Segment& segment) const override { return true; }
+    bool TestPlane(const Plane3& plane) const override { return true; }
+    bool TestPlane(const Plane3& plane, const Matrix4& localToWorld) const override { return true; }
+
+    VolumeIntersectionValue TestAABB(const AABB& aabb) const override
+    {
+        return _box.intersects(aabb) ? VOLUME_PARTIAL : VOLUME_OUTSIDE;
+    }
+
+    VolumeIntersectionValue TestAABB(const AABB& aabb, const Matrix4& localToWorld) const override
+    {
+        return TestAABB(AABB::createFromOrientedAABBSafe(aabb, localToWorld));
+    }
+
+    bool fill() const override { return true; }
+
+    const Matrix4& GetViewProjection() const override { return _identity; }
+    const Matrix4& GetViewport() const override { return _identity; }
+    const Matrix4& GetProjection() const override { return _identity; }
+    const Matrix4& GetModelview() const override { return _identity; }
+};
+
+}
+
+TEST_F(SpacePartitionTest, MovedBrushesAreRelinked)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+
+    std::vector<scene::INodePtr> brushes;
+
+    // Enough brushes to let the tree subdivide a few times
+    for (int i = 0; i < 200; ++i)
+    {
+        brushes.push_back(algorithm::createCubicBrush(worldspawn, Vector3((i % 20) * 160, (i / 20) * 160, 0)));
+    }
+
+    // Move every other brush far away, crossing the current root bounds
+    for (std::size_t i = 0; i < brushes.size(); i += 2)
+    {
+        auto transformable = Node_getTransformable(brushes[i]);
+
+        transformable->setTranslation(Vector3(-8192, 4096, 1024));
+        transformable->freezeTransform();
+    }
+
+    // And the other ones by a small amount, most of them stay in their cell
+    for (std::size_t i = 1; i < brushes.size(); i += 2)
+    {
+        auto transformable = Node_getTransformable(brushes[i]);
+
+        transformable->setTranslation(Vector3(8, 8, 0));
+        transformable->freezeTransform();
+    }
+
+    std::map<scene::INodePtr, scene::ISPNodePtr> members;
+    collectMembers(GlobalSceneGraph().getSpacePartition()->getRoot(), members);
+
+    for (const auto& brush : brushes)
+    {
+        expectCorrectlyLinked(brush, members);
+    }
+
+    // Removed brushes must vanish from the tree, even if they had been moved before
+    auto transformable = Node_getTransformable(brushes.front());
+    transformable->setTranslation(Vector3(64, 0, 0));
+    transformable->freezeTransform();
+
+    scene::removeNodeFromParent(brushes.front());
+
+    members.clear();
+    collectMembers(GlobalSceneGraph().getSpacePartition()->getRoot(), members);
+
+    EXPECT_EQ(members.count(brushes.front()), 0);
+
+    for (std::size_t i = 1; i < brushes.size(); ++i)
+    {
+        expectCorrectlyLinked(brushes[i], members);
+    }
+}
+
+TEST_F(SpacePartitionTest, LargeSceneVolumeTraversal)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+
+    std::vector<scene::INodePtr> brushes;
+
+    // Large enough to be culled on several threads
+    for (int i = 0; i < 5000; ++i)
+    {
+        brushes.push_back(algorithm::createCubicBrush(worldspawn,
+            Vector3((i % 50) * 256 - 6400, ((i / 50) % 50) * 256 - 6400, (i / 2500) * 256)));
+    }
+
+    BoxVolume volume(AABB(Vector3(-1024, 512, 0), Vector3(2048, 1024, 512)));
+
+    std::map<scene::INodePtr, int> visitCount;
+
+    GlobalSceneGraph().foreachNodeInVolume(volume, [&](const scene::INodePtr& node)
+    {
+        ++visitCount[node];
+        return true;
+    });
+
+    for (const auto& pair : visitCount)
+    {
+        EXPECT_EQ(pair.second, 1) << "Node visited more than once";
+    }
+
+    // Every brush intersecting the volume must have been visited
+    std::size_t numIntersecting = 0;
+
+    for (const auto& brush : brushes)
+    {
+        if (volume.TestAABB(brush->worldAABB()) != VOLUME_OUTSIDE)
+        {
+            ++numIntersecting;
+            EXPECT_EQ(visitCount.count(brush), 1);
+        }
+    }
+
+    EXPECT_GT(numIntersecting, 0);
+
+    // Walkers returning false stop the traversal
+    std::size_t numVisited = 0;
+
+    GlobalSceneGraph().foreachNodeInVolume(volume, [&](const scene::INodePtr& node)
+    {
+        return ++numVisited < 10;
+    });
+
+    EXPECT_EQ(numVisited, 10);
+}
+
+// Two rooms connected by a doorway with a visportal
+TEST_F(SpacePartitionTest, PortalAreaGraphSeparatesRooms)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    const std::string caulk = "textures/common/caulk";
+
+    // Outer shell, the interior is x = [-512..512], y = [-256..256], z = [0..256]
+    createBoxBrush(worldspawn, Vector3(-528, -272, -16), Vector3(528, 272, 0), caulk);
+    createBoxBrush(worldspawn, Vector3(-528, -272, 256), Vector3(528, 272, 272), caulk);
+    createBoxBrush(worldspawn, Vector3(-528, -272, 0), Vector3(-512, 272, 256), caulk);
+    createBoxBrush(worldspawn, Vector3(512, -272, 0), Vector3(528, 272, 256), caulk);
+    createBoxBrush(worldspawn, Vector3(-528, -272, 0), Vector3(528, -256, 256), caulk);
+    createBoxBrush(worldspawn, Vector3(-528, 256, 0), Vector3(528, 272, 256), caulk);
+
+    // Dividing wall with a doorway at y = [-64..64], z = [0..128]
+    createBoxBrush(worldspawn, Vector3(-8, -256, 0), Vector3(8, -64, 256), caulk);
+    createBoxBrush(worldspawn, Vector3(-8, 64, 0), Vector3(8, 256, 256), caulk);
+    createBoxBrush(worldspawn, Vector3(-8, -64, 128), Vector3(8, 64, 256), caulk);
+
+    auto portal = createBoxBrush(worldspawn, Vector3(-2, -64, 0), Vector3(2, 64, 128), "textures/editor/visportal");
+
+    EXPECT_TRUE(scene::PortalAreaGraph::IsPortalBrush(portal));
+    EXPECT_FALSE(scene::PortalAreaGraph::IsOpaqueBrush(portal));
+
+    scene::PortalAreaGraph graph;
+    graph.build(worldspawn);
+
+    // The two rooms and the void around them
+    EXPECT_EQ(graph.getAreas().size(), 3);
+    ASSERT_EQ(graph.getPortals().size(), 1);
+    EXPECT_EQ(graph.getPortals().front().areas.size(), 2);
+
+    Vector3 originInFirstRoom(-256, 0, 64);
+    auto firstRoom = graph.getAreaAt(originInFirstRoom);
+    auto secondRoom = graph.getAreaAt(Vector3(256, 0, 64));
+
+    EXPECT_NE(firstRoom, -1);
+    EXPECT_NE(secondRoom, -1);
+    EXPECT_NE(firstRoom, secondRoom);
+
+    // Inside a wall
+    EXPECT_EQ(graph.getAreaAt(Vector3(0, 128, 64)), -1);
+
+    // Looking through the doorway
+    std::vector<AABB> visibleAreas;
+    EXPECT_TRUE(graph.findVisibleAreas(originInFirstRoom,
+        BoxVolume(AABB(Vector3(0, 0, 128), Vector3(1024, 512, 256))), visibleAreas));
+    EXPECT_EQ(visibleAreas.size(), 2);
+
+    // Looking away from the doorway, the portal is not in the volume
+    visibleAreas.clear();
+    EXPECT_TRUE(graph.findVisibleAreas(originInFirstRoom,
+        BoxVolume(AABB(Vector3(-384, 0, 128), Vector3(128, 512, 256))), visibleAreas));
+    ASSERT_EQ(visibleAreas.size(), 1);
+
+    // Objects in the second room are culled
+    EXPECT_FALSE(visibleAreas.front().intersects(AABB(Vector3(256, 0, 64), Vector3(16, 16, 16))));
+    EXPECT_TRUE(visibleAreas.front().intersects(AABB(Vector3(-256, 0, 64), Vector3(16, 16, 16))));
+}
+
+}
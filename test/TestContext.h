@@ -16,6 +16,7 @@ class TestContext :
 {
 private:
 	std::string _settingsFolder;
+	std::string _cacheFolder;
 	std::string _tempDataPath;
 
 public:
@@ -29,6 +30,14 @@ public:
 		os::removeDirectory(_settingsFolder);
 		os::makeDirectory(_settingsFolder);
 
+		// Cached data like map snapshots should not leak into the user's cache folder
+		auto cacheFolder = os::getTemporaryPath() / "dr_temp_cache";
+
+		_cacheFolder = os::standardPathWithSlash(cacheFolder.string());
+
+		os::removeDirectory(_cacheFolder);
+		os::makeDirectory(_cacheFolder);
+
         auto tempDataFolder = os::getTemporaryPath() / "dr_temp_data";
 
         _tempDataPath = os::standardPathWithSlash(tempDataFolder.string());
@@ -50,6 +59,11 @@ public:
 			os::removeDirectory(_settingsFolder);
 		}
 
+		if (!_cacheFolder.empty())
+		{
+			os::removeDirectory(_cacheFolder);
+		}
+
         if (!_tempDataPath.empty())
         {
             os::removeDirectory(_tempDataPath);
@@ -84,6 +98,11 @@ public:
 		return _settingsFolder;
 	}
 
+	std::string getCacheDataPath() const override
+	{
+		return _cacheFolder;
+	}
+
     // Path to a directory where any stuff can be written to
     // This folder will be purged once on context destruction
     std::string getTemporaryDataPath() const
@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "ThreadPool.h"
+
+namespace test
+{
+
+TEST(ThreadPool, EnqueuedTasksRunInOrder)
+{
+    util::ThreadPool pool(1);
+    std::vector<int> order;
+    std::vector<std::future<void>> results;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        results.push_back(pool.enqueue([&order, i]() { order.push_back(i); }));
+    }
+
+    for (auto& result : results)
+    {
+        result.get();
+    }
+
+    ASSERT_EQ(order.size(), 100);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(order[i], i);
+    }
+}
+
+TEST(ThreadPool, ParallelForInsideEnqueuedTask)
+{
+    // The only worker is busy with the task, the loop must still finish
+    util::ThreadPool pool(1);
+    std::vector<std::atomic<int>> visits(500);
+
+    pool.enqueue([&]()
+    {
+        pool.parallelFor(visits.size(), [&](std::size_t i) { ++visits[i]; });
+    }).get();
+
+    for (std::size_t i = 0; i < visits.size(); ++i)
+    {
+        EXPECT_EQ(visits[i].load(), 1) << "Index " << i;
+    }
+}
+
+TEST(ThreadPool, SerialTaskQueueRunsOneTaskAtATime)
+{
+    util::ThreadPool pool(4);
+    std::vector<int> order;
+    std::atomic<int> running(0);
+    std::atomic<bool> overlapped(false);
+
+    {
+        util::SerialTaskQueue queue(pool);
+
+        for (int i = 0; i < 100; ++i)
+        {
+            queue.enqueue([&order, &running, &overlapped, i]()
+            {
+                if (++running > 1) overlapped = true;
+
+                order.push_back(i);
+                --running;
+
+                if (i == 50) throw std::runtime_error("Discarded by the queue");
+            });
+        }
+
+        queue.wait();
+        EXPECT_EQ(order.size(), 100u);
+
+        // The queue keeps working after the task which threw
+        queue.enqueue([&order]() { order.push_back(100); });
+    }
+
+    EXPECT_FALSE(overlapped);
+    ASSERT_EQ(order.size(), 101u);
+
+    for (int i = 0; i <= 100; ++i)
+    {
+        EXPECT_EQ(order[i], i);
+    }
+}
+
+}
@@ -1,8 +1,10 @@
 #include "RadiantTest.h"
 
 #include "ifilesystem.h"
+#include "idatastream.h"
 #include "os/path.h"
 #include "os/file.h"
+#include <future>
 
 namespace test
 {
@@ -75,6 +77,38 @@ TEST_F(VfsTest, GetArchiveFileInfo)
     EXPECT_EQ(foundFiles.find(fileInPak)->second.getArchivePath(), pk4Path.string());
 }
 
+TEST_F(VfsTest, FindFileInfo)
+{
+    std::string physicalFile = "materials/example.mtr";
+    std::string fileInPak = "materials/tdm_bloom_afx.mtr";
+
+    fs::path pk4Path = _context.getTestProjectPath();
+    pk4Path /= "tdm_example_mtrs.pk4";
+
+    std::size_t visits = 0;
+    EXPECT_TRUE(GlobalFileSystem().findFileInfo(physicalFile, [&](const vfs::FileInfo& fi)
+    {
+        ++visits;
+        EXPECT_EQ(fi.fullPath(), physicalFile);
+        EXPECT_EQ(fi.getIsPhysicalFile(), true);
+        EXPECT_EQ(fi.getArchivePath(), _context.getTestProjectPath());
+    }));
+
+    EXPECT_TRUE(GlobalFileSystem().findFileInfo(fileInPak, [&](const vfs::FileInfo& fi)
+    {
+        ++visits;
+        EXPECT_EQ(fi.fullPath(), fileInPak);
+        EXPECT_EQ(fi.getSize(), 1096);
+        EXPECT_EQ(fi.getIsPhysicalFile(), false);
+        EXPECT_EQ(fi.getArchivePath(), pk4Path.string());
+    }));
+
+    EXPECT_EQ(visits, 2);
+
+    EXPECT_FALSE(GlobalFileSystem().findFileInfo("materials/nothere.mtr", [&](const vfs::FileInfo&) { ++visits; }));
+    EXPECT_EQ(visits, 2);
+}
+
 TEST_F(VfsTest, VisitMaterialsFolderOnly)
 {
     // Visit files only under materials/
@@ -176,6 +210,108 @@ TEST_F(VfsTest, openArchiveInAbsolutePath)
     ASSERT_NE(contents.find("textures/AFX/AFXmodulate"), std::string::npos);
 }
 
+TEST_F(VfsTest, ConcurrentArchiveReads)
+{
+    fs::path pk4Path = _context.getTestProjectPath();
+    pk4Path /= "tdm_example_mtrs.pk4";
+
+    auto archive = GlobalFileSystem().openArchiveInAbsolutePath(pk4Path.string());
+    ASSERT_TRUE(archive) << "Could not open " << pk4Path.string();
+
+    std::vector<std::string> files = {
+        "materials/tdm_ai_monsters_spiders.mtr",
+        "materials/tdm_ai_nobles.mtr",
+        "materials/tdm_bloom_afx.mtr"
+    };
+
+    auto readFile = [&](const std::string& name)
+    {
+        auto file = archive->openFile(name);
+        EXPECT_TRUE(file) << "Could not open " << name;
+
+        std::string contents;
+
+        if (file)
+        {
+            contents.resize(file->size());
+            auto bytesRead = file->getInputStream().read(
+                reinterpret_cast<InputStream::byte_type*>(&contents[0]), contents.size());
+            contents.resize(bytesRead);
+        }
+
+        return contents;
+    };
+
+    std::vector<std::string> expectedContents;
+
+    for (const auto& name : files)
+    {
+        expectedContents.push_back(readFile(name));
+        EXPECT_EQ(expectedContents.back().size(), archive->openFile(name)->size());
+    }
+
+    // Read all files from many threads at once, they should all get the same data
+    std::vector<std::future<bool>> results;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        results.emplace_back(std::async(std::launch::async, [&]()
+        {
+            for (int j = 0; j < 20; ++j)
+            {
+                for (std::size_t f = 0; f < files.size(); ++f)
+                {
+                    if (readFile(files[f]) != expectedContents[f]) return false;
+                }
+            }
+
+            return true;
+        }));
+    }
+
+    for (auto& result : results)
+    {
+        EXPECT_TRUE(result.get());
+    }
+}
+
+TEST_F(VfsTest, ReinitialiseFromIndexCache)
+{
+    // The first initialisation should have written the cache
+    auto cachePath = _context.getCacheDataPath() + "vfsindex.cache";
+    EXPECT_TRUE(os::fileOrDirExists(cachePath));
+
+    auto collectFiles = [&]()
+    {
+        std::set<std::string> foundFiles;
+        GlobalFileSystem().forEachFile("", "*", [&](const vfs::FileInfo& fi) { foundFiles.insert(fi.name); }, 0);
+        return foundFiles;
+    };
+
+    auto readFile = [&](const std::string& name)
+    {
+        auto file = GlobalFileSystem().openTextFile(name);
+        EXPECT_TRUE(file) << "Could not open " << name;
+
+        std::istream fileStream(&(file->getInputStream()));
+        return std::string(std::istreambuf_iterator<char>(fileStream), {});
+    };
+
+    auto filesBefore = collectFiles();
+    auto contentsBefore = readFile("materials/tdm_bloom_afx.mtr");
+
+    // Initialise again, this time the archive contents are taken from the cache
+    auto searchPaths = GlobalFileSystem().getVfsSearchPaths();
+    auto extensions = GlobalFileSystem().getArchiveExtensions();
+
+    GlobalFileSystem().shutdown();
+    GlobalFileSystem().initialise(searchPaths, extensions);
+
+    EXPECT_EQ(collectFiles(), filesBefore);
+    EXPECT_EQ(readFile("materials/tdm_bloom_afx.mtr"), contentsBefore);
+    EXPECT_EQ(GlobalFileSystem().getFileCount("models/darkmod/test/unit_cube.ase"), 1);
+}
+
 TEST_F(VfsTest, VisitEachFileInArchive)
 {
     fs::path pk4Path = _context.getTestProjectPath();
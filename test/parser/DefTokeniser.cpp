@@ -0,0 +1,137 @@
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <vector>
+#include <fmt/format.h>
+
+#include "parser/DefTokeniser.h"
+#include "string/convert.h"
+
+namespace test
+{
+
+namespace
+{
+
+std::vector<std::string> tokeniseStream(const std::string& input,
+    const char* delims = parser::WHITESPACE, const char* keptDelims = "{}()")
+{
+    std::istringstream stream(input);
+    parser::BasicDefTokeniser<std::istream> tok(stream, delims, keptDelims);
+
+    std::vector<std::string> tokens;
+
+    while (tok.hasMoreTokens())
+    {
+        tokens.push_back(tok.nextToken());
+    }
+
+    return tokens;
+}
+
+std::vector<std::string> tokeniseView(const std::string& input,
+    const char* delims = parser::WHITESPACE, const char* keptDelims = "{}()")
+{
+    parser::BasicDefTokeniser<std::string_view> tok(input, delims, keptDelims);
+
+    std::vector<std::string> tokens;
+
+    while (tok.hasMoreTokens())
+    {
+        tokens.emplace_back(tok.nextTokenView());
+    }
+
+    return tokens;
+}
+
+// Generates the text of a map with the given amount of brushes
+std::string generateMapText(std::size_t numBrushes)
+{
+    std::string text = "Version 2\n// entity 0\n{\n\"classname\" \"worldspawn\"\n";
+
+    for (std::size_t i = 0; i < numBrushes; ++i)
+    {
+        text += fmt::format("// primitive {0}\n{{\nbrushDef3\n{{\n", i);
+
+        for (int face = 0; face < 6; ++face)
+        {
+            text += fmt::format("( 0 0 {0} -{1} ) ( ( 0.015625 0 255.9375 ) ( 0 0.015625 0 ) ) "
+                "\"textures/darkmod/stone/brick/blocks_brown\" 0 0 0\n", face % 2 ? 1 : -1, i);
+        }
+
+        text += "}\n}\n";
+    }
+
+    return text + "}\n";
+}
+
+}
+
+TEST(DefTokeniser, ViewTokeniserMatchesStreamTokeniser)
+{
+    std::vector<std::string> inputs =
+    {
+        "",
+        "   \t\n  ",
+        "Version 2 { \"classname\" \"worldspawn\" }",
+        "token1 token2{token3}(token4)",
+        "before// comment\nafter",
+        "before/* delimited\n comment */after",
+        "/* unterminated comment",
+        "a/b/c /d e/ /",
+        "abc/**/def // trailing",
+        "\"quoted string with spaces\" unquoted\"quoted\"",
+        "\"\" \"\"",
+        "\"escaped \\\"quote\\\" \\n newline \\t tab \\x other\"",
+        "\"continued\" \\ \"string\" next",
+        "\"continued\"\n\\\n\"over\" \\ \"lines\"",
+        "\"unterminated quote",
+        "**/ *** / ** /",
+    };
+
+    for (const auto& input : inputs)
+    {
+        EXPECT_EQ(tokeniseView(input), tokeniseStream(input)) << "Input: " << input;
+    }
+
+    // Custom delimiters, slash as kept delimiter disables comment parsing
+    EXPECT_EQ(tokeniseView("1/2//3*4", "", "/*"), tokeniseStream("1/2//3*4", "", "/*"));
+    EXPECT_EQ(tokeniseView("a,b,,c", " ,", ""), tokeniseStream("a,b,,c", " ,", ""));
+
+    auto mapText = generateMapText(10);
+    EXPECT_EQ(tokeniseView(mapText), tokeniseStream(mapText));
+}
+
+TEST(DefTokeniser, ViewTokeniserPeekAndAssert)
+{
+    std::string input = "{ \"key\" 1.5 }";
+    parser::BasicDefTokeniser<std::string_view> tok(input);
+
+    EXPECT_EQ(tok.peek(), "{");
+    tok.assertNextToken("{");
+    EXPECT_EQ(tok.peek(), "key");
+    EXPECT_EQ(tok.nextToken(), "key");
+    EXPECT_EQ(string::to_float(tok.nextTokenView()), 1.5);
+    EXPECT_THROW(tok.assertNextToken(")"), parser::ParseException);
+    EXPECT_FALSE(tok.hasMoreTokens());
+    EXPECT_THROW(tok.nextTokenView(), parser::ParseException);
+}
+
+TEST(DefTokeniser, ViewNumbersConvertLikeStrings)
+{
+    for (std::string number : { "0.1", "-1234.5678", "1e-3", "abc", "", "1e50" })
+    {
+        EXPECT_EQ(string::to_float(std::string_view(number)), string::to_float(number)) << number;
+        EXPECT_EQ(string::to_double(std::string_view(number)), std::atof(number.c_str())) << number;
+    }
+}
+
+TEST(DefTokeniser, MissingQuoteAfterBackslashThrows)
+{
+    std::string input = "\"continued\" \\ unquoted";
+
+    EXPECT_THROW(tokeniseView(input), parser::ParseException);
+    EXPECT_THROW(tokeniseStream(input), parser::ParseException);
+}
+
+}